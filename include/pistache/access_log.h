@@ -0,0 +1,153 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* access_log.h
+
+   Access log of the HTTP server. A record is taken as the response to a
+   request is handed to the transport, with the method, version, status,
+   bytes sent, resource, and timings of the request. Records are binary: the
+   thread that answers pushes them, without a lock, to a ring of its own,
+   and a thread of the log writes them in batches to a file, or to a UDP or
+   Unix datagram socket. AccessLog::decode() reads them back.
+*/
+
+#pragma once
+
+#include <pistache/http_defs.h>
+#include <pistache/net.h>
+#include <pistache/os.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace Pistache::Http
+{
+
+    class AccessLog;
+    class Request;
+
+    struct AccessRecord
+    {
+        // When the request started to be received, in microseconds since
+        // the epoch
+        uint64_t time = 0;
+        // From then until the response was queued
+        std::chrono::microseconds duration { 0 };
+
+        Method method   = Method::Get;
+        Version version = Version::Http11;
+        Code status     = Code::Ok;
+        // Head and body of the response
+        uint64_t bytes = 0;
+
+        std::string resource;
+    };
+
+    // A sampled request waiting for its response, see AccessLog::begin()
+    struct PendingAccess
+    {
+        std::shared_ptr<AccessLog> log;
+        std::chrono::steady_clock::time_point received;
+        Method method;
+        Version version;
+        std::string resource;
+    };
+
+    class AccessLog : public std::enable_shared_from_this<AccessLog>
+    {
+    public:
+        static constexpr size_t DefaultRingSize = 256 * 1024;
+        static constexpr std::chrono::milliseconds DefaultInterval { 50 };
+
+        // Longest resource kept in a record, the rest is cut
+        static constexpr size_t MaxResourceSize = 1024;
+        // Largest datagram sent to a socket, a record is never split
+        static constexpr size_t MaxDatagramSize = 8192;
+
+        /* A record is written as its size, 4 bytes, followed by the
+         * time (8 bytes), bytes (8), duration in microseconds (4), status
+         * (2), method (1) and version (1), then the resource. Integers are
+         * in the byte order of the host. A datagram holds whole records.
+         */
+        static std::shared_ptr<AccessLog> toFile(const std::string& path,
+                                                 size_t ringSize                   = DefaultRingSize,
+                                                 std::chrono::milliseconds interval = DefaultInterval);
+        static std::shared_ptr<AccessLog> toUdp(const Address& address,
+                                                size_t ringSize                   = DefaultRingSize,
+                                                std::chrono::milliseconds interval = DefaultInterval);
+        static std::shared_ptr<AccessLog> toUnixSocket(const std::string& path,
+                                                       size_t ringSize                   = DefaultRingSize,
+                                                       std::chrono::milliseconds interval = DefaultInterval);
+
+        // Writes what is left in the rings, and closes the sink
+        ~AccessLog();
+
+        AccessLog(const AccessLog&) = delete;
+        AccessLog& operator=(const AccessLog&) = delete;
+
+        // Records one request in every n of each thread, 1 by default
+        void setSampling(uint32_t n);
+        uint32_t sampling() const { return sampling_.load(std::memory_order_relaxed); }
+
+        // Called by the handler as a request is dispatched, nullptr when the
+        // request is not sampled
+        std::shared_ptr<PendingAccess> begin(const Request& request,
+                                             std::chrono::steady_clock::time_point received);
+        // Called once its response has been queued, from any thread
+        void record(const PendingAccess& access, Code status, uint64_t bytes);
+
+        // Writes what has been recorded so far from the calling thread
+        void flush();
+
+        // Records dropped because the ring of their thread was full, or the
+        // sink refused them
+        uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+        uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+        // Records of a file, or of the datagrams, concatenated. An
+        // incomplete record at the end is ignored
+        static std::vector<AccessRecord> decode(std::string_view data);
+
+    private:
+        struct Ring;
+
+        AccessLog(Fd fd, bool datagrams, size_t ringSize, std::chrono::milliseconds interval);
+
+        Ring* ring();
+        void run();
+        // Called with lock_ held
+        void drain();
+        void send();
+
+        const uint64_t id_;
+        Fd fd_;
+        bool datagrams_;
+        size_t ringSize_;
+        std::chrono::milliseconds interval_;
+
+        std::atomic<uint32_t> sampling_ { 1 };
+        std::atomic<uint64_t> dropped_ { 0 };
+        std::atomic<uint64_t> written_ { 0 };
+
+        std::mutex lock_;
+        std::condition_variable wakeup_;
+        bool stop_ = false;
+        std::vector<std::shared_ptr<Ring>> rings_;
+        std::string batch_;
+        size_t batchRecords_ = 0;
+
+        std::thread writer_;
+    };
+
+} // namespace Pistache::Http
@@ -17,12 +17,15 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
+#include <iterator>
 #include <memory>
 #include <mutex>
 #include <stdexcept>
 #include <type_traits>
 #include <typeinfo>
+#include <utility>
 #include <vector>
 
 namespace Pistache::Async
@@ -61,6 +64,126 @@ namespace Pistache::Async
         ~BadAnyCast() override = default;
     };
 
+    // Rejects the promises of a chain, and the client requests, whose
+    // cancellation token was cancelled
+    class Cancelled : public Error
+    {
+    public:
+        Cancelled()
+            : Error("Cancelled")
+        { }
+    };
+
+    namespace Private
+    {
+        struct CancellationState
+        {
+            std::atomic<bool> cancelled { false };
+            std::mutex lock;
+            uint64_t next = 1;
+            std::vector<std::pair<uint64_t, std::function<void()>>> callbacks;
+        };
+    } // namespace Private
+
+    /* Tells the work started on behalf of something that it is no longer
+     * wanted, such as a request whose client went away. A default one is
+     * never cancelled. Copies share their state, and can be used from any
+     * thread.
+     */
+    class CancellationToken
+    {
+    public:
+        using Registration = uint64_t;
+
+        CancellationToken() = default;
+
+        bool isCancelled() const
+        {
+            return state_ && state_->cancelled.load(std::memory_order_acquire);
+        }
+
+        bool canBeCancelled() const { return state_ != nullptr; }
+
+        // The callback runs from the thread cancelling the token, or right
+        // away when it already is cancelled, 0 being returned then. It is
+        // kept until the token is cancelled or forgotten
+        Registration onCancel(std::function<void()> callback) const
+        {
+            if (!state_)
+                return 0;
+
+            {
+                std::lock_guard<std::mutex> guard(state_->lock);
+                if (!state_->cancelled.load(std::memory_order_relaxed))
+                {
+                    const auto registration = state_->next++;
+                    state_->callbacks.emplace_back(registration, std::move(callback));
+                    return registration;
+                }
+            }
+
+            callback();
+            return 0;
+        }
+
+        void forget(Registration registration) const
+        {
+            if (!state_ || registration == 0)
+                return;
+
+            std::lock_guard<std::mutex> guard(state_->lock);
+            auto& callbacks = state_->callbacks;
+            for (auto it = callbacks.begin(); it != callbacks.end(); ++it)
+            {
+                if (it->first == registration)
+                {
+                    callbacks.erase(it);
+                    break;
+                }
+            }
+        }
+
+    private:
+        friend class CancellationSource;
+
+        explicit CancellationToken(std::shared_ptr<Private::CancellationState> state)
+            : state_(std::move(state))
+        { }
+
+        std::shared_ptr<Private::CancellationState> state_;
+    };
+
+    class CancellationSource
+    {
+    public:
+        CancellationSource()
+            : state_(std::make_shared<Private::CancellationState>())
+        { }
+
+        CancellationToken token() const { return CancellationToken(state_); }
+
+        bool isCancelled() const { return state_->cancelled.load(std::memory_order_acquire); }
+
+        // Runs the callbacks of the tokens, only the first call has an
+        // effect
+        void cancel() const
+        {
+            std::vector<std::pair<uint64_t, std::function<void()>>> callbacks;
+            {
+                std::lock_guard<std::mutex> guard(state_->lock);
+                if (state_->cancelled.exchange(true, std::memory_order_acq_rel))
+                    return;
+                callbacks.swap(state_->callbacks);
+            }
+
+            for (auto& callback : callbacks)
+                callback.second();
+        }
+
+    private:
+        std::shared_ptr<Private::CancellationState> state_;
+    };
+
     enum class State { Pending,
                        Fulfilled,
                        Rejected };
@@ -68,6 +191,12 @@ namespace Pistache::Async
     template <typename T>
     class Promise;
 
+    namespace Impl
+    {
+        template <typename T, typename Sink>
+        struct FanIn;
+    } // namespace Impl
+
     class PromiseBase
     {
     public:
@@ -207,30 +336,21 @@ namespace Pistache::Async
                 : allocated(false)
                 , state(_state)
                 , exc()
-                , mtx()
-                , requests()
                 , id(_id)
+                , continuations_(0)
+                , request_()
+                , overflowLock_()
+                , overflow_()
             { }
 
             bool allocated;
             std::atomic<State> state;
             std::exception_ptr exc;
-
-            /*
-   * We need this lock because a Promise might be resolved or rejected from a
-   * thread A while a continuation to the same Promise (Core) might be attached
-   * at the same from a thread B. If that's the case, then we need to serialize
-   * operations so that we avoid a race-condition.
-   *
-   * Since we have a lock, we have a blocking progress guarantee but I don't
-   * expect this to be a major bottleneck as I don't expect major contention on
-   * the lock If it ends up being a bottlenick, try @improving it by
-   * experimenting with a lock-free scheme
-   */
-            std::mutex mtx;
-            std::vector<std::shared_ptr<Request>> requests;
             TypeId id;
 
+            // Handed down to the promises chained to this one
+            CancellationToken cancellation;
+
             virtual void* memory() = 0;
 
             virtual bool isVoid() const = 0;
@@ -259,7 +379,99 @@ namespace Pistache::Async
                 state     = State::Fulfilled;
             }
 
+            // Runs the continuations attached to the core. Must be called
+            // once the core has been fulfilled or rejected, only the first
+            // call has an effect
+            void resolveRequests(const std::shared_ptr<Core>& self)
+            {
+                notify(self, &Request::resolve);
+            }
+
+            void rejectRequests(const std::shared_ptr<Core>& self)
+            {
+                notify(self, &Request::reject);
+            }
+
+            // Attaches a continuation, running it right away when the core
+            // already has been completed
+            void attach(const std::shared_ptr<Core>& self, std::shared_ptr<Request> request)
+            {
+                /*
+   * A Promise might be completed from a thread A while a continuation is
+   * attached from a thread B. The first continuation, by far the most common
+   * case, is handed over through the continuations_ flags alone: whichever of
+   * the attaching and the completing thread comes last runs it. Further
+   * continuations fall back to a locked vector.
+   */
+                auto prev = continuations_.fetch_or(Claimed, std::memory_order_acq_rel);
+                if ((prev & Claimed) == 0)
+                {
+                    request_ = std::move(request);
+                    prev     = continuations_.fetch_or(Attached, std::memory_order_acq_rel);
+                    if (prev & Completed)
+                        dispatch(self, *request_);
+                    return;
+                }
+
+                continuations_.fetch_or(Overflow, std::memory_order_acq_rel);
+                {
+                    std::lock_guard<std::mutex> guard(overflowLock_);
+                    if ((continuations_.load(std::memory_order_acquire) & Completed) == 0)
+                    {
+                        overflow_.push_back(std::move(request));
+                        return;
+                    }
+                }
+                dispatch(self, *request);
+            }
+
             virtual ~Core() = default;
+
+        private:
+            enum : uint32_t {
+                Claimed   = 1,
+                Attached  = 1 << 1,
+                Overflow  = 1 << 2,
+                Completed = 1 << 3
+            };
+
+            using Notify = void (Request::*)(const std::shared_ptr<Core>&);
+
+            void notify(const std::shared_ptr<Core>& self, Notify how)
+            {
+                const auto prev = continuations_.fetch_or(Completed, std::memory_order_acq_rel);
+                if (prev & Completed)
+                    return;
+
+                if (prev & Attached)
+                    ((*request_).*how)(self);
+
+                if (prev & Overflow)
+                {
+                    std::vector<std::shared_ptr<Request>> requests;
+                    {
+                        std::lock_guard<std::mutex> guard(overflowLock_);
+                        requests = overflow_;
+                    }
+
+                    for (const auto& req : requests)
+                        ((*req).*how)(self);
+                }
+            }
+
+            void dispatch(const std::shared_ptr<Core>& self, Request& request)
+            {
+                if (state == State::Fulfilled)
+                    request.resolve(self);
+                else if (state == State::Rejected)
+                    request.reject(self);
+            }
+
+            std::atomic<uint32_t> continuations_;
+            std::shared_ptr<Request> request_;
+
+            std::mutex overflowLock_;
+            std::vector<std::shared_ptr<Request>> overflow_;
         };
 
         template <typename T>
@@ -332,6 +544,17 @@ namespace Pistache::Async
                         // throw Error("Resolve must not be called more than once");
 
                 ++resolveCount_;
+
+                // The continuation does not run, the rest of the chain is
+                // rejected instead
+                if (chain_->cancellation.isCancelled())
+                {
+                    chain_->exc   = std::make_exception_ptr(Cancelled());
+                    chain_->state = State::Rejected;
+                    chain_->rejectRequests(chain_);
+                    return;
+                }
+
                 doResolve(coreCast(core));
             }
 
@@ -350,10 +573,7 @@ namespace Pistache::Async
                 {
                     chain_->exc   = e.exc;
                     chain_->state = State::Rejected;
-                    for (const auto& req : chain_->requests)
-                    {
-                        req->reject(chain_);
-                    }
+                    chain_->rejectRequests(chain_);
                 }
             }
 
@@ -433,10 +653,7 @@ namespace Pistache::Async
                 void doReject(const std::shared_ptr<CoreT<T>>& core) override
                 {
                     reject_(core->exc);
-                    for (const auto& req : this->chain_->requests)
-                    {
-                        req->reject(this->chain_);
-                    }
+                    this->chain_->rejectRequests(this->chain_);
                 }
 
                 template <typename Ret>
@@ -444,10 +661,7 @@ namespace Pistache::Async
                 {
                     typedef typename std::decay<Ret>::type CleanRet;
                     this->chain_->template construct<CleanRet>(std::forward<Ret>(ret));
-                    for (const auto& req : this->chain_->requests)
-                    {
-                        req->resolve(this->chain_);
-                    }
+                    this->chain_->resolveRequests(this->chain_);
                 }
 
                 Resolve resolve_;
@@ -478,10 +692,7 @@ namespace Pistache::Async
                 void doReject(const std::shared_ptr<CoreT<void>>& core) override
                 {
                     reject_(core->exc);
-                    for (const auto& req : this->chain_->requests)
-                    {
-                        req->reject(this->chain_);
-                    }
+                    this->chain_->rejectRequests(this->chain_);
                 }
 
                 template <typename Ret>
@@ -489,10 +700,7 @@ namespace Pistache::Async
                 {
                     typedef typename std::remove_reference<Ret>::type CleanRet;
                     this->chain_->template construct<CleanRet>(std::forward<Ret>(ret));
-                    for (const auto& req : this->chain_->requests)
-                    {
-                        req->resolve(this->chain_);
-                    }
+                    this->chain_->resolveRequests(this->chain_);
                 }
 
                 Resolve resolve_;
@@ -594,10 +802,7 @@ namespace Pistache::Async
                 void doReject(const std::shared_ptr<CoreT<T>>& core) override
                 {
                     reject_(core->exc);
-                    for (const auto& req : core->requests)
-                    {
-                        req->reject(core);
-                    }
+                    this->chain_->rejectRequests(this->chain_);
                 }
 
                 template <typename PromiseType>
@@ -610,10 +815,7 @@ namespace Pistache::Async
                     void operator()(const PromiseType& val)
                     {
                         chainCore->construct<PromiseType>(val);
-                        for (const auto& req : chainCore->requests)
-                        {
-                            req->resolve(chainCore);
-                        }
+                        chainCore->resolveRequests(chainCore);
                     }
 
                     std::shared_ptr<Core> chainCore;
@@ -637,10 +839,7 @@ namespace Pistache::Async
                             core->exc   = std::move(exc);
                             core->state = State::Rejected;
 
-                            for (const auto& req : core->requests)
-                            {
-                                req->reject(core);
-                            }
+                            core->rejectRequests(core);
                         }
                     });
                 }
@@ -674,10 +873,7 @@ namespace Pistache::Async
                 void doReject(const std::shared_ptr<CoreT<void>>& core) override
                 {
                     reject_(core->exc);
-                    for (const auto& req : core->requests)
-                    {
-                        req->reject(core);
-                    }
+                    this->chain_->rejectRequests(this->chain_);
                 }
 
                 template <typename PromiseType, typename Dummy = void>
@@ -690,10 +886,7 @@ namespace Pistache::Async
                     void operator()(const PromiseType& val)
                     {
                         chainCore->construct<PromiseType>(val);
-                        for (const auto& req : chainCore->requests)
-                        {
-                            req->resolve(chainCore);
-                        }
+                        chainCore->resolveRequests(chainCore);
                     }
 
                     std::shared_ptr<Core> chainCore;
@@ -711,10 +904,7 @@ namespace Pistache::Async
                         auto core   = this->chain_;
                         core->state = State::Fulfilled;
 
-                        for (const auto& req : chainCore->requests)
-                        {
-                            req->resolve(chainCore);
-                        }
+                        chainCore->resolveRequests(chainCore);
                     }
 
                     std::shared_ptr<Core> chainCore;
@@ -731,15 +921,12 @@ namespace Pistache::Async
                 void finishResolve(P& promise)
                 {
                     auto chainer = makeChainer(promise);
-                    promise.then(std::move(chainer), [=](std::exception_ptr exc) {
+                    promise.then(std::move(chainer), [this](std::exception_ptr exc) {
                         auto core   = this->chain_;
                         core->exc   = std::move(exc);
                         core->state = State::Rejected;
 
-                        for (const auto& req : core->requests)
-                        {
-                            req->reject(core);
-                        }
+                        core->rejectRequests(core);
                     });
                 }
 
@@ -814,6 +1001,29 @@ namespace Pistache::Async
                 : Base(core, std::move(resolve), std::move(reject))
             { }
         };
+        // Runs a continuation through an executor rather than on the thread
+        // completing the promise
+        template <typename Executor>
+        struct Hop : public Request
+        {
+            Hop(std::shared_ptr<Request> next, Executor executor)
+                : next_(std::move(next))
+                , executor_(std::move(executor))
+            { }
+
+            void resolve(const std::shared_ptr<Core>& core) override
+            {
+                executor_([next = next_, core]() { next->resolve(core); });
+            }
+
+            void reject(const std::shared_ptr<Core>& core) override
+            {
+                executor_([next = next_, core]() { next->reject(core); });
+            }
+
+            std::shared_ptr<Request> next_;
+            Executor executor_;
+        };
     } // namespace Private
 
     class Resolver
@@ -849,13 +1059,9 @@ namespace Pistache::Async
                 throw Error("Attempt to resolve a void promise with arguments");
             }
 
-            std::unique_lock<std::mutex> guard(core_->mtx);
             core_->construct<Type>(std::forward<Arg>(arg));
 
-            for (const auto& req : core_->requests)
-            {
-                req->resolve(core_);
-            }
+            core_->resolveRequests(core_);
 
             return true;
         }
@@ -871,12 +1077,8 @@ namespace Pistache::Async
             if (!core_->isVoid())
                 throw Error("Attempt ro resolve a non-void promise with no argument");
 
-            std::unique_lock<std::mutex> guard(core_->mtx);
             core_->state = State::Fulfilled;
-            for (const auto& req : core_->requests)
-            {
-                req->resolve(core_);
-            }
+            core_->resolveRequests(core_);
 
             return true;
         }
@@ -911,13 +1113,25 @@ namespace Pistache::Async
             if (core_->state != State::Pending)
                 throw Error("Attempt to reject a fulfilled promise");
 
-            std::unique_lock<std::mutex> guard(core_->mtx);
             core_->exc   = std::make_exception_ptr(exc);
             core_->state = State::Rejected;
-            for (const auto& req : core_->requests)
-            {
-                req->reject(core_);
-            }
+            core_->rejectRequests(core_);
+
+            return true;
+        }
+
+        // Passes on the exception another promise was rejected with
+        bool operator()(std::exception_ptr exc) const
+        {
+            if (!core_)
+                return false;
+
+            if (core_->state != State::Pending)
+                throw Error("Attempt to reject a fulfilled promise");
+
+            core_->exc   = std::move(exc);
+            core_->state = State::Rejected;
+            core_->rejectRequests(core_);
 
             return true;
         }
@@ -1047,6 +1261,8 @@ namespace Pistache::Async
     public:
         template <typename U>
         friend class Promise;
+        template <typename U, typename Sink>
+        friend struct Impl::FanIn;
 
         typedef Private::CoreT<T> Core;
 
@@ -1056,7 +1272,7 @@ namespace Pistache::Async
             , resolver_(core_)
             , rejection_(core_)
         {
-            details::callAsync<T>(func, resolver_, rejection_);
+            details::callAsync<T>(std::move(func), resolver_, rejection_);
         }
 
         Promise(const Promise<T>& other) = delete;
@@ -1077,6 +1293,7 @@ namespace Pistache::Async
 
             auto core = std::make_shared<Core>();
             core->template construct<T>(std::forward<U>(value));
+            core->resolveRequests(core);
             return Promise<T>(std::move(core));
         }
 
@@ -1087,6 +1304,7 @@ namespace Pistache::Async
 
             auto core   = std::make_shared<Core>();
             core->state = State::Fulfilled;
+            core->resolveRequests(core);
             return Promise<T>(std::move(core));
         }
 
@@ -1096,6 +1314,7 @@ namespace Pistache::Async
             auto core   = std::make_shared<Core>();
             core->exc   = std::make_exception_ptr(exc);
             core->state = State::Rejected;
+            core->rejectRequests(core);
             return Promise<T>(std::move(core));
         }
 
@@ -1113,26 +1332,57 @@ namespace Pistache::Async
                 typename detail::FunctionTrait<ResolveFunc>::ReturnType>::Type RetType;
 
             Promise<RetType> promise;
+            promise.core_->cancellation = core_->cancellation;
 
             typedef Private::Continuation<T, ResolveFunc, RejectFunc, ResolveFunc>
                 Continuation;
             std::shared_ptr<Private::Request> req = std::make_shared<Continuation>(promise.core_, resolveFunc, rejectFunc);
 
-            std::unique_lock<std::mutex> guard(core_->mtx);
-            if (isFulfilled())
-            {
-                req->resolve(core_);
-            }
-            else if (isRejected())
-            {
-                req->reject(core_);
-            }
+            core_->attach(core_, std::move(req));
+
+            return promise;
+        }
 
-            core_->requests.push_back(req);
+        /* Same as then(), but the continuations run from the executor, a
+         * callable given each of them as a std::function<void()>, instead of
+         * the thread completing the promise. Such as the dispatcher of the
+         * transport owning a response, see ResponseWriter::executor(). A
+         * continuation the executor drops never runs.
+         */
+        template <typename Executor, typename ResolveFunc, typename RejectFunc>
+        auto thenOn(Executor executor, ResolveFunc resolveFunc, RejectFunc rejectFunc)
+            -> Promise<typename detail::RemovePromise<
+                typename detail::FunctionTrait<ResolveFunc>::ReturnType>::Type>
+        {
+            typedef typename detail::RemovePromise<
+                typename detail::FunctionTrait<ResolveFunc>::ReturnType>::Type RetType;
+
+            Promise<RetType> promise;
+            promise.core_->cancellation = core_->cancellation;
+
+            typedef Private::Continuation<T, ResolveFunc, RejectFunc, ResolveFunc>
+                Continuation;
+            auto req = std::make_shared<Continuation>(promise.core_, resolveFunc, rejectFunc);
+
+            core_->attach(core_, std::make_shared<Private::Hop<Executor>>(std::move(req),
+                                                                          std::move(executor)));
 
             return promise;
         }
 
+        /* Once the token is cancelled, the continuations chained after this
+         * promise are not run anymore, their promises are rejected with
+         * Cancelled instead. The promise itself is left to its producer,
+         * which may honor the token as well. Set before chaining.
+         */
+        Promise<T>& cancelWith(CancellationToken token)
+        {
+            core_->cancellation = std::move(token);
+            return *this;
+        }
+
+        const CancellationToken& cancellation() const { return core_->cancellation; }
+
     private:
         Promise()
             : core_(std::make_shared<Core>())
@@ -1633,6 +1883,145 @@ namespace Pistache::Async
             Rejection reject;
         };
 
+        /* Joins the promises of a range without a continuation of their own:
+         * the requests attached to them live in a single block, along with
+         * the countdown, and share its ownership. The sink is given each
+         * value with its index in the range, from the thread resolving its
+         * promise, then finishes once all of them were.
+         */
+        template <typename T, typename Sink>
+        struct FanIn
+        {
+            struct Slot : public Private::Request
+            {
+                void resolve(const std::shared_ptr<Private::Core>& core) override
+                {
+                    owner->onResolved(index, *core);
+                }
+
+                void reject(const std::shared_ptr<Private::Core>& core) override
+                {
+                    owner->onRejected(core->exc);
+                }
+
+                FanIn* owner = nullptr;
+                size_t index = 0;
+            };
+
+            FanIn(size_t total, Sink _sink, Resolver _resolve, Rejection _reject)
+                : slots(total)
+                , remaining(total)
+                , sink(std::move(_sink))
+                , resolve(std::move(_resolve))
+                , reject(std::move(_reject))
+            { }
+
+            template <typename Iterator>
+            static void start(Iterator first, Iterator last, Sink sink, Resolver& resolve,
+                              Rejection& reject)
+            {
+                const auto total = static_cast<size_t>(std::distance(first, last));
+                if (total == 0)
+                {
+                    sink.finish(resolve);
+                    return;
+                }
+
+                auto block = std::make_shared<FanIn>(total, std::move(sink), std::move(resolve),
+                                                     std::move(reject));
+
+                size_t index = 0;
+                for (auto it = first; it != last; ++it, ++index)
+                {
+                    auto& slot = block->slots[index];
+                    slot.owner = block.get();
+                    slot.index = index;
+
+                    // Owned by the block, nothing is allocated for the promise
+                    it->core_->attach(it->core_, std::shared_ptr<Private::Request>(block, &slot));
+                }
+            }
+
+            void onResolved(size_t index, Private::Core& core)
+            {
+                if (failed.load(std::memory_order_acquire))
+                    return;
+
+                try
+                {
+                    if constexpr (std::is_void<T>::value)
+                        sink.value(index);
+                    else
+                        sink.value(index, static_cast<Private::CoreT<T>&>(core).value());
+                }
+                catch (...)
+                {
+                    onRejected(std::current_exception());
+                    return;
+                }
+
+                // A rejected promise never counts down, the last one to do so
+                // sees every value written
+                if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    sink.finish(resolve);
+            }
+
+            void onRejected(std::exception_ptr exc)
+            {
+                if (!failed.exchange(true, std::memory_order_acq_rel))
+                    reject(std::move(exc));
+            }
+
+            std::vector<Slot> slots;
+            std::atomic<size_t> remaining;
+            std::atomic<bool> failed { false };
+
+            Sink sink;
+            Resolver resolve;
+            Rejection reject;
+        };
+
+        // Writes the values to their place in a single array
+        template <typename T>
+        struct GatherSink
+        {
+            explicit GatherSink(size_t total)
+                : results(total)
+            { }
+
+            void value(size_t index, const T& val) { results[index] = val; }
+            void finish(Resolver& resolve) { resolve(std::move(results)); }
+
+            std::vector<T> results;
+        };
+
+        template <>
+        struct GatherSink<void>
+        {
+            explicit GatherSink(size_t) { }
+
+            void value(size_t) { }
+            void finish(Resolver& resolve) { resolve(); }
+        };
+
+        template <typename T, typename Func>
+        struct EachSink
+        {
+            void value(size_t index, const T& val) { func(index, val); }
+            void finish(Resolver& resolve) { resolve(); }
+
+            Func func;
+        };
+
+        template <typename Func>
+        struct EachSink<void, Func>
+        {
+            void value(size_t index) { func(index); }
+            void finish(Resolver& resolve) { resolve(); }
+
+            Func func;
+        };
+
     } // namespace Impl
 
     template <typename... Args,
@@ -1694,4 +2083,42 @@ namespace Pistache::Async
         });
     }
 
+    /* Same as whenAll(first, last), for the fan-outs of many promises: the
+     * values go to a single array, counted down without a lock, and nothing
+     * is allocated per promise of the range. Rejected with the first of them
+     * to be rejected.
+     */
+    template <typename Iterator,
+              typename ValueType = typename detail::RemovePromise<
+                  typename std::iterator_traits<Iterator>::value_type>::Type,
+              typename Results =
+                  typename std::conditional<std::is_same<void, ValueType>::value,
+                                            void, std::vector<ValueType>>::type>
+    Promise<Results> gather(Iterator first, Iterator last)
+    {
+        return Promise<Results>([=](Resolver& resolve, Rejection& reject) {
+            using Sink = Impl::GatherSink<ValueType>;
+            Impl::FanIn<ValueType, Sink>::start(
+                first, last, Sink(static_cast<size_t>(std::distance(first, last))), resolve, reject);
+        });
+    }
+
+    /* Streams the values of the promises of a range as they come: func is
+     * called with the index of the promise in the range and its value, from
+     * the thread resolving it, so the calls may run concurrently. The promise
+     * returned is resolved once every promise of the range was, and rejected
+     * with the first rejection or exception thrown by func, after which func
+     * is not called anymore.
+     */
+    template <typename Iterator, typename Func,
+              typename ValueType = typename detail::RemovePromise<
+                  typename std::iterator_traits<Iterator>::value_type>::Type>
+    Promise<void> whenEach(Iterator first, Iterator last, Func func)
+    {
+        return Promise<void>([=](Resolver& resolve, Rejection& reject) {
+            using Sink = Impl::EachSink<ValueType, Func>;
+            Impl::FanIn<ValueType, Sink>::start(first, last, Sink { func }, resolve, reject);
+        });
+    }
+
 } // namespace Pistache::Async
@@ -15,7 +15,9 @@
 
 // Standard C++ / POSIX system headers...
 #include <cstddef>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #if __cplusplus < 201703L
@@ -43,6 +45,19 @@ public:
     // Decode base 64 encoding into raw bytes...
     const std::vector<std::byte>& Decode();
 
+    // Largest number of raw bytes that base 64 encoding of a given length can
+    //  decode to...
+    static std::size_t MaxDecodedSize(const std::size_t EncodedSize) noexcept
+    {
+        return (EncodedSize + 3) / 4 * 3;
+    }
+
+    // Decode base 64 encoding, padded or not, into a caller supplied buffer of
+    //  at least MaxDecodedSize() bytes without allocating. Returns the number
+    //  of decoded bytes, or nothing if the input is not base 64...
+    static std::optional<std::size_t> DecodeInto(std::string_view Encoded,
+                                                 std::byte* Output) noexcept;
+
     // Get raw decoded data...
     const std::vector<std::byte>& GetRawDecodedData() const noexcept
     {
@@ -85,6 +100,12 @@ public:
     // Encode a string into base 64 format...
     static std::string EncodeString(const std::string& StringInput);
 
+    // Encode raw bytes into a caller supplied buffer of CalculateEncodedSize()
+    //  characters without allocating. Returns the number of characters...
+    static std::string::size_type EncodeInto(const std::byte* Input,
+                                             std::size_t InputSize,
+                                             char* Output) noexcept;
+
     // Get the encoded data...
     const std::string& GetBase64EncodedString() const noexcept
     {
@@ -0,0 +1,88 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* buffer_pool.h
+
+   Blocks of memory for the buffers of the requests and of the responses,
+   recycled instead of going back to the allocator. The blocks come in size
+   classes, powers of two from MinBlock to MaxBlock bytes, and every thread
+   keeps the ones it released in a cache of its own: a worker takes and gives
+   back its blocks without a lock. The blocks can be carved from 2 MiB huge
+   pages, to spare the TLB when many connections hold a buffer.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Pistache
+{
+
+    // A block of memory from the pool, given back by the destructor to the
+    // pool of the thread that destroys it
+    class PooledBuffer
+    {
+    public:
+        PooledBuffer() = default;
+        // A block of at least capacity bytes, none of them in use
+        explicit PooledBuffer(size_t capacity);
+
+        PooledBuffer(const PooledBuffer&)            = delete;
+        PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+        PooledBuffer(PooledBuffer&& other) noexcept;
+        PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+
+        ~PooledBuffer();
+
+        char* data() { return data_; }
+        const char* data() const { return data_; }
+
+        // Bytes in use, from the start of the block
+        size_t size() const { return size_; }
+        void resize(size_t size) { size_ = size; }
+
+        size_t capacity() const { return capacity_; }
+        bool empty() const { return size_ == 0; }
+
+        // Moves to a block of at least capacity bytes, keeping the ones in use
+        void reserve(size_t capacity);
+
+        // Gives the block back to the pool
+        void reset();
+
+    private:
+        char* data_      = nullptr;
+        size_t size_     = 0;
+        size_t capacity_ = 0;
+        // Carved from a huge page, the block never goes back to the allocator
+        bool slab_ = false;
+    };
+
+    namespace BufferPool
+    {
+        static constexpr size_t MinBlock = 512;
+        // Larger buffers are taken from the allocator and freed along with
+        // their PooledBuffer
+        static constexpr size_t MaxBlock = 1024 * 1024;
+
+        // Carves the blocks allocated from now on from 2 MiB huge pages,
+        // explicit ones when the system reserved some, transparent ones
+        // otherwise. Memory carved that way is kept by the pool for good
+        void setHugePages(bool enabled);
+        bool hugePages();
+
+        // Fills the cache of the calling thread with blocks for a total of
+        // about bytes, in the sizes the buffers of a connection start with
+        void reserve(size_t bytes);
+
+        // Blocks taken from the allocator or from huge pages so far, by all
+        // the threads
+        uint64_t allocated();
+    } // namespace BufferPool
+
+} // namespace Pistache
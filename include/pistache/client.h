@@ -13,19 +13,29 @@
 #pragma once
 
 #include <pistache/async.h>
+#include <pistache/dns_resolver.h>
 #include <pistache/http.h>
+#include <pistache/http2.h>
+#include <pistache/mailbox.h>
+#include <pistache/net.h>
 #include <pistache/os.h>
 #include <pistache/reactor.h>
-#include <pistache/timer_pool.h>
+#include <pistache/timer_wheel.h>
+#include <pistache/tls_session.h>
 #include <pistache/view.h>
 
 #include <atomic>
 #include <chrono>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace Pistache::Http::Experimental
 {
@@ -36,95 +46,490 @@ namespace Pistache::Http::Experimental
         constexpr int MaxConnectionsPerHost = 8;
         constexpr bool KeepAlive            = true;
         constexpr size_t MaxResponseSize    = std::numeric_limits<uint32_t>::max();
+        constexpr int DnsResolverThreads    = 1;
+        constexpr auto DnsCacheTtl          = std::chrono::seconds(60);
+        constexpr size_t PipelineDepth      = 1;
+        // Zero keeps the connections open for as long as the server does
+        constexpr auto IdleTimeout = std::chrono::milliseconds(0);
+        constexpr auto MaxLifetime = std::chrono::milliseconds(0);
+        // Retries and hedges allowed per request on average, and at most in
+        // a burst
+        constexpr double RetryRatio = 0.2;
+        constexpr size_t RetryBurst = 10;
+        // RFC 8305 section 5: how long a connection attempt runs alone before
+        // the next address of the host is tried alongside it
+        constexpr auto ConnectionAttemptDelay = std::chrono::milliseconds(250);
+        // Streams of an HTTP/2 connection, unless the server allows less
+        constexpr size_t Http2Streams = 100;
     } // namespace Default
 
+    // How the client speaks HTTP/2, see Client::Options::http2()
+    enum class Http2Mode {
+        // HTTP/1.1 only
+        Off,
+        // Offered with ALPN to the https servers
+        Tls,
+        // To the http servers as well, which are known to speak it (h2c)
+        PriorKnowledge
+    };
+
     class Transport;
+    class HostConnections;
+    // The TLS configuration of a client, and the sessions of its https hosts
+    struct TlsContext;
+    struct Connection;
+
+    // Flow control of a streamed response body: while paused, the connection
+    // is not read and TCP slows the server down. The bytes already received,
+    // one receive buffer at most, are still handed to the reader. On HTTP/2
+    // the window of the stream is not given back instead, the other streams
+    // of the connection go on
+    class ResponseFlow
+    {
+    public:
+        ResponseFlow() = default;
+
+        // Both can be called from any thread
+        void pause() const;
+        void resume() const;
+
+    private:
+        friend struct Connection;
+        explicit ResponseFlow(std::weak_ptr<Connection> connection, uint32_t stream = 0);
+
+        std::weak_ptr<Connection> connection_;
+        uint32_t stream_;
+    };
+
+    // Called from the thread of the transport once the headers of a response
+    // have been received. The body is then handed to the returned reader as
+    // it arrives instead of being buffered, and the promise of the response
+    // is resolved right away, with an empty body. A null reader leaves the
+    // body buffered as usual
+    using BodyStart = std::function<std::shared_ptr<BodyReader>(const Response& response, ResponseFlow flow)>;
+
+    // Cancels a request. It is rejected with "Cancelled" and its response is
+    // read and dropped. A connection that does not pipeline requests is closed
+    // right away instead, its next request would get that response otherwise.
+    // On HTTP/2 its stream is reset, the connection is kept
+    class Cancellation
+    {
+    public:
+        // Can be called from any thread, more than once
+        void cancel();
+        bool isCancelled() const;
+
+    private:
+        friend struct Connection;
+        friend class Client;
+
+        // Called at once when the request was already cancelled
+        void onCancel(std::function<void()> callback);
+
+        mutable std::mutex lock_;
+        bool cancelled_ = false;
+        std::function<void()> callback_;
+    };
+
+    // Retries and hedges draw from a budget that the requests refill, so that
+    // they stay a fraction of the traffic and do not pile up on an upstream
+    // that already struggles
+    class RetryBudget
+    {
+    public:
+        RetryBudget();
+
+        // Starts with the full burst
+        void init(double ratio, size_t burst);
+
+        // Once per request. Each retry or hedge then withdraws one, as long
+        // as there is one left
+        void deposit();
+        bool withdraw();
+
+    private:
+        // In thousandths of a retry
+        int64_t deposit_;
+        int64_t max_;
+        std::atomic<int64_t> balance_;
+    };
 
     struct Connection : public std::enable_shared_from_this<Connection>
     {
 
         using OnDone = std::function<void()>;
 
-        explicit Connection(size_t maxResponseSize);
+        explicit Connection(size_t maxResponseSize,
+                            size_t pipelineDepth = Default::PipelineDepth,
+                            Http2Mode http2      = Http2Mode::Off,
+                            size_t maxStreams    = Default::Http2Streams);
+        ~Connection();
 
         struct RequestData
         {
 
             RequestData(Async::Resolver resolve, Async::Rejection reject,
-                        const Http::Request& request, OnDone onDone)
+                        const Http::Request& request, OnDone onDone,
+                        BodyStart bodyStart                        = nullptr,
+                        std::shared_ptr<Cancellation> cancellation = nullptr)
                 : resolve(std::move(resolve))
                 , reject(std::move(reject))
                 , request(request)
                 , onDone(std::move(onDone))
+                , bodyStart(std::move(bodyStart))
+                , cancellation(std::move(cancellation))
             { }
             Async::Resolver resolve;
             Async::Rejection reject;
 
             Http::Request request;
             OnDone onDone;
+            BodyStart bodyStart;
+            std::shared_ptr<Cancellation> cancellation;
         };
 
+        // The state counts the requests in flight on the connection, Exclusive
+        // is set when no other request may be pipelined behind them
         enum State : uint32_t { Idle,
-                                Used };
+                                Used,
+                                Exclusive = 1u << 31 };
 
         enum ConnectionState { NotConnected,
                                Connecting,
                                Connected };
 
-        void connect(const Address& addr);
+        // Called with whether the connection could be established, once the
+        // requests queued meanwhile have been sent or rejected
+        using OnConnected = std::function<void(bool connected)>;
+
+        void connect(const Address& addr, OnConnected onConnected = nullptr);
+        // Races connection attempts to the addresses, in order, each one
+        // starting once the previous failed or ConnectionAttemptDelay after
+        // it started. The first socket connected is kept
+        void connect(std::vector<Address> addresses, OnConnected onConnected = nullptr);
+        // Speaks TLS to the server once connected. The session of the last
+        // connection with the same key is resumed, and the certificate of the
+        // server is checked against its name
+        void useTls(std::shared_ptr<TlsContext> tls, std::string sessionKey,
+                    std::string serverName);
         void close();
         bool isIdle() const;
-        bool tryUse();
+        bool tryUse(bool exclusive = false);
+        // Adds a request to a connection that already is in use, as long as
+        // less than pipelineDepth requests are in flight, or streams of an
+        // HTTP/2 connection are open
+        bool tryPipeline();
+        // Returns true when the last request in flight was released
+        bool tryRelease();
         void setAsIdle();
         bool isConnected() const;
+        // Whether the connection speaks HTTP/2, its requests then are the
+        // streams of its session
+        bool isMultiplexed() const { return multiplexed_.load(std::memory_order_acquire); }
         bool hasTransport() const;
         void associateTransport(const std::shared_ptr<Transport>& transport);
 
-        Async::Promise<Response> perform(const Http::Request& request, OnDone onDone);
+        Async::Promise<Response> perform(const Http::Request& request, OnDone onDone,
+                                         BodyStart bodyStart                        = nullptr,
+                                         std::shared_ptr<Cancellation> cancellation = nullptr);
 
         Async::Promise<Response> asyncPerform(const Http::Request& request,
-                                              OnDone onDone);
-
-        void performImpl(const Http::Request& request, Async::Resolver resolve,
-                         Async::Rejection reject, OnDone onDone);
+                                              OnDone onDone, BodyStart bodyStart = nullptr,
+                                              std::shared_ptr<Cancellation> cancellation = nullptr);
+
+        void performImpl(Http::Request request, Async::Resolver resolve,
+                         Async::Rejection reject, OnDone onDone,
+                         BodyStart bodyStart                        = nullptr,
+                         std::shared_ptr<Cancellation> cancellation = nullptr);
+        // As a stream of the HTTP/2 session
+        void performHttp2(Http::Request request, Async::Resolver resolve,
+                          Async::Rejection reject, OnDone onDone, BodyStart bodyStart,
+                          std::shared_ptr<Cancellation> cancellation);
 
         Fd fd() const;
         void handleResponsePacket(const char* buffer, size_t totalBytes);
         void handleError(const char* error);
-        void handleTimeout();
+        // Called by the transport once the timer of a request expired, returns
+        // true when the connection had to be closed. On HTTP/2 only the stream
+        // of the request is reset
+        bool handleTimeout(uint64_t request);
+        // Called by the transport once a request has been cancelled, returns
+        // true when the connection had to be closed
+        bool handleCancel(uint64_t request);
+        // Whether the request was cancelled before it could be written, it
+        // is not written then
+        bool isWithdrawn(uint64_t request);
+
+        // Whether the body of a response is being streamed to a reader, and
+        // whether that reader paused the reading of the connection
+        bool isStreaming() const;
+        bool isReadPaused() const;
+
+        // Rejects every request queued while the connection was being
+        // established
+        void rejectPendingRequests(const char* error);
+        // Queued until the connection has been established
+        void queueRequest(RequestData request);
+
+        // Whether an established connection has been idle for too long, or
+        // open for too long. A zero duration disables the check
+        bool isExpired(std::chrono::steady_clock::time_point now,
+                       std::chrono::milliseconds idleTimeout,
+                       std::chrono::milliseconds maxLifetime) const;
+        // Closes the connection from the thread of its transport, then calls
+        // done. The connection is checked out meanwhile
+        void closeFromTransport(OnDone done);
+
+        // Index of the transport of the connection, see HostConnections
+        size_t lane() const { return lane_; }
+        // Pool of the host the connection belongs to, null when it has none
+        // or when the client it belongs to is gone
+        std::shared_ptr<HostConnections> hostConnections() const { return host_.lock(); }
 
         std::string dump() const;
 
     private:
+        friend class HostConnections;
+        friend class ConnectionPool;
+        friend class Transport;
+
         void processRequestQueue();
 
+        // Once the socket of the connection has been connected, or could not
+        // be, from the thread of the transport
+        void established(OnConnected onConnected);
+        // Whether the connection speaks HTTP/2 once established, as
+        // negotiated with ALPN or known beforehand
+        bool wantsHttp2() const;
+        void failConnect(const char* error, OnConnected onConnected);
+
+        enum class Handshake { Done,
+                               WantRead,
+                               WantWrite,
+                               Failed };
+
+        // The TLS handshake, driven by the transport
+        bool startTls(std::string& error);
+        Handshake handshake(std::string& error);
+        bool isHandshaking() const;
+        bool isTls() const { return ssl_ != nullptr; }
+        // Same results as recv() and send(), errno is EAGAIN while TLS waits
+        // for the socket
+        ssize_t readTls(char* buffer, size_t size);
+        ssize_t writeTls(const char* data, size_t size);
+
+        // The attempts of connect(), only used from the thread of the
+        // transport
+        struct ConnectRace;
+        void nextAttempt(const std::shared_ptr<ConnectRace>& race);
+        void onAttemptConnected(const std::shared_ptr<ConnectRace>& race, Fd fd);
+        void onAttemptFailed(const std::shared_ptr<ConnectRace>& race, Fd fd, const char* error);
+
         struct RequestEntry
         {
             RequestEntry(Async::Resolver resolve, Async::Rejection reject,
-                         std::shared_ptr<TimerPool::Entry> timer, OnDone onDone)
+                         uint64_t id, OnDone onDone, BodyStart bodyStart)
                 : resolve(std::move(resolve))
                 , reject(std::move(reject))
-                , timer(std::move(timer))
+                , id(id)
                 , onDone(std::move(onDone))
+                , bodyStart(std::move(bodyStart))
             { }
 
             Async::Resolver resolve;
             Async::Rejection reject;
-            std::shared_ptr<TimerPool::Entry> timer;
+            // Tells the request apart when its timer expires
+            uint64_t id;
+            // On the timing wheel of the transport
+            TimerWheel::TimerId timer = TimerWheel::InvalidTimer;
+            OnDone onDone;
+            BodyStart bodyStart;
+            // Its response is dropped when it comes
+            bool cancelled = false;
+            // On HTTP/2, once it has been submitted
+            uint32_t stream = 0;
+        };
+
+        // A stream of the HTTP/2 session, only used from the thread of the
+        // transport. Its request is in flight until the head of its response
+        // comes, a streamed body then goes to its reader
+        struct Http2Stream
+        {
+            uint64_t request = 0;
+            std::shared_ptr<BodyReader> reader;
             OnDone onDone;
         };
 
+        friend class ResponseFlow;
+
+        std::deque<RequestEntry> takeInflight();
+        void cancelTimer(const RequestEntry& entry);
+
+        void parseResponses();
+        // Returns true once the response came whole, or its body was streamed
+        // to its end
+        bool startBody(RequestEntry& entry);
+        // Returns how many of the bytes belong to the streamed body
+        size_t feedBody(const char* data, size_t size);
+        void endBody(const char* error);
+        void resumeReading();
+
+        // HTTP/2, from the thread of the transport
+        void startHttp2();
+        void submitHttp2(uint64_t request, std::vector<Hpack::HeaderField> head, std::string body);
+        std::optional<RequestEntry> takeEntry(uint64_t request);
+        bool onStreamHead(uint32_t stream, const Response& response);
+        void onStreamData(uint32_t stream, std::string_view data);
+        void onStreamResponse(uint32_t stream, Response response);
+        void onStreamReset(uint32_t stream, const char* error);
+        void pauseStream(uint32_t stream, bool paused);
+
         Fd fd_;
 
-        struct sockaddr_in saddr;
-        std::unique_ptr<RequestEntry> requestEntry;
+        struct sockaddr_storage saddr = {};
+
+        // Requests written on the connection, in the order their responses are
+        // expected
+        std::mutex inflightLock_;
+        std::deque<RequestEntry> inflight_;
+        uint64_t nextRequest_ = 0;
+        // Set once a request has been cancelled, only then are the requests
+        // checked before being written
+        std::atomic<bool> cancelled_ { false };
+        const size_t maxResponseSize_;
+        const size_t pipelineDepth_;
+
         std::atomic<uint32_t> state_;
         std::atomic<ConnectionState> connectionState_;
         std::shared_ptr<Transport> transport_;
         Queue<RequestData> requestsQueue;
 
-        TimerPool timerPool_;
         ResponseParser parser;
+
+        // The body streamed to a reader, only used from the thread of the
+        // transport, and what to call once it ends
+        std::unique_ptr<Private::BodyDecoder> body_;
+        OnDone bodyDone_;
+        std::atomic<bool> readPaused_ { false };
+
+        // Ticks of the steady clock when the connection was established, and
+        // when its last request was released
+        std::atomic<std::chrono::steady_clock::rep> connectedAt_ { 0 };
+        std::atomic<std::chrono::steady_clock::rep> idleSince_ { 0 };
+
+        // Pool the connection belongs to, its slot in that pool, and the
+        // index of the transport it is bound to. The connection may outlive
+        // the pool, held by a callback of a transport
+        std::weak_ptr<HostConnections> host_;
+        uint32_t slot_ = 0;
+        uint32_t lane_ = 0;
+
+        // TLS of an https connection, see useTls(). The SSL object only is
+        // used from the thread of the transport
+        std::shared_ptr<TlsContext> tls_;
+        std::string tlsSessionKey_;
+        std::string tlsServerName_;
+        void* ssl_ = nullptr;
+        // Called once the handshake is over, unless it timed out first
+        OnConnected onHandshake_;
+        TimerWheel::TimerId handshakeTimer_ = TimerWheel::InvalidTimer;
+        // The server chose h2 with ALPN
+        bool alpnHttp2_ = false;
+
+        // HTTP/2 of the connection, see Client::Options::http2(). The session
+        // and the streams only are used from the thread of the transport
+        const Http2Mode http2_;
+        const size_t maxStreams_;
+        std::unique_ptr<Http2::ClientSession> h2_;
+        std::unordered_map<uint32_t, Http2Stream> streams_;
+        std::atomic<bool> multiplexed_ { false };
+        // Streams the session can open at once
+        std::atomic<uint32_t> streamLimit_ { 0 };
+        // Whether the transport waits for the socket to be writable to send
+        // the rest of the output of the session
+        bool writeWanted_ = false;
+    };
+
+    // Connections to a single host. Idle connections are kept on a lock-free
+    // stack of slot indices so that checking a connection out or in is O(1),
+    // and connections are only created when no idle one is left. With a
+    // pipeline depth above one, busy connections are shared once every
+    // connection has been created. Busy HTTP/2 connections are shared before
+    // a connection is created, by every request.
+    //
+    // Each transport of the client has its own lane, a stack of the idle
+    // connections bound to it. An affine checkout, for a request issued from
+    // the thread of a transport, prefers opening a connection in the lane of
+    // that transport to taking an idle one from another lane: the request is
+    // then written and answered without leaving the thread.
+    //
+    // Requests issued while no connection is available wait on a lock-free
+    // queue of the host, drained as its connections are released.
+    class HostConnections : public std::enable_shared_from_this<HostConnections>
+    {
+    public:
+        HostConnections(std::string name, size_t maxConnections, size_t maxResponseSize,
+                        size_t pipelineDepth = Default::PipelineDepth, size_t lanes = 1,
+                        Http2Mode http2 = Http2Mode::Off, size_t maxStreams = Default::Http2Streams);
+
+        // The host, with the "https://" prefix for TLS connections
+        const std::string& name() const { return name_; }
+
+        // An exclusive checkout never shares the connection with other
+        // requests. A new connection is bound to the lane
+        std::shared_ptr<Connection> checkout(bool exclusive = true, size_t lane = 0,
+                                             bool affine = false);
+        void release(Connection& connection);
+
+        // Checks out the idle connections that expired, the other ones are
+        // left idle
+        std::vector<std::shared_ptr<Connection>>
+        claimExpired(const std::function<bool(const Connection&)>& expired);
+
+        // Returns false when too many requests already are waiting
+        bool enqueue(std::shared_ptr<Connection::RequestData> request);
+        bool dequeue(std::shared_ptr<Connection::RequestData>& request);
+
+        template <typename Func>
+        void forEach(Func func) const
+        {
+            for (size_t i = 0; i < maxConnections_; ++i)
+            {
+                if (slots_[i].ready.load(std::memory_order_acquire))
+                    func(slots_[i].connection);
+            }
+        }
+
+    private:
+        struct Slot
+        {
+            std::shared_ptr<Connection> connection;
+            std::atomic<bool> ready { false };
+            // 1-based index of the next idle slot, 0 ends the stack
+            std::atomic<uint32_t> next { 0 };
+        };
+
+        std::shared_ptr<Connection> popIdle(bool exclusive, size_t lane);
+        // Only the HTTP/2 connections when multiplexed
+        std::shared_ptr<Connection> pickBusy(size_t lane, bool multiplexed = false);
+        void pushIdle(uint32_t index);
+
+        const std::string name_;
+        const size_t maxConnections_;
+        const size_t maxResponseSize_;
+        const size_t pipelineDepth_;
+        const size_t lanes_;
+        const Http2Mode http2_;
+        const size_t maxStreams_;
+
+        std::unique_ptr<Slot[]> slots_;
+        std::atomic<size_t> created_;
+
+        // One stack per lane. Low 32 bits hold the 1-based index of the top
+        // slot, high 32 bits a generation counter protecting against ABA
+        std::unique_ptr<std::atomic<uint64_t>[]> idleHeads_;
+
+        MPMCQueue<std::shared_ptr<Connection::RequestData>, 2048> pending_;
     };
 
     class ConnectionPool
@@ -132,31 +537,50 @@ namespace Pistache::Http::Experimental
     public:
         ConnectionPool() = default;
 
-        void init(size_t maxConnectionsPerHost, size_t maxResponseSize);
+        void init(size_t maxConnectionsPerHost, size_t maxResponseSize,
+                  size_t pipelineDepth = Default::PipelineDepth, size_t lanes = 1,
+                  Http2Mode http2 = Http2Mode::Off, size_t maxStreams = Default::Http2Streams);
+
+        // The connections of the host, created on first use. Hosts are never
+        // removed, the reference lives as long as the pool. Looked up without
+        // copying the name
+        HostConnections& connections(std::string_view domain);
 
-        std::shared_ptr<Connection> pickConnection(const std::string& domain);
+        std::shared_ptr<Connection> pickConnection(std::string_view domain,
+                                                   bool exclusive = true, size_t lane = 0,
+                                                   bool affine = false);
         static void releaseConnection(const std::shared_ptr<Connection>& connection);
 
-        size_t usedConnections(const std::string& domain) const;
-        size_t idleConnections(const std::string& domain) const;
+        size_t usedConnections(std::string_view domain) const;
+        size_t idleConnections(std::string_view domain) const;
 
         size_t availableConnections(const std::string& domain) const;
 
         void closeIdleConnections(const std::string& domain);
+        // See HostConnections::claimExpired(), for every host
+        std::vector<std::shared_ptr<Connection>>
+        claimExpired(const std::function<bool(const Connection&)>& expired);
         void shutdown();
 
     private:
-        using Connections = std::vector<std::shared_ptr<Connection>>;
-        using Lock        = std::mutex;
-        using Guard       = std::lock_guard<Lock>;
+        HostConnections* host(std::string_view domain) const;
 
+        using Lock = std::shared_mutex;
+
+        // Hosts are only ever added, lookups take a shared lock. Keyed by the
+        // name each host owns
         mutable Lock connsLock;
-        std::unordered_map<std::string, Connections> conns;
+        std::unordered_map<std::string_view, std::shared_ptr<HostConnections>> conns;
         size_t maxConnectionsPerHost;
         size_t maxResponseSize;
+        size_t pipelineDepth = Default::PipelineDepth;
+        size_t lanes         = 1;
+        Http2Mode http2      = Http2Mode::Off;
+        size_t maxStreams    = Default::Http2Streams;
     };
 
     class Client;
+    struct Attempts;
 
     class RequestBuilder
     {
@@ -175,11 +599,33 @@ namespace Pistache::Http::Experimental
             return header(std::make_shared<H>(std::forward<Args>(args)...));
         }
 
+        // Sent as it is, without being parsed
+        RequestBuilder& header(const Header::Raw& raw);
+
         RequestBuilder& cookie(const Cookie& cookie);
         RequestBuilder& body(const std::string& val);
         RequestBuilder& body(std::string&& val);
         RequestBuilder& timeout(std::chrono::milliseconds val);
 
+        // Streams the body of the response, see BodyStart. The timeout then
+        // only covers the time until the headers are received
+        RequestBuilder& onBodyStart(BodyStart callback);
+
+        // An idempotent request that fails, or times out, is sent again up to
+        // count times. Each retry is taken from the budget of the client
+        RequestBuilder& retries(size_t count);
+        // Once the delay passed without a response, a copy of an idempotent
+        // request is sent on another connection, up to count copies, budget
+        // allowing. The first response wins and the other attempts are
+        // cancelled, which releases their connections
+        RequestBuilder& hedge(std::chrono::milliseconds delay, size_t count = 1);
+
+        // Once the token is cancelled, the request is aborted as Cancellation
+        // does, and the continuations chained to its promise do not run
+        // anymore, see Async::Promise::cancelWith(). A request still waiting
+        // for a connection is rejected once it gets one, without being sent
+        RequestBuilder& cancellation(Async::CancellationToken token);
+
         Async::Promise<Response> send();
 
     private:
@@ -191,6 +637,13 @@ namespace Pistache::Http::Experimental
         Client* const client_;
 
         Request request_;
+        BodyStart bodyStart_;
+
+        size_t retries_ = 0;
+        std::chrono::milliseconds hedgeDelay_ { 0 };
+        size_t hedges_ = 0;
+
+        Async::CancellationToken cancellation_;
     };
 
     class Client
@@ -207,18 +660,68 @@ namespace Pistache::Http::Experimental
                 , maxConnectionsPerHost_(Default::MaxConnectionsPerHost)
                 , keepAlive_(Default::KeepAlive)
                 , maxResponseSize_(Default::MaxResponseSize)
+                , dnsResolverThreads_(Default::DnsResolverThreads)
+                , dnsCacheTtl_(Default::DnsCacheTtl)
+                , pipelineDepth_(Default::PipelineDepth)
+                , idleTimeout_(Default::IdleTimeout)
+                , maxLifetime_(Default::MaxLifetime)
+                , retryRatio_(Default::RetryRatio)
+                , retryBurst_(Default::RetryBurst)
+                , http2_(Http2Mode::Off)
+                , maxStreams_(Default::Http2Streams)
+                , sslVerifyPeer_(true)
+                , sslCertificateAuthority_()
             { }
 
             Options& threads(int val);
             Options& keepAlive(bool val);
             Options& maxConnectionsPerHost(int val);
             Options& maxResponseSize(size_t val);
+            Options& dnsResolverThreads(int val);
+            Options& dnsCacheTtl(std::chrono::seconds val);
+            // Up to depth requests are written back to back on a connection
+            // before their responses come back. Only requests with idempotent
+            // methods are pipelined
+            Options& pipelining(size_t depth);
+            // Idle connections are closed after the timeout, and connections
+            // once they have been open for the lifetime, as soon as they are
+            // idle. Both are checked on the timer of a transport
+            Options& idleTimeout(std::chrono::milliseconds val);
+            Options& maxLifetime(std::chrono::milliseconds val);
+            // See RetryBudget
+            Options& retryBudget(double ratio, size_t burst = Default::RetryBurst);
+            // Every connection goes to the address instead of the host of
+            // the url, which still names the pool and the Host header. Such
+            // as Address::unixSocket() for a service of the same host
+            Options& connectTo(Address address);
+            // The requests of a connection to a server speaking HTTP/2 are
+            // streams sent at once, up to maxStreams of them, instead of
+            // waiting for each other. A few connections per host then are
+            // enough. Their timeouts reset their stream only
+            Options& http2(Http2Mode mode, size_t maxStreams = Default::Http2Streams);
+            // The certificates of https servers are checked against the
+            // certificate authorities of the system, or of the PEM file. Only
+            // has an effect with PISTACHE_USE_SSL
+            Options& sslVerifyPeer(bool val);
+            Options& sslCertificateAuthority(std::string file);
 
         private:
             int threads_;
             int maxConnectionsPerHost_;
             bool keepAlive_;
             size_t maxResponseSize_;
+            int dnsResolverThreads_;
+            std::chrono::seconds dnsCacheTtl_;
+            size_t pipelineDepth_;
+            std::chrono::milliseconds idleTimeout_;
+            std::chrono::milliseconds maxLifetime_;
+            double retryRatio_;
+            size_t retryBurst_;
+            std::optional<Address> connectTo_;
+            Http2Mode http2_;
+            size_t maxStreams_;
+            bool sslVerifyPeer_;
+            std::string sslCertificateAuthority_;
         };
 
         Client();
@@ -233,6 +736,16 @@ namespace Pistache::Http::Experimental
         RequestBuilder patch(const std::string& resource);
         RequestBuilder del(const std::string& resource);
 
+        /* Establishes up to count connections to the host ahead of the
+         * first requests, connections already open included. The promise is
+         * resolved with how many are open once every attempt is over.
+         */
+        Async::Promise<size_t> warmup(const std::string& host, size_t count);
+
+        // The TLS handshakes of the https connections, full or resuming the
+        // session of a previous connection to the same host
+        Tcp::TlsHandshakes tlsHandshakes() const;
+
         void shutdown();
 
     private:
@@ -240,25 +753,56 @@ namespace Pistache::Http::Experimental
 
         ConnectionPool pool;
         Aio::Reactor::Key transportKey;
+        std::shared_ptr<DnsResolver> resolver_;
 
         std::atomic<uint64_t> ioIndex;
+        std::vector<std::shared_ptr<Transport>> transports_;
+
+        std::atomic<bool> stopProcessPequestsQueues;
 
-        using Lock  = std::mutex;
-        using Guard = std::lock_guard<Lock>;
+        std::chrono::milliseconds idleTimeout_;
+        std::chrono::milliseconds maxLifetime_;
+        std::atomic<bool> reaping_;
 
-        Lock queuesLock;
-        std::unordered_map<std::string,
-                           MPMCQueue<std::shared_ptr<Connection::RequestData>, 2048>>
-            requestsQueues;
-        bool stopProcessPequestsQueues;
+        RetryBudget retryBudget_;
+
+        std::optional<Address> connectTo_;
+
+        // Only set with PISTACHE_USE_SSL, https requests fail otherwise
+        std::shared_ptr<TlsContext> tls_;
 
     private:
         RequestBuilder prepareRequest(const std::string& resource,
                                       Http::Method method);
 
-        Async::Promise<Response> doRequest(Http::Request request);
-
-        void processRequestQueue();
+        Async::Promise<Response> doRequest(Http::Request request, BodyStart bodyStart = nullptr,
+                                           std::shared_ptr<Cancellation> cancellation = nullptr);
+        // Sends the request more than once, see RequestBuilder::retries() and
+        // RequestBuilder::hedge()
+        Async::Promise<Response> doAttempts(Http::Request request, BodyStart bodyStart,
+                                            size_t retries, std::chrono::milliseconds hedgeDelay,
+                                            size_t hedges,
+                                            std::shared_ptr<Cancellation> cancellation = nullptr);
+        void sendAttempt(const std::shared_ptr<Attempts>& attempts);
+        void scheduleHedge(const std::shared_ptr<Attempts>& attempts,
+                           std::chrono::milliseconds delay);
+
+        // Hands the connections of the host to the requests waiting for one
+        void processRequestQueue(HostConnections& host);
+        // Releases the connection, then lets a waiting request have it
+        void releaseConnection(const std::shared_ptr<Connection>& conn);
+
+        std::shared_ptr<Transport> nextTransport();
+        // Checks out a connection of the lane of the transport running the
+        // calling thread, if any. Other threads get the lanes in turn
+        std::shared_ptr<Connection> pickConnection(HostConnections& host, bool exclusive = true);
+        void bindTransport(const std::shared_ptr<Connection>& conn);
+        // Resolves the host, then connects the connection to it
+        void connect(const std::shared_ptr<Connection>& conn, const std::string& host,
+                     Connection::OnConnected onConnected = nullptr);
+
+        void scheduleReaper();
+        void reapConnections();
     };
 
 } // namespace Pistache::Http
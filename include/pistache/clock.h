@@ -0,0 +1,47 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* clock.h
+
+   Cheap reads of the time for the hot paths. The reactor takes the time
+   once as its poll returns, and the handlers of the events of that
+   iteration read it back instead of the clock. The current date is kept
+   formatted for the Date header, and formatted again once a second.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <string_view>
+
+namespace Pistache
+{
+
+    class CachedClock
+    {
+    public:
+        using time_point = std::chrono::steady_clock::time_point;
+
+        // The steady time read with CLOCK_MONOTONIC_COARSE: no system call,
+        // and a resolution of a few milliseconds
+        static time_point coarse();
+
+        // Within the handlers called by a reactor, the time at which its poll
+        // returned, the steady clock otherwise. Late by the time the
+        // handlers of the iteration took
+        static time_point now();
+
+        // The current date as an IMF-fixdate (RFC 9110 5.6.7), e.g. "Sun, 06
+        // Nov 1994 08:49:37 GMT". Formatted once a second by every thread,
+        // valid until the next call of the thread
+        static std::string_view httpDate();
+
+        // Called by the reactor around the handlers of an iteration
+        static void update(time_point now);
+        static void reset();
+    };
+
+} // namespace Pistache
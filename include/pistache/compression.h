@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* compression.h
+
+   Content codings of the responses. The codings are only available when the
+   library is built with them: gzip and deflate with
+   PISTACHE_USE_CONTENT_ENCODING_DEFLATE (zlib), br with
+   PISTACHE_USE_CONTENT_ENCODING_BROTLI.
+
+   Compressors keep their state between two responses: a worker thread keeps
+   the ones it released in a pool of its own, so that a response does not
+   allocate and initialize the state of the compression library again.
+*/
+
+#pragma once
+
+#include <pistache/http_header.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace Pistache::Http::Compression
+{
+
+    // Level picked by the compression library itself
+    static constexpr int DefaultLevel = -1;
+
+    // Bodies smaller than this are sent as is, the coding would barely save
+    // a segment but cost the time to compress them
+    static constexpr size_t DefaultMinSize = 1024;
+
+    struct Settings
+    {
+        // Compress the responses of the clients that accept a coding
+        bool enabled = false;
+        int level    = DefaultLevel;
+        // Smallest body compressed by send(), streams always are
+        size_t minSize = DefaultMinSize;
+    };
+
+    // Whether the library has been built with a compressor for the coding
+    bool isSupported(Header::Encoding encoding);
+
+    // Supported coding preferred by the client according to the value of its
+    // Accept-Encoding header (RFC 9110 12.5.3), Identity when there is none.
+    // Between codings of the same weight, br is preferred over gzip and gzip
+    // over deflate.
+    Header::Encoding negotiate(std::string_view acceptEncoding);
+
+    // Weight, from 0 to 1, that an Accept-Encoding value gives to a coding
+    double acceptWeight(std::string_view acceptEncoding, Header::Encoding encoding);
+
+    class Compressor
+    {
+    public:
+        enum class Flush { None,
+                           // Pushes out everything received so far
+                           Sync,
+                           // Ends the compressed stream
+                           Finish };
+
+        virtual ~Compressor() = default;
+
+        virtual Header::Encoding encoding() const = 0;
+        int level() const { return level_; }
+
+        // Appends to out the compressed form of data. Without a flush, the
+        // compressor may keep part or all of the data until the next call.
+        virtual void compress(const char* data, size_t size, Flush flush, std::string& out) = 0;
+
+        // Starts a new stream
+        virtual void reset() = 0;
+
+    protected:
+        explicit Compressor(int level)
+            : level_(level)
+        { }
+
+    private:
+        int level_;
+    };
+
+    // Gives a compressor back to the pool of the calling thread
+    struct Release
+    {
+        void operator()(Compressor* compressor) const;
+    };
+
+    using CompressorPtr = std::unique_ptr<Compressor, Release>;
+
+    // Takes a compressor from the pool of the calling thread, or creates one.
+    // Returns nullptr when the coding is not supported.
+    CompressorPtr acquire(Header::Encoding encoding, int level = DefaultLevel);
+
+    // Compressors kept by the pool of the calling thread
+    size_t pooled();
+
+    // Compresses a whole body at once
+    std::string compress(Header::Encoding encoding, int level, const char* data, size_t size);
+
+} // namespace Pistache::Http::Compression
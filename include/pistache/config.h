@@ -22,6 +22,9 @@ namespace Pistache::Const
 
     static constexpr size_t DefaultTimerPoolSize = 128;
 
+    static constexpr auto DefaultTimerWheelResolution = std::chrono::milliseconds(10);
+    static constexpr size_t DefaultTimerWheelSlots    = 512;
+
     // Defined from CMakeLists.txt in project root
     static constexpr size_t DefaultMaxRequestSize    = 4096;
     static constexpr size_t DefaultMaxResponseSize   = std::numeric_limits<uint32_t>::max();
@@ -29,7 +32,25 @@ namespace Pistache::Const
     static constexpr auto DefaultBodyTimeout         = std::chrono::seconds(60);
     static constexpr auto DefaultKeepaliveTimeout    = std::chrono::seconds(300);
     static constexpr auto DefaultSSLHandshakeTimeout = std::chrono::seconds(10);
+    static constexpr auto DefaultTlsSessionTimeout   = std::chrono::seconds(300);
+    static constexpr auto DefaultTicketKeyRotation   = std::chrono::seconds(3600);
+    static constexpr auto DefaultSseHeartbeat        = std::chrono::seconds(15);
+    static constexpr auto DefaultProxyTimeout        = std::chrono::seconds(60);
+    static constexpr auto DefaultShedInterval        = std::chrono::milliseconds(100);
+    // How long the kernel holds a connection that sent nothing yet, with
+    // Tcp::Options::DeferAccept
+    static constexpr auto DeferAcceptTimeout         = std::chrono::seconds(10);
+    // How long the buffers sent without a copy are kept once their peer is
+    // closed, the kernel no longer tells when it is done with them
+    static constexpr auto ZeroCopyLinger             = std::chrono::seconds(10);
     static constexpr size_t ChunkSize                = 1024;
+    static constexpr size_t DefaultMaxReceiveBuffer  = 64 * 1024;
+    static constexpr size_t DefaultSendFileBudget    = 1024 * 1024;
+    // Below this size, copying a buffer costs less than pinning its pages
+    static constexpr size_t MinZeroCopySize          = 16 * 1024;
+    static constexpr size_t DefaultHighWatermark     = 1024 * 1024;
+    static constexpr size_t DefaultLowWatermark      = 256 * 1024;
+    static constexpr size_t DefaultMaxWebSocketMessage = 16 * 1024 * 1024;
 
     static constexpr uint16_t HTTP_STANDARD_PORT = 80;
 } // namespace Pistache::Const
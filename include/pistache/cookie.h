@@ -18,6 +18,7 @@
 #include <map>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -54,6 +55,10 @@ namespace Pistache::Http
 
     std::ostream& operator<<(std::ostream& os, const Cookie& cookie);
 
+    // The cookies of a Cookie header are kept as the raw header, and only
+    // turned into Cookie objects when they are looked up or iterated over.
+    // Looking up or iterating completes the jar in place, a jar must not be
+    // read from several threads at once
     class CookieJar
     {
     public:
@@ -142,17 +147,38 @@ namespace Pistache::Http
         void add(const Cookie& cookie);
         void removeAllCookies();
 
+        // Checks the name=value pairs of a Cookie header, without parsing
+        // them yet
         void addFromRaw(const char* str, size_t len);
         Cookie get(const std::string& name) const;
 
-        bool has(const std::string& name) const;
+        bool has(std::string_view name) const;
 
-        iterator begin() const { return iterator(cookies.begin(), cookies.end()); }
+        // The value of a cookie without building it. The view is valid
+        // until the jar is changed
+        std::optional<std::string_view> value(std::string_view name) const;
 
-        iterator end() const { return iterator(cookies.end()); }
+        iterator begin() const
+        {
+            materialize();
+            return iterator(cookies.begin(), cookies.end());
+        }
+
+        iterator end() const
+        {
+            materialize();
+            return iterator(cookies.end());
+        }
 
     private:
-        Storage cookies;
+        // Adds the cookies of raw not parsed yet to the storage
+        void materialize() const;
+
+        mutable Storage cookies;
+
+        // The Cookie headers, parsed up to parsed_
+        std::string raw_;
+        mutable size_t parsed_ = 0;
     };
 
 } // namespace Pistache::Http
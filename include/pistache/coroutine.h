@@ -0,0 +1,319 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* coroutine.h
+
+   C++20 coroutine support: co_await on an Async::Promise, and route handlers
+   written as coroutines. A handler coroutine always resumes on the thread of
+   the transport that owns its connection, so the rest of the handler runs in
+   the same context as a synchronous one.
+
+   The library itself is built as C++17, this header is empty unless the
+   including translation unit is compiled with coroutine support.
+*/
+
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define PISTACHE_HAS_COROUTINES 1
+#endif
+
+#ifdef PISTACHE_HAS_COROUTINES
+
+#include <pistache/async.h>
+#include <pistache/http.h>
+#include <pistache/router.h>
+#include <pistache/transport.h>
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace Pistache::Async
+{
+
+    namespace details
+    {
+        template <typename Promise>
+        void resume(std::coroutine_handle<Promise> handle)
+        {
+            if constexpr (requires { handle.promise().transport; })
+            {
+                auto* transport = handle.promise().transport;
+                if (transport != nullptr && !transport->isInTransportThread())
+                {
+                    transport->post([handle] { handle.resume(); });
+                    return;
+                }
+            }
+
+            handle.resume();
+        }
+
+        template <typename T>
+        class PromiseAwaiter
+        {
+        public:
+            explicit PromiseAwaiter(Promise<T>& promise)
+                : promise_(promise)
+            { }
+
+            // The value of a settled promise only is reachable through then(),
+            // await_suspend() finds out and declines to suspend
+            bool await_ready() const noexcept { return false; }
+
+            template <typename P>
+            bool await_suspend(std::coroutine_handle<P> handle)
+            {
+                auto settle = [this, handle] {
+                    if (settled_.exchange(true, std::memory_order_acq_rel))
+                        details::resume(handle);
+                };
+
+                auto reject = [this, settle](std::exception_ptr exc) {
+                    error_ = std::move(exc);
+                    settle();
+                };
+
+                if constexpr (std::is_void_v<T>)
+                {
+                    promise_.then([settle] { settle(); }, reject);
+                }
+                else
+                {
+                    promise_.then(
+                        [this, settle](const T& value) {
+                            value_.emplace(value);
+                            settle();
+                        },
+                        reject);
+                }
+
+                // Whoever comes second, this or the continuation, resumes
+                return !settled_.exchange(true, std::memory_order_acq_rel);
+            }
+
+            T await_resume()
+            {
+                if (error_)
+                    std::rethrow_exception(error_);
+
+                if constexpr (!std::is_void_v<T>)
+                    return std::move(*value_);
+            }
+
+        private:
+            struct Empty
+            { };
+
+            Promise<T>& promise_;
+            std::conditional_t<std::is_void_v<T>, Empty, std::optional<T>> value_;
+            std::exception_ptr error_;
+            std::atomic<bool> settled_ { false };
+        };
+    } // namespace details
+
+    template <typename T>
+    details::PromiseAwaiter<T> operator co_await(Promise<T>& promise)
+    {
+        return details::PromiseAwaiter<T>(promise);
+    }
+
+    template <typename T>
+    details::PromiseAwaiter<T> operator co_await(Promise<T>&& promise)
+    {
+        return details::PromiseAwaiter<T>(promise);
+    }
+
+    /* Return type of a coroutine route handler.
+
+       The coroutine does not run until start() is called, it then owns itself
+       and is destroyed once it completes. An exception escaping the coroutine
+       is answered the same way as one escaping a synchronous handler.
+    */
+    class [[nodiscard]] Task
+    {
+    public:
+        struct promise_type
+        {
+            // Called with the parameters of the coroutine, the first
+            // ResponseWriter among them ties the coroutine to its transport
+            template <typename... Args>
+            explicit promise_type(Args&... args)
+            {
+                (capture(args), ...);
+            }
+
+            Task get_return_object()
+            {
+                return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+
+            void return_void() const noexcept { }
+
+            void unhandled_exception() noexcept
+            {
+                if (response == nullptr)
+                    return;
+
+                try
+                {
+                    std::rethrow_exception(std::current_exception());
+                }
+                catch (const Http::HttpError& err)
+                {
+                    response->send(static_cast<Http::Code>(err.code()), err.reason());
+                }
+                catch (const std::exception& e)
+                {
+                    response->send(Http::Code::Internal_Server_Error, e.what());
+                }
+                catch (...)
+                {
+                    response->send(Http::Code::Internal_Server_Error, "Unknown exception");
+                }
+            }
+
+            Tcp::Transport* transport      = nullptr;
+            Http::ResponseWriter* response = nullptr;
+            std::shared_ptr<void> keepAlive;
+
+        private:
+            void capture(Http::ResponseWriter& writer)
+            {
+                if (response != nullptr)
+                    return;
+
+                response  = &writer;
+                transport = writer.transport();
+            }
+
+            template <typename U>
+            void capture(const U&)
+            { }
+        };
+
+        Task(Task&& other) noexcept
+            : handle_(std::exchange(other.handle_, {}))
+        { }
+
+        Task(const Task&)            = delete;
+        Task& operator=(const Task&) = delete;
+        Task& operator=(Task&&)      = delete;
+
+        ~Task()
+        {
+            if (handle_)
+                handle_.destroy();
+        }
+
+        // Keeps the value alive until the coroutine completes
+        void keepAlive(std::shared_ptr<void> value)
+        {
+            handle_.promise().keepAlive = std::move(value);
+        }
+
+        // Runs the coroutine up to its first suspension point
+        void start() { std::exchange(handle_, {}).resume(); }
+
+    private:
+        explicit Task(std::coroutine_handle<promise_type> handle)
+            : handle_(handle)
+        { }
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+} // namespace Pistache::Async
+
+namespace Pistache::Rest::Routes
+{
+
+    namespace details
+    {
+        // The coroutine only holds a reference to the request, which does not
+        // outlive the call of the handler. Hand it a copy that lives as long as
+        // the coroutine does.
+        template <typename Invoke>
+        Route::Handler bindTask(Invoke invoke)
+        {
+            return [=](const Rest::Request& request, Http::ResponseWriter response) {
+                auto copy = std::make_shared<Rest::Request>(request);
+
+                Async::Task task = invoke(*copy, std::move(response));
+                task.keepAlive(std::move(copy));
+                task.start();
+
+                return Route::Result::Ok;
+            };
+        }
+    } // namespace details
+
+    template <typename Cls, typename... Args, typename Obj>
+    Route::Handler bind(Async::Task (Cls::*func)(Args...), Obj obj)
+    {
+        details::static_checks<details::BindChecks, Args...>();
+
+        return details::bindTask(
+            [=](const Rest::Request& request, Http::ResponseWriter response) {
+                return (obj->*func)(request, std::move(response));
+            });
+    }
+
+    template <typename Cls, typename... Args, typename Obj>
+    Route::Handler bind(Async::Task (Cls::*func)(Args...) const, Obj obj)
+    {
+        details::static_checks<details::BindChecks, Args...>();
+
+        return details::bindTask(
+            [=](const Rest::Request& request, Http::ResponseWriter response) {
+                return (obj->*func)(request, std::move(response));
+            });
+    }
+
+    template <typename Cls, typename... Args, typename Obj>
+    Route::Handler bind(Async::Task (Cls::*func)(Args...), std::shared_ptr<Obj> objPtr)
+    {
+        details::static_checks<details::BindChecks, Args...>();
+
+        return details::bindTask(
+            [=](const Rest::Request& request, Http::ResponseWriter response) {
+                return (objPtr.get()->*func)(request, std::move(response));
+            });
+    }
+
+    template <typename Cls, typename... Args, typename Obj>
+    Route::Handler bind(Async::Task (Cls::*func)(Args...) const, std::shared_ptr<Obj> objPtr)
+    {
+        details::static_checks<details::BindChecks, Args...>();
+
+        return details::bindTask(
+            [=](const Rest::Request& request, Http::ResponseWriter response) {
+                return (objPtr.get()->*func)(request, std::move(response));
+            });
+    }
+
+    template <typename... Args>
+    Route::Handler bind(Async::Task (*func)(Args...))
+    {
+        details::static_checks<details::BindChecks, Args...>();
+
+        return details::bindTask(
+            [=](const Rest::Request& request, Http::ResponseWriter response) {
+                return func(request, std::move(response));
+            });
+    }
+
+} // namespace Pistache::Rest::Routes
+
+#endif /* PISTACHE_HAS_COROUTINES */
@@ -513,6 +513,11 @@ namespace Pistache::Rest
         Schema::PathGroup paths_;
     };
 
+    /* Serves the description at apiPath, and the files of uiDirectory at
+     * uiPath. The description is serialized once, at the first request for
+     * it, and kept along with its compressed forms and its ETag. The files of
+     * the UI are served from a FileCache.
+     */
     class Swagger
     {
     public:
@@ -522,6 +527,7 @@ namespace Pistache::Rest
             , uiDirectory_()
             , apiPath_()
             , serializer_()
+            , served_()
         { }
 
         typedef std::function<std::string(const Description&)> Serializer;
@@ -531,14 +537,22 @@ namespace Pistache::Rest
         Swagger& apiPath(std::string path);
         Swagger& serializer(Serializer serialize);
 
+        // Replaces the description, e.g. once the routes changed. Once
+        // installed, the next request for it serializes it again
+        Swagger& description(const Description& description);
+
         void install(Rest::Router& router);
 
     private:
+        // What the handler installed serves, shared with it
+        struct Served;
+
         Description description_;
         std::string uiPath_;
         std::string uiDirectory_;
         std::string apiPath_;
         Serializer serializer_;
+        std::shared_ptr<Served> served_;
     };
 
 } // namespace Pistache::Rest
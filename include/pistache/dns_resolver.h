@@ -0,0 +1,127 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* dns_resolver.h
+
+   Resolves host names on a small pool of background threads and caches the
+   results. Concurrent lookups of the same host share a single getaddrinfo()
+   call. A host resolves to all of its IPv4 and IPv6 addresses, in the order
+   they should be connected to. Addresses are resolved back to host names
+   the same way, with getnameinfo().
+*/
+
+#pragma once
+
+#include <pistache/async.h>
+#include <pistache/net.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Pistache
+{
+
+    class DnsResolver
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // A ttl of zero disables the cache. getaddrinfo() does not report the
+        // TTL of the records, entries live for the configured duration.
+        explicit DnsResolver(size_t threads = 1,
+                             std::chrono::seconds ttl = std::chrono::seconds(60));
+        ~DnsResolver();
+
+        DnsResolver(const DnsResolver&)            = delete;
+        DnsResolver& operator=(const DnsResolver&) = delete;
+
+        // host uses the same "host[:port]" format as Address. The promise is
+        // resolved right away when the host is cached, and from one of the
+        // resolver threads otherwise
+        Async::Promise<Address> resolve(const std::string& host);
+        // Same as above, with every address of the host. There is at least one
+        Async::Promise<std::vector<Address>> resolveAll(const std::string& host);
+
+        // Reverse lookup of a numeric host such as "10.0.0.1" or "::1". The
+        // absence of a name is cached as well, and rejects the promise
+        Async::Promise<std::string> resolveName(const std::string& ip);
+
+        // The first address of the host, when it is cached
+        std::optional<Address> cached(const std::string& host) const;
+        // The name of the numeric host when it is cached, empty when it is
+        // known to have none
+        std::optional<std::string> cachedName(const std::string& ip) const;
+        size_t cacheSize() const;
+        void clearCache();
+
+        // Stops the threads and rejects the pending lookups
+        void shutdown();
+
+        // RFC 8305 section 4: keeps the order of getaddrinfo(), which already
+        // sorted them by preference, but alternates the address families,
+        // starting with the family of the first address
+        static std::vector<Address> interleaveFamilies(std::vector<Address> addresses);
+
+        // Resolver of the peers of the servers, created on first use
+        static DnsResolver& shared();
+
+    private:
+        struct Waiter
+        {
+            Async::Resolver resolve;
+            Async::Rejection reject;
+            // Resolved with every address rather than the first one
+            bool all;
+        };
+
+        struct CacheEntry
+        {
+            std::vector<Address> addresses;
+            Clock::time_point expiry;
+        };
+
+        struct NameEntry
+        {
+            // Empty when the address has no name
+            std::string name;
+            Clock::time_point expiry;
+        };
+
+        struct Query
+        {
+            std::string host;
+            bool reverse;
+        };
+
+        template <typename T>
+        Async::Promise<T> lookup(const std::string& host, bool all);
+
+        void run();
+        void resolveNext(const std::string& host);
+        void resolveNextName(const std::string& ip);
+
+        std::chrono::seconds ttl_;
+
+        mutable std::mutex lock_;
+        std::condition_variable cv_;
+        std::deque<Query> queue_;
+        std::unordered_map<std::string, std::vector<Waiter>> pending_;
+        std::unordered_map<std::string, CacheEntry> cache_;
+        std::unordered_map<std::string, std::vector<Waiter>> pendingNames_;
+        std::unordered_map<std::string, NameEntry> names_;
+        bool shutdown_ = false;
+
+        std::vector<std::thread> threads_;
+    };
+
+} // namespace Pistache
@@ -29,6 +29,17 @@ namespace Pistache::Http
         {
             friend class Endpoint;
 
+            // Count given to threads() to size the workers on the machine
+            static constexpr int AutoThreads = 0;
+
+            /*!
+             * \brief Number of worker threads
+             *
+             * With AutoThreads, one worker per cpu the process can actually
+             * use, see usableCpus(): the cpus of its affinity mask, capped by
+             * the cpu quota of its cgroup. A container limited to 2 cpus of a
+             * 64 cpus node then runs 2 workers rather than being throttled.
+             */
             Options& threads(int val);
             Options& threadsName(const std::string& val);
 
@@ -44,6 +55,336 @@ namespace Pistache::Http
             Options& maxRequestSize(size_t val);
             Options& maxResponseSize(size_t val);
 
+            /*!
+             * \brief Upper bound of the per-worker receive buffer
+             *
+             * The buffer grows from Const::MaxBuffer bytes up to this size
+             * while a peer keeps filling it, so that large uploads are read
+             * with fewer system calls.
+             */
+            Options& maxReceiveBufferSize(size_t val);
+
+            /*!
+             * \brief Reuse the memory of a request for the next one
+             *
+             * When enabled, the body, headers, cookies and query containers of
+             * a request are cleared instead of being freed once the request
+             * has been handled, the next request on the same connection then
+             * fills them without going through the allocator again.
+             */
+            Options& reuseRequestStorage(bool val);
+
+            /*!
+             * \brief Parse the typed headers of a request on first access
+             *
+             * The headers known to the library are kept in their raw form
+             * while the request is received and only parsed into their typed
+             * form when the handler asks for them. A malformed header then
+             * throws from get() / tryGet() instead of failing the request.
+             */
+            Options& lazyHeaders(bool val);
+
+            /*!
+             * \brief Put chunked bodies together in the receive buffer
+             *
+             * The payloads of the chunks of a request are moved over the
+             * chunk lines within the buffer the request is received in,
+             * and the body is copied to the request once, at its end,
+             * instead of growing with every chunk.
+             */
+            Options& inPlaceChunks(bool val);
+
+            /*!
+             * \brief Send the writes of an event batch together
+             *
+             * The responses and chunks written while a worker handles one
+             * batch of events, explicit flushes included, are held back and
+             * sent once the batch is done, with one vectored send per peer.
+             * Pipelined requests and small streamed chunks then go out in
+             * fewer TCP segments.
+             */
+            Options& autoCork(bool val);
+
+            /*!
+             * \brief Bytes of files a worker sends to a peer at a time
+             *
+             * Once a peer got that many bytes from the files of its responses,
+             * the worker serves its other peers before sending the rest, a
+             * large download does not hold the whole worker anymore. Throws
+             * std::invalid_argument when bytes is zero.
+             */
+            Options& sendFileBudget(size_t bytes);
+
+            /*!
+             * \brief Send the large buffers without copying them
+             *
+             * The responses held in memory of at least threshold bytes are
+             * sent with MSG_ZEROCOPY, the kernel reading them in place rather
+             * than copying them to the socket, and are kept until it is done
+             * with them. Pays off for buffers of hundreds of kilobytes and
+             * more, such as cached blobs; the threshold is at least
+             * Const::MinZeroCopySize. TLS connections are left out. Zero, the
+             * default, copies them.
+             */
+            Options& zeroCopySends(size_t threshold);
+
+            /*!
+             * \brief Read files that are not in memory from a pool of threads
+             *
+             * Before sending a part of a file, the worker checks that it is in
+             * the page cache. When it is not, that part is read by one of the
+             * threads of the pool while the worker serves its other peers,
+             * instead of blocking the worker on the disk. Zero, the default,
+             * disables the pool.
+             */
+            Options& filePrefetchThreads(size_t threads);
+
+            /*!
+             * \brief Preallocate the buffers of every worker
+             *
+             * The buffers of the requests and of the responses take their
+             * memory from a pool of the thread that uses them, which keeps
+             * the blocks given back instead of freeing them. Every worker
+             * fills its pool with blocks for about bytes of buffers when it
+             * starts. With hugePages, the blocks are carved from 2 MiB huge
+             * pages, explicit ones when the system reserved some and
+             * transparent ones otherwise, and that memory stays in the pool
+             * for the lifetime of the process.
+             */
+            Options& bufferPool(size_t bytes, bool hugePages = false);
+
+            /*!
+             * \brief Compress the responses of the clients that accept it
+             *
+             * The coding is negotiated from the Accept-Encoding header of
+             * every request, among the ones the library has been built with.
+             * Bodies sent at once are only compressed from minSize() bytes
+             * on, streamed bodies always are, chunk by chunk.
+             */
+            Options& compression(bool val);
+
+            /*!
+             * \brief Level of the compressor, Compression::DefaultLevel lets
+             * the compression library pick
+             */
+            Options& compressionLevel(int val);
+            Options& compressionMinSize(size_t val);
+
+            /*!
+             * \brief Serve HTTP/2 next to HTTP/1.x
+             *
+             * Offered with ALPN to the clients of an SSL endpoint, and taken
+             * from the clients that start a plain connection with the
+             * HTTP/2 preface (prior knowledge). The requests of all the
+             * streams of a connection are handed to the same handler, their
+             * responses are multiplexed on that connection.
+             */
+            Options& http2(bool val);
+
+            /*!
+             * \brief Backpressure of the streamed responses
+             *
+             * Once the bytes a connection has queued and not written yet reach
+             * high, its ResponseStreams stop being writable, until those drop
+             * to low. A producer waits for ResponseStream::whenWritable()
+             * instead of buffering a slow client's response in memory.
+             */
+            Options& streamWatermarks(size_t high, size_t low);
+
+            /*!
+             * \brief Spool the large request bodies to disk
+             *
+             * Bodies of at least threshold bytes, and chunked ones, are
+             * written to a temporary file of the directory and handed to the
+             * handler as Request::bodyFile(), beyond the maximum request size.
+             * Plain TCP connections move them with splice(), without copying
+             * them through user space. Zero, the default, disables it.
+             */
+            Options& bodySpool(size_t threshold, std::string directory = "/tmp");
+
+            /*!
+             * \brief Record the requests to an access log
+             *
+             * The method, resource, status, bytes sent and timings of every
+             * sampled request are taken as its response is queued, without a
+             * lock, and written in batches by the thread of the log, see
+             * Http::AccessLog.
+             */
+            Options& accessLog(std::shared_ptr<Http::AccessLog> log);
+
+            /*!
+             * \brief Time the phases of the requests
+             *
+             * The accept of the connection, the first byte, the end of the
+             * headers and of the body, the call of the handler and the write
+             * of the response are handed to the tracer once the response is
+             * written, see Tracing::OtlpExporter.
+             *
+             * \note Needs pistache compiled with PISTACHE_USE_TRACING, the
+             *       handler refuses the tracer otherwise
+             */
+            Options& tracer(std::shared_ptr<Tracing::Tracer> tracer);
+
+            /*!
+             * \brief Accept connections directly from the worker threads
+             *
+             * Every worker gets its own SO_REUSEPORT listening socket bound to
+             * the endpoint address and the kernel balances new connections
+             * between them, peers do not go through the accept thread anymore.
+             */
+            Options& acceptPerWorker(bool val);
+
+            /*!
+             * \brief Select how new connections are spread between workers
+             *
+             * Ignored in acceptPerWorker() mode, where the kernel picks the
+             * worker socket.
+             */
+            Options& dispatchPolicy(Tcp::DispatchPolicy policy);
+
+            /*!
+             * \brief Accept connections from several threads
+             *
+             * Every accept thread polls the listening socket with
+             * EPOLLEXCLUSIVE, a new connection wakes up only one of them,
+             * which then accepts the pending connections in a batch. For
+             * connection storms that a single accept thread can not keep up
+             * with. Ignored in acceptPerWorker() mode.
+             */
+            Options& acceptThreads(size_t count);
+
+            /*!
+             * \brief Keep every worker and its memory on one NUMA node
+             *
+             * Each worker is pinned to a cpu of its own, spread over the
+             * nodes, and allocates its buffers from that thread so that they
+             * live on the local node. New peers are handed to a worker of
+             * the node whose cpu received their packets (SO_INCOMING_CPU),
+             * the dispatch policy only applies when there is none. In
+             * acceptPerWorker() mode only the pinning applies.
+             */
+            Options& numaAware(bool val);
+
+            /*!
+             * \brief Pin each worker to a cpu of its own
+             *
+             * Spread over the cpus of the affinity mask of the process, and
+             * over its NUMA nodes. Unlike numaAware(), the peers are still
+             * handed to the workers by the dispatch policy.
+             */
+            Options& pinWorkers(bool val);
+
+            /*!
+             * \brief Serve from workers shared with other endpoints
+             *
+             * The endpoints given the same pool, each one with its own
+             * address, handler and options, are served by the same worker
+             * threads instead of a set each. The threads count and name, the
+             * pinning, the polling backend and the busy polling of the loop
+             * are then the ones of the pool. Shutting the endpoint down
+             * closes its connections, the workers keep serving the others.
+             * Not in acceptPerWorker() mode.
+             */
+            Options& workerPool(std::shared_ptr<Tcp::WorkerPool> pool);
+
+            /*!
+             * \brief Trade cpu for latency
+             *
+             * The workers poll without blocking for up to spin after their
+             * last event before they block, and the responses and peers
+             * handed to them by other threads meanwhile do not go through
+             * an eventfd. Every worker then keeps a cpu busy while the
+             * server is loaded. With socketBusyPoll, the sockets of the
+             * peers get SO_BUSY_POLL for as long, and SO_PREFER_BUSY_POLL,
+             * for the kernel to poll the device queue as well.
+             */
+            template <typename Duration>
+            Options& busyPoll(Duration spin, bool socketBusyPoll = false)
+            {
+                busyPollSpin_   = std::chrono::duration_cast<std::chrono::microseconds>(spin);
+                socketBusyPoll_ = socketBusyPoll;
+                return *this;
+            }
+
+            /*!
+             * \brief Bound the connections served by every worker
+             *
+             * Once every worker serves perWorker peers, no connection is
+             * accepted until one of them goes away: the new ones wait in the
+             * backlog of the listening socket instead of taking memory and
+             * a descriptor of the server. Zero, the default, does not bound
+             * them.
+             */
+            Options& maxConnections(size_t perWorker);
+
+            /*!
+             * \brief Close idle keep-alive connections to make room
+             *
+             * Once a worker serves more than perWorker peers, every new one
+             * closes the connection of the worker that has been idle the
+             * longest, between two requests, rather than waiting for its
+             * keep-alive timeout. The connections with a request being
+             * received or answered are kept. Below maxConnections(), the
+             * idle ones give way before the new ones have to wait; with
+             * acceptPerWorker(), a worker full with maxConnections() closes
+             * one as well. Zero, the default, keeps them.
+             */
+            Options& evictIdleConnections(size_t perWorker);
+
+            /*!
+             * \brief Bound the requests every worker has in flight
+             *
+             * Past perWorker HTTP/1 requests dispatched and not answered yet,
+             * new requests are answered with a 503 and a Retry-After header
+             * before their body is read, and their connection is closed.
+             * Zero, the default, does not bound them.
+             */
+            Options& maxInFlight(size_t perWorker);
+
+            /*!
+             * \brief Bound the memory of the requests being received
+             *
+             * The bytes of the HTTP/1 requests received and not dispatched
+             * yet are counted across the workers and per worker. A request
+             * announcing a body that does not fit, or going past the budget
+             * while it arrives, is answered with a 503 and a Retry-After
+             * header, and its connection is closed. The bodies grow with
+             * what arrives rather than to their Content-Length up front.
+             * Zero, the default, does not bound them.
+             */
+            Options& bodyBudget(size_t global, size_t perWorker = 0);
+
+            /*!
+             * \brief Limit the rate of the requests of every client
+             *
+             * The HTTP/1 requests over the limit of their key, see
+             * Http::RateLimiter, are answered with a 429 and a Retry-After
+             * header before their body is read, and their connection is
+             * closed. The same limiter can also be a middleware of a
+             * router, see Rest::Routes::rateLimit().
+             */
+            Options& rateLimit(std::shared_ptr<Http::RateLimiter> limiter);
+
+            /*!
+             * \brief Shed the requests of an overloaded worker
+             *
+             * The queueing delay of every HTTP/1 request, from its first bytes
+             * to its dispatch, is measured by its worker. Once no request
+             * of an interval went through in less than the target, as CoDel
+             * does, the requests that waited more than twice the target are
+             * answered with a 503 the way maxInFlight() does, until the
+             * delay is back under the target. A target of zero, the default,
+             * disables it.
+             */
+            template <typename Duration>
+            Options& loadShedding(Duration target,
+                                  std::chrono::milliseconds interval = Const::DefaultShedInterval)
+            {
+                shedTarget_   = std::chrono::duration_cast<std::chrono::milliseconds>(target);
+                shedInterval_ = interval;
+                return *this;
+            }
+
             template <typename Duration>
             Options& headerTimeout(Duration timeout)
             {
@@ -74,6 +415,14 @@ namespace Pistache::Http
 
             Options& logger(PISTACHE_STRING_LOGGER_T logger);
 
+            /*!
+             * \brief Select the kernel facility used by the worker threads
+             *
+             * Polling::Backend::IoUring is only used when supported by the
+             * running kernel, the endpoint falls back to epoll otherwise.
+             */
+            Options& pollingBackend(Polling::Backend backend);
+
             [[deprecated("Replaced by maxRequestSize(val)")]] Options&
             maxPayload(size_t val);
 
@@ -99,6 +448,41 @@ namespace Pistache::Http
             PISTACHE_STRING_LOGGER_T logger_;
             // This should be moved after "keepaliveTimeout_" in the next ABI change
             std::chrono::milliseconds sslHandshakeTimeout_;
+            Polling::Backend pollingBackend_;
+            size_t maxReceiveBufferSize_;
+            bool reuseRequestStorage_;
+            bool lazyHeaders_;
+            bool inPlaceChunks_;
+            bool acceptPerWorker_;
+            Tcp::DispatchPolicy dispatchPolicy_;
+            size_t acceptThreads_;
+            bool numaAware_;
+            bool pinWorkers_;
+            bool autoCork_;
+            Compression::Settings compression_;
+            size_t sendFileBudget_;
+            size_t zeroCopyThreshold_;
+            size_t filePrefetchThreads_;
+            size_t bufferPoolBytes_;
+            bool hugePageBuffers_;
+            bool http2_;
+            size_t streamHighWatermark_;
+            size_t streamLowWatermark_;
+            size_t bodySpoolThreshold_;
+            std::string bodySpoolDirectory_;
+            std::shared_ptr<Http::AccessLog> accessLog_;
+            std::shared_ptr<Tracing::Tracer> tracer_;
+            size_t maxConnections_;
+            size_t idleEviction_;
+            std::shared_ptr<Tcp::WorkerPool> workerPool_;
+            std::chrono::microseconds busyPollSpin_;
+            bool socketBusyPoll_;
+            size_t maxInFlight_;
+            size_t bodyBudget_;
+            size_t workerBodyBudget_;
+            std::shared_ptr<Http::RateLimiter> rateLimiter_;
+            std::chrono::milliseconds shedTarget_;
+            std::chrono::milliseconds shedInterval_;
             Options();
         };
         Endpoint();
@@ -121,6 +505,33 @@ namespace Pistache::Http
 
         void shutdown();
 
+        /*!
+         * \brief Serve from a socket that already listens
+         *
+         * The socket is one passed by systemd socket activation, see
+         * Tcp::Listener::activationSockets(), or the one the previous
+         * process handed over with sendListenSocket() and that
+         * Tcp::Listener::receiveListenSocket() got. The connections
+         * waiting in its backlog are served by this endpoint, none is
+         * refused during a restart. Must be called before serve().
+         */
+        void useListenSocket(Fd fd) { listener.adoptListenSocket(fd); }
+
+        // Hands the listening socket to the next process over a connected
+        // Unix domain socket, see Tcp::Listener::sendListenSocket()
+        void sendListenSocket(Fd channel) { listener.sendListenSocket(channel); }
+
+        /*!
+         * \brief Stop accepting and wait for the connections to finish
+         *
+         * The connections waiting in the backlog are left to the process
+         * the socket was handed to, the requests being handled are
+         * answered and every connection is closed once it is idle, see
+         * Tcp::Listener::drain(). Returns whether all of them were closed
+         * within the timeout, shutdown() then closes what is left.
+         */
+        bool drain(std::chrono::milliseconds timeout);
+
         /*!
          * \brief Use SSL on this endpoint
          *
@@ -189,6 +600,69 @@ namespace Pistache::Http
         void useSSLAuth(std::string ca_file, std::string ca_path = "",
                         int (*cb)(int, void*) = nullptr);
 
+        /*!
+         * \brief Hand the encryption of the TLS connections to the kernel
+         *
+         * Once the handshake of a connection is done, its keys are given to
+         * the kernel (kTLS), which encrypts the records sent and decrypts the
+         * ones received, possibly offloading them to the NIC. Files are then
+         * sent with zero copy sendfile() instead of being read and encrypted
+         * in userspace. Connections for which the kernel does not support the
+         * negotiated cipher keep being encrypted by OpenSSL.
+         *
+         * The function 'useSSL' *must* be called before this function.
+         *
+         * \sa useSSL
+         * \note The tls kernel module must be loaded for the offload to
+         *          happen. This function will throw an exception if pistache
+         *          has not been compiled with PISTACHE_USE_SSL, or if OpenSSL
+         *          is older than 3.0 or built without kTLS.
+         */
+        void useKTLS();
+
+        /*!
+         * \brief Let the clients resume their TLS sessions
+         *
+         * \param[in] store Where the sessions are kept, nullptr to only use
+         *                  session tickets
+         * \param[in] timeout Lifetime of a session
+         * \param[in] ticketKeyRotation How long a key encrypts the session
+         *                  tickets, 0 to disable them
+         *
+         * A reconnecting client presents the session of a previous
+         * connection, either its id or a ticket holding the session encrypted
+         * by the server. The handshake is then abbreviated: no certificate is
+         * sent and no key exchange is signed.
+         *
+         * The sessions identified by an id are kept in the store. The default
+         * one keeps them in the memory of the process, a store backed by a
+         * service shared between several servers lets the clients resume
+         * their sessions on any of them.
+         *
+         * The keys of the tickets are generated randomly and replaced every
+         * ticketKeyRotation, the tickets encrypted with a replaced key are
+         * accepted, and renewed, until their timeout.
+         *
+         * The function 'useSSL' *must* be called before this function, and
+         * both before the endpoint serves.
+         *
+         * \sa useSSL, tlsHandshakes
+         * \note The keys of the tickets are rotated with OpenSSL 3.0 and
+         *          later, older versions keep the key they generated. This
+         *          function will throw an exception if pistache has not been
+         *          compiled with PISTACHE_USE_SSL
+         */
+        void useSSLSessions(std::shared_ptr<Tcp::TlsSessionStore> store = std::make_shared<Tcp::TlsSessionCache>(),
+                            std::chrono::seconds timeout           = Const::DefaultTlsSessionTimeout,
+                            std::chrono::seconds ticketKeyRotation = Const::DefaultTicketKeyRotation);
+
+        // Count of the full and of the resumed TLS handshakes of all workers
+        Tcp::TlsHandshakes tlsHandshakes() { return listener.tlsHandshakes(); }
+
+        // Loop and queue counters of every worker, cheap enough to be read
+        // as often as needed while serving
+        std::vector<Tcp::Listener::WorkerStats> workerStats() { return listener.workerStats(); }
+
         bool isBound() const { return listener.isBound(); }
 
         Port getPort() const { return listener.getPort(); }
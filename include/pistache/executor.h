@@ -0,0 +1,84 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* executor.h
+
+   Pool of threads running CPU-heavy work away from the worker threads of the
+   transports, so that they keep reading and writing for their other peers
+   meanwhile. Every thread of the pool has its own queue: a task submitted
+   from a thread of the pool goes to the queue of that thread, the others are
+   spread over the queues, and a thread whose queue is empty steals the tasks
+   at the back of the other ones.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Pistache
+{
+
+    class Executor
+    {
+    public:
+        using Task = std::function<void()>;
+
+        explicit Executor(size_t threads = std::thread::hardware_concurrency());
+
+        Executor(const Executor&)            = delete;
+        Executor& operator=(const Executor&) = delete;
+
+        // Runs the tasks already submitted, then joins the threads
+        ~Executor();
+
+        // Throws once the executor has been shut down
+        void submit(Task task);
+
+        // Runs the tasks already submitted and joins the threads, the ones
+        // submitted afterwards are refused
+        void shutdown();
+
+        size_t threads() const { return queues_.size(); }
+
+        // Tasks run by another thread than the one whose queue held them
+        uint64_t stolen() const { return stolen_.load(std::memory_order_relaxed); }
+
+    private:
+        struct alignas(64) Queue
+        {
+            std::mutex lock;
+            std::deque<Task> tasks;
+        };
+
+        void run(size_t index);
+        // The front of its own queue, or else the back of another one
+        bool take(size_t index, Task& task);
+
+        std::vector<std::unique_ptr<Queue>> queues_;
+        std::vector<std::thread> workers_;
+
+        // Tasks in the queues, the threads only sleep on lock_ when there is
+        // none
+        std::atomic<size_t> pending_ { 0 };
+        std::atomic<size_t> sleeping_ { 0 };
+        std::atomic<bool> stop_ { false };
+        std::mutex lock_;
+        std::condition_variable cv_;
+
+        std::atomic<size_t> next_ { 0 };
+        std::atomic<uint64_t> stolen_ { 0 };
+    };
+
+} // namespace Pistache
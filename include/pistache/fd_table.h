@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* fd_table.h
+
+   A map keyed by file descriptors. The kernel hands out the lowest free
+   descriptor, so they stay small and dense and a vector indexed by the
+   descriptor replaces the hash lookup with a single indexed load.
+
+   The table is not thread-safe, callers are expected to provide their own
+   synchronization.
+*/
+
+#pragma once
+
+#include <pistache/os.h>
+
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace Pistache
+{
+
+    template <typename T>
+    class FdTable
+    {
+    public:
+        T* find(Fd fd)
+        {
+            if (!inRange(fd) || !slots_[static_cast<size_t>(fd)])
+                return nullptr;
+            return &*slots_[static_cast<size_t>(fd)];
+        }
+
+        const T* find(Fd fd) const
+        {
+            if (!inRange(fd) || !slots_[static_cast<size_t>(fd)])
+                return nullptr;
+            return &*slots_[static_cast<size_t>(fd)];
+        }
+
+        bool contains(Fd fd) const { return find(fd) != nullptr; }
+
+        // Returns false, and leaves the table untouched, when the descriptor
+        // already has a value
+        bool insert(Fd fd, T value)
+        {
+            if (fd < 0)
+                return false;
+
+            const auto index = static_cast<size_t>(fd);
+            if (index >= slots_.size())
+                slots_.resize(index + 1);
+
+            if (slots_[index])
+                return false;
+
+            slots_[index].emplace(std::move(value));
+            ++size_;
+            return true;
+        }
+
+        bool erase(Fd fd)
+        {
+            if (!inRange(fd) || !slots_[static_cast<size_t>(fd)])
+                return false;
+
+            slots_[static_cast<size_t>(fd)].reset();
+            --size_;
+            return true;
+        }
+
+        // Removes the value and hands it back
+        std::optional<T> take(Fd fd)
+        {
+            if (!inRange(fd))
+                return std::nullopt;
+
+            auto value = std::exchange(slots_[static_cast<size_t>(fd)], std::nullopt);
+            if (value)
+                --size_;
+            return value;
+        }
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        void clear()
+        {
+            slots_.clear();
+            size_ = 0;
+        }
+
+        // Calls func(fd, value) for every value, by ascending descriptor. func
+        // must not insert into the table.
+        template <typename Func>
+        void forEach(Func func)
+        {
+            for (size_t i = 0; i < slots_.size(); ++i)
+            {
+                if (slots_[i])
+                    func(static_cast<Fd>(i), *slots_[i]);
+            }
+        }
+
+        template <typename Func>
+        void forEach(Func func) const
+        {
+            for (size_t i = 0; i < slots_.size(); ++i)
+            {
+                if (slots_[i])
+                    func(static_cast<Fd>(i), *slots_[i]);
+            }
+        }
+
+    private:
+        bool inRange(Fd fd) const
+        {
+            return fd >= 0 && static_cast<size_t>(fd) < slots_.size();
+        }
+
+        std::vector<std::optional<T>> slots_;
+        size_t size_ = 0;
+    };
+
+} // namespace Pistache
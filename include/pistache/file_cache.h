@@ -0,0 +1,128 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* file_cache.h
+
+   Static files served from a cache of open descriptors. The cache keeps, for
+   every file it served, the descriptor, the stat() results, the media type
+   and the validators of the file, along with the .br and .gz siblings that
+   hold a precompressed copy of it.
+
+   A file is checked again with stat() once its entry is older than the
+   revalidation delay, in between a request is answered without any system
+   call on the file: conditional requests get a 304 and the others are sent
+   from the descriptor already open.
+*/
+
+#pragma once
+
+#include <pistache/async.h>
+#include <pistache/http.h>
+#include <pistache/mime.h>
+#include <pistache/stream.h>
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include <sys/types.h>
+
+namespace Pistache::Http
+{
+
+    class FileCache
+    {
+    public:
+        static constexpr size_t DefaultMaxEntries = 1024;
+
+        explicit FileCache(std::chrono::milliseconds revalidateAfter = std::chrono::seconds(1),
+                           size_t maxEntries                         = DefaultMaxEntries);
+
+        FileCache(const FileCache&)            = delete;
+        FileCache& operator=(const FileCache&) = delete;
+
+        /* Answers the request with the file, like serveFile(): a 304 when the
+         * If-None-Match or If-Modified-Since header of the request matches
+         * the cached validators, the precompressed sibling preferred by the
+         * Accept-Encoding header of the request when there is one, the file
+         * itself otherwise, or the part of it that the Range header asks
+         * for. The media type is guessed from the extension of the file when
+         * contentType is not valid.
+         *
+         * Throws an HttpError when the file cannot be opened.
+         */
+        Async::Promise<ssize_t> serve(const Request& request, ResponseWriter& writer,
+                                      const std::string& fileName,
+                                      const Mime::MediaType& contentType = Mime::MediaType());
+
+        // Serve the .br and .gz siblings of the files, enabled by default.
+        // Entries already cached keep their siblings until checked again.
+        void setPrecompressed(bool enabled);
+
+        size_t size() const;
+        void clear();
+
+    private:
+        struct Stat
+        {
+            bool exists  = false;
+            dev_t dev    = 0;
+            ino_t ino    = 0;
+            off_t size   = 0;
+            time_t mtime = 0;
+            long mtimeNs = 0;
+
+            bool operator==(const Stat& other) const;
+            bool operator!=(const Stat& other) const { return !(*this == other); }
+        };
+
+        struct Variant
+        {
+            std::shared_ptr<const Fd> file;
+            size_t size = 0;
+            std::string etag;
+        };
+
+        struct Entry
+        {
+            Mime::MediaType mime;
+            FullDate lastModified;
+
+            Variant identity;
+            std::optional<Variant> br;
+            std::optional<Variant> gzip;
+
+            // What the file and its siblings looked like when they were opened
+            Stat stats[3];
+        };
+
+        struct Slot
+        {
+            std::shared_ptr<const Entry> entry;
+            std::chrono::steady_clock::time_point validated;
+            std::list<std::string>::iterator lru;
+        };
+
+        std::shared_ptr<const Entry> lookup(const std::string& fileName);
+        std::shared_ptr<const Entry> load(const std::string& fileName) const;
+        void stat(const std::string& fileName, Stat (&stats)[3]) const;
+
+        const std::chrono::milliseconds revalidateAfter_;
+        const size_t maxEntries_;
+        std::atomic<bool> precompressed_ { true };
+
+        mutable std::mutex lock_;
+        std::unordered_map<std::string, Slot> slots_;
+        // Least recently used last
+        std::list<std::string> lru_;
+    };
+
+} // namespace Pistache::Http
@@ -0,0 +1,76 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* file_prefetcher.h
+
+   Small pool of threads that read parts of files into the page cache. A
+   worker thread about to send a part of a file that is not in memory hands
+   it to the pool instead of blocking on the disk in sendfile(), and resumes
+   the send once the pool read it: its other peers are served meanwhile.
+*/
+
+#pragma once
+
+#include <pistache/os.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Pistache::Tcp
+{
+
+    class FilePrefetcher
+    {
+    public:
+        static constexpr size_t DefaultThreads = 2;
+
+        explicit FilePrefetcher(size_t threads = DefaultThreads);
+
+        FilePrefetcher(const FilePrefetcher&)            = delete;
+        FilePrefetcher& operator=(const FilePrefetcher&) = delete;
+
+        // Waits for the reads in progress, the queued ones are dropped
+        ~FilePrefetcher();
+
+        /* Whether the pages at both ends of the range are in the page cache,
+         * probed with non-blocking reads (RWF_NOWAIT). True when the kernel
+         * or the filesystem cannot tell, the file is then sent as is.
+         */
+        static bool isCached(Fd file, size_t offset, size_t size);
+
+        // Reads the range into the page cache from a thread of the pool, done
+        // is then called from that thread
+        void prefetch(std::shared_ptr<const Fd> file, size_t offset, size_t size,
+                      std::function<void()> done);
+
+        size_t threads() const { return workers_.size(); }
+
+    private:
+        struct Job
+        {
+            std::shared_ptr<const Fd> file;
+            size_t offset = 0;
+            size_t size   = 0;
+            std::function<void()> done;
+        };
+
+        void run();
+
+        std::mutex lock_;
+        std::condition_variable cv_;
+        std::deque<Job> jobs_;
+        bool stop_ = false;
+
+        std::vector<std::thread> workers_;
+    };
+
+} // namespace Pistache::Tcp
@@ -0,0 +1,147 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* hpack.h
+
+   HPACK, the compression of the header fields of HTTP/2 (RFC 7541). Both
+   ends of a connection keep a table of the fields recently sent, a field
+   already in it is sent as its index. The strings that are not indexed may
+   be sent Huffman coded.
+
+   The Decoder and the Encoder of a connection each keep their own table, a
+   header block must be decoded in the order it was received in.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Pistache::Http::Hpack
+{
+
+    // Size of the dynamic table until the peer sets another one
+    static constexpr size_t DefaultTableSize = 4096;
+
+    struct HeaderField
+    {
+        std::string name;
+        std::string value;
+
+        // What the field takes in a table, and counts for in the size of a
+        // header list (RFC 7541 4.1)
+        size_t size() const { return name.size() + value.size() + 32; }
+    };
+
+    // A header block that cannot be decoded, the connection cannot go on
+    // since the two tables may not match anymore
+    class DecodeError : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // A header block decoding to a header list past the limit. The rest of
+    // the block is not decoded, the tables do not match anymore either
+    class HeaderListTooLarge : public DecodeError
+    {
+    public:
+        using DecodeError::DecodeError;
+    };
+
+    void huffmanEncode(std::string_view data, std::string& out);
+    size_t huffmanEncodedSize(std::string_view data);
+    // Throws DecodeError when the padding is not a prefix of EOS, or when
+    // EOS is found in the data
+    std::string huffmanDecode(std::string_view data);
+
+    // The static table followed by the dynamic one, indexes start at 1
+    class Table
+    {
+    public:
+        explicit Table(size_t maxSize = DefaultTableSize);
+
+        void add(std::string name, std::string value);
+        // Evicts the oldest entries that do not fit anymore
+        void setMaxSize(size_t maxSize);
+
+        // Throws DecodeError when there is no entry at that index
+        const HeaderField& at(size_t index) const;
+
+        // Index of an entry with that name and value, or else of an entry
+        // with that name, zero when there is none. The bool tells whether
+        // the value matched as well
+        std::pair<size_t, bool> find(std::string_view name, std::string_view value) const;
+
+        size_t size() const { return size_; }
+        size_t maxSize() const { return maxSize_; }
+        size_t entries() const { return entries_.size(); }
+
+    private:
+        void evict(size_t room);
+
+        // The newest first, it has the lowest dynamic index
+        std::deque<HeaderField> entries_;
+        size_t size_ = 0;
+        size_t maxSize_;
+    };
+
+    class Decoder
+    {
+    public:
+        explicit Decoder(size_t maxTableSize = DefaultTableSize);
+
+        // The largest table the encoder of the peer may use, as advertised
+        // in the SETTINGS_HEADER_TABLE_SIZE of this end
+        void setMaxTableSize(size_t size);
+
+        // Decodes a whole header block, throws DecodeError. Throws
+        // HeaderListTooLarge as soon as the size of the header list goes
+        // past maxListSize, before a block of references to a large entry
+        // is copied out in full
+        std::vector<HeaderField> decode(const char* data, size_t size,
+                                        size_t maxListSize = std::numeric_limits<size_t>::max());
+
+        const Table& table() const { return table_; }
+
+    private:
+        Table table_;
+        size_t maxTableSize_;
+    };
+
+    class Encoder
+    {
+    public:
+        explicit Encoder(size_t maxTableSize = DefaultTableSize);
+
+        // The SETTINGS_HEADER_TABLE_SIZE of the peer. The table shrinks to it
+        // when it is smaller than the current one, the size update is sent
+        // at the beginning of the next block
+        void setMaxTableSize(size_t size);
+
+        void encode(const std::vector<HeaderField>& fields, std::string& out);
+
+        const Table& table() const { return table_; }
+
+    private:
+        void encodeField(const HeaderField& field, std::string& out);
+
+        Table table_;
+        size_t limit_;
+        // Smallest size the table went through since the last block, and
+        // the size it ended at, both have to be told to the decoder
+        size_t pendingMin_;
+        bool pendingUpdate_ = false;
+    };
+
+} // namespace Pistache::Http::Hpack
@@ -14,17 +14,22 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <variant>
 #include <vector>
 
 #include <sys/timerfd.h>
 
 #include <pistache/async.h>
+#include <pistache/compression.h>
 #include <pistache/cookie.h>
 #include <pistache/http_defs.h>
 #include <pistache/http_headers.h>
@@ -41,6 +46,11 @@ namespace Pistache
     {
         class Peer;
     }
+    namespace Tracing
+    {
+        class Tracer;
+        struct PendingTrace;
+    } // namespace Tracing
     namespace Http
     {
 
@@ -71,8 +81,36 @@ namespace Pistache
             class ResponseLineStep;
             class HeadersStep;
             class BodyStep;
+
+            template <typename Message>
+            class ParserImpl;
+
+            struct ConnectionState;
+            struct RequestCancellation;
+            class BodyDecoder;
+            class SpoolWriter;
         } // namespace Private
 
+        class AccessLog;
+        class RateLimiter;
+        struct PendingAccess;
+
+        namespace Http2
+        {
+            class Session;
+            class ClientSession;
+        } // namespace Http2
+
+        namespace Sse
+        {
+            class Channel;
+        } // namespace Sse
+
+        namespace WebSocket
+        {
+            class Connection;
+        } // namespace WebSocket
+
         template <class CharT, class Traits>
         std::basic_ostream<CharT, Traits>& crlf(std::basic_ostream<CharT, Traits>& os)
         {
@@ -89,6 +127,8 @@ namespace Pistache
             friend class Private::HeadersStep;
             friend class Private::BodyStep;
             friend class ResponseWriter;
+            friend class Http2::Session;
+            friend class Http2::ClientSession;
 
             Message() = default;
             explicit Message(Version version);
@@ -123,6 +163,13 @@ namespace Pistache
         namespace Uri
         {
 
+            /* Parameters of the query of a Uri.
+
+               The query of a request is kept as the single raw segment it was
+               received as, lookups scan it and getView() returns views into it
+               without copying. The parameters only are split into a map when
+               they are iterated over or modified.
+            */
             class Query
             {
             public:
@@ -130,18 +177,44 @@ namespace Pistache
                 explicit Query(
                     std::initializer_list<std::pair<const std::string, std::string>> params);
 
+                Query(const Query& other);
+                Query(Query&& other) noexcept;
+                Query& operator=(const Query& other);
+                Query& operator=(Query&& other) noexcept;
+
+                // raw is the query of a Uri without its leading '?', as in
+                // "key1=value1&key2"
+                static Query fromRaw(std::string raw);
+
                 void add(std::string name, std::string value);
                 std::optional<std::string> get(const std::string& name) const;
                 bool has(const std::string& name) const;
+
+                // The value as it appears in the Uri. The view stays valid as long
+                // as the query is not modified
+                std::optional<std::string_view> getView(std::string_view name) const;
+
+                // The value with its percent-encoded octets, and '+', decoded
+                std::optional<std::string> getDecoded(std::string_view name) const;
+
                 // Return empty string or "?key1=value1&key2=value2" if query exist
                 std::string as_str() const;
 
-                void clear() { params.clear(); }
+                // The raw query, empty once the parameters have been modified
+                std::string_view raw() const { return raw_; }
+
+                void clear()
+                {
+                    raw_.clear();
+                    params.clear();
+                    split_.store(true, std::memory_order_relaxed);
+                }
 
                 // \brief Return iterator to the beginning of the parameters map
                 std::unordered_map<std::string, std::string>::const_iterator
                 parameters_begin() const
                 {
+                    split();
                     return params.begin();
                 }
 
@@ -149,12 +222,14 @@ namespace Pistache
                 std::unordered_map<std::string, std::string>::const_iterator
                 parameters_end() const
                 {
+                    split();
                     return params.end();
                 }
 
                 // \brief returns all parameters given in the query
                 std::vector<std::string> parameters() const
                 {
+                    split();
                     std::vector<std::string> keys;
                     std::transform(
                         params.begin(), params.end(), std::back_inserter(keys),
@@ -163,14 +238,65 @@ namespace Pistache
                 }
 
             private:
+                // Copies the parameters of the raw query to the map, under a
+                // lock since the const accessors of a request may be called
+                // from several threads at once. raw_ stays as it is for the
+                // lookups scanning it meanwhile, params only is read once
+                // split_ is set
+                void split() const;
+
+                std::string raw_;
+                // Whether params, rather than raw_, holds the parameters
+                mutable std::atomic<bool> split_ { true };
+
                 // first is key second is value
-                std::unordered_map<std::string, std::string> params;
+                mutable std::unordered_map<std::string, std::string> params;
             };
         } // namespace Uri
 
         // Remove when RequestBuilder will be out of namespace Experimental
         namespace Experimental {class RequestBuilder; }
 
+        class Handler;
+
+        // A request body spooled to a temporary file instead of memory, see
+        // Handler::setBodySpool(). The file is removed along with the last
+        // reference to it, unless it has been kept
+        class BodyFile
+        {
+        public:
+            // Creates an empty file in the directory, throws an HttpError
+            // when it can not
+            static std::shared_ptr<BodyFile> create(const std::string& directory);
+
+            BodyFile(const BodyFile&)            = delete;
+            BodyFile& operator=(const BodyFile&) = delete;
+
+            ~BodyFile();
+
+            Fd fd() const { return *file_; }
+            const std::string& path() const { return path_; }
+            size_t size() const { return size_; }
+
+            // The body, to be sent back in a response
+            FileBuffer buffer() const { return FileBuffer(file_, size_); }
+
+            // Moves the file to its destination, where it stays once the
+            // request is gone. Throws a std::runtime_error when it can not
+            void keep(const std::string& destination);
+
+        private:
+            friend class Handler;
+            friend class Private::SpoolWriter;
+
+            BodyFile(std::shared_ptr<const Fd> file, std::string path);
+
+            std::shared_ptr<const Fd> file_;
+            std::string path_;
+            size_t size_ = 0;
+            bool kept_   = false;
+        };
+
         // 5. Request
         class Request : public Message
         {
@@ -178,6 +304,9 @@ namespace Pistache
             friend class Private::RequestLineStep;
 
             friend class Experimental::RequestBuilder;
+            friend class Private::ParserImpl<Http::Request>;
+            friend class Http2::Session;
+            friend class Handler;
 
             Request() = default;
 
@@ -210,7 +339,18 @@ namespace Pistache
 
             std::chrono::milliseconds timeout() const;
 
+            // The body when it was spooled to a file, body() is then empty
+            const std::shared_ptr<BodyFile>& bodyFile() const { return bodyFile_; }
+
+            // When the server started to receive the request, left at the
+            // epoch for a request that was not received by a server
+            std::chrono::steady_clock::time_point receivedAt() const { return received_; }
+
         private:
+            // Empties the request while keeping the memory already held by the
+            // body and the header, cookie and query containers
+            void clear();
+
 #ifdef LIBSTDCPP_SMARTPTR_LOCK_FIXME
             void associatePeer(const std::shared_ptr<Tcp::Peer>& peer)
             {
@@ -230,9 +370,11 @@ namespace Pistache
 #endif
             Address address_;
             std::chrono::milliseconds timeout_ = std::chrono::milliseconds(0);
+
+            std::shared_ptr<BodyFile> bodyFile_;
+            std::chrono::steady_clock::time_point received_;
         };
 
-        class Handler;
         class ResponseWriter;
 
         class Timeout
@@ -244,22 +386,30 @@ namespace Pistache
                 : handler(other.handler)
                 , transport(other.transport)
                 , armed(other.armed)
-                , timerFd(other.timerFd)
+                , timerId(other.timerId)
                 , peer(std::move(other.peer))
+                , http2(std::move(other.http2))
+                , http2Stream(other.http2Stream)
+                , cancellation_(std::move(other.cancellation_))
             {
                 // cppcheck-suppress useInitializationList
-                other.timerFd = -1;
+                other.armed = false;
             }
 
             Timeout& operator=(Timeout&& other)
             {
-                handler       = other.handler;
-                transport     = other.transport;
-                version       = other.version;
-                armed         = other.armed;
-                timerFd       = other.timerFd;
-                other.timerFd = -1;
+                disarm();
+
+                handler     = other.handler;
+                transport   = other.transport;
+                version     = other.version;
+                armed       = other.armed;
+                timerId     = other.timerId;
+                other.armed = false;
                 peer          = std::move(other.peer);
+                http2         = std::move(other.http2);
+                http2Stream   = other.http2Stream;
+                cancellation_ = std::move(other.cancellation_);
                 return *this;
             }
 
@@ -268,20 +418,7 @@ namespace Pistache
             template <typename Duration>
             void arm(Duration duration)
             {
-                Async::Promise<uint64_t> p([=](Async::Deferred<uint64_t> deferred) {
-                    timerFd = TRY_RET(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK));
-                    transport->armTimer(timerFd, duration, std::move(deferred));
-                });
-
-                p.then(
-                    [=](uint64_t numWakeup) {
-                        this->armed = false;
-                        this->onTimeout(numWakeup);
-                        close(timerFd);
-                    },
-                    [=](std::exception_ptr exc) { std::rethrow_exception(exc); });
-
-                armed = true;
+                armMs(std::chrono::duration_cast<std::chrono::milliseconds>(duration));
             }
 
             void disarm();
@@ -294,20 +431,52 @@ namespace Pistache
             Timeout(Tcp::Transport* transport_, Http::Version version, Handler* handler_,
                     std::weak_ptr<Tcp::Peer> peer_);
 
-            void onTimeout(uint64_t numWakeup);
+            void armMs(std::chrono::milliseconds duration);
+
+            // See ResponseWriter::cancellation(), shared by the copies
+            Async::CancellationToken cancellation();
+
+            // Does not refer to the Timeout itself, which may have been moved
+            // by the time the timer fires
+            static void onTimeout(Handler* handler, Tcp::Transport* transport,
+                                  Http::Version version, const std::weak_ptr<Tcp::Peer>& peer,
+                                  const std::weak_ptr<Http2::Session>& http2, uint32_t http2Stream,
+                                  const std::shared_ptr<Private::RequestCancellation>& cancellation);
 
             Handler* handler;
             Http::Version version;
             Tcp::Transport* transport;
             bool armed;
-            Fd timerFd;
+            TimerWheel::TimerId timerId;
             std::weak_ptr<Tcp::Peer> peer;
+
+            // Stream of the request on an HTTP/2 connection
+            std::weak_ptr<Http2::Session> http2;
+            uint32_t http2Stream = 0;
+
+            std::shared_ptr<Private::RequestCancellation> cancellation_;
+        };
+
+        // Told once the last write of a response is done, see
+        // ResponseWriter::listen()
+        class ResponseListener
+        {
+        public:
+            virtual ~ResponseListener() = default;
+
+            // since is the time given to listen(), written is false when the
+            // connection failed first
+            virtual void onWritten(Code code, std::chrono::steady_clock::time_point since,
+                                   bool written)
+                = 0;
         };
 
         class ResponseStream final
         {
         public:
             friend class ResponseWriter;
+            friend class StreamGroup;
+            friend class Sse::Channel;
 
             ResponseStream(ResponseStream&& other);
 
@@ -318,21 +487,81 @@ namespace Pistache
 
             std::streamsize write(const char* data, std::streamsize sz);
 
+            // Sends the buffer as a chunk of its own, queued as it is instead
+            // of being copied in the stream. What has been written before is
+            // flushed along with it
+            void write(RawBuffer buffer);
+            // A chunk sent from a range of the file, with sendfile()
+            void write(const FileBuffer& file);
+            // The chunk references the storage of the buffer, that the other
+            // streams it is written to share
+            void write(const SharedBuffer& buffer);
+
+            // With a content coding, also pushes out what the compressor holds
             void flush();
             void ends();
 
+            /* Backpressure of the connection. What the stream flushes is
+             * queued until it has been written to the socket, a stream stops
+             * being writable once the queued bytes of its connection reach the
+             * high watermark (Endpoint::Options::streamWatermarks()).
+             *
+             * whenWritable() is resolved once they are back at the low
+             * watermark, right away when the stream is writable, and rejected
+             * when the connection is closed first. A producer should wait for
+             * it instead of flushing more.
+             */
+            size_t queuedBytes() const;
+            bool writable() const;
+            Async::Promise<void> whenWritable();
+
         private:
-            ResponseStream(Message&& other, std::weak_ptr<Tcp::Peer> peer,
+            ResponseStream(Message&& other, std::weak_ptr<Tcp::Peer> peer, Tcp::PeerHandle handle,
                            Tcp::Transport* transport, Timeout timeout, size_t streamSize,
-                           size_t maxResponseSize);
+                           size_t maxResponseSize,
+                           std::weak_ptr<Private::ConnectionState> connection = {},
+                           Compression::CompressorPtr compressor             = nullptr,
+                           std::shared_ptr<Http2::Session> http2             = nullptr,
+                           uint32_t http2Stream                              = 0);
 
             std::shared_ptr<Tcp::Peer> peer() const;
 
+            void writeChunk(const char* data, size_t size);
+            void compressChunk(const char* data, size_t size, Compression::Compressor::Flush flush);
+            // The chunk head, the buffer and the closing CRLF are separate
+            // entries of the write queue
+            template <typename Buf>
+            void writeBuffer(Buf buffer, size_t size);
+            // Counts the bytes as queued on the peer until the write is done
+            void track(Async::Promise<ssize_t> write, size_t bytes);
+
             Message response_;
             std::weak_ptr<Tcp::Peer> peer_;
+            // How the thread of the transport finds the peer
+            Tcp::PeerHandle handle_;
             DynamicStreamBuf buf_;
             Tcp::Transport* transport_;
             Timeout timeout_;
+            std::weak_ptr<Private::ConnectionState> connection_;
+
+            // Set when the body is sent with a content coding
+            Compression::CompressorPtr compressor_;
+            std::string compressed_;
+
+            // Set on an HTTP/2 connection, the body is sent in DATA frames
+            // instead of chunks
+            std::shared_ptr<Http2::Session> http2_;
+            uint32_t http2Stream_ = 0;
+
+            // Recorded to the access log once the stream ends
+            std::shared_ptr<PendingAccess> access_;
+            uint64_t sent_ = 0;
+
+            // Told once the last chunk has been written
+            std::shared_ptr<ResponseListener> listener_;
+            std::chrono::steady_clock::time_point listenedSince_;
+            std::shared_ptr<Tracing::PendingTrace> trace_;
+            bool ending_ = false;
         };
 
         inline ResponseStream& ends(ResponseStream& stream)
@@ -350,6 +579,15 @@ namespace Pistache
         template <typename T>
         ResponseStream& operator<<(ResponseStream& stream, const T& val)
         {
+            if (stream.compressor_ || stream.http2_)
+            {
+                std::ostringstream oss;
+                oss << val;
+                const auto data = oss.str();
+                stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+                return stream;
+            }
+
             Size<T> size;
 
             std::ostream os(&stream.buf_);
@@ -365,6 +603,29 @@ namespace Pistache
             return (*func)(stream);
         }
 
+        // Streams that are sent the same events, the subscribers of
+        // server-sent events for instance. Can be used from any thread
+        class StreamGroup
+        {
+        public:
+            // The stream stays in the group until its connection is closed
+            void add(ResponseStream&& stream);
+
+            // Writes the payload as a chunk of every stream, all of them
+            // referencing the same storage, and flushes them. Returns the
+            // number of streams it was written to
+            size_t broadcast(const SharedBuffer& payload);
+
+            // Ends the streams and empties the group
+            void close();
+
+            size_t size() const;
+
+        private:
+            mutable std::mutex lock_;
+            std::vector<ResponseStream> streams_;
+        };
+
         // 6. Response
         // @Investigate public inheritence
         class Response : public Message
@@ -381,6 +642,83 @@ namespace Pistache
             Response& operator=(Response&& other) = default;
         };
 
+        /* Output streams of RapidJSON (Ch, Put() and Flush()), so that a
+         * rapidjson::Writer serializes a document straight into a response
+         * body, without a StringBuffer to copy it from. Neither needs the
+         * RapidJSON headers.
+         */
+
+        // Appends to a string, see ResponseWriter::sendJson()
+        class JsonOutput
+        {
+        public:
+            typedef char Ch;
+
+            explicit JsonOutput(std::string& out)
+                : out_(out)
+            { }
+
+            void Put(char c) { out_.push_back(c); }
+            void Flush() { }
+
+        private:
+            std::string& out_;
+        };
+
+        // Sends the document as chunks of the stream, of chunkSize bytes,
+        // for documents too large to be held at once
+        class JsonStreamOutput
+        {
+        public:
+            typedef char Ch;
+
+            static constexpr size_t DefaultChunkSize = 16384;
+
+            explicit JsonStreamOutput(ResponseStream& stream,
+                                      size_t chunkSize = DefaultChunkSize)
+                : stream_(stream)
+                , chunkSize_(chunkSize)
+            {
+                chunk_.reserve(chunkSize_);
+            }
+
+            void Put(char c)
+            {
+                chunk_.push_back(c);
+                if (chunk_.size() >= chunkSize_)
+                    Flush();
+            }
+
+            // Called by the writer once the document is complete, the stream
+            // is ended by its owner
+            void Flush()
+            {
+                if (chunk_.empty())
+                    return;
+                stream_.write(chunk_.data(), static_cast<std::streamsize>(chunk_.size()));
+                stream_.flush();
+                chunk_.clear();
+            }
+
+        private:
+            ResponseStream& stream_;
+            size_t chunkSize_;
+            std::string chunk_;
+        };
+
+        // Given a response as it is serialized, see ResponseWriter::record()
+        class ResponseRecorder
+        {
+        public:
+            virtual ~ResponseRecorder() = default;
+
+            // head holds the status line and the headers, up to and with the
+            // blank line ending them
+            virtual void onSerialized(const Response& response, std::string_view head,
+                                      std::string_view body)
+                = 0;
+        };
+
         class ResponseWriter final
         {
         public:
@@ -388,16 +726,21 @@ namespace Pistache
 
             friend Async::Promise<ssize_t>
             serveFile(ResponseWriter&, const std::string&, const Mime::MediaType&);
+            friend Async::Promise<ssize_t>
+            serveFile(ResponseWriter&, const FileBuffer&, const Mime::MediaType&);
+            friend Async::Promise<ssize_t>
+            serveFile(const Request&, ResponseWriter&, const FileBuffer&, const Mime::MediaType&);
 
             friend class Handler;
             friend class Timeout;
+            friend class Http2::Session;
 
             ResponseWriter& operator=(const ResponseWriter& other) = delete;
 
             friend class Private::ResponseLineStep;
 
             ResponseWriter(Http::Version version, Tcp::Transport* transport,
-                           Handler* handler, std::weak_ptr<Tcp::Peer> peer);
+                           Handler* handler, const std::shared_ptr<Tcp::Peer>& peer);
 
             //
             // C++11: std::weak_ptr move constructor is C++14 only so the default
@@ -432,14 +775,72 @@ namespace Pistache
             Async::Promise<ssize_t> send(Code code, const char* data, const size_t size,
                                          const Mime::MediaType& mime = Mime::MediaType());
 
+            /* Takes ownership of the body instead of copying it after the headers,
+             * the headers and the body are then handed to the transport as two
+             * separate buffers.
+             */
+            Async::Promise<ssize_t> send(Code code, std::string&& body,
+                                         const Mime::MediaType& mime = Mime::MediaType());
+
+            /* Sends the JSON that serialize writes to the JsonOutput it is
+             * given, such as through a rapidjson::Writer<Http::JsonOutput>.
+             * The document is serialized right into the body handed over to
+             * the transport.
+             */
+            template <typename Serialize>
+            Async::Promise<ssize_t> sendJson(Code code, Serialize&& serialize)
+            {
+                std::string body;
+                JsonOutput output(body);
+                serialize(output);
+                return send(code, std::move(body), MIME(Application, Json));
+            }
+
             ResponseStream stream(Code code, size_t streamSize = DefaultStreamSize);
 
+            /* The listener is told once the response, or the last chunk of
+             * its stream, has been written to the connection. A single
+             * listener is kept, it costs nothing to the responses without.
+             */
+            void listen(std::shared_ptr<ResponseListener> listener,
+                        std::chrono::steady_clock::time_point since = std::chrono::steady_clock::now());
+
+            /* The recorder is given the response once it is serialized, when
+             * it is sent whole over HTTP/1. Streams and HTTP/2 responses are
+             * not recorded.
+             */
+            void record(std::shared_ptr<ResponseRecorder> recorder);
+
+            /* Sends a response that already is serialized, status line and
+             * headers included, such as one given to a ResponseRecorder. The
+             * parts are queued as they are, nothing of the writer is added to
+             * them. Rejected on an HTTP/2 stream.
+             */
+            Async::Promise<ssize_t> sendSerialized(Code code, const std::vector<SharedBuffer>& parts);
+
+            /* Content coding of the body, Identity sends it as is. Set by the
+             * handler from the Accept-Encoding header of the request when
+             * compression is enabled, an unsupported coding is ignored.
+             * Bodies smaller than the minimum size of the handler, or sent
+             * with a Content-Encoding header already set, are not compressed.
+             */
+            void setCompression(Header::Encoding encoding);
+            Header::Encoding getCompression() const { return encoding_; }
+
             template <typename Duration>
             void timeoutAfter(Duration duration)
             {
                 timeout_.arm(duration);
             }
 
+            /* Cancelled once the timeout of the request fires, right before
+             * Handler::onTimeout() is called, or once its connection closes.
+             * Handed to the client requests and the promises the response
+             * waits for, they stop working for a request nobody waits for
+             * anymore. Already cancelled when the connection is gone.
+             */
+            Async::CancellationToken cancellation() { return timeout_.cancellation(); }
+
             const CookieJar& cookies() const;
             CookieJar& cookies();
 
@@ -450,6 +851,18 @@ namespace Pistache
 
             std::shared_ptr<Tcp::Peer> peer() const;
 
+            // Transport of the worker thread that owns the connection
+            Tcp::Transport* transport() const { return transport_; }
+
+            /* Resumes the continuations given to Async::Promise::thenOn() on
+             * the thread of the transport, where the response is written
+             * without going through the queue of the other threads.
+             */
+            Tcp::Transport::Dispatcher executor() const
+            {
+                return transport_ ? transport_->dispatcher() : Tcp::Transport::Dispatcher();
+            }
+
             // Returns total count of HTTP bytes (headers, cookies, body) written when
             // sending the response.  Result valid AFTER ResponseWriter.send() is called.
             ssize_t getResponseSize() const { return sent_bytes_; }
@@ -463,6 +876,8 @@ namespace Pistache
 
             DynamicStreamBuf* rdbuf(DynamicStreamBuf* other);
 
+            // The copy starts with an empty buffer of its own, which takes a
+            // block from the pool of the worker once written to only
             ResponseWriter clone() const;
 
             std::shared_ptr<Tcp::Peer> getPeer() const
@@ -479,20 +894,79 @@ namespace Pistache
                                              const size_t size,
                                              const Mime::MediaType& mime);
 
+            void prepareResponse(Code code, const Mime::MediaType& mime);
+            bool writeHead(size_t contentLength);
+
             Async::Promise<ssize_t> putOnWire(const char* data, size_t len);
+            Async::Promise<ssize_t> putOnWire(RawBuffer&& body);
+
+            bool shouldCompress(size_t size) const;
+            RawBuffer compressBody(const char* data, size_t size);
+            void addEncodingHeaders();
+
+            // Answers the stream of an HTTP/2 connection instead
+            void attachHttp2(std::shared_ptr<Http2::Session> session, uint32_t stream);
+            Async::Promise<ssize_t> respondHttp2(std::optional<size_t> contentLength,
+                                                 std::vector<std::variant<RawBuffer, FileBuffer, SharedBuffer>> body);
 
             Response response_;
             std::weak_ptr<Tcp::Peer> peer_;
+            // How the thread of the transport finds the peer
+            Tcp::PeerHandle handle_;
             DynamicStreamBuf buf_;
             Tcp::Transport* transport_ = nullptr;
             Timeout timeout_;
             ssize_t sent_bytes_ = 0;
+
+            Compression::Settings compression_;
+            Header::Encoding encoding_ = Header::Encoding::Identity;
+
+            // Connection of the request this writer answers, told once the
+            // response has been queued so that pipelined requests resume
+            std::weak_ptr<Private::ConnectionState> connection_;
+
+            std::shared_ptr<Http2::Session> http2_;
+            uint32_t http2Stream_ = 0;
+
+            // Set when the access log of the handler samples the request,
+            // recorded once the response has been queued
+            std::shared_ptr<PendingAccess> access_;
+
+            std::shared_ptr<ResponseListener> listener_;
+            std::chrono::steady_clock::time_point listenedSince_;
+
+            // Set when the handler traces its requests, handed to the tracer
+            // once the response has been written
+            std::shared_ptr<Tracing::PendingTrace> trace_;
+
+            std::shared_ptr<ResponseRecorder> recorder_;
         };
 
         Async::Promise<ssize_t>
         serveFile(ResponseWriter& writer, const std::string& fileName,
                   const Mime::MediaType& contentType = Mime::MediaType());
 
+        // Sends a file that already is open, its size is the Content-Length
+        Async::Promise<ssize_t>
+        serveFile(ResponseWriter& writer, const FileBuffer& file,
+                  const Mime::MediaType& contentType = Mime::MediaType());
+
+        /* Like above, and answers the Range header of a GET request (RFC 9110
+         * 14.2) with the parts of the file it asks for: a 206 with a single
+         * range, a multipart/byteranges 206 with several, a 416 when none of
+         * them is in the file. The Range is ignored, and the whole file sent,
+         * when it cannot be parsed or when If-Range does not match the ETag
+         * or Last-Modified headers of the response. The file that is opened
+         * gets a Last-Modified header from its modification time.
+         */
+        Async::Promise<ssize_t>
+        serveFile(const Request& request, ResponseWriter& writer, const std::string& fileName,
+                  const Mime::MediaType& contentType = Mime::MediaType());
+
+        Async::Promise<ssize_t>
+        serveFile(const Request& request, ResponseWriter& writer, const FileBuffer& file,
+                  const Mime::MediaType& contentType = Mime::MediaType());
+
         namespace Private
         {
 
@@ -501,6 +975,11 @@ namespace Pistache
                                Done };
             using StepId = uint64_t;
 
+            // The size at the start of a chunk line, its extensions are
+            // ignored. A size past max is refused with a 413 before any of the
+            // chunk is read
+            size_t parseChunkSize(std::string_view line, size_t max);
+
             struct Step
             {
                 explicit Step(Message* request);
@@ -553,6 +1032,13 @@ namespace Pistache
 
                 StepId id() const override { return Id; }
                 State apply(StreamCursor& cursor) override;
+
+                // When enabled, the typed headers of the library are kept raw
+                // and only parsed once the handler asks for them
+                void setLazyHeaders(bool lazy) { lazy_ = lazy; }
+
+            private:
+                bool lazy_ = false;
             };
 
             class BodyStep : public Step
@@ -560,15 +1046,43 @@ namespace Pistache
             public:
                 static constexpr auto Id = Meta::Hash::fnv1a("Body");
 
-                explicit BodyStep(Message* message_)
+                // A chunked body larger than maxBodySize is refused
+                BodyStep(Message* message_, size_t maxBodySize)
                     : Step(message_)
-                    , chunk(message_)
+                    , chunk(message_, maxBodySize)
                     , bytesRead(0)
                 { }
 
                 StepId id() const override { return Id; }
                 State apply(StreamCursor& cursor) override;
 
+                // When enabled, the step first stops once the headers are
+                // parsed, so that the handler can take the body over
+                void setHeadFirst(bool headFirst) { headFirst_ = headFirst; }
+
+                // When enabled, the payloads of a chunked body are moved
+                // together within the receive buffer, over the chunk lines,
+                // and copied to the body once at its end
+                void setInPlaceChunks(bool inPlace) { chunk.inPlace = inPlace; }
+
+                enum class Mode { None,
+                                  // Stopped after the headers
+                                  Head,
+                                  Buffered,
+                                  // Taken by the handler, not read
+                                  Streamed };
+
+                Mode mode() const { return mode_; }
+                void setMode(Mode mode) { mode_ = mode; }
+
+                // Forgets the body being parsed, for the next message
+                void reset()
+                {
+                    mode_     = Mode::None;
+                    bytesRead = 0;
+                    chunk.finish();
+                }
+
             private:
                 struct Chunk
                 {
@@ -576,25 +1090,47 @@ namespace Pistache
                                   Incomplete,
                                   Final };
 
-                    explicit Chunk(Message* message_)
+                    Chunk(Message* message_, size_t maxBodySize_)
                         : message(message_)
+                        , maxBodySize(maxBodySize_)
                         , bytesRead(0)
                         , size(-1)
                     { }
 
                     Result parse(StreamCursor& cursor);
 
+                    // Ready for the next chunk of the body
                     void reset()
                     {
                         bytesRead = 0;
                         size      = -1;
                     }
 
+                    // Ready for the next body
+                    void finish()
+                    {
+                        reset();
+                        started = false;
+                        written = 0;
+                    }
+
+                    bool inPlace = false;
+
                 private:
+                    // Takes bytes of the chunk data at the cursor
+                    void append(StreamCursor& cursor, size_t bytes);
+
                     Message* message;
+                    size_t maxBodySize;
                     size_t bytesRead;
                     ssize_t size;
-                    ssize_t alreadyAppendedChunkBytes;
+                    ssize_t alreadyAppendedChunkBytes = 0;
+
+                    // Where the body starts in the receive buffer, and its
+                    // bytes taken so far
+                    bool started     = false;
+                    size_t bodyStart = 0;
+                    size_t written   = 0;
                 };
 
                 State parseContentLength(StreamCursor& cursor,
@@ -605,6 +1141,9 @@ namespace Pistache
 
                 Chunk chunk;
                 size_t bytesRead;
+
+                bool headFirst_ = false;
+                Mode mode_      = Mode::None;
             };
 
             class ParserBase
@@ -625,20 +1164,47 @@ namespace Pistache
                 virtual void reset();
                 State parse();
 
+                // Prepares the parser for the next message, keeping the bytes
+                // received past the end of the current one
+                virtual void resetKeepingPending();
+
+                // Whether bytes past the end of the current message have been
+                // received, e.g. a pipelined request
+                bool hasPending() const;
+                // Those bytes, valid until the parser is fed or reset
+                std::string_view pending() const;
+                // Drops the first bytes of pending() once they have been used
+                void consume(size_t bytes);
+
                 Step* step();
 
+                // See BodyStep::setHeadFirst()
+                void setHeadFirst(bool headFirst);
+
+                // Whether parse() stopped after the headers of a message with
+                // a body. The body is then either streamed, parse() then
+                // completes the message without it, or read as usual
+                bool bodyPending() const;
+                void streamBody();
+                void bufferBody();
+
+                // See BodyStep::setInPlaceChunks()
+                void setInPlaceChunks(bool inPlace);
+
+                // Tracing::Ticks when the step completed, zero before. Only
+                // taken with PISTACHE_USE_TRACING
+                uint64_t stepDoneAt(size_t step) const { return stepsDoneAt_[step]; }
+
             protected:
                 std::array<std::unique_ptr<Step>, StepsCount> allSteps;
                 size_t currentStep = 0;
+                std::array<uint64_t, StepsCount> stepsDoneAt_ {};
 
             private:
                 ArrayStreamBuf<char> buffer;
                 StreamCursor cursor;
             };
 
-            template <typename Message>
-            class ParserImpl;
-
             template <>
             class ParserImpl<Http::Request> : public ParserBase
             {
@@ -646,16 +1212,31 @@ namespace Pistache
                 explicit ParserImpl(size_t maxDataSize);
 
                 void reset() override;
+                void resetKeepingPending() override;
+
+                // When enabled, reset() clears the request in place instead of
+                // replacing it, so that the next request on the connection
+                // reuses its allocations
+                void setStorageReuse(bool reuse) { reuseStorage_ = reuse; }
+
+                // See HeadersStep::setLazyHeaders()
+                void setLazyHeaders(bool lazy);
 
                 std::chrono::steady_clock::time_point time() const
                 {
                     return time_;
                 }
 
+                // The next request starts now, for a parser taken from a pool
+                void restartClock();
+
                 Request request;
 
             private:
+                void resetRequest();
+
                 std::chrono::steady_clock::time_point time_;
+                bool reuseStorage_ = false;
             };
 
             template <>
@@ -673,19 +1254,414 @@ namespace Pistache
         using RequestParser  = Private::ParserImpl<Http::Request>;
         using ResponseParser = Private::ParserImpl<Http::Response>;
 
-        class Handler : public Tcp::Handler
+        // Receives the body of a request as it arrives, instead of it being
+        // buffered whole in the request. Called from the thread of the
+        // transport serving the connection
+        class BodyReader
+        {
+        public:
+            virtual ~BodyReader() = default;
+
+            // Bytes of the body, chunked framing removed. The view points
+            // into the receive buffer and is only valid during the call
+            virtual void onData(std::string_view data) = 0;
+
+            // The whole body has been received, the request is dispatched
+            // right after, with an empty body
+            virtual void onEnd();
+
+            // The body was malformed or the connection went away, the request
+            // is not dispatched
+            virtual void onError(const std::string& reason);
+        };
+
+        // Flow control of a streamed body: while paused, the connection is
+        // not read and TCP slows the client down. The bytes already received,
+        // one receive buffer at most, are still handed to the reader
+        class BodyFlow
         {
         public:
-            static constexpr const char* ParserData = "__Parser";
+            BodyFlow() = default;
+
+            // Both can be called from any thread
+            void pause() const;
+            void resume() const;
+
+        private:
+            friend class Handler;
+            BodyFlow(Tcp::Transport* transport, std::weak_ptr<Tcp::Peer> peer);
+
+            Tcp::Transport* transport_ = nullptr;
+            Tcp::Transport::Poster post_;
+            std::weak_ptr<Tcp::Peer> peer_;
+        };
+
+        namespace Private
+        {
+            // Strips the framing of a streamed body and hands its bytes to the
+            // reader, without copying them
+            class BodyDecoder
+            {
+            public:
+                // Longest chunk size or trailer line accepted
+                static constexpr size_t MaxLineSize = 4096;
+
+                BodyDecoder(std::shared_ptr<BodyReader> reader, const Message& message);
+
+                // Returns how many of the bytes belong to the body, the rest
+                // are the next request. Throws an HttpError when the chunked
+                // framing is malformed
+                size_t feed(const char* data, size_t size);
+
+                bool done() const { return step_ == Step::Done; }
+
+                const std::shared_ptr<BodyReader>& reader() const { return reader_; }
+
+            private:
+                enum class Step { Data,
+                                  ChunkSize,
+                                  ChunkData,
+                                  ChunkEnd,
+                                  Trailers,
+                                  Done };
+
+                // Gathers a line, returns false while it is not complete
+                bool readLine(const char* data, size_t size, size_t& used);
+
+                std::shared_ptr<BodyReader> reader_;
+                Step step_;
+                size_t remaining_ = 0;
+                std::string line_;
+            };
+
+            /* Bytes of the HTTP/1 requests being received, buffered by the
+             * parsers until their dispatch, bounded per worker and across the
+             * workers. A copy keeps the limits and counts for its worker
+             * alone, the global count being shared, so that every clone of a
+             * handler gets a count of its own.
+             */
+            class BodyBudget
+            {
+            public:
+                // Taken from any thread, a connection gives its bytes back
+                // when it goes away
+                struct Counts
+                {
+                    size_t globalLimit = 0;
+                    size_t workerLimit = 0;
+                    std::atomic<size_t> worker { 0 };
+                    // Null without a global limit
+                    std::shared_ptr<std::atomic<size_t>> global;
+
+                    // Takes the bytes from both counts, or nothing when either
+                    // would go past its limit
+                    bool charge(size_t bytes);
+                    void release(size_t bytes);
+
+                    // Whether the bytes could be taken now
+                    bool fits(size_t bytes) const;
+                };
+
+                BodyBudget() = default;
+                BodyBudget(const BodyBudget& other);
+                BodyBudget& operator=(const BodyBudget& other);
+
+                // Zero does not bound the count
+                void setLimits(size_t global, size_t perWorker);
+                size_t globalLimit() const { return counts_ ? counts_->globalLimit : 0; }
+                size_t workerLimit() const { return counts_ ? counts_->workerLimit : 0; }
+
+                // Null when the bodies are not bounded
+                const std::shared_ptr<Counts>& counts() const { return counts_; }
+
+            private:
+                std::shared_ptr<Counts> counts_;
+            };
+
+            // What a connection keeps between two requests. The parser only is
+            // attached while a request is being received: it is taken from the
+            // pool of the worker on the first bytes and handed back once the
+            // request has been handled
+            // Kept in a slot of the peer, see Handler::connectionState()
+            struct ConnectionState : std::enable_shared_from_this<ConnectionState>
+            {
+                // Where the response to the last dispatched request stands.
+                // The requests received behind it are only dispatched once it
+                // has been queued, so that the responses leave in order.
+                enum Pipeline : int { Idle,
+                                      Pending,
+                                      Stalled };
+
+                std::shared_ptr<RequestParser> parser;
+
+                // Connection time, or end of the last request
+                std::chrono::steady_clock::time_point since = std::chrono::steady_clock::now();
+
+                Handler* handler = nullptr;
+                std::atomic<int> pipeline { Idle };
+
+                // Set once the connection turned out to be an HTTP/2 one, the
+                // session then takes all of its bytes
+                std::shared_ptr<Http2::Session> http2;
+                // Whether the first bytes of the connection have been handled,
+                // and the ones too few to tell the preface of HTTP/2 apart
+                bool started = false;
+                std::string prelude;
+
+                // Set once the connection has been upgraded to a WebSocket one,
+                // its frames then take all of its bytes
+                std::shared_ptr<WebSocket::Connection> websocket;
+
+                // Set while the body of the request is streamed to a reader,
+                // the bytes go to it instead of the parser
+                std::unique_ptr<BodyDecoder> body;
+
+                // File the body of the request is spooled to, and whether the
+                // transport splices it there
+                std::shared_ptr<BodyFile> spool;
+                bool splicing = false;
+
+                // Set once a request was answered before its body, the bytes
+                // that follow can not be told apart from the next request
+                bool closing = false;
+
+                // Set once the request being received got past the load
+                // shedding, which sees every request once
+                bool admitted = false;
+
+                // Requests of the worker dispatched and not answered yet, set
+                // when the handler bounds them. The one of this connection
+                // counts from its dispatch until its response is queued
+                std::shared_ptr<std::atomic<size_t>> inFlight;
+
+                // Set when the handler bounds the bytes of the requests being
+                // received, the ones of this connection until their dispatch
+                std::shared_ptr<BodyBudget::Counts> budget;
+                size_t budgeted = 0;
+
+                // Cancelled once the connection closes, see
+                // ResponseWriter::cancellation()
+                Async::CancellationSource closed;
+
+                ConnectionState() = default;
+                ConnectionState(const ConnectionState&)            = delete;
+                ConnectionState& operator=(const ConnectionState&) = delete;
+                ~ConnectionState();
+
+                // Called from any thread once the response has been handed to
+                // the transport, resumes the stalled requests from the thread
+                // of the transport
+                void responseQueued(Tcp::Transport* transport, const std::weak_ptr<Tcp::Peer>& peer);
+
+                // The request was answered without the response going through
+                // responseQueued()
+                void settle();
+            };
 
+            /* Overload protection of a worker, used from its thread. Requests
+             * are refused past a number of them in flight, or while their
+             * queueing delay, from their first bytes to their dispatch, stays
+             * above the target for a whole interval, as CoDel does for the
+             * packets of a queue. Once overloaded, only the requests that
+             * waited more than twice the target are refused, so that the
+             * queue drains without refusing everything. A copy keeps the
+             * settings and starts out with no request, every clone of a
+             * handler then sheds on the load of its own worker.
+             */
+            class LoadShedder
+            {
+            public:
+                using Clock = std::chrono::steady_clock;
+
+                LoadShedder() = default;
+                LoadShedder(const LoadShedder& other);
+                LoadShedder& operator=(const LoadShedder& other);
+
+                void setMaxInFlight(size_t value);
+                size_t maxInFlight() const { return maxInFlight_; }
+
+                void setQueueDelay(std::chrono::milliseconds target, std::chrono::milliseconds interval);
+                std::chrono::milliseconds queueDelayTarget() const { return target_; }
+                std::chrono::milliseconds queueDelayInterval() const { return interval_; }
+
+                bool enabled() const { return maxInFlight_ > 0 || target_.count() > 0; }
+
+                // Whether the request received since then is to be refused
+                bool shed(Clock::time_point received, Clock::time_point now);
+
+                // Null when the requests in flight are not bounded
+                const std::shared_ptr<std::atomic<size_t>>& inFlight() const;
+
+            private:
+                size_t maxInFlight_ = 0;
+                std::chrono::milliseconds target_ { 0 };
+                std::chrono::milliseconds interval_ = Const::DefaultShedInterval;
+
+                std::shared_ptr<std::atomic<size_t>> inFlight_;
+
+                // Lowest delay of the interval, which ends at intervalEnd_
+                Clock::duration minDelay_ = Clock::duration::zero();
+                Clock::time_point intervalEnd_;
+                bool overloaded_ = false;
+            };
+
+            // Parsers of a worker that are not attached to any connection, only
+            // used from the thread of the worker. A copy starts out empty, so
+            // that every clone of a handler gets a pool of its own
+            class ParserPool
+            {
+            public:
+                static constexpr size_t MaxPooled = 64;
+
+                ParserPool() = default;
+                ParserPool(const ParserPool& other);
+                ParserPool& operator=(const ParserPool& other);
+
+                std::shared_ptr<RequestParser> acquire(size_t maxDataSize, bool reuseStorage,
+                                                       bool lazyHeaders = false,
+                                                       bool inPlaceChunks = false);
+                void release(std::shared_ptr<RequestParser> parser);
+
+                // Safe to call from any thread
+                size_t active() const;
+                size_t pooled() const;
+
+            private:
+                std::vector<std::shared_ptr<RequestParser>> free_;
+                std::atomic<size_t> pooled_ { 0 };
+
+                // Parsers of this pool still alive, the count outlives the pool
+                // since a dropped connection frees its parser directly
+                std::shared_ptr<std::atomic<size_t>> live_ = std::make_shared<std::atomic<size_t>>(0);
+            };
+        } // namespace Private
+
+        class Handler : public Tcp::Handler
+        {
+        public:
             virtual void onRequest(const Request& request, ResponseWriter response) = 0;
 
+            // Hands a parsed request over to the handler. Defaults to
+            // onRequest(), handlers that can take ownership of the request
+            // override it to avoid copying it
+            virtual void dispatchRequest(Request&& request, ResponseWriter response);
+
             virtual void onTimeout(const Request& request, ResponseWriter response);
 
+            /* Called once the headers of a request with a body have been
+             * received, before the body. A reader returned here receives the
+             * body as it arrives, and the request is dispatched with an empty
+             * body once it has been received entirely: uploads of any size
+             * then run in constant memory. The default returns nullptr, the
+             * body is buffered in the request, up to the maximum request size.
+             *
+             * Not called for HTTP/2 streams, their body is always buffered.
+             */
+            virtual std::shared_ptr<BodyReader> onBodyStart(const Request& request, BodyFlow flow);
+
+            /* Called once the headers of an HTTP/1.1 request carrying
+             * Expect: 100-continue have been received, before onBodyStart().
+             * Returning true tells the client to send the body. A handler
+             * that rejects the request sends a final response and returns
+             * false: the body is then never received, and what the client
+             * sends behind it is dropped until it closes the connection.
+             * The default accepts every request.
+             *
+             * Whether it expects 100-continue or not, a request buffered in
+             * memory whose Content-Length exceeds the maximum request size
+             * is answered with a 413 the same way, before its body.
+             */
+            virtual bool onExpectContinue(const Request& request, ResponseWriter& response);
+
             void setMaxRequestSize(size_t value);
             size_t getMaxRequestSize() const;
             void setMaxResponseSize(size_t value);
             size_t getMaxResponseSize() const;
+            void setRequestStorageReuse(bool value);
+            bool getRequestStorageReuse() const;
+
+            // Typed headers are parsed on first access rather than while the
+            // request is received. A malformed header then no longer fails
+            // the request up front, it throws when the handler reads it.
+            void setLazyHeaders(bool value);
+            bool getLazyHeaders() const;
+
+            // The chunked bodies are put together within the receive buffer
+            // and copied to the request once, see BodyStep::setInPlaceChunks()
+            void setInPlaceChunks(bool value);
+            bool getInPlaceChunks() const;
+
+            // Compression of the responses, negotiated for every request
+            // from its Accept-Encoding header
+            void setCompression(const Compression::Settings& settings);
+            const Compression::Settings& getCompression() const;
+
+            /* Bodies of at least threshold bytes, and chunked ones, are written
+             * to a temporary file of the directory instead of memory, see
+             * Request::bodyFile(). They are then not bound by the maximum
+             * request size. On plain TCP connections the transport splices
+             * them from the socket to the file, without reading them. Zero,
+             * the default, disables it. A reader returned by onBodyStart()
+             * takes precedence.
+             */
+            void setBodySpool(size_t threshold, std::string directory = "/tmp");
+            size_t getBodySpoolThreshold() const;
+            const std::string& getBodySpoolDirectory() const;
+
+            // Records the responses to the HTTP/1 requests, see AccessLog.
+            // The log is shared by the handlers of all the workers
+            void setAccessLog(std::shared_ptr<AccessLog> log);
+            const std::shared_ptr<AccessLog>& getAccessLog() const;
+
+            // Times the phases of the HTTP/1 requests, see tracing.h. Throws
+            // when pistache was not compiled with PISTACHE_USE_TRACING
+            void setTracer(std::shared_ptr<Tracing::Tracer> tracer);
+            const std::shared_ptr<Tracing::Tracer>& getTracer() const;
+
+            /* Past maxInFlight HTTP/1 requests of a worker dispatched and not
+             * answered yet, new requests are answered with a 503 before
+             * their body is read, and the connection is closed. Zero, the
+             * default, does not bound them.
+             */
+            void setMaxInFlight(size_t value);
+            size_t getMaxInFlight() const;
+
+            /* Bounds the bytes of the HTTP/1 requests received and not
+             * dispatched yet, across the workers and per worker. A request
+             * whose Content-Length does not fit is answered with a 503
+             * before its body is read, one that goes past the budget while
+             * it is received is answered the same way, and the connection
+             * is closed. Zero, the default, does not bound them.
+             */
+            void setBodyBudget(size_t global, size_t perWorker);
+            size_t getBodyBudget() const;
+            size_t getWorkerBodyBudget() const;
+
+            /* Refuses the HTTP/1 requests of a worker the same way while their
+             * queueing delay, from their first bytes to their dispatch, stays
+             * above the target for a whole interval, see
+             * Private::LoadShedder. A target of zero, the default, disables it.
+             */
+            void setLoadShedding(std::chrono::milliseconds target,
+                                 std::chrono::milliseconds interval = Const::DefaultShedInterval);
+            std::chrono::milliseconds getLoadSheddingTarget() const;
+
+            // Refuses the HTTP/1 requests over their limit with a 429 before
+            // their body is read, and closes their connection. The limiter
+            // is shared by the handlers of all the workers
+            void setRateLimiter(std::shared_ptr<RateLimiter> limiter);
+            const std::shared_ptr<RateLimiter>& getRateLimiter() const;
+
+            // Serve HTTP/2 to the clients that negotiated it with ALPN, or
+            // that start the connection with its preface
+            void setHttp2(bool value);
+            bool getHttp2() const;
+
+            // Queued bytes of a connection past which its response streams
+            // stop being writable, and at which they are writable again
+            void setStreamWatermarks(size_t high, size_t low);
+            size_t getStreamHighWatermark() const;
+            size_t getStreamLowWatermark() const;
 
             template <typename Duration>
             void setHeaderTimeout(Duration timeout)
@@ -709,8 +1685,39 @@ namespace Pistache
                 return bodyTimeout_;
             }
 
+            struct ParserStats
+            {
+                // Connections in the middle of receiving a request
+                size_t activeParsers;
+                // Parsers kept around for the next requests
+                size_t pooledParsers;
+                // Lower bound of the memory kept by the handler for a
+                // connection between two requests, not counting the peer
+                // itself: the state of the connection and of its cancellation.
+                // Allocator overhead and the buffers that grow with the
+                // traffic of the connection, such as its cancellation
+                // callbacks, are left out
+                size_t bytesPerIdleConnection;
+            };
+
+            // Parsers of the connections of this worker, safe to call from any
+            // thread
+            ParserStats parserStats() const;
+
+            static std::shared_ptr<Private::ConnectionState>
+            getConnectionState(const std::shared_ptr<Tcp::Peer>& peer);
+            // Same without counting a reference, nullptr before the handler
+            // took the connection
+            static Private::ConnectionState* connectionState(const Tcp::Peer& peer);
+
+            // Parser of the request being received, nullptr while the
+            // connection is idle
             static std::shared_ptr<RequestParser> getParser(const std::shared_ptr<Tcp::Peer>& peer);
 
+            // Tells the WebSocket of the connection that it went away, the
+            // overrides call it as well
+            void onDisconnection(const std::shared_ptr<Tcp::Peer>& peer) override;
+
             ~Handler() override = default;
 
         private:
@@ -718,9 +1725,64 @@ namespace Pistache
             void onInput(const char* buffer, size_t len,
                          const std::shared_ptr<Tcp::Peer>& peer) override;
 
+            friend struct Private::ConnectionState;
+
+            // Dispatches the complete requests held by the parser, in order
+            void handleRequests(const std::shared_ptr<Tcp::Peer>& peer,
+                                Private::ConnectionState& state);
+            void resumeRequests(const std::shared_ptr<Tcp::Peer>& peer);
+
+            // The phases of the request timed so far, for the tracer
+            std::shared_ptr<Tracing::PendingTrace>
+            beginTrace(const Request& request, const Private::ParserBase& parser, Tcp::Peer& peer);
+
+            void finishRequest(Private::ConnectionState& state);
+
+            // Answers the request with a 503 before its body when the worker
+            // is overloaded, returns true when it did
+            bool shedRequest(const std::shared_ptr<Tcp::Peer>& peer,
+                             Private::ConnectionState& state);
+
+            // Answers with a 503 the request that does not fit in the
+            // budget of the bodies, and closes the connection
+            void refuseOverBudget(const std::shared_ptr<Tcp::Peer>& peer,
+                                  Private::ConnectionState& state);
+
+            // The request was answered before its body, the connection only
+            // waits for the client to close it
+            void rejectBody(Private::ConnectionState& state);
+
+            // Spools the body of the request to a file, returns false when
+            // the transport splices it and the request waits for it
+            bool spoolBody(const std::shared_ptr<Tcp::Peer>& peer, Private::ConnectionState& state,
+                           std::shared_ptr<BodyReader>& reader);
+
+            // Feeds the streamed body, returns false while it is not complete
+            bool feedBody(Private::ConnectionState& state, const char* data, size_t size,
+                          size_t& used);
+
+            // Hands the connection over to an HTTP/2 session
+            void startHttp2(const std::shared_ptr<Tcp::Peer>& peer, Private::ConnectionState& state);
+
         private:
+            Private::ParserPool parsers_;
+            Private::LoadShedder shedder_;
+            Private::BodyBudget budget_;
+
             size_t maxRequestSize_  = Const::DefaultMaxRequestSize;
             size_t maxResponseSize_ = Const::DefaultMaxResponseSize;
+            bool reuseRequestStorage_ = false;
+            bool lazyHeaders_         = false;
+            bool inPlaceChunks_       = false;
+            bool http2_               = false;
+            size_t streamHighWatermark_ = Const::DefaultHighWatermark;
+            size_t streamLowWatermark_  = Const::DefaultLowWatermark;
+            size_t spoolThreshold_      = 0;
+            std::string spoolDirectory_ = "/tmp";
+            std::shared_ptr<AccessLog> accessLog_;
+            std::shared_ptr<RateLimiter> rateLimiter_;
+            std::shared_ptr<Tracing::Tracer> tracer_;
+            Compression::Settings compression_;
 
             std::chrono::milliseconds headerTimeout_ = Const::DefaultHeaderTimeout;
             std::chrono::milliseconds bodyTimeout_   = Const::DefaultBodyTimeout;
@@ -0,0 +1,495 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* http2.h
+
+   HTTP/2 (RFC 9113) connections. A Session takes the bytes of a connection
+   once it has been negotiated with ALPN over TLS, or when the client starts
+   it with the connection preface right away (prior knowledge, h2c). Every
+   stream is a request handed to the same Http::Handler::onRequest() as the
+   HTTP/1 ones, its ResponseWriter sends the response on that stream.
+
+   The responses are sent according to the flow control windows of the
+   peer. When several streams have data to send, the frames are scheduled
+   after their priority (RFC 9218), from the priority header of the request
+   and the PRIORITY_UPDATE frames: the most urgent streams first, the
+   incremental ones of the same urgency taking turns. The dependency tree of
+   RFC 7540, deprecated, is ignored. Server push is not used.
+
+   A ClientSession is the other end, the requests of a client multiplexed
+   on a connection. It does no I/O: the client feeds it the bytes received,
+   and sends the output it frames.
+*/
+
+#pragma once
+
+#include <pistache/async.h>
+#include <pistache/hpack.h>
+#include <pistache/http.h>
+#include <pistache/stream.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace Pistache::Http::Http2
+{
+
+    // What a client sends first on a connection (RFC 9113 3.4)
+    static constexpr std::string_view Preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+    static constexpr size_t FrameHeaderSize = 9;
+
+    enum class FrameType : uint8_t {
+        Data           = 0x0,
+        Headers        = 0x1,
+        Priority       = 0x2,
+        RstStream      = 0x3,
+        Settings       = 0x4,
+        PushPromise    = 0x5,
+        Ping           = 0x6,
+        GoAway         = 0x7,
+        WindowUpdate   = 0x8,
+        Continuation   = 0x9,
+        PriorityUpdate = 0x10,
+    };
+
+    namespace Flag
+    {
+        static constexpr uint8_t EndStream  = 0x1;
+        static constexpr uint8_t Ack        = 0x1;
+        static constexpr uint8_t EndHeaders = 0x4;
+        static constexpr uint8_t Padded     = 0x8;
+        static constexpr uint8_t Priority   = 0x20;
+    } // namespace Flag
+
+    enum class ErrorCode : uint32_t {
+        NoError            = 0x0,
+        ProtocolError      = 0x1,
+        InternalError      = 0x2,
+        FlowControlError   = 0x3,
+        SettingsTimeout    = 0x4,
+        StreamClosed       = 0x5,
+        FrameSizeError     = 0x6,
+        RefusedStream      = 0x7,
+        Cancel             = 0x8,
+        CompressionError   = 0x9,
+        ConnectError       = 0xa,
+        EnhanceYourCalm    = 0xb,
+        InadequateSecurity = 0xc,
+        Http11Required     = 0xd,
+    };
+
+    enum class SettingId : uint16_t {
+        HeaderTableSize       = 0x1,
+        EnablePush            = 0x2,
+        MaxConcurrentStreams  = 0x3,
+        InitialWindowSize     = 0x4,
+        MaxFrameSize          = 0x5,
+        MaxHeaderListSize     = 0x6,
+        NoRfc7540Priorities   = 0x9,
+    };
+
+    static constexpr uint32_t DefaultWindowSize    = 65535;
+    static constexpr uint32_t MaxWindowSize        = 0x7fffffff;
+    static constexpr uint32_t DefaultMaxFrameSize  = 16384;
+    static constexpr uint32_t MaxFrameSizeLimit    = 0xffffff;
+    static constexpr uint32_t DefaultMaxStreams    = 100;
+
+    // Whether the data received so far is the beginning of a connection
+    // preface, at least one byte is needed to tell
+    bool startsWithPreface(const char* data, size_t size);
+
+    // Priority of a response, parsed from the structured field of the
+    // priority header or of a PRIORITY_UPDATE frame (RFC 9218 4)
+    struct Priority
+    {
+        static constexpr uint8_t DefaultUrgency = 3;
+
+        uint8_t urgency  = DefaultUrgency;
+        bool incremental = false;
+
+        static Priority parse(std::string_view value);
+    };
+
+    // Part of the body of a response, files are read as their frames are
+    // sent
+    using BodyPart = std::variant<RawBuffer, FileBuffer, SharedBuffer>;
+
+    /* What the sessions of the servers and of the clients share: the frames
+     * of the connection itself, SETTINGS, PING and WINDOW_UPDATE, the header
+     * blocks and the framing of the output. The frames of the streams are
+     * handled by each session.
+     */
+    class SessionBase
+    {
+    public:
+        virtual ~SessionBase() = default;
+
+    protected:
+        // Header blocks are decoded once they are complete, the fragments
+        // of a block are held up to that size by default
+        static constexpr size_t MaxHeaderBlock = 64 * 1024;
+
+        // Cannot go on with the connection, answered with a GOAWAY
+        struct ConnectionError
+        {
+            ErrorCode code;
+            const char* reason;
+        };
+
+        explicit SessionBase(size_t maxHeaderBlock = MaxHeaderBlock);
+
+        SessionBase(const SessionBase&)            = delete;
+        SessionBase& operator=(const SessionBase&) = delete;
+
+        // Handles the complete frames of the input, throws a ConnectionError
+        void handleFrames();
+
+        // Whether a stream has not been opened yet
+        virtual bool isIdle(uint32_t stream) const = 0;
+        // Send window of an open stream, nullptr once it is closed
+        virtual int64_t* streamWindow(uint32_t stream) = 0;
+        // Applies a change of the initial window of the peer to the send
+        // windows of the open streams
+        virtual void adjustWindows(int64_t delta) = 0;
+        // Resets a stream because of the peer
+        virtual void failStream(uint32_t stream, ErrorCode code, const char* reason) = 0;
+
+        virtual void handleData(uint8_t flags, uint32_t stream, const char* payload, size_t length) = 0;
+        virtual void handleHeaderBlock()                                                            = 0;
+        virtual void handleRstStream(uint32_t stream, const char* payload, size_t length)           = 0;
+        virtual void handleGoAway(const char* payload, size_t length)                               = 0;
+        // The SETTINGS that are not about the framing or the windows
+        virtual void applySetting(SettingId id, uint32_t value) = 0;
+        // PRIORITY, PRIORITY_UPDATE and the frames that are not known, all
+        // ignored by default (RFC 9113 5.5)
+        virtual void handleOther(FrameType type, uint8_t flags, uint32_t stream,
+                                 const char* payload, size_t length);
+
+        void writeFrame(FrameType type, uint8_t flags, uint32_t stream, std::string_view payload);
+        void writeHead(uint32_t stream, const std::vector<Hpack::HeaderField>& head, bool end);
+        void writeGoAway(uint32_t lastStream, ErrorCode code);
+        // A WINDOW_UPDATE giving a window back its size, once half of it has
+        // been received
+        void replenishWindow(uint32_t stream, int64_t& window, int64_t size);
+
+        Hpack::Decoder decoder_;
+        Hpack::Encoder encoder_;
+
+        std::string input_;
+        std::string output_;
+        bool settingsReceived_ = false;
+        // A connection error has been answered with a GOAWAY
+        bool failed_ = false;
+
+        // Header block split over CONTINUATION frames
+        std::string headerBlock_;
+        uint32_t headerStream_ = 0;
+        uint8_t headerFlags_   = 0;
+
+        // SETTINGS of the peer
+        uint32_t peerInitialWindow_ = DefaultWindowSize;
+        uint32_t peerMaxFrameSize_  = DefaultMaxFrameSize;
+        int64_t sendWindow_         = DefaultWindowSize;
+
+    private:
+        void handleFrame(FrameType type, uint8_t flags, uint32_t stream,
+                         const char* payload, size_t length);
+        void handleHeaders(uint8_t flags, uint32_t stream, const char* payload, size_t length);
+        void handleContinuation(uint8_t flags, uint32_t stream, const char* payload, size_t length);
+        void handleSettings(uint8_t flags, uint32_t stream, const char* payload, size_t length);
+        void handleWindowUpdate(uint32_t stream, const char* payload, size_t length);
+
+        const size_t maxHeaderBlock_;
+    };
+
+    class Session : public SessionBase, public std::enable_shared_from_this<Session>
+    {
+    public:
+        // Output held in the session and in the transport, past which the
+        // session stops framing the bodies until some of it has been sent
+        static constexpr size_t MaxBuffered = 256 * 1024;
+
+        Session(Handler* handler, Tcp::Transport* transport,
+                const std::shared_ptr<Tcp::Peer>& peer,
+                const std::shared_ptr<Private::ConnectionState>& connection);
+        ~Session();
+
+        Session(const Session&)            = delete;
+        Session& operator=(const Session&) = delete;
+
+        // Sends the SETTINGS of the server, a server speaks first as well
+        void start();
+
+        // Bytes received from the peer, from the thread of the transport
+        void feed(const char* data, size_t size);
+
+        /* Sends the head of the response to a stream, with a first part of
+         * its body. With end, that part ends the response. The promise is
+         * resolved once the last frame of the response has been written, or
+         * of that part when the response does not end there.
+         *
+         * Those can be called from any thread, the frames are always framed
+         * from the thread of the transport.
+         */
+        Async::Promise<ssize_t> respond(uint32_t stream, std::vector<Hpack::HeaderField> head,
+                                        std::vector<BodyPart> body, bool end);
+
+        // More of the body of a response whose head has been sent
+        Async::Promise<ssize_t> sendData(uint32_t stream, std::vector<BodyPart> body, bool end);
+
+        // The header fields of a response, lowercased, without the fields
+        // that are specific to HTTP/1 connections
+        static std::vector<Hpack::HeaderField>
+        responseHead(const Message& response, std::optional<size_t> contentLength);
+
+        // Streams opened by the peer and not closed yet
+        size_t openStreams() const;
+
+        Tcp::Transport* transport() const { return transport_; }
+
+    private:
+        struct Pending
+        {
+            BodyPart part;
+            size_t offset = 0;
+            // Resolved once the last frame of the part has been written
+            std::shared_ptr<Async::Deferred<ssize_t>> done;
+            ssize_t total = 0;
+        };
+
+        struct Stream
+        {
+            uint32_t id = 0;
+
+            Request request;
+            // END_STREAM has been received, whether the request is complete
+            bool remoteClosed = false;
+            // A response, or an error, has been sent
+            bool responded = false;
+            // The body of the response ends with the last pending part
+            bool ending = false;
+            // A response to a HEAD request has no content
+            bool head = false;
+
+            int64_t sendWindow = DefaultWindowSize;
+            int64_t recvWindow = DefaultWindowSize;
+
+            std::optional<size_t> contentLength;
+            std::deque<Pending> pending;
+
+            Priority priority;
+        };
+
+        Async::Promise<ssize_t> queue(uint32_t stream, std::optional<std::vector<Hpack::HeaderField>> head,
+                                      std::vector<BodyPart> body, bool end);
+        void queueNow(uint32_t stream, std::optional<std::vector<Hpack::HeaderField>> head,
+                      std::vector<BodyPart> body, bool end,
+                      std::shared_ptr<Async::Deferred<ssize_t>> done);
+
+        bool isIdle(uint32_t stream) const override;
+        int64_t* streamWindow(uint32_t stream) override;
+        void adjustWindows(int64_t delta) override;
+        void failStream(uint32_t stream, ErrorCode code, const char* reason) override;
+
+        void handleData(uint8_t flags, uint32_t stream, const char* payload, size_t length) override;
+        void handleHeaderBlock() override;
+        void handleRstStream(uint32_t stream, const char* payload, size_t length) override;
+        void handleGoAway(const char* payload, size_t length) override;
+        void applySetting(SettingId id, uint32_t value) override;
+        void handleOther(FrameType type, uint8_t flags, uint32_t stream,
+                         const char* payload, size_t length) override;
+        void handlePriorityUpdate(uint32_t stream, const char* payload, size_t length);
+
+        // Fills the request of a new stream, false when it is malformed
+        bool buildRequest(Stream& stream, std::vector<Hpack::HeaderField>& fields);
+        void endRequest(uint32_t stream);
+        void dispatch(uint32_t stream);
+
+        // Answers a stream with an error of the server, the response of a
+        // handler having failed
+        void respondError(uint32_t stream, Code code, const std::string& body);
+
+        void resetStream(uint32_t stream, ErrorCode code);
+        void closeStream(std::map<uint32_t, Stream>::iterator it);
+        void goAway(ErrorCode code);
+
+        // WINDOW_UPDATE frames for what has been received, of the connection
+        // and of the stream when there is one
+        void replenish(Stream* stream);
+
+        // Frames the bodies waiting for the flow control windows
+        void pump();
+        std::map<uint32_t, Stream>::iterator nextStream();
+        // Frames the part at the front of the stream, false when a file
+        // could not be read
+        bool sendFrame(Stream& stream);
+        // Hands the output to the transport
+        void flushOutput();
+
+        void updateIdle();
+
+        Handler* handler_;
+        Tcp::Transport* transport_;
+        std::weak_ptr<Tcp::Peer> peer_;
+        std::weak_ptr<Private::ConnectionState> connection_;
+        Fd fd_;
+
+        bool prefaceReceived_ = false;
+
+        std::map<uint32_t, Stream> streams_;
+        uint32_t lastStreamId_ = 0;
+        // Stream that sent the last DATA frame, the incremental streams
+        // take turns after it
+        uint32_t lastServed_ = 0;
+        // PRIORITY_UPDATE frames received before their stream was opened
+        std::map<uint32_t, Priority> earlyPriorities_;
+
+        int64_t recvWindow_ = DefaultWindowSize;
+
+        // Whether frames are being handled, the output is then flushed once
+        // they all have been
+        bool handling_ = false;
+
+        size_t inFlight_ = 0;
+        // To resolve once the output framed so far has been written
+        std::vector<std::pair<std::shared_ptr<Async::Deferred<ssize_t>>, ssize_t>> written_;
+    };
+
+    class ClientSession : public SessionBase
+    {
+    public:
+        // Output held in the session, past which the bodies of the requests
+        // are framed once some of it has been sent
+        static constexpr size_t MaxBuffered = 256 * 1024;
+        // Receive windows advertised to the server, a paused stream holds
+        // the window of its stream only
+        static constexpr uint32_t StreamWindow     = 1024 * 1024;
+        static constexpr uint32_t ConnectionWindow = 16 * 1024 * 1024;
+
+        /* What happens to the streams, called from feed(). A stream ends
+         * with either onResponse() or onReset(), never both. When onHead()
+         * returns true, the body of the response is handed to onData() as
+         * it arrives instead of being held in the response.
+         */
+        struct Callbacks
+        {
+            std::function<bool(uint32_t, const Response&)> onHead;
+            std::function<void(uint32_t, std::string_view)> onData;
+            std::function<void(uint32_t, Response)> onResponse;
+            std::function<void(uint32_t, const char*)> onReset;
+        };
+
+        ClientSession(Callbacks callbacks, size_t maxResponseSize, size_t maxStreams = DefaultMaxStreams);
+
+        ClientSession(const ClientSession&)            = delete;
+        ClientSession& operator=(const ClientSession&) = delete;
+
+        // Frames the connection preface and the SETTINGS of the client
+        void start();
+
+        /* Opens a stream for a request, head holding its pseudo-header
+         * fields first. Its body is framed as the windows of the server
+         * allow. Returns 0 when no stream can be opened anymore, the server
+         * going away.
+         */
+        uint32_t submit(std::vector<Hpack::HeaderField> head, std::string body);
+
+        // Resets a stream, nothing is called for it anymore
+        void cancel(uint32_t stream, ErrorCode code = ErrorCode::Cancel);
+
+        // Stops giving the window of a stream back to the server, which
+        // stops sending its body once the window is spent
+        void pause(uint32_t stream);
+        void resume(uint32_t stream);
+
+        // Bytes received from the server, false once the connection failed
+        bool feed(const char* data, size_t size);
+
+        // Frames to send, and how many of them have been sent
+        std::string_view output() const { return output_; }
+        void consume(size_t size);
+
+        // Streams opened and not ended yet
+        size_t openStreams() const { return streams_.size(); }
+        // Streams the server accepts at once, up to the ones asked for
+        size_t maxStreams() const;
+
+        // The server is going away or the connection failed, no stream can
+        // be opened anymore
+        bool isClosed() const { return goingAway_ || failed_; }
+        bool isFailed() const { return failed_; }
+        const std::string& error() const { return error_; }
+
+    private:
+        struct Stream
+        {
+            uint32_t id = 0;
+
+            Response response;
+            // The final head has been received, the informational ones are
+            // skipped
+            bool headReceived = false;
+            bool streamed     = false;
+            bool paused       = false;
+
+            int64_t sendWindow = DefaultWindowSize;
+            int64_t recvWindow = StreamWindow;
+
+            // Body of the request, and what has been framed of it
+            std::string body;
+            size_t sent = 0;
+            bool ended  = false;
+        };
+
+        bool isIdle(uint32_t stream) const override;
+        int64_t* streamWindow(uint32_t stream) override;
+        void adjustWindows(int64_t delta) override;
+        // Resets a stream because of the server, and tells why
+        void failStream(uint32_t stream, ErrorCode code, const char* reason) override;
+
+        void handleData(uint8_t flags, uint32_t stream, const char* payload, size_t length) override;
+        void handleHeaderBlock() override;
+        void handleRstStream(uint32_t stream, const char* payload, size_t length) override;
+        void handleGoAway(const char* payload, size_t length) override;
+        void applySetting(SettingId id, uint32_t value) override;
+
+        // Fills the head of the response of a stream, false when it is
+        // malformed
+        bool buildResponse(Stream& stream, std::vector<Hpack::HeaderField>& fields);
+        void endStream(std::map<uint32_t, Stream>::iterator it);
+
+        void replenish(Stream* stream);
+
+        // Frames the bodies of the requests the windows allow
+        void pump();
+
+        Callbacks callbacks_;
+        const size_t maxResponseSize_;
+        const size_t maxStreams_;
+
+        std::map<uint32_t, Stream> streams_;
+        uint32_t nextStreamId_ = 1;
+
+        // Unlimited until the server tells
+        uint32_t peerMaxStreams_ = UINT32_MAX;
+        int64_t recvWindow_      = ConnectionWindow;
+
+        bool goingAway_ = false;
+        std::string error_;
+    };
+
+} // namespace Pistache::Http::Http2
@@ -173,11 +173,15 @@ namespace Pistache::Http
 
     enum class Version {
         Http10, // HTTP/1.0
-        Http11 // HTTP/1.1
+        Http11, // HTTP/1.1
+        Http2 // HTTP/2
     };
 
     enum class ConnectionControl { Close,
                                    KeepAlive,
+                                   // Asks to switch protocols, along with an
+                                   // Upgrade header
+                                   Upgrade,
                                    Ext };
 
     enum class Expectation { Continue,
@@ -68,6 +68,8 @@ namespace Pistache::Http::Header
                           Deflate,
                           Identity,
                           Chunked,
+                          Br,
+                          Zstd,
                           Unknown };
 
     const char* encodingString(Encoding encoding);
@@ -492,12 +494,62 @@ namespace Pistache::Http::Header
     public:
         NAME("Date")
 
+        // Without a date, the time it is written at, from a date formatted
+        // once a second
         Date()
             : fullDate_()
+            , current_(true)
         { }
 
         explicit Date(const FullDate& date)
             : fullDate_(date)
+            , current_(false)
+        { }
+
+        void parse(const std::string& str) override;
+        void write(std::ostream& os) const override;
+
+        FullDate fullDate() const;
+
+    private:
+        FullDate fullDate_;
+        bool current_;
+    };
+
+    // Validator of a representation, written and read with its quotes
+    class ETag : public Header
+    {
+    public:
+        NAME("ETag")
+
+        ETag()
+            : tag_()
+        { }
+
+        explicit ETag(std::string tag)
+            : tag_(std::move(tag))
+        { }
+
+        void parse(const std::string& data) override;
+        void write(std::ostream& os) const override;
+
+        std::string tag() const { return tag_; }
+
+    private:
+        std::string tag_;
+    };
+
+    class LastModified : public Header
+    {
+    public:
+        NAME("Last-Modified")
+
+        LastModified()
+            : fullDate_()
+        { }
+
+        explicit LastModified(const FullDate& date)
+            : fullDate_(date)
         { }
 
         void parse(const std::string& str) override;
@@ -628,19 +680,100 @@ namespace Pistache::Http::Header
         std::string ua_;
     };
 
-#define CUSTOM_HEADER(header_name)                                                  \
-    class header_name : public Pistache::Http::Header::Header                       \
+    // Request headers a response depends on, for the caches in between
+    class Vary : public Header
+    {
+    public:
+        NAME("Vary")
+
+        Vary()
+            : fields_()
+        { }
+
+        explicit Vary(std::string fields)
+            : fields_(std::move(fields))
+        { }
+
+        void parse(const std::string& data) override;
+        void write(std::ostream& os) const override;
+
+        std::string fields() const { return fields_; }
+
+    private:
+        std::string fields_;
+    };
+
+    class AcceptRanges : public Header
+    {
+    public:
+        NAME("Accept-Ranges")
+
+        AcceptRanges()
+            : unit_()
+        { }
+
+        explicit AcceptRanges(std::string unit)
+            : unit_(std::move(unit))
+        { }
+
+        void parse(const std::string& data) override;
+        void write(std::ostream& os) const override;
+
+        std::string unit() const { return unit_; }
+
+    private:
+        std::string unit_;
+    };
+
+    // Range of bytes carried by a 206 response, or the size of the file when
+    // the requested ranges could not be satisfied (RFC 9110 14.4)
+    class ContentRange : public Header
+    {
+    public:
+        NAME("Content-Range")
+
+        ContentRange() = default;
+
+        ContentRange(size_t first, size_t last, size_t length)
+            : satisfied_(true)
+            , first_(first)
+            , last_(last)
+            , length_(length)
+        { }
+
+        // Sent along with a 416
+        static ContentRange unsatisfied(size_t length);
+
+        void parse(const std::string& data) override;
+        void write(std::ostream& os) const override;
+
+        bool satisfied() const { return satisfied_; }
+        size_t first() const { return first_; }
+        // Inclusive, like in the header
+        size_t last() const { return last_; }
+        size_t length() const { return length_; }
+
+    private:
+        bool satisfied_ = false;
+        size_t first_   = 0;
+        size_t last_    = 0;
+        size_t length_  = 0;
+    };
+
+// Like CUSTOM_HEADER, for names that are not identifiers
+#define NAMED_CUSTOM_HEADER(header_class, header_name)                              \
+    class header_class : public Pistache::Http::Header::Header                      \
     {                                                                               \
     public:                                                                         \
-        NAME(#header_name)                                                          \
+        NAME(header_name)                                                           \
                                                                                     \
-        header_name() = default;                                                    \
+        header_class() = default;                                                   \
                                                                                     \
-        explicit header_name(const char* value)                                     \
+        explicit header_class(const char* value)                                    \
             : value_ { value }                                                      \
         { }                                                                         \
                                                                                     \
-        explicit header_name(std::string value)                                     \
+        explicit header_class(std::string value)                                    \
             : value_(std::move(value))                                              \
         { }                                                                         \
                                                                                     \
@@ -654,6 +787,8 @@ namespace Pistache::Http::Header
         std::string value_;                                                         \
     };
 
+#define CUSTOM_HEADER(header_name) NAMED_CUSTOM_HEADER(header_name, #header_name)
+
     class Raw
     {
     public:
@@ -669,8 +804,8 @@ namespace Pistache::Http::Header
         Raw(Raw&& other) = default;
         Raw& operator=(Raw&& other) = default;
 
-        std::string name() const { return name_; }
-        std::string value() const { return value_; }
+        const std::string& name() const { return name_; }
+        const std::string& value() const { return value_; }
 
     private:
         std::string name_;
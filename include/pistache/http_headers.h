@@ -13,8 +13,14 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <stdexcept>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -48,42 +54,139 @@ namespace Pistache::Http::Header
         };
     };
 
+    namespace detail
+    {
+        // Typed headers of the library. Each one has a slot of its own in a
+        // Collection, found at compile time from the Name of the header type
+        inline constexpr std::string_view KnownHeaders[] = {
+            "Accept",
+            "Access-Control-Allow-Origin",
+            "Access-Control-Allow-Headers",
+            "Access-Control-Expose-Headers",
+            "Access-Control-Allow-Methods",
+            "Allow",
+            "Authorization",
+            "Cache-Control",
+            "Connection",
+            "Content-Encoding",
+            "Content-Length",
+            "Content-Type",
+            "Date",
+            "Expect",
+            "Host",
+            "Location",
+            "Server",
+            "Transfer-Encoding",
+            "User-Agent",
+        };
+
+        inline constexpr size_t KnownHeadersCount = std::size(KnownHeaders);
+
+        constexpr size_t knownSlot(std::string_view name)
+        {
+            for (size_t i = 0; i < KnownHeadersCount; ++i)
+            {
+                if (KnownHeaders[i] == name)
+                    return i;
+            }
+
+            return KnownHeadersCount;
+        }
+
+        // Same as above ignoring the case, for the names received on the wire
+        size_t knownSlotIgnoreCase(std::string_view name);
+    } // namespace detail
+
+    // Raw headers in the order they were added. A request carries a handful of
+    // them, a case-insensitive scan is cheaper than hashing the lowercased
+    // name and does not allocate a node per header
+    class RawList
+    {
+    public:
+        using value_type     = std::pair<std::string, Raw>;
+        using const_iterator = std::vector<value_type>::const_iterator;
+
+        const_iterator begin() const { return entries_.begin(); }
+        const_iterator end() const { return entries_.end(); }
+
+        size_t size() const { return entries_.size(); }
+        bool empty() const { return entries_.empty(); }
+
+        const_iterator find(std::string_view name) const;
+
+        // The first header of a given name wins, like an insert in a map
+        bool insert(const Raw& raw);
+        bool erase(std::string_view name);
+
+        // Keeps the storage for the next message
+        void clear() { entries_.clear(); }
+
+    private:
+        std::vector<value_type> entries_;
+    };
+
     class Collection
     {
     public:
         Collection()
-            : headers()
+            : known_()
+            , deferred_(0)
+            , others_()
             , rawHeaders()
         { }
 
+        Collection(const Collection& other);
+        Collection(Collection&& other) noexcept;
+        Collection& operator=(const Collection& other);
+        Collection& operator=(Collection&& other) noexcept;
+
         template <typename H>
         typename std::enable_if<IsHeader<H>::value, std::shared_ptr<const H>>::type
         get() const
         {
-            return std::static_pointer_cast<const H>(get(H::Name));
+            auto header = tryGet<H>();
+            if (!header)
+                throw std::runtime_error("Could not find header");
+            return header;
         }
         template <typename H>
         typename std::enable_if<IsHeader<H>::value, std::shared_ptr<H>>::type get()
         {
-            return std::static_pointer_cast<H>(get(H::Name));
+            auto header = tryGet<H>();
+            if (!header)
+                throw std::runtime_error("Could not find header");
+            return header;
         }
 
         template <typename H>
         typename std::enable_if<IsHeader<H>::value, std::shared_ptr<const H>>::type
         tryGet() const
         {
-            return std::static_pointer_cast<const H>(tryGet(H::Name));
+            constexpr size_t Slot = detail::knownSlot(H::Name);
+            if constexpr (Slot < detail::KnownHeadersCount)
+                return std::static_pointer_cast<const H>(slot(Slot));
+            else
+                return std::static_pointer_cast<const H>(tryGet(H::Name));
         }
         template <typename H>
         typename std::enable_if<IsHeader<H>::value, std::shared_ptr<H>>::type
         tryGet()
         {
-            return std::static_pointer_cast<H>(tryGet(H::Name));
+            constexpr size_t Slot = detail::knownSlot(H::Name);
+            if constexpr (Slot < detail::KnownHeadersCount)
+                return std::static_pointer_cast<H>(slot(Slot));
+            else
+                return std::static_pointer_cast<H>(tryGet(H::Name));
         }
 
         Collection& add(const std::shared_ptr<Header>& header);
         Collection& addRaw(const Raw& raw);
 
+        // Adds a raw header. When it is one of the typed headers of the
+        // library, it only is parsed into its typed form on first access, a
+        // malformed value then throws from get() / tryGet().
+        Collection& addDeferred(const Raw& raw);
+
         template <typename H, typename... Args>
         typename std::enable_if<IsHeader<H>::value, Collection&>::type
         add(Args&&... args)
@@ -108,33 +211,91 @@ namespace Pistache::Http::Header
         template <typename H>
         typename std::enable_if<IsHeader<H>::value, bool>::type has() const
         {
-            return has(H::Name);
+            constexpr size_t Slot = detail::knownSlot(H::Name);
+            if constexpr (Slot < detail::KnownHeadersCount)
+                return known_[Slot] != nullptr || isDeferred(Slot);
+            else
+                return has(H::Name);
         }
         bool has(const std::string& name) const;
 
         std::vector<std::shared_ptr<Header>> list() const;
 
-        const std::unordered_map<std::string, Raw, LowercaseHash, LowercaseEqual>&
-        rawList() const
+        // The headers of list(), in the same order, without copying them
+        template <typename Func>
+        void forEach(Func func) const
+        {
+            for (size_t i = 0; i < known_.size(); ++i)
+            {
+                if (isDeferred(i))
+                    func(*materialize(i));
+                else if (known_[i])
+                    func(*known_[i]);
+            }
+            for (const auto& header : others_)
+                func(*header);
+        }
+
+        /* The headers as they are written to a message: the typed ones,
+         * then the raw ones that no typed header stands for. A deferred
+         * header goes out as it was received, without being parsed.
+         */
+        template <typename Typed, typename RawFunc>
+        void forEachOnWire(Typed typed, RawFunc raw) const
         {
-            return rawHeaders;
+            for (size_t i = 0; i < known_.size(); ++i)
+            {
+                if (known_[i] && !isDeferred(i))
+                    typed(*known_[i]);
+            }
+            for (const auto& header : others_)
+                typed(*header);
+            for (const auto& entry : rawHeaders)
+            {
+                if (!hasTyped(entry.first))
+                    raw(entry.second);
+            }
         }
 
+        // Every header as it was received, the typed ones included, whether
+        // they are parsed up front or on first access
+        const RawList& rawList() const { return rawHeaders; }
+
         bool remove(const std::string& name);
 
         void clear();
 
     private:
-        std::pair<bool, std::shared_ptr<Header>>
-        getImpl(const std::string& name) const;
-
-        std::unordered_map<std::string, std::shared_ptr<Header>, LowercaseHash,
-                           LowercaseEqual>
-            headers;
-        std::unordered_map<std::string, Raw, LowercaseHash, LowercaseEqual>
-            rawHeaders;
+        std::shared_ptr<Header> getImpl(std::string_view name) const;
+        // A typed header of that name is set, not a deferred one
+        bool hasTyped(std::string_view name) const;
+
+        static_assert(detail::KnownHeadersCount <= 32, "The deferred slots are bits of a uint32_t");
+
+        bool isDeferred(size_t index) const
+        {
+            return (deferred_.load(std::memory_order_acquire) & (uint32_t(1) << index)) != 0;
+        }
+        std::shared_ptr<Header> slot(size_t index) const
+        {
+            return isDeferred(index) ? materialize(index) : known_[index];
+        }
+        // Parses a deferred slot under a lock, the const accessors of a
+        // request may be called from several threads at once. The slot is
+        // only read without the lock once its bit has been cleared.
+        std::shared_ptr<Header> materialize(size_t index) const;
+
+        // Typed headers of the library, by slot, then the other ones. A
+        // deferred slot still has to be parsed from its raw header.
+        mutable std::array<std::shared_ptr<Header>, detail::KnownHeadersCount> known_;
+        mutable std::atomic<uint32_t> deferred_;
+        std::vector<std::shared_ptr<Header>> others_;
+        RawList rawHeaders;
     };
 
+    // The typed headers of the library are always registered and looked up
+    // through a perfect hash built at compile time. The map only holds the
+    // headers registered at runtime.
     class Registry
     {
 
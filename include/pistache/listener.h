@@ -21,10 +21,15 @@
 #include <pistache/reactor.h>
 #include <pistache/ssl_wrappers.h>
 #include <pistache/tcp.h>
+#include <pistache/tls_session.h>
 
 #include <sys/resource.h>
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
 #include <thread>
 #include <vector>
 
@@ -38,8 +43,50 @@ namespace Pistache::Tcp
     class Peer;
     class Transport;
 
+    // How the listener picks the worker that will serve a new connection
+    enum class DispatchPolicy {
+        // Historical behaviour, spreads peers by their file descriptor
+        FdModulo,
+        RoundRobin,
+        // Worker serving the fewest peers
+        LeastConnections,
+        // Least busy of two randomly picked workers, cheaper than a full scan
+        // while avoiding herding when workers have similar peer counts
+        PowerOfTwoChoices,
+        // Worker with the lowest CPU usage, as reported by the last
+        // requestLoad(). Falls back to LeastConnections until a load has
+        // been computed
+        LeastLoaded
+    };
+
     void setSocketOptions(Fd fd, Flags<Options> options);
 
+    /* Worker threads shared by the listeners of several endpoints, such as a
+     * public, an admin and a metrics port, instead of a set each. Every
+     * listener adds its own transport to the workers, with its own handler
+     * and options, and keeps its own accept thread. The workers start with
+     * the first listener that runs, and stop with the pool.
+     */
+    class WorkerPool
+    {
+    public:
+        explicit WorkerPool(const Aio::AsyncContext& context);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&)            = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        // Starts the workers, the calls after the first one do nothing
+        void start();
+        void shutdown();
+
+        Aio::Reactor& reactor() { return reactor_; }
+
+    private:
+        Aio::Reactor reactor_;
+        std::once_flag started_;
+    };
+
     class Listener
     {
     public:
@@ -66,11 +113,88 @@ namespace Pistache::Tcp
                   PISTACHE_STRING_LOGGER_T logger = PISTACHE_NULL_STRING_LOGGER);
 
         void setTransportFactory(TransportFactory factory);
+        void setPollingBackend(Polling::Backend backend);
+
+        // Give every worker its own SO_REUSEPORT listening socket, connections
+        // are then accepted by the workers instead of the accept thread
+        void setAcceptPerWorker(bool value);
+
+        void setDispatchPolicy(DispatchPolicy policy);
+
+        // Peers a worker serves at most. Once every worker is full, no
+        // connection is accepted until a peer goes away: the new ones wait in
+        // the backlog of the listening socket. Zero, the default, does not
+        // bound them
+        void setMaxConnections(size_t perWorker);
+
+        // Threads accepting the connections, each one polling the listening
+        // socket with EPOLLEXCLUSIVE so that a connection wakes up only one
+        // of them. Ignored in acceptPerWorker mode. Must be called before
+        // bind()
+        void setAcceptThreads(size_t count);
+
+        // See Aio::AsyncContext::busyPoll(), must be called before bind()
+        void setBusyPoll(std::chrono::microseconds spin);
+
+        // Pin every worker that was not explicitly pinned to a cpu of its own,
+        // spreading the workers over the NUMA nodes, and hand new peers to a
+        // worker of the node that received their packets
+        void setNumaAware(bool value);
+
+        // Pin every worker that was not explicitly pinned to a cpu of its own,
+        // without changing how new peers are handed to the workers
+        void setPinWorkers(bool value);
+
+        // Serve from the workers of the pool rather than from workers of its
+        // own, the workers count, name, pinning, polling backend and busy
+        // polling are then the ones of the pool. Shutting the listener down
+        // closes its connections and leaves the workers running. Must be
+        // called before bind(), not in acceptPerWorker mode
+        void setWorkerPool(std::shared_ptr<WorkerPool> pool);
+
+        // Offer HTTP/2 to the TLS clients with ALPN, next to HTTP/1.1
+        void setHttp2(bool value);
         void setHandler(const std::shared_ptr<Handler>& handler);
 
         void bind();
         void bind(const Address& address);
 
+        /* Serves from a socket that already listens instead of binding the
+         * address: one passed by systemd socket activation, see
+         * activationSockets(), or the one of the previous process, see
+         * sendListenSocket(). The connections waiting in its backlog are
+         * accepted by this listener, none is refused while the processes
+         * take turns. Must be called before bind(), the address of the
+         * listener becomes the one of the socket.
+         */
+        void adoptListenSocket(Fd fd);
+
+        // The listening sockets passed by systemd socket activation, as
+        // sd_listen_fds(3) would return them. Empty when the process was
+        // not started that way
+        static std::vector<Fd> activationSockets();
+
+        // Hands the listening socket to another process with SCM_RIGHTS, over
+        // a connected Unix domain socket. Both processes then accept from it
+        // until this one drains. Must be called after bind()
+        void sendListenSocket(Fd channel);
+        // The listening socket sent by sendListenSocket(), for
+        // adoptListenSocket()
+        static Fd receiveListenSocket(Fd channel);
+
+        /* Stops accepting, and lets the workers finish what they are doing:
+         * every connection is closed once it is idle, between two requests,
+         * the ones that sent nothing yet included. Streams, HTTP/2 and
+         * upgraded connections stay until they end, or until shutdown(). The
+         * connections left in the backlog go to the process the socket was
+         * handed to, with acceptPerWorker() the ones in the backlogs of the
+         * sockets of the workers are lost. Can not be undone.
+         */
+        void drain();
+        bool isDraining() const { return draining_.load(std::memory_order_relaxed); }
+        // Peers of all the workers, zero once drained
+        size_t connectionCount();
+
         bool isBound() const;
         Port getPort() const;
 
@@ -84,6 +208,7 @@ namespace Pistache::Tcp
         Options options() const;
         Address address() const;
 
+        // Must be called before bind(), which starts the workers
         void pinWorker(size_t worker, const CpuSet& set);
 
         void setupSSL(const std::string& cert_path, const std::string& key_path,
@@ -91,8 +216,24 @@ namespace Pistache::Tcp
                       std::chrono::milliseconds sslHandshakeTimeout = Const::DefaultSSLHandshakeTimeout);
         void setupSSLAuth(const std::string& ca_file, const std::string& ca_path,
                           int (*cb)(int, void*));
+        void setupSSLSessions(std::shared_ptr<TlsSessionStore> store,
+                              std::chrono::seconds timeout,
+                              std::chrono::seconds ticketKeyRotation);
+        void setupKTLS();
+        TlsHandshakes tlsHandshakes();
         std::vector<std::shared_ptr<Tcp::Peer>> getAllPeer();
 
+        // Counters of the event loop and of the transport of a worker
+        struct WorkerStats
+        {
+            Aio::LoopStats loop;
+            TransportStats transport;
+        };
+
+        // One entry per worker, read from the counters the workers keep up
+        // to date instead of asking them as requestLoad() does
+        std::vector<WorkerStats> workerStats();
+
     private:
         Address addr_;
         int listen_fd = -1;
@@ -109,22 +250,93 @@ namespace Pistache::Tcp
 
         Aio::Reactor reactor_;
         Aio::Reactor::Key transportKey;
+        std::shared_ptr<WorkerPool> workerPool_;
+
+        // The one of the pool, if any
+        Aio::Reactor& reactor() { return workerPool_ ? workerPool_->reactor() : reactor_; }
 
         TransportFactory transportFactory_;
 
         TransportFactory defaultTransportFactory() const;
 
-        void handleNewConnection();
-        int acceptConnection(struct sockaddr_storage& peer_addr) const;
+        // Polls the listening socket from one of the accept threads
+        struct AcceptLoop
+        {
+            Polling::Epoll poller;
+            NotifyFd shutdownFd;
+            std::thread thread;
+        };
+
+        // The accept threads after the one running run()
+        size_t acceptThreads_ = 1;
+        std::vector<std::unique_ptr<AcceptLoop>> acceptLoops_;
+
+        void acceptLoop(Polling::Epoll& poller, const NotifyFd& shutdown);
+        void watchListenSocket(Polling::Epoll& poller);
+
+        // Accepts the pending connections, a batch at most. Returns false
+        // once every worker is full, the socket is then left alone
+        bool handleNewConnection();
+        std::shared_ptr<Peer> acceptPeer(Fd fd);
+        int acceptConnection(Fd fd, struct sockaddr_storage& peer_addr) const;
+        // Binds and listens on the first socket of the address that works
+        Fd bindTcpSocket(const Address& address);
+        // Watches the listening socket, then starts the workers
+        void bindListenSocket(Fd fd);
+        void bindWorkerSockets(Fd fd);
         void dispatchPeer(const std::shared_ptr<Peer>& peer);
 
         bool useSSL_            = false;
         ssl::SSLCtxPtr ssl_ctx_ = nullptr;
 
+        bool http2_ = false;
+        void setupALPN();
+
         PISTACHE_STRING_LOGGER_T logger_ = PISTACHE_NULL_STRING_LOGGER;
 
         // This should be moved after "ssl_ctx_" in the next ABI change
         std::chrono::milliseconds sslHandshakeTimeout_ = Const::DefaultSSLHandshakeTimeout;
+
+        Polling::Backend backend_ = Polling::Backend::Epoll;
+
+        bool acceptPerWorker_ = false;
+        std::vector<Fd> workerListenFds_;
+
+        // Set by adoptListenSocket() until bind()
+        Fd adoptedFd_ = -1;
+        // The file of a Unix domain socket is removed along with the
+        // listener, unless the socket came from or went to another process
+        bool ownsSocketFile_ = true;
+        std::atomic<bool> draining_ { false };
+
+        DispatchPolicy dispatchPolicy_ = DispatchPolicy::FdModulo;
+        // Shared by the accept threads
+        std::atomic<size_t> nextWorker_ { 0 };
+        std::mutex dispatchRngLock_;
+        std::minstd_rand dispatchRng_;
+
+        std::mutex workersLoadLock_;
+        std::vector<double> workersLoad_;
+
+        bool numaAware_  = false;
+        bool pinWorkers_ = false;
+        std::vector<CpuSet> workerAffinity_;
+        // Node of every worker, -1 when its cpus are not all on the same one
+        std::vector<int> workerNodes_;
+        std::vector<int> cpuNodes_;
+
+        void assignWorkerCpus();
+
+        size_t maxConnections_ = 0;
+        std::chrono::microseconds busyPoll_ { 0 };
+
+        bool hasRoom(const std::vector<std::shared_ptr<Aio::Handler>>& handlers) const;
+
+        size_t pickWorker(const std::shared_ptr<Peer>& peer,
+                          const std::vector<std::shared_ptr<Aio::Handler>>& handlers);
+        std::optional<size_t>
+        pickLocalWorker(const std::shared_ptr<Peer>& peer,
+                        const std::vector<std::shared_ptr<Aio::Handler>>& handlers);
     };
 
 } // namespace Pistache::Tcp
@@ -20,9 +20,9 @@
     {                                                                      \
         if (logger && logger->isEnabledFor(::Pistache::Log::Level::FATAL)) \
         {                                                                  \
-            std::ostringstream oss_;                                       \
-            oss_ << message;                                               \
-            logger->log(::Pistache::Log::Level::FATAL, oss_.str());        \
+            ::Pistache::Log::MessageBuilder builder_;                      \
+            builder_ << message;                                           \
+            logger->log(::Pistache::Log::Level::FATAL, builder_.str());    \
         }                                                                  \
     } while (0)
 #endif
@@ -33,9 +33,9 @@
     {                                                                      \
         if (logger && logger->isEnabledFor(::Pistache::Log::Level::ERROR)) \
         {                                                                  \
-            std::ostringstream oss_;                                       \
-            oss_ << message;                                               \
-            logger->log(::Pistache::Log::Level::ERROR, oss_.str());        \
+            ::Pistache::Log::MessageBuilder builder_;                      \
+            builder_ << message;                                           \
+            logger->log(::Pistache::Log::Level::ERROR, builder_.str());    \
         }                                                                  \
     } while (0)
 #endif
@@ -46,9 +46,9 @@
     {                                                                     \
         if (logger && logger->isEnabledFor(::Pistache::Log::Level::WARN)) \
         {                                                                 \
-            std::ostringstream oss_;                                      \
-            oss_ << message;                                              \
-            logger->log(::Pistache::Log::Level::WARN, oss_.str());        \
+            ::Pistache::Log::MessageBuilder builder_;                     \
+            builder_ << message;                                          \
+            logger->log(::Pistache::Log::Level::WARN, builder_.str());    \
         }                                                                 \
     } while (0)
 #endif
@@ -59,9 +59,9 @@
     {                                                                     \
         if (logger && logger->isEnabledFor(::Pistache::Log::Level::INFO)) \
         {                                                                 \
-            std::ostringstream oss_;                                      \
-            oss_ << message;                                              \
-            logger->log(::Pistache::Log::Level::INFO, oss_.str());        \
+            ::Pistache::Log::MessageBuilder builder_;                     \
+            builder_ << message;                                          \
+            logger->log(::Pistache::Log::Level::INFO, builder_.str());    \
         }                                                                 \
     } while (0)
 #endif
@@ -72,9 +72,9 @@
     {                                                                      \
         if (logger && logger->isEnabledFor(::Pistache::Log::Level::DEBUG)) \
         {                                                                  \
-            std::ostringstream oss_;                                       \
-            oss_ << message;                                               \
-            logger->log(::Pistache::Log::Level::DEBUG, oss_.str());        \
+            ::Pistache::Log::MessageBuilder builder_;                      \
+            builder_ << message;                                           \
+            logger->log(::Pistache::Log::Level::DEBUG, builder_.str());    \
         }                                                                  \
     } while (0)
 #endif
@@ -86,21 +86,21 @@
     {                                                                      \
         if (logger && logger->isEnabledFor(::Pistache::Log::Level::TRACE)) \
         {                                                                  \
-            std::ostringstream oss_;                                       \
-            oss_ << message;                                               \
-            logger->log(::Pistache::Log::Level::TRACE, oss_.str());        \
+            ::Pistache::Log::MessageBuilder builder_;                      \
+            builder_ << message;                                           \
+            logger->log(::Pistache::Log::Level::TRACE, builder_.str());    \
         }                                                                  \
     } while (0)
 #else
-#define PISTACHE_LOG_STRING_TRACE(logger, message)                  \
-    do                                                              \
-    {                                                               \
-        if (0)                                                      \
-        {                                                           \
-            std::ostringstream oss_;                                \
-            oss_ << message;                                        \
-            logger->log(::Pistache::Log::Level::TRACE, oss_.str()); \
-        }                                                           \
+#define PISTACHE_LOG_STRING_TRACE(logger, message)                      \
+    do                                                                  \
+    {                                                                   \
+        if (0)                                                          \
+        {                                                               \
+            ::Pistache::Log::MessageBuilder builder_;                   \
+            builder_ << message;                                        \
+            logger->log(::Pistache::Log::Level::TRACE, builder_.str()); \
+        }                                                               \
     } while (0)
 #endif
 #endif
@@ -10,7 +10,17 @@
 #include <atomic>
 #include <stdexcept>
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include <sys/eventfd.h>
 #include <unistd.h>
 
@@ -353,6 +363,240 @@ namespace Pistache
         int event_fd;
     };
 
+    /*
+ * A bounded MPSC queue with the same interface as PollableQueue, for the
+ queues that are fed from other threads on a hot path.
+
+ * The entries live in a ring of preallocated slots, so a push does not
+ allocate, and the eventfd only is written when the queue goes from empty to
+ non-empty. A push into a full ring is not refused: it goes to an overflow
+ list, and the following pushes go there too until the consumer caught up, so
+ the entries of a producer are popped in the order they were pushed.
+
+ * The ring uses the sequence numbers of the bounded MPMC queue below
+*/
+    template <typename T, size_t Size = 1024>
+    class PollableRing
+    {
+        static_assert(Size >= 2 && ((Size & (Size - 1)) == 0),
+                      "The size must be a power of 2");
+        static constexpr size_t Mask = Size - 1;
+
+    public:
+        PollableRing()
+            : cells_()
+            , enqueueIndex(0)
+            , dequeueIndex(0)
+            , signaled(false)
+            , overflowing(false)
+            , event_fd(-1)
+        {
+            for (size_t i = 0; i < Size; ++i)
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        PollableRing(const PollableRing& other)            = delete;
+        PollableRing& operator=(const PollableRing& other) = delete;
+
+        ~PollableRing()
+        {
+            while (dequeue())
+                ;
+
+            if (event_fd != -1)
+                close(event_fd);
+        }
+
+        bool isBound() const { return event_fd != -1; }
+
+        Polling::Tag bind(Polling::Epoll& poller)
+        {
+            using namespace Polling;
+
+            if (isBound())
+            {
+                throw std::runtime_error("The queue has already been bound");
+            }
+
+            event_fd = TRY_RET(eventfd(0, EFD_NONBLOCK));
+            Tag tag_(event_fd);
+            poller.addFd(event_fd, Flags<Polling::NotifyOn>(NotifyOn::Read), tag_);
+
+            return tag_;
+        }
+
+        template <class U>
+        void push(U&& u)
+        {
+            if (overflowing.load() || !enqueue(std::forward<U>(u)))
+            {
+                std::lock_guard<std::mutex> guard(overflowLock);
+                overflow.emplace_back(std::forward<U>(u));
+                overflowing.store(true);
+            }
+
+            // The consumer looks at the queue on its own while it spins. Pairs
+            // with its fence once it stops: either it sees the entry, or the
+            // flag is seen down here
+            if (spinning_)
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (spinning_->load(std::memory_order_relaxed))
+                    return;
+            }
+
+            if (!signaled.exchange(true) && isBound())
+            {
+                uint64_t val = 1;
+                TRY(write(event_fd, &val, sizeof val));
+            }
+        }
+
+        // The flag of a busy-polling consumer, see Aio::Handler::spinning().
+        // Pushes do not write the eventfd while it is up
+        void setSpinFlag(const std::atomic<bool>* spinning) { spinning_ = spinning; }
+
+        // Only to be called from the consumer thread
+        std::optional<T> popSafe()
+        {
+            if (auto value = pop())
+                return value;
+
+            // Drained, the next push has to signal again. Whatever got pushed
+            // before the flag went down did not signal, look once more.
+            signaled.store(false);
+            if (isBound())
+            {
+                uint64_t val;
+                while (read(event_fd, &val, sizeof val) != -1)
+                    ;
+            }
+
+            return pop();
+        }
+
+        bool empty() const
+        {
+            return batch.empty() && !overflowing.load()
+                && cells_[dequeueIndex & Mask].sequence.load(std::memory_order_acquire) != dequeueIndex + 1;
+        }
+
+        Polling::Tag tag() const
+        {
+            if (!isBound())
+                throw std::runtime_error("Can not retrieve tag of an unbound mailbox");
+
+            return Polling::Tag(event_fd);
+        }
+
+        void unbind(Polling::Epoll& poller)
+        {
+            if (event_fd == -1)
+            {
+                throw std::runtime_error("The mailbox is not bound");
+            }
+
+            poller.removeFd(event_fd);
+            close(event_fd), event_fd = -1;
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+            T& data() { return *std::launder(reinterpret_cast<T*>(&storage)); }
+        };
+
+        template <typename U>
+        bool enqueue(U&& u)
+        {
+            Cell* target;
+            size_t index = enqueueIndex.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                target     = &cells_[index & Mask];
+                size_t seq = target->sequence.load(std::memory_order_acquire);
+                auto diff  = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(index);
+                if (diff == 0)
+                {
+                    if (enqueueIndex.compare_exchange_weak(index, index + 1,
+                                                           std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                    return false;
+                else
+                {
+                    index = enqueueIndex.load(std::memory_order_relaxed);
+                }
+            }
+
+            new (&target->storage) T(std::forward<U>(u));
+            target->sequence.store(index + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Single consumer, the dequeue index does not need to be shared
+        std::optional<T> dequeue()
+        {
+            Cell* target = &cells_[dequeueIndex & Mask];
+            if (target->sequence.load(std::memory_order_acquire) != dequeueIndex + 1)
+                return std::nullopt;
+
+            std::optional<T> value(std::move(target->data()));
+            target->data().~T();
+            target->sequence.store(dequeueIndex + Size, std::memory_order_release);
+            ++dequeueIndex;
+            return value;
+        }
+
+        // The ring first, everything in it was pushed before the overflow
+        // started. The overflow then is taken as a whole, before the ring is
+        // looked at again.
+        std::optional<T> pop()
+        {
+            if (batch.empty())
+            {
+                if (auto value = dequeue())
+                    return value;
+
+                if (!overflowing.load())
+                    return std::nullopt;
+
+                std::lock_guard<std::mutex> guard(overflowLock);
+                batch.swap(overflow);
+                overflowing.store(false);
+            }
+
+            if (batch.empty())
+                return std::nullopt;
+
+            std::optional<T> value(std::move(batch.front()));
+            batch.pop_front();
+            return value;
+        }
+
+        std::array<Cell, Size> cells_;
+
+        cacheline_pad_t pad0;
+        std::atomic<size_t> enqueueIndex;
+
+        cacheline_pad_t pad1;
+        size_t dequeueIndex;
+        std::deque<T> batch;
+
+        cacheline_pad_t pad2;
+        std::atomic<bool> signaled;
+        std::atomic<bool> overflowing;
+        const std::atomic<bool>* spinning_ = nullptr;
+        std::mutex overflowLock;
+        std::deque<T> overflow;
+
+        int event_fd;
+    };
+
     // A Multi-Producer Multi-Consumer bounded queue
     // taken from
     // http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
@@ -484,4 +728,92 @@ namespace Pistache
         std::atomic<size_t> dequeueIndex;
     };
 
+    /*
+ * Records of any size, from a single producer to a single consumer, in a ring
+ of bytes allocated once. A record is stored as its size followed by its bytes,
+ wrapping around the end of the storage, and a push into a ring without room
+ for it is refused rather than waiting for the consumer.
+*/
+    class RecordRing
+    {
+    public:
+        explicit RecordRing(size_t capacity)
+            : data_(capacity)
+        { }
+
+        RecordRing(const RecordRing& other)            = delete;
+        RecordRing& operator=(const RecordRing& other) = delete;
+
+        // From the producer
+        bool push(std::string_view record)
+        {
+            const auto size   = static_cast<uint32_t>(record.size());
+            const size_t need = sizeof(size) + record.size();
+
+            const size_t head = head_.load(std::memory_order_relaxed);
+            const size_t tail = tail_.load(std::memory_order_acquire);
+            if (record.size() > UINT32_MAX || data_.size() - (head - tail) < need)
+                return false;
+
+            put(head, reinterpret_cast<const char*>(&size), sizeof(size));
+            put(head + sizeof(size), record.data(), record.size());
+            head_.store(head + need, std::memory_order_release);
+            return true;
+        }
+
+        // From the consumer, calls func with every record pushed so far. The
+        // view is only valid during the call
+        template <typename Func>
+        void drain(Func func)
+        {
+            size_t tail       = tail_.load(std::memory_order_relaxed);
+            const size_t head = head_.load(std::memory_order_acquire);
+            while (tail < head)
+            {
+                uint32_t size = 0;
+                get(tail, reinterpret_cast<char*>(&size), sizeof(size));
+                tail += sizeof(size);
+
+                // Contiguous unless it wraps around
+                const size_t at = tail % data_.size();
+                if (at + size <= data_.size())
+                {
+                    func(std::string_view(data_.data() + at, size));
+                }
+                else
+                {
+                    scratch_.resize(size);
+                    get(tail, scratch_.data(), size);
+                    func(std::string_view(scratch_.data(), size));
+                }
+                tail += size;
+            }
+            tail_.store(tail, std::memory_order_release);
+        }
+
+    private:
+        void put(size_t at, const char* bytes, size_t size)
+        {
+            at               = at % data_.size();
+            const size_t end = std::min(size, data_.size() - at);
+            std::memcpy(data_.data() + at, bytes, end);
+            std::memcpy(data_.data(), bytes + end, size - end);
+        }
+
+        void get(size_t at, char* bytes, size_t size) const
+        {
+            at               = at % data_.size();
+            const size_t end = std::min(size, data_.size() - at);
+            std::memcpy(bytes, data_.data() + at, end);
+            std::memcpy(bytes + end, data_.data(), size - end);
+        }
+
+        std::vector<char> data_;
+        std::vector<char> scratch_;
+
+        // Both only grow, their difference is what the ring holds
+        alignas(CachelineSize) std::atomic<size_t> head_ { 0 };
+        alignas(CachelineSize) std::atomic<size_t> tail_ { 0 };
+    };
+
 } // namespace Pistache
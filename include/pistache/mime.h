@@ -47,6 +47,8 @@ namespace Pistache::Http::Mime
     SUB_TYPE(JsonSchemaInstance, "schema-instance+json") \
     SUB_TYPE(FormUrlEncoded, "x-www-form-urlencoded")    \
     SUB_TYPE(FormData, "form-data")                      \
+    SUB_TYPE(ByteRanges, "byteranges")                   \
+    SUB_TYPE(EventStream, "event-stream")                \
                                                          \
     SUB_TYPE(Png, "png")                                 \
     SUB_TYPE(Gif, "gif")                                 \
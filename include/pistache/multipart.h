@@ -0,0 +1,145 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* multipart.h
+
+   Incremental multipart/form-data parser (RFC 7578). The body is fed as it
+   arrives, in pieces of any size: the headers of every part are parsed with
+   a StreamCursor, and the content of the parts is handed over as views into
+   the bytes fed, without being copied. Only the few bytes that may start a
+   boundary at the end of a piece are held back until the next one.
+
+   A Reader plugs the parser into the streaming body of a request, see
+   Http::Handler::onBodyStart(), so that a form carrying large files is
+   parsed in constant memory.
+*/
+
+#pragma once
+
+#include <pistache/http.h>
+#include <pistache/http_headers.h>
+#include <pistache/mime.h>
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Pistache::Http::Multipart
+{
+
+    struct Part
+    {
+        // Raw headers of the part
+        Header::Collection headers;
+
+        // Parameters of its Content-Disposition
+        std::string name;
+        // Empty unless the part is a file
+        std::string filename;
+
+        // text/plain when the part has no Content-Type
+        Mime::MediaType contentType;
+
+        bool isFile() const { return !filename.empty(); }
+    };
+
+    // Called as the parts are parsed, from the thread feeding the parser
+    class Handler
+    {
+    public:
+        virtual ~Handler() = default;
+
+        // The headers of a part have been received
+        virtual void onPart(const Part& part);
+
+        // Content of the part, the view is only valid during the call
+        virtual void onData(const Part& part, std::string_view data) = 0;
+
+        virtual void onPartEnd(const Part& part);
+
+        // The closing boundary has been received
+        virtual void onEnd();
+
+        // The body was malformed, cut short, or the connection went away
+        virtual void onError(const std::string& reason);
+    };
+
+    class Parser
+    {
+    public:
+        // Largest header block of a part
+        static constexpr size_t MaxHeadersSize = 8192;
+        // Longest boundary allowed by RFC 2046
+        static constexpr size_t MaxBoundarySize = 70;
+
+        // The handler must outlive the parser
+        Parser(std::string_view boundary, Handler& handler);
+
+        // Boundary of a multipart/form-data request, nullopt for any other
+        // request
+        static std::optional<std::string> boundary(const Request& request);
+
+        /* Parses the next bytes of the body. Throws an HttpError when they
+         * are malformed, the parser can not be fed anymore then.
+         */
+        void feed(std::string_view data);
+
+        // Whether the closing boundary has been received, what follows it
+        // is ignored
+        bool done() const { return step_ == Step::Epilogue; }
+
+    private:
+        enum class Step { Preamble,
+                          BoundaryLine,
+                          Headers,
+                          Content,
+                          Epilogue };
+
+        // Looks for the delimiter, hands the content before it over. Returns
+        // the bytes used, found tells whether the delimiter was among them
+        size_t scan(std::string_view data, bool& found);
+        void emit(std::string_view data);
+        size_t readBoundaryLine(std::string_view data);
+        size_t readHeaders(std::string_view data);
+        void parseHeaders();
+
+        // CR LF -- boundary
+        std::string delimiter_;
+        Handler& handler_;
+
+        Step step_ = Step::Preamble;
+        // End of the previous piece that may start the delimiter
+        std::string held_;
+        // Line or header block being gathered
+        std::string line_;
+
+        Part part_;
+    };
+
+    // Feeds the streamed body of a request to a parser
+    class Reader : public BodyReader
+    {
+    public:
+        Reader(std::string boundary, std::shared_ptr<Handler> handler);
+
+        // Reader of a multipart/form-data request, nullptr for any other
+        // request
+        static std::shared_ptr<Reader> create(const Request& request,
+                                              std::shared_ptr<Handler> handler);
+
+        void onData(std::string_view data) override;
+        // Throws an HttpError when the closing boundary is missing
+        void onEnd() override;
+        void onError(const std::string& reason) override;
+
+    private:
+        std::shared_ptr<Handler> handler_;
+        Parser parser_;
+    };
+
+} // namespace Pistache::Http::Multipart
@@ -0,0 +1,76 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* negotiation.h
+
+   Content negotiation of the media type of a response from the Accept
+   header of the request (RFC 9110 12.5.1), for the routes that produce
+   several of them.
+
+   The types a route produces, the produce list of its Rest::Description
+   path for instance, are compiled once into lowercase names. The Accept
+   value is then matched in a single pass over its bytes, without building
+   a Mime::MediaType for every media range. The results of the Accept values
+   seen last are kept by every thread, a client sending the same value
+   again is answered without parsing it.
+*/
+
+#pragma once
+
+#include <pistache/http.h>
+#include <pistache/mime.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Pistache::Http::Mime
+{
+
+    class Negotiator
+    {
+    public:
+        // Types a negotiator can choose from
+        static constexpr size_t MaxTypes = 32;
+        // Longer Accept values are negotiated again every time
+        static constexpr size_t MaxCachedAccept = 512;
+
+        // The types in order of preference, the first one wins between the
+        // types a client accepts with the same weight
+        explicit Negotiator(const std::vector<MediaType>& produces);
+
+        /* Index in the produced types of the one the client prefers, the
+         * first type when accept is empty. Empty when the client accepts
+         * none of them, the response then is a 406 Not Acceptable.
+         */
+        std::optional<size_t> negotiate(std::string_view accept) const;
+
+        // Type the client of the request prefers, nullptr when it accepts
+        // none of them
+        const MediaType* select(const Request& request) const;
+
+        const std::vector<MediaType>& produces() const { return produces_; }
+
+    private:
+        struct Compiled
+        {
+            std::string top;
+            // Subtype along with its suffix, as in "vnd.api+json"
+            std::string sub;
+        };
+
+        std::optional<size_t> match(std::string_view accept) const;
+
+        std::vector<MediaType> produces_;
+        std::vector<Compiled> compiled_;
+        // Tells the results of this negotiator apart in the caches
+        const uint64_t id_;
+    };
+
+} // namespace Pistache::Http::Mime
@@ -163,16 +163,29 @@ namespace Pistache
         static Address fromUnix(struct sockaddr* addr);
         static Address fromUnix(struct sockaddr_in* addr);
 
+        /* A Unix domain stream socket, for the services of the same host. A
+         * path starting with '@' names a socket of the abstract namespace,
+         * which has no file. "unix:<path>" strings are parsed the same way.
+         */
+        static Address unixSocket(std::string path);
+
+        // The path of a Unix domain socket, '@' first for an abstract one
         std::string host() const;
+        // Zero for a Unix domain socket
         Port port() const;
         int family() const;
 
+        // Fills the storage with the socket address and returns its length
+        socklen_t toSockaddr(struct sockaddr_storage& storage) const;
+
         friend std::ostream& operator<<(std::ostream& os, const Address& address);
 
     private:
         void init(const std::string& addr);
         IP ip_;
         Port port_;
+        bool unixDomain_ = false;
+        std::string path_;
     };
 
     std::ostream& operator<<(std::ostream& os, const Address& address);
@@ -19,6 +19,8 @@
 #include <bitset>
 #include <chrono>
 #include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include <sched.h>
@@ -58,11 +60,40 @@ namespace Pistache
         std::bitset<Size> bits;
     };
 
+    // CPUs the calling thread is allowed to run on, in ascending order
+    std::vector<size_t> availableCpus();
+
+    // CPUs worth of time the cgroup of the process may use, the smallest
+    // quota of its cgroup and of their parents: cpu.max for cgroup v2, else
+    // cpu.cfs_quota_us over cpu.cfs_period_us for v1. nullopt when there is
+    // no quota. The paths can be changed for tests
+    std::optional<double> cpuQuota(const std::string& cgroupRoot = "/sys/fs/cgroup",
+                                   const std::string& selfCgroup = "/proc/self/cgroup");
+
+    // Threads that can run at once: the CPUs of the affinity mask, capped by
+    // the cgroup quota rounded up, and at least 1
+    size_t usableCpus();
+
+    // NUMA node of a CPU as reported by sysfs, -1 when it is not known
+    int cpuNode(size_t cpu);
+
     namespace Polling
     {
 
+        // Exclusive is level-triggered, and wakes up only one of the pollers
+        // watching the same fd with it (EPOLLEXCLUSIVE). Only for addFd()
         enum class Mode { Level,
-                          Edge };
+                          Edge,
+                          Exclusive };
+
+        /*
+         * The kernel facility used to wait for readiness events. IoUring
+         * keeps the same readiness semantics as Epoll but arms the fds with
+         * IORING_OP_POLL_ADD requests that are submitted in batches together
+         * with the wait itself, saving an epoll_ctl() call per re-arm.
+         */
+        enum class Backend { Epoll,
+                             IoUring };
 
         enum class NotifyOn {
             None = 0,
@@ -70,7 +101,10 @@ namespace Pistache
             Read     = 1,
             Write    = Read << 1,
             Hangup   = Read << 2,
-            Shutdown = Read << 3
+            Shutdown = Read << 3,
+            // Reported whatever the interest, for an error or a message in
+            // the error queue of the socket
+            Error = Read << 4
         };
 
         DECLARE_FLAGS_OPERATORS(NotifyOn)
@@ -104,12 +138,42 @@ namespace Pistache
             Tag tag;
         };
 
+        /* While it lives, the tags of the fds added from the current thread
+         * carry the bits. The reactor sets them to the index of a handler
+         * that registers its own fds, for their events to reach it.
+         */
+        class TagScope
+        {
+        public:
+            explicit TagScope(uint64_t bits);
+            ~TagScope();
+
+            TagScope(const TagScope&)            = delete;
+            TagScope& operator=(const TagScope&) = delete;
+
+            static uint64_t bits();
+
+        private:
+            uint64_t previous_;
+        };
+
+        class IoUring;
+
         class Epoll
         {
         public:
             Epoll();
+            explicit Epoll(Backend backend);
             ~Epoll();
 
+            Epoll(const Epoll&)            = delete;
+            Epoll& operator=(const Epoll&) = delete;
+
+            Backend backend() const;
+
+            // Whether the running kernel can be used with the given backend
+            static bool isSupported(Backend backend);
+
             void addFd(Fd fd, Flags<NotifyOn> interest, Tag tag, Mode mode = Mode::Level);
             void addFdOneShot(Fd fd, Flags<NotifyOn> interest, Tag tag,
                               Mode mode = Mode::Level);
@@ -124,6 +188,7 @@ namespace Pistache
             static int toEpollEvents(const Flags<NotifyOn>& interest);
             static Flags<NotifyOn> toNotifyOn(int events);
             Fd epoll_fd;
+            std::unique_ptr<IoUring> uring_;
         };
 
     } // namespace Polling
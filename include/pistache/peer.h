@@ -12,9 +12,16 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <pistache/async.h>
 #include <pistache/http.h>
@@ -33,12 +40,30 @@ namespace Pistache::Tcp
 
     class Transport;
 
+    /* Key of a typed slot of the peers, naming the type it holds:
+     *
+     *     struct SessionSlot : Tcp::PeerSlot<Session> { };
+     *
+     *     peer->putSlot<SessionSlot>(std::make_shared<Session>());
+     *     Session* session = peer->slot<SessionSlot>();
+     *
+     * Each key is given the index of a slot the first time it is used, for
+     * the rest of the program.
+     */
+    template <typename T>
+    struct PeerSlot
+    {
+        using Type = T;
+    };
+
     class Peer
     {
     public:
         friend class Transport;
         friend class Http::Handler;
         friend class Http::Timeout;
+        friend class Http::ResponseStream;
+        friend class Listener;
 
         ~Peer();
 
@@ -50,19 +75,69 @@ namespace Pistache::Tcp
         void setIdle(bool bIdle);
         bool isIdle() const;
 
+        // Whether the handler stopped reading it, see Transport::pauseReading()
+        bool isReadPaused() const { return readPaused_; }
+
         const Address& address() const;
+        // The name of the peer once a reverse lookup of its address is
+        // cached, its numeric address until then. Never blocks
         const std::string& hostname();
+        // Looks the name of the peer up on DnsResolver::shared(). Resolved
+        // from one of its threads, and rejected when the address has no name
+        Async::Promise<std::string> resolveHostname() const;
         Fd fd() const;
 
         void* ssl() const;
-
+        // Whether the records sent to the peer are encrypted by the kernel
+        bool kernelTls() const;
+        // Protocol selected with ALPN during the TLS handshake, empty when
+        // none was
+        std::string alpnProtocol() const;
+
+        // Slots a peer has, for all of the keys of the program
+        static constexpr size_t SlotsCount = 4;
+
+        // nullptr while nothing was put in the slot. Read by index, neither
+        // hashing a name nor copying a shared_ptr
+        template <typename Key>
+        typename Key::Type* slot() const
+        {
+            return static_cast<typename Key::Type*>(slots_[slotIndex<Key>()].get());
+        }
+
+        template <typename Key>
+        std::shared_ptr<typename Key::Type> sharedSlot() const
+        {
+            return std::static_pointer_cast<typename Key::Type>(slots_[slotIndex<Key>()]);
+        }
+
+        template <typename Key>
+        void putSlot(std::shared_ptr<typename Key::Type> value)
+        {
+            slots_[slotIndex<Key>()] = std::move(value);
+        }
+
+        // Ad-hoc data, by name. The state that is read often belongs in a slot
         void putData(std::string name, std::shared_ptr<void> data);
         std::shared_ptr<void> getData(std::string name) const;
         std::shared_ptr<void> tryGetData(std::string name) const;
 
         Async::Promise<ssize_t> send(const RawBuffer& buffer, int flags = 0);
+
+        // Bytes of the streamed responses handed to the transport and not
+        // written to the socket yet. Can be called from any thread
+        size_t queuedBytes() const;
+
+        // Past the high watermark, a stream stops being writable until the
+        // queued bytes drop to the low one
+        void setWatermarks(size_t high, size_t low);
+        size_t highWatermark() const { return highWatermark_; }
+        size_t lowWatermark() const { return lowWatermark_; }
+
         size_t getID() const;
 
+        PeerHandle handle() const { return PeerHandle { fd_, id_ }; }
+
     protected:
         Peer(Fd fd, const Address& addr, void* ssl);
 
@@ -71,16 +146,77 @@ namespace Pistache::Tcp
         Transport* transport() const;
         static size_t getUniqueId();
 
+        // Throws once SlotsCount keys have been given a slot
+        static size_t allocateSlot();
+
+        template <typename Key>
+        static size_t slotIndex()
+        {
+            static const size_t index = allocateSlot();
+            return index;
+        }
+
+        void queueBytes(size_t bytes);
+        void releaseBytes(size_t bytes);
+        // Calls the callback once the queued bytes are at most the low
+        // watermark, with false when the peer goes away first
+        void whenDrained(std::function<void(bool)> callback);
+
         Transport* transport_ = nullptr;
         Fd fd_                = -1;
         Address addr;
 
         std::string hostname_;
+        // hostname_ is the name of the peer rather than its address
+        bool hostnameResolved_ = false;
+        std::array<std::shared_ptr<void>, SlotsCount> slots_;
         std::unordered_map<std::string, std::shared_ptr<void>> data_;
 
         void* ssl_ = nullptr;
         const size_t id_;
         bool isIdle_ = false;
+        // Reading was paused by the handler, only used from the thread of
+        // the transport
+        bool readPaused_ = false;
+        // Set once the peer was read from, see Transport::drain()
+        bool received_ = false;
+
+        // Neighbours in the list of the peers of the transport, from the
+        // most recently active one, see Transport::setIdleEviction()
+        Peer* lruPrev_ = nullptr;
+        Peer* lruNext_ = nullptr;
+
+        // MSG_ZEROCOPY, enabled on the socket on the first large send. Every
+        // send with it is given the next id, the buffers are held along with
+        // the id of their last send until the kernel is done with it
+        enum class ZeroCopy : uint8_t { Unknown,
+                                        Enabled,
+                                        Unsupported };
+        ZeroCopy zeroCopy_       = ZeroCopy::Unknown;
+        uint32_t nextZeroCopyId_ = 0;
+        std::deque<std::pair<uint32_t, Transport::BufferHolder>> zeroCopyHeld_;
+
+        // The TLS handshake of a SSL peer is driven by its transport
+        bool handshakePending_ = false;
+        // Set once the handshake is done and kTLS was enabled for sending
+        bool kernelTls_ = false;
+
+        // Tracing::Ticks of the accept, and of the first byte of the request
+        // being received, see tracing.h
+        uint64_t acceptedAt_  = 0;
+        uint64_t firstByteAt_ = 0;
+
+        // Writes not sent yet, only used from the thread of the transport
+        std::deque<Transport::WriteEntry> writeQueue_;
+        // The file at the front of the queue is being read into memory, the
+        // queue waits for it
+        bool prefetching_ = false;
+
+        std::atomic<size_t> queuedBytes_ { 0 };
+        size_t highWatermark_ = Const::DefaultHighWatermark;
+        size_t lowWatermark_  = Const::DefaultLowWatermark;
+        std::mutex drainLock_;
+        std::vector<std::function<void(bool)>> drainWaiters_;
     };
 
     std::ostream& operator<<(std::ostream& os, Peer& peer);
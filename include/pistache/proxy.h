@@ -0,0 +1,62 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* proxy.h
+
+   Reverse proxy: a handler forwarding the requests to a pool of upstream
+   servers through an Experimental::Client. The headers are passed through
+   as they were received, without being parsed, and the body of a response
+   is streamed back as it arrives, at the pace of the downstream connection.
+*/
+
+#pragma once
+
+#include <pistache/client.h>
+#include <pistache/config.h>
+#include <pistache/http.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Pistache::Http
+{
+
+    class Proxy : public Handler
+    {
+    public:
+        HTTP_PROTOTYPE(Proxy)
+
+        /* The upstreams are base URLs such as "10.0.0.1:8080", taken in turn
+         * for each request. The client has to be initialized, and is shared
+         * with the clones of the handler. The timeout covers the time until
+         * the headers of the response are received.
+         */
+        Proxy(std::shared_ptr<Experimental::Client> client, std::vector<std::string> upstreams,
+              std::chrono::milliseconds timeout = Const::DefaultProxyTimeout);
+
+        /* The request is answered with a 502 when the upstream can not be
+         * reached, and a 504 when it does not answer in time. A connection
+         * that fails in the middle of the body of a response is closed, for
+         * the client to tell it from a complete response.
+         */
+        void onRequest(const Request& request, ResponseWriter response) override;
+
+        // Headers that only concern one connection, they are not forwarded
+        static bool isHopByHop(std::string_view name);
+
+    private:
+        const std::string& nextUpstream();
+
+        std::shared_ptr<Experimental::Client> client_;
+        std::shared_ptr<const std::vector<std::string>> upstreams_;
+        std::shared_ptr<std::atomic<size_t>> next_;
+        std::chrono::milliseconds timeout_;
+    };
+
+} // namespace Pistache::Http
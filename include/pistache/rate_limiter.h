@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* rate_limiter.h
+
+   Token buckets limiting the requests of every client, by address or by a
+   header such as an API key. A key gets rate tokens per second, and holds
+   burst of them at most.
+
+   The buckets are shared by all the threads, spread over lock-striped
+   shards, but a thread does not take its tokens one at a time: it leases a
+   few of them, spends them without a lock, and gives back what is left once
+   per reconcile interval. The limit is then approximate, a client may get
+   the tokens leased by every thread on top of its burst, in exchange for
+   the workers rarely meeting on a lock.
+
+   The 429 responses are serialized once, when the limiter is built.
+*/
+
+#pragma once
+
+#include <pistache/http.h>
+#include <pistache/router.h>
+#include <pistache/stream.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Pistache::Http
+{
+
+    class RateLimiter
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+        // The key of the bucket of a request, an empty one is not limited
+        using KeyFunction = std::function<std::string(const Request&)>;
+
+        static constexpr size_t ShardsCount = 16;
+        // Part of the burst a thread leases at once
+        static constexpr size_t LeaseDivisor = 8;
+        static constexpr std::chrono::milliseconds DefaultReconcileInterval { 100 };
+
+        RateLimiter(double rate, size_t burst, KeyFunction key = byAddress(),
+                    std::chrono::milliseconds reconcile = DefaultReconcileInterval);
+
+        RateLimiter(const RateLimiter&)            = delete;
+        RateLimiter& operator=(const RateLimiter&) = delete;
+
+        ~RateLimiter();
+
+        // The address of the client, or the value of one of its headers
+        static KeyFunction byAddress();
+        static KeyFunction byHeader(std::string name);
+
+        // Takes a token from the bucket of the key
+        bool allow(std::string_view key);
+        bool allow(std::string_view key, Clock::time_point now);
+
+        // Takes a token from the bucket of the request
+        bool admit(const Request& request);
+
+        /* Answers with a 429 and a Retry-After header. On HTTP/1 the
+         * response is written from the buffers serialized up front, asking
+         * the client to close the connection when close is true, or when
+         * its request did.
+         */
+        Async::Promise<ssize_t> refuse(const Request& request, ResponseWriter& response,
+                                       bool close = false) const;
+
+        // Requests refused so far
+        uint64_t limited() const { return limited_.load(std::memory_order_relaxed); }
+        // Keys with a bucket in the shards, the full ones are dropped
+        size_t size() const;
+
+    private:
+        struct Bucket
+        {
+            double tokens;
+            Clock::time_point updated;
+        };
+
+        // Searched by string_view, a key is only copied for a new entry.
+        // Ordered, the lookup of the unordered maps takes a std::string
+        // until C++20
+        template <typename T>
+        using KeyMap = std::map<std::string, T, std::less<>>;
+
+        struct alignas(64) Shard
+        {
+            mutable std::mutex lock;
+            KeyMap<Bucket> buckets;
+        };
+
+        // The tokens the calling thread leased, by key
+        struct Leases;
+        Leases& leases();
+
+        Shard& shardOf(std::string_view key);
+        // Adds the tokens earned since the bucket was last updated
+        void refill(Bucket& bucket, Clock::time_point now) const;
+
+        size_t lease(std::string_view key, Clock::time_point now);
+        // Gives the leased tokens back and forgets the keys of the thread
+        void reconcile(Leases& leases, Clock::time_point now);
+        // Drops the buckets of a shard that are full again
+        void sweep(Shard& shard, Clock::time_point now);
+
+        const double rate_;
+        const double burst_;
+        const size_t leaseSize_;
+        const KeyFunction key_;
+        const Clock::duration reconcile_;
+        // Tells the leases of this limiter apart in the threads
+        const uint64_t id_;
+
+        std::array<Shard, ShardsCount> shards_;
+        std::atomic<size_t> nextSweep_ { 0 };
+        std::atomic<uint64_t> limited_ { 0 };
+
+        // The leases of every thread, also held by the thread itself
+        std::mutex leasesLock_;
+        std::vector<std::shared_ptr<Leases>> leases_;
+
+        // Whole seconds until a token is earned
+        const std::string retryAfter_;
+
+        // Status line and headers of HTTP/1.0 and HTTP/1.1, then the
+        // Connection header and the body, closing or not
+        std::array<SharedBuffer, 2> heads_;
+        std::array<SharedBuffer, 2> tails_;
+    };
+
+} // namespace Pistache::Http
+
+namespace Pistache::Rest::Routes
+{
+    // Refuses the requests over their limit with a 429, for
+    // Router::addMiddleware(). The endpoint can refuse them before their body,
+    // see Http::Endpoint::Options::rateLimit()
+    Route::Middleware rateLimit(std::shared_ptr<Http::RateLimiter> limiter);
+} // namespace Pistache::Rest::Routes
@@ -24,6 +24,9 @@
 #include <sys/resource.h>
 #include <sys/time.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <thread>
 #include <vector>
@@ -54,10 +57,19 @@ namespace Pistache::Aio
             bool isReadable() const { return flags.hasFlag(Polling::NotifyOn::Read); }
             bool isWritable() const { return flags.hasFlag(Polling::NotifyOn::Write); }
             bool isHangup() const { return flags.hasFlag(Polling::NotifyOn::Hangup); }
+            bool isError() const { return flags.hasFlag(Polling::NotifyOn::Error); }
 
             Polling::Tag getTag() const { return this->tag; }
         };
 
+        // Takes over the storage of the entries, release() hands it back so
+        // that the reactor can reuse it for the next batch of events
+        explicit FdSet(std::vector<Entry>&& entries)
+            : events_(std::move(entries))
+        { }
+
+        std::vector<Entry> release() && { return std::move(events_); }
+
         using iterator       = std::vector<Entry>::iterator;
         using const_iterator = std::vector<Entry>::const_iterator;
 
@@ -82,6 +94,29 @@ namespace Pistache::Aio
     class Handler;
     class ExecutionContext;
 
+    // Counters of an event loop since it started, readable from any thread
+    // while it runs without disturbing it
+    struct LoopStats
+    {
+        // Calls to poll(), and the events they returned
+        uint64_t iterations = 0;
+        uint64_t events     = 0;
+        // Largest batch of events returned by a single poll()
+        uint64_t maxBatch = 0;
+
+        // Time spent blocked in poll(), and handling the events it returned
+        std::chrono::nanoseconds waiting { 0 };
+        std::chrono::nanoseconds busy { 0 };
+
+        // Calls to onReady() of the handlers, and the longest of them
+        uint64_t handlerCalls = 0;
+        std::chrono::nanoseconds maxHandler { 0 };
+
+        // Time the loop has been handling its current batch, zero while it
+        // waits in poll(). Growing from a read to the next, it is stalled
+        std::chrono::nanoseconds lag { 0 };
+    };
+
     class Reactor : public std::enable_shared_from_this<Reactor>
     {
     public:
@@ -140,6 +175,10 @@ namespace Pistache::Aio
 
         void shutdown();
 
+        // One entry per thread polling for the reactor, in the order of
+        // the handlers returned by handlers()
+        std::vector<LoopStats> loopStats() const;
+
     private:
         Impl* impl() const;
         std::unique_ptr<Impl> impl_;
@@ -155,27 +194,48 @@ namespace Pistache::Aio
     class SyncContext : public ExecutionContext
     {
     public:
+        explicit SyncContext(Polling::Backend backend = Polling::Backend::Epoll)
+            : backend_(backend)
+        { }
+
         ~SyncContext() override = default;
         Reactor::Impl* makeImpl(Reactor* reactor) const override;
+
+    private:
+        Polling::Backend backend_;
     };
 
     class AsyncContext : public ExecutionContext
     {
     public:
-        explicit AsyncContext(size_t threads, const std::string& threadsName = "")
+        explicit AsyncContext(size_t threads, const std::string& threadsName = "",
+                              Polling::Backend backend = Polling::Backend::Epoll)
             : threads_(threads)
             , threadsName_(threadsName)
+            , backend_(backend)
         { }
 
         ~AsyncContext() override = default;
 
         Reactor::Impl* makeImpl(Reactor* reactor) const override;
 
+        // Restricts worker i to cpus[i] once its thread starts, workers
+        // without an entry or with an empty set are not pinned
+        AsyncContext& pinWorkers(std::vector<CpuSet> cpus);
+
+        // The workers poll without blocking for up to spin after their last
+        // event before they block, trading a cpu each for latency. Zero, the
+        // default, always blocks
+        AsyncContext& busyPoll(std::chrono::microseconds spin);
+
         static AsyncContext singleThreaded();
 
     private:
         size_t threads_;
         std::string threadsName_;
+        Polling::Backend backend_;
+        std::vector<CpuSet> affinity_;
+        std::chrono::microseconds spin_ { 0 };
     };
 
     class Handler : public Prototype<Handler>
@@ -208,6 +268,15 @@ namespace Pistache::Aio
         virtual void onReady(const FdSet& fds)              = 0;
         virtual void registerPoller(Polling::Epoll& poller) = 0;
 
+        // Called by a busy-polling loop between two polls that returned
+        // nothing, and once more before it blocks. The queues that do not
+        // wake the loop up while it spins are looked at from here
+        virtual void onSpin() { }
+
+        // Raised while the loop of the handler busy-polls, null when it
+        // never does. Set before registerPoller()
+        const std::atomic<bool>* spinning() const { return spinning_; }
+
         Reactor* reactor() const { return reactor_; }
 
         Context context() const { return context_; }
@@ -220,6 +289,7 @@ namespace Pistache::Aio
         Reactor* reactor_;
         Context context_;
         Reactor::Key key_;
+        const std::atomic<bool>* spinning_ = nullptr;
     };
 
 } // namespace Pistache::Aio
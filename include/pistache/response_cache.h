@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* response_cache.h
+
+   In-memory cache of the responses of a Rest::Router. A response is kept as
+   it was serialized, a hit is written to the connection from that copy
+   without calling the handler nor serializing the headers again.
+
+   The responses to GET and HEAD requests are stored when their status is
+   cacheable by default (RFC 9110 section 15.1) and they are fresh for some
+   time: the s-maxage or max-age of their Cache-Control header, or else the
+   default ttl of the cache. no-store, no-cache or private, a Set-Cookie
+   header, and a Vary header naming other headers than the ones of the key
+   keep a response out of the cache.
+
+   The entries are spread over lock-striped shards, each one bounded by its
+   part of the byte budget and evicting the least recently used entries.
+*/
+
+#pragma once
+
+#include <pistache/http.h>
+#include <pistache/router.h>
+#include <pistache/stream.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Pistache::Rest
+{
+
+    class ResponseCache : public std::enable_shared_from_this<ResponseCache>
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr size_t DefaultMaxBytes = 64 * 1024 * 1024;
+        static constexpr size_t ShardsCount     = 16;
+
+        /* The key of a response is the method, the resource with its query,
+         * the version, and the values of the varyHeaders of the request,
+         * such as Accept-Encoding when the responses are compressed. A ttl
+         * of zero only caches the responses saying how long they are fresh.
+         */
+        explicit ResponseCache(std::vector<std::string> varyHeaders = {},
+                               size_t maxBytes                      = DefaultMaxBytes,
+                               std::chrono::seconds defaultTtl      = std::chrono::seconds(0));
+
+        ResponseCache(const ResponseCache&)            = delete;
+        ResponseCache& operator=(const ResponseCache&) = delete;
+
+        /* Answers the request from the cache and returns true. Otherwise the
+         * response is recorded, to be stored once it is sent. Requests with
+         * an Authorization header, conditional ones, and the ones whose
+         * Cache-Control asks for a fresh response are not answered from the
+         * cache.
+         */
+        bool serve(const Http::Request& request, Http::ResponseWriter& response);
+
+        size_t size() const;
+        // Bytes held by the entries, keys included
+        size_t bytes() const;
+        void clear();
+
+        uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+        uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+    private:
+        class Recorder;
+
+        struct Entry
+        {
+            Http::Code code;
+            // Status line and headers, without the blank line ending them
+            SharedBuffer head;
+            SharedBuffer body;
+            Clock::time_point stored;
+            Clock::time_point expiry;
+        };
+
+        struct Slot
+        {
+            std::shared_ptr<const Entry> entry;
+            size_t bytes;
+            std::list<std::string>::iterator lru;
+        };
+
+        struct alignas(64) Shard
+        {
+            mutable std::mutex lock;
+            std::unordered_map<std::string, Slot> slots;
+            // Least recently used last
+            std::list<std::string> lru;
+            size_t bytes = 0;
+        };
+
+        std::string keyOf(const Http::Request& request) const;
+        Shard& shardOf(const std::string& key);
+
+        void store(const std::string& key, const Http::Response& response, std::string_view head,
+                   std::string_view body);
+        // How long the response is fresh, zero when it is not to be stored
+        std::chrono::seconds freshness(const Http::Response& response) const;
+        void erase(Shard& shard, std::unordered_map<std::string, Slot>::iterator it);
+
+        const std::vector<std::string> varyHeaders_;
+        const size_t maxShardBytes_;
+        const std::chrono::seconds defaultTtl_;
+
+        std::array<Shard, ShardsCount> shards_;
+
+        std::atomic<uint64_t> hits_ { 0 };
+        std::atomic<uint64_t> misses_ { 0 };
+    };
+
+    namespace Routes
+    {
+        // Answers the requests of every route from the cache, once the
+        // middlewares added before it have run. For Router::addMiddleware()
+        Route::Middleware cache(std::shared_ptr<ResponseCache> cache);
+
+        // The handler of a single route, answering from the cache first
+        Route::Handler cached(std::shared_ptr<ResponseCache> cache, Route::Handler handler);
+    } // namespace Routes
+
+} // namespace Pistache::Rest
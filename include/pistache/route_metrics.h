@@ -0,0 +1,167 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* route_metrics.h
+
+   Latency histograms and counters of the routes of a Rest::Router. Every
+   route with metrics counts its requests and their responses, and records
+   two durations: from the start of the request to the call of its handler,
+   and from that call until the response has been written. Each worker
+   thread records to a shard of its own without a lock, the shards are
+   merged when the metrics are read.
+*/
+
+#pragma once
+
+#include <pistache/http.h>
+#include <pistache/http_defs.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Pistache::Rest
+{
+
+    /* Log-linear histogram of durations in microseconds, in the manner of
+     * HdrHistogram: every power of two is split in 16 buckets, a quantile is
+     * then known within 1/16 of its value. Durations beyond MaxValue are
+     * counted in the last bucket.
+     */
+    class LatencyHistogram
+    {
+    public:
+        static constexpr size_t SubBucketBits = 4;
+        static constexpr size_t SubBuckets    = size_t(1) << SubBucketBits;
+        // About 19 hours
+        static constexpr uint64_t MaxValue   = (uint64_t(1) << 36) - 1;
+        static constexpr size_t BucketsCount = (36 - SubBucketBits + 1) * SubBuckets;
+
+        struct Snapshot
+        {
+            std::array<uint64_t, BucketsCount> counts {};
+            uint64_t count = 0;
+            // In microseconds
+            uint64_t sum = 0;
+            uint64_t max = 0;
+
+            // Upper bound of the bucket holding the quantile q, 0 <= q <= 1
+            std::chrono::microseconds quantile(double q) const;
+
+            Snapshot& operator+=(const Snapshot& other);
+        };
+
+        // Safe to call from several threads, although a shard of each is
+        // what keeps it cheap
+        void record(std::chrono::microseconds duration);
+
+        void addTo(Snapshot& snapshot) const;
+
+        static size_t bucketOf(uint64_t value);
+        // Largest value counted in a bucket
+        static uint64_t upperBound(size_t bucket);
+
+    private:
+        std::array<std::atomic<uint64_t>, BucketsCount> counts_ {};
+        std::atomic<uint64_t> sum_ { 0 };
+        std::atomic<uint64_t> max_ { 0 };
+    };
+
+    class RouteMetrics : public Http::ResponseListener
+    {
+    public:
+        // Shards of the worker threads, threads past that share them
+        static constexpr size_t MaxShards = 64;
+
+        struct Snapshot
+        {
+            uint64_t requests = 0;
+            // Responses by class of status, 1xx to 5xx
+            std::array<uint64_t, 5> responses {};
+            // Responses that could not be written
+            uint64_t failed = 0;
+
+            // From the start of the request to the call of its handler
+            LatencyHistogram::Snapshot dispatch;
+            // From that call until the response has been written
+            LatencyHistogram::Snapshot response;
+        };
+
+        RouteMetrics() = default;
+        ~RouteMetrics() override;
+
+        RouteMetrics(const RouteMetrics&) = delete;
+        RouteMetrics& operator=(const RouteMetrics&) = delete;
+
+        // Called by the router as it hands a request to the handler of the
+        // route, the response is then listened to
+        void onDispatch(const Http::Request& request, std::chrono::steady_clock::time_point now);
+
+        void onWritten(Http::Code code, std::chrono::steady_clock::time_point since,
+                       bool written) override;
+
+        Snapshot snapshot() const;
+
+    private:
+        struct alignas(64) Shard
+        {
+            std::atomic<uint64_t> requests { 0 };
+            std::array<std::atomic<uint64_t>, 5> responses {};
+            std::atomic<uint64_t> failed { 0 };
+
+            LatencyHistogram dispatch;
+            LatencyHistogram response;
+        };
+
+        // Shard of the calling thread, created on its first request
+        Shard& shard();
+
+        std::array<std::atomic<Shard*>, MaxShards> shards_ {};
+    };
+
+    /* Metrics of the routes of a router, shared by its copies. Routes added
+     * once Router::enableMetrics() has been called get metrics of their own.
+     */
+    class RouteMetricsRegistry
+    {
+    public:
+        struct Stats
+        {
+            Http::Method method;
+            std::string resource;
+            RouteMetrics::Snapshot metrics;
+        };
+
+        std::shared_ptr<RouteMetrics> add(Http::Method method, const std::string& resource);
+        void remove(Http::Method method, const std::string& resource);
+
+        // Merged metrics of every route, in the order they were added
+        std::vector<Stats> collect() const;
+
+        /* The metrics in the Prometheus text format: counters of requests
+         * and responses, and summaries of the two durations with their
+         * p50, p99 and p999, labelled with the method and the route.
+         */
+        std::string prometheus() const;
+
+    private:
+        struct Entry
+        {
+            Http::Method method;
+            std::string resource;
+            std::shared_ptr<RouteMetrics> metrics;
+        };
+
+        mutable std::mutex lock_;
+        std::vector<Entry> entries_;
+    };
+
+} // namespace Pistache::Rest
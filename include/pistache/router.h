@@ -12,13 +12,27 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <functional>
 #include <memory>
-#include <regex>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <pistache/executor.h>
 #include <pistache/flags.h>
 #include <pistache/http.h>
 #include <pistache/http_defs.h>
@@ -27,15 +41,29 @@ namespace Pistache::Rest
 {
 
     class Description;
+    class RouteMetrics;
+    class RouteMetricsRegistry;
 
     namespace details
     {
+        // Arithmetic types, other than bool and the character types, that
+        // std::from_chars converts
         template <typename T>
+        struct IsCharConvertible
+            : std::bool_constant<(std::is_integral_v<T> && !std::is_same_v<T, bool>
+                                  && !std::is_same_v<T, char> && !std::is_same_v<T, signed char>
+                                  && !std::is_same_v<T, unsigned char>
+                                  && !std::is_same_v<T, wchar_t> && !std::is_same_v<T, char16_t>
+                                  && !std::is_same_v<T, char32_t>)
+                                 || std::is_floating_point_v<T>>
+        { };
+
+        template <typename T, typename Enable = void>
         struct LexicalCast
         {
-            static T cast(const std::string& value)
+            static T cast(std::string_view value)
             {
-                std::istringstream iss(value);
+                std::istringstream iss { std::string(value) };
                 T out;
                 if (!(iss >> out))
                     throw std::runtime_error("Bad lexical cast");
@@ -43,10 +71,33 @@ namespace Pistache::Rest
             }
         };
 
+        // Accepts what the stream extraction did: leading whitespace, an
+        // explicit '+' sign and trailing characters after the number
+        template <typename T>
+        struct LexicalCast<T, std::enable_if_t<IsCharConvertible<T>::value>>
+        {
+            static T cast(std::string_view value)
+            {
+                const char* first = value.data();
+                const char* last  = value.data() + value.size();
+
+                while (first != last && std::isspace(static_cast<unsigned char>(*first)))
+                    ++first;
+                if (first != last && *first == '+')
+                    ++first;
+
+                T out {};
+                auto [ptr, ec] = std::from_chars(first, last, out);
+                if (ec != std::errc() || ptr == first)
+                    throw std::runtime_error("Bad lexical cast");
+                return out;
+            }
+        };
+
         template <>
         struct LexicalCast<std::string>
         {
-            static std::string cast(const std::string& value) { return value; }
+            static std::string cast(std::string_view value) { return std::string(value); }
         };
     } // namespace details
 
@@ -65,6 +116,7 @@ namespace Pistache::Rest
         }
 
         const std::string& name() const { return name_; }
+        std::string_view value() const { return value_; }
 
     private:
         const std::string name_;
@@ -82,15 +134,196 @@ namespace Pistache::Rest
                             NotFound,
                             NotAllowed };
 
-        typedef std::function<Result(const Request, Http::ResponseWriter)> Handler;
+        /* Takes (const Request&, Http::ResponseWriter), as std::function
+         * does, but a callable of up to InlineSize bytes that moves without
+         * throwing is held within the handler: the lambdas of the bind()
+         * overloads are called through a single function pointer, without
+         * an allocation of their own.
+         */
+        class Handler
+        {
+        public:
+            static constexpr size_t InlineSize = 4 * sizeof(void*);
+
+            Handler() noexcept = default;
+            Handler(std::nullptr_t) noexcept { }
+
+            template <typename Func,
+                      typename = std::enable_if_t<
+                          !std::is_same_v<std::decay_t<Func>, Handler>
+                          && std::is_invocable_r_v<Result, std::decay_t<Func>&, const Request&,
+                                                   Http::ResponseWriter>>>
+            Handler(Func&& func)
+            {
+                using Stored = std::decay_t<Func>;
+                static_assert(std::is_copy_constructible_v<Stored>,
+                              "A route handler should be copyable");
+
+                // A null function pointer or an empty std::function
+                if constexpr (std::is_constructible_v<bool, const Stored&>)
+                {
+                    if (!static_cast<bool>(func))
+                        return;
+                }
+
+                if constexpr (isInline<Stored>())
+                    ::new (static_cast<void*>(storage_)) Stored(std::forward<Func>(func));
+                else
+                    *reinterpret_cast<Stored**>(storage_) = new Stored(std::forward<Func>(func));
+
+                invoke_ = &invokeStored<Stored>;
+                manage_ = &manageStored<Stored>;
+            }
+
+            Handler(const Handler& other) { copyFrom(other); }
+
+            Handler(Handler&& other) noexcept { moveFrom(other); }
+
+            Handler& operator=(const Handler& other)
+            {
+                if (&other != this)
+                {
+                    Handler copy(other);
+                    reset();
+                    moveFrom(copy);
+                }
+                return *this;
+            }
+
+            Handler& operator=(Handler&& other) noexcept
+            {
+                if (&other != this)
+                {
+                    reset();
+                    moveFrom(other);
+                }
+                return *this;
+            }
+
+            ~Handler() { reset(); }
+
+            Result operator()(const Request& request, Http::ResponseWriter response) const
+            {
+                if (!invoke_)
+                    throw std::bad_function_call();
+                return invoke_(storage_, request, std::move(response));
+            }
+
+            explicit operator bool() const noexcept { return invoke_ != nullptr; }
+
+            friend bool operator==(const Handler& handler, std::nullptr_t) noexcept
+            {
+                return !handler;
+            }
+            friend bool operator!=(const Handler& handler, std::nullptr_t) noexcept
+            {
+                return static_cast<bool>(handler);
+            }
+
+        private:
+            enum class Operation { Copy,
+                                   Move,
+                                   Destroy };
+
+            using Invoke = Result (*)(unsigned char*, const Request&, Http::ResponseWriter&&);
+            using Manage = void (*)(Operation, unsigned char* to, unsigned char* from);
+
+            template <typename Stored>
+            static constexpr bool isInline()
+            {
+                return sizeof(Stored) <= InlineSize && alignof(Stored) <= alignof(void*)
+                    && std::is_nothrow_move_constructible_v<Stored>;
+            }
+
+            template <typename Stored>
+            static Stored& stored(unsigned char* storage)
+            {
+                if constexpr (isInline<Stored>())
+                    return *std::launder(reinterpret_cast<Stored*>(storage));
+                else
+                    return **reinterpret_cast<Stored**>(storage);
+            }
+
+            template <typename Stored>
+            static Result invokeStored(unsigned char* storage, const Request& request,
+                                       Http::ResponseWriter&& response)
+            {
+                return stored<Stored>(storage)(request, std::move(response));
+            }
+
+            template <typename Stored>
+            static void manageStored(Operation operation, unsigned char* to, unsigned char* from)
+            {
+                if constexpr (isInline<Stored>())
+                {
+                    auto& callable = stored<Stored>(from);
+                    if (operation == Operation::Copy)
+                        ::new (static_cast<void*>(to)) Stored(callable);
+                    else if (operation == Operation::Move)
+                        ::new (static_cast<void*>(to)) Stored(std::move(callable));
+                    if (operation != Operation::Copy)
+                        callable.~Stored();
+                }
+                else
+                {
+                    auto*& callable = *reinterpret_cast<Stored**>(from);
+                    if (operation == Operation::Copy)
+                        *reinterpret_cast<Stored**>(to) = new Stored(*callable);
+                    else if (operation == Operation::Move)
+                        *reinterpret_cast<Stored**>(to) = callable;
+                    else
+                        delete callable;
+                }
+            }
+
+            void copyFrom(const Handler& other)
+            {
+                if (!other.manage_)
+                    return;
+                other.manage_(Operation::Copy, storage_, other.storage_);
+                invoke_ = other.invoke_;
+                manage_ = other.manage_;
+            }
+
+            void moveFrom(Handler& other) noexcept
+            {
+                if (!other.manage_)
+                    return;
+                other.manage_(Operation::Move, storage_, other.storage_);
+                invoke_ = std::exchange(other.invoke_, nullptr);
+                manage_ = std::exchange(other.manage_, nullptr);
+            }
+
+            void reset() noexcept
+            {
+                if (!manage_)
+                    return;
+                manage_(Operation::Destroy, nullptr, storage_);
+                invoke_ = nullptr;
+                manage_ = nullptr;
+            }
+
+            alignas(void*) mutable unsigned char storage_[InlineSize];
+            Invoke invoke_ = nullptr;
+            Manage manage_ = nullptr;
+        };
 
+        // Middlewares also run on the headers of a request expecting
+        // 100-continue, see Router::expectContinue(), and again on the whole
+        // request if none of them rejected it
         typedef std::function<bool(Http::Request& req, Http::ResponseWriter& resp)> Middleware;
 
         typedef std::function<void(const std::shared_ptr<Tcp::Peer>& peer)>
             DisconnectHandler;
 
-        explicit Route(Route::Handler handler)
+        // Takes the body of the requests of a route as it arrives, see
+        // Http::Handler::onBodyStart(). Middlewares do not run before it
+        typedef std::function<std::shared_ptr<Http::BodyReader>(const Request&, Http::BodyFlow)>
+            BodyHandler;
+
+        explicit Route(Route::Handler handler, Route::BodyHandler bodyHandler = nullptr)
             : handler_(std::move(handler))
+            , bodyHandler_(std::move(bodyHandler))
         { }
 
         template <typename... Args>
@@ -100,6 +333,10 @@ namespace Pistache::Rest
         }
 
         Handler handler_;
+        BodyHandler bodyHandler_;
+
+        // Set when the router has metrics enabled, see Router::enableMetrics()
+        std::shared_ptr<RouteMetrics> metrics_;
     };
 
     namespace Private
@@ -107,6 +344,15 @@ namespace Pistache::Rest
         class RouterHandler;
     }
 
+    // Number of known HTTP methods
+    constexpr size_t MethodsCount = 0
+#define METHOD(m, _) +1
+        HTTP_METHODS
+#undef METHOD
+        ;
+
+    using MethodSet = std::bitset<MethodsCount>;
+
     /**
      * A request URI is made of various path segments.
      * Since all routes handled by a router are naturally
@@ -122,6 +368,8 @@ namespace Pistache::Rest
     class SegmentTreeNode
     {
     private:
+        friend class RouteTable;
+
         enum class SegmentType { Fixed,
                                  Param,
                                  Optional,
@@ -144,14 +392,28 @@ namespace Pistache::Rest
         std::shared_ptr<SegmentTreeNode> splat_;
         std::shared_ptr<Route> route_;
 
+        // Methods served by this exact path, see addMethod()
+        MethodSet methods_;
+
+        static SegmentType getSegmentType(const std::string_view& fragment);
+
         /**
-         * Common web servers (nginx, httpd, IIS) collapse multiple
-         * forward slashes to a single one. This regex is used to
-         * obtain the same result.
+         * Walks down to the node of a given path, creating the missing
+         * nodes on the way.
          */
-        static std::regex multiple_slash;
+        SegmentTreeNode& makeNode(const std::string_view& path,
+                                  const std::shared_ptr<char>& resource_reference);
 
-        static SegmentType getSegmentType(const std::string_view& fragment);
+        /**
+         * Walks down to the node of a given path, calls clear on it and
+         * prunes the nodes left empty.
+         * \returns Whether this node is now empty.
+         * \throws std::runtime_error The path does not exist
+         */
+        template <typename Clear>
+        bool removeNode(const std::string_view& path, Clear clear);
+
+        bool isEmpty() const;
 
         /**
          * Fetches the route associated to a given path.
@@ -184,6 +446,18 @@ namespace Pistache::Rest
          */
         static std::string sanitizeResource(const std::string& path);
 
+        /**
+         * Same as above, without allocating when the URL is already clean.
+         * Common web servers (nginx, httpd, IIS) collapse multiple forward
+         * slashes to a single one, which is what this does.
+         * @param path URL to sanitize.
+         * @param storage Holds the sanitized URL when slashes had to be
+         * collapsed.
+         * @return Sanitized URL, either a view into path or into storage.
+         */
+        static std::string_view sanitizeResource(std::string_view path,
+                                                 std::string& storage);
+
         /**
          * Associates a route handler to a given path.
          * \param[in] path Requested resource path. Must have no leading and trailing
@@ -195,10 +469,13 @@ namespace Pistache::Rest
          * - auth//login is invalid
          * \param[in] handler Handler to associate to path.
          * \param[in] resource_reference See SegmentTreeNode::resource_ref_ (private)
+         * \param[in] bodyHandler Takes the body of the requests, if any.
+         * \returns The route added.
          * \throws std::runtime_error An empty path was given
          */
-        void addRoute(const std::string_view& path, const Route::Handler& handler,
-                      const std::shared_ptr<char>& resource_reference);
+        Route& addRoute(const std::string_view& path, const Route::Handler& handler,
+                      const std::shared_ptr<char>& resource_reference,
+                      const Route::BodyHandler& bodyHandler = nullptr);
 
         /**
          * Removes the route handler associated to a given path.
@@ -227,6 +504,111 @@ namespace Pistache::Rest
         std::tuple<std::shared_ptr<Route>, std::vector<TypedParam>,
                    std::vector<TypedParam>>
         findRoute(const std::string_view& path) const;
+
+        /**
+         * Records that a method is served by a given path. A single tree
+         * can then tell every method a requested path could be served with.
+         * \param[in] path Resource path, same format as addRoute.
+         * \param[in] method Method served by the path.
+         * \param[in] resource_reference See SegmentTreeNode::resource_ref_ (private)
+         */
+        void addMethod(const std::string_view& path, Http::Method method,
+                       const std::shared_ptr<char>& resource_reference);
+
+        /**
+         * Reverts addMethod.
+         * \throws std::runtime_error The path does not exist
+         */
+        void removeMethod(const std::string_view& path, Http::Method method);
+
+        /**
+         * Collects, in a single walk, the methods registered with addMethod
+         * for every path pattern matching the requested path.
+         * \param[in] path Requested resource path, same format as findRoute.
+         */
+        MethodSet allowedMethods(const std::string_view& path) const;
+    };
+
+    /**
+     * Read-only, flattened copy of a SegmentTreeNode tree. Nodes, edges and
+     * segment names live in a handful of contiguous arrays, fixed segments
+     * are looked up by binary search and matching does not allocate.
+     * Matching follows the same precedence rules as
+     * SegmentTreeNode::findRoute.
+     */
+    class RouteTable
+    {
+    public:
+        // Maximum number of parameters and splats a single route can have
+        static constexpr size_t MaxCaptures = 16;
+
+        struct Capture
+        {
+            std::string_view name;
+            std::string_view value;
+        };
+
+        /**
+         * Result of a lookup. Parameter names point into the table, values
+         * and splats into the path that was looked up.
+         */
+        struct Match
+        {
+            const Route* route = nullptr;
+
+            std::array<Capture, MaxCaptures> params;
+            size_t paramsCount = 0;
+
+            std::array<std::string_view, MaxCaptures> splats;
+            size_t splatsCount = 0;
+        };
+
+        RouteTable() = default;
+
+        /**
+         * \throws std::runtime_error A route has more than MaxCaptures
+         * parameters and splats
+         */
+        explicit RouteTable(const SegmentTreeNode& root);
+
+        /**
+         * Finds the route for a sanitized path.
+         * \return Whether a route was found, in which case match is filled.
+         */
+        bool find(std::string_view path, Match& match) const;
+
+        bool empty() const;
+
+    private:
+        static constexpr uint32_t None = UINT32_MAX;
+
+        struct Edge
+        {
+            uint32_t nameOffset;
+            uint32_t nameLength;
+            uint32_t child;
+        };
+
+        struct Node
+        {
+            uint32_t fixedBegin    = 0;
+            uint32_t paramBegin    = 0;
+            uint32_t optionalBegin = 0;
+            uint32_t optionalEnd   = 0;
+            uint32_t splat         = None;
+            uint32_t route         = None;
+        };
+
+        uint32_t compile(const SegmentTreeNode& node, size_t depth);
+        uint32_t addName(std::string_view name);
+        std::string_view name(const Edge& edge) const;
+
+        bool find(uint32_t node, std::string_view path, Match& match) const;
+
+        std::vector<Node> nodes_;
+        std::vector<Edge> edges_;
+        std::string names_;
+        std::vector<std::shared_ptr<Route>> routes_;
     };
 
     class Router
@@ -246,8 +628,12 @@ namespace Pistache::Rest
         void patch(const std::string& resource, Route::Handler handler);
         void del(const std::string& resource, Route::Handler handler);
         void options(const std::string& resource, Route::Handler handler);
+        /**
+         * A route with a body handler receives the body of its requests as
+         * it arrives, the handler is then called with an empty body.
+         */
         void addRoute(Http::Method method, const std::string& resource,
-                      Route::Handler handler);
+                      Route::Handler handler, Route::BodyHandler bodyHandler = nullptr);
         void removeRoute(Http::Method method, const std::string& resource);
         void head(const std::string& resource, Route::Handler handler);
 
@@ -259,11 +645,67 @@ namespace Pistache::Rest
         inline bool hasNotFoundHandler() { return notFoundHandler != nullptr; }
         void invokeNotFoundHandler(const Http::Request& req,
                                    Http::ResponseWriter resp) const;
+        void invokeNotFoundHandler(Http::Request&& req,
+                                   Http::ResponseWriter resp) const;
 
         void disconnectPeer(const std::shared_ptr<Tcp::Peer>& peer);
 
         Route::Status route(const Http::Request& request,
                             Http::ResponseWriter response);
+        Route::Status route(Http::Request&& request,
+                            Http::ResponseWriter response);
+
+        // Reader of the route of the request, nullptr when the route buffers
+        // its body
+        std::shared_ptr<Http::BodyReader> bodyReader(const Http::Request& request,
+                                                     Http::BodyFlow flow);
+
+        /**
+         * Decides, from its headers only, whether the body of a request
+         * expecting 100-continue is worth receiving. The middlewares run on
+         * a copy of the request, and a request that no route or custom
+         * handler takes is answered with a 405 or a 404 right away.
+         */
+        bool expectContinue(const Http::Request& request, Http::ResponseWriter& response);
+
+        /**
+         * Compiles the routes into RouteTables that are used for every
+         * subsequent lookup. Routes can not be added or removed once the
+         * router is frozen.
+         */
+        void freeze();
+        bool isFrozen() const;
+
+        /**
+         * Gives the routes added from now on latency histograms and
+         * counters, see RouteMetricsRegistry. The copies of the router
+         * share them.
+         */
+        void enableMetrics();
+        // nullptr until metrics are enabled
+        std::shared_ptr<RouteMetricsRegistry> metrics() const;
+
+        /**
+         * Compiles the routes, as they are now, into a new version of the
+         * routing table and publishes it while the router is serving. Once
+         * published, the requests are only routed with the latest table:
+         * the routes added or removed afterwards take effect together, at
+         * the next publish(). Can be called from any thread, along with
+         * addRoute() and removeRoute().
+         *
+         * A worker thread only reads the version number of the table before
+         * each request, and takes the new table when it changed. A previous
+         * table is released once no worker routes with it anymore, that is
+         * once each of them handled a request since.
+         *
+         * The copies of the router share the published tables, the ones
+         * given to handler() included.
+         *
+         * \throws std::runtime_error The router is frozen
+         */
+        void publish();
+        // Version of the table last published, 0 until publish() is called
+        uint64_t version() const;
 
         Router()
             : routes()
@@ -273,8 +715,56 @@ namespace Pistache::Rest
         { }
 
     private:
+        friend class Private::RouterHandler;
+
+        // A published version of the routes, never modified once built
+        struct Snapshot
+        {
+            uint64_t version = 0;
+            std::unordered_map<Http::Method, RouteTable> tables;
+            bool bodyRoutes = false;
+        };
+
+        struct Published
+        {
+            std::atomic<uint64_t> version { 0 };
+            // Serializes the changes of the routes, and guards current
+            std::mutex lock;
+            std::shared_ptr<const Snapshot> current;
+        };
+
+        // The table a worker routes with, taken again from the published
+        // ones only when a newer version is out
+        struct SnapshotCache
+        {
+            uint64_t version = 0;
+            std::shared_ptr<const Snapshot> snapshot;
+        };
+
+        // nullptr until the routes are published
+        const Snapshot* refresh(SnapshotCache& cache) const;
+
+        Route::Status route(Http::Request&& request, Http::ResponseWriter response,
+                            SnapshotCache& cache);
+        std::shared_ptr<Http::BodyReader> bodyReader(const Http::Request& request,
+                                                     Http::BodyFlow flow, SnapshotCache& cache);
+        bool expectContinue(const Http::Request& request, Http::ResponseWriter& response,
+                            SnapshotCache& cache);
+
+        // Route of a sanitized path, along with its parameters and splats
+        const Route* findRoute(const Snapshot* snapshot, Http::Method method,
+                               std::string_view path, std::vector<TypedParam>& params,
+                               std::vector<TypedParam>& splats);
+
+        // Answers a request that no route takes with a 405, or a 404
+        Route::Status sendUnrouted(const Snapshot* snapshot, Request&& request,
+                                   std::string_view path, Http::ResponseWriter response);
+
         std::unordered_map<Http::Method, SegmentTreeNode> routes;
 
+        // Every route of every method, used to answer with a 405
+        SegmentTreeNode allowedMethods;
+
         std::vector<Route::Handler> customHandlers;
 
         std::vector<Route::Middleware> middlewares;
@@ -282,6 +772,17 @@ namespace Pistache::Rest
         std::vector<Route::DisconnectHandler> disconnectHandlers;
 
         Route::Handler notFoundHandler;
+
+        std::unordered_map<Http::Method, RouteTable> frozenRoutes;
+        bool frozen = false;
+
+        // Whether a route was added with a body handler, the other routers
+        // skip the lookup
+        bool bodyRoutes = false;
+
+        std::shared_ptr<RouteMetricsRegistry> metrics_;
+
+        std::shared_ptr<Published> published_ = std::make_shared<Published>();
     };
 
     namespace Private
@@ -308,11 +809,20 @@ namespace Pistache::Rest
 
             void onRequest(const Http::Request& req,
                            Http::ResponseWriter response) override;
+            void dispatchRequest(Http::Request&& req,
+                                 Http::ResponseWriter response) override;
+
+            std::shared_ptr<Http::BodyReader> onBodyStart(const Http::Request& req,
+                                                          Http::BodyFlow flow) override;
+            bool onExpectContinue(const Http::Request& req,
+                                  Http::ResponseWriter& response) override;
 
             void onDisconnection(const std::shared_ptr<Tcp::Peer>& peer) override;
 
         private:
             std::shared_ptr<Rest::Router> router;
+            // Of this worker, the handler being cloned for each of them
+            Rest::Router::SnapshotCache snapshot;
         };
     } // namespace Private
 
@@ -352,6 +862,22 @@ namespace Pistache::Rest
 
         void NotFound(Router& router, Route::Handler handler);
 
+        /**
+         * Serves the metrics of the routes in the Prometheus text format,
+         * enabling them for the routes added afterwards.
+         */
+        void Metrics(Router& router, const std::string& resource = "/metrics");
+
+        /**
+         * Runs the handler on a thread of the executor, for the routes doing
+         * CPU-heavy work: the worker thread of the connection carries on with
+         * its other peers meanwhile. The handler gets a copy of the request,
+         * its response is queued to the transport of the connection, and the
+         * next requests of a pipelined connection wait for it. An exception
+         * thrown by the handler is answered with a 500.
+         */
+        Route::Handler offload(std::shared_ptr<Executor> executor, Route::Handler handler);
+
         namespace details
         {
             template <typename... Args>
@@ -402,6 +928,20 @@ namespace Pistache::Rest
                 // instantiate template this way
                 [[maybe_unused]] constexpr Checks<Request, Response> checks;
             }
+
+            // The result of a handler bound at compile time, Ok when it
+            // returns none
+            template <typename Call>
+            Route::Result boundResult(Call&& call)
+            {
+                if constexpr (std::is_same_v<std::invoke_result_t<Call>, Route::Result>)
+                    return call();
+                else
+                {
+                    call();
+                    return Route::Result::Ok;
+                }
+            }
         } // namespace details
 
         template <typename Result, typename Cls, typename... Args, typename Obj>
@@ -464,6 +1004,33 @@ namespace Pistache::Rest
             };
         }
 
+        /* Binds a member function known at compile time,
+         * bind<&Cls::handle>(obj), obj being a pointer or a shared_ptr: the
+         * handler holds obj alone and calls the function directly.
+         */
+        template <auto Func, typename Obj>
+        Route::Handler bind(Obj obj)
+        {
+            static_assert(std::is_member_function_pointer_v<decltype(Func)>,
+                          "Function should be a member function of the object");
+
+            return [obj = std::move(obj)](const Rest::Request& request, Http::ResponseWriter response) {
+                return details::boundResult([&] { return ((*obj).*Func)(request, std::move(response)); });
+            };
+        }
+
+        // Binds a free function known at compile time, bind<&handle>()
+        template <auto Func>
+        Route::Handler bind()
+        {
+            static_assert(std::is_invocable_v<decltype(Func), const Rest::Request&, Http::ResponseWriter>,
+                          "Function should accept (const Rest::Request&, HttpResponseWriter)");
+
+            return [](const Rest::Request& request, Http::ResponseWriter response) {
+                return details::boundResult([&] { return Func(request, std::move(response)); });
+            };
+        }
+
         template <typename Cls, typename... Args, typename Obj>
         Route::Middleware middleware(bool (Cls::*func)(Args...), Obj obj)
         {
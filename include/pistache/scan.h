@@ -0,0 +1,70 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* scan.h
+
+   Vectorized byte scanning primitives used by the stream matchers, and the
+   base 64 codec. The best implementation supported by the CPU is picked
+   once, at first use.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Pistache::Scan
+{
+
+    enum class Backend { Scalar,
+                         Sse42,
+                         Avx2,
+                         Neon };
+
+    // Backend used by the functions below
+    Backend activeBackend();
+    bool isSupported(Backend backend);
+
+    // Returns a pointer to the first byte of [begin, end) that is one of the
+    // count bytes of set, or end if there is none
+    const char* findFirstOf(const char* begin, const char* end,
+                            const char* set, size_t count);
+
+    // Same as above, forcing a given backend. The backend must be supported
+    const char* findFirstOf(Backend backend, const char* begin, const char* end,
+                            const char* set, size_t count);
+
+    // XORs the bytes with the 4 bytes of the key, repeated from its byte at
+    // phase on, e.g. the masking of WebSocket frames. Returns the phase of
+    // the byte following the last one, for the next part of the same payload
+    size_t applyMask(char* data, size_t size, const uint8_t key[4], size_t phase = 0);
+
+    // Same as above, forcing a given backend. The backend must be supported
+    size_t applyMask(Backend backend, char* data, size_t size, const uint8_t key[4],
+                     size_t phase = 0);
+
+    // Returns a pointer to the first CR LF sequence of [begin, end), or end if
+    // there is none
+    const char* findCrlf(const char* begin, const char* end);
+
+    // Returned by base64Decode() for an input that is not base 64
+    constexpr size_t Base64Invalid = static_cast<size_t>(-1);
+
+    // Encodes the bytes to padded base 64 (RFC 4648 section 4), writing the
+    // 4 * ceil(size / 3) characters at out. Returns the number of characters
+    size_t base64Encode(const uint8_t* data, size_t size, char* out);
+
+    // Same as above, forcing a given backend. The backend must be supported
+    size_t base64Encode(Backend backend, const uint8_t* data, size_t size, char* out);
+
+    // Decodes base 64, padded or not, writing at most (size + 3) / 4 * 3
+    // bytes at out. Returns the number of bytes, or Base64Invalid
+    size_t base64Decode(const char* data, size_t size, uint8_t* out);
+
+    // Same as above, forcing a given backend. The backend must be supported
+    size_t base64Decode(Backend backend, const char* data, size_t size, uint8_t* out);
+
+} // namespace Pistache::Scan
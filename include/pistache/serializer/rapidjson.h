@@ -15,6 +15,7 @@
 #include <rapidjson/prettywriter.h>
 
 #include <pistache/description.h>
+#include <pistache/http.h>
 #include <pistache/http_defs.h>
 #include <pistache/mime.h>
 
@@ -237,13 +238,15 @@ namespace Pistache::Rest::Serializer
         writer.EndObject();
     }
 
+    // Serialized in the string that is handed over as the body
     inline std::string rapidJson(const Description& desc)
     {
-        rapidjson::StringBuffer sb;
-        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
+        std::string json;
+        Http::JsonOutput output(json);
+        rapidjson::PrettyWriter<Http::JsonOutput> writer(output);
         serializeDescription(writer, desc);
 
-        return sb.GetString();
+        return json;
     }
 
 } // namespace Pistache::Rest::Serializer
@@ -0,0 +1,122 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* sse.h
+
+   Server-sent events (text/event-stream). A channel keeps the streams of its
+   subscribers grouped by the worker serving their connection, and only ever
+   touches them from the thread of that worker: an event is serialized once,
+   and its buffer handed to every worker with subscribers in a single task,
+   instead of a cross-thread write per subscriber.
+*/
+
+#pragma once
+
+#include <pistache/config.h>
+#include <pistache/http.h>
+#include <pistache/stream.h>
+#include <pistache/transport.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Pistache::Http::Sse
+{
+
+    struct Event
+    {
+        Event() = default;
+        explicit Event(std::string data_)
+            : data(std::move(data_))
+        { }
+
+        // Sent as one data field per line
+        std::string data;
+        // Omitted when empty
+        std::string event;
+        std::string id;
+        std::optional<std::chrono::milliseconds> retry;
+
+        // The event in the text/event-stream format, ending with its blank line
+        std::string serialize() const;
+    };
+
+    class Channel : public std::enable_shared_from_this<Channel>
+    {
+    public:
+        // A comment is sent to the subscribers of a worker when it did not
+        // send them anything during that delay, zero disables it
+        static std::shared_ptr<Channel>
+        create(std::chrono::milliseconds heartbeat = Const::DefaultSseHeartbeat);
+
+        Channel(const Channel&)            = delete;
+        Channel& operator=(const Channel&) = delete;
+
+        /* Answers the request with an event stream that the channel keeps
+         * until its connection is closed. The stream is not compressed, its
+         * events are shared with the other subscribers.
+         */
+        void subscribe(ResponseWriter response);
+
+        // Can be called from any thread, the events are sent in order
+        void publish(const Event& event);
+        // A payload already in the text/event-stream format
+        void publish(const SharedBuffer& payload);
+
+        /* Forgets the subscribers of a connection. Their streams are dropped
+         * anyway once the connection is gone, this releases them right away,
+         * from Rest::Router::addDisconnectHandler() for instance.
+         */
+        void disconnect(const std::shared_ptr<Tcp::Peer>& peer);
+
+        // Ends the streams of all the subscribers
+        void close();
+
+        size_t subscribers() const { return subscribers_.load(); }
+
+        std::chrono::milliseconds heartbeat() const { return heartbeat_; }
+
+    private:
+        explicit Channel(std::chrono::milliseconds heartbeat);
+
+        struct Subscriber
+        {
+            std::shared_ptr<ResponseStream> stream;
+            size_t peerId;
+        };
+
+        // The subscribers served by one transport, only used from its thread
+        struct Worker
+        {
+            Tcp::Transport::Poster post;
+            std::vector<Subscriber> subscribers;
+            bool heartbeatArmed = false;
+            // Something was sent since the last heartbeat
+            bool active = false;
+        };
+
+        std::shared_ptr<Worker> worker(Tcp::Transport* transport);
+        // Tasks of the workers, run from their thread
+        void send(Worker& worker, const SharedBuffer& payload);
+        void prune(Worker& worker, size_t peerId);
+        void armHeartbeat(const std::shared_ptr<Worker>& worker, Tcp::Transport* transport);
+
+        const std::chrono::milliseconds heartbeat_;
+        const SharedBuffer heartbeatComment_;
+
+        mutable std::mutex lock_;
+        std::unordered_map<Tcp::Transport*, std::shared_ptr<Worker>> workers_;
+        std::atomic<size_t> subscribers_ { 0 };
+    };
+
+} // namespace Pistache::Http::Sse
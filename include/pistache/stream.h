@@ -12,12 +12,15 @@
 
 #pragma once
 
+#include <pistache/buffer_pool.h>
 #include <pistache/os.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstring>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <stdexcept>
 #include <streambuf>
 #include <string>
@@ -88,41 +91,75 @@ namespace Pistache
             , bytes()
             , maxSize_(maxSize)
         {
-            bytes.clear();
             Base::setg(bytes.data(), bytes.data(), bytes.data() + bytes.size());
         }
 
         template <size_t M>
         explicit ArrayStreamBuf(char (&arr)[M])
+            : bytes(M)
         {
-            bytes.clear();
-            std::copy(arr, arr + M, std::back_inserter(bytes));
+            std::copy(arr, arr + M, bytes.data());
+            bytes.resize(M);
             Base::setg(bytes.data(), bytes.data(), bytes.data() + bytes.size());
         }
 
         bool feed(const char* data, size_t len)
         {
-            if (bytes.size() + len > maxSize_)
+            const size_t used = bytes.size();
+            if (used + len > maxSize_)
             {
                 return false;
             }
+
+            // The storage is taken from the pool on the first feed and grows
+            // up to maxSize_ at most, it is then reused by the following
+            // requests
+            if (used + len > bytes.capacity())
+            {
+                const size_t grown = std::max(bytes.capacity() * 2, InitialCapacity);
+                bytes.reserve(std::min(maxSize_, std::max(used + len, grown)));
+            }
+
             // persist current offset
             size_t readOffset = static_cast<size_t>(this->gptr() - this->eback());
-            std::copy(data, data + len, std::back_inserter(bytes));
+            if (len > 0)
+                std::memcpy(bytes.data() + used, data, len);
+            bytes.resize(used + len);
             Base::setg(bytes.data(), bytes.data() + readOffset,
                        bytes.data() + bytes.size());
             return true;
         }
 
+        // Forgets the content but keeps the storage, unless a large request
+        // made it grow past what is worth retaining on an idle connection
         void reset()
         {
-            std::vector<CharT> nbytes;
-            bytes.swap(nbytes);
+            if (bytes.capacity() > RetainedCapacity)
+                bytes.reset();
+            else
+                bytes.resize(0);
+            Base::setg(bytes.data(), bytes.data(), bytes.data() + bytes.size());
+        }
+
+        // Drops the bytes that have already been read, keeping the rest at
+        // the front of the storage
+        void discardConsumed()
+        {
+            const auto consumed = this->gptr() - this->eback();
+            const size_t left   = bytes.size() - static_cast<size_t>(consumed);
+            if (left > 0)
+                std::memmove(bytes.data(), bytes.data() + consumed, left);
+            bytes.resize(left);
             Base::setg(bytes.data(), bytes.data(), bytes.data() + bytes.size());
         }
 
+        size_t capacity() const { return bytes.capacity(); }
+
     private:
-        std::vector<CharT> bytes;
+        static constexpr size_t InitialCapacity  = Const::MaxBuffer;
+        static constexpr size_t RetainedCapacity = Const::DefaultMaxReceiveBuffer;
+
+        PooledBuffer bytes;
         size_t maxSize_ = Const::MaxBuffer;
     };
 
@@ -148,17 +185,47 @@ namespace Pistache
         size_t length_ = 0;
     };
 
+    // Immutable bytes shared by all the copies of the buffer. A payload
+    // sent to many peers is allocated once, each write only holds a reference
+    class SharedBuffer final
+    {
+    public:
+        SharedBuffer() = default;
+        explicit SharedBuffer(std::string data);
+        SharedBuffer(const char* data, size_t length);
+
+        const char* data() const;
+        size_t size() const;
+        bool empty() const { return size() == 0; }
+
+        // Buffers and pending writes referencing the storage
+        long useCount() const { return data_.use_count(); }
+
+    private:
+        std::shared_ptr<const std::string> data_;
+    };
+
     struct FileBuffer
     {
         explicit FileBuffer(const std::string& fileName);
 
+        // Sends size bytes, from offset on, of a file that already is open.
+        // The descriptor is shared, it is closed along with its last holder.
+        FileBuffer(std::shared_ptr<const Fd> file, size_t size, size_t offset = 0);
+
+        // Takes ownership of the descriptor
+        static std::shared_ptr<const Fd> own(Fd fd);
+
         Fd fd() const;
         size_t size() const;
+        size_t offset() const { return offset_; }
+        const std::shared_ptr<const Fd>& file() const { return fd_; }
 
     private:
         std::string fileName_;
-        Fd fd_;
+        std::shared_ptr<const Fd> fd_;
         size_t size_;
+        size_t offset_ = 0;
     };
 
     class DynamicStreamBuf : public StreamBuf<char>
@@ -168,6 +235,8 @@ namespace Pistache
         using traits_type = typename Base::traits_type;
         using int_type    = typename Base::int_type;
 
+        // No block is taken from the pool until the first write, which
+        // takes one of size bytes
         DynamicStreamBuf(size_t size, size_t maxSize);
 
         DynamicStreamBuf(const DynamicStreamBuf& other)            = delete;
@@ -178,6 +247,10 @@ namespace Pistache
 
         RawBuffer buffer() const;
 
+        // Hands the bytes written over without copying them, the next write
+        // takes another block from the pool
+        PooledBuffer detach();
+
         void clear();
 
         size_t maxSize() const;
@@ -188,8 +261,9 @@ namespace Pistache
     private:
         void reserve(size_t size);
 
-        std::vector<char> data_;
-        size_t maxSize_ = Const::MaxBuffer;
+        PooledBuffer data_;
+        size_t initialSize_ = 0;
+        size_t maxSize_     = Const::MaxBuffer;
     };
 
     class StreamCursor
@@ -303,6 +377,9 @@ namespace Pistache
                      CaseSensitivity cs = CaseSensitivity::Insensitive);
     bool match_until(std::initializer_list<char> chars, StreamCursor& cursor,
                      CaseSensitivity cs = CaseSensitivity::Insensitive);
+    // Moves the cursor to the next CR LF, or to the end of the stream when
+    // there is none, in which case false is returned
+    bool match_until_eol(StreamCursor& cursor);
     bool match_double(double* val, StreamCursor& cursor);
 
     void skip_whitespaces(StreamCursor& cursor);
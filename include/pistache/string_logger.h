@@ -13,8 +13,20 @@
 
 #pragma once
 
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 namespace Pistache::Log
 {
@@ -54,4 +66,123 @@ namespace Pistache::Log
         std::ostream* out_;
     };
 
+    /* Writes the messages from a thread of its own. Every thread that logs
+     * has a ring of its own, that it fills without taking any lock, and the
+     * writer empties the rings in batches, with a single write and flush of
+     * the stream for all of the messages it found.
+     *
+     * A message that does not fit in the ring of its thread, because the
+     * writer is behind, is dropped and counted.
+     */
+    class AsyncStringLogger : public StringLogger
+    {
+    public:
+        static constexpr size_t DefaultRingSize = 64 * 1024;
+        static constexpr std::chrono::milliseconds DefaultInterval { 10 };
+
+        explicit AsyncStringLogger(Level level, std::ostream* out = &std::cerr,
+                                   size_t ringSize                   = DefaultRingSize,
+                                   std::chrono::milliseconds interval = DefaultInterval);
+        // Writes what is left in the rings
+        ~AsyncStringLogger() override;
+
+        AsyncStringLogger(const AsyncStringLogger&) = delete;
+        AsyncStringLogger& operator=(const AsyncStringLogger&) = delete;
+
+        void log(Level level, const std::string& message) override;
+        bool isEnabledFor(Level level) const override;
+
+        // Writes what has been logged so far from the calling thread
+        void flush();
+
+        // Messages dropped since the logger was created
+        uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        struct Ring;
+
+        // Ring of the calling thread, created on its first message
+        Ring* ring();
+        void run();
+        // Called with lock_ held
+        void drain();
+
+        const uint64_t id_;
+        Level level_;
+        std::ostream* out_;
+        size_t ringSize_;
+        std::chrono::milliseconds interval_;
+
+        std::atomic<uint64_t> dropped_ { 0 };
+
+        std::mutex lock_;
+        std::condition_variable wakeup_;
+        bool stop_ = false;
+        std::vector<std::shared_ptr<Ring>> rings_;
+        std::string batch_;
+
+        std::thread writer_;
+    };
+
+    /* Formats the message of the PISTACHE_LOG_STRING_* macros. Strings and
+     * integers are appended to the message as they are, an ostringstream is
+     * only created for the other types and for manipulators, and everything
+     * streamed from then on goes through it.
+     */
+    class MessageBuilder
+    {
+    public:
+        template <typename T>
+        MessageBuilder& operator<<(const T& value)
+        {
+            if (stream_)
+            {
+                *stream_ << value;
+            }
+            else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+            {
+                text_.append(std::string_view(value));
+            }
+            else if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char>
+                               || std::is_same_v<T, unsigned char>)
+            {
+                text_.push_back(static_cast<char>(value));
+            }
+            else if constexpr (std::is_same_v<T, bool>)
+            {
+                text_.push_back(value ? '1' : '0');
+            }
+            else if constexpr (std::is_integral_v<T>)
+            {
+                char digits[48];
+                text_.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+            }
+            else
+            {
+                toStream() << value;
+            }
+            return *this;
+        }
+
+        MessageBuilder& operator<<(std::ostream& (*manipulator)(std::ostream&))
+        {
+            manipulator(toStream());
+            return *this;
+        }
+
+        MessageBuilder& operator<<(std::ios_base& (*manipulator)(std::ios_base&))
+        {
+            manipulator(toStream());
+            return *this;
+        }
+
+        const std::string& str();
+
+    private:
+        std::ostream& toStream();
+
+        std::string text_;
+        std::unique_ptr<std::ostringstream> stream_;
+    };
+
 } // namespace Pistache::Log
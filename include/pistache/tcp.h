@@ -17,6 +17,7 @@
 
 #include <pistache/common.h>
 #include <pistache/flags.h>
+#include <pistache/os.h>
 #include <pistache/prototype.h>
 
 namespace Pistache::Tcp
@@ -34,10 +35,44 @@ namespace Pistache::Tcp
         ReuseAddr   = QuickAck << 1,
         ReusePort   = ReuseAddr << 1,
         CloseOnExec = ReusePort << 1,
+        // Connections are only accepted once their first bytes arrived, see
+        // Const::DeferAcceptTimeout
+        DeferAccept = CloseOnExec << 1,
     };
 
     DECLARE_FLAGS_OPERATORS(Options)
 
+    // What a transport has been handed and not handled yet
+    struct TransportStats
+    {
+        // Writes, timers and peers queued by other threads, waiting for the
+        // next iteration of the loop
+        size_t queuedWrites = 0;
+        size_t queuedTimers = 0;
+        size_t queuedPeers  = 0;
+
+        // Bytes queued for the peers and not yet written to their sockets
+        size_t pendingWriteBytes = 0;
+
+        // Idle peers closed to make room for new ones
+        size_t evictedPeers = 0;
+
+        // Sends with MSG_ZEROCOPY the kernel is done with, and the ones among
+        // them it copied anyway, as it does on the loopback
+        size_t zeroCopySends  = 0;
+        size_t zeroCopyCopied = 0;
+    };
+
+    // Names a peer for the thread of its transport, which owns it: its
+    // descriptor, and its id to tell it from the peers that had the
+    // descriptor before. Transport::findPeer() resolves it with an indexed
+    // load, without the atomic reference counting of a std::shared_ptr
+    struct PeerHandle
+    {
+        Fd fd     = -1;
+        size_t id = 0;
+    };
+
     class Handler : public Prototype<Handler>
     {
     public:
@@ -0,0 +1,90 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* timer_wheel.h
+
+   A hashed timing wheel. Timers are bucketed by the tick at which they
+   expire, so scheduling and cancelling are constant time operations and a
+   single kernel timer is enough to drive any number of them.
+
+   The wheel itself is not thread-safe, callers are expected to provide their
+   own synchronization.
+*/
+
+#pragma once
+
+#include <pistache/config.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace Pistache
+{
+
+    class TimerWheel
+    {
+    public:
+        using Clock    = std::chrono::steady_clock;
+        using TimerId  = uint64_t;
+        using Callback = std::function<void()>;
+
+        static constexpr TimerId InvalidTimer = 0;
+
+        explicit TimerWheel(std::chrono::milliseconds resolution = Const::DefaultTimerWheelResolution,
+                            size_t slots                         = Const::DefaultTimerWheelSlots,
+                            Clock::time_point now                = Clock::now());
+
+        TimerId schedule(std::chrono::milliseconds delay, Callback callback,
+                         Clock::time_point now = Clock::now());
+        bool cancel(TimerId id);
+        bool isScheduled(TimerId id) const;
+
+        // Removes the timers that expired at the given time and returns their
+        // callbacks, so that they can be invoked once the caller released its
+        // locks. They come slot by slot, not sorted by deadline
+        std::vector<Callback> expire(Clock::time_point now = Clock::now());
+
+        // Expires the timers and invokes their callbacks, returns the number of
+        // timers that fired
+        size_t advance(Clock::time_point now = Clock::now());
+
+        // Time left until the next tick holding a timer
+        std::optional<Clock::duration> nextTimeout(Clock::time_point now = Clock::now()) const;
+
+        size_t size() const;
+        bool empty() const;
+
+        std::chrono::milliseconds resolution() const;
+
+    private:
+        struct Entry
+        {
+            TimerId id;
+            Clock::time_point deadline;
+            Callback callback;
+        };
+
+        using Slot = std::list<Entry>;
+
+        uint64_t tickOf(Clock::time_point time) const;
+
+        std::vector<Slot> slots_;
+        std::unordered_map<TimerId, std::pair<size_t, Slot::iterator>> index_;
+
+        std::chrono::milliseconds resolution_;
+        Clock::time_point origin_;
+
+        // Next tick to be processed
+        uint64_t currentTick_ = 0;
+        TimerId nextId_       = 1;
+    };
+
+} // namespace Pistache
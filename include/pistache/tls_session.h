@@ -0,0 +1,95 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* tls_session.h
+
+   Server side state of the TLS sessions. A client reconnecting with the
+   session of a previous connection resumes it with an abbreviated handshake
+   instead of a full one, which spares the asymmetric cryptography.
+
+   The sessions are kept in a TlsSessionStore, keyed by their id. The default
+   TlsSessionCache keeps them in memory, sharded to limit the contention
+   between the workers. Another store, backed by a service shared by several
+   servers, lets a client resume its session on any of them.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace Pistache::Tcp
+{
+
+    // Count of the TLS handshakes completed
+    struct TlsHandshakes
+    {
+        size_t full    = 0;
+        size_t resumed = 0;
+    };
+
+    class TlsSessionStore
+    {
+    public:
+        virtual ~TlsSessionStore() = default;
+
+        // Called from the worker threads, concurrently. The session is opaque
+        // and must be forgotten once the timeout elapsed
+        virtual void put(const std::string& id, std::string session,
+                         std::chrono::seconds timeout)
+            = 0;
+        virtual std::optional<std::string> get(const std::string& id) = 0;
+        virtual void remove(const std::string& id)                      = 0;
+    };
+
+    class TlsSessionCache : public TlsSessionStore
+    {
+    public:
+        static constexpr size_t DefaultMaxSessions = 20 * 1024;
+        static constexpr size_t DefaultShards      = 16;
+
+        explicit TlsSessionCache(size_t maxSessions = DefaultMaxSessions,
+                                 size_t shards      = DefaultShards);
+
+        void put(const std::string& id, std::string session,
+                 std::chrono::seconds timeout) override;
+        std::optional<std::string> get(const std::string& id) override;
+        void remove(const std::string& id) override;
+
+        size_t size() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry
+        {
+            std::string session;
+            Clock::time_point expires;
+            std::list<std::string>::iterator lru;
+        };
+
+        // The oldest sessions of a full shard are evicted first
+        struct Shard
+        {
+            mutable std::mutex lock;
+            std::unordered_map<std::string, Entry> entries;
+            std::list<std::string> lru;
+        };
+
+        Shard& shardOf(const std::string& id);
+
+        size_t maxPerShard_;
+        size_t shardCount_;
+        std::unique_ptr<Shard[]> shards_;
+    };
+
+} // namespace Pistache::Tcp
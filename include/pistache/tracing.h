@@ -0,0 +1,175 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* tracing.h
+
+   Timestamps of the phases of a request: the accept of its connection, its
+   first byte, the end of its headers and of its body, the call of its
+   handler, and the write of its response. They are taken with a cheap
+   clock, the TSC on x86-64, and handed to a Tracer once the response is
+   written. OtlpExporter turns them into OpenTelemetry spans.
+
+   The timestamps are only taken when pistache is compiled with
+   PISTACHE_USE_TRACING, the hooks compile to nothing otherwise.
+*/
+
+#pragma once
+
+#include <pistache/http_defs.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef PISTACHE_USE_TRACING
+#define PISTACHE_TRACE_MARK(ticks) ((ticks) = ::Pistache::Tracing::now())
+#else
+#define PISTACHE_TRACE_MARK(ticks) ((void)0)
+#endif
+
+namespace Pistache::Tracing
+{
+
+    // Zero stands for a phase that was not reached
+    using Ticks = uint64_t;
+
+    // A few nanoseconds, no system call
+    inline Ticks now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __builtin_ia32_rdtsc();
+#else
+        return static_cast<Ticks>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    // Nanoseconds since the epoch, the clock is calibrated on the first
+    // call
+    uint64_t toUnixNanos(Ticks ticks);
+
+    enum class Phase : uint8_t {
+        Accept,
+        FirstByte,
+        HeadersParsed,
+        BodyComplete,
+        Dispatch,
+        Written,
+    };
+
+    constexpr size_t PhasesCount = 6;
+
+    const char* phaseName(Phase phase);
+
+    struct RequestTrace
+    {
+        std::array<Ticks, PhasesCount> at {};
+
+        Ticks& operator[](Phase phase) { return at[static_cast<size_t>(phase)]; }
+        Ticks operator[](Phase phase) const { return at[static_cast<size_t>(phase)]; }
+
+        Http::Method method   = Http::Method::Get;
+        Http::Version version = Http::Version::Http11;
+        std::string resource;
+        Http::Code status = Http::Code::Ok;
+        // False when the response could not be written
+        bool written = false;
+
+        // From the traceparent header of the request, random otherwise
+        std::array<uint8_t, 16> traceId {};
+        std::array<uint8_t, 8> spanId {};
+        // Zero without a traceparent header
+        std::array<uint8_t, 8> parentSpanId {};
+
+        // Takes the ids of a W3C traceparent header, false when it is
+        // malformed. The span id is always generated
+        bool setParent(std::string_view traceparent);
+        void generateIds();
+    };
+
+    // Called from the worker threads as the responses are written
+    class Tracer
+    {
+    public:
+        virtual ~Tracer() = default;
+
+        virtual void onTrace(RequestTrace trace) = 0;
+    };
+
+    /* Exports the traces as OpenTelemetry server spans, in the JSON encoding
+     * of OTLP: every payload is an ExportTraceServiceRequest that can be
+     * posted as is to the /v1/traces of a collector. The span covers the
+     * request from its first phase to the write of its response, every
+     * phase is an event of the span.
+     *
+     * Traces are batched and handed to the sink by a thread of the
+     * exporter, the ones that do not fit the queue are dropped.
+     */
+    class OtlpExporter : public Tracer
+    {
+    public:
+        using Sink = std::function<void(const std::string& payload)>;
+
+        static constexpr size_t DefaultBatchSize = 512;
+        static constexpr std::chrono::milliseconds DefaultInterval { 1000 };
+
+        explicit OtlpExporter(Sink sink, std::string serviceName = "pistache",
+                              size_t batchSize                   = DefaultBatchSize,
+                              std::chrono::milliseconds interval = DefaultInterval);
+        ~OtlpExporter() override;
+
+        OtlpExporter(const OtlpExporter&) = delete;
+        OtlpExporter& operator=(const OtlpExporter&) = delete;
+
+        void onTrace(RequestTrace trace) override;
+
+        // Hands the queued traces to the sink now
+        void flush();
+
+        uint64_t exported() const { return exported_.load(std::memory_order_relaxed); }
+        uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+        static std::string toJson(const std::vector<RequestTrace>& traces,
+                                  const std::string& serviceName);
+
+    private:
+        void run();
+        void exportQueued(std::unique_lock<std::mutex>& lock);
+
+        Sink sink_;
+        std::string serviceName_;
+        size_t batchSize_;
+        std::chrono::milliseconds interval_;
+
+        std::mutex lock_;
+        std::condition_variable wakeup_;
+        std::vector<RequestTrace> queue_;
+        bool stop_ = false;
+        // Serializes the calls to the sink
+        std::mutex sinkLock_;
+
+        std::atomic<uint64_t> exported_ { 0 };
+        std::atomic<uint64_t> dropped_ { 0 };
+
+        std::thread thread_;
+    };
+
+    // A request waiting for its response to be written
+    struct PendingTrace
+    {
+        std::shared_ptr<Tracer> tracer;
+        RequestTrace trace;
+    };
+
+} // namespace Pistache::Tracing
@@ -13,16 +13,22 @@
 #pragma once
 
 #include <pistache/async.h>
+#include <pistache/fd_table.h>
+#include <pistache/file_prefetcher.h>
 #include <pistache/mailbox.h>
 #include <pistache/reactor.h>
 #include <pistache/stream.h>
+#include <pistache/timer_wheel.h>
+#include <pistache/tls_session.h>
 
+#include <atomic>
 #include <chrono>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
-#include <unordered_map>
+#include <vector>
 
 namespace Pistache::Tcp
 {
@@ -33,34 +39,87 @@ namespace Pistache::Tcp
     class Transport : public Aio::Handler
     {
     public:
+        using Acceptor = std::function<std::shared_ptr<Peer>(Fd)>;
         explicit Transport(const std::shared_ptr<Tcp::Handler>& handler);
 
         Transport(const Transport&)            = delete;
         Transport& operator=(const Transport&) = delete;
 
+        ~Transport() override;
+
         void init(const std::shared_ptr<Tcp::Handler>& handler);
 
         void registerPoller(Polling::Epoll& poller) override;
 
         void handleNewPeer(const std::shared_ptr<Peer>& peer);
+
+        // Shuts the sockets of the peers down from the thread of the
+        // transport, they then go away as if the clients had left
+        void disconnectPeers();
+
+        // Accept connections from a listening socket owned by this transport,
+        // the acceptor returns nullptr once there is no pending connection
+        void setListenSocket(Fd fd, Acceptor acceptor);
+
+        // Peers past which the transport stops accepting from its listening
+        // socket, the connections then wait in its backlog until a peer goes
+        // away. Zero, the default, does not bound them
+        void setMaxPeers(size_t value);
+        size_t maxPeers() const;
+
+        // Peers past which the transport closes its least recently active
+        // idle peer, see Peer::isIdle(), for every new one. A transport full
+        // with setMaxPeers() closes one instead of leaving the connections in
+        // its backlog. The peers that are busy are never closed. Zero, the
+        // default, keeps every peer
+        void setIdleEviction(size_t peers);
+        size_t idleEviction() const;
+
+        // Stops accepting from the listening socket of the transport, and
+        // closes every peer once it is idle, the ones that sent nothing yet
+        // included. Can be called from any thread
+        void drain();
         void onReady(const Aio::FdSet& fds) override;
 
+        // The writes and the peers handed over by other threads, looked at
+        // by a busy-polling loop instead of waking it up
+        void onSpin() override;
+
         template <typename Buf>
         Async::Promise<ssize_t> asyncWrite(Fd fd, const Buf& buffer, int flags = 0)
         {
             // Always enqueue reponses for sending. Giving preference to consumer
             // context means chunked responses could be sent out of order.
             return Async::Promise<ssize_t>(
-                [=](Async::Deferred<ssize_t> deferred) mutable {
+                [this, buffer, fd, flags](Async::Deferred<ssize_t> deferred) mutable {
                     BufferHolder holder { buffer };
-                    WriteEntry write(std::move(deferred), std::move(holder), fd, flags);
-                    writesQueue.push(std::move(write));
+                    pushWrite(WriteEntry(std::move(deferred), std::move(holder), fd, flags));
+                });
+        }
+
+        // Takes ownership of the buffer instead of copying it in the write queue
+        Async::Promise<ssize_t> asyncWrite(Fd fd, RawBuffer&& buffer, int flags = 0)
+        {
+            return Async::Promise<ssize_t>(
+                [this, fd, flags, buffer = std::move(buffer)](Async::Deferred<ssize_t> deferred) mutable {
+                    BufferHolder holder { std::move(buffer) };
+                    pushWrite(WriteEntry(std::move(deferred), std::move(holder), fd, flags));
+                });
+        }
+
+        // The block goes back to the pool of the transport once written
+        Async::Promise<ssize_t> asyncWrite(Fd fd, PooledBuffer&& buffer, int flags = 0)
+        {
+            return Async::Promise<ssize_t>(
+                [this, fd, flags, buffer = std::move(buffer)](Async::Deferred<ssize_t> deferred) mutable {
+                    BufferHolder holder { std::move(buffer) };
+                    pushWrite(WriteEntry(std::move(deferred), std::move(holder), fd, flags));
                 });
         }
 
         Async::Promise<rusage> load()
         {
-            return Async::Promise<rusage>([=](Async::Deferred<rusage> deferred) {
+            return Async::Promise<rusage>([this](Async::Deferred<rusage> deferred) {
                 loadRequest_ = std::move(deferred);
                 notifier.notify();
             });
@@ -76,19 +135,170 @@ namespace Pistache::Tcp
 
         void disarmTimer(Fd fd);
 
+        // Timers of the worker timing wheel, all driven by a single timerfd.
+        // The callback is invoked from the thread of the transport, these
+        // functions can be called from any thread
+        TimerWheel::TimerId scheduleTimer(std::chrono::milliseconds delay,
+                                          TimerWheel::Callback callback);
+        bool cancelTimer(TimerWheel::TimerId id);
+        bool isTimerScheduled(TimerWheel::TimerId id) const;
+
+        // Runs the task on the thread of the transport. Can be called from any
+        // thread, the task is queued even when called from that thread
+        void post(std::function<void()> task);
+
+        // Whether the caller runs on the thread of the transport
+        bool isInTransportThread() const;
+
+        // The peer the handle names, nullptr once it is gone. Only from the
+        // thread of the transport, the other threads hold a std::weak_ptr
+        Peer* findPeer(PeerHandle handle) const;
+
+    private:
+        struct Anchor;
+
+    public:
+        // Posts tasks to the transport from objects that may outlive it, the
+        // tasks posted once it has been destroyed are dropped
+        class Poster
+        {
+        public:
+            Poster() = default;
+
+            // False when the task was dropped
+            bool operator()(std::function<void()> task) const;
+            bool alive() const;
+
+        private:
+            friend class Transport;
+            explicit Poster(std::shared_ptr<Anchor> anchor)
+                : anchor_(std::move(anchor))
+            { }
+
+            std::shared_ptr<Anchor> anchor_;
+        };
+
+        Poster poster() const { return Poster(anchor_); }
+
+        // Runs the tasks on the thread of the transport, right away when
+        // already called from it. An executor for Async::Promise::thenOn()
+        class Dispatcher
+        {
+        public:
+            Dispatcher() = default;
+
+            // False when the task was dropped
+            bool operator()(std::function<void()> task) const;
+
+        private:
+            friend class Transport;
+            explicit Dispatcher(std::shared_ptr<Anchor> anchor)
+                : anchor_(std::move(anchor))
+            { }
+
+            std::shared_ptr<Anchor> anchor_;
+        };
+
+        Dispatcher dispatcher() const { return Dispatcher(anchor_); }
+
         std::shared_ptr<Aio::Handler> clone() const override;
 
+        // Sends what has been queued so far instead of waiting for the socket
+        // to be reported writable. Called from another thread, the queues are
+        // flushed from the thread of the transport as soon as it picks it up
         void flush();
+        void flush(Fd fd);
+
+        // Stops reading from the peer until resumeReading(), what it sends
+        // meanwhile waits in the socket and TCP flow control slows it down.
+        // Both are called from the thread of the transport
+        void pauseReading(const std::shared_ptr<Peer>& peer);
+        // Reads again, starting with what arrived while paused
+        void resumeReading(const std::shared_ptr<Peer>& peer);
+
+        // Called as the bytes are spliced with the count still to come, zero
+        // once they all are, or -1 when the file could not be written
+        using SpliceProgress = std::function<void(ssize_t remaining)>;
+
+        /* Moves the next bytes of the peer from its socket to the file with
+         * splice(), through a pipe, without copying them to user space. The
+         * peer is not read meanwhile, a connection that closes before the
+         * end is disconnected as usual. From the thread of the transport,
+         * the splice starts from the next iteration of the loop.
+         *
+         * Returns false when the bytes can not be spliced, for a TLS peer
+         * whose bytes have to be decrypted, the caller then reads them.
+         */
+        bool spliceToFile(const std::shared_ptr<Peer>& peer, std::shared_ptr<const Fd> file,
+                          size_t bytes, SpliceProgress progress);
+
+        // Writes queued while the transport handles a batch of events, the
+        // flushes included, are held back and sent once the batch is done,
+        // coalesced with the other writes of their peer
+        // SO_BUSY_POLL on the sockets of the peers, the kernel then polls
+        // the device queue for that long when a read finds nothing, and
+        // SO_PREFER_BUSY_POLL where available. Zero, the default, leaves
+        // them alone
+        void setSocketBusyPoll(std::chrono::microseconds budget);
+        std::chrono::microseconds socketBusyPoll() const;
+
+        void setAutoCork(bool enabled);
+        bool autoCork() const;
+
+        // Bytes of files sent to a peer before the transport goes back to its
+        // other peers, the rest is sent from the next iteration of the loop
+        void setSendFileBudget(size_t bytes);
+        size_t sendFileBudget() const;
+
+        // Buffers in memory of at least this many bytes are sent with
+        // MSG_ZEROCOPY: the kernel reads them in place instead of copying
+        // them, and the transport holds them until the error queue of the
+        // socket tells they are released. Raised to Const::MinZeroCopySize,
+        // TLS peers are left out. Zero, the default, copies every buffer
+        void setZeroCopyThreshold(size_t bytes);
+        size_t zeroCopyThreshold() const;
+
+        // Bytes of buffers the thread of the transport preallocates in its
+        // pool when it starts
+        void setBufferPool(size_t bytes);
+        size_t bufferPool() const;
+
+        // Parts of files that are not in the page cache are read by the
+        // prefetcher before being sent, instead of blocking the transport in
+        // sendfile(). Null, the default, sends them right away
+        void setFilePrefetcher(std::shared_ptr<FilePrefetcher> prefetcher);
+        const std::shared_ptr<FilePrefetcher>& filePrefetcher() const;
+
+        // The receive buffer starts at Const::MaxBuffer bytes and doubles, up
+        // to this size, every time a read fills it completely
+        void setMaxReceiveBufferSize(size_t size);
+        size_t maxReceiveBufferSize() const;
+
+        // Peers that did not complete their TLS handshake within this delay
+        // after being handed to the transport are closed, zero disables it
+        void setSslHandshakeTimeout(std::chrono::milliseconds timeout);
 
         std::deque<std::shared_ptr<Peer>> getAllPeer();
 
+        // Number of peers handed to this transport and not yet removed, safe
+        // to read from any thread
+        size_t peerCount() const;
+        TlsHandshakes tlsHandshakes() const;
+        // Safe to read from any thread, without messaging the transport
+        TransportStats stats() const;
+
     private:
+        // The write queue of a peer lives on the peer itself
+        friend class Peer;
+
         enum WriteStatus { FirstTry,
                            Retry };
 
         struct BufferHolder
         {
             enum Type { Raw,
+                        Shared,
+                        Pooled,
                         File };
 
             explicit BufferHolder(const RawBuffer& buffer, off_t offset = 0)
@@ -98,54 +308,111 @@ namespace Pistache::Tcp
                 , type(Raw)
             { }
 
-            explicit BufferHolder(const FileBuffer& buffer, off_t offset = 0)
-                : _fd(buffer.fd())
+            explicit BufferHolder(RawBuffer&& buffer, off_t offset = 0)
+                : _raw(std::move(buffer))
+                , size_(_raw.size())
+                , offset_(offset)
+                , type(Raw)
+            { }
+
+            // Holds a reference to the storage, a detached holder keeps
+            // pointing to it instead of copying what is left
+            explicit BufferHolder(const SharedBuffer& buffer, off_t offset = 0)
+                : shared_(buffer)
                 , size_(buffer.size())
                 , offset_(offset)
+                , type(Shared)
+            { }
+
+            explicit BufferHolder(PooledBuffer&& buffer, off_t offset = 0)
+                : pooled_(std::move(buffer))
+                , size_(pooled_.size())
+                , offset_(offset)
+                , type(Pooled)
+            { }
+
+            // The offsets of a file are positions in that file, its size is
+            // the position where the send stops
+            explicit BufferHolder(const FileBuffer& buffer)
+                : file_(buffer.file())
+                , size_(buffer.offset() + buffer.size())
+                , offset_(static_cast<off_t>(buffer.offset()))
+                , start_(buffer.offset())
                 , type(File)
             { }
 
             bool isFile() const { return type == File; }
             bool isRaw() const { return type == Raw; }
+            // Raw, shared and pooled buffers are sent from memory
+            bool inMemory() const { return type != File; }
             size_t size() const { return size_; }
             size_t offset() const { return offset_; }
+            // Where the send began, the count of bytes written starts there
+            size_t start() const { return start_; }
 
             Fd fd() const
             {
                 if (!isFile())
                     throw std::runtime_error("Tried to retrieve fd of a non-filebuffer");
-                return _fd;
+                return *file_;
             }
 
-            RawBuffer raw() const
+            const std::shared_ptr<const Fd>& file() const { return file_; }
+
+            const RawBuffer& raw() const
             {
                 if (!isRaw())
                     throw std::runtime_error("Tried to retrieve raw data of a non-buffer");
                 return _raw;
             }
 
+            // Start of the bytes of a buffer held in memory
+            const char* bytes() const
+            {
+                if (type == Shared)
+                    return shared_.data();
+                if (type == Pooled)
+                    return pooled_.data();
+                if (type == Raw)
+                    return _raw.data().data();
+                throw std::runtime_error("Tried to retrieve the bytes of a file buffer");
+            }
+
+            // Resumes the send at offset, the storage staying where it is
+            void seek(size_t offset) { offset_ = static_cast<off_t>(offset); }
+
             BufferHolder detach(size_t offset = 0)
             {
+                if (type == Shared)
+                    return BufferHolder(shared_, static_cast<off_t>(offset));
+                // The rest of the block stays where it is
+                if (type == Pooled)
+                    return BufferHolder(std::move(pooled_), static_cast<off_t>(offset));
                 if (!isRaw())
-                    return BufferHolder(_fd, size_, offset);
+                    return BufferHolder(file_, size_, offset, start_);
 
                 auto detached = _raw.copy(offset);
                 return BufferHolder(detached);
             }
 
         private:
-            BufferHolder(Fd fd, size_t size, off_t offset = 0)
-                : _fd(fd)
+            BufferHolder(std::shared_ptr<const Fd> file, size_t size, off_t offset, size_t start)
+                : file_(std::move(file))
                 , size_(size)
                 , offset_(offset)
+                , start_(start)
                 , type(File)
             { }
 
             RawBuffer _raw;
-            Fd _fd;
+            SharedBuffer shared_;
+            PooledBuffer pooled_;
+            // Closed along with the last holder, a cached file outlives the write
+            std::shared_ptr<const Fd> file_;
 
             size_t size_  = 0;
             off_t offset_ = 0;
+            size_t start_ = 0;
             Type type;
         };
 
@@ -163,6 +430,9 @@ namespace Pistache::Tcp
             BufferHolder buffer;
             int flags = 0;
             Fd peerFd = -1;
+            // Part of the buffer went out with MSG_ZEROCOPY, the kernel may
+            // still be reading it
+            bool zeroCopy = false;
         };
 
         struct TimerEntry
@@ -194,6 +464,18 @@ namespace Pistache::Tcp
             std::atomic<bool> active;
         };
 
+        // Bytes of a peer on their way to a file
+        struct Splice
+        {
+            std::shared_ptr<const Fd> file;
+            std::shared_ptr<const Fd> pipeIn;
+            std::shared_ptr<const Fd> pipeOut;
+            size_t remaining = 0;
+            // In the pipe, not written to the file yet
+            size_t inPipe = 0;
+            SpliceProgress progress;
+        };
+
         struct PeerEntry
         {
             explicit PeerEntry(std::shared_ptr<Peer> peer_)
@@ -205,23 +487,94 @@ namespace Pistache::Tcp
         using Lock  = std::mutex;
         using Guard = std::lock_guard<Lock>;
 
-        PollableQueue<WriteEntry> writesQueue;
-        std::unordered_map<Fd, std::deque<WriteEntry>> toWrite;
-        Lock toWriteLock;
+        // Writes from the other threads, the thread of the transport moves them
+        // to the queue of their peer
+        PollableRing<WriteEntry> writesQueue;
 
         PollableQueue<TimerEntry> timersQueue;
-        std::unordered_map<Fd, TimerEntry> timers;
+        FdTable<TimerEntry> timers;
+
+        // Every accepted connection goes through it
+        PollableRing<PeerEntry> peersQueue;
 
-        PollableQueue<PeerEntry> peersQueue;
+        PollableQueue<std::function<void()>> tasksQueue;
 
         Async::Deferred<rusage> loadRequest_;
         NotifyFd notifier;
 
         std::shared_ptr<Tcp::Handler> handler_;
 
+        // Shared by all the peers of this transport, since reads all happen on
+        // the reactor thread
+        std::vector<char> recvBuffer_;
+        size_t maxRecvBufferSize_ = Const::DefaultMaxReceiveBuffer;
+
+        std::chrono::milliseconds sslHandshakeTimeout_ = Const::DefaultSSLHandshakeTimeout;
+        FdTable<TimerWheel::TimerId> handshakeTimers_;
+
+        // Peers whose bytes go to a file instead of the handler
+        FdTable<Splice> splices_;
+
+        size_t sendFileBudget_ = Const::DefaultSendFileBudget;
+        std::shared_ptr<FilePrefetcher> prefetcher_;
+        // Cleared when the transport goes away, the prefetches still running
+        // then have nobody to resume
+        struct Anchor
+        {
+            std::mutex lock;
+            Transport* transport;
+        };
+        std::shared_ptr<Anchor> anchor_;
+
+        bool autoCork_ = false;
+        std::chrono::microseconds socketBusyPoll_ { 0 };
+        size_t bufferPoolBytes_ = 0;
+        // Set while onReady() runs in auto-cork mode, the peers that got
+        // their first write of the batch are written to once it is done
+        bool corking_ = false;
+        std::vector<Fd> corked_;
+
+        mutable std::mutex wheelLock_;
+        TimerWheel wheel_;
+        Fd wheelTimerFd_ = -1;
+        std::optional<TimerWheel::Clock::time_point> wheelArmedAt_;
+
+        Fd listenFd_ = -1;
+        Acceptor acceptor_;
+        size_t maxPeers_ = 0;
+        // Set while the listening socket is not polled, the transport being
+        // full
+        bool acceptPaused_ = false;
+
+        // The peers, from the most recently active to the least, linked
+        // through the peers themselves while idle eviction is enabled
+        size_t idleEviction_ = 0;
+        Peer* lruHead_       = nullptr;
+        Peer* lruTail_       = nullptr;
+
+        // Set by drain(), the idle peers are closed until none is left
+        bool draining_ = false;
+        std::atomic<size_t> evictedPeers_ { 0 };
+
+        size_t zeroCopyThreshold_ = 0;
+        std::atomic<size_t> zeroCopySends_ { 0 };
+        std::atomic<size_t> zeroCopyCopied_ { 0 };
+
+        std::atomic<size_t> peerCount_ { 0 };
+        std::atomic<size_t> fullHandshakes_ { 0 };
+        std::atomic<size_t> resumedHandshakes_ { 0 };
+
+        std::atomic<size_t> queuedWrites_ { 0 };
+        std::atomic<size_t> queuedTimers_ { 0 };
+        std::atomic<size_t> queuedPeers_ { 0 };
+        std::atomic<size_t> pendingWriteBytes_ { 0 };
+
     protected:
         void removePeer(const std::shared_ptr<Peer>& peer);
-        std::unordered_map<Fd, std::shared_ptr<Peer>> peers;
+
+        // Indexed by the fd, every readable event is dispatched with a single
+        // lookup
+        FdTable<std::shared_ptr<Peer>> peers;
 
     private:
         bool isPeerFd(Fd fd) const;
@@ -237,16 +590,63 @@ namespace Pistache::Tcp
 
         void armTimerMsImpl(TimerEntry entry);
 
+        // Moves the peer to the front of the list of the peers, and out of it
+        void touchPeer(Peer& peer);
+        void unlinkPeer(Peer& peer);
+        // Closes the least recently active idle peer, false when all of them
+        // are busy
+        bool evictIdlePeer();
+        // Closes the idle peers while draining, again later while some are
+        // left
+        void closeIdlePeers();
+
+        // Sends with MSG_ZEROCOPY the buffers that are large enough, setting
+        // pinned once the kernel holds a part of them
+        ssize_t sendZeroCopy(Peer& peer, const char* buffer, size_t len, int flags,
+                             bool& pinned);
+        // Keeps the buffer until the kernel is done with the last send
+        void holdZeroCopy(Peer& peer, BufferHolder buffer);
+        // Releases the buffers the error queue of the socket tells the kernel
+        // is done with
+        void reapZeroCopy(Peer& peer);
+        // Keeps the buffers of a peer going away for Const::ZeroCopyLinger
+        void lingerZeroCopy(Peer& peer);
+
+        // Queues a write from any thread
+        void pushWrite(WriteEntry write);
+        // Appends to the write queue of the peer, from the thread of the
+        // transport. False when the peer is gone
+        bool enqueueWrite(WriteEntry write);
+
         // This will attempt to drain the write queue for the fd
         void asyncWriteImpl(Fd fd);
+        // Drains the queue of the peer from the next iteration of the loop,
+        // unless the peer is gone by then. Can be called from any thread
+        void resumeWrites(std::weak_ptr<Peer> peer, bool prefetched = false);
+        void flushCorked();
+
+        // Consecutive raw buffers at the front of the queue can be sent with a
+        // single sendmsg() call
+        bool isCoalescable(Fd fd, const std::deque<WriteEntry>& wq) const;
+        // Forgets the writes of the queue, and their bytes
+        void dropWrites(std::deque<WriteEntry>& wq);
+        void unqueueBytes(size_t bytes);
+        bool asyncWriteVectored(Fd fd, std::deque<WriteEntry>& wq);
         ssize_t sendRawBuffer(Fd fd, const char* buffer, size_t len, int flags);
         ssize_t sendFile(Fd fd, Fd file, off_t offset, size_t len);
 
         void handlePeerDisconnection(const std::shared_ptr<Peer>& peer);
+        void handleListenSocket();
+        void handleHandshake(const std::shared_ptr<Peer>& peer);
+        void cancelHandshakeTimer(Fd fd);
+        void handleWheelTimer();
+        void armWheelTimer(std::unique_lock<std::mutex>& lock);
         void handleIncoming(const std::shared_ptr<Peer>& peer);
+        void handleSplice(const std::shared_ptr<Peer>& peer);
         void handleWriteQueue(bool flush = false);
         void handleTimerQueue();
         void handlePeerQueue();
+        void handleTaskQueue();
         void handleNotify();
         void handleTimer(TimerEntry entry);
         void handlePeer(const std::shared_ptr<Peer>& peer);
@@ -0,0 +1,219 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* websocket.h
+
+   WebSocket connections (RFC 6455). A handler answers the upgrade request of
+   a client with upgrade(), the connection is then handed over to a
+   WebSocket::Handler: its bytes are taken as frames from the same transport,
+   instead of being parsed as HTTP requests.
+
+   The frames of the client are unmasked with the vector instructions of the
+   CPU (Scan::applyMask()). The permessage-deflate extension (RFC 7692) is
+   negotiated when the library is built with zlib
+   (PISTACHE_USE_CONTENT_ENCODING_DEFLATE): the compression contexts of a
+   connection are kept from one message to the next.
+*/
+
+#pragma once
+
+#include <pistache/async.h>
+#include <pistache/compression.h>
+#include <pistache/http.h>
+#include <pistache/stream.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace Pistache::Http::Header
+{
+
+    // Fields of the handshake (RFC 6455 11.3)
+    NAMED_CUSTOM_HEADER(Upgrade, "Upgrade")
+    NAMED_CUSTOM_HEADER(SecWebSocketAccept, "Sec-WebSocket-Accept")
+    NAMED_CUSTOM_HEADER(SecWebSocketVersion, "Sec-WebSocket-Version")
+    NAMED_CUSTOM_HEADER(SecWebSocketProtocol, "Sec-WebSocket-Protocol")
+    NAMED_CUSTOM_HEADER(SecWebSocketExtensions, "Sec-WebSocket-Extensions")
+
+} // namespace Pistache::Http::Header
+
+namespace Pistache::Http::WebSocket
+{
+
+    // Appended to the key of the client to compute the accept value
+    static constexpr std::string_view Guid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    enum class Opcode : uint8_t {
+        Continuation = 0x0,
+        Text         = 0x1,
+        Binary       = 0x2,
+        Close        = 0x8,
+        Ping         = 0x9,
+        Pong         = 0xA
+    };
+
+    enum class CloseCode : uint16_t {
+        Normal          = 1000,
+        GoingAway       = 1001,
+        ProtocolError   = 1002,
+        UnsupportedData = 1003,
+        // Not sent, reported when the close frame had no code
+        NoStatus = 1005,
+        // Not sent, reported when the connection went away without a close
+        // frame
+        Abnormal        = 1006,
+        InvalidPayload  = 1007,
+        PolicyViolation = 1008,
+        MessageTooBig   = 1009,
+        InternalError   = 1011
+    };
+
+    struct Options
+    {
+        // Messages of the client larger than this, once reassembled and
+        // decompressed, close the connection
+        size_t maxMessageSize = Const::DefaultMaxWebSocketMessage;
+
+        // Accept the permessage-deflate extension when the client offers it
+        bool compression     = true;
+        int compressionLevel = Compression::DefaultLevel;
+        // Smaller messages are sent as they are. A shared buffer that is
+        // not compressed is written without being copied
+        size_t compressionMinSize = 128;
+
+        // Subprotocol answered in Sec-WebSocket-Protocol, when the client
+        // offered it
+        std::string protocol;
+    };
+
+    class Connection;
+
+    // Called from the thread of the transport serving the connection
+    class Handler
+    {
+    public:
+        virtual ~Handler() = default;
+
+        virtual void onOpen(const std::shared_ptr<Connection>& connection);
+
+        // A complete message, its fragments reassembled and decompressed
+        virtual void onMessage(const std::shared_ptr<Connection>& connection, std::string data,
+                               Opcode opcode)
+            = 0;
+
+        // Called once, when the closing handshake is done or the connection
+        // went away
+        virtual void onClose(const std::shared_ptr<Connection>& connection, CloseCode code,
+                             const std::string& reason);
+    };
+
+    // Sec-WebSocket-Accept value of a key
+    std::string acceptKey(std::string_view key);
+
+    // Whether the request asks for a WebSocket connection
+    bool isUpgrade(const Request& request);
+
+    /* Answers the request with 101 Switching Protocols and hands the
+     * connection over to the handler. A request that is not a valid upgrade
+     * is answered with an error and nullptr is returned.
+     *
+     * Must be called from onRequest(), on the thread of the transport, so
+     * that the first frames of the client are not taken for a request.
+     */
+    std::shared_ptr<Connection> upgrade(const Request& request, ResponseWriter response,
+                                        std::shared_ptr<Handler> handler,
+                                        const Options& options = Options());
+
+    class Connection : public std::enable_shared_from_this<Connection>
+    {
+    public:
+        Connection(const Connection&)            = delete;
+        Connection& operator=(const Connection&) = delete;
+
+        ~Connection();
+
+        /* Sends a message, from any thread. A shared buffer is queued as it
+         * is, along with the header of its frame, so that broadcasting it to
+         * many connections does not copy it. The promises are rejected once
+         * the close frame has been sent.
+         */
+        Async::Promise<ssize_t> send(std::string_view data, Opcode opcode = Opcode::Text);
+        Async::Promise<ssize_t> send(const SharedBuffer& payload, Opcode opcode = Opcode::Text);
+
+        Async::Promise<ssize_t> ping(std::string_view payload = std::string_view());
+
+        // Starts the closing handshake, the connection is closed once the
+        // client answered
+        void close(CloseCode code = CloseCode::Normal, std::string_view reason = std::string_view());
+
+        bool isOpen() const { return !closeSent_.load(); }
+
+        // Whether permessage-deflate has been negotiated
+        bool compressed() const;
+
+        const std::string& protocol() const { return protocol_; }
+
+        std::shared_ptr<Tcp::Peer> peer() const { return peer_.lock(); }
+
+    private:
+        friend class Http::Handler;
+        friend std::shared_ptr<Connection> upgrade(const Request&, ResponseWriter,
+                                                   std::shared_ptr<Handler>, const Options&);
+
+        struct Deflate;
+
+        Connection(Tcp::Transport* transport, const std::shared_ptr<Tcp::Peer>& peer,
+                   std::shared_ptr<Handler> handler, const Options& options);
+
+        // Bytes of the connection, from the thread of the transport
+        void feed(const char* data, size_t size);
+        // The connection went away
+        void disconnected();
+
+        // Handles the frame at the front of the bytes, returns its size or 0
+        // when it is not complete yet
+        size_t parseFrame(const char* data, size_t size);
+        void onMessage();
+        void onControl(Opcode opcode, std::string payload);
+        void fail(CloseCode code, const char* reason);
+        void closed(CloseCode code, const std::string& reason);
+
+        Async::Promise<ssize_t> sendFrame(Opcode opcode, const char* data, size_t size,
+                                          const SharedBuffer* shared);
+        // Closes the TCP connection once the close frame has been written
+        void shutdownAfter(Async::Promise<ssize_t> written);
+
+        Tcp::Transport* transport_;
+        std::weak_ptr<Tcp::Peer> peer_;
+        Fd fd_;
+        std::shared_ptr<Handler> handler_;
+        size_t maxMessageSize_;
+        size_t compressionMinSize_;
+        std::string protocol_;
+
+        // Bytes of a frame not received entirely yet
+        std::string input_;
+        // Fragments of the message being received, Continuation while there
+        // is none
+        std::string message_;
+        Opcode messageOpcode_   = Opcode::Continuation;
+        bool messageCompressed_ = false;
+
+        // Frames of the different threads are queued in one go each
+        std::mutex sendLock_;
+        std::atomic<bool> closeSent_ { false };
+        bool closeReceived_ = false;
+        bool done_          = false;
+
+        std::unique_ptr<Deflate> deflate_;
+    };
+
+} // namespace Pistache::Http::WebSocket
@@ -14,17 +14,35 @@
 #include <pistache/common.h>
 #include <pistache/http.h>
 #include <pistache/net.h>
+#include <pistache/ssl_wrappers.h>
 #include <pistache/stream.h>
 
+#include <arpa/inet.h>
 #include <netdb.h>
 #include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+
+#ifdef PISTACHE_USE_SSL
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#endif /* PISTACHE_USE_SSL */
 
 #include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+
+#include "../common/value_stream.h"
 
 namespace Pistache::Http::Experimental
 {
@@ -42,7 +60,8 @@ namespace Pistache::Http::Experimental
             RawStreamBuf<char> buf(const_cast<char*>(url.data()), url.size());
             StreamCursor cursor(&buf);
 
-            match_string("http://", cursor);
+            if (!match_string("https://", cursor))
+                match_string("http://", cursor);
             match_string("www", cursor);
             match_literal('.', cursor);
 
@@ -54,91 +73,331 @@ namespace Pistache::Http::Experimental
 
             return std::make_pair(host, page);
         }
+
+        // The connections to a host are pooled apart for https, under the
+        // url up to the end of the host
+        std::string_view hostKey(const std::string& url, std::string_view host)
+        {
+            if (url.rfind("https://", 0) == 0)
+                return std::string_view(url.data(), host.data() + host.size() - url.data());
+            return host;
+        }
     } // namespace
 
+#ifdef PISTACHE_USE_SSL
+    struct TlsContext
+    {
+        TlsContext() = default;
+
+        TlsContext(const TlsContext&)            = delete;
+        TlsContext& operator=(const TlsContext&) = delete;
+
+        ~TlsContext()
+        {
+            for (auto& session : sessions)
+                SSL_SESSION_free(session.second);
+        }
+
+        // Keeps the last session of each host, the servers of TLS 1.3 send
+        // them after the handshake
+        void store(const std::string& key, SSL_SESSION* session)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto& slot = sessions[key];
+            if (slot)
+                SSL_SESSION_free(slot);
+            slot = session;
+        }
+
+        // With a reference the caller releases
+        SSL_SESSION* session(const std::string& key)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = sessions.find(key);
+            if (it == sessions.end() || !SSL_SESSION_is_resumable(it->second))
+                return nullptr;
+            SSL_SESSION_up_ref(it->second);
+            return it->second;
+        }
+
+        ssl::SSLCtxPtr ctx;
+        std::mutex lock;
+        std::unordered_map<std::string, SSL_SESSION*> sessions;
+
+        std::atomic<size_t> fullHandshakes { 0 };
+        std::atomic<size_t> resumedHandshakes { 0 };
+    };
+
     namespace
     {
-        template <typename H, typename... Args>
-        void writeHeader(std::stringstream& streamBuf, Args&&... args)
+        // The application data of a SSL object is the key of its session
+        int storeSession(SSL* ssl, SSL_SESSION* session)
         {
-            using Http::crlf;
+            auto* tls = static_cast<TlsContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+            auto* key = static_cast<const std::string*>(SSL_get_app_data(ssl));
+            if (!tls || !key)
+                return 0;
 
-            H header(std::forward<Args>(args)...);
+            tls->store(*key, session);
+            return 1;
+        }
 
-            streamBuf << H::Name << ": ";
-            header.write(streamBuf);
+        std::string tlsErrorString(const char* fallback)
+        {
+            const auto code = ERR_get_error();
+            if (code == 0)
+                return fallback;
 
-            streamBuf << crlf;
+            char buffer[256];
+            ERR_error_string_n(code, buffer, sizeof(buffer));
+            return buffer;
         }
 
-        void writeHeaders(std::stringstream& streamBuf,
-                          const Http::Header::Collection& headers)
+        std::shared_ptr<TlsContext> makeTlsContext(bool verifyPeer,
+                                                   const std::string& certificateAuthority,
+                                                   bool http2)
         {
-            using Http::crlf;
+            auto tls = std::make_shared<TlsContext>();
+            tls->ctx = ssl::SSLCtxPtr(SSL_CTX_new(TLS_client_method()));
+            auto* ctx = ssl::GetSSLContext(tls->ctx);
+            if (!ctx)
+                throw std::runtime_error("Cannot create SSL context: " + tlsErrorString(""));
+
+            SSL_CTX_set_app_data(ctx, tls.get());
+            SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+            // A response without its close_notify is told apart by its framing
+            SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+            SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+            // The sessions are kept per host rather than in the context
+            SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+            SSL_CTX_sess_set_new_cb(ctx, storeSession);
+
+            static constexpr unsigned char Protocols[]      = "\x08http/1.1";
+            static constexpr unsigned char Http2Protocols[] = "\x02h2\x08http/1.1";
+            if (http2)
+                SSL_CTX_set_alpn_protos(ctx, Http2Protocols, sizeof(Http2Protocols) - 1);
+            else
+                SSL_CTX_set_alpn_protos(ctx, Protocols, sizeof(Protocols) - 1);
 
-            for (const auto& header : headers.list())
+            if (verifyPeer)
             {
-                streamBuf << header->name() << ": ";
-                header->write(streamBuf);
-                streamBuf << crlf;
+                const int loaded = certificateAuthority.empty()
+                    ? SSL_CTX_set_default_verify_paths(ctx)
+                    : SSL_CTX_load_verify_locations(ctx, certificateAuthority.c_str(), nullptr);
+                if (loaded != 1)
+                    throw std::runtime_error("Cannot load the certificate authorities: "
+                                             + tlsErrorString(certificateAuthority.c_str()));
+                SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
             }
+            else
+            {
+                SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+            }
+
+            return tls;
+        }
+    } // namespace
+#else
+    struct TlsContext
+    { };
+#endif /* PISTACHE_USE_SSL */
+
+    namespace
+    {
+        using namespace std::literals;
+
+        void appendNumber(std::string& head, uint64_t value)
+        {
+            char digits[std::numeric_limits<uint64_t>::digits10 + 1];
+            auto* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+            head.append(digits, end);
         }
 
-        void writeCookies(std::stringstream& streamBuf,
-                          const Http::CookieJar& cookies)
+        bool writeHeaders(std::string& head, const Http::Header::Collection& headers,
+                          Http::Private::ValueStream& values)
         {
-            using Http::crlf;
+            bool ok = true;
+            const auto typed = [&](const Http::Header::Header& header) {
+                if (!ok)
+                    return;
+
+                head += header.name();
+                head += ": "sv;
+                if (header.name() == Http::Header::ContentLength::Name)
+                {
+                    appendNumber(head, static_cast<const Http::Header::ContentLength&>(header).value());
+                }
+                else
+                {
+                    header.write(values.get());
+                    ok = static_cast<bool>(values.get());
+                }
+                head += "\r\n"sv;
+            };
+            const auto raw = [&](const Http::Header::Raw& header) {
+                head += header.name();
+                head += ": "sv;
+                head += header.value();
+                head += "\r\n"sv;
+            };
+            headers.forEachOnWire(typed, raw);
+
+            return ok;
+        }
 
-            streamBuf << "Cookie: ";
+        void writeCookies(std::string& head, const Http::CookieJar& cookies)
+        {
+            head += "Cookie: "sv;
             bool first = true;
             for (const auto& cookie : cookies)
             {
                 if (!first)
                 {
-                    streamBuf << "; ";
+                    head += "; "sv;
                 }
                 else
                 {
                     first = false;
                 }
-                streamBuf << cookie.name << "=" << cookie.value;
+                head += cookie.name;
+                head += '=';
+                head += cookie.value;
             }
 
-            streamBuf << crlf;
+            head += "\r\n"sv;
         }
 
-        void writeRequest(std::stringstream& streamBuf, const Http::Request& request)
+        // Appends the request line and the headers of a request to its head,
+        // the body is sent from the request itself
+        bool writeRequest(std::string& head, const Http::Request& request)
         {
-            using Http::crlf;
-
             const auto& res         = request.resource();
             const auto [host, path] = splitUrl(res);
             const auto& body        = request.body();
-            const auto& query       = request.query();
+            const auto query        = request.query().as_str();
 
-            auto pathStr = std::string(path);
+            head.reserve(res.size() + query.size() + 256);
 
-            streamBuf << request.method() << " ";
-            if (pathStr[0] != '/')
-                streamBuf << '/';
+            head += Http::methodString(request.method());
+            head += ' ';
+            if (path.empty() || path[0] != '/')
+                head += '/';
 
-            streamBuf << pathStr << query.as_str();
-            streamBuf << " HTTP/1.1" << crlf;
+            head += path;
+            head += query;
+            head += " HTTP/1.1\r\n"sv;
 
-            writeCookies(streamBuf, request.cookies());
-            writeHeaders(streamBuf, request.headers());
+            writeCookies(head, request.cookies());
 
-            writeHeader<Http::Header::UserAgent>(streamBuf, UA);
-            writeHeader<Http::Header::Host>(streamBuf, std::string(host));
-            if (!body.empty())
+            Http::Private::StringAppendBuf appended(head);
+            Http::Private::ValueStream values(appended);
+            if (!writeHeaders(head, request.headers(), values))
+                return false;
+
+            if (!request.headers().has<Http::Header::UserAgent>())
             {
-                writeHeader<Http::Header::ContentLength>(streamBuf, body.size());
+                head += Http::Header::UserAgent::Name;
+                head += ": "sv;
+                head += UA;
+                head += "\r\n"sv;
             }
-            streamBuf << crlf;
+
+            head += Http::Header::Host::Name;
+            head += ": "sv;
+            Http::Header::Host(std::string(host)).write(values.get());
+            if (!values.get())
+                return false;
+            head += "\r\n"sv;
 
             if (!body.empty())
             {
-                streamBuf << body;
+                head += "Content-Length: "sv;
+                appendNumber(head, body.size());
+                head += "\r\n"sv;
+            }
+            head += "\r\n"sv;
+
+            return true;
+        }
+
+        // The header fields of a request sent on an HTTP/2 stream, the
+        // pseudo-header fields first (RFC 9113 8.3.1). The names are
+        // lowercase, the fields specific to HTTP/1 connections are dropped
+        bool writeHttp2Request(std::vector<Hpack::HeaderField>& fields,
+                               const Http::Request& request, bool tls)
+        {
+            const auto& res         = request.resource();
+            const auto [host, path] = splitUrl(res);
+
+            std::string target;
+            if (path.empty() || path[0] != '/')
+                target += '/';
+            target += path;
+            target += request.query().as_str();
+
+            fields.push_back({ ":method", Http::methodString(request.method()) });
+            fields.push_back({ ":scheme", tls ? "https" : "http" });
+            fields.push_back({ ":authority", std::string(host) });
+            fields.push_back({ ":path", std::move(target) });
+
+            const bool hasBody = !request.body().empty();
+            const auto add     = [&](std::string_view name, std::string value) {
+                std::string lowered(name);
+                std::transform(lowered.begin(), lowered.end(), lowered.begin(),
+                               [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                if (lowered == "connection" || lowered == "keep-alive" || lowered == "proxy-connection"
+                    || lowered == "transfer-encoding" || lowered == "upgrade" || lowered == "host"
+                    || (hasBody && lowered == "content-length"))
+                    return;
+                fields.push_back({ std::move(lowered), std::move(value) });
+            };
+
+            std::string value;
+            Http::Private::StringAppendBuf appended(value);
+            Http::Private::ValueStream values(appended);
+            bool ok          = true;
+            const auto typed = [&](const Http::Header::Header& header) {
+                if (!ok)
+                    return;
+                value.clear();
+                header.write(values.get());
+                ok = static_cast<bool>(values.get());
+                add(header.name(), value);
+            };
+            const auto raw = [&](const Http::Header::Raw& header) { add(header.name(), header.value()); };
+            request.headers().forEachOnWire(typed, raw);
+
+            // One field per cookie, they compress better (RFC 9113 8.2.3)
+            for (const auto& cookie : request.cookies())
+                fields.push_back({ "cookie", cookie.name + "=" + cookie.value });
+
+            if (!request.headers().has<Http::Header::UserAgent>())
+                fields.push_back({ "user-agent", UA });
+
+            if (hasBody)
+                fields.push_back({ "content-length", std::to_string(request.body().size()) });
+
+            return ok;
+        }
+
+        // RFC 7230 section 6.3.2: requests with a non-idempotent method
+        // should not have other requests pipelined behind them
+        bool isIdempotent(Http::Method method)
+        {
+            switch (method)
+            {
+            case Http::Method::Get:
+            case Http::Method::Head:
+            case Http::Method::Put:
+            case Http::Method::Delete:
+            case Http::Method::Options:
+            case Http::Method::Trace:
+                return true;
+            default:
+                return false;
             }
         }
     } // namespace
@@ -152,21 +411,72 @@ namespace Pistache::Http::Experimental
         Transport(const Transport&)
             : requestsQueue()
             , connectionsQueue()
+            , tasksQueue()
             , connections()
-            , timeouts()
-            , timeoutsLock()
         { }
 
+        ~Transport() override
+        {
+            if (wheelTimerFd_ != -1)
+                close(wheelTimerFd_);
+        }
+
         void onReady(const Aio::FdSet& fds) override;
         void registerPoller(Polling::Epoll& poller) override;
 
-        Async::Promise<void> asyncConnect(std::shared_ptr<Connection> connection,
+        // Connects the socket, one of the attempts of the connection. From
+        // the thread of the transport, the attempt is started right away
+        Async::Promise<void> asyncConnect(std::shared_ptr<Connection> connection, Fd fd,
                                           const struct sockaddr* address,
                                           socklen_t addr_len);
+        // Stops following an attempt that is in progress, which is rejected.
+        // From the thread of the transport, the socket is left to the caller
+        void abandonConnect(Fd fd);
+
+        // The head of the request and its body are written together, the body
+        // straight from the request. The id is the one of the request on its
+        // connection
+        Async::Promise<ssize_t>
+        asyncSendRequest(std::shared_ptr<Connection> connection, uint64_t id, std::string head,
+                         std::shared_ptr<const Http::Request> request);
 
+        // Same as above, but always goes through the requests queue so that
+        // requests are written in the order they have been queued
         Async::Promise<ssize_t>
-        asyncSendRequest(std::shared_ptr<Connection> connection,
-                         std::shared_ptr<TimerPool::Entry> timer, std::string buffer);
+        asyncQueueRequest(std::shared_ptr<Connection> connection, uint64_t id, std::string head,
+                          std::shared_ptr<const Http::Request> request);
+
+        // Cancels the request from the thread of the transport
+        void cancelRequest(std::shared_ptr<Connection> connection, uint64_t id);
+
+        // The timeouts of the requests of every connection of the transport
+        // are kept on a single timing wheel, driven by a single timerfd
+        TimerWheel::TimerId scheduleTimeout(std::shared_ptr<Connection> connection,
+                                            uint64_t request,
+                                            std::chrono::milliseconds timeout);
+        bool cancelTimeout(TimerWheel::TimerId id);
+        // Any other callback, run from the thread of the transport
+        TimerWheel::TimerId schedule(std::chrono::milliseconds delay, TimerWheel::Callback callback);
+
+        // Closes the connection from the thread of the transport, unless the
+        // server closed it first
+        void closeConnection(std::shared_ptr<Connection> connection, std::function<void()> done);
+
+        // Reads the connection again once its reader resumed, from the thread
+        // of the transport
+        void resumeReading(std::shared_ptr<Connection> connection);
+
+        // Runs the task from the thread of the transport
+        void post(std::function<void()> task);
+
+        // Starts the TLS handshake of a connection that just connected, from
+        // the thread of the transport. It fails after the handshake timeout
+        void startHandshake(std::shared_ptr<Connection> connection);
+
+        // Sends what the HTTP/2 session of the connection framed, from the
+        // thread of the transport. The connection is closed once the session
+        // failed, or once the server went away and its last stream ended
+        void settleHttp2(const std::shared_ptr<Connection>& connection);
 
     private:
         enum WriteStatus { FirstTry,
@@ -175,11 +485,12 @@ namespace Pistache::Http::Experimental
         struct ConnectionEntry
         {
             ConnectionEntry(Async::Resolver resolve, Async::Rejection reject,
-                            std::shared_ptr<Connection> connection,
+                            std::shared_ptr<Connection> connection, Fd fd,
                             const struct sockaddr* _addr, socklen_t _addr_len)
                 : resolve(std::move(resolve))
                 , reject(std::move(reject))
                 , connection(connection)
+                , fd(fd)
                 , addr_len(_addr_len)
             {
                 memcpy(&addr, _addr, addr_len);
@@ -193,6 +504,8 @@ namespace Pistache::Http::Experimental
             Async::Resolver resolve;
             Async::Rejection reject;
             std::weak_ptr<Connection> connection;
+            // The socket of the attempt, the one of the connection once it won
+            Fd fd;
             sockaddr_storage addr;
             socklen_t addr_len;
         };
@@ -200,31 +513,35 @@ namespace Pistache::Http::Experimental
         struct RequestEntry
         {
             RequestEntry(Async::Resolver resolve, Async::Rejection reject,
-                         std::shared_ptr<Connection> connection,
-                         std::shared_ptr<TimerPool::Entry> timer, std::string buf)
+                         std::shared_ptr<Connection> connection, uint64_t id, std::string head,
+                         std::shared_ptr<const Http::Request> request)
                 : resolve(std::move(resolve))
                 , reject(std::move(reject))
                 , connection(connection)
-                , timer(timer)
-                , buffer(std::move(buf))
+                , id(id)
+                , head(std::move(head))
+                , request(std::move(request))
             { }
 
             Async::Resolver resolve;
             Async::Rejection reject;
             std::weak_ptr<Connection> connection;
-            std::shared_ptr<TimerPool::Entry> timer;
-            std::string buffer;
+            uint64_t id;
+            std::string head;
+            // Holds the body, when there is one
+            std::shared_ptr<const Http::Request> request;
         };
 
-        PollableQueue<RequestEntry> requestsQueue;
+        PollableRing<RequestEntry> requestsQueue;
         PollableQueue<ConnectionEntry> connectionsQueue;
+        PollableQueue<std::function<void()>> tasksQueue;
 
         std::unordered_map<Fd, ConnectionEntry> connections;
-        std::unordered_map<Fd, std::weak_ptr<Connection>> timeouts;
 
-        using Lock  = std::mutex;
-        using Guard = std::lock_guard<Lock>;
-        Lock timeoutsLock;
+        mutable std::mutex wheelLock_;
+        TimerWheel wheel_;
+        Fd wheelTimerFd_ = -1;
+        std::optional<TimerWheel::Clock::time_point> wheelArmedAt_;
 
     private:
         void asyncSendRequestImpl(const RequestEntry& req,
@@ -232,10 +549,18 @@ namespace Pistache::Http::Experimental
 
         void handleRequestsQueue();
         void handleConnectionQueue();
+        void connectImpl(ConnectionEntry entry);
+        void handleTaskQueue();
+        void handleWheelTimer();
+        void armWheelTimer(std::unique_lock<std::mutex>& lock);
         void handleReadableEntry(const Aio::FdSet::Entry& entry);
         void handleWritableEntry(const Aio::FdSet::Entry& entry);
         void handleHangupEntry(const Aio::FdSet::Entry& entry);
         void handleIncoming(std::shared_ptr<Connection> connection);
+        void handleHandshake(const std::shared_ptr<Connection>& connection);
+        void failHandshake(const std::shared_ptr<Connection>& connection, const char* error);
+        // Closes an HTTP/2 connection, its requests fail with the error
+        void closeHttp2(const std::shared_ptr<Connection>& connection, const char* error);
     };
 
     void Transport::onReady(const Aio::FdSet& fds)
@@ -250,6 +575,14 @@ namespace Pistache::Http::Experimental
             {
                 handleRequestsQueue();
             }
+            else if (entry.getTag() == tasksQueue.tag())
+            {
+                handleTaskQueue();
+            }
+            else if (wheelTimerFd_ != -1 && entry.getTag() == Polling::Tag(wheelTimerFd_))
+            {
+                handleWheelTimer();
+            }
             else if (entry.isReadable())
             {
                 handleReadableEntry(entry);
@@ -273,31 +606,313 @@ namespace Pistache::Http::Experimental
     {
         requestsQueue.bind(poller);
         connectionsQueue.bind(poller);
+        tasksQueue.bind(poller);
+
+        wheelTimerFd_ = TRY_RET(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC));
+        poller.addFd(wheelTimerFd_, Flags<Polling::NotifyOn>(NotifyOn::Read),
+                     Polling::Tag(wheelTimerFd_));
+
+        std::unique_lock<std::mutex> lock(wheelLock_);
+        armWheelTimer(lock);
+    }
+
+    TimerWheel::TimerId Transport::scheduleTimeout(std::shared_ptr<Connection> connection,
+                                                   uint64_t request,
+                                                   std::chrono::milliseconds timeout)
+    {
+        std::weak_ptr<Connection> weakConn = connection;
+        auto callback                      = [this, weakConn, request]() {
+            auto conn = weakConn.lock();
+            if (!conn)
+                return;
+
+            const auto fd = conn->fd();
+            if (conn->handleTimeout(request))
+                connections.erase(fd);
+        };
+
+        return schedule(timeout, std::move(callback));
+    }
+
+    TimerWheel::TimerId Transport::schedule(std::chrono::milliseconds delay,
+                                            TimerWheel::Callback callback)
+    {
+        std::unique_lock<std::mutex> lock(wheelLock_);
+
+        auto id = wheel_.schedule(delay, std::move(callback));
+        armWheelTimer(lock);
+
+        return id;
+    }
+
+    bool Transport::cancelTimeout(TimerWheel::TimerId id)
+    {
+        // The timerfd is left armed, an early wake-up simply finds nothing to
+        // expire and re-arms it for the next timer
+        std::lock_guard<std::mutex> guard(wheelLock_);
+        return wheel_.cancel(id);
+    }
+
+    void Transport::cancelRequest(std::shared_ptr<Connection> connection, uint64_t id)
+    {
+        tasksQueue.push([this, weakConn = std::weak_ptr<Connection>(connection), id]() {
+            auto conn = weakConn.lock();
+            if (!conn)
+                return;
+
+            if (conn->handleCancel(id))
+                connections.erase(conn->fd());
+        });
+    }
+
+    void Transport::resumeReading(std::shared_ptr<Connection> connection)
+    {
+        tasksQueue.push([this, weakConn = std::weak_ptr<Connection>(connection)]() {
+            auto conn = weakConn.lock();
+            if (conn && connections.find(conn->fd()) != connections.end())
+                handleIncoming(conn);
+        });
+    }
+
+    void Transport::closeConnection(std::shared_ptr<Connection> connection,
+                                    std::function<void()> done)
+    {
+        tasksQueue.push([this, connection = std::move(connection), done = std::move(done)]() {
+            if (connection->isConnected())
+            {
+                connections.erase(connection->fd());
+                connection->close();
+            }
+            done();
+        });
+    }
+
+    void Transport::post(std::function<void()> task) { tasksQueue.push(std::move(task)); }
+
+    void Transport::startHandshake(std::shared_ptr<Connection> connection)
+    {
+        std::string error;
+        if (!connection->startTls(error))
+        {
+            failHandshake(connection, error.c_str());
+            return;
+        }
+
+        std::weak_ptr<Connection> weakConn = connection;
+        connection->handshakeTimer_        = schedule(
+            std::chrono::duration_cast<std::chrono::milliseconds>(Const::DefaultSSLHandshakeTimeout),
+            [this, weakConn]() {
+                auto conn = weakConn.lock();
+                if (!conn)
+                    return;
+
+                conn->handshakeTimer_ = TimerWheel::InvalidTimer;
+                if (conn->isHandshaking())
+                    failHandshake(conn, "TLS handshake timed out");
+            });
+
+        handleHandshake(connection);
+    }
+
+    void Transport::handleHandshake(const std::shared_ptr<Connection>& connection)
+    {
+        std::string error;
+        const auto status = connection->handshake(error);
+        if (status == Connection::Handshake::WantRead)
+            return;
+
+        const auto fd = connection->fd();
+        if (status == Connection::Handshake::WantWrite)
+        {
+            reactor()->modifyFd(key(), fd, NotifyOn::Read | NotifyOn::Write, Polling::Mode::Edge);
+            return;
+        }
+
+        if (connection->handshakeTimer_ != TimerWheel::InvalidTimer)
+        {
+            cancelTimeout(connection->handshakeTimer_);
+            connection->handshakeTimer_ = TimerWheel::InvalidTimer;
+        }
+
+        if (status == Connection::Handshake::Failed)
+        {
+            failHandshake(connection, error.c_str());
+            return;
+        }
+
+        reactor()->modifyFd(key(), fd, NotifyOn::Read, Polling::Mode::Edge);
+        connection->established(std::exchange(connection->onHandshake_, nullptr));
+    }
+
+    void Transport::failHandshake(const std::shared_ptr<Connection>& connection,
+                                  const char* error)
+    {
+        // Forgotten before the socket is closed, its number may be reused
+        connections.erase(connection->fd());
+        connection->close();
+        connection->failConnect(error, std::exchange(connection->onHandshake_, nullptr));
+    }
+
+    void Transport::settleHttp2(const std::shared_ptr<Connection>& connection)
+    {
+        if (!connection->isMultiplexed())
+            return;
+
+        auto* session = connection->h2_.get();
+
+        const auto fd = connection->fd();
+        while (!session->output().empty())
+        {
+            const auto output     = session->output();
+            const ssize_t written = connection->isTls()
+                ? connection->writeTls(output.data(), output.size())
+                : ::send(fd, output.data(), output.size(), MSG_NOSIGNAL);
+            if (written < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    closeHttp2(connection, "Could not send request");
+                    return;
+                }
+
+                // The rest is sent once the socket is writable
+                if (!connection->writeWanted_)
+                {
+                    reactor()->modifyFd(key(), fd, NotifyOn::Read | NotifyOn::Write, Polling::Mode::Edge);
+                    connection->writeWanted_ = true;
+                }
+                return;
+            }
+            session->consume(static_cast<size_t>(written));
+        }
+
+        if (connection->writeWanted_)
+        {
+            reactor()->modifyFd(key(), fd, NotifyOn::Read, Polling::Mode::Edge);
+            connection->writeWanted_ = false;
+        }
+
+        if (session->isFailed())
+        {
+            const std::string error = session->error();
+            closeHttp2(connection, error.c_str());
+            return;
+        }
+
+        // Going away, the next request opens the connection again
+        if (session->isClosed() && session->openStreams() == 0)
+        {
+            closeHttp2(connection, "Connection closed by the server");
+            return;
+        }
+
+        connection->streamLimit_.store(static_cast<uint32_t>(session->maxStreams()),
+                                       std::memory_order_release);
+    }
+
+    void Transport::closeHttp2(const std::shared_ptr<Connection>& connection, const char* error)
+    {
+        // Closed first, the requests released along are then sent on a new
+        // connection rather than on this one
+        const std::string reason = error;
+        connections.erase(connection->fd());
+        connection->close();
+        connection->handleError(reason.c_str());
+    }
+
+    void Transport::handleTaskQueue()
+    {
+        for (;;)
+        {
+            auto task = tasksQueue.popSafe();
+            if (!task)
+                break;
+
+            (*task)();
+        }
+    }
+
+    void Transport::handleWheelTimer()
+    {
+        uint64_t wakeups;
+        (void)::read(wheelTimerFd_, &wakeups, sizeof wakeups);
+
+        std::vector<TimerWheel::Callback> expired;
+        {
+            std::unique_lock<std::mutex> lock(wheelLock_);
+            wheelArmedAt_.reset();
+
+            expired = wheel_.expire();
+            armWheelTimer(lock);
+        }
+
+        for (auto& callback : expired)
+            callback();
+    }
+
+    void Transport::armWheelTimer(std::unique_lock<std::mutex>& /*lock*/)
+    {
+        if (wheelTimerFd_ == -1)
+            return;
+
+        auto now   = TimerWheel::Clock::now();
+        auto delay = wheel_.nextTimeout(now);
+        if (!delay)
+            return;
+
+        // Only move the timer earlier, a later wake-up would be missed
+        auto when = now + *delay;
+        if (wheelArmedAt_ && *wheelArmedAt_ <= when)
+            return;
+
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(*delay);
+        ns      = std::max(ns, std::chrono::nanoseconds(1));
+
+        itimerspec spec {};
+        spec.it_value.tv_sec  = static_cast<time_t>(ns.count() / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(ns.count() % 1000000000);
+
+        TRY(timerfd_settime(wheelTimerFd_, 0, &spec, nullptr));
+        wheelArmedAt_ = when;
     }
 
     Async::Promise<void>
-    Transport::asyncConnect(std::shared_ptr<Connection> connection,
+    Transport::asyncConnect(std::shared_ptr<Connection> connection, Fd fd,
                             const struct sockaddr* address, socklen_t addr_len)
     {
         return Async::Promise<void>(
-            [=](Async::Resolver& resolve, Async::Rejection& reject) {
-                ConnectionEntry entry(std::move(resolve), std::move(reject), connection,
+            [&](Async::Resolver& resolve, Async::Rejection& reject) {
+                ConnectionEntry entry(std::move(resolve), std::move(reject), connection, fd,
                                       address, addr_len);
-                connectionsQueue.push(std::move(entry));
+                if (std::this_thread::get_id() != context().thread())
+                    connectionsQueue.push(std::move(entry));
+                else
+                    connectImpl(std::move(entry));
             });
     }
 
+    void Transport::abandonConnect(Fd fd)
+    {
+        auto connIt = connections.find(fd);
+        if (connIt == std::end(connections))
+            return;
+
+        auto abandoned = std::move(connIt->second);
+        connections.erase(connIt);
+        abandoned.reject(Error("Connection attempt abandoned"));
+    }
+
     Async::Promise<ssize_t>
-    Transport::asyncSendRequest(std::shared_ptr<Connection> connection,
-                                std::shared_ptr<TimerPool::Entry> timer,
-                                std::string buffer)
+    Transport::asyncSendRequest(std::shared_ptr<Connection> connection, uint64_t id,
+                                std::string head,
+                                std::shared_ptr<const Http::Request> request)
     {
 
         return Async::Promise<ssize_t>(
             [&](Async::Resolver& resolve, Async::Rejection& reject) {
                 auto ctx = context();
-                RequestEntry req(std::move(resolve), std::move(reject), connection,
-                                 timer, std::move(buffer));
+                RequestEntry req(std::move(resolve), std::move(reject), connection, id,
+                                 std::move(head), std::move(request));
                 if (std::this_thread::get_id() != ctx.thread())
                 {
                     requestsQueue.push(std::move(req));
@@ -309,22 +924,75 @@ namespace Pistache::Http::Experimental
             });
     }
 
+    Async::Promise<ssize_t>
+    Transport::asyncQueueRequest(std::shared_ptr<Connection> connection, uint64_t id,
+                                 std::string head,
+                                 std::shared_ptr<const Http::Request> request)
+    {
+        return Async::Promise<ssize_t>(
+            [&](Async::Resolver& resolve, Async::Rejection& reject) {
+                requestsQueue.push(RequestEntry(std::move(resolve), std::move(reject),
+                                                connection, id, std::move(head),
+                                                std::move(request)));
+            });
+    }
+
     void Transport::asyncSendRequestImpl(const RequestEntry& req,
                                          WriteStatus status)
     {
-        const auto& buffer = req.buffer;
-        auto conn          = req.connection.lock();
+        auto conn = req.connection.lock();
         if (!conn)
             throw std::runtime_error("Send request error");
 
+        // Its connection might have been closed, and opened again since
+        if (conn->isWithdrawn(req.id))
+        {
+            req.reject(Async::Cancelled());
+            return;
+        }
+
         auto fd = conn->fd();
 
+        const std::string_view parts[] = {
+            req.head, req.request ? std::string_view(req.request->body()) : std::string_view()
+        };
+        const ssize_t len = static_cast<ssize_t>(parts[0].size() + parts[1].size());
+
         ssize_t totalWritten = 0;
         for (;;)
         {
-            const char* data           = buffer.data() + totalWritten;
-            const ssize_t len          = buffer.size() - totalWritten;
-            const ssize_t bytesWritten = ::send(fd, data, len, 0);
+            // What is left of the head, then of the body
+            struct iovec iov[2];
+            size_t iovcnt = 0;
+            size_t offset = static_cast<size_t>(totalWritten);
+            for (auto part : parts)
+            {
+                if (offset >= part.size())
+                {
+                    offset -= part.size();
+                    continue;
+                }
+                iov[iovcnt].iov_base = const_cast<char*>(part.data() + offset);
+                iov[iovcnt].iov_len  = part.size() - offset;
+                ++iovcnt;
+                offset = 0;
+            }
+
+            ssize_t bytesWritten;
+            if (conn->isTls())
+            {
+                // One record after the other
+                bytesWritten = conn->writeTls(static_cast<const char*>(iov[0].iov_base),
+                                              iov[0].iov_len);
+            }
+            else
+            {
+                struct msghdr msg = {};
+                msg.msg_iov       = iov;
+                msg.msg_iovlen    = iovcnt;
+
+                bytesWritten = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+            }
             if (bytesWritten < 0)
             {
                 if (errno == EAGAIN || errno == EWOULDBLOCK)
@@ -346,12 +1014,6 @@ namespace Pistache::Http::Experimental
                 totalWritten += bytesWritten;
                 if (totalWritten == len)
                 {
-                    if (req.timer)
-                    {
-                        Guard guard(timeoutsLock);
-                        timeouts.insert(std::make_pair(req.timer->fd(), conn));
-                        req.timer->registerReactor(key(), reactor());
-                    }
                     req.resolve(totalWritten);
                     break;
                 }
@@ -380,29 +1042,30 @@ namespace Pistache::Http::Experimental
             if (!data)
                 break;
 
-            auto conn = data->connection.lock();
-            if (!conn)
-            {
-                data->reject(Error::system("Failed to connect"));
-                continue;
-            }
+            connectImpl(std::move(*data));
+        }
+    }
 
-            int res = ::connect(conn->fd(), data->getAddr(), data->addr_len);
-            if (res == -1)
-            {
-                if (errno == EINPROGRESS)
-                {
-                    reactor()->registerFdOneShot(key(), conn->fd(),
-                                                 NotifyOn::Write | NotifyOn::Hangup | NotifyOn::Shutdown);
-                }
-                else
-                {
-                    data->reject(Error::system("Failed to connect"));
-                    continue;
-                }
-            }
-            connections.insert(std::make_pair(conn->fd(), std::move(*data)));
+    void Transport::connectImpl(ConnectionEntry entry)
+    {
+        if (entry.connection.expired())
+        {
+            entry.reject(Error::system("Failed to connect"));
+            return;
+        }
+
+        // Even once connected right away, the socket is reported writable
+        int res = ::connect(entry.fd, entry.getAddr(), entry.addr_len);
+        if (res == -1 && errno != EINPROGRESS)
+        {
+            entry.reject(Error::system("Failed to connect"));
+            return;
         }
+
+        reactor()->registerFdOneShot(key(), entry.fd,
+                                     NotifyOn::Write | NotifyOn::Hangup | NotifyOn::Shutdown);
+        const auto fd = entry.fd;
+        connections.insert(std::make_pair(fd, std::move(entry)));
     }
 
     void Transport::handleReadableEntry(const Aio::FdSet::Entry& entry)
@@ -425,20 +1088,6 @@ namespace Pistache::Http::Experimental
                     "Connection error: problem with reading data from server");
             }
         }
-        else
-        {
-            Guard guard(timeoutsLock);
-            auto timerIt = timeouts.find(fd);
-            if (timerIt != std::end(timeouts))
-            {
-                auto connection = timerIt->second.lock();
-                if (connection)
-                {
-                    connection->handleTimeout();
-                    timeouts.erase(fd);
-                }
-            }
-        }
     }
 
     void Transport::handleWritableEntry(const Aio::FdSet::Entry& entry)
@@ -452,15 +1101,40 @@ namespace Pistache::Http::Experimental
         {
             auto& connectionEntry = connIt->second;
             auto connection       = connIt->second.connection.lock();
-            if (connection)
+            if (connection && connection->isHandshaking())
+            {
+                handleHandshake(connection);
+            }
+            else if (connection && connection->isMultiplexed())
             {
+                settleHttp2(connection);
+            }
+            else if (connection)
+            {
+                // A connection that failed is reported writable as well
+                int error          = 0;
+                socklen_t errorLen = sizeof(error);
+                if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLen) == 0 && error != 0)
+                {
+                    auto failed = std::move(connectionEntry);
+                    connections.erase(connIt);
+                    errno = error;
+                    failed.reject(Error::system("Could not connect"));
+                    return;
+                }
+
+                // We are connected, we can start reading data now. The socket
+                // is read until it would block, or until a streamed body is
+                // paused. Registered first, what runs on the resolution may
+                // close it already
+                reactor()->modifyFd(key(), fd, NotifyOn::Read, Polling::Mode::Edge);
                 connectionEntry.resolve();
-                // We are connected, we can start reading data now
-                reactor()->modifyFd(key(), connection->fd(), NotifyOn::Read);
             }
             else
             {
-                connectionEntry.reject(Error::system("Connection lost"));
+                auto lost = std::move(connectionEntry);
+                connections.erase(connIt);
+                lost.reject(Error::system("Connection lost"));
             }
         }
         else
@@ -478,8 +1152,9 @@ namespace Pistache::Http::Experimental
         auto connIt   = connections.find(fd);
         if (connIt != std::end(connections))
         {
-            auto& connectionEntry = connIt->second;
-            connectionEntry.reject(Error::system("Could not connect"));
+            auto failed = std::move(connIt->second);
+            connections.erase(connIt);
+            failed.reject(Error::system("Could not connect"));
         }
         else
         {
@@ -489,25 +1164,47 @@ namespace Pistache::Http::Experimental
 
     void Transport::handleIncoming(std::shared_ptr<Connection> connection)
     {
+        if (connection->isHandshaking())
+        {
+            handleHandshake(connection);
+            return;
+        }
+
         ssize_t totalBytes = 0;
 
         for (;;)
         {
+            if (connection->isReadPaused())
+                break;
+
             char buffer[Const::MaxBuffer] = {
                 0,
             };
-            const ssize_t bytes = recv(connection->fd(), buffer, Const::MaxBuffer, 0);
+            const ssize_t bytes = connection->isTls()
+                ? connection->readTls(buffer, Const::MaxBuffer)
+                : recv(connection->fd(), buffer, Const::MaxBuffer, 0);
             if (bytes == -1)
             {
                 if (errno != EAGAIN && errno != EWOULDBLOCK)
                 {
+                    if (connection->isMultiplexed())
+                    {
+                        closeHttp2(connection, strerror(errno));
+                        return;
+                    }
                     connection->handleError(strerror(errno));
                 }
                 break;
             }
             else if (bytes == 0)
             {
-                if (totalBytes == 0)
+                if (connection->isMultiplexed())
+                {
+                    closeHttp2(connection, "Remote closed connection");
+                    return;
+                }
+
+                if (totalBytes == 0 || connection->isStreaming())
                 {
                     connection->handleError("Remote closed connection");
                 }
@@ -519,338 +1216,1619 @@ namespace Pistache::Http::Experimental
             {
                 totalBytes += bytes;
                 connection->handleResponsePacket(buffer, bytes);
+                if (connection->h2_ && connection->h2_->isFailed())
+                    break;
             }
         }
+
+        // What the frames received called for, WINDOW_UPDATE and SETTINGS
+        // acknowledgments among them
+        if (connection->isMultiplexed())
+            settleHttp2(connection);
     }
 
-    Connection::Connection(size_t maxResponseSize)
+    Connection::Connection(size_t maxResponseSize, size_t pipelineDepth, Http2Mode http2,
+                           size_t maxStreams)
         : fd_(-1)
-        , requestEntry(nullptr)
+        , inflightLock_()
+        , inflight_()
+        , maxResponseSize_(maxResponseSize)
+        , pipelineDepth_(std::max<size_t>(pipelineDepth, 1))
         , parser(maxResponseSize)
+        , http2_(http2)
+        , maxStreams_(std::max<size_t>(maxStreams, 1))
     {
+        // Stops after the headers, in case the body is streamed
+        parser.setHeadFirst(true);
+
         state_.store(static_cast<uint32_t>(State::Idle));
         connectionState_.store(NotConnected);
     }
 
-    void Connection::connect(const Address& addr)
+    struct Connection::ConnectRace
     {
-        struct addrinfo hints;
-        memset(&hints, 0, sizeof(struct addrinfo));
-        hints.ai_family   = addr.family();
-        hints.ai_socktype = SOCK_STREAM; /* Stream socket */
-        hints.ai_flags    = 0;
-        hints.ai_protocol = 0;
+        std::vector<Address> addresses;
+        // Next address to try
+        size_t next = 0;
+        // Sockets of the attempts in progress
+        std::vector<Fd> attempts;
+        // Starts the next attempt once the current one took too long
+        TimerWheel::TimerId timer = TimerWheel::InvalidTimer;
+        std::string error;
+        OnConnected onConnected;
+    };
 
-        const auto& host = addr.host();
-        const auto& port = addr.port().toString();
+    void Connection::connect(const Address& addr, OnConnected onConnected)
+    {
+        connect(std::vector<Address> { addr }, std::move(onConnected));
+    }
 
-        AddrInfo addressInfo;
+    void Connection::connect(std::vector<Address> addresses, OnConnected onConnected)
+    {
+        if (addresses.empty())
+            throw std::invalid_argument("No address to connect to");
 
-        TRY(addressInfo.invoke(host.c_str(), port.c_str(), &hints));
-        const addrinfo* addrs = addressInfo.get_info_ptr();
+        auto race         = std::make_shared<ConnectRace>();
+        race->addresses   = std::move(addresses);
+        race->onConnected = std::move(onConnected);
 
-        int sfd = -1;
+        connectionState_.store(Connecting);
+        transport_->post([self = shared_from_this(), race]() { self->nextAttempt(race); });
+    }
 
-        for (const addrinfo* addr = addrs; addr; addr = addr->ai_next)
+    void Connection::nextAttempt(const std::shared_ptr<ConnectRace>& race)
+    {
+        if (race->timer != TimerWheel::InvalidTimer)
         {
-            sfd = ::socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
-            if (sfd < 0)
-                continue;
+            transport_->cancelTimeout(race->timer);
+            race->timer = TimerWheel::InvalidTimer;
+        }
+
+        while (race->next < race->addresses.size())
+        {
+            const auto& address = race->addresses[race->next++];
 
-            make_non_blocking(sfd);
+            sockaddr_storage storage;
+            socklen_t len = 0;
+            try
+            {
+                len = address.toSockaddr(storage);
+            }
+            catch (const std::exception& e)
+            {
+                race->error = e.what();
+                continue;
+            }
 
-            connectionState_.store(Connecting);
-            fd_ = sfd;
+            const Fd sfd = ::socket(address.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (sfd < 0)
+            {
+                race->error = strerror(errno);
+                continue;
+            }
+            race->attempts.push_back(sfd);
 
+            std::weak_ptr<Connection> weakConn = shared_from_this();
             transport_
-                ->asyncConnect(shared_from_this(), addr->ai_addr, addr->ai_addrlen)
+                ->asyncConnect(shared_from_this(), sfd, reinterpret_cast<sockaddr*>(&storage), len)
                 .then(
-                    [=]() {
-                        socklen_t len = sizeof(saddr);
-                        getsockname(sfd, reinterpret_cast<struct sockaddr*>(&saddr), &len);
-                        connectionState_.store(Connected);
-                        processRequestQueue();
+                    [weakConn, race, sfd]() {
+                        if (auto conn = weakConn.lock())
+                            conn->onAttemptConnected(race, sfd);
                     },
-                    PrintException());
-            break;
+                    [weakConn, race, sfd](std::exception_ptr exc) {
+                        std::string error = "Failed to connect";
+                        try
+                        {
+                            std::rethrow_exception(exc);
+                        }
+                        catch (const std::exception& e)
+                        {
+                            error = e.what();
+                        }
+
+                        if (auto conn = weakConn.lock())
+                            conn->onAttemptFailed(race, sfd, error.c_str());
+                        else
+                            ::close(sfd);
+                    });
+
+            // When the attempt did not fail right away, the next one starts
+            // after the delay unless it fails first
+            const bool running = std::find(race->attempts.begin(), race->attempts.end(), sfd)
+                != race->attempts.end();
+            if (running && race->next < race->addresses.size()
+                && race->timer == TimerWheel::InvalidTimer)
+            {
+                race->timer = transport_->schedule(
+                    Default::ConnectionAttemptDelay, [weakConn, race]() {
+                        race->timer = TimerWheel::InvalidTimer;
+                        if (auto conn = weakConn.lock())
+                            conn->nextAttempt(race);
+                    });
+            }
+            return;
         }
 
-        if (sfd < 0)
-            throw std::runtime_error("Failed to connect");
-    }
+        if (!race->attempts.empty())
+            return;
 
-    std::string Connection::dump() const
-    {
-        std::ostringstream oss;
-        oss << "Connection(fd = " << fd_ << ", src_port = ";
-        oss << ntohs(saddr.sin_port) << ")";
-        return oss.str();
+        // Every address failed
+        failConnect(race->error.c_str(), race->onConnected);
     }
 
-    bool Connection::isIdle() const
+    void Connection::onAttemptConnected(const std::shared_ptr<ConnectRace>& race, Fd fd)
     {
-        return static_cast<Connection::State>(state_.load()) == Connection::State::Idle;
-    }
+        if (race->timer != TimerWheel::InvalidTimer)
+        {
+            transport_->cancelTimeout(race->timer);
+            race->timer = TimerWheel::InvalidTimer;
+        }
+        // No other address is tried past the winner
+        race->next = race->addresses.size();
 
-    bool Connection::tryUse()
-    {
-        auto curState = static_cast<uint32_t>(Connection::State::Idle);
-        auto newState = static_cast<uint32_t>(Connection::State::Used);
-        return state_.compare_exchange_strong(curState, newState);
+        auto losers = std::move(race->attempts);
+        race->attempts.clear();
+        for (Fd loser : losers)
+        {
+            if (loser == fd)
+                continue;
+            transport_->abandonConnect(loser);
+            ::close(loser);
+        }
+
+        fd_           = fd;
+        socklen_t len = sizeof(saddr);
+        getsockname(fd, reinterpret_cast<struct sockaddr*>(&saddr), &len);
+
+        if (tls_)
+        {
+            // Not from within the resolution of the attempt, a failed
+            // handshake forgets its entry
+            onHandshake_ = race->onConnected;
+            transport_->post([self = shared_from_this()]() {
+                self->transport_->startHandshake(self);
+            });
+            return;
+        }
+
+        established(race->onConnected);
     }
 
-    void Connection::setAsIdle()
+    void Connection::established(OnConnected onConnected)
     {
-        state_.store(static_cast<uint32_t>(Connection::State::Idle));
+        connectedAt_.store(std::chrono::steady_clock::now().time_since_epoch().count());
+        if (wantsHttp2())
+            startHttp2();
+        else
+            h2_.reset();
+        connectionState_.store(Connected);
+        processRequestQueue();
+        if (onConnected)
+            onConnected(true);
     }
 
-    bool Connection::isConnected() const
+    bool Connection::wantsHttp2() const
     {
-        return connectionState_.load() == Connected;
+        if (isTls())
+            return alpnHttp2_;
+        return http2_ == Http2Mode::PriorKnowledge;
     }
 
-    void Connection::close()
+    void Connection::startHttp2()
     {
-        connectionState_.store(NotConnected);
-        ::close(fd_);
+        // The session belongs to the connection, and is only fed from the
+        // thread of its transport
+        Http2::ClientSession::Callbacks callbacks;
+        callbacks.onHead = [this](uint32_t stream, const Response& response) {
+            return onStreamHead(stream, response);
+        };
+        callbacks.onData = [this](uint32_t stream, std::string_view data) {
+            onStreamData(stream, data);
+        };
+        callbacks.onResponse = [this](uint32_t stream, Response response) {
+            onStreamResponse(stream, std::move(response));
+        };
+        callbacks.onReset = [this](uint32_t stream, const char* error) {
+            onStreamReset(stream, error);
+        };
+
+        h2_ = std::make_unique<Http2::ClientSession>(std::move(callbacks), maxResponseSize_, maxStreams_);
+        h2_->start();
+        streamLimit_.store(static_cast<uint32_t>(h2_->maxStreams()), std::memory_order_release);
+        multiplexed_.store(true, std::memory_order_release);
+
+        transport_->post([self = shared_from_this()]() {
+            if (self->isMultiplexed())
+                self->transport_->settleHttp2(self);
+        });
     }
 
-    void Connection::associateTransport(
-        const std::shared_ptr<Transport>& transport)
+    void Connection::submitHttp2(uint64_t request, std::vector<Hpack::HeaderField> head,
+                                 std::string body)
     {
-        if (transport_)
-            throw std::runtime_error(
-                "A transport has already been associated to the connection");
+        uint32_t stream = 0;
+        {
+            std::lock_guard<std::mutex> guard(inflightLock_);
+            auto it = std::find_if(inflight_.begin(), inflight_.end(),
+                                   [request](const RequestEntry& entry) {
+                                       return entry.id == request;
+                                   });
+            // Cancelled, timed out or failed along with the connection
+            // before it could be submitted
+            if (it == inflight_.end())
+                return;
 
-        transport_ = transport;
-    }
+            if (isMultiplexed())
+                stream = h2_->submit(std::move(head), std::move(body));
+            it->stream = stream;
+        }
 
-    bool Connection::hasTransport() const { return transport_ != nullptr; }
+        if (stream == 0)
+        {
+            if (auto entry = takeEntry(request))
+            {
+                cancelTimer(*entry);
+                entry->reject(Error(isMultiplexed() ? "The server does not accept new streams" : "Connection closed"));
+                if (entry->onDone)
+                    entry->onDone();
+            }
+            return;
+        }
 
-    Fd Connection::fd() const
+        streams_[stream].request = request;
+        transport_->settleHttp2(shared_from_this());
+    }
+
+    std::optional<Connection::RequestEntry> Connection::takeEntry(uint64_t request)
     {
-        assert(fd_ != -1);
-        return fd_;
+        std::lock_guard<std::mutex> guard(inflightLock_);
+        auto it = std::find_if(inflight_.begin(), inflight_.end(),
+                               [request](const RequestEntry& entry) {
+                                   return entry.id == request;
+                               });
+        if (it == inflight_.end())
+            return std::nullopt;
+
+        std::optional<RequestEntry> entry(std::move(*it));
+        inflight_.erase(it);
+        return entry;
     }
 
-    void Connection::handleResponsePacket(const char* buffer, size_t totalBytes)
+    bool Connection::onStreamHead(uint32_t stream, const Response& response)
     {
-        try
+        auto it = streams_.find(stream);
+        if (it == streams_.end())
+            return false;
+
+        BodyStart bodyStart;
         {
-            const bool result = parser.feed(buffer, totalBytes);
-            if (!result)
+            std::lock_guard<std::mutex> guard(inflightLock_);
+            for (const auto& entry : inflight_)
             {
-                handleError("Client: Too long packet");
-                return;
+                if (entry.id == it->second.request)
+                    bodyStart = entry.bodyStart;
             }
-            if (parser.parse() == Private::State::Done)
-            {
-                if (requestEntry)
-                {
-                    if (requestEntry->timer)
-                    {
-                        requestEntry->timer->disarm();
-                        timerPool_.releaseTimer(requestEntry->timer);
-                    }
+        }
+        if (!bodyStart)
+            return false;
+
+        auto reader = bodyStart(response, ResponseFlow(weak_from_this(), stream));
+        if (!reader)
+            return false;
+
+        // Resolved right away, the body goes to the reader
+        auto entry = takeEntry(it->second.request);
+        if (!entry)
+            return false;
+
+        cancelTimer(*entry);
+        it->second.reader = std::move(reader);
+        it->second.onDone = std::move(entry->onDone);
+        entry->resolve(response);
+        return true;
+    }
 
-                    requestEntry->resolve(std::move(parser.response));
-                    parser.reset();
+    void Connection::onStreamData(uint32_t stream, std::string_view data)
+    {
+        auto it = streams_.find(stream);
+        if (it != streams_.end() && it->second.reader)
+            it->second.reader->onData(data);
+    }
 
-                    auto onDone = requestEntry->onDone;
+    void Connection::onStreamResponse(uint32_t stream, Response response)
+    {
+        auto it = streams_.find(stream);
+        if (it == streams_.end())
+            return;
 
-                    requestEntry.reset(nullptr);
+        auto state = std::move(it->second);
+        streams_.erase(it);
 
-                    if (onDone)
-                        onDone();
-                }
-            }
-        }
-        catch (const std::exception& ex)
+        if (state.reader)
         {
-            handleError(ex.what());
+            state.reader->onEnd();
+            if (state.onDone)
+                state.onDone();
+            return;
         }
+
+        auto entry = takeEntry(state.request);
+        if (!entry)
+            return;
+
+        cancelTimer(*entry);
+        entry->resolve(std::move(response));
+        if (entry->onDone)
+            entry->onDone();
     }
 
-    void Connection::handleError(const char* error)
+    void Connection::onStreamReset(uint32_t stream, const char* error)
     {
-        if (requestEntry)
+        auto it = streams_.find(stream);
+        if (it == streams_.end())
+            return;
+
+        auto state = std::move(it->second);
+        streams_.erase(it);
+
+        if (state.reader)
         {
-            if (requestEntry->timer)
-            {
-                requestEntry->timer->disarm();
-                timerPool_.releaseTimer(requestEntry->timer);
-            }
+            state.reader->onError(error);
+            if (state.onDone)
+                state.onDone();
+            return;
+        }
+
+        auto entry = takeEntry(state.request);
+        if (!entry)
+            return;
 
-            auto onDone = requestEntry->onDone;
+        cancelTimer(*entry);
+        entry->reject(Error(error));
+        if (entry->onDone)
+            entry->onDone();
+    }
 
-            requestEntry->reject(Error(error));
+    void Connection::pauseStream(uint32_t stream, bool paused)
+    {
+        // Posted, a reader pausing from onData() does not reenter the session
+        transport_->post([self = shared_from_this(), stream, paused]() {
+            if (!self->isMultiplexed())
+                return;
 
-            requestEntry.reset(nullptr);
+            if (paused)
+                self->h2_->pause(stream);
+            else
+                self->h2_->resume(stream);
+            self->transport_->settleHttp2(self);
+        });
+    }
 
-            if (onDone)
-                onDone();
-        }
+    void Connection::failConnect(const char* error, OnConnected onConnected)
+    {
+        connectionState_.store(NotConnected);
+        rejectPendingRequests(error);
+        if (onConnected)
+            onConnected(false);
     }
 
-    void Connection::handleTimeout()
+    void Connection::onAttemptFailed(const std::shared_ptr<ConnectRace>& race, Fd fd,
+                                     const char* error)
     {
-        if (requestEntry)
-        {
-            requestEntry->timer->disarm();
-            timerPool_.releaseTimer(requestEntry->timer);
+        // Abandoned, its socket already is closed
+        auto it = std::find(race->attempts.begin(), race->attempts.end(), fd);
+        if (it == race->attempts.end())
+            return;
 
-            auto onDone = requestEntry->onDone;
+        race->attempts.erase(it);
+        ::close(fd);
+        race->error = error;
 
-            /* @API: create a TimeoutException */
-            requestEntry->reject(std::runtime_error("Timeout"));
+        // The next address is tried right away
+        nextAttempt(race);
+    }
 
-            requestEntry.reset(nullptr);
+    std::string Connection::dump() const
+    {
+        in_port_t port = 0;
+        if (saddr.ss_family == AF_INET6)
+            port = reinterpret_cast<const sockaddr_in6*>(&saddr)->sin6_port;
+        else if (saddr.ss_family == AF_INET)
+            port = reinterpret_cast<const sockaddr_in*>(&saddr)->sin_port;
 
-            if (onDone)
-                onDone();
-        }
+        std::ostringstream oss;
+        oss << "Connection(fd = " << fd_ << ", src_port = ";
+        oss << ntohs(port) << ")";
+        return oss.str();
     }
 
-    Async::Promise<Response> Connection::perform(const Http::Request& request,
-                                                 Connection::OnDone onDone)
+    bool Connection::isIdle() const
     {
-        return Async::Promise<Response>(
-            [=](Async::Resolver& resolve, Async::Rejection& reject) {
-                performImpl(request, std::move(resolve), std::move(reject),
-                            std::move(onDone));
-            });
+        return state_.load() == static_cast<uint32_t>(Connection::State::Idle);
     }
 
-    Async::Promise<Response> Connection::asyncPerform(const Http::Request& request,
-                                                      Connection::OnDone onDone)
+    bool Connection::tryUse(bool exclusive)
     {
-        return Async::Promise<Response>(
-            [=](Async::Resolver& resolve, Async::Rejection& reject) {
-                requestsQueue.push(RequestData(std::move(resolve), std::move(reject),
-                                               request, std::move(onDone)));
-            });
+        auto curState = static_cast<uint32_t>(Connection::State::Idle);
+        auto newState = static_cast<uint32_t>(Connection::State::Used);
+        if (exclusive)
+            newState |= Connection::State::Exclusive;
+        return state_.compare_exchange_strong(curState, newState);
     }
 
-    void Connection::performImpl(const Http::Request& request,
-                                 Async::Resolver resolve, Async::Rejection reject,
-                                 Connection::OnDone onDone)
+    bool Connection::tryPipeline()
     {
+        if (!isConnected())
+            return false;
 
-        std::stringstream streamBuf;
-        writeRequest(streamBuf, request);
-        if (!streamBuf)
-            reject(std::runtime_error("Could not write request"));
-        std::string buffer = streamBuf.str();
+        // The requests of an HTTP/2 connection do not wait for each other,
+        // even an exclusive one
+        const bool multiplexed = isMultiplexed();
+        const size_t limit     = multiplexed ? streamLimit_.load(std::memory_order_acquire) : pipelineDepth_;
 
-        std::shared_ptr<TimerPool::Entry> timer(nullptr);
-        auto timeout = request.timeout();
-        if (timeout.count() > 0)
+        auto curState = state_.load();
+        for (;;)
         {
-            timer = timerPool_.pickTimer();
-            timer->arm(timeout);
+            const auto count = curState & ~static_cast<uint32_t>(Connection::State::Exclusive);
+            if (curState == Connection::State::Idle
+                || (!multiplexed && (curState & Connection::State::Exclusive) != 0)
+                || count >= limit)
+                return false;
+
+            if (state_.compare_exchange_weak(curState, curState + 1))
+                return true;
         }
-
-        requestEntry = std::make_unique<RequestEntry>(std::move(resolve), std::move(reject),
-                                                      timer, std::move(onDone));
-        transport_->asyncSendRequest(shared_from_this(), timer, std::move(buffer));
     }
 
-    void Connection::processRequestQueue()
+    bool Connection::tryRelease()
     {
+        auto curState = state_.load();
         for (;;)
         {
-            auto req = requestsQueue.popSafe();
-            if (!req)
-                break;
-
-            performImpl(req->request, std::move(req->resolve), std::move(req->reject),
-                        std::move(req->onDone));
+            const auto count = curState & ~static_cast<uint32_t>(Connection::State::Exclusive);
+            if (count == 0)
+                return false;
+
+            // Releasing the last request also clears the Exclusive flag
+            const auto newState = count == 1
+                ? static_cast<uint32_t>(Connection::State::Idle)
+                : curState - 1;
+            if (state_.compare_exchange_weak(curState, newState))
+                return count == 1;
         }
     }
 
-    void ConnectionPool::init(size_t maxConnectionsPerHost,
-                              size_t maxResponseSize)
+    void Connection::setAsIdle()
     {
-        this->maxConnectionsPerHost = maxConnectionsPerHost;
-        this->maxResponseSize       = maxResponseSize;
+        state_.store(static_cast<uint32_t>(Connection::State::Idle));
     }
 
-    std::shared_ptr<Connection>
-    ConnectionPool::pickConnection(const std::string& domain)
+    bool Connection::isConnected() const
     {
-        Connections pool;
-
-        {
-            Guard guard(connsLock);
-            auto poolIt = conns.find(domain);
-            if (poolIt == std::end(conns))
-            {
-                Connections connections;
-                for (size_t i = 0; i < maxConnectionsPerHost; ++i)
-                {
-                    connections.push_back(std::make_shared<Connection>(maxResponseSize));
-                }
+        return connectionState_.load() == Connected;
+    }
 
-                poolIt = conns.insert(std::make_pair(domain, std::move(connections))).first;
-            }
-            pool = poolIt->second;
-        }
+    Connection::~Connection()
+    {
+#ifdef PISTACHE_USE_SSL
+        SSL_free(static_cast<SSL*>(ssl_));
+#endif /* PISTACHE_USE_SSL */
+    }
 
-        for (auto& conn : pool)
+    void Connection::close()
+    {
+        // Its streams are failed by the caller, a connection opened again
+        // negotiates HTTP/2 anew. The session itself is kept, the transport
+        // may still be feeding it when the pool closes the connection
+        multiplexed_.store(false, std::memory_order_release);
+        writeWanted_ = false;
+        alpnHttp2_   = false;
+
+        const auto state = connectionState_.exchange(NotConnected);
+#ifdef PISTACHE_USE_SSL
+        if (ssl_)
         {
-            if (conn->tryUse())
-            {
-                return conn;
-            }
+            // Quietly, the server may be gone already. OpenSSL would not let
+            // the session be resumed otherwise
+            if (state == Connected)
+                SSL_set_shutdown(static_cast<SSL*>(ssl_), SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+            SSL_free(static_cast<SSL*>(ssl_));
+            ssl_ = nullptr;
         }
+#else
+        (void)state;
+#endif /* PISTACHE_USE_SSL */
+        ::close(fd_);
+    }
 
-        return nullptr;
+    void Connection::useTls(std::shared_ptr<TlsContext> tls, std::string sessionKey,
+                            std::string serverName)
+    {
+        tls_           = std::move(tls);
+        tlsSessionKey_ = std::move(sessionKey);
+        tlsServerName_ = std::move(serverName);
     }
 
-    void ConnectionPool::releaseConnection(
-        const std::shared_ptr<Connection>& connection)
+    bool Connection::isHandshaking() const
     {
-        connection->setAsIdle();
+        return ssl_ != nullptr && connectionState_.load() == Connecting;
     }
 
-    size_t ConnectionPool::usedConnections(const std::string& domain) const
+#ifdef PISTACHE_USE_SSL
+    bool Connection::startTls(std::string& error)
     {
-        Connections pool;
+        auto* ssl = SSL_new(ssl::GetSSLContext(tls_->ctx));
+        if (!ssl || SSL_set_fd(ssl, fd_) != 1)
         {
-            Guard guard(connsLock);
-            auto it = conns.find(domain);
-            if (it == std::end(conns))
-            {
-                return 0;
-            }
-            pool = it->second;
+            SSL_free(ssl);
+            error = tlsErrorString("Cannot create SSL connection");
+            return false;
+        }
+        SSL_set_connect_state(ssl);
+        SSL_set_app_data(ssl, &tlsSessionKey_);
+
+        // Addresses are checked against the certificate, but are not sent
+        // with SNI
+        in6_addr ip;
+        const auto& name = tlsServerName_;
+        if (inet_pton(AF_INET, name.c_str(), &ip) == 1 || inet_pton(AF_INET6, name.c_str(), &ip) == 1)
+        {
+            X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl), name.c_str());
+        }
+        else
+        {
+            SSL_set_tlsext_host_name(ssl, name.c_str());
+            SSL_set1_host(ssl, name.c_str());
+        }
+
+        if (auto* session = tls_->session(tlsSessionKey_))
+        {
+            SSL_set_session(ssl, session);
+            SSL_SESSION_free(session);
         }
 
-        return std::count_if(pool.begin(), pool.end(),
-                             [](const std::shared_ptr<Connection>& conn) {
-                                 return conn->isConnected();
-                             });
+        ssl_ = ssl;
+        return true;
     }
 
-    size_t ConnectionPool::idleConnections(const std::string& domain) const
+    Connection::Handshake Connection::handshake(std::string& error)
     {
-        Connections pool;
+        auto* ssl = static_cast<SSL*>(ssl_);
+
+        ERR_clear_error();
+        const int res = SSL_connect(ssl);
+        if (res == 1)
         {
-            Guard guard(connsLock);
-            auto it = conns.find(domain);
-            if (it == std::end(conns))
-            {
-                return 0;
-            }
-            pool = it->second;
+            if (SSL_session_reused(ssl))
+                tls_->resumedHandshakes.fetch_add(1);
+            else
+                tls_->fullHandshakes.fetch_add(1);
+
+            const unsigned char* protocol = nullptr;
+            unsigned int length           = 0;
+            SSL_get0_alpn_selected(ssl, &protocol, &length);
+            alpnHttp2_ = length == 2 && std::memcmp(protocol, "h2", 2) == 0;
+            return Handshake::Done;
+        }
+
+        switch (SSL_get_error(ssl, res))
+        {
+        case SSL_ERROR_WANT_READ:
+            return Handshake::WantRead;
+        case SSL_ERROR_WANT_WRITE:
+            return Handshake::WantWrite;
+        default:
+            break;
         }
 
-        return std::count_if(
-            pool.begin(), pool.end(),
-            [](const std::shared_ptr<Connection>& conn) { return conn->isIdle(); });
+        const auto verified = SSL_get_verify_result(ssl);
+        if (verified != X509_V_OK)
+            error = std::string("Certificate verification failed: ")
+                + X509_verify_cert_error_string(verified);
+        else
+            error = "TLS handshake failed: " + tlsErrorString("connection closed");
+        return Handshake::Failed;
     }
 
-    size_t ConnectionPool::availableConnections(const std::string& /*domain*/) const
+    ssize_t Connection::readTls(char* buffer, size_t size)
+    {
+        auto* ssl = static_cast<SSL*>(ssl_);
+
+        ERR_clear_error();
+        const int res = SSL_read(ssl, buffer, static_cast<int>(size));
+        if (res > 0)
+            return res;
+
+        switch (SSL_get_error(ssl, res))
+        {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_ZERO_RETURN:
+            return 0;
+        case SSL_ERROR_SYSCALL:
+            if (errno == 0)
+                return 0;
+            return -1;
+        default:
+            errno = EPROTO;
+            return -1;
+        }
+    }
+
+    ssize_t Connection::writeTls(const char* data, size_t size)
+    {
+        auto* ssl = static_cast<SSL*>(ssl_);
+
+        ERR_clear_error();
+        const int res = SSL_write(ssl, data, static_cast<int>(size));
+        if (res > 0)
+            return res;
+
+        switch (SSL_get_error(ssl, res))
+        {
+        case SSL_ERROR_WANT_READ:
+        case SSL_ERROR_WANT_WRITE:
+            errno = EAGAIN;
+            return -1;
+        case SSL_ERROR_SYSCALL:
+            return -1;
+        default:
+            errno = EPROTO;
+            return -1;
+        }
+    }
+#else
+    bool Connection::startTls(std::string& error)
+    {
+        error = "TLS needs PISTACHE_USE_SSL";
+        return false;
+    }
+
+    Connection::Handshake Connection::handshake(std::string& error)
+    {
+        error = "TLS needs PISTACHE_USE_SSL";
+        return Handshake::Failed;
+    }
+
+    ssize_t Connection::readTls(char*, size_t)
+    {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    ssize_t Connection::writeTls(const char*, size_t)
+    {
+        errno = ENOTSUP;
+        return -1;
+    }
+#endif /* PISTACHE_USE_SSL */
+
+    void Connection::associateTransport(
+        const std::shared_ptr<Transport>& transport)
+    {
+        if (transport_)
+            throw std::runtime_error(
+                "A transport has already been associated to the connection");
+
+        transport_ = transport;
+    }
+
+    bool Connection::hasTransport() const { return transport_ != nullptr; }
+
+    Fd Connection::fd() const
+    {
+        assert(fd_ != -1);
+        return fd_;
+    }
+
+    void Connection::handleResponsePacket(const char* buffer, size_t totalBytes)
+    {
+        // A session that failed has reset its streams, the transport closes
+        // the connection
+        if (h2_)
+        {
+            h2_->feed(buffer, totalBytes);
+            return;
+        }
+
+        try
+        {
+            // The bytes of a streamed body go to its reader, the ones past its
+            // end are the next response
+            if (body_)
+            {
+                const size_t used = feedBody(buffer, totalBytes);
+                buffer += used;
+                totalBytes -= used;
+                if (body_ || totalBytes == 0)
+                    return;
+            }
+
+            const bool result = parser.feed(buffer, totalBytes);
+            if (!result)
+            {
+                handleError("Client: Too long packet");
+                return;
+            }
+
+            parseResponses();
+        }
+        catch (const std::exception& ex)
+        {
+            handleError(ex.what());
+        }
+    }
+
+    void Connection::parseResponses()
+    {
+        // With pipelining, a single packet can carry several responses
+        while (parser.parse() == Private::State::Done)
+        {
+            if (parser.bodyPending())
+            {
+                BodyStart bodyStart;
+                {
+                    std::lock_guard<std::mutex> guard(inflightLock_);
+                    if (!inflight_.empty())
+                        bodyStart = inflight_.front().bodyStart;
+                }
+
+                std::shared_ptr<BodyReader> reader;
+                if (bodyStart)
+                    reader = bodyStart(parser.response, ResponseFlow(weak_from_this()));
+
+                if (reader)
+                {
+                    parser.streamBody();
+                    body_ = std::make_unique<Private::BodyDecoder>(std::move(reader), parser.response);
+                }
+                else
+                {
+                    parser.bufferBody();
+                }
+                continue;
+            }
+
+            std::optional<RequestEntry> entry;
+            {
+                std::lock_guard<std::mutex> guard(inflightLock_);
+                if (!inflight_.empty())
+                {
+                    entry.emplace(std::move(inflight_.front()));
+                    inflight_.pop_front();
+                }
+            }
+
+            auto response = std::move(parser.response);
+
+            if (entry && !entry->cancelled)
+            {
+                cancelTimer(*entry);
+                entry->resolve(std::move(response));
+            }
+
+            if (body_)
+            {
+                // The connection is only done with once the body has been
+                // streamed to its end
+                if (entry)
+                    bodyDone_ = std::move(entry->onDone);
+
+                // What arrived along with the headers
+                const auto received = parser.pending();
+                parser.consume(feedBody(received.data(), received.size()));
+                parser.resetKeepingPending();
+                if (body_)
+                    return;
+                continue;
+            }
+
+            parser.resetKeepingPending();
+
+            if (entry && entry->onDone)
+                entry->onDone();
+        }
+    }
+
+    size_t Connection::feedBody(const char* data, size_t size)
+    {
+        const size_t used = body_->feed(data, size);
+        if (body_->done())
+            endBody(nullptr);
+        return used;
+    }
+
+    void Connection::endBody(const char* error)
+    {
+        auto body   = std::move(body_);
+        auto onDone = std::move(bodyDone_);
+        bodyDone_   = nullptr;
+        readPaused_ = false;
+
+        if (error)
+            body->reader()->onError(error);
+        else
+            body->reader()->onEnd();
+
+        if (onDone)
+            onDone();
+    }
+
+    bool Connection::isStreaming() const { return body_ != nullptr; }
+
+    bool Connection::isReadPaused() const { return readPaused_.load(std::memory_order_acquire); }
+
+    void Connection::resumeReading()
+    {
+        if (readPaused_.exchange(false) && transport_)
+            transport_->resumeReading(shared_from_this());
+    }
+
+    ResponseFlow::ResponseFlow(std::weak_ptr<Connection> connection, uint32_t stream)
+        : connection_(std::move(connection))
+        , stream_(stream)
+    { }
+
+    void ResponseFlow::pause() const
+    {
+        auto connection = connection_.lock();
+        if (!connection)
+            return;
+
+        if (stream_ != 0)
+            connection->pauseStream(stream_, true);
+        else
+            connection->readPaused_.store(true, std::memory_order_release);
+    }
+
+    void ResponseFlow::resume() const
+    {
+        // Always posted, a reader resuming from onData() does not read the
+        // connection again from within its own input
+        auto connection = connection_.lock();
+        if (!connection)
+            return;
+
+        if (stream_ != 0)
+            connection->pauseStream(stream_, false);
+        else
+            connection->resumeReading();
+    }
+
+    void Cancellation::cancel()
+    {
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (cancelled_)
+                return;
+            cancelled_ = true;
+            callback   = std::move(callback_);
+        }
+
+        if (callback)
+            callback();
+    }
+
+    bool Cancellation::isCancelled() const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return cancelled_;
+    }
+
+    void Cancellation::onCancel(std::function<void()> callback)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (!cancelled_)
+            {
+                callback_ = std::move(callback);
+                return;
+            }
+        }
+
+        callback();
+    }
+
+    RetryBudget::RetryBudget()
+        : deposit_(0)
+        , max_(0)
+        , balance_(0)
+    {
+        init(Default::RetryRatio, Default::RetryBurst);
+    }
+
+    void RetryBudget::init(double ratio, size_t burst)
+    {
+        deposit_ = static_cast<int64_t>(ratio * 1000);
+        max_     = static_cast<int64_t>(burst) * 1000;
+        balance_.store(max_, std::memory_order_relaxed);
+    }
+
+    void RetryBudget::deposit()
+    {
+        auto balance = balance_.load(std::memory_order_relaxed);
+        while (balance < max_
+               && !balance_.compare_exchange_weak(balance, std::min(balance + deposit_, max_),
+                                                  std::memory_order_relaxed))
+        { }
+    }
+
+    bool RetryBudget::withdraw()
+    {
+        auto balance = balance_.load(std::memory_order_relaxed);
+        do
+        {
+            if (balance < 1000)
+                return false;
+        } while (!balance_.compare_exchange_weak(balance, balance - 1000,
+                                                 std::memory_order_relaxed));
+        return true;
+    }
+
+    void Connection::handleError(const char* error)
+    {
+        // Whatever is left in the parser can not be matched with a request
+        parser.reset();
+
+        if (body_)
+            endBody(error);
+
+        // The streamed bodies of the HTTP/2 streams
+        auto streams = std::move(streams_);
+        streams_.clear();
+        for (auto& [id, stream] : streams)
+        {
+            if (!stream.reader)
+                continue;
+
+            stream.reader->onError(error);
+            if (stream.onDone)
+                stream.onDone();
+        }
+
+        for (auto& entry : takeInflight())
+        {
+            cancelTimer(entry);
+            if (!entry.cancelled)
+                entry.reject(Error(error));
+
+            if (entry.onDone)
+                entry.onDone();
+        }
+    }
+
+    bool Connection::handleTimeout(uint64_t request)
+    {
+        // Only the stream of the request is reset
+        if (isMultiplexed())
+        {
+            auto entry = takeEntry(request);
+            if (!entry)
+                return false;
+
+            if (entry->stream != 0 && isMultiplexed())
+            {
+                h2_->cancel(entry->stream);
+                streams_.erase(entry->stream);
+                transport_->settleHttp2(shared_from_this());
+            }
+
+            entry->reject(std::runtime_error("Timeout"));
+            if (entry->onDone)
+                entry->onDone();
+            return false;
+        }
+
+        const bool pipelined = pipelineDepth_ > 1;
+
+        std::deque<RequestEntry> expired;
+        {
+            std::lock_guard<std::mutex> guard(inflightLock_);
+            auto it = std::find_if(inflight_.begin(), inflight_.end(),
+                                   [request](const RequestEntry& entry) {
+                                       return entry.id == request;
+                                   });
+            if (it == inflight_.end())
+                return false;
+
+            // The response might still come later, it would be matched with the
+            // next request, so the connection is closed. When requests are
+            // pipelined, every request in flight fails along
+            if (pipelined)
+            {
+                expired.swap(inflight_);
+            }
+            else
+            {
+                expired.push_back(std::move(*it));
+                inflight_.erase(it);
+            }
+        }
+
+        parser.reset();
+        close();
+
+        for (auto& entry : expired)
+        {
+            const bool timedOut = entry.id == request;
+            if (!timedOut)
+                cancelTimer(entry);
+
+            /* @API: create a TimeoutException */
+            if (timedOut)
+                entry.reject(std::runtime_error("Timeout"));
+            else if (!entry.cancelled)
+                entry.reject(Error("Connection closed after a pipelined request timed out"));
+
+            if (entry.onDone)
+                entry.onDone();
+        }
+
+        return true;
+    }
+
+    bool Connection::handleCancel(uint64_t request)
+    {
+        if (isMultiplexed())
+        {
+            auto entry = takeEntry(request);
+            if (!entry)
+                return false;
+
+            cancelTimer(*entry);
+            if (entry->stream != 0 && isMultiplexed())
+            {
+                h2_->cancel(entry->stream);
+                streams_.erase(entry->stream);
+                transport_->settleHttp2(shared_from_this());
+            }
+
+            entry->reject(Async::Cancelled());
+            if (entry->onDone)
+                entry->onDone();
+            return false;
+        }
+
+        const bool pipelined = pipelineDepth_ > 1;
+
+        std::optional<Async::Rejection> reject;
+        OnDone onDone;
+        {
+            std::lock_guard<std::mutex> guard(inflightLock_);
+            auto it = std::find_if(inflight_.begin(), inflight_.end(),
+                                   [request](const RequestEntry& entry) {
+                                       return entry.id == request;
+                                   });
+            // Answered already
+            if (it == inflight_.end() || it->cancelled)
+                return false;
+
+            cancelTimer(*it);
+            reject.emplace(std::move(it->reject));
+
+            // Pipelined, the response still comes in its turn, the connection
+            // is released once it has been dropped
+            if (pipelined)
+            {
+                it->cancelled = true;
+                it->bodyStart = nullptr;
+            }
+            else
+            {
+                onDone = std::move(it->onDone);
+                inflight_.erase(it);
+            }
+        }
+
+        if (!pipelined)
+        {
+            parser.reset();
+            close();
+        }
+
+        (*reject)(Async::Cancelled());
+        if (onDone)
+            onDone();
+
+        return !pipelined;
+    }
+
+    std::deque<Connection::RequestEntry> Connection::takeInflight()
+    {
+        std::deque<RequestEntry> entries;
+
+        std::lock_guard<std::mutex> guard(inflightLock_);
+        entries.swap(inflight_);
+        return entries;
+    }
+
+    void Connection::cancelTimer(const RequestEntry& entry)
+    {
+        if (entry.timer != TimerWheel::InvalidTimer && transport_)
+            transport_->cancelTimeout(entry.timer);
+    }
+
+    Async::Promise<Response> Connection::perform(const Http::Request& request,
+                                                 Connection::OnDone onDone,
+                                                 BodyStart bodyStart,
+                                                 std::shared_ptr<Cancellation> cancellation)
+    {
+        return Async::Promise<Response>(
+            [=](Async::Resolver& resolve, Async::Rejection& reject) mutable {
+                performImpl(std::move(request), std::move(resolve), std::move(reject),
+                            std::move(onDone), std::move(bodyStart), std::move(cancellation));
+            });
+    }
+
+    Async::Promise<Response> Connection::asyncPerform(const Http::Request& request,
+                                                      Connection::OnDone onDone,
+                                                      BodyStart bodyStart,
+                                                      std::shared_ptr<Cancellation> cancellation)
+    {
+        return Async::Promise<Response>(
+            [=](Async::Resolver& resolve, Async::Rejection& reject) {
+                requestsQueue.push(RequestData(std::move(resolve), std::move(reject),
+                                               request, std::move(onDone), std::move(bodyStart),
+                                               std::move(cancellation)));
+            });
+    }
+
+    void Connection::performImpl(Http::Request request,
+                                 Async::Resolver resolve, Async::Rejection reject,
+                                 Connection::OnDone onDone, BodyStart bodyStart,
+                                 std::shared_ptr<Cancellation> cancellation)
+    {
+        if (cancellation && cancellation->isCancelled())
+        {
+            reject(Async::Cancelled());
+            if (onDone)
+                onDone();
+            return;
+        }
+
+        if (isMultiplexed())
+        {
+            performHttp2(std::move(request), std::move(resolve), std::move(reject),
+                         std::move(onDone), std::move(bodyStart), std::move(cancellation));
+            return;
+        }
+
+        std::string head;
+        if (!writeRequest(head, request))
+        {
+            reject(std::runtime_error("Could not write request"));
+            if (onDone)
+                onDone();
+            return;
+        }
+
+        const auto timeout = request.timeout();
+
+        // The body is sent from the request, which is kept until it is written
+        std::shared_ptr<const Http::Request> body;
+        if (!request.body().empty())
+            body = std::make_shared<const Http::Request>(std::move(request));
+
+        const bool pipelined = pipelineDepth_ > 1;
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> guard(inflightLock_);
+
+            id = nextRequest_++;
+            RequestEntry entry(std::move(resolve), std::move(reject), id,
+                               std::move(onDone), std::move(bodyStart));
+            // Scheduled under the lock, so that the timer can not expire
+            // before the request is in flight
+            if (timeout.count() > 0)
+                entry.timer = transport_->scheduleTimeout(
+                    shared_from_this(), entry.id,
+                    std::chrono::duration_cast<std::chrono::milliseconds>(timeout));
+            inflight_.push_back(std::move(entry));
+
+            // Responses are matched in order, the request has to be written
+            // in the order it is added to the requests in flight
+            if (pipelined)
+                transport_->asyncQueueRequest(shared_from_this(), id, std::move(head),
+                                              std::move(body));
+        }
+
+        if (!pipelined)
+            transport_->asyncSendRequest(shared_from_this(), id, std::move(head), std::move(body));
+
+        if (cancellation)
+        {
+            cancellation->onCancel([weakConn = weak_from_this(), id]() {
+                if (auto conn = weakConn.lock())
+                {
+                    conn->cancelled_.store(true, std::memory_order_release);
+                    conn->transport_->cancelRequest(conn, id);
+                }
+            });
+        }
+    }
+
+    void Connection::performHttp2(Http::Request request, Async::Resolver resolve,
+                                  Async::Rejection reject, OnDone onDone, BodyStart bodyStart,
+                                  std::shared_ptr<Cancellation> cancellation)
+    {
+        std::vector<Hpack::HeaderField> head;
+        if (!writeHttp2Request(head, request, isTls()))
+        {
+            reject(std::runtime_error("Could not write request"));
+            if (onDone)
+                onDone();
+            return;
+        }
+
+        const auto timeout = request.timeout();
+
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> guard(inflightLock_);
+
+            id = nextRequest_++;
+            RequestEntry entry(std::move(resolve), std::move(reject), id,
+                               std::move(onDone), std::move(bodyStart));
+            if (timeout.count() > 0)
+                entry.timer = transport_->scheduleTimeout(
+                    shared_from_this(), entry.id,
+                    std::chrono::duration_cast<std::chrono::milliseconds>(timeout));
+            inflight_.push_back(std::move(entry));
+        }
+
+        // Submitted from the thread of the transport, which owns the session.
+        // Its response may come in any order
+        transport_->post([self = shared_from_this(), id, head = std::move(head),
+                          body = std::string(request.body())]() mutable {
+            self->submitHttp2(id, std::move(head), std::move(body));
+        });
+
+        if (cancellation)
+        {
+            cancellation->onCancel([weakConn = weak_from_this(), id]() {
+                if (auto conn = weakConn.lock())
+                    conn->transport_->cancelRequest(conn, id);
+            });
+        }
+    }
+
+    bool Connection::isWithdrawn(uint64_t request)
+    {
+        if (!cancelled_.load(std::memory_order_acquire))
+            return false;
+
+        std::lock_guard<std::mutex> guard(inflightLock_);
+        return std::none_of(inflight_.begin(), inflight_.end(),
+                            [request](const RequestEntry& entry) { return entry.id == request; });
+    }
+
+    void Connection::processRequestQueue()
+    {
+        for (;;)
+        {
+            auto req = requestsQueue.popSafe();
+            if (!req)
+                break;
+
+            performImpl(std::move(req->request), std::move(req->resolve), std::move(req->reject),
+                        std::move(req->onDone), std::move(req->bodyStart),
+                        std::move(req->cancellation));
+        }
+    }
+
+    void Connection::rejectPendingRequests(const char* error)
+    {
+        for (;;)
+        {
+            auto req = requestsQueue.popSafe();
+            if (!req)
+                break;
+
+            req->reject(Error(error));
+            if (req->onDone)
+                req->onDone();
+        }
+    }
+
+    void Connection::queueRequest(RequestData request)
+    {
+        requestsQueue.push(std::move(request));
+    }
+
+    bool Connection::isExpired(std::chrono::steady_clock::time_point now,
+                               std::chrono::milliseconds idleTimeout,
+                               std::chrono::milliseconds maxLifetime) const
+    {
+        if (!isConnected())
+            return false;
+
+        using Clock         = std::chrono::steady_clock;
+        const auto idle     = now - Clock::time_point(Clock::duration(idleSince_.load()));
+        const auto lifetime = now - Clock::time_point(Clock::duration(connectedAt_.load()));
+        return (idleTimeout.count() > 0 && idle >= idleTimeout)
+            || (maxLifetime.count() > 0 && lifetime >= maxLifetime);
+    }
+
+    void Connection::closeFromTransport(OnDone done)
+    {
+        transport_->closeConnection(shared_from_this(), std::move(done));
+    }
+
+    void ConnectionPool::init(size_t maxConnectionsPerHost,
+                              size_t maxResponseSize, size_t pipelineDepth, size_t lanes,
+                              Http2Mode http2, size_t maxStreams)
+    {
+        this->maxConnectionsPerHost = maxConnectionsPerHost;
+        this->maxResponseSize       = maxResponseSize;
+        this->pipelineDepth         = pipelineDepth;
+        this->lanes                 = std::max<size_t>(lanes, 1);
+        this->http2                 = http2;
+        this->maxStreams            = maxStreams;
+    }
+
+    HostConnections::HostConnections(std::string name, size_t maxConnections,
+                                     size_t maxResponseSize, size_t pipelineDepth, size_t lanes,
+                                     Http2Mode http2, size_t maxStreams)
+        : name_(std::move(name))
+        , maxConnections_(maxConnections)
+        , maxResponseSize_(maxResponseSize)
+        , pipelineDepth_(pipelineDepth)
+        , lanes_(std::max<size_t>(lanes, 1))
+        , http2_(http2)
+        , maxStreams_(maxStreams)
+        , slots_(std::make_unique<Slot[]>(maxConnections))
+        , created_(0)
+        , idleHeads_(std::make_unique<std::atomic<uint64_t>[]>(lanes_))
+    {
+        for (size_t i = 0; i < lanes_; ++i)
+            idleHeads_[i].store(0, std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<Connection> HostConnections::checkout(bool exclusive, size_t lane,
+                                                          bool affine)
+    {
+        lane %= lanes_;
+
+        const auto popAny = [&]() -> std::shared_ptr<Connection> {
+            for (size_t i = 0; i < lanes_; ++i)
+            {
+                if (auto conn = popIdle(exclusive, (lane + i) % lanes_))
+                    return conn;
+            }
+            return nullptr;
+        };
+
+        if (auto conn = affine ? popIdle(exclusive, lane) : popAny())
+            return conn;
+
+        // A stream of an HTTP/2 connection costs less than a new connection
+        if (http2_ != Http2Mode::Off)
+        {
+            if (auto conn = pickBusy(lane, true))
+                return conn;
+        }
+
+        auto index = created_.load(std::memory_order_relaxed);
+        while (index < maxConnections_)
+        {
+            if (created_.compare_exchange_weak(index, index + 1, std::memory_order_relaxed))
+            {
+                auto& slot = slots_[index];
+
+                auto conn   = std::make_shared<Connection>(maxResponseSize_, pipelineDepth_, http2_,
+                                                         maxStreams_);
+                conn->host_ = weak_from_this();
+                conn->slot_ = static_cast<uint32_t>(index);
+                conn->lane_ = static_cast<uint32_t>(lane);
+                conn->tryUse(exclusive);
+
+                slot.connection = conn;
+                slot.ready.store(true, std::memory_order_release);
+                return conn;
+            }
+        }
+
+        // Every connection has been opened, one of another lane will do
+        if (affine)
+        {
+            if (auto conn = popAny())
+                return conn;
+        }
+
+        if (!exclusive && pipelineDepth_ > 1)
+            return pickBusy(lane);
+
+        return nullptr;
+    }
+
+    std::shared_ptr<Connection> HostConnections::pickBusy(size_t lane, bool multiplexed)
+    {
+        // Connections of the lane first
+        for (const bool sameLane : { true, false })
+        {
+            for (size_t i = 0; i < maxConnections_; ++i)
+            {
+                auto& slot = slots_[i];
+                if (!slot.ready.load(std::memory_order_acquire)
+                    || (slot.connection->lane_ == lane) != sameLane
+                    || (multiplexed && !slot.connection->isMultiplexed()))
+                    continue;
+                if (slot.connection->tryPipeline())
+                    return slot.connection;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void HostConnections::release(Connection& connection)
+    {
+        if (connection.tryRelease())
+        {
+            connection.idleSince_.store(std::chrono::steady_clock::now().time_since_epoch().count());
+            pushIdle(connection.slot_);
+        }
+    }
+
+    std::vector<std::shared_ptr<Connection>>
+    HostConnections::claimExpired(const std::function<bool(const Connection&)>& expired)
+    {
+        std::vector<std::shared_ptr<Connection>> claimed;
+        for (size_t lane = 0; lane < lanes_; ++lane)
+        {
+            // The whole stack is taken at once: each connection on it is then
+            // either claimed or pushed back, and can never be on it twice
+            auto& idleHead = idleHeads_[lane];
+            auto head      = idleHead.load(std::memory_order_acquire);
+            while (!idleHead.compare_exchange_weak(head, ((head >> 32) + 1) << 32,
+                                                   std::memory_order_acquire))
+            { }
+
+            for (auto top = static_cast<uint32_t>(head); top != 0;)
+            {
+                const auto index = top - 1;
+                top              = slots_[index].next.load(std::memory_order_relaxed);
+
+                auto& conn = slots_[index].connection;
+                // Picked up outside of the pool, it will be pushed back on release
+                if (!conn->tryUse(true))
+                    continue;
+
+                if (expired(*conn))
+                {
+                    claimed.push_back(conn);
+                }
+                else
+                {
+                    conn->setAsIdle();
+                    pushIdle(index);
+                }
+            }
+        }
+
+        return claimed;
+    }
+
+    bool HostConnections::enqueue(std::shared_ptr<Connection::RequestData> request)
+    {
+        return pending_.enqueue(std::move(request));
+    }
+
+    bool HostConnections::dequeue(std::shared_ptr<Connection::RequestData>& request)
+    {
+        return pending_.dequeue(request);
+    }
+
+    std::shared_ptr<Connection> HostConnections::popIdle(bool exclusive, size_t lane)
+    {
+        auto& idleHead = idleHeads_[lane];
+        auto head      = idleHead.load(std::memory_order_acquire);
+        for (;;)
+        {
+            const auto top = static_cast<uint32_t>(head);
+            if (top == 0)
+                return nullptr;
+
+            const auto next    = slots_[top - 1].next.load(std::memory_order_relaxed);
+            const auto newHead = (((head >> 32) + 1) << 32) | next;
+            if (!idleHead.compare_exchange_weak(head, newHead, std::memory_order_acquire))
+                continue;
+
+            auto& conn = slots_[top - 1].connection;
+            if (conn->tryUse(exclusive))
+                return conn;
+
+            // Picked up outside of the pool, it will be pushed back on release
+            head = idleHead.load(std::memory_order_acquire);
+        }
+    }
+
+    void HostConnections::pushIdle(uint32_t index)
+    {
+        auto& idleHead = idleHeads_[slots_[index].connection->lane_];
+        auto head      = idleHead.load(std::memory_order_relaxed);
+        uint64_t newHead;
+        do
+        {
+            slots_[index].next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            newHead = (((head >> 32) + 1) << 32) | (index + 1);
+        } while (!idleHead.compare_exchange_weak(head, newHead, std::memory_order_release,
+                                                 std::memory_order_relaxed));
+    }
+
+    HostConnections* ConnectionPool::host(std::string_view domain) const
+    {
+        std::shared_lock<Lock> guard(connsLock);
+        auto it = conns.find(domain);
+        return it == std::end(conns) ? nullptr : it->second.get();
+    }
+
+    HostConnections& ConnectionPool::connections(std::string_view domain)
+    {
+        if (auto* connections = host(domain))
+            return *connections;
+
+        std::unique_lock<Lock> guard(connsLock);
+        auto it = conns.find(domain);
+        if (it != std::end(conns))
+            return *it->second;
+
+        auto connections = std::make_shared<HostConnections>(
+            std::string(domain), maxConnectionsPerHost, maxResponseSize, pipelineDepth, lanes,
+            http2, maxStreams);
+        const std::string_view name = connections->name();
+        return *conns.emplace(name, std::move(connections)).first->second;
+    }
+
+    std::shared_ptr<Connection>
+    ConnectionPool::pickConnection(std::string_view domain, bool exclusive, size_t lane,
+                                   bool affine)
+    {
+        return connections(domain).checkout(exclusive, lane, affine);
+    }
+
+    void ConnectionPool::releaseConnection(
+        const std::shared_ptr<Connection>& connection)
+    {
+        if (auto host = connection->hostConnections())
+            host->release(*connection);
+        else
+            connection->setAsIdle();
+    }
+
+    size_t ConnectionPool::usedConnections(std::string_view domain) const
+    {
+        auto* connections = host(domain);
+        if (connections == nullptr)
+            return 0;
+
+        size_t count = 0;
+        connections->forEach([&](const std::shared_ptr<Connection>& conn) {
+            if (conn->isConnected())
+                ++count;
+        });
+        return count;
+    }
+
+    size_t ConnectionPool::idleConnections(std::string_view domain) const
+    {
+        auto* connections = host(domain);
+        if (connections == nullptr)
+            return 0;
+
+        size_t count = 0;
+        connections->forEach([&](const std::shared_ptr<Connection>& conn) {
+            if (conn->isIdle())
+                ++count;
+        });
+        return count;
+    }
+
+    size_t ConnectionPool::availableConnections(const std::string& /*domain*/) const
     {
         return 0;
     }
@@ -859,19 +2837,33 @@ namespace Pistache::Http::Experimental
     {
     }
 
+    std::vector<std::shared_ptr<Connection>>
+    ConnectionPool::claimExpired(const std::function<bool(const Connection&)>& expired)
+    {
+        std::vector<std::shared_ptr<Connection>> claimed;
+
+        std::shared_lock<Lock> guard(connsLock);
+        for (auto& it : conns)
+        {
+            auto expiredConns = it.second->claimExpired(expired);
+            claimed.insert(claimed.end(), expiredConns.begin(), expiredConns.end());
+        }
+
+        return claimed;
+    }
+
     void ConnectionPool::shutdown()
     {
         // close all connections
-        Guard guard(connsLock);
+        std::shared_lock<Lock> guard(connsLock);
         for (auto& it : conns)
         {
-            for (auto& conn : it.second)
-            {
+            it.second->forEach([](const std::shared_ptr<Connection>& conn) {
                 if (conn->isConnected())
                 {
                     conn->close();
                 }
-            }
+            });
         }
     }
 
@@ -900,6 +2892,12 @@ namespace Pistache::Http::Experimental
         return *this;
     }
 
+    RequestBuilder& RequestBuilder::header(const Header::Raw& raw)
+    {
+        request_.headers_.addDeferred(raw);
+        return *this;
+    }
+
     RequestBuilder& RequestBuilder::cookie(const Cookie& cookie)
     {
         request_.cookies_.add(cookie);
@@ -924,9 +2922,58 @@ namespace Pistache::Http::Experimental
         return *this;
     }
 
+    RequestBuilder& RequestBuilder::onBodyStart(BodyStart callback)
+    {
+        bodyStart_ = std::move(callback);
+        return *this;
+    }
+
+    RequestBuilder& RequestBuilder::retries(size_t count)
+    {
+        retries_ = count;
+        return *this;
+    }
+
+    RequestBuilder& RequestBuilder::hedge(std::chrono::milliseconds delay, size_t count)
+    {
+        hedgeDelay_ = delay;
+        hedges_     = count;
+        return *this;
+    }
+
+    RequestBuilder& RequestBuilder::cancellation(Async::CancellationToken token)
+    {
+        cancellation_ = std::move(token);
+        return *this;
+    }
+
     Async::Promise<Response> RequestBuilder::send()
     {
-        return client_->doRequest(request_);
+        std::shared_ptr<Cancellation> cancellation;
+        Async::CancellationToken::Registration registration = 0;
+        if (cancellation_.canBeCancelled())
+        {
+            cancellation = std::make_shared<Cancellation>();
+            registration = cancellation_.onCancel([cancellation]() { cancellation->cancel(); });
+        }
+
+        auto promise = (retries_ > 0 || hedges_ > 0) && isIdempotent(request_.method_)
+            ? client_->doAttempts(request_, bodyStart_, retries_, hedgeDelay_, hedges_, cancellation)
+            : client_->doRequest(request_, bodyStart_, cancellation);
+        if (!cancellation)
+            return promise;
+
+        // The token may outlive the request by far
+        promise.cancelWith(cancellation_);
+        return promise.then(
+            [token = cancellation_, registration](Response&& response) {
+                token.forget(registration);
+                return std::move(response);
+            },
+            [token = cancellation_, registration](std::exception_ptr exc) {
+                token.forget(registration);
+                Async::Throw(std::move(exc));
+            });
     }
 
     Client::Options& Client::Options::threads(int val)
@@ -953,36 +3000,128 @@ namespace Pistache::Http::Experimental
         return *this;
     }
 
+    Client::Options& Client::Options::dnsResolverThreads(int val)
+    {
+        dnsResolverThreads_ = val;
+        return *this;
+    }
+
+    Client::Options& Client::Options::dnsCacheTtl(std::chrono::seconds val)
+    {
+        dnsCacheTtl_ = val;
+        return *this;
+    }
+
+    Client::Options& Client::Options::pipelining(size_t depth)
+    {
+        pipelineDepth_ = depth;
+        return *this;
+    }
+
+    Client::Options& Client::Options::idleTimeout(std::chrono::milliseconds val)
+    {
+        idleTimeout_ = val;
+        return *this;
+    }
+
+    Client::Options& Client::Options::maxLifetime(std::chrono::milliseconds val)
+    {
+        maxLifetime_ = val;
+        return *this;
+    }
+
+    Client::Options& Client::Options::retryBudget(double ratio, size_t burst)
+    {
+        retryRatio_ = ratio;
+        retryBurst_ = burst;
+        return *this;
+    }
+
+    Client::Options& Client::Options::connectTo(Address address)
+    {
+        connectTo_ = std::move(address);
+        return *this;
+    }
+
+    Client::Options& Client::Options::http2(Http2Mode mode, size_t maxStreams)
+    {
+        http2_      = mode;
+        maxStreams_ = maxStreams;
+        return *this;
+    }
+
+    Client::Options& Client::Options::sslVerifyPeer(bool val)
+    {
+        sslVerifyPeer_ = val;
+        return *this;
+    }
+
+    Client::Options& Client::Options::sslCertificateAuthority(std::string file)
+    {
+        sslCertificateAuthority_ = std::move(file);
+        return *this;
+    }
+
     Client::Client()
         : reactor_(Aio::Reactor::create())
         , pool()
         , transportKey()
+        , resolver_()
         , ioIndex(0)
-        , queuesLock()
-        , requestsQueues()
         , stopProcessPequestsQueues(false)
+        , idleTimeout_(Default::IdleTimeout)
+        , maxLifetime_(Default::MaxLifetime)
+        , reaping_(false)
     { }
 
     Client::~Client()
     {
         assert(stopProcessPequestsQueues == true && "You must explicitly call shutdown method of Client object");
+
+        // shutdown() only asks the transports to stop. Wait for their threads
+        // while the pool they hand connections back to still is alive
+        transports_.clear();
+        reactor_.reset();
     }
 
     Client::Options Client::options() { return Client::Options(); }
 
     void Client::init(const Client::Options& options)
     {
-        pool.init(options.maxConnectionsPerHost_, options.maxResponseSize_);
         reactor_->init(Aio::AsyncContext(options.threads_));
         transportKey = reactor_->addHandler(std::make_shared<Transport>());
+        for (const auto& handler : reactor_->handlers(transportKey))
+            transports_.push_back(std::static_pointer_cast<Transport>(handler));
+        pool.init(options.maxConnectionsPerHost_, options.maxResponseSize_,
+                  options.pipelineDepth_, transports_.size(), options.http2_, options.maxStreams_);
+        resolver_    = std::make_shared<DnsResolver>(
+            static_cast<size_t>(options.dnsResolverThreads_), options.dnsCacheTtl_);
         reactor_->run();
+
+        retryBudget_.init(options.retryRatio_, options.retryBurst_);
+
+#ifdef PISTACHE_USE_SSL
+        tls_ = makeTlsContext(options.sslVerifyPeer_, options.sslCertificateAuthority_,
+                              options.http2_ != Http2Mode::Off);
+#endif /* PISTACHE_USE_SSL */
+
+        connectTo_   = options.connectTo_;
+        idleTimeout_ = options.idleTimeout_;
+        maxLifetime_ = options.maxLifetime_;
+        if (idleTimeout_.count() > 0 || maxLifetime_.count() > 0)
+        {
+            reaping_ = true;
+            scheduleReaper();
+        }
     }
 
     void Client::shutdown()
     {
+        reaping_ = false;
+        if (resolver_)
+            resolver_->shutdown();
         reactor_->shutdown();
         pool.shutdown();
-        Guard guard(queuesLock);
         stopProcessPequestsQueues = true;
     }
 
@@ -1020,98 +3159,504 @@ namespace Pistache::Http::Experimental
         return builder;
     }
 
-    Async::Promise<Response> Client::doRequest(Http::Request request)
+    Async::Promise<Response> Client::doRequest(Http::Request request, BodyStart bodyStart,
+                                               std::shared_ptr<Cancellation> cancellation)
     {
         // request.headers_.add<Header::Connection>(ConnectionControl::KeepAlive);
         request.headers().remove<Header::UserAgent>();
         auto resourceData = request.resource();
 
+        // An attempt of a request sent more than once is not pipelined behind
+        // other requests, it would wait for them otherwise
         auto resource = splitUrl(resourceData);
-        auto conn     = pool.pickConnection(std::string(resource.first));
+        auto& host    = pool.connections(hostKey(resourceData, resource.first));
+        auto conn     = pickConnection(host, !isIdempotent(request.method()) || cancellation);
 
         if (conn == nullptr)
         {
-            return Async::Promise<Response>([this, resource = std::move(resource),
-                                             request](Async::Resolver& resolve,
-                                                      Async::Rejection& reject) {
-                Guard guard(queuesLock);
-
+            auto promise = Async::Promise<Response>([&](Async::Resolver& resolve,
+                                                        Async::Rejection& reject) {
                 auto data = std::make_shared<Connection::RequestData>(
-                    std::move(resolve), std::move(reject), std::move(request), nullptr);
-                auto& queue = requestsQueues[std::string(resource.first)];
-                if (!queue.enqueue(data))
+                    std::move(resolve), std::move(reject), std::move(request), nullptr,
+                    std::move(bodyStart), std::move(cancellation));
+                if (!host.enqueue(data))
                     data->reject(std::runtime_error("Queue is full"));
             });
+
+            // A connection released meanwhile did not see the request
+            processRequestQueue(host);
+            return promise;
         }
-        else
+
+        bindTransport(conn);
+
+        std::weak_ptr<Connection> weakConn = conn;
+        auto onDone                        = [this, weakConn]() {
+            if (auto conn = weakConn.lock())
+                releaseConnection(conn);
+        };
+
+        if (!conn->isConnected())
         {
+            auto res = conn->asyncPerform(request, std::move(onDone), std::move(bodyStart),
+                                          std::move(cancellation));
+            connect(conn, host.name());
+            return res;
+        }
 
-            if (!conn->hasTransport())
+        return conn->perform(request, std::move(onDone), std::move(bodyStart),
+                             std::move(cancellation));
+    }
+
+    // The attempts of a request sent more than once. The first one to get a
+    // response wins, and the other ones are cancelled
+    struct Attempts
+    {
+        Attempts(Async::Resolver resolve, Async::Rejection reject, Http::Request request,
+                 BodyStart bodyStart, size_t retries, size_t hedges)
+            : resolve(std::move(resolve))
+            , reject(std::move(reject))
+            , request(std::move(request))
+            , bodyStart(std::move(bodyStart))
+            , retries(retries)
+            , hedges(hedges)
+        { }
+
+        // Returns whether the attempt is the one that won
+        bool win(const std::shared_ptr<Cancellation>& attempt)
+        {
+            std::vector<std::shared_ptr<Cancellation>> losers;
             {
-                auto transports = reactor_->handlers(transportKey);
-                auto index      = ioIndex.fetch_add(1) % transports.size();
+                std::lock_guard<std::mutex> guard(lock);
+                if (done)
+                    return winner == attempt;
 
-                auto transport = std::static_pointer_cast<Transport>(transports[index]);
-                conn->associateTransport(transport);
+                done   = true;
+                winner = attempt;
+                losers.swap(pending);
             }
 
-            if (!conn->isConnected())
+            for (const auto& loser : losers)
+            {
+                if (loser != attempt)
+                    loser->cancel();
+            }
+            return true;
+        }
+
+        // Cancels every attempt in flight, the request is rejected
+        void cancel()
+        {
+            std::vector<std::shared_ptr<Cancellation>> cancelled;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (done)
+                    return;
+
+                done = true;
+                cancelled.swap(pending);
+            }
+
+            for (const auto& attempt : cancelled)
+                attempt->cancel();
+            reject(Async::Cancelled());
+        }
+
+        std::mutex lock;
+        Async::Resolver resolve;
+        Async::Rejection reject;
+        const Http::Request request;
+        const BodyStart bodyStart;
+
+        // Left to send
+        size_t retries;
+        size_t hedges;
+
+        std::vector<std::shared_ptr<Cancellation>> pending;
+        std::shared_ptr<Cancellation> winner;
+        // Once the promise has been resolved or rejected
+        bool done = false;
+    };
+
+    Async::Promise<Response> Client::doAttempts(Http::Request request, BodyStart bodyStart,
+                                                size_t retries,
+                                                std::chrono::milliseconds hedgeDelay,
+                                                size_t hedges,
+                                                std::shared_ptr<Cancellation> cancellation)
+    {
+        retryBudget_.deposit();
+
+        return Async::Promise<Response>([&](Async::Resolver& resolve, Async::Rejection& reject) {
+            auto attempts = std::make_shared<Attempts>(std::move(resolve), std::move(reject),
+                                                       std::move(request), std::move(bodyStart),
+                                                       retries, hedges);
+            if (cancellation)
             {
-                std::weak_ptr<Connection> weakConn = conn;
-                auto res                           = conn->asyncPerform(request, [this, weakConn]() {
-                    auto conn = weakConn.lock();
-                    if (conn)
+                cancellation->onCancel([weakAttempts = std::weak_ptr<Attempts>(attempts)]() {
+                    if (auto cancelled = weakAttempts.lock())
+                        cancelled->cancel();
+                });
+            }
+
+            sendAttempt(attempts);
+            if (hedges > 0)
+                scheduleHedge(attempts, hedgeDelay);
+        });
+    }
+
+    void Client::sendAttempt(const std::shared_ptr<Attempts>& attempts)
+    {
+        auto attempt = std::make_shared<Cancellation>();
+        {
+            std::lock_guard<std::mutex> guard(attempts->lock);
+            if (attempts->done)
+                return;
+            attempts->pending.push_back(attempt);
+        }
+
+        // A streamed body goes to the reader of the attempt that won, the
+        // other ones are cancelled before it is read
+        BodyStart bodyStart;
+        if (attempts->bodyStart)
+        {
+            bodyStart = [attempts, attempt](const Response& response,
+                                            ResponseFlow flow) -> std::shared_ptr<BodyReader> {
+                if (!attempts->win(attempt))
+                    return nullptr;
+                return attempts->bodyStart(response, std::move(flow));
+            };
+        }
+
+        doRequest(attempts->request, std::move(bodyStart), attempt)
+            .then(
+                [attempts, attempt](Response response) {
+                    if (attempts->win(attempt))
+                        attempts->resolve(std::move(response));
+                },
+                [this, attempts, attempt](std::exception_ptr error) {
+                    bool retry = false;
+                    bool fail  = false;
                     {
-                        pool.releaseConnection(conn);
-                        processRequestQueue();
+                        std::lock_guard<std::mutex> guard(attempts->lock);
+                        if (attempts->done)
+                        {
+                            // Cancelled, unless it won before failing
+                            fail = attempts->winner == attempt;
+                        }
+                        else
+                        {
+                            auto& pending = attempts->pending;
+                            pending.erase(std::remove(pending.begin(), pending.end(), attempt),
+                                          pending.end());
+
+                            if (attempts->retries > 0 && retryBudget_.withdraw())
+                            {
+                                --attempts->retries;
+                                retry = true;
+                            }
+                            else if (pending.empty())
+                            {
+                                // Pending hedges are dropped
+                                attempts->done = true;
+                                fail           = true;
+                            }
+                        }
                     }
+
+                    if (fail)
+                        attempts->reject(error);
+                    if (retry)
+                        sendAttempt(attempts);
                 });
-                conn->connect(helpers::httpAddr(resource.first));
-                return res;
+    }
+
+    void Client::scheduleHedge(const std::shared_ptr<Attempts>& attempts,
+                               std::chrono::milliseconds delay)
+    {
+        nextTransport()->schedule(delay, [this, attempts, delay]() {
+            bool again = false;
+            {
+                std::lock_guard<std::mutex> guard(attempts->lock);
+                if (attempts->done || attempts->hedges == 0)
+                    return;
+                again = --attempts->hedges > 0;
             }
 
-            std::weak_ptr<Connection> weakConn = conn;
-            return conn->perform(request, [this, weakConn]() {
-                auto conn = weakConn.lock();
-                if (conn)
+            if (retryBudget_.withdraw())
+                sendAttempt(attempts);
+            if (again)
+                scheduleHedge(attempts, delay);
+        });
+    }
+
+    void Client::processRequestQueue(HostConnections& host)
+    {
+        while (!stopProcessPequestsQueues.load())
+        {
+            auto conn = pickConnection(host);
+            if (!conn)
+                break;
+
+            std::shared_ptr<Connection::RequestData> data;
+            if (!host.dequeue(data))
+            {
+                pool.releaseConnection(conn);
+                break;
+            }
+
+            auto onDone = [this, conn]() { releaseConnection(conn); };
+
+            // Not created yet, or closed by the server or the reaper while it
+            // was idle
+            if (!conn->isConnected())
+            {
+                bindTransport(conn);
+                conn->queueRequest(Connection::RequestData(
+                    std::move(data->resolve), std::move(data->reject), data->request,
+                    std::move(onDone), std::move(data->bodyStart), std::move(data->cancellation)));
+                connect(conn, host.name());
+                continue;
+            }
+
+            conn->performImpl(std::move(data->request), std::move(data->resolve),
+                              std::move(data->reject), std::move(onDone),
+                              std::move(data->bodyStart), std::move(data->cancellation));
+        }
+    }
+
+    void Client::releaseConnection(const std::shared_ptr<Connection>& conn)
+    {
+        pool.releaseConnection(conn);
+        if (auto host = conn->hostConnections())
+            processRequestQueue(*host);
+    }
+
+    Async::Promise<size_t> Client::warmup(const std::string& host, size_t count)
+    {
+        // Held until every attempt is over, an idle connection would be
+        // handed out again otherwise
+        std::vector<std::shared_ptr<Connection>> conns;
+        while (conns.size() < count)
+        {
+            // Spread over the transports
+            auto conn = pool.pickConnection(host, true, ioIndex.fetch_add(1));
+            if (!conn)
+                break;
+            conns.push_back(std::move(conn));
+        }
+
+        return Async::Promise<size_t>([&](Async::Resolver& resolve, Async::Rejection&) {
+            struct Progress
+            {
+                Progress(size_t pending, Async::Resolver resolve)
+                    : pending(pending)
+                    , resolve(std::move(resolve))
+                { }
+
+                std::atomic<size_t> pending;
+                std::atomic<size_t> connected { 0 };
+                Async::Resolver resolve;
+            };
+
+            if (conns.empty())
+            {
+                resolve(size_t { 0 });
+                return;
+            }
+
+            auto progress = std::make_shared<Progress>(conns.size(), std::move(resolve));
+            auto finish   = [this, progress](const std::shared_ptr<Connection>& conn, bool connected) {
+                if (connected)
+                    progress->connected.fetch_add(1);
+                releaseConnection(conn);
+                if (progress->pending.fetch_sub(1) == 1)
+                    progress->resolve(progress->connected.load());
+            };
+
+            for (const auto& conn : conns)
+            {
+                if (conn->isConnected())
                 {
-                    pool.releaseConnection(conn);
-                    processRequestQueue();
+                    finish(conn, true);
+                    continue;
                 }
-            });
+
+                bindTransport(conn);
+                connect(conn, host, [finish, conn](bool connected) { finish(conn, connected); });
+            }
+        });
+    }
+
+    std::shared_ptr<Transport> Client::nextTransport()
+    {
+        return transports_[ioIndex.fetch_add(1) % transports_.size()];
+    }
+
+    std::shared_ptr<Connection> Client::pickConnection(HostConnections& host, bool exclusive)
+    {
+        const auto self = std::this_thread::get_id();
+        for (size_t lane = 0; lane < transports_.size(); ++lane)
+        {
+            if (transports_[lane]->context().thread() == self)
+                return host.checkout(exclusive, lane, true);
         }
+
+        return host.checkout(exclusive, ioIndex.fetch_add(1));
     }
 
-    void Client::processRequestQueue()
+    void Client::bindTransport(const std::shared_ptr<Connection>& conn)
     {
-        Guard guard(queuesLock);
+        if (!conn->hasTransport())
+            conn->associateTransport(transports_[conn->lane() % transports_.size()]);
+    }
 
-        if (stopProcessPequestsQueues)
-            return;
+    void Client::connect(const std::shared_ptr<Connection>& conn, const std::string& host,
+                         Connection::OnConnected onConnected)
+    {
+        // Once an HTTP/2 connection is up, the requests waiting for a
+        // connection of the host share it
+        if (conn->hostConnections())
+        {
+            onConnected = [this, conn = std::weak_ptr<Connection>(conn),
+                           onConnected = std::move(onConnected)](bool connected) {
+                if (onConnected)
+                    onConnected(connected);
+
+                auto established = conn.lock();
+                if (!connected || !established || !established->isMultiplexed())
+                    return;
+                if (auto host = established->hostConnections())
+                    processRequestQueue(*host);
+            };
+        }
+
+        // The lookup runs on the resolver threads, connect() only hands the
+        // socket over to the transport
+        std::weak_ptr<Connection> weakConn = conn;
+        auto onError                       = [weakConn, onConnected](const char* error) {
+            auto conn = weakConn.lock();
+            if (conn)
+                conn->rejectPendingRequests(error);
+            if (onConnected)
+                onConnected(false);
+        };
 
-        for (auto& queues : requestsQueues)
+        // https hosts are pooled under their url, on port 443 by default
+        std::string authority = host;
+        if (authority.rfind("https://", 0) == 0)
         {
-            for (;;)
+            authority.erase(0, std::strlen("https://"));
+            if (!tls_)
             {
-                const auto& domain = queues.first;
-                auto conn          = pool.pickConnection(domain);
+                onError("https needs PISTACHE_USE_SSL");
+                return;
+            }
+
+            std::string serverName;
+            try
+            {
+                const AddressParser parser(authority);
+                serverName = parser.rawHost();
+                if (parser.family() == AF_INET6)
+                    serverName = serverName.substr(1, serverName.size() - 2);
+                if (!parser.hasColon())
+                    authority += ":443";
+            }
+            catch (const std::exception& e)
+            {
+                onError(e.what());
+                return;
+            }
+            conn->useTls(tls_, host, std::move(serverName));
+        }
+
+        if (connectTo_)
+        {
+            try
+            {
+                conn->connect(*connectTo_, onConnected);
+            }
+            catch (const std::exception& e)
+            {
+                onError(e.what());
+            }
+            return;
+        }
+
+        resolver_->resolveAll(authority).then(
+            [weakConn, onError, onConnected](const std::vector<Address>& addresses) {
+                auto conn = weakConn.lock();
                 if (!conn)
-                    break;
+                {
+                    onError("Connection lost");
+                    return;
+                }
 
-                auto& queue = queues.second;
-                std::shared_ptr<Connection::RequestData> data;
-                if (!queue.dequeue(data))
+                try
                 {
-                    pool.releaseConnection(conn);
-                    break;
+                    conn->connect(addresses, onConnected);
+                }
+                catch (const std::exception& e)
+                {
+                    onError(e.what());
+                }
+            },
+            [onError](std::exception_ptr exc) {
+                try
+                {
+                    std::rethrow_exception(exc);
+                }
+                catch (const std::exception& e)
+                {
+                    onError(e.what());
                 }
+            });
+    }
 
-                conn->performImpl(data->request, std::move(data->resolve),
-                                  std::move(data->reject), [this, conn]() {
-                                      pool.releaseConnection(conn);
-                                      processRequestQueue();
-                                  });
-            }
+    Tcp::TlsHandshakes Client::tlsHandshakes() const
+    {
+        Tcp::TlsHandshakes handshakes;
+#ifdef PISTACHE_USE_SSL
+        if (tls_)
+        {
+            handshakes.full    = tls_->fullHandshakes.load();
+            handshakes.resumed = tls_->resumedHandshakes.load();
+        }
+#endif /* PISTACHE_USE_SSL */
+        return handshakes;
+    }
+
+    void Client::scheduleReaper()
+    {
+        // Often enough for a connection to be closed within half of its
+        // timeout past it, at most every second
+        auto interval = std::chrono::milliseconds::max();
+        for (auto timeout : { idleTimeout_, maxLifetime_ })
+        {
+            if (timeout.count() > 0)
+                interval = std::min(interval, timeout / 2);
+        }
+        interval = std::clamp(interval, std::chrono::milliseconds(10), std::chrono::milliseconds(1000));
+
+        nextTransport()->schedule(interval, [this]() {
+            if (!reaping_)
+                return;
+
+            reapConnections();
+            scheduleReaper();
+        });
+    }
+
+    void Client::reapConnections()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        auto expired   = pool.claimExpired([&](const Connection& conn) {
+            return conn.isExpired(now, idleTimeout_, maxLifetime_);
+        });
+
+        for (auto& conn : expired)
+        {
+            conn->closeFromTransport([this, conn]() { releaseConnection(conn); });
         }
     }
 
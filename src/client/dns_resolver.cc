@@ -0,0 +1,426 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* dns_resolver.cc
+
+   Implementation of the asynchronous, caching host name resolver
+*/
+
+#include <pistache/config.h>
+#include <pistache/dns_resolver.h>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace Pistache
+{
+
+    namespace
+    {
+        Port parsePort(const AddressParser& parser)
+        {
+            if (!parser.hasColon())
+                return Port(Const::HTTP_STANDARD_PORT);
+
+            const auto& raw = parser.rawPort();
+            char* end       = nullptr;
+            long port       = std::strtol(raw.c_str(), &end, 10);
+            if (raw.empty() || *end != 0 || port < Port::min() || port > Port::max())
+                throw std::invalid_argument("Invalid port");
+            return Port(static_cast<uint16_t>(port));
+        }
+
+        // Every IPv4 and IPv6 address of the host, in the order of
+        // getaddrinfo()
+        std::vector<Address> lookupAddresses(const std::string& host)
+        {
+            AddressParser parser(host);
+            // IPv6 literals, and the wildcard, are handled by Address itself
+            if (parser.family() == AF_INET6 || parser.rawHost() == "*")
+                return { Address(host) };
+
+            const auto port = parsePort(parser);
+
+            struct addrinfo hints;
+            memset(&hints, 0, sizeof(struct addrinfo));
+            hints.ai_family   = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+
+            AddrInfo addressInfo;
+            const int res = addressInfo.invoke(parser.rawHost().c_str(), nullptr, &hints);
+            if (res != 0)
+                throw std::runtime_error(gai_strerror(res));
+
+            std::vector<Address> addresses;
+            for (const addrinfo* info = addressInfo.get_info_ptr(); info; info = info->ai_next)
+            {
+                if (info->ai_family != AF_INET && info->ai_family != AF_INET6)
+                    continue;
+
+                Address address(IP(info->ai_addr), port);
+                const bool seen = std::any_of(addresses.begin(), addresses.end(),
+                                              [&](const Address& other) {
+                                                  return other.family() == address.family()
+                                                      && other.host() == address.host();
+                                              });
+                if (!seen)
+                    addresses.push_back(std::move(address));
+            }
+
+            if (addresses.empty())
+                throw std::runtime_error("No address found");
+            return addresses;
+        }
+
+        // The name of the numeric host, empty when it has none
+        std::string lookupName(const std::string& ip)
+        {
+            sockaddr_storage storage;
+            memset(&storage, 0, sizeof(storage));
+            socklen_t len = 0;
+
+            auto* addr4 = reinterpret_cast<sockaddr_in*>(&storage);
+            auto* addr6 = reinterpret_cast<sockaddr_in6*>(&storage);
+            if (inet_pton(AF_INET, ip.c_str(), &addr4->sin_addr) == 1)
+            {
+                addr4->sin_family = AF_INET;
+                len               = sizeof(sockaddr_in);
+            }
+            else if (inet_pton(AF_INET6, ip.c_str(), &addr6->sin6_addr) == 1)
+            {
+                addr6->sin6_family = AF_INET6;
+                len                = sizeof(sockaddr_in6);
+            }
+            else
+                throw std::invalid_argument("Not a numeric host");
+
+            char host[NI_MAXHOST];
+            const int res = getnameinfo(reinterpret_cast<sockaddr*>(&storage), len, host,
+                                        sizeof(host), nullptr, 0, NI_NAMEREQD);
+            if (res == EAI_NONAME)
+                return std::string();
+            if (res != 0)
+                throw std::runtime_error(gai_strerror(res));
+            return host;
+        }
+    } // namespace
+
+    DnsResolver::DnsResolver(size_t threads, std::chrono::seconds ttl)
+        : ttl_(ttl)
+    {
+        if (threads == 0)
+            throw std::invalid_argument("DnsResolver needs at least one thread");
+
+        threads_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i)
+            threads_.emplace_back([this] { run(); });
+    }
+
+    DnsResolver::~DnsResolver() { shutdown(); }
+
+    Async::Promise<Address> DnsResolver::resolve(const std::string& host)
+    {
+        return lookup<Address>(host, false);
+    }
+
+    Async::Promise<std::vector<Address>> DnsResolver::resolveAll(const std::string& host)
+    {
+        return lookup<std::vector<Address>>(host, true);
+    }
+
+    template <typename T>
+    Async::Promise<T> DnsResolver::lookup(const std::string& host, bool all)
+    {
+        return Async::Promise<T>(
+            [&](Async::Resolver& resolve, Async::Rejection& reject) {
+                std::unique_lock<std::mutex> guard(lock_);
+
+                if (shutdown_)
+                {
+                    guard.unlock();
+                    reject(Error("DnsResolver has been shut down"));
+                    return;
+                }
+
+                auto it = cache_.find(host);
+                if (it != std::end(cache_))
+                {
+                    if (Clock::now() < it->second.expiry)
+                    {
+                        auto addresses = it->second.addresses;
+                        guard.unlock();
+                        if (all)
+                            resolve(std::move(addresses));
+                        else
+                            resolve(addresses.front());
+                        return;
+                    }
+                    cache_.erase(it);
+                }
+
+                auto& waiters = pending_[host];
+                waiters.push_back(Waiter { std::move(resolve), std::move(reject), all });
+
+                // Someone already is looking this host up
+                if (waiters.size() > 1)
+                    return;
+
+                queue_.push_back(Query { host, false });
+                guard.unlock();
+                cv_.notify_one();
+            });
+    }
+
+    Async::Promise<std::string> DnsResolver::resolveName(const std::string& ip)
+    {
+        return Async::Promise<std::string>(
+            [&](Async::Resolver& resolve, Async::Rejection& reject) {
+                std::unique_lock<std::mutex> guard(lock_);
+
+                if (shutdown_)
+                {
+                    guard.unlock();
+                    reject(Error("DnsResolver has been shut down"));
+                    return;
+                }
+
+                auto it = names_.find(ip);
+                if (it != std::end(names_))
+                {
+                    if (Clock::now() < it->second.expiry)
+                    {
+                        auto name = it->second.name;
+                        guard.unlock();
+                        if (name.empty())
+                            reject(Error(ip + " has no name"));
+                        else
+                            resolve(std::move(name));
+                        return;
+                    }
+                    names_.erase(it);
+                }
+
+                auto& waiters = pendingNames_[ip];
+                waiters.push_back(Waiter { std::move(resolve), std::move(reject), false });
+
+                if (waiters.size() > 1)
+                    return;
+
+                queue_.push_back(Query { ip, true });
+                guard.unlock();
+                cv_.notify_one();
+            });
+    }
+
+    std::optional<Address> DnsResolver::cached(const std::string& host) const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+
+        auto it = cache_.find(host);
+        if (it == std::end(cache_) || it->second.expiry <= Clock::now())
+            return std::nullopt;
+
+        return it->second.addresses.front();
+    }
+
+    std::optional<std::string> DnsResolver::cachedName(const std::string& ip) const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+
+        auto it = names_.find(ip);
+        if (it == std::end(names_) || it->second.expiry <= Clock::now())
+            return std::nullopt;
+
+        return it->second.name;
+    }
+
+    size_t DnsResolver::cacheSize() const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return cache_.size() + names_.size();
+    }
+
+    void DnsResolver::clearCache()
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        cache_.clear();
+        names_.clear();
+    }
+
+    void DnsResolver::shutdown()
+    {
+        std::unordered_map<std::string, std::vector<Waiter>> pending;
+        std::unordered_map<std::string, std::vector<Waiter>> pendingNames;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (shutdown_)
+                return;
+
+            shutdown_ = true;
+            queue_.clear();
+        }
+        cv_.notify_all();
+
+        for (auto& thread : threads_)
+        {
+            if (thread.joinable())
+                thread.join();
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            pending.swap(pending_);
+            pendingNames.swap(pendingNames_);
+        }
+
+        for (auto* lookups : { &pending, &pendingNames })
+        {
+            for (auto& lookup : *lookups)
+            {
+                for (auto& waiter : lookup.second)
+                    waiter.reject(Error("DnsResolver has been shut down"));
+            }
+        }
+    }
+
+    void DnsResolver::run()
+    {
+        for (;;)
+        {
+            Query query;
+            {
+                std::unique_lock<std::mutex> guard(lock_);
+                cv_.wait(guard, [this] { return shutdown_ || !queue_.empty(); });
+                if (shutdown_)
+                    return;
+
+                query = std::move(queue_.front());
+                queue_.pop_front();
+            }
+
+            if (query.reverse)
+                resolveNextName(query.host);
+            else
+                resolveNext(query.host);
+        }
+    }
+
+    void DnsResolver::resolveNext(const std::string& host)
+    {
+        std::vector<Address> addresses;
+        std::string error;
+        try
+        {
+            addresses = interleaveFamilies(lookupAddresses(host));
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+
+        std::vector<Waiter> waiters;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (!addresses.empty() && ttl_.count() > 0)
+                cache_[host] = CacheEntry { addresses, Clock::now() + ttl_ };
+
+            auto it = pending_.find(host);
+            if (it != std::end(pending_))
+            {
+                waiters = std::move(it->second);
+                pending_.erase(it);
+            }
+        }
+
+        for (auto& waiter : waiters)
+        {
+            if (addresses.empty())
+                waiter.reject(Error("Could not resolve " + host + ": " + error));
+            else if (waiter.all)
+                waiter.resolve(addresses);
+            else
+                waiter.resolve(addresses.front());
+        }
+    }
+
+    void DnsResolver::resolveNextName(const std::string& ip)
+    {
+        std::optional<std::string> name;
+        std::string error;
+        try
+        {
+            name = lookupName(ip);
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+
+        std::vector<Waiter> waiters;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            // A missing name is an answer, only failures are not cached
+            if (name && ttl_.count() > 0)
+                names_[ip] = NameEntry { *name, Clock::now() + ttl_ };
+
+            auto it = pendingNames_.find(ip);
+            if (it != std::end(pendingNames_))
+            {
+                waiters = std::move(it->second);
+                pendingNames_.erase(it);
+            }
+        }
+
+        for (auto& waiter : waiters)
+        {
+            if (!name)
+                waiter.reject(Error("Could not resolve " + ip + ": " + error));
+            else if (name->empty())
+                waiter.reject(Error(ip + " has no name"));
+            else
+                waiter.resolve(*name);
+        }
+    }
+
+    std::vector<Address> DnsResolver::interleaveFamilies(std::vector<Address> addresses)
+    {
+        if (addresses.empty())
+            return addresses;
+
+        const int first = addresses.front().family();
+        std::vector<Address> preferred, others;
+        for (auto& address : addresses)
+        {
+            if (address.family() == first)
+                preferred.push_back(std::move(address));
+            else
+                others.push_back(std::move(address));
+        }
+
+        std::vector<Address> interleaved;
+        interleaved.reserve(preferred.size() + others.size());
+        for (size_t i = 0; i < std::max(preferred.size(), others.size()); ++i)
+        {
+            if (i < preferred.size())
+                interleaved.push_back(std::move(preferred[i]));
+            if (i < others.size())
+                interleaved.push_back(std::move(others[i]));
+        }
+        return interleaved;
+    }
+
+    DnsResolver& DnsResolver::shared()
+    {
+        static DnsResolver resolver;
+        return resolver;
+    }
+
+} // namespace Pistache
@@ -0,0 +1,321 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* access_log.cc
+
+   Binary access log, written in batches by a thread of its own
+*/
+
+#include <pistache/access_log.h>
+#include <pistache/common.h>
+#include <pistache/http.h>
+#include <pistache/mailbox.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Pistache::Http
+{
+
+    struct AccessLog::Ring
+    {
+        explicit Ring(size_t capacity)
+            : records(capacity)
+        { }
+
+        RecordRing records;
+
+        // Set once the log is gone, the thread forgets the ring then
+        std::atomic<bool> closed { false };
+
+        // Requests seen by the thread, for the sampling
+        uint32_t seen = 0;
+    };
+
+    namespace
+    {
+        std::atomic<uint64_t> nextLogId { 0 };
+
+        // Rings of the calling thread, by log
+        thread_local std::vector<std::pair<uint64_t, std::shared_ptr<void>>> threadRings;
+
+        // Fixed part of a record, after its size
+        constexpr size_t HeaderSize = 8 + 8 + 4 + 2 + 1 + 1;
+
+        template <typename T>
+        void put(char*& out, T value)
+        {
+            std::memcpy(out, &value, sizeof(value));
+            out += sizeof(value);
+        }
+
+        template <typename T>
+        T get(const char*& in)
+        {
+            T value;
+            std::memcpy(&value, in, sizeof(value));
+            in += sizeof(value);
+            return value;
+        }
+    } // namespace
+
+    AccessLog::AccessLog(Fd fd, bool datagrams, size_t ringSize, std::chrono::milliseconds interval)
+        : id_(nextLogId.fetch_add(1, std::memory_order_relaxed))
+        , fd_(fd)
+        , datagrams_(datagrams)
+        , ringSize_(ringSize)
+        , interval_(interval)
+    {
+        writer_ = std::thread([this] { run(); });
+    }
+
+    std::shared_ptr<AccessLog> AccessLog::toFile(const std::string& path, size_t ringSize,
+                                                 std::chrono::milliseconds interval)
+    {
+        Fd fd = TRY_RET(::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644));
+        return std::shared_ptr<AccessLog>(new AccessLog(fd, false, ringSize, interval));
+    }
+
+    std::shared_ptr<AccessLog> AccessLog::toUdp(const Address& address, size_t ringSize,
+                                                std::chrono::milliseconds interval)
+    {
+        struct addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = address.family();
+        hints.ai_socktype = SOCK_DGRAM;
+
+        const auto host = address.host();
+        const auto port = address.port().toString();
+
+        AddrInfo addressInfo;
+        TRY(addressInfo.invoke(host.c_str(), port.c_str(), &hints));
+
+        for (const addrinfo* addr = addressInfo.get_info_ptr(); addr; addr = addr->ai_next)
+        {
+            Fd fd = ::socket(addr->ai_family, addr->ai_socktype | SOCK_CLOEXEC, addr->ai_protocol);
+            if (fd < 0)
+                continue;
+            if (::connect(fd, addr->ai_addr, addr->ai_addrlen) == 0)
+                return std::shared_ptr<AccessLog>(new AccessLog(fd, true, ringSize, interval));
+            ::close(fd);
+        }
+
+        throw std::runtime_error("Could not connect the access log to " + host + ":" + port);
+    }
+
+    std::shared_ptr<AccessLog> AccessLog::toUnixSocket(const std::string& path, size_t ringSize,
+                                                       std::chrono::milliseconds interval)
+    {
+        struct sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        if (path.size() >= sizeof(addr.sun_path))
+            throw std::invalid_argument("Unix socket path too long: " + path);
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.data(), path.size());
+
+        Fd fd = TRY_RET(::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0));
+        if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            const int error = errno;
+            ::close(fd);
+            throw std::runtime_error("Could not connect the access log to " + path + ": "
+                                     + std::strerror(error));
+        }
+        return std::shared_ptr<AccessLog>(new AccessLog(fd, true, ringSize, interval));
+    }
+
+    AccessLog::~AccessLog()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stop_ = true;
+        }
+        wakeup_.notify_one();
+        writer_.join();
+
+        std::lock_guard<std::mutex> guard(lock_);
+        drain();
+        for (const auto& ring : rings_)
+            ring->closed.store(true, std::memory_order_release);
+        ::close(fd_);
+    }
+
+    void AccessLog::setSampling(uint32_t n)
+    {
+        sampling_.store(std::max<uint32_t>(n, 1), std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<PendingAccess> AccessLog::begin(const Request& request,
+                                                    std::chrono::steady_clock::time_point received)
+    {
+        auto* threadRing = ring();
+        if (threadRing->seen++ % sampling() != 0)
+            return nullptr;
+
+        const auto& resource = request.resource();
+        return std::make_shared<PendingAccess>(PendingAccess {
+            shared_from_this(), received, request.method(), request.version(),
+            resource.substr(0, std::min(resource.size(), MaxResourceSize)) });
+    }
+
+    void AccessLog::record(const PendingAccess& access, Code status, uint64_t bytes)
+    {
+        const auto now      = std::chrono::steady_clock::now();
+        const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(now - access.received);
+        const auto time     = std::chrono::duration_cast<std::chrono::microseconds>(
+                              std::chrono::system_clock::now().time_since_epoch() - duration);
+
+        char record[HeaderSize + MaxResourceSize];
+        char* out = record;
+        put<uint64_t>(out, static_cast<uint64_t>(time.count()));
+        put<uint64_t>(out, bytes);
+        put<uint32_t>(out, static_cast<uint32_t>(std::min<int64_t>(duration.count(), UINT32_MAX)));
+        put<uint16_t>(out, static_cast<uint16_t>(status));
+        put<uint8_t>(out, static_cast<uint8_t>(access.method));
+        put<uint8_t>(out, static_cast<uint8_t>(access.version));
+        std::memcpy(out, access.resource.data(), access.resource.size());
+        out += access.resource.size();
+
+        if (!ring()->records.push(std::string_view(record, static_cast<size_t>(out - record))))
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void AccessLog::flush()
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        drain();
+    }
+
+    std::vector<AccessRecord> AccessLog::decode(std::string_view data)
+    {
+        std::vector<AccessRecord> records;
+        while (data.size() >= sizeof(uint32_t))
+        {
+            const char* in     = data.data();
+            const auto size    = get<uint32_t>(in);
+            if (size < HeaderSize || data.size() - sizeof(uint32_t) < size)
+                break;
+
+            AccessRecord record;
+            record.time     = get<uint64_t>(in);
+            record.bytes    = get<uint64_t>(in);
+            record.duration = std::chrono::microseconds(get<uint32_t>(in));
+            record.status   = static_cast<Code>(get<uint16_t>(in));
+            record.method   = static_cast<Method>(get<uint8_t>(in));
+            record.version  = static_cast<Version>(get<uint8_t>(in));
+            record.resource.assign(in, size - HeaderSize);
+            records.push_back(std::move(record));
+
+            data.remove_prefix(sizeof(uint32_t) + size);
+        }
+        return records;
+    }
+
+    AccessLog::Ring* AccessLog::ring()
+    {
+        for (const auto& entry : threadRings)
+        {
+            if (entry.first == id_)
+                return static_cast<Ring*>(entry.second.get());
+        }
+
+        // First request of the thread, the rings of the logs that are gone
+        // are forgotten along the way
+        threadRings.erase(std::remove_if(threadRings.begin(), threadRings.end(),
+                                         [](const auto& entry) {
+                                             return static_cast<Ring*>(entry.second.get())
+                                                 ->closed.load(std::memory_order_acquire);
+                                         }),
+                          threadRings.end());
+
+        auto ring = std::make_shared<Ring>(ringSize_);
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            rings_.push_back(ring);
+        }
+        threadRings.emplace_back(id_, ring);
+        return ring.get();
+    }
+
+    void AccessLog::run()
+    {
+        std::unique_lock<std::mutex> lock(lock_);
+        while (!stop_)
+        {
+            wakeup_.wait_for(lock, interval_);
+            drain();
+        }
+    }
+
+    void AccessLog::drain()
+    {
+        batch_.clear();
+        batchRecords_ = 0;
+        for (auto it = rings_.begin(); it != rings_.end();)
+        {
+            // Its thread is gone, nothing can be pushed to it anymore once
+            // what it holds has been read
+            const bool orphan = it->use_count() == 1;
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            (*it)->records.drain([this](std::string_view record) {
+                const auto size = static_cast<uint32_t>(record.size());
+                // A datagram holds whole records
+                if (datagrams_ && batch_.size() + sizeof(size) + record.size() > MaxDatagramSize)
+                    send();
+                batch_.append(reinterpret_cast<const char*>(&size), sizeof(size));
+                batch_.append(record);
+                ++batchRecords_;
+            });
+            if (orphan)
+                it = rings_.erase(it);
+            else
+                ++it;
+        }
+
+        send();
+    }
+
+    void AccessLog::send()
+    {
+        if (batch_.empty())
+            return;
+
+        const char* data = batch_.data();
+        size_t left      = batch_.size();
+        while (left > 0)
+        {
+            const ssize_t bytes = datagrams_ ? ::send(fd_, data, left, MSG_NOSIGNAL)
+                                             : ::write(fd_, data, left);
+            if (bytes < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            data += bytes;
+            left -= static_cast<size_t>(bytes);
+        }
+
+        if (left == 0)
+            written_.fetch_add(batchRecords_, std::memory_order_relaxed);
+        else
+            dropped_.fetch_add(batchRecords_, std::memory_order_relaxed);
+
+        batch_.clear();
+        batchRecords_ = 0;
+    }
+
+} // namespace Pistache::Http
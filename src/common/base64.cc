@@ -8,11 +8,13 @@
 
 // Our headers...
 #include <pistache/base64.h>
+#include <pistache/scan.h>
 
 // Standard C++ / POSIX system headers...
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <stdexcept>
 
@@ -74,50 +76,36 @@ const vector<byte>& Base64Decoder::Decode()
     // Calculate required size of output buffer...
     const auto DecodedSize = CalculateDecodedSize();
 
-    // Allocate sufficient storage...
+    // Only the characters before the first non-decodable one, such as padding,
+    //  are decoded. Find how many of them produced the decoded size...
+    string::size_type InputSize = DecodedSize / 3 * 4;
+    if (DecodedSize % 3 != 0)
+        InputSize += DecodedSize % 3 + 1;
+
+    // Allocate sufficient storage and decode them...
     m_DecodedData = vector<byte>(DecodedSize, byte(0x00));
     m_DecodedData.shrink_to_fit();
+    Pistache::Scan::base64Decode(m_Base64EncodedString.data(), InputSize,
+                                 reinterpret_cast<uint8_t*>(m_DecodedData.data()));
 
-    // Initialize decode input and output iterators...
-    string::size_type InputOffset  = 0;
-    string::size_type OutputOffset = 0;
+    // All done. Return constant reference to buffer containing decoded data...
+    return m_DecodedData;
+}
 
-    // While there is at least one set of three octets remaining to decode...
-    for (string::size_type Index = 2; Index < DecodedSize; Index += 3)
-    {
-        // Construct octets from sextets...
-        m_DecodedData.at(OutputOffset + 0) = static_cast<byte>(
-            DecodeCharacter(m_Base64EncodedString.at(InputOffset + 0)) << 2 | DecodeCharacter(m_Base64EncodedString.at(InputOffset + 1)) >> 4);
-        m_DecodedData.at(OutputOffset + 1) = static_cast<byte>(
-            DecodeCharacter(m_Base64EncodedString.at(InputOffset + 1)) << 4 | DecodeCharacter(m_Base64EncodedString.at(InputOffset + 2)) >> 2);
-        m_DecodedData.at(OutputOffset + 2) = static_cast<byte>(
-            DecodeCharacter(m_Base64EncodedString.at(InputOffset + 2)) << 6 | DecodeCharacter(m_Base64EncodedString.at(InputOffset + 3)));
-
-        // Reseek i/o pointers...
-        InputOffset += 4;
-        OutputOffset += 3;
-    }
+// Decode base 64 encoding, padded or not, into a caller supplied buffer without
+//  allocating...
+optional<size_t> Base64Decoder::DecodeInto(string_view Encoded,
+                                           byte* Output) noexcept
+{
+    // Let the vectorized decoder do the work...
+    const auto DecodedSize = Pistache::Scan::base64Decode(
+        Encoded.data(), Encoded.size(), reinterpret_cast<uint8_t*>(Output));
 
-    // There's less than three octets remaining...
-    switch (DecodedSize % 3)
-    {
-    // One octet left to construct...
-    case 1:
-        m_DecodedData.at(OutputOffset + 0) = static_cast<byte>(
-            DecodeCharacter(m_Base64EncodedString.at(InputOffset + 0)) << 2 | DecodeCharacter(m_Base64EncodedString.at(InputOffset + 1)) >> 4);
-        break;
+    // Input was not base 64...
+    if (DecodedSize == Pistache::Scan::Base64Invalid)
+        return nullopt;
 
-    // Two octets left to construct...
-    case 2:
-        m_DecodedData.at(OutputOffset + 0) = static_cast<byte>(
-            DecodeCharacter(m_Base64EncodedString.at(InputOffset + 0)) << 2 | DecodeCharacter(m_Base64EncodedString.at(InputOffset + 1)) >> 4);
-        m_DecodedData.at(OutputOffset + 1) = static_cast<byte>(
-            DecodeCharacter(m_Base64EncodedString.at(InputOffset + 1)) << 4 | DecodeCharacter(m_Base64EncodedString.at(InputOffset + 2)) >> 2);
-        break;
-    }
-
-    // All done. Return constant reference to buffer containing decoded data...
-    return m_DecodedData;
+    return DecodedSize;
 }
 
 // Convert an octet character to corresponding sextet, provided it can safely be
@@ -166,80 +154,24 @@ const string& Base64Encoder::Encode() noexcept
     m_Base64EncodedString = string(CalculateEncodedSize(m_InputBuffer.size()), '!');
     m_Base64EncodedString.shrink_to_fit();
 
-    // Number of complete octet triplets...
-    const auto OctetTriplets = m_InputBuffer.size() / 3;
-
-    // Initialize encode input and output offset registers...
-    string::size_type InputOffset  = 0;
-    string::size_type OutputOffset = 0;
-
-    // While there are still complete octet triplets remaining...
-    for (string::size_type Index = 0; Index < OctetTriplets; ++Index)
-    {
-        // Encode first sextet from first octet...
-        m_Base64EncodedString.at(OutputOffset + 0) = EncodeByte(static_cast<byte>(m_InputBuffer.at(InputOffset + 0) >> 2));
-
-        // Encode second sextet from first and second octet....
-        m_Base64EncodedString.at(OutputOffset + 1) = EncodeByte(static_cast<byte>(
-            (m_InputBuffer.at(InputOffset + 0) & static_cast<byte>(0x03)) << 4 | m_InputBuffer.at(InputOffset + 1) >> 4));
-
-        // Encode third sextet from second and third octet...
-        m_Base64EncodedString.at(OutputOffset + 2) = EncodeByte(static_cast<byte>(
-            (m_InputBuffer.at(InputOffset + 1) & static_cast<byte>(0x0F)) << 2 | m_InputBuffer.at(InputOffset + 2) >> 6));
-
-        // Encode fourth sextet from third octet...
-        m_Base64EncodedString.at(OutputOffset + 3) = EncodeByte(m_InputBuffer.at(InputOffset + 2) & static_cast<byte>(0x3F));
-
-        // Stride i/o pointers...
-        InputOffset += 3;
-        OutputOffset += 4;
-    }
-
-    // Since the length of padded base 64 encoding must always be a multiple of
-    //  four, after the last octet triplet, were there any additional octets in
-    //  the input to encode that were less than three in number?
-    switch (m_InputBuffer.size() % 3)
-    {
-    // Exactly one trailing octet followed...
-    case 1:
-
-        // Encode first sextet from remaining octet...
-        m_Base64EncodedString.at(OutputOffset + 0) = EncodeByte(static_cast<byte>(m_InputBuffer.at(InputOffset + 0) >> 2));
-
-        // Encode second sextet from remaining octet and empty second one...
-        m_Base64EncodedString.at(OutputOffset + 1) = EncodeByte(
-            (m_InputBuffer.at(InputOffset + 0) & static_cast<byte>(0x03)) << 4);
-
-        // Padd the two sextets with two padding characters to ensure the
-        //  total length is a multiple of four...
-        m_Base64EncodedString.at(OutputOffset + 2) = '=';
-        m_Base64EncodedString.at(OutputOffset + 3) = '=';
-        break;
-
-    // Exactly two trailing octets followed...
-    case 2:
-
-        // Encode first sextet from first octet...
-        m_Base64EncodedString.at(OutputOffset + 0) = EncodeByte(static_cast<byte>(m_InputBuffer.at(InputOffset + 0) >> 2));
-
-        // Encode second sextet from first and second octet...
-        m_Base64EncodedString.at(OutputOffset + 1) = EncodeByte(static_cast<byte>(
-            (m_InputBuffer.at(InputOffset + 0) & static_cast<byte>(0x03)) << 4 | m_InputBuffer.at(InputOffset + 1) >> 4));
-
-        // Encode third sextet from second and dummy third octet...
-        m_Base64EncodedString.at(OutputOffset + 2) = EncodeByte(
-            (m_InputBuffer.at(InputOffset + 1) & static_cast<byte>(0x0F)) << 2);
-
-        // Padd three sextets with a single padding character to ensure the
-        //  total length is a multiple of four...
-        m_Base64EncodedString.at(OutputOffset + 3) = '=';
-        break;
-    }
+    // Encode into it...
+    EncodeInto(m_InputBuffer.data(), m_InputBuffer.size(),
+               m_Base64EncodedString.data());
 
     // Return constant reference to encoded data to caller...
     return m_Base64EncodedString;
 }
 
+// Encode raw bytes into a caller supplied buffer without allocating...
+string::size_type Base64Encoder::EncodeInto(const byte* Input,
+                                            const size_t InputSize,
+                                            char* Output) noexcept
+{
+    // Let the vectorized encoder do the work...
+    return Pistache::Scan::base64Encode(
+        reinterpret_cast<const uint8_t*>(Input), InputSize, Output);
+}
+
 // Encode single binary byte to 6-bit base 64 character...
 inline unsigned char Base64Encoder::EncodeByte(const byte Byte) const
 {
@@ -271,16 +203,13 @@ inline unsigned char Base64Encoder::EncodeByte(const byte Byte) const
 // Encode a string into base 64 format...
 string Base64Encoder::EncodeString(const string& StringInput)
 {
-    // Allocate storage for binary form of message...
-    vector<byte> BinaryInput(StringInput.size());
-
-    // Convert message to binary form...
-    transform(StringInput.begin(), StringInput.end(), BinaryInput.begin(),
-              [](const char Character) { return byte(Character); });
+    // Allocate storage for the encoded string...
+    string Encoded(CalculateEncodedSize(StringInput.size()), '!');
 
-    // Encode to base 64...
-    Base64Encoder Encoder(BinaryInput);
+    // Encode straight from the string, without a binary copy of it...
+    EncodeInto(reinterpret_cast<const byte*>(StringInput.data()),
+               StringInput.size(), Encoded.data());
 
     // Return encoded string to caller by value...
-    return Encoder.Encode();
+    return Encoded;
 }
@@ -0,0 +1,327 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* buffer_pool.cc
+
+   Implementation of the pool of the blocks of memory of the buffers
+*/
+
+#include <pistache/buffer_pool.h>
+#include <pistache/config.h>
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Pistache
+{
+
+    namespace
+    {
+        // 512 bytes to 1 MiB
+        constexpr size_t ClassesCount = 12;
+        constexpr size_t SlabSize     = 2 * 1024 * 1024;
+        // What a thread keeps of every class, two blocks at least
+        constexpr size_t CachedBytes = 256 * 1024;
+
+        static_assert((BufferPool::MinBlock << (ClassesCount - 1)) == BufferPool::MaxBlock);
+
+        constexpr size_t classSize(size_t index) { return BufferPool::MinBlock << index; }
+
+        size_t classOf(size_t capacity)
+        {
+            size_t index = 0;
+            while (classSize(index) < capacity)
+                ++index;
+            return index;
+        }
+
+        std::atomic<bool> useHugePages { false };
+        // Whether the depot may hold blocks, the threads only lock it then
+        std::atomic<bool> carved { false };
+        std::atomic<uint64_t> allocatedBlocks { 0 };
+
+        struct Block
+        {
+            char* data;
+            bool slab;
+        };
+
+        // Blocks carved from huge pages that no thread holds
+        struct Depot
+        {
+            std::mutex lock;
+            std::array<std::vector<char*>, ClassesCount> blocks;
+        };
+
+        Depot& depot()
+        {
+            // Never destroyed, the threads still give blocks back while the
+            // process exits
+            static auto* instance = new Depot;
+            return *instance;
+        }
+
+        void giveToDepot(char* data, size_t index)
+        {
+            auto& shared = depot();
+            std::lock_guard<std::mutex> guard(shared.lock);
+            shared.blocks[index].push_back(data);
+        }
+
+        // An explicit huge page when the system reserved some, else a region
+        // aligned on one for the kernel to back with a transparent huge page
+        char* mapSlab()
+        {
+#ifdef MAP_HUGETLB
+            void* page = ::mmap(nullptr, SlabSize, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (page != MAP_FAILED)
+                return static_cast<char*>(page);
+#endif
+
+            void* region = ::mmap(nullptr, SlabSize * 2, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (region == MAP_FAILED)
+                return nullptr;
+
+            const auto start   = reinterpret_cast<uintptr_t>(region);
+            const auto aligned = (start + SlabSize - 1) & ~static_cast<uintptr_t>(SlabSize - 1);
+            if (aligned > start)
+                ::munmap(region, aligned - start);
+            const auto end = start + SlabSize * 2;
+            if (end > aligned + SlabSize)
+                ::munmap(reinterpret_cast<void*>(aligned + SlabSize), end - aligned - SlabSize);
+
+            auto* slab = reinterpret_cast<char*>(aligned);
+#ifdef MADV_HUGEPAGE
+            ::madvise(slab, SlabSize, MADV_HUGEPAGE);
+#endif
+            return slab;
+        }
+
+        // Set once the cache of the thread is gone, its blocks are then given
+        // straight back
+        thread_local bool cacheGone = false;
+
+        struct Cache
+        {
+            Cache()
+            {
+                for (size_t i = 0; i < ClassesCount; ++i)
+                    limits[i] = std::max<size_t>(2, CachedBytes / classSize(i));
+            }
+
+            ~Cache()
+            {
+                cacheGone = true;
+                for (size_t i = 0; i < ClassesCount; ++i)
+                {
+                    for (const auto& block : blocks[i])
+                    {
+                        if (block.slab)
+                            giveToDepot(block.data, i);
+                        else
+                            ::operator delete(block.data);
+                    }
+                }
+            }
+
+            std::array<std::vector<Block>, ClassesCount> blocks;
+            std::array<size_t, ClassesCount> limits;
+        };
+
+        Cache& cache()
+        {
+            thread_local Cache instance;
+            return instance;
+        }
+
+        // From the depot, carving a huge page when it is empty, else from the
+        // allocator
+        Block fresh(size_t index)
+        {
+            const bool hugePages = useHugePages.load(std::memory_order_relaxed);
+            if (hugePages || carved.load(std::memory_order_relaxed))
+            {
+                auto& shared = depot();
+                std::lock_guard<std::mutex> guard(shared.lock);
+
+                auto& blocks = shared.blocks[index];
+                if (blocks.empty() && hugePages)
+                {
+                    if (auto* slab = mapSlab())
+                    {
+                        const size_t count = SlabSize / classSize(index);
+                        for (size_t i = 0; i < count; ++i)
+                            blocks.push_back(slab + i * classSize(index));
+                        allocatedBlocks.fetch_add(count, std::memory_order_relaxed);
+                        carved.store(true, std::memory_order_relaxed);
+                    }
+                }
+
+                if (!blocks.empty())
+                {
+                    Block block { blocks.back(), true };
+                    blocks.pop_back();
+
+                    // Half a cache at once, the next ones do not lock
+                    if (!cacheGone)
+                    {
+                        auto& free         = cache().blocks[index];
+                        const size_t batch = std::min(blocks.size(), cache().limits[index] / 2);
+                        for (size_t i = 0; i < batch; ++i)
+                        {
+                            free.push_back(Block { blocks.back(), true });
+                            blocks.pop_back();
+                        }
+                    }
+                    return block;
+                }
+            }
+
+            allocatedBlocks.fetch_add(1, std::memory_order_relaxed);
+            return Block { static_cast<char*>(::operator new(classSize(index))), false };
+        }
+
+        Block take(size_t index)
+        {
+            if (!cacheGone)
+            {
+                auto& free = cache().blocks[index];
+                if (!free.empty())
+                {
+                    auto block = free.back();
+                    free.pop_back();
+                    return block;
+                }
+            }
+            return fresh(index);
+        }
+
+        void give(Block block, size_t index)
+        {
+            if (!cacheGone)
+            {
+                auto& own = cache();
+                if (own.blocks[index].size() < own.limits[index])
+                {
+                    own.blocks[index].push_back(block);
+                    return;
+                }
+            }
+
+            if (block.slab)
+                giveToDepot(block.data, index);
+            else
+                ::operator delete(block.data);
+        }
+    } // namespace
+
+    PooledBuffer::PooledBuffer(size_t capacity)
+    {
+        if (capacity > BufferPool::MaxBlock)
+        {
+            allocatedBlocks.fetch_add(1, std::memory_order_relaxed);
+            data_     = static_cast<char*>(::operator new(capacity));
+            capacity_ = capacity;
+            return;
+        }
+
+        const auto index = classOf(capacity);
+        const auto block = take(index);
+        data_            = block.data;
+        capacity_        = classSize(index);
+        slab_            = block.slab;
+    }
+
+    PooledBuffer::PooledBuffer(PooledBuffer&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0))
+        , capacity_(std::exchange(other.capacity_, 0))
+        , slab_(std::exchange(other.slab_, false))
+    { }
+
+    PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept
+    {
+        if (&other != this)
+        {
+            reset();
+            data_     = std::exchange(other.data_, nullptr);
+            size_     = std::exchange(other.size_, 0);
+            capacity_ = std::exchange(other.capacity_, 0);
+            slab_     = std::exchange(other.slab_, false);
+        }
+        return *this;
+    }
+
+    PooledBuffer::~PooledBuffer() { reset(); }
+
+    void PooledBuffer::reserve(size_t capacity)
+    {
+        if (capacity <= capacity_)
+            return;
+
+        PooledBuffer grown(capacity);
+        if (size_ > 0)
+            std::memcpy(grown.data_, data_, size_);
+        grown.size_ = size_;
+        *this       = std::move(grown);
+    }
+
+    void PooledBuffer::reset()
+    {
+        if (data_ == nullptr)
+            return;
+
+        if (capacity_ > BufferPool::MaxBlock)
+            ::operator delete(data_);
+        else
+            give(Block { data_, slab_ }, classOf(capacity_));
+
+        data_     = nullptr;
+        size_     = 0;
+        capacity_ = 0;
+        slab_     = false;
+    }
+
+    namespace BufferPool
+    {
+        void setHugePages(bool enabled)
+        {
+            useHugePages.store(enabled, std::memory_order_relaxed);
+        }
+
+        bool hugePages() { return useHugePages.load(std::memory_order_relaxed); }
+
+        void reserve(size_t bytes)
+        {
+            // The block of the head of a response and the one a request is
+            // read into
+            const size_t response = classOf(MinBlock);
+            const size_t request  = classOf(Const::MaxBuffer);
+            const size_t count    = bytes / (classSize(response) + classSize(request));
+
+            auto& own = cache();
+            for (const auto index : { response, request })
+            {
+                own.limits[index] = std::max(own.limits[index], count);
+                while (own.blocks[index].size() < count)
+                    own.blocks[index].push_back(fresh(index));
+            }
+        }
+
+        uint64_t allocated() { return allocatedBlocks.load(std::memory_order_relaxed); }
+    } // namespace BufferPool
+
+} // namespace Pistache
@@ -0,0 +1,112 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* clock.cc
+
+   Time taken by the reactor, and the formatted date of the Date header
+*/
+
+#include <pistache/clock.h>
+
+#include <ctime>
+
+namespace Pistache
+{
+
+    namespace
+    {
+        thread_local CachedClock::time_point cachedNow {};
+
+        struct FormattedDate
+        {
+            time_t second = -1;
+            // "Sun, 06 Nov 1994 08:49:37 GMT"
+            char text[30];
+        };
+
+        thread_local FormattedDate formattedDate;
+
+        void twoDigits(char* out, int value)
+        {
+            out[0] = static_cast<char>('0' + value / 10);
+            out[1] = static_cast<char>('0' + value % 10);
+        }
+
+        // Not strftime, whose names follow the locale
+        void format(time_t second, char (&text)[30])
+        {
+            static constexpr char Days[][4] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+            static constexpr char Months[][4] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                                  "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+            struct tm tm;
+            gmtime_r(&second, &tm);
+
+            char* out = text;
+            for (int i = 0; i < 3; ++i)
+                *out++ = Days[tm.tm_wday][i];
+            *out++ = ',';
+            *out++ = ' ';
+            twoDigits(out, tm.tm_mday);
+            out += 2;
+            *out++ = ' ';
+            for (int i = 0; i < 3; ++i)
+                *out++ = Months[tm.tm_mon][i];
+            *out++ = ' ';
+
+            const int year = tm.tm_year + 1900;
+            twoDigits(out, year / 100);
+            twoDigits(out + 2, year % 100);
+            out += 4;
+            *out++ = ' ';
+            twoDigits(out, tm.tm_hour);
+            out[2] = ':';
+            twoDigits(out + 3, tm.tm_min);
+            out[5] = ':';
+            twoDigits(out + 6, tm.tm_sec);
+            out += 8;
+            *out++ = ' ';
+            *out++ = 'G';
+            *out++ = 'M';
+            *out++ = 'T';
+        }
+    } // namespace
+
+    CachedClock::time_point CachedClock::coarse()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        // The epoch of the steady clock is the one of CLOCK_MONOTONIC
+        return time_point(std::chrono::duration_cast<time_point::duration>(
+            std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+    }
+
+    CachedClock::time_point CachedClock::now()
+    {
+        if (cachedNow != time_point())
+            return cachedNow;
+        return std::chrono::steady_clock::now();
+    }
+
+    std::string_view CachedClock::httpDate()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+
+        auto& date = formattedDate;
+        if (ts.tv_sec != date.second)
+        {
+            format(ts.tv_sec, date.text);
+            date.second = ts.tv_sec;
+        }
+        return std::string_view(date.text, 29);
+    }
+
+    void CachedClock::update(time_point now) { cachedNow = now; }
+
+    void CachedClock::reset() { cachedNow = time_point(); }
+
+} // namespace Pistache
@@ -0,0 +1,368 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* compression.cc
+
+   Implementation of the content codings and of the per-thread pool of
+   compressors
+*/
+
+#include <pistache/compression.h>
+#include <pistache/net.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+#include <zlib.h>
+#endif
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#include "string_utils.h"
+
+namespace Pistache::Http::Compression
+{
+
+    namespace
+    {
+        constexpr size_t MaxPooled = 16;
+
+        // Output grows by this much while a compressor still has data to give
+        constexpr size_t OutputStep = 16 * 1024;
+
+        bool equalsIgnoreCase(std::string_view left, std::string_view right)
+        {
+            return std::equal(left.begin(), left.end(), right.begin(), right.end(),
+                              [](char a, char b) {
+                                  return std::tolower(static_cast<unsigned char>(a))
+                                      == std::tolower(static_cast<unsigned char>(b));
+                              });
+        }
+
+        // Weight of a member of Accept-Encoding, 1 without a q parameter
+        double weightOf(std::string_view params)
+        {
+            while (!params.empty())
+            {
+                auto end   = params.find(';');
+                auto param = Private::trim(params.substr(0, end));
+                params     = end == std::string_view::npos ? std::string_view() : params.substr(end + 1);
+
+                if (param.size() < 2 || std::tolower(static_cast<unsigned char>(param[0])) != 'q'
+                    || param[1] != '=')
+                    continue;
+
+                const std::string value(param.substr(2));
+                char* last   = nullptr;
+                double qval = std::strtod(value.c_str(), &last);
+                if (last == value.c_str())
+                    return 0.0;
+                return std::clamp(qval, 0.0, 1.0);
+            }
+
+            return 1.0;
+        }
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+        class ZlibCompressor final : public Compressor
+        {
+        public:
+            ZlibCompressor(Header::Encoding encoding, int level)
+                : Compressor(level)
+                , encoding_(encoding)
+                , stream_()
+            {
+                // 16 more window bits asks zlib for a gzip wrapper instead of
+                // the zlib one that HTTP calls deflate
+                const int windowBits = encoding == Header::Encoding::Gzip ? 15 + 16 : 15;
+                const int zlevel     = level == DefaultLevel ? Z_DEFAULT_COMPRESSION : std::clamp(level, 0, 9);
+
+                if (deflateInit2(&stream_, zlevel, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                    throw Error("Could not initialize the zlib compressor");
+            }
+
+            ~ZlibCompressor() override { deflateEnd(&stream_); }
+
+            ZlibCompressor(const ZlibCompressor&)            = delete;
+            ZlibCompressor& operator=(const ZlibCompressor&) = delete;
+
+            Header::Encoding encoding() const override { return encoding_; }
+
+            void compress(const char* data, size_t size, Flush flush, std::string& out) override
+            {
+                static constexpr size_t MaxInput = std::numeric_limits<uInt>::max();
+
+                // zlib counts in uInt, larger inputs are fed in slices
+                do
+                {
+                    const size_t slice = std::min(size, MaxInput);
+                    const bool last    = slice == size;
+
+                    int mode = Z_NO_FLUSH;
+                    if (last && flush == Flush::Sync)
+                        mode = Z_SYNC_FLUSH;
+                    else if (last && flush == Flush::Finish)
+                        mode = Z_FINISH;
+
+                    stream_.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+                    stream_.avail_in = static_cast<uInt>(slice);
+
+                    do
+                    {
+                        const size_t offset = out.size();
+                        out.resize(offset + OutputStep);
+
+                        stream_.next_out  = reinterpret_cast<Bytef*>(&out[offset]);
+                        stream_.avail_out = static_cast<uInt>(OutputStep);
+
+                        const int ret = deflate(&stream_, mode);
+                        out.resize(out.size() - stream_.avail_out);
+
+                        if (ret == Z_STREAM_ERROR)
+                            throw Error("zlib compression failed");
+                    } while (stream_.avail_out == 0);
+
+                    data += slice;
+                    size -= slice;
+                } while (size > 0);
+            }
+
+            void reset() override { deflateReset(&stream_); }
+
+        private:
+            Header::Encoding encoding_;
+            z_stream stream_;
+        };
+#endif /* PISTACHE_USE_CONTENT_ENCODING_DEFLATE */
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_BROTLI
+        class BrotliCompressor final : public Compressor
+        {
+        public:
+            // The default quality of brotli (11) is meant for static content,
+            // responses are compressed on the fly
+            static constexpr int DefaultQuality = 5;
+
+            explicit BrotliCompressor(int level)
+                : Compressor(level)
+            {
+                open();
+            }
+
+            ~BrotliCompressor() override { BrotliEncoderDestroyInstance(state_); }
+
+            BrotliCompressor(const BrotliCompressor&)            = delete;
+            BrotliCompressor& operator=(const BrotliCompressor&) = delete;
+
+            Header::Encoding encoding() const override { return Header::Encoding::Br; }
+
+            void compress(const char* data, size_t size, Flush flush, std::string& out) override
+            {
+                BrotliEncoderOperation op = BROTLI_OPERATION_PROCESS;
+                if (flush == Flush::Sync)
+                    op = BROTLI_OPERATION_FLUSH;
+                else if (flush == Flush::Finish)
+                    op = BROTLI_OPERATION_FINISH;
+
+                auto nextIn    = reinterpret_cast<const uint8_t*>(data);
+                size_t availIn = size;
+
+                for (;;)
+                {
+                    size_t availOut  = 0;
+                    uint8_t* nextOut = nullptr;
+                    if (!BrotliEncoderCompressStream(state_, op, &availIn, &nextIn, &availOut, &nextOut, nullptr))
+                        throw Error("brotli compression failed");
+
+                    size_t produced = 0;
+                    auto output     = BrotliEncoderTakeOutput(state_, &produced);
+                    out.append(reinterpret_cast<const char*>(output), produced);
+
+                    if (availIn > 0 || BrotliEncoderHasMoreOutput(state_))
+                        continue;
+                    if (op == BROTLI_OPERATION_FINISH && !BrotliEncoderIsFinished(state_))
+                        continue;
+                    break;
+                }
+            }
+
+            // The encoder has no way to start over, its state is rebuilt
+            void reset() override
+            {
+                BrotliEncoderDestroyInstance(state_);
+                open();
+            }
+
+        private:
+            void open()
+            {
+                state_ = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+                if (state_ == nullptr)
+                    throw Error("Could not initialize the brotli compressor");
+
+                const int quality = level() == DefaultLevel ? DefaultQuality : std::clamp(level(), 0, 11);
+                BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY, static_cast<uint32_t>(quality));
+            }
+
+            BrotliEncoderState* state_ = nullptr;
+        };
+#endif /* PISTACHE_USE_CONTENT_ENCODING_BROTLI */
+
+        std::unique_ptr<Compressor> create(Header::Encoding encoding, [[maybe_unused]] int level)
+        {
+            switch (encoding)
+            {
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+            case Header::Encoding::Gzip:
+            case Header::Encoding::Deflate:
+                return std::make_unique<ZlibCompressor>(encoding, level);
+#endif
+#ifdef PISTACHE_USE_CONTENT_ENCODING_BROTLI
+            case Header::Encoding::Br:
+                return std::make_unique<BrotliCompressor>(level);
+#endif
+            default:
+                return nullptr;
+            }
+        }
+
+        // Compressors released by the thread, ready for the next response
+        std::vector<std::unique_ptr<Compressor>>& freeList()
+        {
+            thread_local std::vector<std::unique_ptr<Compressor>> free;
+            return free;
+        }
+    } // namespace
+
+    bool isSupported(Header::Encoding encoding)
+    {
+        switch (encoding)
+        {
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+        case Header::Encoding::Gzip:
+        case Header::Encoding::Deflate:
+            return true;
+#endif
+#ifdef PISTACHE_USE_CONTENT_ENCODING_BROTLI
+        case Header::Encoding::Br:
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    Header::Encoding negotiate(std::string_view acceptEncoding)
+    {
+        // By order of preference
+        static constexpr Header::Encoding Codings[] = { Header::Encoding::Br,
+                                                        Header::Encoding::Gzip,
+                                                        Header::Encoding::Deflate };
+
+        auto best         = Header::Encoding::Identity;
+        double bestWeight = 0.0;
+        for (auto coding : Codings)
+        {
+            if (!isSupported(coding))
+                continue;
+
+            const double weight = acceptWeight(acceptEncoding, coding);
+            if (weight > bestWeight)
+            {
+                best       = coding;
+                bestWeight = weight;
+            }
+        }
+
+        return best;
+    }
+
+    double acceptWeight(std::string_view acceptEncoding, Header::Encoding encoding)
+    {
+        const std::string_view coding = Header::encodingString(encoding);
+
+        double weight    = -1.0;
+        double anyWeight = -1.0;
+        while (!acceptEncoding.empty())
+        {
+            auto end       = acceptEncoding.find(',');
+            auto member    = Private::trim(acceptEncoding.substr(0, end));
+            acceptEncoding = end == std::string_view::npos ? std::string_view() : acceptEncoding.substr(end + 1);
+
+            auto paramsStart = member.find(';');
+            auto name        = Private::trim(member.substr(0, paramsStart));
+            auto value       = paramsStart == std::string_view::npos ? 1.0 : weightOf(member.substr(paramsStart + 1));
+
+            if (name == "*")
+                anyWeight = value;
+            else if (equalsIgnoreCase(name, coding)
+                     || (encoding == Header::Encoding::Gzip && equalsIgnoreCase(name, "x-gzip")))
+                weight = value;
+        }
+
+        if (weight >= 0.0)
+            return weight;
+        return anyWeight < 0.0 ? 0.0 : anyWeight;
+    }
+
+    void Release::operator()(Compressor* compressor) const
+    {
+        std::unique_ptr<Compressor> owned(compressor);
+        if (!owned)
+            return;
+
+        auto& free = freeList();
+        if (free.size() >= MaxPooled)
+            return;
+
+        try
+        {
+            owned->reset();
+            free.push_back(std::move(owned));
+        }
+        catch (const std::exception&)
+        {
+            // Not pooled, the compressor is freed
+        }
+    }
+
+    CompressorPtr acquire(Header::Encoding encoding, int level)
+    {
+        auto& free = freeList();
+        for (auto it = free.rbegin(); it != free.rend(); ++it)
+        {
+            if ((*it)->encoding() == encoding && (*it)->level() == level)
+            {
+                CompressorPtr compressor(it->release());
+                free.erase(std::next(it).base());
+                return compressor;
+            }
+        }
+
+        return CompressorPtr(create(encoding, level).release());
+    }
+
+    size_t pooled() { return freeList().size(); }
+
+    std::string compress(Header::Encoding encoding, int level, const char* data, size_t size)
+    {
+        auto compressor = acquire(encoding, level);
+        if (!compressor)
+            throw Error("Unsupported content coding");
+
+        std::string out;
+        out.reserve(size / 2 + 64);
+        compressor->compress(data, size, Compressor::Flush::Finish, out);
+        return out;
+    }
+
+} // namespace Pistache::Http::Compression
@@ -253,6 +253,37 @@ namespace Pistache::Http
         return os;
     }
 
+    namespace
+    {
+        // Calls func with the name and value of every pair of a Cookie
+        // header, until it returns false. Returns false if a pair has no
+        // value
+        template <typename Func>
+        bool forEachPair(std::string_view raw, Func func)
+        {
+            while (!raw.empty())
+            {
+                const auto end  = raw.find(';');
+                const auto pair = raw.substr(0, end);
+                const auto eq   = pair.find('=');
+                if (eq == std::string_view::npos)
+                    return false;
+
+                if (!func(pair.substr(0, eq), pair.substr(eq + 1)))
+                    return true;
+
+                if (end == std::string_view::npos)
+                    break;
+
+                raw.remove_prefix(end + 1);
+                while (!raw.empty() && (raw.front() == ' ' || raw.front() == '\t'))
+                    raw.remove_prefix(1);
+            }
+
+            return true;
+        }
+    } // namespace
+
     CookieJar::CookieJar()
         : cookies()
     { }
@@ -276,36 +307,25 @@ namespace Pistache::Http
         }
     }
 
-    void CookieJar::removeAllCookies() { cookies.clear(); }
+    void CookieJar::removeAllCookies()
+    {
+        cookies.clear();
+        raw_.clear();
+        parsed_ = 0;
+    }
 
     void CookieJar::addFromRaw(const char* str, size_t len)
     {
-        RawStreamBuf<> buf(const_cast<char*>(str), len);
-        StreamCursor cursor(&buf);
-
-        while (!cursor.eof())
-        {
-            StreamCursor::Token nameToken(cursor);
-
-            if (!match_until('=', cursor))
-                throw std::runtime_error("Invalid cookie, missing value");
-
-            auto name = nameToken.text();
-
-            if (!cursor.advance(1))
-                throw std::runtime_error("Invalid cookie, missing value");
-
-            StreamCursor::Token valueToken(cursor);
-
-            match_until(';', cursor);
-            auto value = valueToken.text();
+        const std::string_view header(str, len);
+        if (!forEachPair(header, [](std::string_view, std::string_view) { return true; }))
+            throw std::runtime_error("Invalid cookie, missing value");
 
-            Cookie cookie(std::move(name), std::move(value));
-            add(cookie);
+        if (header.empty())
+            return;
 
-            cursor.advance(1);
-            skip_whitespaces(cursor);
-        }
+        if (!raw_.empty())
+            raw_.append("; ");
+        raw_.append(header);
     }
 
     Cookie CookieJar::get(const std::string& name) const
@@ -316,12 +336,50 @@ namespace Pistache::Http
             return it->second.begin()
                 ->second; // it returns begin(), first element, could be changed.
         }
+
+        if (auto found = value(name))
+            return Cookie(name, std::string(*found));
+
         throw std::runtime_error("Could not find requested cookie");
     }
 
-    bool CookieJar::has(const std::string& name) const
+    bool CookieJar::has(std::string_view name) const
+    {
+        return value(name).has_value();
+    }
+
+    std::optional<std::string_view> CookieJar::value(std::string_view name) const
+    {
+        if (!cookies.empty())
+        {
+            auto it = cookies.find(std::string(name));
+            if (it != cookies.end())
+                return std::string_view(it->second.begin()->second.value);
+        }
+
+        std::optional<std::string_view> found;
+        forEachPair(std::string_view(raw_).substr(parsed_),
+                    [&](std::string_view pairName, std::string_view pairValue) {
+                        if (pairName != name)
+                            return true;
+                        found = pairValue;
+                        return false;
+                    });
+        return found;
+    }
+
+    void CookieJar::materialize() const
     {
-        return cookies.find(name) != cookies.end();
+        if (parsed_ == raw_.size())
+            return;
+
+        forEachPair(std::string_view(raw_).substr(parsed_),
+                    [this](std::string_view name, std::string_view value) {
+                        cookies[std::string(name)].emplace(
+                            std::string(value), Cookie(std::string(name), std::string(value)));
+                        return true;
+                    });
+        parsed_ = raw_.size();
     }
 
 } // namespace Pistache::Http
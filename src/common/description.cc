@@ -10,12 +10,18 @@
    Implementation of the description system
 */
 
+#include <pistache/compression.h>
 #include <pistache/config.h>
 #include <pistache/description.h>
+#include <pistache/file_cache.h>
 #include <pistache/http_header.h>
 
 #include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <mutex>
 #include <sstream>
+#include <string_view>
 
 #if __has_include(<filesystem>)
 #include <filesystem>
@@ -25,6 +31,8 @@ namespace filesystem = std::filesystem;
 namespace filesystem = std::experimental::filesystem;
 #endif
 
+#include "string_utils.h"
+
 namespace Pistache::Rest
 {
 
@@ -405,11 +413,156 @@ namespace Pistache::Rest
         return *this;
     }
 
+    namespace
+    {
+        // The serialized description, in every coding it is served with
+        struct Document
+        {
+            explicit Document(std::string body)
+                : json(std::move(body))
+            {
+                char hash[24];
+                std::snprintf(hash, sizeof(hash), "%zx", std::hash<std::string> {}(json));
+                etag = hash;
+
+                const std::pair<Http::Header::Encoding, std::string*> codings[] = {
+                    { Http::Header::Encoding::Br, &br }, { Http::Header::Encoding::Gzip, &gzip }
+                };
+                for (const auto& [coding, out] : codings)
+                {
+                    if (Http::Compression::isSupported(coding))
+                        *out = Http::Compression::compress(coding, Http::Compression::DefaultLevel,
+                                                           json.data(), json.size());
+                }
+            }
+
+            std::string json;
+            // Empty when the library is built without the coding
+            std::string br;
+            std::string gzip;
+            // Unquoted, the codings add their own suffix
+            std::string etag;
+        };
+
+        // If-None-Match uses the weak comparison (RFC 9110 13.1.2)
+        bool tagMatches(std::string_view ifNoneMatch, std::string_view etag)
+        {
+            while (!ifNoneMatch.empty())
+            {
+                auto end = ifNoneMatch.find(',');
+                auto tag = Http::Private::trim(ifNoneMatch.substr(0, end));
+                ifNoneMatch = end == std::string_view::npos ? std::string_view() : ifNoneMatch.substr(end + 1);
+
+                if (tag == "*")
+                    return true;
+                if (tag.substr(0, 2) == "W/")
+                    tag.remove_prefix(2);
+
+                if (tag == etag)
+                    return true;
+            }
+
+            return false;
+        }
+
+        void sendDocument(const Document& document, const Http::Request& request,
+                          Http::ResponseWriter& response)
+        {
+            const std::string* body = &document.json;
+            const char* suffix      = "";
+            auto coding             = Http::Header::Encoding::Identity;
+            if (auto accept = request.headers().tryGetRaw("Accept-Encoding"))
+            {
+                const auto value = accept->value();
+                const double br  = document.br.empty() ? 0.0 : Http::Compression::acceptWeight(value, Http::Header::Encoding::Br);
+                const double gz  = document.gzip.empty() ? 0.0 : Http::Compression::acceptWeight(value, Http::Header::Encoding::Gzip);
+
+                if (br > 0.0 && br >= gz)
+                {
+                    body   = &document.br;
+                    suffix = "-br";
+                    coding = Http::Header::Encoding::Br;
+                }
+                else if (gz > 0.0)
+                {
+                    body   = &document.gzip;
+                    suffix = "-gz";
+                    coding = Http::Header::Encoding::Gzip;
+                }
+            }
+
+            const auto etag = "\"" + document.etag + suffix + "\"";
+            auto& headers   = response.headers();
+            headers.add<Http::Header::ETag>(etag);
+            if (!document.br.empty() || !document.gzip.empty())
+                headers.add<Http::Header::Vary>("Accept-Encoding");
+
+            if (auto ifNoneMatch = request.headers().tryGetRaw("If-None-Match"))
+            {
+                if (tagMatches(ifNoneMatch->value(), etag))
+                {
+                    response.send(Http::Code::Not_Modified);
+                    return;
+                }
+            }
+
+            if (coding != Http::Header::Encoding::Identity)
+                headers.add<Http::Header::ContentEncoding>(coding);
+            response.send(Http::Code::Ok, body->data(), body->size(), MIME(Application, Json));
+        }
+    } // namespace
+
+    struct Swagger::Served
+    {
+        explicit Served(const Swagger& swagger)
+            : uiPath(swagger.uiPath_)
+            , uiDirectory(swagger.uiDirectory_)
+            , apiPath(swagger.apiPath_)
+            , serializer(swagger.serializer_)
+            , description(swagger.description_)
+        { }
+
+        // Serializes the description when it is not already
+        std::shared_ptr<const Document> document()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!cached)
+                cached = std::make_shared<const Document>(serializer(description));
+            return cached;
+        }
+
+        void reset(const Description& replacement)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            description = replacement;
+            cached.reset();
+        }
+
+        const std::string uiPath;
+        const std::string uiDirectory;
+        const std::string apiPath;
+        const Serializer serializer;
+        Http::FileCache files;
+
+        std::mutex lock;
+        Description description;
+        std::shared_ptr<const Document> cached;
+    };
+
+    Swagger& Swagger::description(const Description& description)
+    {
+        description_ = description;
+        if (served_)
+            served_->reset(description);
+        return *this;
+    }
+
     void Swagger::install(Rest::Router& router)
     {
+        served_ = std::make_shared<Served>(*this);
 
-        Route::Handler uiHandler = [=](const Rest::Request& req,
-                                       Http::ResponseWriter response) {
+        Route::Handler uiHandler = [served = served_](const Rest::Request& req,
+                                                      Http::ResponseWriter response) {
             const auto& res = req.resource();
 
             /*
@@ -481,21 +634,21 @@ namespace Pistache::Rest
                 std::string trailingSlashValue;
             };
 
-            Path ui(uiPath_);
-            Path uiDir(uiDirectory_);
+            Path ui(served->uiPath);
+            Path uiDir(served->uiDirectory);
 
             if (ui.matches(req))
             {
                 if (!Path::hasTrailingSlash(req))
                 {
-                    response.headers().add<Http::Header::Location>(uiPath_ + '/');
+                    response.headers().add<Http::Header::Location>(served->uiPath + '/');
 
                     response.send(Http::Code::Moved_Permanently);
                 }
                 else
                 {
                     auto index = uiDir.join("index.html");
-                    Http::serveFile(response, index);
+                    served->files.serve(req, response, index);
                 }
                 return Route::Result::Ok;
             }
@@ -507,9 +660,9 @@ namespace Pistache::Rest
                 // Check if the requested file is contained in the uiDirectory
                 // to prevent path traversal vulnerabilities.
                 // In C++20, use std::string::starts_with()
-                if (path.rfind(uiDirectory_, 0) == 0)
+                if (path.rfind(served->uiDirectory, 0) == 0)
                 {
-                    Http::serveFile(response, path);
+                    served->files.serve(req, response, path);
                     return Route::Result::Ok;
                 }
                 else
@@ -519,10 +672,9 @@ namespace Pistache::Rest
                 }
             }
 
-            else if (res == apiPath_)
+            else if (res == served->apiPath)
             {
-                response.send(Http::Code::Ok, serializer_(description_),
-                              MIME(Application, Json));
+                sendDocument(*served->document(), req, response);
                 return Route::Result::Ok;
             }
 
@@ -0,0 +1,156 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* executor.cc
+
+   Implementation of the work-stealing pool of threads
+*/
+
+#include <pistache/executor.h>
+
+#include <stdexcept>
+
+namespace Pistache
+{
+
+    namespace
+    {
+        // The executor running on this thread, if any, and the index of the
+        // thread in its pool
+        thread_local const Executor* currentExecutor = nullptr;
+        thread_local size_t currentIndex             = 0;
+
+        // A task that throws is dropped, the thread carries on
+        void runTask(Executor::Task& task)
+        {
+            try
+            {
+                task();
+            }
+            catch (...)
+            { }
+        }
+    } // namespace
+
+    Executor::Executor(size_t threads)
+    {
+        if (threads == 0)
+            throw std::invalid_argument("An executor needs at least one thread");
+
+        queues_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i)
+            queues_.push_back(std::make_unique<Queue>());
+
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i)
+            workers_.emplace_back([this, i] { run(i); });
+    }
+
+    Executor::~Executor() { shutdown(); }
+
+    void Executor::submit(Task task)
+    {
+        if (stop_.load(std::memory_order_acquire))
+            throw std::runtime_error("The executor has been shut down");
+
+        const size_t index = currentExecutor == this
+            ? currentIndex
+            : next_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+
+        {
+            auto& queue = *queues_[index];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        // Paired with the sleeping thread counting itself before it looks at
+        // the pending tasks, one of them sees the other
+        pending_.fetch_add(1, std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_seq_cst) > 0)
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            cv_.notify_one();
+        }
+    }
+
+    void Executor::shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (stop_.exchange(true, std::memory_order_acq_rel))
+                return;
+        }
+        cv_.notify_all();
+
+        for (auto& worker : workers_)
+            worker.join();
+
+        // Submitted while the threads were leaving
+        Task task;
+        while (take(0, task))
+            runTask(task);
+    }
+
+    bool Executor::take(size_t index, Task& task)
+    {
+        {
+            auto& own = *queues_[index];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.front());
+                own.tasks.pop_front();
+                pending_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        for (size_t i = 1; i < queues_.size(); ++i)
+        {
+            auto& victim = *queues_[(index + i) % queues_.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                pending_.fetch_sub(1, std::memory_order_relaxed);
+                stolen_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void Executor::run(size_t index)
+    {
+        currentExecutor = this;
+        currentIndex    = index;
+
+        for (;;)
+        {
+            Task task;
+            if (take(index, task))
+            {
+                runTask(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> guard(lock_);
+            sleeping_.fetch_add(1, std::memory_order_seq_cst);
+            cv_.wait(guard, [this] {
+                return stop_.load(std::memory_order_acquire)
+                    || pending_.load(std::memory_order_seq_cst) > 0;
+            });
+            sleeping_.fetch_sub(1, std::memory_order_relaxed);
+
+            if (stop_.load(std::memory_order_acquire)
+                && pending_.load(std::memory_order_acquire) == 0)
+                return;
+        }
+    }
+
+} // namespace Pistache
@@ -0,0 +1,119 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* file_prefetcher.cc
+
+   Implementation of the pool of threads reading files ahead of sendfile()
+*/
+
+#include <pistache/file_prefetcher.h>
+
+#include <cerrno>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace Pistache::Tcp
+{
+
+    namespace
+    {
+        // The byte itself is copied, the page it belongs to is not read from
+        // the disk if it is not in memory
+        bool isPageCached(Fd file, size_t offset)
+        {
+            char byte;
+            struct iovec iov { &byte, 1 };
+
+            const auto res = ::preadv2(file, &iov, 1, static_cast<off_t>(offset), RWF_NOWAIT);
+            if (res >= 0)
+                return true;
+            return errno != EAGAIN;
+        }
+
+        void waitForPages(Fd file, size_t offset, size_t size)
+        {
+            static const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+
+            char byte;
+            const size_t end = offset + size;
+            for (size_t pos = offset; pos < end; pos = (pos / pageSize + 1) * pageSize)
+            {
+                if (::pread(file, &byte, 1, static_cast<off_t>(pos)) <= 0)
+                    return;
+            }
+        }
+    } // namespace
+
+    FilePrefetcher::FilePrefetcher(size_t threads)
+    {
+        if (threads == 0)
+            throw std::invalid_argument("A prefetcher needs at least one thread");
+
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i)
+            workers_.emplace_back([this] { run(); });
+    }
+
+    FilePrefetcher::~FilePrefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stop_ = true;
+            jobs_.clear();
+        }
+        cv_.notify_all();
+
+        for (auto& worker : workers_)
+            worker.join();
+    }
+
+    bool FilePrefetcher::isCached(Fd file, size_t offset, size_t size)
+    {
+        if (size == 0)
+            return true;
+        return isPageCached(file, offset) && isPageCached(file, offset + size - 1);
+    }
+
+    void FilePrefetcher::prefetch(std::shared_ptr<const Fd> file, size_t offset, size_t size,
+                                  std::function<void()> done)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            jobs_.push_back(Job { std::move(file), offset, size, std::move(done) });
+        }
+        cv_.notify_one();
+    }
+
+    void FilePrefetcher::run()
+    {
+        for (;;)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(lock_);
+                cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+                if (stop_)
+                    return;
+
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+
+            // readahead() only starts the reads, reading a byte of each page
+            // then waits for them. A failure only means that sendfile() reads
+            // the range itself
+            ::readahead(*job.file, static_cast<off64_t>(job.offset), job.size);
+            waitForPages(*job.file, job.offset, job.size);
+
+            if (job.done)
+                job.done();
+        }
+    }
+
+} // namespace Pistache::Tcp
@@ -0,0 +1,587 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* hpack.cc
+
+   Implementation of the HPACK decoder and encoder
+*/
+
+#include <pistache/hpack.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace Pistache::Http::Hpack
+{
+
+    namespace
+    {
+        // RFC 7541 Appendix A
+        const HeaderField StaticTable[] = {
+            { ":authority", "" },
+            { ":method", "GET" },
+            { ":method", "POST" },
+            { ":path", "/" },
+            { ":path", "/index.html" },
+            { ":scheme", "http" },
+            { ":scheme", "https" },
+            { ":status", "200" },
+            { ":status", "204" },
+            { ":status", "206" },
+            { ":status", "304" },
+            { ":status", "400" },
+            { ":status", "404" },
+            { ":status", "500" },
+            { "accept-charset", "" },
+            { "accept-encoding", "gzip, deflate" },
+            { "accept-language", "" },
+            { "accept-ranges", "" },
+            { "accept", "" },
+            { "access-control-allow-origin", "" },
+            { "age", "" },
+            { "allow", "" },
+            { "authorization", "" },
+            { "cache-control", "" },
+            { "content-disposition", "" },
+            { "content-encoding", "" },
+            { "content-language", "" },
+            { "content-length", "" },
+            { "content-location", "" },
+            { "content-range", "" },
+            { "content-type", "" },
+            { "cookie", "" },
+            { "date", "" },
+            { "etag", "" },
+            { "expect", "" },
+            { "expires", "" },
+            { "from", "" },
+            { "host", "" },
+            { "if-match", "" },
+            { "if-modified-since", "" },
+            { "if-none-match", "" },
+            { "if-range", "" },
+            { "if-unmodified-since", "" },
+            { "last-modified", "" },
+            { "link", "" },
+            { "location", "" },
+            { "max-forwards", "" },
+            { "proxy-authenticate", "" },
+            { "proxy-authorization", "" },
+            { "range", "" },
+            { "referer", "" },
+            { "refresh", "" },
+            { "retry-after", "" },
+            { "server", "" },
+            { "set-cookie", "" },
+            { "strict-transport-security", "" },
+            { "transfer-encoding", "" },
+            { "user-agent", "" },
+            { "vary", "" },
+            { "via", "" },
+            { "www-authenticate", "" },
+        };
+
+        constexpr size_t StaticEntries = sizeof(StaticTable) / sizeof(StaticTable[0]);
+
+        struct Code
+        {
+            uint32_t bits;
+            uint8_t length;
+        };
+
+        // RFC 7541 Appendix B, the last one is EOS
+        constexpr Code HuffmanCodes[257] = {
+            { 0x1ff8, 13 }, { 0x7fffd8, 23 }, { 0xfffffe2, 28 }, { 0xfffffe3, 28 },
+            { 0xfffffe4, 28 }, { 0xfffffe5, 28 }, { 0xfffffe6, 28 }, { 0xfffffe7, 28 },
+            { 0xfffffe8, 28 }, { 0xffffea, 24 }, { 0x3ffffffc, 30 }, { 0xfffffe9, 28 },
+            { 0xfffffea, 28 }, { 0x3ffffffd, 30 }, { 0xfffffeb, 28 }, { 0xfffffec, 28 },
+            { 0xfffffed, 28 }, { 0xfffffee, 28 }, { 0xfffffef, 28 }, { 0xffffff0, 28 },
+            { 0xffffff1, 28 }, { 0xffffff2, 28 }, { 0x3ffffffe, 30 }, { 0xffffff3, 28 },
+            { 0xffffff4, 28 }, { 0xffffff5, 28 }, { 0xffffff6, 28 }, { 0xffffff7, 28 },
+            { 0xffffff8, 28 }, { 0xffffff9, 28 }, { 0xffffffa, 28 }, { 0xffffffb, 28 },
+            { 0x14, 6 }, { 0x3f8, 10 }, { 0x3f9, 10 }, { 0xffa, 12 },
+            { 0x1ff9, 13 }, { 0x15, 6 }, { 0xf8, 8 }, { 0x7fa, 11 },
+            { 0x3fa, 10 }, { 0x3fb, 10 }, { 0xf9, 8 }, { 0x7fb, 11 },
+            { 0xfa, 8 }, { 0x16, 6 }, { 0x17, 6 }, { 0x18, 6 },
+            { 0x0, 5 }, { 0x1, 5 }, { 0x2, 5 }, { 0x19, 6 },
+            { 0x1a, 6 }, { 0x1b, 6 }, { 0x1c, 6 }, { 0x1d, 6 },
+            { 0x1e, 6 }, { 0x1f, 6 }, { 0x5c, 7 }, { 0xfb, 8 },
+            { 0x7ffc, 15 }, { 0x20, 6 }, { 0xffb, 12 }, { 0x3fc, 10 },
+            { 0x1ffa, 13 }, { 0x21, 6 }, { 0x5d, 7 }, { 0x5e, 7 },
+            { 0x5f, 7 }, { 0x60, 7 }, { 0x61, 7 }, { 0x62, 7 },
+            { 0x63, 7 }, { 0x64, 7 }, { 0x65, 7 }, { 0x66, 7 },
+            { 0x67, 7 }, { 0x68, 7 }, { 0x69, 7 }, { 0x6a, 7 },
+            { 0x6b, 7 }, { 0x6c, 7 }, { 0x6d, 7 }, { 0x6e, 7 },
+            { 0x6f, 7 }, { 0x70, 7 }, { 0x71, 7 }, { 0x72, 7 },
+            { 0xfc, 8 }, { 0x73, 7 }, { 0xfd, 8 }, { 0x1ffb, 13 },
+            { 0x7fff0, 19 }, { 0x1ffc, 13 }, { 0x3ffc, 14 }, { 0x22, 6 },
+            { 0x7ffd, 15 }, { 0x3, 5 }, { 0x23, 6 }, { 0x4, 5 },
+            { 0x24, 6 }, { 0x5, 5 }, { 0x25, 6 }, { 0x26, 6 },
+            { 0x27, 6 }, { 0x6, 5 }, { 0x74, 7 }, { 0x75, 7 },
+            { 0x28, 6 }, { 0x29, 6 }, { 0x2a, 6 }, { 0x7, 5 },
+            { 0x2b, 6 }, { 0x76, 7 }, { 0x2c, 6 }, { 0x8, 5 },
+            { 0x9, 5 }, { 0x2d, 6 }, { 0x77, 7 }, { 0x78, 7 },
+            { 0x79, 7 }, { 0x7a, 7 }, { 0x7b, 7 }, { 0x7ffe, 15 },
+            { 0x7fc, 11 }, { 0x3ffd, 14 }, { 0x1ffd, 13 }, { 0xffffffc, 28 },
+            { 0xfffe6, 20 }, { 0x3fffd2, 22 }, { 0xfffe7, 20 }, { 0xfffe8, 20 },
+            { 0x3fffd3, 22 }, { 0x3fffd4, 22 }, { 0x3fffd5, 22 }, { 0x7fffd9, 23 },
+            { 0x3fffd6, 22 }, { 0x7fffda, 23 }, { 0x7fffdb, 23 }, { 0x7fffdc, 23 },
+            { 0x7fffdd, 23 }, { 0x7fffde, 23 }, { 0xffffeb, 24 }, { 0x7fffdf, 23 },
+            { 0xffffec, 24 }, { 0xffffed, 24 }, { 0x3fffd7, 22 }, { 0x7fffe0, 23 },
+            { 0xffffee, 24 }, { 0x7fffe1, 23 }, { 0x7fffe2, 23 }, { 0x7fffe3, 23 },
+            { 0x7fffe4, 23 }, { 0x1fffdc, 21 }, { 0x3fffd8, 22 }, { 0x7fffe5, 23 },
+            { 0x3fffd9, 22 }, { 0x7fffe6, 23 }, { 0x7fffe7, 23 }, { 0xffffef, 24 },
+            { 0x3fffda, 22 }, { 0x1fffdd, 21 }, { 0xfffe9, 20 }, { 0x3fffdb, 22 },
+            { 0x3fffdc, 22 }, { 0x7fffe8, 23 }, { 0x7fffe9, 23 }, { 0x1fffde, 21 },
+            { 0x7fffea, 23 }, { 0x3fffdd, 22 }, { 0x3fffde, 22 }, { 0xfffff0, 24 },
+            { 0x1fffdf, 21 }, { 0x3fffdf, 22 }, { 0x7fffeb, 23 }, { 0x7fffec, 23 },
+            { 0x1fffe0, 21 }, { 0x1fffe1, 21 }, { 0x3fffe0, 22 }, { 0x1fffe2, 21 },
+            { 0x7fffed, 23 }, { 0x3fffe1, 22 }, { 0x7fffee, 23 }, { 0x7fffef, 23 },
+            { 0xfffea, 20 }, { 0x3fffe2, 22 }, { 0x3fffe3, 22 }, { 0x3fffe4, 22 },
+            { 0x7ffff0, 23 }, { 0x3fffe5, 22 }, { 0x3fffe6, 22 }, { 0x7ffff1, 23 },
+            { 0x3ffffe0, 26 }, { 0x3ffffe1, 26 }, { 0xfffeb, 20 }, { 0x7fff1, 19 },
+            { 0x3fffe7, 22 }, { 0x7ffff2, 23 }, { 0x3fffe8, 22 }, { 0x1ffffec, 25 },
+            { 0x3ffffe2, 26 }, { 0x3ffffe3, 26 }, { 0x3ffffe4, 26 }, { 0x7ffffde, 27 },
+            { 0x7ffffdf, 27 }, { 0x3ffffe5, 26 }, { 0xfffff1, 24 }, { 0x1ffffed, 25 },
+            { 0x7fff2, 19 }, { 0x1fffe3, 21 }, { 0x3ffffe6, 26 }, { 0x7ffffe0, 27 },
+            { 0x7ffffe1, 27 }, { 0x3ffffe7, 26 }, { 0x7ffffe2, 27 }, { 0xfffff2, 24 },
+            { 0x1fffe4, 21 }, { 0x1fffe5, 21 }, { 0x3ffffe8, 26 }, { 0x3ffffe9, 26 },
+            { 0xffffffd, 28 }, { 0x7ffffe3, 27 }, { 0x7ffffe4, 27 }, { 0x7ffffe5, 27 },
+            { 0xfffec, 20 }, { 0xfffff3, 24 }, { 0xfffed, 20 }, { 0x1fffe6, 21 },
+            { 0x3fffe9, 22 }, { 0x1fffe7, 21 }, { 0x1fffe8, 21 }, { 0x7ffff3, 23 },
+            { 0x3fffea, 22 }, { 0x3fffeb, 22 }, { 0x1ffffee, 25 }, { 0x1ffffef, 25 },
+            { 0xfffff4, 24 }, { 0xfffff5, 24 }, { 0x3ffffea, 26 }, { 0x7ffff4, 23 },
+            { 0x3ffffeb, 26 }, { 0x7ffffe6, 27 }, { 0x3ffffec, 26 }, { 0x3ffffed, 26 },
+            { 0x7ffffe7, 27 }, { 0x7ffffe8, 27 }, { 0x7ffffe9, 27 }, { 0x7ffffea, 27 },
+            { 0x7ffffeb, 27 }, { 0xffffffe, 28 }, { 0x7ffffec, 27 }, { 0x7ffffed, 27 },
+            { 0x7ffffee, 27 }, { 0x7ffffef, 27 }, { 0x7fffff0, 27 }, { 0x3ffffee, 26 },
+            { 0x3fffffff, 30 },
+        };
+
+        constexpr int Eos = 256;
+
+        // Binary tree of the codes, walked one bit of the encoded string at
+        // a time. A negative child is the leaf of the symbol -child - 1
+        class HuffmanTree
+        {
+        public:
+            HuffmanTree()
+            {
+                nodes_.push_back({ 0, 0 });
+                for (int symbol = 0; symbol <= Eos; ++symbol)
+                {
+                    const auto& code = HuffmanCodes[symbol];
+
+                    size_t node = 0;
+                    for (int bit = code.length - 1; bit > 0; --bit)
+                    {
+                        const auto side = (code.bits >> bit) & 1;
+                        if (nodes_[node][side] == 0)
+                        {
+                            nodes_[node][side] = static_cast<int16_t>(nodes_.size());
+                            nodes_.push_back({ 0, 0 });
+                        }
+                        node = static_cast<size_t>(nodes_[node][side]);
+                    }
+                    nodes_[node][code.bits & 1] = static_cast<int16_t>(-symbol - 1);
+                }
+            }
+
+            int16_t child(size_t node, unsigned bit) const { return nodes_[node][bit]; }
+
+        private:
+            std::vector<std::array<int16_t, 2>> nodes_;
+        };
+
+        const HuffmanTree& huffmanTree()
+        {
+            static const HuffmanTree tree;
+            return tree;
+        }
+
+        // RFC 7541 5.1, the flags are the bits of the first byte above the
+        // prefix
+        void encodeInteger(std::string& out, size_t value, unsigned prefix, uint8_t flags)
+        {
+            const size_t max = (size_t(1) << prefix) - 1;
+            if (value < max)
+            {
+                out.push_back(static_cast<char>(flags | value));
+                return;
+            }
+
+            out.push_back(static_cast<char>(flags | max));
+            value -= max;
+            while (value >= 128)
+            {
+                out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<char>(value));
+        }
+
+        size_t decodeInteger(const uint8_t*& pos, const uint8_t* end, unsigned prefix)
+        {
+            if (pos == end)
+                throw DecodeError("Truncated integer");
+
+            const size_t max = (size_t(1) << prefix) - 1;
+            size_t value     = *pos++ & max;
+            if (value < max)
+                return value;
+
+            // Nothing a header block holds needs more than 32 bits
+            for (unsigned shift = 0; shift < 32; shift += 7)
+            {
+                if (pos == end)
+                    throw DecodeError("Truncated integer");
+
+                const auto byte = *pos++;
+                value += static_cast<size_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    if (value > std::numeric_limits<uint32_t>::max())
+                        break;
+                    return value;
+                }
+            }
+
+            throw DecodeError("Integer overflow");
+        }
+
+        void encodeString(std::string& out, std::string_view value)
+        {
+            const auto huffmanSize = huffmanEncodedSize(value);
+            if (huffmanSize < value.size())
+            {
+                encodeInteger(out, huffmanSize, 7, 0x80);
+                huffmanEncode(value, out);
+            }
+            else
+            {
+                encodeInteger(out, value.size(), 7, 0);
+                out.append(value);
+            }
+        }
+
+        std::string decodeString(const uint8_t*& pos, const uint8_t* end)
+        {
+            if (pos == end)
+                throw DecodeError("Truncated string");
+
+            const bool huffman = (*pos & 0x80) != 0;
+            const auto length  = decodeInteger(pos, end, 7);
+            if (length > static_cast<size_t>(end - pos))
+                throw DecodeError("Truncated string");
+
+            std::string_view data(reinterpret_cast<const char*>(pos), length);
+            pos += length;
+
+            return huffman ? huffmanDecode(data) : std::string(data);
+        }
+
+        // Values that hardly ever repeat would only push the others out of
+        // the table
+        bool shouldIndex(const HeaderField& field, size_t tableSize)
+        {
+            static constexpr std::string_view Unindexed[] = {
+                ":path", "age", "content-length", "etag", "if-modified-since",
+                "if-none-match", "last-modified", "location", "set-cookie"
+            };
+
+            if (field.size() > tableSize * 3 / 4)
+                return false;
+            return std::find(std::begin(Unindexed), std::end(Unindexed), field.name)
+                == std::end(Unindexed);
+        }
+
+        // Intermediaries must not index those either (RFC 7541 7.1.3)
+        bool isSensitive(const HeaderField& field)
+        {
+            return field.name == "authorization" || field.name == "proxy-authorization"
+                || (field.name == "cookie" && field.value.size() < 20);
+        }
+    } // namespace
+
+    void huffmanEncode(std::string_view data, std::string& out)
+    {
+        uint64_t bits  = 0;
+        unsigned count = 0;
+
+        for (unsigned char c : data)
+        {
+            const auto& code = HuffmanCodes[c];
+            bits             = (bits << code.length) | code.bits;
+            count += code.length;
+
+            while (count >= 8)
+            {
+                count -= 8;
+                out.push_back(static_cast<char>(bits >> count));
+            }
+        }
+
+        // Padded with the most significant bits of EOS, all ones
+        if (count > 0)
+            out.push_back(static_cast<char>((bits << (8 - count)) | (0xff >> count)));
+    }
+
+    size_t huffmanEncodedSize(std::string_view data)
+    {
+        size_t bits = 0;
+        for (unsigned char c : data)
+            bits += HuffmanCodes[c].length;
+        return (bits + 7) / 8;
+    }
+
+    std::string huffmanDecode(std::string_view data)
+    {
+        const auto& tree = huffmanTree();
+
+        std::string out;
+        out.reserve(data.size() * 8 / 5);
+
+        size_t node = 0;
+        // Bits read since the last symbol, and whether they all were ones
+        unsigned depth = 0;
+        bool ones      = true;
+
+        for (unsigned char c : data)
+        {
+            for (int bit = 7; bit >= 0; --bit)
+            {
+                const unsigned value = (c >> bit) & 1;
+                const auto child     = tree.child(node, value);
+
+                ++depth;
+                ones = ones && value == 1;
+
+                if (child < 0)
+                {
+                    const int symbol = -child - 1;
+                    if (symbol == Eos)
+                        throw DecodeError("EOS in a Huffman coded string");
+
+                    out.push_back(static_cast<char>(symbol));
+                    node  = 0;
+                    depth = 0;
+                    ones  = true;
+                }
+                else
+                {
+                    node = static_cast<size_t>(child);
+                }
+            }
+        }
+
+        if (depth > 7 || !ones)
+            throw DecodeError("Invalid Huffman padding");
+
+        return out;
+    }
+
+    Table::Table(size_t maxSize)
+        : maxSize_(maxSize)
+    { }
+
+    void Table::add(std::string name, std::string value)
+    {
+        HeaderField field { std::move(name), std::move(value) };
+        const auto size = field.size();
+
+        // An entry larger than the table empties it and is not added
+        evict(size);
+        if (size > maxSize_)
+            return;
+
+        size_ += size;
+        entries_.push_front(std::move(field));
+    }
+
+    void Table::setMaxSize(size_t maxSize)
+    {
+        maxSize_ = maxSize;
+        evict(0);
+    }
+
+    void Table::evict(size_t room)
+    {
+        while (!entries_.empty() && size_ + room > maxSize_)
+        {
+            size_ -= entries_.back().size();
+            entries_.pop_back();
+        }
+    }
+
+    const HeaderField& Table::at(size_t index) const
+    {
+        if (index == 0)
+            throw DecodeError("Invalid index");
+        if (index <= StaticEntries)
+            return StaticTable[index - 1];
+
+        index -= StaticEntries + 1;
+        if (index >= entries_.size())
+            throw DecodeError("Invalid index");
+        return entries_[index];
+    }
+
+    std::pair<size_t, bool> Table::find(std::string_view name, std::string_view value) const
+    {
+        size_t nameIndex = 0;
+
+        for (size_t i = 0; i < StaticEntries; ++i)
+        {
+            if (StaticTable[i].name != name)
+                continue;
+            if (StaticTable[i].value == value)
+                return { i + 1, true };
+            if (nameIndex == 0)
+                nameIndex = i + 1;
+        }
+
+        for (size_t i = 0; i < entries_.size(); ++i)
+        {
+            if (entries_[i].name != name)
+                continue;
+            if (entries_[i].value == value)
+                return { StaticEntries + i + 1, true };
+            if (nameIndex == 0)
+                nameIndex = StaticEntries + i + 1;
+        }
+
+        return { nameIndex, false };
+    }
+
+    Decoder::Decoder(size_t maxTableSize)
+        : table_(maxTableSize)
+        , maxTableSize_(maxTableSize)
+    { }
+
+    void Decoder::setMaxTableSize(size_t size)
+    {
+        maxTableSize_ = size;
+        if (table_.maxSize() > size)
+            table_.setMaxSize(size);
+    }
+
+    std::vector<HeaderField> Decoder::decode(const char* data, size_t size, size_t maxListSize)
+    {
+        const auto* pos = reinterpret_cast<const uint8_t*>(data);
+        const auto* end = pos + size;
+
+        std::vector<HeaderField> fields;
+        size_t listSize = 0;
+        const auto account = [&](const HeaderField& field) {
+            listSize += field.size();
+            if (listSize > maxListSize)
+                throw HeaderListTooLarge("Header list past the limit");
+        };
+
+        while (pos != end)
+        {
+            const auto byte = *pos;
+
+            // Indexed field
+            if (byte & 0x80)
+            {
+                const auto& entry = table_.at(decodeInteger(pos, end, 7));
+                account(entry);
+                fields.push_back(entry);
+                continue;
+            }
+
+            // Only allowed at the beginning of a block
+            if ((byte & 0xe0) == 0x20)
+            {
+                if (!fields.empty())
+                    throw DecodeError("Table size update after a field");
+
+                const auto tableSize = decodeInteger(pos, end, 5);
+                if (tableSize > maxTableSize_)
+                    throw DecodeError("Table size update past the limit");
+                table_.setMaxSize(tableSize);
+                continue;
+            }
+
+            const bool indexing = (byte & 0x40) != 0;
+            const auto index    = decodeInteger(pos, end, indexing ? 6 : 4);
+
+            HeaderField field;
+            field.name  = index == 0 ? decodeString(pos, end) : table_.at(index).name;
+            field.value = decodeString(pos, end);
+
+            if (indexing)
+                table_.add(field.name, field.value);
+            account(field);
+            fields.push_back(std::move(field));
+        }
+
+        return fields;
+    }
+
+    Encoder::Encoder(size_t maxTableSize)
+        : table_(std::min(maxTableSize, DefaultTableSize))
+        , limit_(maxTableSize)
+        , pendingMin_(table_.maxSize())
+    { }
+
+    void Encoder::setMaxTableSize(size_t size)
+    {
+        const auto tableSize = std::min(size, limit_);
+        if (tableSize == table_.maxSize())
+            return;
+
+        table_.setMaxSize(tableSize);
+        pendingMin_    = std::min(pendingMin_, tableSize);
+        pendingUpdate_ = true;
+    }
+
+    void Encoder::encode(const std::vector<HeaderField>& fields, std::string& out)
+    {
+        if (pendingUpdate_)
+        {
+            if (pendingMin_ < table_.maxSize())
+                encodeInteger(out, pendingMin_, 5, 0x20);
+            encodeInteger(out, table_.maxSize(), 5, 0x20);
+
+            pendingMin_    = table_.maxSize();
+            pendingUpdate_ = false;
+        }
+
+        for (const auto& field : fields)
+            encodeField(field, out);
+    }
+
+    void Encoder::encodeField(const HeaderField& field, std::string& out)
+    {
+        const auto [index, exact] = table_.find(field.name, field.value);
+        if (exact)
+        {
+            encodeInteger(out, index, 7, 0x80);
+            return;
+        }
+
+        const bool sensitive = isSensitive(field);
+        const bool indexing  = !sensitive && shouldIndex(field, table_.maxSize());
+
+        if (sensitive)
+            encodeInteger(out, index, 4, 0x10);
+        else if (indexing)
+            encodeInteger(out, index, 6, 0x40);
+        else
+            encodeInteger(out, index, 4, 0);
+
+        if (index == 0)
+            encodeString(out, field.name);
+        encodeString(out, field.value);
+
+        if (indexing)
+            table_.add(field.name, field.value);
+    }
+
+} // namespace Pistache::Http::Hpack
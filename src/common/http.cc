@@ -10,112 +10,278 @@
    Http layer implementation
 */
 
+#include <pistache/access_log.h>
+#include <pistache/clock.h>
 #include <pistache/config.h>
 #include <pistache/http.h>
+#include <pistache/http2.h>
 #include <pistache/net.h>
 #include <pistache/peer.h>
+#include <pistache/rate_limiter.h>
+#include <pistache/tracing.h>
 #include <pistache/transport.h>
-
+#include <pistache/websocket.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
 #include <stdexcept>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include <fcntl.h>
+#include <strings.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "string_utils.h"
+#include "striped_lock.h"
+#include "value_stream.h"
+
 namespace Pistache::Http
 {
 
-    template <typename H, typename Stream, typename... Args>
-    typename std::enable_if<Header::IsHeader<H>::value, Stream&>::type
-    writeHeader(Stream& stream, Args&&... args)
+    namespace
     {
-        H header(std::forward<Args>(args)...);
+        using namespace std::literals;
 
-        stream << H::Name << ": ";
-        header.write(stream);
+        // The response head is written straight to the buffer of the
+        // response, without an ostream
+        bool put(DynamicStreamBuf& buf, std::string_view data)
+        {
+            const auto size = static_cast<std::streamsize>(data.size());
+            return buf.sputn(data.data(), size) == size;
+        }
 
-        stream << crlf;
+        bool putNumber(DynamicStreamBuf& buf, uint64_t value)
+        {
+            char digits[std::numeric_limits<uint64_t>::digits10 + 1];
+            auto* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+            return put(buf, std::string_view(digits, end - digits));
+        }
 
-        return stream;
-    }
+        // The whole status line of every known code, preformatted
+        std::string_view statusLine(Version version, Code code)
+        {
+#define CODE(value, name, str) \
+    case Code::name:           \
+        return VERSION " " #value " " str "\r\n"sv;
+
+            switch (version)
+            {
+            case Version::Http10:
+                switch (code)
+                {
+#define VERSION "HTTP/1.0"
+                    STATUS_CODES
+#undef VERSION
+                }
+                break;
+            case Version::Http11:
+                switch (code)
+                {
+#define VERSION "HTTP/1.1"
+                    STATUS_CODES
+#undef VERSION
+                }
+                break;
+            case Version::Http2:
+                break;
+            }
+
+#undef CODE
+
+            return {};
+        }
 
-    namespace
-    {
         bool writeStatusLine(Version version, Code code, DynamicStreamBuf& buf)
         {
-#define OUT(...)          \
-    do                    \
-    {                     \
-        __VA_ARGS__;      \
-        if (!os)          \
-            return false; \
-    } while (0)
+            const auto line = statusLine(version, code);
+            if (!line.empty())
+                return put(buf, line);
+
+            // A code of an application
+            return put(buf, versionString(version)) && put(buf, " "sv)
+                && putNumber(buf, static_cast<unsigned>(code)) && put(buf, " "sv)
+                && put(buf, codeString(code)) && put(buf, "\r\n"sv);
+        }
+
+        bool writeContentLength(uint64_t length, DynamicStreamBuf& buf)
+        {
+            return put(buf, "Content-Length: "sv) && putNumber(buf, length) && put(buf, "\r\n"sv);
+        }
+
+        bool writeHeaders(const Header::Collection& headers, DynamicStreamBuf& buf)
+        {
+            Private::ValueStream values(buf);
 
-            std::ostream os(&buf);
+            bool ok = true;
+            const auto typed = [&](const Header::Header& header) {
+                if (!ok)
+                    return;
 
-            OUT(os << version << " ");
-            OUT(os << static_cast<int>(code));
-            OUT(os << ' ');
-            OUT(os << code);
-            OUT(os << crlf);
+                // The name of a typed header is its Name, which is enough
+                // to tell a Content-Length without a cast for every header
+                if (header.name() == Header::ContentLength::Name)
+                {
+                    ok = writeContentLength(static_cast<const Header::ContentLength&>(header).value(), buf);
+                    return;
+                }
 
-            return true;
+                ok = put(buf, header.name()) && put(buf, ": "sv);
+                if (!ok)
+                    return;
 
-#undef OUT
+                auto& os = values.get();
+                header.write(os);
+                ok = os && put(buf, "\r\n"sv);
+            };
+            const auto raw = [&](const Header::Raw& header) {
+                ok = ok && put(buf, header.name()) && put(buf, ": "sv) && put(buf, header.value())
+                    && put(buf, "\r\n"sv);
+            };
+            headers.forEachOnWire(typed, raw);
+
+            return ok;
         }
 
-        bool writeHeaders(const Header::Collection& headers, DynamicStreamBuf& buf)
+        bool writeCookies(const CookieJar& cookies, DynamicStreamBuf& buf)
         {
-#define OUT(...)          \
-    do                    \
-    {                     \
-        __VA_ARGS__;      \
-        if (!os)          \
-            return false; \
-    } while (0)
+            if (cookies.begin() == cookies.end())
+                return true;
+
+            Private::ValueStream values(buf);
+            auto& os = values.get();
+            for (const auto& cookie : cookies)
+            {
+                if (!put(buf, "Set-Cookie: "sv))
+                    return false;
+                os << cookie;
+                if (!os || !put(buf, "\r\n"sv))
+                    return false;
+            }
 
-            std::ostream os(&buf);
+            return true;
+        }
 
-            for (const auto& header : headers.list())
+        // Calls func with the peer of a response. The thread of its transport
+        // owns the peer and finds it by its handle, the other threads lock it
+        template <typename Func>
+        bool withPeer(Tcp::Transport* transport, Tcp::PeerHandle handle,
+                      const std::weak_ptr<Tcp::Peer>& weak, Func func)
+        {
+            if (transport != nullptr && transport->isInTransportThread())
             {
-                OUT(os << header->name() << ": ");
-                OUT(header->write(os));
-                OUT(os << crlf);
+                auto* peer = transport->findPeer(handle);
+                if (peer == nullptr)
+                    return false;
+                func(*peer);
+                return true;
             }
 
+            auto peer = weak.lock();
+            if (!peer)
+                return false;
+            func(*peer);
             return true;
+        }
 
-#undef OUT
+        Fd peerFd(Tcp::Transport* transport, Tcp::PeerHandle handle,
+                  const std::weak_ptr<Tcp::Peer>& weak)
+        {
+            Fd fd = -1;
+            if (!withPeer(transport, handle, weak, [&fd](Tcp::Peer& peer) { fd = peer.fd(); }))
+                throw std::runtime_error("Write failed: Broken pipe");
+            return fd;
         }
 
-        bool writeCookies(const CookieJar& cookies, DynamicStreamBuf& buf)
+        // Tells the connection, once, that the response to its request has
+        // been handed to the transport
+        void notifyQueued(std::weak_ptr<Private::ConnectionState>& connection,
+                          Tcp::Transport* transport, const std::weak_ptr<Tcp::Peer>& peer)
         {
-#define OUT(...)          \
-    do                    \
-    {                     \
-        __VA_ARGS__;      \
-        if (!os)          \
-            return false; \
-    } while (0)
+            if (auto state = connection.lock())
+                state->responseQueued(transport, peer);
+            connection.reset();
+        }
 
-            std::ostream os(&buf);
-            for (const auto& cookie : cookies)
+        // Records the request to the access log, once
+        void logAccess(std::shared_ptr<PendingAccess>& access, Code status, uint64_t bytes)
+        {
+            if (access)
+                access->log->record(*access, status, bytes);
+            access.reset();
+        }
+
+        void finishTrace(Tracing::PendingTrace& pending, Code code, bool written)
+        {
+            PISTACHE_TRACE_MARK(pending.trace[Tracing::Phase::Written]);
+            pending.trace.status  = code;
+            pending.trace.written = written;
+            pending.tracer->onTrace(std::move(pending.trace));
+        }
+
+        // Tells the listener of a response once its last write is done, and
+        // hands its trace to the tracer
+        void tellWritten(std::shared_ptr<ResponseListener>& listener,
+                         std::chrono::steady_clock::time_point since,
+                         std::shared_ptr<Tracing::PendingTrace>& trace, Code code,
+                         Async::Promise<ssize_t>& written)
+        {
+            if (trace)
             {
-                OUT(os << "Set-Cookie: ");
-                OUT(os << cookie);
-                OUT(os << crlf);
+                written.then([trace, code](ssize_t) { finishTrace(*trace, code, true); },
+                             [trace, code](std::exception_ptr) { finishTrace(*trace, code, false); });
+                trace.reset();
             }
 
-            return true;
+            if (!listener)
+                return;
+
+            written.then([listener, since, code](ssize_t) { listener->onWritten(code, since, true); },
+                         [listener, since, code](std::exception_ptr) {
+                             listener->onWritten(code, since, false);
+                         });
+            listener.reset();
+        }
 
-#undef OUT
+        // Interim response telling the client to go on with the body
+        constexpr char ContinueLine[] = "HTTP/1.1 100 Continue\r\n\r\n";
+
+        // HTTP/1.0 clients may send the header, it is ignored for them
+        bool expectsContinue(const Request& request)
+        {
+            if (request.version() != Version::Http11)
+                return false;
+            auto expect = request.headers().tryGet<Header::Expect>();
+            return expect && expect->expectation() == Expectation::Continue;
+        }
+
+        // Value of a hexadecimal digit, -1 for any other character
+        int hexValue(char c)
+        {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F')
+                return c - 'A' + 10;
+            return -1;
         }
 
         using HttpMethods = std::unordered_map<std::string, Method>;
@@ -126,11 +292,36 @@ namespace Pistache::Http
 #undef METHOD
         };
 
+        // Where the handler keeps the state of a connection
+        struct ConnectionSlot : Tcp::PeerSlot<Private::ConnectionState>
+        { };
+
     } // namespace
 
     namespace Private
     {
 
+        size_t parseChunkSize(std::string_view line, size_t max)
+        {
+            size_t size = 0;
+            size_t i    = 0;
+            for (; i < line.size(); ++i)
+            {
+                const int digit = hexValue(line[i]);
+                if (digit < 0)
+                    break;
+                if (static_cast<size_t>(digit) > max || size > (max - digit) / 16)
+                    throw HttpError(Code::Request_Entity_Too_Large, "Chunk exceeds maximum body size");
+                size = size * 16 + digit;
+            }
+
+            while (i < line.size() && (line[i] == ' ' || line[i] == '\t'))
+                ++i;
+            if (i == 0 || (i < line.size() && line[i] != ';'))
+                throw HttpError(Code::Bad_Request, "Invalid chunk size");
+            return size;
+        }
+
         Step::Step(Message* request)
             : message(request)
         { }
@@ -171,9 +362,9 @@ namespace Pistache::Http
                 return State::Again;
 
             StreamCursor::Token resToken(cursor);
-            while ((n = cursor.current()) != '?' && n != ' ')
-                if (!cursor.advance(1))
-                    return State::Again;
+            if (!match_until({ '?', ' ' }, cursor))
+                return State::Again;
+            n = cursor.current();
 
             request->resource_ = resToken.text();
 
@@ -183,43 +374,11 @@ namespace Pistache::Http
                 if (!cursor.advance(1))
                     return State::Again;
 
-                while ((n = cursor.current()) != ' ')
-                {
-                    StreamCursor::Token keyToken(cursor);
-                    if (!match_until({ '=', ' ', '&' }, cursor))
-                        return State::Again;
-
-                    std::string key = keyToken.text();
-
-                    auto c = cursor.current();
-                    if (c == ' ')
-                    {
-                        request->query_.add(std::move(key), "");
-                    }
-                    else if (c == '&')
-                    {
-                        request->query_.add(std::move(key), "");
-                        if (!cursor.advance(1))
-                            return State::Again;
-                    }
-                    else if (c == '=')
-                    {
-                        if (!cursor.advance(1))
-                            return State::Again;
-
-                        StreamCursor::Token valueToken(cursor);
-                        if (!match_until({ ' ', '&' }, cursor))
-                            return State::Again;
+                StreamCursor::Token queryToken(cursor);
+                if (!match_until(' ', cursor))
+                    return State::Again;
 
-                        std::string value = valueToken.text();
-                        request->query_.add(std::move(key), std::move(value));
-                        if (cursor.current() == '&')
-                        {
-                            if (!cursor.advance(1))
-                                return State::Again;
-                        }
-                    }
-                }
+                request->query_ = Uri::Query::fromRaw(queryToken.text());
             }
 
             // @Todo: Fragment
@@ -231,9 +390,8 @@ namespace Pistache::Http
             // HTTP-Version
             StreamCursor::Token versionToken(cursor);
 
-            while (!cursor.eol())
-                if (!cursor.advance(1))
-                    return State::Again;
+            if (!match_until_eol(cursor))
+                return State::Again;
 
             const char* ver   = versionToken.rawText();
             const size_t size = versionToken.size();
@@ -263,6 +421,11 @@ namespace Pistache::Http
 
             auto* response = static_cast<Response*>(message);
 
+            // Not enough bytes to tell the version yet, which also is the case
+            // between two pipelined responses
+            if (cursor.remaining() < strlen("HTTP/1.1"))
+                return State::Again;
+
             if (match_raw("HTTP/1.1", strlen("HTTP/1.1"), cursor))
             {
                 // response->version = Version::Http11;
@@ -295,10 +458,7 @@ namespace Pistache::Http
             if (!cursor.advance(1))
                 return State::Again;
 
-            while (!cursor.eol() && !cursor.eof())
-            {
-                cursor.advance(1);
-            }
+            match_until_eol(cursor);
 
             if (!cursor.advance(2))
                 return State::Again;
@@ -318,9 +478,8 @@ namespace Pistache::Http
                 // Read the header name
                 size_t start = cursor;
 
-                while (cursor.current() != ':')
-                    if (!cursor.advance(1))
-                        return State::Again;
+                if (!match_until(':', cursor))
+                    return State::Again;
 
                 // Skip the ':'
                 if (!cursor.advance(1))
@@ -335,11 +494,8 @@ namespace Pistache::Http
 
                 // Read the header value
                 start = cursor;
-                while (!cursor.eol())
-                {
-                    if (!cursor.advance(1))
-                        return State::Again;
-                }
+                if (!match_until_eol(cursor))
+                    return State::Again;
 
                 if (Header::LowercaseEqualStatic(name, "cookie"))
                 {
@@ -353,6 +509,20 @@ namespace Pistache::Http
                         Cookie::fromRaw(cursor.offset(start), cursor.diff(start)));
                 }
 
+                // Typed headers of the library are parsed when first accessed,
+                //  the raw header they will be parsed from is all that is kept
+                else if (lazy_ && Header::detail::knownSlotIgnoreCase(name) < Header::detail::KnownHeadersCount)
+                {
+                    std::string value(cursor.offset(start), cursor.diff(start));
+                    message->headers_.addDeferred(Header::Raw(std::move(name), std::move(value)));
+
+                    if (!cursor.advance(2))
+                        return State::Again;
+
+                    headerRevert.ignore();
+                    continue;
+                }
+
                 // If the header is registered with the Registry, add its strongly
                 //  typed form to the headers list...
                 else if (Header::Registry::instance().isRegistered(name))
@@ -389,6 +559,20 @@ namespace Pistache::Http
             if (cl && te)
                 raise("Got mutually exclusive ContentLength and TransferEncoding header");
 
+            if (headFirst_ && (te || (cl && cl->value() > 0)))
+            {
+                if (te && te->encoding() != Http::Header::Encoding::Chunked)
+                    raise("Unsupported Transfer-Encoding", Code::Not_Implemented);
+
+                if (mode_ == Mode::None)
+                {
+                    mode_ = Mode::Head;
+                    return State::Done;
+                }
+                if (mode_ != Mode::Buffered)
+                    return State::Done;
+            }
+
             if (cl)
                 return parseContentLength(cursor, cl);
 
@@ -407,6 +591,13 @@ namespace Pistache::Http
                 StreamCursor::Token token(cursor);
                 const size_t available = cursor.remaining();
 
+                // Grown with what arrives, a client announcing a large body
+                // does not get its memory before sending it
+                auto& body        = message->body_;
+                const size_t wants = body.size() + std::min(available, size);
+                if (wants > body.capacity())
+                    body.reserve(std::min<size_t>(contentLength, std::max(wants, body.capacity() * 2)));
+
                 // We have an incomplete body, read what we can
                 if (available < size)
                 {
@@ -434,7 +625,6 @@ namespace Pistache::Http
             // This is the first time we are reading the payload
             else
             {
-                message->body_.reserve(contentLength);
                 if (!readBody(contentLength))
                     return State::Again;
             }
@@ -447,18 +637,20 @@ namespace Pistache::Http
         {
             if (size == -1)
             {
+                if (!started)
+                {
+                    started   = true;
+                    bodyStart = cursor;
+                }
+
                 StreamCursor::Revert revert(cursor);
                 StreamCursor::Token chunkSize(cursor);
 
-                while (!cursor.eol())
-                    if (!cursor.advance(1))
-                        return Incomplete;
+                if (!match_until_eol(cursor))
+                    return Incomplete;
 
-                char* end;
-                const char* raw = chunkSize.rawText();
-                auto sz         = std::strtol(raw, &end, 16);
-                if (*end != '\r')
-                    throw std::runtime_error("Invalid chunk size");
+                const auto sz = parseChunkSize(
+                    std::string_view(chunkSize.rawText(), chunkSize.size()), maxBodySize - written);
 
                 // CRLF
                 if (!cursor.advance(2))
@@ -466,34 +658,77 @@ namespace Pistache::Http
 
                 revert.ignore();
 
-                size                      = sz;
+                size                      = static_cast<ssize_t>(sz);
                 alreadyAppendedChunkBytes = 0;
             }
 
             if (size == 0)
-                return Final;
+            {
+                // The trailers are dropped, an empty line ends them
+                for (;;)
+                {
+                    StreamCursor::Revert revert(cursor);
+                    StreamCursor::Token line(cursor);
+
+                    if (!match_until_eol(cursor))
+                        return Incomplete;
+                    const bool last = line.size() == 0;
+                    if (!cursor.advance(2))
+                        return Incomplete;
+
+                    revert.ignore();
+                    if (last)
+                        break;
+                }
 
-            message->body_.reserve(size);
-            StreamCursor::Token chunkData(cursor);
-            const ssize_t available = cursor.remaining();
+                if (inPlace)
+                    message->body_.assign(cursor.offset(bodyStart), written);
+                return Final;
+            }
 
-            if (available + alreadyAppendedChunkBytes < size + 2)
+            if (alreadyAppendedChunkBytes < size)
             {
-                cursor.advance(available);
-                message->body_.append(chunkData.rawText(), available);
-                alreadyAppendedChunkBytes += available;
-                return Incomplete;
+                const auto bytes = std::min<size_t>(cursor.remaining(), size - alreadyAppendedChunkBytes);
+                append(cursor, bytes);
+                alreadyAppendedChunkBytes += bytes;
+                if (alreadyAppendedChunkBytes < size)
+                    return Incomplete;
             }
-            cursor.advance(size - alreadyAppendedChunkBytes);
 
             // trailing EOL
+            if (cursor.remaining() < 2)
+                return Incomplete;
+            if (cursor.offset()[0] != '\r' || cursor.offset()[1] != '\n')
+                throw HttpError(Code::Bad_Request, "Missing CRLF after chunk");
             cursor.advance(2);
 
-            message->body_.append(chunkData.rawText(), size - alreadyAppendedChunkBytes);
-
             return Complete;
         }
 
+        void BodyStep::Chunk::append(StreamCursor& cursor, size_t bytes)
+        {
+            const char* data = cursor.offset();
+            if (inPlace)
+            {
+                // Moved down over the chunk lines already parsed, the
+                // receive buffer is owned by the parser
+                auto* dest = const_cast<char*>(cursor.offset(bodyStart + written));
+                if (dest != data)
+                    std::memmove(dest, data, bytes);
+            }
+            else
+            {
+                // Grown geometrically, up to the maximum size of the body
+                auto& body = message->body_;
+                if (body.size() + bytes > body.capacity())
+                    body.reserve(std::min(maxBodySize, std::max(body.size() + bytes, body.capacity() * 2)));
+                body.append(data, bytes);
+            }
+
+            written += bytes;
+            cursor.advance(bytes);
+        }
+
         State BodyStep::parseTransferEncoding(
             StreamCursor& cursor, const std::shared_ptr<Header::TransferEncoding>& te)
         {
@@ -512,12 +747,17 @@ namespace Pistache::Http
                         if (cursor.eof())
                             return State::Again;
                     }
-                    chunk.reset();
+                    chunk.finish();
+                }
+                catch (const HttpError&)
+                {
+                    chunk.finish();
+                    throw;
                 }
                 catch (const std::exception& e)
                 {
                     // reset chunk incase signal handled & chunk eventually reused
-                    chunk.reset();
+                    chunk.finish();
                     raise(e.what());
                 }
 
@@ -542,6 +782,10 @@ namespace Pistache::Http
             {
                 Step* step = allSteps[currentStep].get();
                 state      = step->apply(cursor);
+#ifdef PISTACHE_USE_TRACING
+                if (state != State::Again)
+                    PISTACHE_TRACE_MARK(stepsDoneAt_[currentStep]);
+#endif
                 if (state == State::Next)
                 {
                     ++currentStep;
@@ -563,6 +807,29 @@ namespace Pistache::Http
             cursor.reset();
 
             currentStep = 0;
+            stepsDoneAt_ = {};
+            static_cast<BodyStep*>(allSteps[2].get())->reset();
+        }
+
+        void ParserBase::resetKeepingPending()
+        {
+            buffer.discardConsumed();
+            currentStep = 0;
+            stepsDoneAt_ = {};
+            static_cast<BodyStep*>(allSteps[2].get())->reset();
+        }
+
+        bool ParserBase::hasPending() const { return cursor.remaining() > 0; }
+
+        std::string_view ParserBase::pending() const
+        {
+            return std::string_view(cursor.offset(), cursor.remaining());
+        }
+
+        void ParserBase::consume(size_t bytes)
+        {
+            cursor.advance(bytes);
+            buffer.discardConsumed();
         }
 
         Step* ParserBase::step()
@@ -570,36 +837,192 @@ namespace Pistache::Http
             return allSteps[currentStep].get();
         }
 
+        void ParserBase::setHeadFirst(bool headFirst)
+        {
+            static_cast<BodyStep*>(allSteps[2].get())->setHeadFirst(headFirst);
+        }
+
+        bool ParserBase::bodyPending() const
+        {
+            return currentStep == 2
+                && static_cast<const BodyStep*>(allSteps[2].get())->mode() == BodyStep::Mode::Head;
+        }
+
+        void ParserBase::streamBody()
+        {
+            static_cast<BodyStep*>(allSteps[2].get())->setMode(BodyStep::Mode::Streamed);
+        }
+
+        void ParserBase::bufferBody()
+        {
+            static_cast<BodyStep*>(allSteps[2].get())->setMode(BodyStep::Mode::Buffered);
+        }
+
+        void ParserBase::setInPlaceChunks(bool inPlace)
+        {
+            static_cast<BodyStep*>(allSteps[2].get())->setInPlaceChunks(inPlace);
+        }
+
     } // namespace Private
 
     namespace Uri
     {
 
+        namespace
+        {
+            // Calls func(name, value) for every parameter of a raw query, in
+            // order, until it returns false
+            template <typename Func>
+            void forEachParameter(std::string_view raw, Func func)
+            {
+                while (!raw.empty())
+                {
+                    const auto end   = raw.find('&');
+                    const auto param = raw.substr(0, end);
+
+                    const auto eq = param.find('=');
+                    const auto name
+                        = eq == std::string_view::npos ? param : param.substr(0, eq);
+                    const auto value
+                        = eq == std::string_view::npos ? std::string_view() : param.substr(eq + 1);
+
+                    if (!func(name, value) || end == std::string_view::npos)
+                        return;
+
+                    raw.remove_prefix(end + 1);
+                }
+            }
+
+            // A '%' that is not followed by two hexadecimal digits is kept
+            std::string percentDecode(std::string_view value)
+            {
+                std::string decoded;
+                decoded.reserve(value.size());
+
+                for (size_t i = 0; i < value.size(); ++i)
+                {
+                    const char c = value[i];
+                    if (c == '+')
+                    {
+                        decoded += ' ';
+                    }
+                    else if (c == '%' && i + 2 < value.size() && hexValue(value[i + 1]) >= 0
+                             && hexValue(value[i + 2]) >= 0)
+                    {
+                        decoded += static_cast<char>(hexValue(value[i + 1]) * 16 + hexValue(value[i + 2]));
+                        i += 2;
+                    }
+                    else
+                    {
+                        decoded += c;
+                    }
+                }
+
+                return decoded;
+            }
+        } // namespace
+
         Query::Query()
-            : params()
+            : raw_()
+            , params()
         { }
 
         Query::Query(
             std::initializer_list<std::pair<const std::string, std::string>> params)
-            : params(params)
+            : raw_()
+            , params(params)
+        { }
+
+        Query::Query(const Query& other) { *this = other; }
+
+        Query::Query(Query&& other) noexcept
+            : raw_(std::move(other.raw_))
+            , split_(other.split_.load(std::memory_order_relaxed))
+            , params(std::move(other.params))
         { }
 
+        Query& Query::operator=(const Query& other)
+        {
+            if (this == &other)
+                return *this;
+
+            // The other query may be split meanwhile
+            std::lock_guard<std::mutex> guard(Private::stripedLock(&other));
+            raw_ = other.raw_;
+            split_.store(other.split_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            params = other.params;
+            return *this;
+        }
+
+        Query& Query::operator=(Query&& other) noexcept
+        {
+            raw_ = std::move(other.raw_);
+            split_.store(other.split_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            params = std::move(other.params);
+            return *this;
+        }
+
+        Query Query::fromRaw(std::string raw)
+        {
+            Query query;
+            query.raw_ = std::move(raw);
+            query.split_.store(false, std::memory_order_relaxed);
+            return query;
+        }
+
         void Query::add(std::string name, std::string value)
         {
+            split();
+            raw_.clear();
             params.insert(std::make_pair(std::move(name), std::move(value)));
         }
 
         std::optional<std::string> Query::get(const std::string& name) const
         {
-            auto it = params.find(name);
-            if (it == std::end(params))
+            auto value = getView(name);
+            if (!value)
+                return std::nullopt;
+
+            return std::optional<std::string>(std::string(*value));
+        }
+
+        std::optional<std::string_view> Query::getView(std::string_view name) const
+        {
+            if (split_.load(std::memory_order_acquire))
+            {
+                auto it = params.find(std::string(name));
+                if (it == std::end(params))
+                    return std::nullopt;
+
+                return std::optional<std::string_view>(it->second);
+            }
+
+            // Like in the map, the first parameter of a given name wins
+            std::optional<std::string_view> found;
+            forEachParameter(raw_, [&](std::string_view key, std::string_view value) {
+                if (key != name)
+                    return true;
+
+                found = value;
+                return false;
+            });
+
+            return found;
+        }
+
+        std::optional<std::string> Query::getDecoded(std::string_view name) const
+        {
+            auto value = getView(name);
+            if (!value)
                 return std::nullopt;
 
-            return std::optional<std::string>(it->second);
+            return percentDecode(*value);
         }
 
         std::string Query::as_str() const
         {
+            split();
+
             std::string query_url;
             for (const auto& e : params)
             {
@@ -614,7 +1037,24 @@ namespace Pistache::Http
 
         bool Query::has(const std::string& name) const
         {
-            return params.find(name) != std::end(params);
+            return getView(name).has_value();
+        }
+
+        void Query::split() const
+        {
+            if (split_.load(std::memory_order_acquire))
+                return;
+
+            std::lock_guard<std::mutex> guard(Private::stripedLock(this));
+            if (split_.load(std::memory_order_relaxed))
+                return;
+
+            forEachParameter(raw_, [this](std::string_view key, std::string_view value) {
+                params.emplace(std::string(key), std::string(value));
+                return true;
+            });
+
+            split_.store(true, std::memory_order_release);
         }
 
     } // namespace Uri
@@ -649,6 +1089,30 @@ namespace Pistache::Http
 
     std::chrono::milliseconds Request::timeout() const { return timeout_; }
 
+    void Request::clear()
+    {
+        // Do not keep a large upload alive for the whole connection lifetime
+        static constexpr size_t MaxRetainedBody = 64 * 1024;
+
+        if (body_.capacity() > MaxRetainedBody)
+            std::string().swap(body_);
+        else
+            body_.clear();
+
+        version_ = Version::Http11;
+        cookies_.removeAllCookies();
+        headers_.clear();
+        resource_.clear();
+        query_.clear();
+#ifdef LIBSTDCPP_SMARTPTR_LOCK_FIXME
+        peer_.reset();
+#endif
+        address_ = Address();
+        timeout_ = std::chrono::milliseconds(0);
+        bodyFile_.reset();
+        received_ = {};
+    }
+
     Response::Response(Version version)
         : Message(version)
     { }
@@ -668,20 +1132,47 @@ namespace Pistache::Http
     ResponseStream::ResponseStream(ResponseStream&& other)
         : response_(std::move(other.response_))
         , peer_(std::move(other.peer_))
+        , handle_(other.handle_)
         , buf_(std::move(other.buf_))
         , transport_(other.transport_)
         , timeout_(std::move(other.timeout_))
+        , connection_(std::move(other.connection_))
+        , compressor_(std::move(other.compressor_))
+        , compressed_(std::move(other.compressed_))
+        , http2_(std::move(other.http2_))
+        , http2Stream_(other.http2Stream_)
+        , access_(std::move(other.access_))
+        , sent_(other.sent_)
+        , listener_(std::move(other.listener_))
+        , listenedSince_(other.listenedSince_)
+        , trace_(std::move(other.trace_))
+        , ending_(other.ending_)
     { }
 
     ResponseStream::ResponseStream(Message&& other, std::weak_ptr<Tcp::Peer> peer,
-                                   Tcp::Transport* transport, Timeout timeout,
-                                   size_t streamSize, size_t maxResponseSize)
+                                   Tcp::PeerHandle handle, Tcp::Transport* transport, Timeout timeout,
+                                   size_t streamSize, size_t maxResponseSize,
+                                   std::weak_ptr<Private::ConnectionState> connection,
+                                   Compression::CompressorPtr compressor,
+                                   std::shared_ptr<Http2::Session> http2, uint32_t http2Stream)
         : response_(std::move(other))
         , peer_(std::move(peer))
+        , handle_(handle)
         , buf_(streamSize, maxResponseSize)
         , transport_(transport)
         , timeout_(std::move(timeout))
+        , connection_(std::move(connection))
+        , compressor_(std::move(compressor))
+        , http2_(std::move(http2))
+        , http2Stream_(http2Stream)
     {
+        if (http2_)
+        {
+            http2_->respond(http2Stream_, Http2::Session::responseHead(response_, std::nullopt), {},
+                            false);
+            return;
+        }
+
         if (!writeStatusLine(response_.version(), response_.code(), buf_))
             throw Error("Response exceeded buffer size");
 
@@ -692,18 +1183,13 @@ namespace Pistache::Http
 
         if (writeHeaders(response_.headers(), buf_))
         {
-            std::ostream os(&buf_);
             /* @Todo @Major:
              * Correctly handle non-keep alive requests
              * Do not put Keep-Alive if version == Http::11 and request.keepAlive ==
              * true
              */
-            // writeHeader<Header::Connection>(os, ConnectionControl::KeepAlive);
-            // if (!os) throw Error("Response exceeded buffer size");
-            writeHeader<Header::TransferEncoding>(os, Header::Encoding::Chunked);
-            if (!os)
+            if (!put(buf_, "Transfer-Encoding: chunked\r\n\r\n"sv))
                 throw Error("Response exceeded buffer size");
-            os << crlf;
         }
     }
 
@@ -711,27 +1197,154 @@ namespace Pistache::Http
     {
         response_  = std::move(other.response_);
         peer_      = std::move(other.peer_);
+        handle_    = other.handle_;
         buf_       = std::move(other.buf_);
-        transport_ = other.transport_;
-        timeout_   = std::move(other.timeout_);
+        transport_  = other.transport_;
+        timeout_    = std::move(other.timeout_);
+        connection_ = std::move(other.connection_);
+        compressor_ = std::move(other.compressor_);
+        compressed_ = std::move(other.compressed_);
+        http2_      = std::move(other.http2_);
+        http2Stream_ = other.http2Stream_;
+        access_     = std::move(other.access_);
+        sent_       = other.sent_;
+        listener_      = std::move(other.listener_);
+        listenedSince_ = other.listenedSince_;
+        trace_         = std::move(other.trace_);
+        ending_        = other.ending_;
 
         return *this;
     }
 
     std::streamsize ResponseStream::write(const char* data, std::streamsize sz)
     {
-        std::ostream os(&buf_);
-        os << std::hex << sz << crlf;
-        os.write(data, sz);
-        os << crlf;
+        if (compressor_)
+            compressChunk(data, static_cast<size_t>(sz), Compression::Compressor::Flush::None);
+        else
+            writeChunk(data, static_cast<size_t>(sz));
         return sz;
     }
 
-    std::shared_ptr<Tcp::Peer> ResponseStream::peer() const
+    void ResponseStream::write(RawBuffer buffer)
     {
-        if (peer_.expired())
+        if (compressor_)
         {
-            throw std::runtime_error("Write failed: Broken pipe");
+            // Encoded through the compressor, it is copied anyway
+            write(buffer.data().data(), static_cast<std::streamsize>(buffer.size()));
+            return;
+        }
+
+        const size_t size = buffer.size();
+        writeBuffer(std::move(buffer), size);
+    }
+
+    void ResponseStream::write(const FileBuffer& file)
+    {
+        if (!compressor_)
+        {
+            writeBuffer(file, file.size());
+            return;
+        }
+
+        std::string data(file.size(), '\0');
+        size_t done = 0;
+        while (done < data.size())
+        {
+            const ssize_t bytes = ::pread(file.fd(), data.data() + done, data.size() - done,
+                                          static_cast<off_t>(file.offset() + done));
+            if (bytes < 0 && errno == EINTR)
+                continue;
+            if (bytes <= 0)
+                throw Error("Could not read the file of a chunk");
+            done += static_cast<size_t>(bytes);
+        }
+        write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    void ResponseStream::write(const SharedBuffer& buffer)
+    {
+        if (compressor_)
+        {
+            write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            return;
+        }
+
+        writeBuffer(buffer, buffer.size());
+    }
+
+    template <typename Buf>
+    void ResponseStream::writeBuffer(Buf buffer, size_t size)
+    {
+        // An empty chunk would end the body
+        if (size == 0)
+            return;
+
+        timeout_.disarm();
+        auto pending          = buf_.buffer();
+        const size_t buffered = pending.size();
+        buf_.clear();
+
+        if (http2_)
+        {
+            std::vector<Http2::BodyPart> body;
+            if (buffered > 0)
+                body.emplace_back(std::move(pending));
+            body.emplace_back(std::move(buffer));
+            track(http2_->sendData(http2Stream_, std::move(body), false), buffered + size);
+            return;
+        }
+
+        // What was buffered goes out in front of the head. The queue sends
+        // consecutive raw buffers with a single sendmsg()
+        std::string head(pending.data(), 0, buffered);
+        char digits[sizeof(size_t) * 2];
+        head.append(digits, std::to_chars(digits, digits + sizeof(digits), size, 16).ptr);
+        head.append("\r\n", 2);
+
+        auto fd                = peerFd(transport_, handle_, peer_);
+        const size_t headBytes = head.size();
+        track(transport_->asyncWrite(fd, RawBuffer(std::move(head), headBytes)), headBytes);
+        track(transport_->asyncWrite(fd, std::move(buffer)), size);
+        track(transport_->asyncWrite(fd, RawBuffer("\r\n", 2)), 2);
+        transport_->flush(fd);
+    }
+
+    void ResponseStream::writeChunk(const char* data, size_t size)
+    {
+        // An empty chunk would end the body
+        if (size == 0)
+            return;
+
+        if (http2_)
+        {
+            // Framed by the session
+            buf_.sputn(data, static_cast<std::streamsize>(size));
+            return;
+        }
+
+        // Formatted in place, without an ostream for every chunk
+        char head[sizeof(size_t) * 2 + 2];
+        auto* end = std::to_chars(head, head + sizeof(head) - 2, size, 16).ptr;
+        *end++    = '\r';
+        *end++    = '\n';
+        buf_.sputn(head, end - head);
+        buf_.sputn(data, static_cast<std::streamsize>(size));
+        buf_.sputn("\r\n", 2);
+    }
+
+    void ResponseStream::compressChunk(const char* data, size_t size,
+                                       Compression::Compressor::Flush flush)
+    {
+        compressed_.clear();
+        compressor_->compress(data, size, flush, compressed_);
+        writeChunk(compressed_.data(), compressed_.size());
+    }
+
+    std::shared_ptr<Tcp::Peer> ResponseStream::peer() const
+    {
+        if (peer_.expired())
+        {
+            throw std::runtime_error("Write failed: Broken pipe");
         }
 
         return peer_.lock();
@@ -739,53 +1352,246 @@ namespace Pistache::Http
 
     void ResponseStream::flush()
     {
+        if (compressor_)
+            compressChunk(nullptr, 0, Compression::Compressor::Flush::Sync);
+
         timeout_.disarm();
-        auto buf = buf_.buffer();
 
-        auto fd = peer()->fd();
-        transport_->asyncWrite(fd, buf);
-        transport_->flush();
+        if (http2_)
+        {
+            auto buf           = buf_.buffer();
+            const size_t bytes = buf.size();
+            std::vector<Http2::BodyPart> body;
+            if (bytes > 0)
+                body.emplace_back(std::move(buf));
+            track(http2_->sendData(http2Stream_, std::move(body), false), bytes);
+            buf_.clear();
+            return;
+        }
 
-        buf_.clear();
+        // The block goes to the transport, the next chunks take another one
+        auto fd            = peerFd(transport_, handle_, peer_);
+        auto buf           = buf_.detach();
+        const size_t bytes = buf.size();
+        track(transport_->asyncWrite(fd, std::move(buf)), bytes);
+        transport_->flush(fd);
     }
 
     void ResponseStream::ends()
     {
-        std::ostream os(&buf_);
-        os << "0" << crlf;
-        os << crlf;
+        if (compressor_)
+        {
+            compressChunk(nullptr, 0, Compression::Compressor::Flush::Finish);
+            compressor_.reset();
+        }
+
+        // The last write tells the listener
+        ending_ = true;
+
+        if (http2_)
+        {
+            timeout_.disarm();
+
+            auto buf           = buf_.buffer();
+            const size_t bytes = buf.size();
+            std::vector<Http2::BodyPart> body;
+            if (bytes > 0)
+                body.emplace_back(std::move(buf));
+            track(http2_->sendData(http2Stream_, std::move(body), true), bytes);
+            buf_.clear();
+            return;
+        }
 
-        if (!os)
+        if (buf_.sputn("0\r\n\r\n", 5) != 5)
         {
             throw Error("Response exceeded buffer size");
         }
 
         flush();
+        notifyQueued(connection_, transport_, peer_);
+        logAccess(access_, response_.code(), sent_);
+    }
+
+    void ResponseStream::track(Async::Promise<ssize_t> write, size_t bytes)
+    {
+        sent_ += bytes;
+        if (ending_)
+            tellWritten(listener_, listenedSince_, trace_, response_.code(), write);
+
+        if (bytes == 0)
+            return;
+
+        // The transport resolves the write on its own thread, where the peer
+        // is found by its handle
+        if (transport_->isInTransportThread())
+        {
+            auto* peer = transport_->findPeer(handle_);
+            if (peer == nullptr)
+                return;
+
+            peer->queueBytes(bytes);
+            auto release = [transport = transport_, handle = handle_, bytes]() {
+                if (auto* peer = transport->findPeer(handle))
+                    peer->releaseBytes(bytes);
+            };
+            write.then([release](ssize_t) { release(); },
+                       [release](std::exception_ptr) { release(); });
+            return;
+        }
+
+        auto peer = peer_.lock();
+        if (!peer)
+            return;
+
+        peer->queueBytes(bytes);
+        std::weak_ptr<Tcp::Peer> weak = peer;
+        auto release                  = [weak, bytes]() {
+            if (auto peer = weak.lock())
+                peer->releaseBytes(bytes);
+        };
+        write.then([release](ssize_t) { release(); },
+                   [release](std::exception_ptr) { release(); });
+    }
+
+    size_t ResponseStream::queuedBytes() const
+    {
+        auto peer = peer_.lock();
+        return peer ? peer->queuedBytes() : 0;
+    }
+
+    bool ResponseStream::writable() const
+    {
+        auto peer = peer_.lock();
+        return peer && peer->queuedBytes() < peer->highWatermark();
+    }
+
+    Async::Promise<void> ResponseStream::whenWritable()
+    {
+        auto peer = peer_.lock();
+        if (!peer)
+            return Async::Promise<void>::rejected(Error("Connection closed"));
+        if (peer->queuedBytes() < peer->highWatermark())
+            return Async::Promise<void>::resolved();
+
+        return Async::Promise<void>([&](Async::Deferred<void> deferred) {
+            auto ready = std::make_shared<Async::Deferred<void>>(std::move(deferred));
+            peer->whenDrained([ready](bool open) {
+                if (open)
+                    ready->resolve();
+                else
+                    ready->reject(Error("Connection closed"));
+            });
+        });
+    }
+
+    void StreamGroup::add(ResponseStream&& stream)
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        streams_.push_back(std::move(stream));
+    }
+
+    size_t StreamGroup::broadcast(const SharedBuffer& payload)
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+
+        auto it = streams_.begin();
+        while (it != streams_.end())
+        {
+            // The connection may also go away while the chunk is written
+            bool open = !it->peer_.expired();
+            if (open)
+            {
+                try
+                {
+                    it->write(payload);
+                    // Left in the stream by the compressor otherwise
+                    if (it->compressor_)
+                        it->flush();
+                }
+                catch (const std::runtime_error&)
+                {
+                    open = false;
+                }
+            }
+
+            it = open ? it + 1 : streams_.erase(it);
+        }
+
+        return streams_.size();
+    }
+
+    void StreamGroup::close()
+    {
+        std::vector<ResponseStream> streams;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            streams.swap(streams_);
+        }
+
+        for (auto& stream : streams)
+        {
+            try
+            {
+                stream.ends();
+            }
+            catch (const std::runtime_error&)
+            { }
+        }
+    }
+
+    size_t StreamGroup::size() const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return streams_.size();
     }
 
     ResponseWriter::ResponseWriter(ResponseWriter&& other)
         : response_(std::move(other.response_))
         , peer_(other.peer_)
+        , handle_(other.handle_)
         , buf_(std::move(other.buf_))
         , transport_(other.transport_)
         , timeout_(std::move(other.timeout_))
+        , compression_(other.compression_)
+        , encoding_(other.encoding_)
+        , connection_(std::move(other.connection_))
+        , http2_(std::move(other.http2_))
+        , http2Stream_(other.http2Stream_)
+        , access_(std::move(other.access_))
+        , listener_(std::move(other.listener_))
+        , listenedSince_(other.listenedSince_)
+        , trace_(std::move(other.trace_))
+        , recorder_(std::move(other.recorder_))
     { }
 
     ResponseWriter::ResponseWriter(Http::Version version, Tcp::Transport* transport,
-                                   Handler* handler, std::weak_ptr<Tcp::Peer> peer)
+                                   Handler* handler, const std::shared_ptr<Tcp::Peer>& peer)
         : response_(version)
         , peer_(peer)
+        , handle_(peer ? peer->handle() : Tcp::PeerHandle())
         , buf_(DefaultStreamSize, handler->getMaxResponseSize())
         , transport_(transport)
         , timeout_(transport, version, handler, peer)
+        , compression_(handler->getCompression())
     { }
 
     ResponseWriter::ResponseWriter(const ResponseWriter& other)
         : response_(other.response_)
         , peer_(other.peer_)
+        , handle_(other.handle_)
         , buf_(DefaultStreamSize, other.buf_.maxSize())
         , transport_(other.transport_)
         , timeout_(other.timeout_)
+        , compression_(other.compression_)
+        , encoding_(other.encoding_)
+        , connection_(other.connection_)
+        , http2_(other.http2_)
+        , http2Stream_(other.http2Stream_)
+        , access_(other.access_)
+        , listener_(other.listener_)
+        , listenedSince_(other.listenedSince_)
+        , trace_(other.trace_)
+        , recorder_(other.recorder_)
     { }
 
     void ResponseWriter::setMime(const Mime::MediaType& mime)
@@ -824,17 +1630,162 @@ namespace Pistache::Http
         return sendImpl(code, data, size, mime);
     }
 
+    Async::Promise<ssize_t> ResponseWriter::send(Code code, std::string&& body,
+                                                 const Mime::MediaType& mime)
+    {
+        prepareResponse(code, mime);
+
+        auto size = body.size();
+        if (shouldCompress(size))
+            return putOnWire(compressBody(body.data(), size));
+
+        return putOnWire(RawBuffer(std::move(body), size));
+    }
+
     Async::Promise<ssize_t> ResponseWriter::sendImpl(Code code, const char* data,
                                                      const size_t size,
                                                      const Mime::MediaType& mime)
     {
-        if (!peer_.expired())
+        prepareResponse(code, mime);
+
+        if (shouldCompress(size))
+            return putOnWire(compressBody(data, size));
+
+        return putOnWire(data, size);
+    }
+
+    void ResponseWriter::setCompression(Header::Encoding encoding)
+    {
+        if (encoding == Header::Encoding::Identity || Compression::isSupported(encoding))
+            encoding_ = encoding;
+    }
+
+    bool ResponseWriter::shouldCompress(size_t size) const
+    {
+        return encoding_ != Header::Encoding::Identity && size > 0 && size >= compression_.minSize
+            && !response_.headers().has<Header::ContentEncoding>();
+    }
+
+    void ResponseWriter::addEncodingHeaders()
+    {
+        response_.headers().add<Header::ContentEncoding>(encoding_);
+        if (!response_.headers().has<Header::Vary>())
+            response_.headers().add<Header::Vary>("Accept-Encoding");
+    }
+
+    RawBuffer ResponseWriter::compressBody(const char* data, size_t size)
+    {
+        auto body = Compression::compress(encoding_, compression_.level, data, size);
+
+        addEncodingHeaders();
+
+        auto compressedSize = body.size();
+        return RawBuffer(std::move(body), compressedSize);
+    }
+
+    void ResponseWriter::attachHttp2(std::shared_ptr<Http2::Session> session, uint32_t stream)
+    {
+        http2_       = std::move(session);
+        http2Stream_ = stream;
+
+        timeout_.http2       = http2_;
+        timeout_.http2Stream = stream;
+    }
+
+    Async::Promise<ssize_t>
+    ResponseWriter::respondHttp2(std::optional<size_t> contentLength,
+                                 std::vector<std::variant<RawBuffer, FileBuffer, SharedBuffer>> body)
+    {
+        // The size of the header block is only known once it has been
+        // encoded, by the session
+        for (const auto& part : body)
+            sent_bytes_ += std::visit([](const auto& buffer) { return buffer.size(); }, part);
+
+        timeout_.disarm();
+
+        auto head    = Http2::Session::responseHead(response_, contentLength);
+        auto written = http2_->respond(http2Stream_, std::move(head), std::move(body), true);
+        tellWritten(listener_, listenedSince_, trace_, response_.code(), written);
+        return written;
+    }
+
+    void ResponseWriter::listen(std::shared_ptr<ResponseListener> listener,
+                                std::chrono::steady_clock::time_point since)
+    {
+        listener_      = std::move(listener);
+        listenedSince_ = since;
+    }
+
+    void ResponseWriter::record(std::shared_ptr<ResponseRecorder> recorder)
+    {
+        recorder_ = std::move(recorder);
+    }
+
+    Async::Promise<ssize_t> ResponseWriter::sendSerialized(Code code,
+                                                           const std::vector<SharedBuffer>& parts)
+    {
+        if (http2_)
+            return Async::Promise<ssize_t>::rejected(
+                Error("A serialized response can not be sent over HTTP/2"));
+
+        try
+        {
+            prepareResponse(code, Mime::MediaType());
+
+            size_t size = 0;
+            for (const auto& part : parts)
+                size += part.size();
+            sent_bytes_ += size;
+
+            timeout_.disarm();
+
+            auto fd = peerFd(transport_, handle_, peer_);
+
+            // Queued from the same thread, the parts are gathered in a single
+            // sendmsg() call. The last write tells when the response is out
+            size_t last = parts.size();
+            for (size_t i = 0; i < parts.size(); ++i)
+            {
+                if (!parts[i].empty())
+                    last = i;
+            }
+            for (size_t i = 0; i < last; ++i)
+            {
+                if (!parts[i].empty())
+                    transport_->asyncWrite(fd, parts[i]);
+            }
+
+            auto written = last == parts.size()
+                ? Async::Promise<ssize_t>::resolved(0)
+                : transport_->asyncWrite(fd, parts[last])
+                      .then<std::function<Async::Promise<ssize_t>(ssize_t)>,
+                            std::function<void(std::exception_ptr&)>>(
+                          [size](ssize_t) {
+                              return Async::Promise<ssize_t>::resolved(static_cast<ssize_t>(size));
+                          },
+
+                          [](std::exception_ptr& eptr) {
+                              return Async::Promise<ssize_t>::rejected(eptr);
+                          });
+            notifyQueued(connection_, transport_, peer_);
+            logAccess(access_, code, static_cast<uint64_t>(sent_bytes_));
+            tellWritten(listener_, listenedSince_, trace_, code, written);
+            return written;
+        }
+        catch (const std::runtime_error& e)
         {
-            auto curPeer = peer_.lock();
-            curPeer->setIdle(true); // change peer state to idle
+            return Async::Promise<ssize_t>::rejected(e);
+        }
+    }
 
-            // It will result in double free
-            // Http::Handler::getParser(curPeer)->reset(); // reset the timeout time
+    void ResponseWriter::prepareResponse(Code code, const Mime::MediaType& mime)
+    {
+        // The other streams of an HTTP/2 connection may still be open, its
+        // session tells when the peer is idle
+        if (!http2_)
+        {
+            // change peer state to idle
+            withPeer(transport_, handle_, peer_, [](Tcp::Peer& peer) { peer.setIdle(true); });
         }
 
         response_.code_ = code;
@@ -851,16 +1802,30 @@ namespace Pistache::Http
                 headers().add(std::make_shared<Header::ContentType>(mime));
             }
         }
-
-        return putOnWire(data, size);
     }
 
     ResponseStream ResponseWriter::stream(Code code, size_t streamSize)
     {
         response_.code_ = code;
 
-        return ResponseStream(std::move(response_), peer_, transport_,
-                              std::move(timeout_), streamSize, buf_.maxSize());
+        // The size of a stream is not known up front, it always is compressed
+        Compression::CompressorPtr compressor;
+        if (encoding_ != Header::Encoding::Identity
+            && !response_.headers().has<Header::ContentEncoding>())
+        {
+            compressor = Compression::acquire(encoding_, compression_.level);
+            addEncodingHeaders();
+        }
+
+        ResponseStream stream(std::move(response_), peer_, handle_, transport_,
+                              std::move(timeout_), streamSize, buf_.maxSize(),
+                              std::move(connection_), std::move(compressor),
+                              std::move(http2_), http2Stream_);
+        stream.access_        = std::move(access_);
+        stream.listener_      = std::move(listener_);
+        stream.listenedSince_ = listenedSince_;
+        stream.trace_         = std::move(trace_);
+        return stream;
     }
 
     const CookieJar& ResponseWriter::cookies() const { return response_.cookies(); }
@@ -895,62 +1860,82 @@ namespace Pistache::Http
 
     ResponseWriter ResponseWriter::clone() const { return ResponseWriter(*this); }
 
+    bool ResponseWriter::writeHead(size_t contentLength)
+    {
+        if (!writeStatusLine(response_.version(), response_.code(), buf_)
+            || !writeHeaders(response_.headers(), buf_) || !writeCookies(response_.cookies(), buf_))
+            return false;
+
+        /* @Todo @Major:
+         * Correctly handle non-keep alive requests
+         * Do not put Keep-Alive if version == Http::11 and request.keepAlive ==
+         * true
+         */
+        // An informational response has no content (RFC 9110 8.6)
+        if (static_cast<int>(response_.code()) >= 200 && !writeContentLength(contentLength, buf_))
+            return false;
+
+        return put(buf_, "\r\n"sv);
+    }
+
     Async::Promise<ssize_t> ResponseWriter::putOnWire(const char* data,
                                                       size_t len)
     {
         try
         {
-            std::ostream os(&buf_);
-
-#define OUT(...)                                         \
-    do                                                   \
-    {                                                    \
-        __VA_ARGS__;                                     \
-        if (!os)                                         \
-        {                                                \
-            return Async::Promise<ssize_t>::rejected(    \
-                Error("Response exceeded buffer size")); \
-        }                                                \
-    } while (0);
-
-            OUT(writeStatusLine(response_.version(), response_.code(), buf_));
-            OUT(writeHeaders(response_.headers(), buf_));
-            OUT(writeCookies(response_.cookies(), buf_));
-
-            /* @Todo @Major:
-             * Correctly handle non-keep alive requests
-             * Do not put Keep-Alive if version == Http::11 and request.keepAlive ==
-             * true
-             */
-            // OUT(writeHeader<Header::Connection>(os, ConnectionControl::KeepAlive));
-            OUT(writeHeader<Header::ContentLength>(os, len));
+            if (http2_)
+            {
+                std::vector<Http2::BodyPart> body;
+                if (len > 0)
+                    body.emplace_back(RawBuffer(data, len));
+                return respondHttp2(len, std::move(body));
+            }
 
-            OUT(os << crlf);
+            if (!writeHead(len))
+            {
+                return Async::Promise<ssize_t>::rejected(
+                    Error("Response exceeded buffer size"));
+            }
 
             if (len > 0)
             {
-                OUT(os.write(data, len));
+                if (!put(buf_, std::string_view(data, len)))
+                {
+                    return Async::Promise<ssize_t>::rejected(
+                        Error("Response exceeded buffer size"));
+                }
             }
 
-            auto buffer = buf_.buffer();
+            // Written from the block of the stream, no copy
+            auto buffer = buf_.detach();
             sent_bytes_ += buffer.size();
 
-            timeout_.disarm();
-
-#undef OUT
-
-            auto fd = peer()->fd();
+            if (recorder_)
+            {
+                const std::string_view wire(buffer.data(), buffer.size());
+                recorder_->onSerialized(response_, wire.substr(0, wire.size() - len),
+                                        wire.substr(wire.size() - len));
+                recorder_.reset();
+            }
 
-            return transport_->asyncWrite(fd, buffer)
-                .then<std::function<Async::Promise<ssize_t>(ssize_t)>,
-                      std::function<void(std::exception_ptr&)>>(
-                    [=](ssize_t data) {
-                        return Async::Promise<ssize_t>::resolved(data);
-                    },
+            timeout_.disarm();
 
-                    [=](std::exception_ptr& eptr) {
-                        return Async::Promise<ssize_t>::rejected(eptr);
-                    });
+            auto fd = peerFd(transport_, handle_, peer_);
+
+            auto written = transport_->asyncWrite(fd, std::move(buffer))
+                               .then<std::function<Async::Promise<ssize_t>(ssize_t)>,
+                                     std::function<void(std::exception_ptr&)>>(
+                                   [=](ssize_t data) {
+                                       return Async::Promise<ssize_t>::resolved(data);
+                                   },
+
+                                   [=](std::exception_ptr& eptr) {
+                                       return Async::Promise<ssize_t>::rejected(eptr);
+                                   });
+            notifyQueued(connection_, transport_, peer_);
+            logAccess(access_, response_.code(), static_cast<uint64_t>(sent_bytes_));
+            tellWritten(listener_, listenedSince_, trace_, response_.code(), written);
+            return written;
         }
         catch (const std::runtime_error& e)
         {
@@ -958,112 +1943,501 @@ namespace Pistache::Http
         }
     }
 
-    Async::Promise<ssize_t> serveFile(ResponseWriter& writer,
-                                      const std::string& fileName,
-                                      const Mime::MediaType& contentType)
+    Async::Promise<ssize_t> ResponseWriter::putOnWire(RawBuffer&& body)
     {
-        struct stat sb;
-
-        int fd = open(fileName.c_str(), O_RDONLY);
-        if (fd == -1)
+        try
         {
-            std::string str_error(strerror(errno));
-            if (errno == ENOENT)
+            if (http2_)
             {
-                throw HttpError(Http::Code::Not_Found, std::move(str_error));
+                const auto size = body.size();
+
+                std::vector<Http2::BodyPart> parts;
+                if (size > 0)
+                    parts.emplace_back(std::move(body));
+                return respondHttp2(size, std::move(parts));
             }
-            // eles if TODO
-            /* @Improvement: maybe could we check for errno here and emit a different
-       error message
-    */
-            else
+
+            if (!writeHead(body.size()))
             {
-                throw HttpError(Http::Code::Internal_Server_Error, std::move(str_error));
+                return Async::Promise<ssize_t>::rejected(
+                    Error("Response exceeded buffer size"));
             }
-        }
 
-        int res = ::fstat(fd, &sb);
-        close(fd); // Done with fd, close before error can be thrown
-        if (res == -1)
-        {
-            throw HttpError(Code::Internal_Server_Error, "");
-        }
+            auto head     = buf_.detach();
+            auto headSize = static_cast<ssize_t>(head.size());
+            sent_bytes_ += head.size() + body.size();
 
-        auto* buf = writer.rdbuf();
+            if (recorder_)
+            {
+                recorder_->onSerialized(response_, std::string_view(head.data(), head.size()),
+                                        std::string_view(body.data().data(), body.size()));
+                recorder_.reset();
+            }
 
-        std::ostream os(buf);
+            timeout_.disarm();
 
-#define OUT(...)                                         \
-    do                                                   \
-    {                                                    \
-        __VA_ARGS__;                                     \
-        if (!os)                                         \
-        {                                                \
-            return Async::Promise<ssize_t>::rejected(    \
-                Error("Response exceeded buffer size")); \
-        }                                                \
-    } while (0);
+            auto fd = peerFd(transport_, handle_, peer_);
 
-        auto setContentType = [&](const Mime::MediaType& contentType) {
-            auto& headers = writer.headers();
-            auto ct       = headers.tryGet<Header::ContentType>();
-            if (ct)
-                ct->setMime(contentType);
-            else
-                headers.add<Header::ContentType>(contentType);
-        };
+            // Both buffers are queued from the same thread, the transport will
+            // send them in order and gather them in a single sendmsg() call
+            if (body.size() == 0)
+            {
+                auto written = transport_->asyncWrite(fd, std::move(head));
+                notifyQueued(connection_, transport_, peer_);
+                logAccess(access_, response_.code(), static_cast<uint64_t>(sent_bytes_));
+                tellWritten(listener_, listenedSince_, trace_, response_.code(), written);
+                return written;
+            }
 
-        OUT(writeStatusLine(writer.response_.version(), Http::Code::Ok, *buf));
-        if (contentType.isValid())
-        {
-            setContentType(contentType);
+            transport_->asyncWrite(fd, std::move(head));
+            auto written = transport_->asyncWrite(fd, std::move(body))
+                               .then<std::function<Async::Promise<ssize_t>(ssize_t)>,
+                                     std::function<void(std::exception_ptr&)>>(
+                                   [=](ssize_t data) {
+                                       return Async::Promise<ssize_t>::resolved(headSize + data);
+                                   },
+
+                                   [=](std::exception_ptr& eptr) {
+                                       return Async::Promise<ssize_t>::rejected(eptr);
+                                   });
+            notifyQueued(connection_, transport_, peer_);
+            logAccess(access_, response_.code(), static_cast<uint64_t>(sent_bytes_));
+            tellWritten(listener_, listenedSince_, trace_, response_.code(), written);
+            return written;
         }
-        else
+        catch (const std::runtime_error& e)
         {
-            auto mime = Mime::MediaType::fromFile(fileName.c_str());
-            if (mime.isValid())
-                setContentType(mime);
+            return Async::Promise<ssize_t>::rejected(e);
         }
-
-        OUT(writeHeaders(writer.headers(), *buf));
-
-        const size_t len = sb.st_size;
-
-        OUT(writeHeader<Header::ContentLength>(os, len));
-
-        OUT(os << crlf);
-
-        auto* transport = writer.transport_;
-        auto peer       = writer.peer();
-        auto sockFd     = peer->fd();
-
-        auto buffer = buf->buffer();
-        return transport->asyncWrite(sockFd, buffer, MSG_MORE)
-            .then(
-                [=](ssize_t) {
-                    return transport->asyncWrite(sockFd, FileBuffer(fileName));
-                },
-                Async::Throw);
-
-#undef OUT
     }
 
-    Private::ParserImpl<Http::Request>::ParserImpl(size_t maxDataSize)
-        : ParserBase(maxDataSize)
-        , request()
-        , time_(std::chrono::steady_clock::now())
+    namespace
+    {
+        // A client has no reason to ask for that many pieces of a file, the
+        // whole file is sent instead
+        constexpr size_t MaxRanges = 16;
+
+        // Opens a file to serve, sent from this descriptor it is not opened
+        // a second time
+        std::shared_ptr<const Fd> openFile(const std::string& fileName, struct stat& sb)
+        {
+            int fd = open(fileName.c_str(), O_RDONLY);
+            if (fd == -1)
+            {
+                std::string str_error(strerror(errno));
+                if (errno == ENOENT)
+                {
+                    throw HttpError(Http::Code::Not_Found, std::move(str_error));
+                }
+                // eles if TODO
+                /* @Improvement: maybe could we check for errno here and emit a different
+       error message
+    */
+                else
+                {
+                    throw HttpError(Http::Code::Internal_Server_Error, std::move(str_error));
+                }
+            }
+
+            auto file = FileBuffer::own(fd);
+            if (::fstat(fd, &sb) == -1)
+            {
+                throw HttpError(Code::Internal_Server_Error, "");
+            }
+
+            return file;
+        }
+
+        struct ByteRange
+        {
+            size_t first;
+            // Inclusive, like in the headers
+            size_t last;
+
+            size_t size() const { return last - first + 1; }
+        };
+
+        // Digits only, saturated instead of overflowing: a position past the
+        // end of any file is still past the end of this one
+        bool parsePosition(std::string_view digits, size_t& position)
+        {
+            if (digits.empty())
+                return false;
+
+            position = 0;
+            for (char c : digits)
+            {
+                if (c < '0' || c > '9')
+                    return false;
+
+                const auto digit = static_cast<size_t>(c - '0');
+                if (position > (std::numeric_limits<size_t>::max() - digit) / 10)
+                    position = std::numeric_limits<size_t>::max();
+                else
+                    position = position * 10 + digit;
+            }
+
+            return true;
+        }
+
+        /* Parses the value of a Range header against the size of the file.
+         * Returns false when the header is to be ignored, leaves ranges empty
+         * when none of them is in the file.
+         */
+        bool parseRanges(std::string_view value, size_t size, std::vector<ByteRange>& ranges)
+        {
+            static constexpr std::string_view Unit = "bytes=";
+
+            value = Private::trim(value);
+            if (value.size() <= Unit.size()
+                || strncasecmp(value.data(), Unit.data(), Unit.size()) != 0)
+                return false;
+            value.remove_prefix(Unit.size());
+
+            bool any = false;
+            while (!value.empty())
+            {
+                auto end  = value.find(',');
+                auto spec = Private::trim(value.substr(0, end));
+                value     = end == std::string_view::npos ? std::string_view() : value.substr(end + 1);
+
+                // Empty elements of a list are allowed
+                if (spec.empty())
+                    continue;
+
+                const auto dash = spec.find('-');
+                if (dash == std::string_view::npos)
+                    return false;
+
+                const auto firstDigits = Private::trim(spec.substr(0, dash));
+                const auto lastDigits  = Private::trim(spec.substr(dash + 1));
+                any                    = true;
+
+                size_t first = 0;
+                size_t last  = 0;
+                if (firstDigits.empty())
+                {
+                    // The last bytes of the file
+                    size_t suffix = 0;
+                    if (!parsePosition(lastDigits, suffix))
+                        return false;
+                    if (suffix == 0 || size == 0)
+                        continue;
+
+                    first = suffix < size ? size - suffix : 0;
+                    last  = size - 1;
+                }
+                else
+                {
+                    if (!parsePosition(firstDigits, first))
+                        return false;
+
+                    last = std::numeric_limits<size_t>::max();
+                    if (!lastDigits.empty() && !parsePosition(lastDigits, last))
+                        return false;
+                    if (last < first)
+                        return false;
+
+                    if (first >= size)
+                        continue;
+                    last = std::min(last, size - 1);
+                }
+
+                ranges.push_back(ByteRange { first, last });
+                if (ranges.size() > MaxRanges)
+                    return false;
+            }
+
+            return any;
+        }
+
+        // If-Range holds either an entity tag, compared strongly, or a date
+        // (RFC 9110 13.1.5)
+        bool ifRangeMatches(const Request& request, const Header::Collection& headers)
+        {
+            auto ifRange = request.headers().tryGetRaw("If-Range");
+            if (!ifRange)
+                return true;
+
+            const auto value = std::string(Private::trim(ifRange->value()));
+            if (value.empty())
+                return false;
+
+            if (value.front() == '"' || value.compare(0, 2, "W/") == 0)
+            {
+                auto etag = headers.tryGet<Header::ETag>();
+                return etag && value.front() == '"' && etag->tag() == value;
+            }
+
+            auto lastModified = headers.tryGet<Header::LastModified>();
+            if (!lastModified)
+                return false;
+
+            try
+            {
+                const auto since = FullDate::fromString(value).date();
+                return std::chrono::floor<std::chrono::seconds>(lastModified->fullDate().date())
+                    == std::chrono::floor<std::chrono::seconds>(since);
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+        }
+
+        std::string makeBoundary()
+        {
+            thread_local std::mt19937_64 generator { std::random_device {}() };
+
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%016llx",
+                          static_cast<unsigned long long>(generator()));
+            return buf;
+        }
+    } // namespace
+
+    Async::Promise<ssize_t> serveFile(ResponseWriter& writer,
+                                      const std::string& fileName,
+                                      const Mime::MediaType& contentType)
+    {
+        struct stat sb;
+        auto file = openFile(fileName, sb);
+
+        auto mime = contentType;
+        if (!mime.isValid())
+            mime = Mime::MediaType::fromFile(fileName.c_str());
+
+        return serveFile(writer, FileBuffer(std::move(file), static_cast<size_t>(sb.st_size)), mime);
+    }
+
+    Async::Promise<ssize_t> serveFile(const Request& request, ResponseWriter& writer,
+                                      const std::string& fileName,
+                                      const Mime::MediaType& contentType)
+    {
+        struct stat sb;
+        auto file = openFile(fileName, sb);
+
+        auto mime = contentType;
+        if (!mime.isValid())
+            mime = Mime::MediaType::fromFile(fileName.c_str());
+
+        // The validator If-Range is compared to
+        auto& headers = writer.headers();
+        if (!headers.has<Header::LastModified>())
+            headers.add<Header::LastModified>(
+                FullDate(std::chrono::system_clock::from_time_t(sb.st_mtim.tv_sec)));
+
+        return serveFile(request, writer,
+                         FileBuffer(std::move(file), static_cast<size_t>(sb.st_size)), mime);
+    }
+
+    Async::Promise<ssize_t> serveFile(const Request& request, ResponseWriter& writer,
+                                      const FileBuffer& file, const Mime::MediaType& contentType)
+    {
+        auto& headers = writer.headers();
+        if (!headers.has<Header::AcceptRanges>())
+            headers.add<Header::AcceptRanges>("bytes");
+
+        auto range = request.headers().tryGetRaw("Range");
+        if (!range || request.method() != Method::Get || !ifRangeMatches(request, headers))
+            return serveFile(writer, file, contentType);
+
+        std::vector<ByteRange> ranges;
+        if (!parseRanges(range->value(), file.size(), ranges))
+            return serveFile(writer, file, contentType);
+
+        if (ranges.empty())
+        {
+            headers.add<Header::ContentRange>(Header::ContentRange::unsatisfied(file.size()));
+            return writer.send(Code::Requested_Range_Not_Satisfiable);
+        }
+
+        auto slice = [&file](const ByteRange& part) {
+            return FileBuffer(file.file(), part.size(), file.offset() + part.first);
+        };
+
+        // multipart/byteranges (RFC 9110 14.6): every part has its own head,
+        // the parts of the file are sent in between
+        std::vector<std::string> heads;
+        std::string closing;
+        size_t contentLength = 0;
+
+        auto mime = contentType;
+        if (ranges.size() == 1)
+        {
+            headers.add<Header::ContentRange>(ranges[0].first, ranges[0].last, file.size());
+            contentLength = ranges[0].size();
+        }
+        else
+        {
+            const auto boundary = makeBoundary();
+            for (const auto& part : ranges)
+            {
+                std::ostringstream head;
+                head << crlf << "--" << boundary << crlf;
+                if (contentType.isValid())
+                    head << Header::ContentType::Name << ": " << contentType.toString() << crlf;
+                head << Header::ContentRange::Name << ": ";
+                Header::ContentRange(part.first, part.last, file.size()).write(head);
+                head << crlf << crlf;
+
+                heads.push_back(head.str());
+                contentLength += heads.back().size() + part.size();
+            }
+
+            closing = "\r\n--" + boundary + "--\r\n";
+            contentLength += closing.size();
+
+            mime = Mime::MediaType(Mime::Type::Multipart, Mime::Subtype::ByteRanges);
+            mime.setParam("boundary", boundary);
+        }
+
+        writer.prepareResponse(Code::Partial_Content, mime);
+        if (writer.http2_)
+        {
+            std::vector<Http2::BodyPart> body;
+            for (size_t i = 0; i < ranges.size(); ++i)
+            {
+                if (!heads.empty())
+                {
+                    const auto headSize = heads[i].size();
+                    body.emplace_back(RawBuffer(std::move(heads[i]), headSize));
+                }
+                body.emplace_back(slice(ranges[i]));
+            }
+            if (!closing.empty())
+            {
+                const auto closingSize = closing.size();
+                body.emplace_back(RawBuffer(std::move(closing), closingSize));
+            }
+
+            return writer.respondHttp2(contentLength, std::move(body));
+        }
+
+        if (!writer.writeHead(contentLength))
+        {
+            return Async::Promise<ssize_t>::rejected(Error("Response exceeded buffer size"));
+        }
+
+        auto* transport = writer.transport_;
+        auto sockFd     = peerFd(transport, writer.handle_, writer.peer_);
+
+        writer.timeout_.disarm();
+
+        auto head = writer.buf_.detach();
+        writer.sent_bytes_ += head.size() + contentLength;
+
+        // All queued from this thread, the transport sends them back to back
+        transport->asyncWrite(sockFd, std::move(head), MSG_MORE);
+        if (heads.empty())
+        {
+            auto written = transport->asyncWrite(sockFd, slice(ranges[0]));
+            notifyQueued(writer.connection_, transport, writer.peer_);
+            logAccess(writer.access_, Code::Partial_Content, static_cast<uint64_t>(writer.sent_bytes_));
+            tellWritten(writer.listener_, writer.listenedSince_, writer.trace_, Code::Partial_Content, written);
+            return written;
+        }
+
+        for (size_t i = 0; i < ranges.size(); ++i)
+        {
+            const auto headSize = heads[i].size();
+            transport->asyncWrite(sockFd, RawBuffer(std::move(heads[i]), headSize), MSG_MORE);
+            transport->asyncWrite(sockFd, slice(ranges[i]));
+        }
+        const auto closingSize = closing.size();
+        auto written           = transport->asyncWrite(sockFd, RawBuffer(std::move(closing), closingSize))
+                           .then([contentLength](ssize_t) { return static_cast<ssize_t>(contentLength); },
+                                 [](std::exception_ptr& eptr) {
+                                     return Async::Promise<ssize_t>::rejected(eptr);
+                                 });
+        notifyQueued(writer.connection_, transport, writer.peer_);
+        logAccess(writer.access_, Code::Partial_Content, static_cast<uint64_t>(writer.sent_bytes_));
+        tellWritten(writer.listener_, writer.listenedSince_, writer.trace_, Code::Partial_Content, written);
+        return written;
+    }
+
+    Async::Promise<ssize_t> serveFile(ResponseWriter& writer, const FileBuffer& file,
+                                      const Mime::MediaType& contentType)
+    {
+        auto* buf = writer.rdbuf();
+
+        if (contentType.isValid())
+        {
+            auto& headers = writer.headers();
+            auto ct       = headers.tryGet<Header::ContentType>();
+            if (ct)
+                ct->setMime(contentType);
+            else
+                headers.add<Header::ContentType>(contentType);
+        }
+
+        if (writer.http2_)
+        {
+            writer.prepareResponse(Http::Code::Ok, contentType);
+            return writer.respondHttp2(file.size(), { file });
+        }
+
+        if (!writeStatusLine(writer.response_.version(), Http::Code::Ok, *buf)
+            || !writeHeaders(writer.headers(), *buf) || !writeContentLength(file.size(), *buf)
+            || !put(*buf, "\r\n"sv))
+        {
+            return Async::Promise<ssize_t>::rejected(Error("Response exceeded buffer size"));
+        }
+
+        auto* transport = writer.transport_;
+        auto sockFd     = peerFd(transport, writer.handle_, writer.peer_);
+
+        writer.timeout_.disarm();
+
+        auto head = buf->detach();
+        writer.sent_bytes_ += head.size() + file.size();
+
+        // Both are queued from this thread, the transport sends the file right
+        // after the head
+        transport->asyncWrite(sockFd, std::move(head), MSG_MORE);
+        auto written = transport->asyncWrite(sockFd, file);
+        notifyQueued(writer.connection_, transport, writer.peer_);
+        logAccess(writer.access_, Code::Ok, static_cast<uint64_t>(writer.sent_bytes_));
+        tellWritten(writer.listener_, writer.listenedSince_, writer.trace_, Code::Ok, written);
+        return written;
+    }
+
+    Private::ParserImpl<Http::Request>::ParserImpl(size_t maxDataSize)
+        : ParserBase(maxDataSize)
+        , request()
+        , time_(CachedClock::now())
     {
         allSteps[0] = std::make_unique<RequestLineStep>(&request);
         allSteps[1] = std::make_unique<HeadersStep>(&request);
-        allSteps[2] = std::make_unique<BodyStep>(&request);
+        allSteps[2] = std::make_unique<BodyStep>(&request, maxDataSize);
+    }
+
+    void Private::ParserImpl<Http::Request>::setLazyHeaders(bool lazy)
+    {
+        static_cast<HeadersStep*>(allSteps[1].get())->setLazyHeaders(lazy);
     }
 
     void Private::ParserImpl<Http::Request>::reset()
     {
         ParserBase::reset();
+        resetRequest();
+    }
 
-        request = Request();
-        time_   = std::chrono::steady_clock::now();
+    void Private::ParserImpl<Http::Request>::resetKeepingPending()
+    {
+        ParserBase::resetKeepingPending();
+        resetRequest();
+    }
+
+    void Private::ParserImpl<Http::Request>::restartClock() { time_ = CachedClock::now(); }
+
+    void Private::ParserImpl<Http::Request>::resetRequest()
+    {
+        if (reuseStorage_)
+            request.clear();
+        else
+            request = Request();
+        time_ = CachedClock::now();
     }
 
     Private::ParserImpl<Http::Response>::ParserImpl(size_t maxDataSize)
@@ -1072,28 +2446,470 @@ namespace Pistache::Http
     {
         allSteps[0] = std::make_unique<ResponseLineStep>(&response);
         allSteps[1] = std::make_unique<HeadersStep>(&response);
-        allSteps[2] = std::make_unique<BodyStep>(&response);
+        allSteps[2] = std::make_unique<BodyStep>(&response, maxDataSize);
+    }
+
+    std::shared_ptr<BodyFile> BodyFile::create(const std::string& directory)
+    {
+        std::string path = directory + "/pistache-body-XXXXXX";
+        const Fd fd      = ::mkostemp(path.data(), O_CLOEXEC);
+        if (fd == -1)
+            throw HttpError(Code::Internal_Server_Error, "Could not create the body file");
+
+        return std::shared_ptr<BodyFile>(new BodyFile(FileBuffer::own(fd), std::move(path)));
+    }
+
+    BodyFile::BodyFile(std::shared_ptr<const Fd> file, std::string path)
+        : file_(std::move(file))
+        , path_(std::move(path))
+    { }
+
+    BodyFile::~BodyFile()
+    {
+        if (!kept_)
+            ::unlink(path_.c_str());
+    }
+
+    void BodyFile::keep(const std::string& destination)
+    {
+        if (::rename(path_.c_str(), destination.c_str()) == -1)
+            throw std::runtime_error("Could not move the body file: " + std::string(strerror(errno)));
+
+        path_ = destination;
+        kept_ = true;
+    }
+
+    namespace Private
+    {
+        // Writes the body to its file from user space, for the connections
+        // whose bytes can not be spliced and for chunked bodies
+        class SpoolWriter : public BodyReader
+        {
+        public:
+            explicit SpoolWriter(std::shared_ptr<BodyFile> file)
+                : file_(std::move(file))
+            { }
+
+            void onData(std::string_view data) override
+            {
+                while (!data.empty())
+                {
+                    auto written = ::write(file_->fd(), data.data(), data.size());
+                    if (written == -1 && errno == EINTR)
+                        continue;
+                    if (written <= 0)
+                        throw std::runtime_error("Could not write the body file");
+
+                    file_->size_ += static_cast<size_t>(written);
+                    data.remove_prefix(static_cast<size_t>(written));
+                }
+            }
+
+        private:
+            std::shared_ptr<BodyFile> file_;
+        };
+    } // namespace Private
+
+    void BodyReader::onEnd() { }
+
+    void BodyReader::onError(const std::string& /*reason*/) { }
+
+    BodyFlow::BodyFlow(Tcp::Transport* transport, std::weak_ptr<Tcp::Peer> peer)
+        : transport_(transport)
+        , post_(transport->poster())
+        , peer_(std::move(peer))
+    { }
+
+    void BodyFlow::pause() const
+    {
+        if (!transport_)
+            return;
+
+        // Right away from a reader, so that the transport stops reading
+        // before the next receive buffer
+        if (transport_->isInTransportThread())
+        {
+            if (auto peer = peer_.lock())
+                transport_->pauseReading(peer);
+            return;
+        }
+
+        post_([transport = transport_, weak = peer_] {
+            if (auto peer = weak.lock())
+                transport->pauseReading(peer);
+        });
+    }
+
+    void BodyFlow::resume() const
+    {
+        if (!transport_)
+            return;
+
+        // Always posted, a reader resuming from onData() does not read the
+        // connection again from within its own input
+        post_([transport = transport_, weak = peer_] {
+            if (auto peer = weak.lock())
+                transport->resumeReading(peer);
+        });
+    }
+
+    namespace Private
+    {
+        BodyDecoder::BodyDecoder(std::shared_ptr<BodyReader> reader, const Message& message)
+            : reader_(std::move(reader))
+            , step_(Step::ChunkSize)
+        {
+            if (auto cl = message.headers().tryGet<Header::ContentLength>())
+            {
+                remaining_ = cl->value();
+                step_      = remaining_ > 0 ? Step::Data : Step::Done;
+            }
+        }
+
+        bool BodyDecoder::readLine(const char* data, size_t size, size_t& used)
+        {
+            const char* begin = data + used;
+            const char* eol   = static_cast<const char*>(std::memchr(begin, '\n', size - used));
+            const char* end   = eol ? eol : data + size;
+
+            line_.append(begin, end);
+            used = eol ? eol - data + 1 : size;
+
+            if (line_.size() > MaxLineSize)
+                throw HttpError(Code::Bad_Request, "Chunk line too long");
+            if (!eol)
+                return false;
+
+            if (!line_.empty() && line_.back() == '\r')
+                line_.pop_back();
+            return true;
+        }
+
+        size_t BodyDecoder::feed(const char* data, size_t size)
+        {
+            size_t used = 0;
+            while (used < size && step_ != Step::Done)
+            {
+                switch (step_)
+                {
+                case Step::Data:
+                case Step::ChunkData:
+                {
+                    const size_t bytes = std::min(remaining_, size - used);
+                    reader_->onData(std::string_view(data + used, bytes));
+                    used += bytes;
+                    remaining_ -= bytes;
+                    if (remaining_ == 0)
+                        step_ = step_ == Step::Data ? Step::Done : Step::ChunkEnd;
+                    break;
+                }
+                case Step::ChunkSize:
+                {
+                    if (!readLine(data, size, used))
+                        break;
+
+                    const auto chunkSize = parseChunkSize(line_, std::numeric_limits<size_t>::max());
+                    line_.clear();
+
+                    remaining_ = chunkSize;
+                    step_      = chunkSize > 0 ? Step::ChunkData : Step::Trailers;
+                    break;
+                }
+                case Step::ChunkEnd:
+                    if (!readLine(data, size, used))
+                        break;
+                    if (!line_.empty())
+                        throw HttpError(Code::Bad_Request, "Missing CRLF after chunk");
+                    step_ = Step::ChunkSize;
+                    break;
+                case Step::Trailers:
+                    if (!readLine(data, size, used))
+                        break;
+                    // The trailers end with an empty line, they are dropped
+                    if (line_.empty())
+                        step_ = Step::Done;
+                    line_.clear();
+                    break;
+                case Step::Done:
+                    break;
+                }
+            }
+            return used;
+        }
+    } // namespace Private
+
+    void Handler::setBodySpool(size_t threshold, std::string directory)
+    {
+        spoolThreshold_ = threshold;
+        spoolDirectory_ = std::move(directory);
+    }
+
+    size_t Handler::getBodySpoolThreshold() const { return spoolThreshold_; }
+
+    const std::string& Handler::getBodySpoolDirectory() const { return spoolDirectory_; }
+
+    void Handler::setAccessLog(std::shared_ptr<AccessLog> log) { accessLog_ = std::move(log); }
+
+    const std::shared_ptr<AccessLog>& Handler::getAccessLog() const { return accessLog_; }
+
+    void Handler::setRateLimiter(std::shared_ptr<RateLimiter> limiter)
+    {
+        rateLimiter_ = std::move(limiter);
+    }
+
+    const std::shared_ptr<RateLimiter>& Handler::getRateLimiter() const { return rateLimiter_; }
+
+    void Handler::setTracer(std::shared_ptr<Tracing::Tracer> tracer)
+    {
+#ifndef PISTACHE_USE_TRACING
+        if (tracer)
+            throw std::runtime_error("Pistache has been compiled without tracing support.");
+#endif
+        tracer_ = std::move(tracer);
+    }
+
+    const std::shared_ptr<Tracing::Tracer>& Handler::getTracer() const { return tracer_; }
+
+    void Handler::dispatchRequest(Request&& request, ResponseWriter response)
+    {
+        onRequest(request, std::move(response));
+    }
+
+    std::shared_ptr<BodyReader> Handler::onBodyStart(const Request& /*request*/, BodyFlow /*flow*/)
+    {
+        return nullptr;
+    }
+
+    bool Handler::onExpectContinue(const Request& /*request*/, ResponseWriter& /*response*/)
+    {
+        return true;
     }
 
     void Handler::onInput(const char* buffer, size_t len,
                           const std::shared_ptr<Tcp::Peer>& peer)
     {
-        auto parser   = getParser(peer);
+        auto* connState = connectionState(*peer);
+        if (connState->http2)
+        {
+            connState->http2->feed(buffer, len);
+            return;
+        }
+        if (connState->websocket)
+        {
+            // The keep-alive timeout applies to the silence between frames
+            connState->since = CachedClock::now();
+            connState->websocket->feed(buffer, len);
+            return;
+        }
+        if (connState->closing)
+            return;
+        if (connState->body)
+        {
+            connState->since = CachedClock::now();
+
+            size_t used = 0;
+            try
+            {
+                if (!feedBody(*connState, buffer, len, used))
+                    return;
+            }
+            catch (const HttpError& err)
+            {
+                ResponseWriter response(connState->parser->request.version(), transport(), this, peer);
+                response.send(static_cast<Code>(err.code()), err.reason());
+                finishRequest(*connState);
+                return;
+            }
+            catch (const std::exception& e)
+            {
+                ResponseWriter response(connState->parser->request.version(), transport(), this, peer);
+                response.send(Code::Internal_Server_Error, e.what());
+                finishRequest(*connState);
+                return;
+            }
+
+            // The request is complete, the parser dispatches it along with
+            // the requests pipelined behind it
+            buffer += used;
+            len -= used;
+        }
+
+        std::string prelude;
+        if (!connState->started && http2_)
+        {
+            // A method such as POST starts like the preface as well, the
+            // first three bytes tell them apart
+            connState->prelude.append(buffer, len);
+            if (Http2::startsWithPreface(connState->prelude.data(), connState->prelude.size()))
+            {
+                if (connState->prelude.size() < 3)
+                    return;
+
+                startHttp2(peer, *connState);
+                prelude = std::move(connState->prelude);
+                connState->http2->feed(prelude.data(), prelude.size());
+                return;
+            }
+
+            prelude = std::move(connState->prelude);
+            buffer  = prelude.data();
+            len     = prelude.size();
+        }
+        connState->started = true;
+
+        if (!connState->parser)
+            connState->parser = parsers_.acquire(maxRequestSize_, reuseRequestStorage_,
+                                                 lazyHeaders_, inPlaceChunks_);
+
+        auto parser = connState->parser;
+        if (!parser->feed(buffer, len))
+        {
+            parser->reset();
+
+            ResponseWriter response(parser->request.version(), transport(), this, peer);
+            response.send(Code::Request_Entity_Too_Large, "Request exceeded maximum buffer size");
+            finishRequest(*connState);
+            return;
+        }
+
+        if (connState->budget)
+        {
+            if (!connState->budget->charge(len))
+            {
+                refuseOverBudget(peer, *connState);
+                return;
+            }
+            connState->budgeted += len;
+        }
+
+        // The response to the previous request has not been queued yet, the
+        // bytes wait in the parser until it is
+        int expected = Private::ConnectionState::Pending;
+        if (connState->pipeline.compare_exchange_strong(expected, Private::ConnectionState::Stalled)
+            || expected == Private::ConnectionState::Stalled)
+            return;
+
+        handleRequests(peer, *connState);
+    }
+
+    std::shared_ptr<Tracing::PendingTrace>
+    Handler::beginTrace(const Request& request, const Private::ParserBase& parser, Tcp::Peer& peer)
+    {
+        auto pending    = std::make_shared<Tracing::PendingTrace>();
+        pending->tracer = tracer_;
+
+        auto& trace = pending->trace;
+        // The accept counts for the first request of the connection only
+        trace[Tracing::Phase::Accept]        = std::exchange(peer.acceptedAt_, 0);
+        trace[Tracing::Phase::FirstByte]     = peer.firstByteAt_;
+        trace[Tracing::Phase::HeadersParsed] = parser.stepDoneAt(1);
+        trace[Tracing::Phase::BodyComplete]  = parser.stepDoneAt(2);
+
+        trace.method   = request.method();
+        trace.version  = request.version();
+        trace.resource = request.resource();
+        if (auto traceparent = request.headers().tryGetRaw("traceparent"))
+            trace.setParent(traceparent->value());
+        trace.generateIds();
+
+        return pending;
+    }
+
+    void Handler::handleRequests(const std::shared_ptr<Tcp::Peer>& peer,
+                                 Private::ConnectionState& state)
+    {
+        // The request is dispatched once its streamed body has been received
+        if (state.body || state.splicing)
+            return;
+
+        auto parser   = state.parser;
         auto& request = parser->request;
         try
         {
-            if (!parser->feed(buffer, len))
+            // Every complete request of the buffer is dispatched in turn, their
+            // responses are queued in order and leave in as few writes as the
+            // transport can gather them
+            while (parser->parse() == Private::State::Done)
             {
-                parser->reset();
-                throw HttpError(Code::Request_Entity_Too_Large,
-                                "Request exceeded maximum buffer size");
-            }
+                if (shedRequest(peer, state))
+                    return;
+
+                if (parser->bodyPending())
+                {
+                    request.copyAddress(peer->address());
+
+                    const bool expects = expectsContinue(request);
+                    if (expects)
+                    {
+                        ResponseWriter response(request.version(), transport(), this, peer);
+                        response.headers().add<Header::Connection>(ConnectionControl::Close);
+                        if (!onExpectContinue(request, response))
+                        {
+                            rejectBody(state);
+                            return;
+                        }
+                    }
+
+                    auto reader = onBodyStart(request, BodyFlow(transport(), peer));
+
+                    // Bound to fail once received, the body is not waited for
+                    auto cl            = request.headers().tryGet<Header::ContentLength>();
+                    const bool spooled = spoolThreshold_ != 0 && (!cl || cl->value() >= spoolThreshold_);
+                    if (!reader && !spooled && cl && cl->value() > maxRequestSize_)
+                    {
+                        ResponseWriter response(request.version(), transport(), this, peer);
+                        response.headers().add<Header::Connection>(ConnectionControl::Close);
+                        response.send(Code::Request_Entity_Too_Large, "Request exceeded maximum buffer size");
+                        rejectBody(state);
+                        return;
+                    }
+
+                    // A client that did not wait for it is sending the body already
+                    if (expects && !parser->hasPending())
+                        transport()->asyncWrite(peer->fd(), RawBuffer(ContinueLine, sizeof(ContinueLine) - 1));
+
+                    if (!reader && !spoolBody(peer, state, reader))
+                        return;
+                    if (!reader)
+                    {
+                        parser->bufferBody();
+                        continue;
+                    }
+
+                    parser->streamBody();
+                    peer->setIdle(false);
+                    state.body = std::make_unique<Private::BodyDecoder>(std::move(reader), request);
+
+                    // What arrived along with the headers
+                    const auto received = parser->pending();
+                    size_t used         = 0;
+                    const bool complete = feedBody(state, received.data(), received.size(), used);
+                    parser->consume(used);
+                    if (!complete)
+                        return;
+                }
 
-            auto state = parser->parse();
+                if (state.spool)
+                    request.bodyFile_ = std::move(state.spool);
 
-            if (state == Private::State::Done)
-            {
                 ResponseWriter response(request.version(), transport(), this, peer);
+                response.connection_ = state.weak_from_this();
+                request.received_ = parser->time();
+                if (accessLog_)
+                    response.access_ = accessLog_->begin(request, parser->time());
+#ifdef PISTACHE_USE_TRACING
+                if (tracer_)
+                    response.trace_ = beginTrace(request, *parser, *peer);
+                // The bytes of a pipelined request came along with this one
+                if (!parser->hasPending())
+                    peer->firstByteAt_ = 0;
+#endif
+
+                if (compression_.enabled)
+                {
+                    if (auto accept = request.headers().tryGetRaw("Accept-Encoding"))
+                        response.setCompression(Compression::negotiate(accept->value()));
+                }
 
 #ifdef LIBSTDCPP_SMARTPTR_LOCK_FIXME
                 request.associatePeer(peer);
@@ -1105,36 +2921,303 @@ namespace Pistache::Http
 
                 if (connection)
                 {
-                    response.headers().add<Header::Connection>(connection->control());
+                    // Answered with Upgrade by the handler that switches
+                    // protocols only
+                    auto control = connection->control();
+                    if (control == ConnectionControl::Upgrade)
+                        control = ConnectionControl::KeepAlive;
+                    response.headers().add<Header::Connection>(control);
                 }
                 else
                 {
                     response.headers().add<Header::Connection>(ConnectionControl::Close);
                 }
 
+                const bool pipelined = parser->hasPending();
+
                 peer->setIdle(false); // change peer state to not idle
-                onRequest(request, std::move(response));
-                parser->reset();
+                state.admitted = false;
+                // The request is the handler's now
+                if (state.budget)
+                    state.budget->release(std::exchange(state.budgeted, 0));
+                if (state.inFlight)
+                    state.inFlight->fetch_add(1, std::memory_order_relaxed);
+                state.pipeline.store(Private::ConnectionState::Pending);
+#ifdef PISTACHE_USE_TRACING
+                if (response.trace_)
+                    PISTACHE_TRACE_MARK(response.trace_->trace[Tracing::Phase::Dispatch]);
+#endif
+                dispatchRequest(std::move(request), std::move(response));
+
+                // The handler switched to WebSocket, what the client sent
+                // behind the request already is made of frames
+                if (auto websocket = state.websocket)
+                {
+                    const std::string frames(pipelined ? parser->pending() : std::string_view());
+                    finishRequest(state);
+                    state.settle();
+                    if (!frames.empty())
+                        websocket->feed(frames.data(), frames.size());
+                    return;
+                }
+
+                if (!pipelined)
+                {
+                    finishRequest(state);
+                    return;
+                }
+
+                parser->resetKeepingPending();
+
+                // Answered later, the requests behind it wait for the response
+                int expected = Private::ConnectionState::Pending;
+                if (state.pipeline.compare_exchange_strong(expected,
+                                                                Private::ConnectionState::Stalled))
+                    return;
             }
         }
         catch (const HttpError& err)
         {
+            state.settle();
+
             ResponseWriter response(request.version(), transport(), this, peer);
             response.send(static_cast<Code>(err.code()), err.reason());
-            parser->reset();
+            finishRequest(state);
         }
 
         catch (const std::exception& e)
         {
+            state.settle();
+
             ResponseWriter response(request.version(), transport(), this, peer);
             response.send(Code::Internal_Server_Error, e.what());
-            parser->reset();
+            finishRequest(state);
+        }
+    }
+
+    void Handler::resumeRequests(const std::shared_ptr<Tcp::Peer>& peer)
+    {
+        auto* connState = connectionState(*peer);
+        if (!connState || !connState->parser)
+            return;
+
+        if (connState->pipeline.load() != Private::ConnectionState::Idle)
+            return;
+
+        handleRequests(peer, *connState);
+    }
+
+    bool Handler::spoolBody(const std::shared_ptr<Tcp::Peer>& peer, Private::ConnectionState& state,
+                            std::shared_ptr<BodyReader>& reader)
+    {
+        auto parser   = state.parser;
+        auto& request = parser->request;
+
+        auto cl = request.headers().tryGet<Header::ContentLength>();
+        if (spoolThreshold_ == 0 || (cl && cl->value() < spoolThreshold_))
+            return true;
+
+        state.spool = BodyFile::create(spoolDirectory_);
+
+        // The bytes of a TLS connection have to be decrypted, and chunks
+        // stripped of their framing, by the reader
+        const auto received = parser->pending();
+        if (!cl || received.size() >= cl->value() || peer->ssl() != nullptr)
+        {
+            reader = std::make_shared<Private::SpoolWriter>(state.spool);
+            return true;
+        }
+
+        // What came along with the headers is written first, the splice only
+        // starts from the next iteration of the loop
+        Private::SpoolWriter(state.spool).onData(received);
+        parser->consume(received.size());
+
+        const size_t length = cl->value();
+        auto progress = [this, weak = std::weak_ptr<Tcp::Peer>(peer),
+                         connState = state.shared_from_this()](ssize_t remaining) {
+            auto peer = weak.lock();
+            if (!peer)
+                return;
+
+            connState->since = CachedClock::now();
+            if (remaining > 0)
+                return;
+
+            connState->splicing = false;
+            if (remaining == 0)
+            {
+                handleRequests(peer, *connState);
+                return;
+            }
+
+            // The rest of the body is still on its way, the connection can not
+            // be used anymore
+            connState->spool.reset();
+            ResponseWriter response(connState->parser->request.version(), transport(), this, peer);
+            auto sent = response.send(Code::Internal_Server_Error, "Could not write the body file");
+            finishRequest(*connState);
+            sent.then([weak](ssize_t) {
+                if (auto peer = weak.lock())
+                    ::shutdown(peer->fd(), SHUT_RDWR);
+            },
+                      Async::IgnoreException);
+        };
+        if (!transport()->spliceToFile(peer, state.spool->file_,
+                                       length - state.spool->size_, std::move(progress)))
+            throw HttpError(Code::Internal_Server_Error, "Could not splice the body");
+
+        state.spool->size_ = length;
+        parser->streamBody();
+        peer->setIdle(false);
+        state.splicing = true;
+        return false;
+    }
+
+    bool Handler::feedBody(Private::ConnectionState& state, const char* data, size_t size,
+                           size_t& used)
+    {
+        auto reader = state.body->reader();
+        try
+        {
+            used = state.body->feed(data, size);
+        }
+        catch (const std::exception& e)
+        {
+            state.body.reset();
+            reader->onError(e.what());
+            throw;
+        }
+
+        if (!state.body->done())
+            return false;
+
+        state.body.reset();
+        reader->onEnd();
+        return true;
+    }
+
+    void Handler::finishRequest(Private::ConnectionState& state)
+    {
+        state.admitted = false;
+        if (state.budget)
+            state.budget->release(std::exchange(state.budgeted, 0));
+        if (!state.parser)
+            return;
+
+        state.spool.reset();
+        state.parser->reset();
+        parsers_.release(std::move(state.parser));
+        state.parser = nullptr;
+        state.since  = CachedClock::now();
+    }
+
+    bool Handler::shedRequest(const std::shared_ptr<Tcp::Peer>& peer,
+                              Private::ConnectionState& state)
+    {
+        if ((!shedder_.enabled() && !rateLimiter_ && !state.budget) || state.admitted)
+            return false;
+
+        state.admitted = true;
+        auto& request  = state.parser->request;
+        if (rateLimiter_)
+        {
+            request.copyAddress(peer->address());
+            if (!rateLimiter_->admit(request))
+            {
+                ResponseWriter response(request.version(), transport(), this, peer);
+                rateLimiter_->refuse(request, response, true);
+                rejectBody(state);
+                return true;
+            }
+        }
+
+        // The body announced would not fit in the bytes left to the bodies,
+        // the bytes of the request received so far already count
+        if (state.budget)
+        {
+            auto cl = request.headers().tryGet<Header::ContentLength>();
+            if (cl && cl->value() > state.budgeted
+                && !state.budget->fits(cl->value() - state.budgeted))
+            {
+                refuseOverBudget(peer, state);
+                return true;
+            }
         }
+
+        if (!shedder_.enabled()
+            || !shedder_.shed(state.parser->time(), std::chrono::steady_clock::now()))
+            return false;
+
+        // Refused before its body, the request costs no more than its headers
+        ResponseWriter response(request.version(), transport(), this, peer);
+        response.headers().add<Header::Connection>(ConnectionControl::Close);
+        response.headers().addRaw(Header::Raw("Retry-After", "1"));
+        response.send(Code::Service_Unavailable, "Server overloaded");
+        rejectBody(state);
+        return true;
+    }
+
+    void Handler::refuseOverBudget(const std::shared_ptr<Tcp::Peer>& peer,
+                                   Private::ConnectionState& state)
+    {
+        ResponseWriter response(state.parser->request.version(), transport(), this, peer);
+        response.headers().add<Header::Connection>(ConnectionControl::Close);
+        response.headers().addRaw(Header::Raw("Retry-After", "1"));
+        response.send(Code::Service_Unavailable, "Server out of memory for request bodies");
+        rejectBody(state);
+    }
+
+    void Handler::rejectBody(Private::ConnectionState& state)
+    {
+        state.closing = true;
+        finishRequest(state);
     }
 
     void Handler::onConnection(const std::shared_ptr<Tcp::Peer>& peer)
     {
-        peer->putData(ParserData, std::make_shared<RequestParser>(maxRequestSize_));
+        // The parser is only attached once the first bytes arrive
+        auto state      = std::make_shared<Private::ConnectionState>();
+        state->handler  = this;
+        state->inFlight = shedder_.inFlight();
+        state->budget   = budget_.counts();
+        peer->putSlot<ConnectionSlot>(state);
+        peer->setWatermarks(streamHighWatermark_, streamLowWatermark_);
+
+        if (http2_ && peer->alpnProtocol() == "h2")
+            startHttp2(peer, *state);
+    }
+
+    void Handler::onDisconnection(const std::shared_ptr<Tcp::Peer>& peer)
+    {
+        auto* state = connectionState(*peer);
+        if (!state)
+            return;
+
+        state->closed.cancel();
+
+        state->spool.reset();
+        state->splicing = false;
+        if (state->body)
+        {
+            auto reader = state->body->reader();
+            state->body.reset();
+            reader->onError("Connection closed");
+        }
+
+        if (!state->websocket)
+            return;
+
+        // The handler of the WebSocket may hold it, the cycle is broken here
+        auto websocket = std::move(state->websocket);
+        websocket->disconnected();
+    }
+
+    void Handler::startHttp2(const std::shared_ptr<Tcp::Peer>& peer, Private::ConnectionState& state)
+    {
+        state.started = true;
+        state.http2   = std::make_shared<Http2::Session>(this, transport(), peer, state.shared_from_this());
+        state.http2->start();
     }
 
     void Handler::onTimeout(const Request& /*request*/,
@@ -1143,17 +3226,73 @@ namespace Pistache::Http
         response.send(Code::Request_Timeout);
     }
 
+    namespace Private
+    {
+        // The cancellation of a request, cancelled along with its connection
+        struct RequestCancellation
+        {
+            ~RequestCancellation() { connection.forget(registration); }
+
+            Async::CancellationSource source;
+            Async::CancellationToken connection;
+            Async::CancellationToken::Registration registration = 0;
+        };
+    } // namespace Private
+
     Timeout::~Timeout() { disarm(); }
 
+    void Timeout::armMs(std::chrono::milliseconds duration)
+    {
+        disarm();
+
+        // The token may be asked for once the timer is armed
+        cancellation();
+
+        timerId = transport->scheduleTimer(
+            duration, [handler = handler, transport = transport, version = version, peer = peer,
+                       http2 = http2, stream = http2Stream, cancellation = cancellation_]() {
+                onTimeout(handler, transport, version, peer, http2, stream, cancellation);
+            });
+        armed = true;
+    }
+
+    Async::CancellationToken Timeout::cancellation()
+    {
+        if (cancellation_)
+            return cancellation_->source.token();
+
+        cancellation_ = std::make_shared<Private::RequestCancellation>();
+
+        auto sp     = peer.lock();
+        auto* state = sp ? Handler::connectionState(*sp) : nullptr;
+        if (!state)
+        {
+            cancellation_->source.cancel();
+            return cancellation_->source.token();
+        }
+
+        cancellation_->connection   = state->closed.token();
+        cancellation_->registration = cancellation_->connection.onCancel(
+            [weak = std::weak_ptr<Private::RequestCancellation>(cancellation_)]() {
+                if (auto request = weak.lock())
+                    request->source.cancel();
+            });
+        return cancellation_->source.token();
+    }
+
     void Timeout::disarm()
     {
         if (transport && armed)
         {
-            transport->disarmTimer(timerFd);
+            transport->cancelTimer(timerId);
+            armed = false;
         }
     }
 
-    bool Timeout::isArmed() const { return armed; }
+    bool Timeout::isArmed() const
+    {
+        return armed && transport->isTimerScheduled(timerId);
+    }
 
     Timeout::Timeout(Tcp::Transport* transport_, Http::Version version, Handler* handler_,
                      std::weak_ptr<Tcp::Peer> peer_)
@@ -1161,20 +3300,41 @@ namespace Pistache::Http
         , version(version)
         , transport(transport_)
         , armed(false)
-        , timerFd(-1)
+        , timerId(TimerWheel::InvalidTimer)
         , peer(peer_)
     { }
 
-    void Timeout::onTimeout(uint64_t /*numWakeup*/)
+    void Timeout::onTimeout(Handler* handler, Tcp::Transport* transport,
+                            Http::Version version, const std::weak_ptr<Tcp::Peer>& peer,
+                            const std::weak_ptr<Http2::Session>& http2, uint32_t http2Stream,
+                            const std::shared_ptr<Private::RequestCancellation>& cancellation)
     {
+        if (cancellation)
+            cancellation->source.cancel();
+
         auto sp = peer.lock();
         if (!sp)
             return;
 
-        ResponseWriter response(version, transport, handler, peer);
-        auto parser         = Handler::getParser(sp);
-        const auto& request = parser->request;
-        handler->onTimeout(request, std::move(response));
+        ResponseWriter response(version, transport, handler, sp);
+        if (auto session = http2.lock())
+        {
+            // The request already has been handed to the handler
+            response.attachHttp2(std::move(session), http2Stream);
+            handler->onTimeout(Request(), std::move(response));
+            return;
+        }
+
+        // Queued in place of the response to the request, the requests
+        // behind it on the connection are dispatched once it is
+        if (auto* state = Handler::connectionState(*sp))
+            response.connection_ = state->weak_from_this();
+
+        auto parser = Handler::getParser(sp);
+        if (parser)
+            handler->onTimeout(parser->request, std::move(response));
+        else
+            handler->onTimeout(Request(), std::move(response));
     }
 
     void Handler::setMaxRequestSize(size_t value) { maxRequestSize_ = value; }
@@ -1185,10 +3345,315 @@ namespace Pistache::Http
 
     size_t Handler::getMaxResponseSize() const { return maxResponseSize_; }
 
+    void Handler::setRequestStorageReuse(bool value) { reuseRequestStorage_ = value; }
+
+    bool Handler::getRequestStorageReuse() const { return reuseRequestStorage_; }
+
+    void Handler::setLazyHeaders(bool value) { lazyHeaders_ = value; }
+
+    bool Handler::getLazyHeaders() const { return lazyHeaders_; }
+
+    void Handler::setInPlaceChunks(bool value) { inPlaceChunks_ = value; }
+
+    bool Handler::getInPlaceChunks() const { return inPlaceChunks_; }
+
+    void Handler::setCompression(const Compression::Settings& settings) { compression_ = settings; }
+
+    void Handler::setMaxInFlight(size_t value) { shedder_.setMaxInFlight(value); }
+
+    size_t Handler::getMaxInFlight() const { return shedder_.maxInFlight(); }
+
+    void Handler::setBodyBudget(size_t global, size_t perWorker)
+    {
+        budget_.setLimits(global, perWorker);
+    }
+
+    size_t Handler::getBodyBudget() const { return budget_.globalLimit(); }
+
+    size_t Handler::getWorkerBodyBudget() const { return budget_.workerLimit(); }
+
+    void Handler::setLoadShedding(std::chrono::milliseconds target,
+                                  std::chrono::milliseconds interval)
+    {
+        shedder_.setQueueDelay(target, interval);
+    }
+
+    std::chrono::milliseconds Handler::getLoadSheddingTarget() const
+    {
+        return shedder_.queueDelayTarget();
+    }
+
+    void Handler::setHttp2(bool value) { http2_ = value; }
+
+    bool Handler::getHttp2() const { return http2_; }
+
+    void Handler::setStreamWatermarks(size_t high, size_t low)
+    {
+        if (low > high)
+            throw std::invalid_argument("The low watermark is above the high one");
+
+        streamHighWatermark_ = high;
+        streamLowWatermark_  = low;
+    }
+
+    size_t Handler::getStreamHighWatermark() const { return streamHighWatermark_; }
+
+    size_t Handler::getStreamLowWatermark() const { return streamLowWatermark_; }
+
+    const Compression::Settings& Handler::getCompression() const { return compression_; }
+
+    Handler::ParserStats Handler::parserStats() const
+    {
+        ParserStats stats;
+        stats.activeParsers          = parsers_.active();
+        stats.pooledParsers          = parsers_.pooled();
+        stats.bytesPerIdleConnection = sizeof(Private::ConnectionState)
+            + sizeof(Async::Private::CancellationState);
+        return stats;
+    }
+
+    std::shared_ptr<Private::ConnectionState>
+    Handler::getConnectionState(const std::shared_ptr<Tcp::Peer>& peer)
+    {
+        auto state = peer->sharedSlot<ConnectionSlot>();
+        if (!state)
+            throw std::runtime_error("The connection has no state");
+        return state;
+    }
+
+    Private::ConnectionState* Handler::connectionState(const Tcp::Peer& peer)
+    {
+        return peer.slot<ConnectionSlot>();
+    }
+
     std::shared_ptr<RequestParser>
     Handler::getParser(const std::shared_ptr<Tcp::Peer>& peer)
     {
-        return std::static_pointer_cast<RequestParser>(peer->getData(ParserData));
+        return getConnectionState(peer)->parser;
     }
 
+    namespace Private
+    {
+        ParserPool::ParserPool(const ParserPool& /*other*/)
+            : ParserPool()
+        { }
+
+        ParserPool& ParserPool::operator=(const ParserPool& /*other*/)
+        {
+            return *this;
+        }
+
+        std::shared_ptr<RequestParser> ParserPool::acquire(size_t maxDataSize, bool reuseStorage,
+                                                           bool lazyHeaders, bool inPlaceChunks)
+        {
+            std::shared_ptr<RequestParser> parser;
+            if (free_.empty())
+            {
+                live_->fetch_add(1, std::memory_order_relaxed);
+                parser = std::shared_ptr<RequestParser>(
+                    new RequestParser(maxDataSize), [live = live_](RequestParser* p) {
+                        live->fetch_sub(1, std::memory_order_relaxed);
+                        delete p;
+                    });
+            }
+            else
+            {
+                parser = std::move(free_.back());
+                free_.pop_back();
+                pooled_.store(free_.size(), std::memory_order_relaxed);
+                // Reset when it was released, the request starts with the
+                // bytes it is taken for
+                parser->restartClock();
+            }
+
+            parser->setStorageReuse(reuseStorage);
+            parser->setLazyHeaders(lazyHeaders);
+            parser->setInPlaceChunks(inPlaceChunks);
+            // The handler decides whether the body is streamed or buffered
+            parser->setHeadFirst(true);
+            return parser;
+        }
+
+        void ParserPool::release(std::shared_ptr<RequestParser> parser)
+        {
+            if (free_.size() < MaxPooled)
+            {
+                free_.push_back(std::move(parser));
+                pooled_.store(free_.size(), std::memory_order_relaxed);
+            }
+        }
+
+        size_t ParserPool::active() const
+        {
+            const auto live   = live_->load(std::memory_order_relaxed);
+            const auto pooled = pooled_.load(std::memory_order_relaxed);
+            return live > pooled ? live - pooled : 0;
+        }
+
+        size_t ParserPool::pooled() const { return pooled_.load(std::memory_order_relaxed); }
+
+        ConnectionState::~ConnectionState()
+        {
+            // The connection went away before the response was queued
+            if (inFlight && pipeline.load() != Idle)
+                inFlight->fetch_sub(1, std::memory_order_relaxed);
+            if (budget)
+                budget->release(budgeted);
+        }
+
+        void ConnectionState::responseQueued(Tcp::Transport* transport,
+                                             const std::weak_ptr<Tcp::Peer>& peer)
+        {
+            const int previous = pipeline.exchange(Idle);
+            if (inFlight && previous != Idle)
+                inFlight->fetch_sub(1, std::memory_order_relaxed);
+            if (previous != Stalled)
+                return;
+
+            // Posted even from the thread of the transport, the response may
+            // have been written from within a handler further up the stack
+            transport->post([handler = handler, peer] {
+                if (auto sp = peer.lock())
+                    handler->resumeRequests(sp);
+            });
+        }
+
+        void ConnectionState::settle()
+        {
+            if (pipeline.exchange(Idle) != Idle && inFlight)
+                inFlight->fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        LoadShedder::LoadShedder(const LoadShedder& other)
+            : maxInFlight_(other.maxInFlight_)
+            , target_(other.target_)
+            , interval_(other.interval_)
+        {
+            if (maxInFlight_ > 0)
+                inFlight_ = std::make_shared<std::atomic<size_t>>(0);
+        }
+
+        LoadShedder& LoadShedder::operator=(const LoadShedder& other)
+        {
+            if (this != &other)
+            {
+                setMaxInFlight(other.maxInFlight_);
+                setQueueDelay(other.target_, other.interval_);
+            }
+            return *this;
+        }
+
+        void LoadShedder::setMaxInFlight(size_t value)
+        {
+            maxInFlight_ = value;
+            inFlight_    = value > 0 ? std::make_shared<std::atomic<size_t>>(0) : nullptr;
+        }
+
+        void LoadShedder::setQueueDelay(std::chrono::milliseconds target,
+                                        std::chrono::milliseconds interval)
+        {
+            if (target.count() < 0 || interval.count() <= 0)
+                throw std::invalid_argument("Invalid load shedding target or interval");
+
+            target_      = target;
+            interval_    = interval;
+            minDelay_    = Clock::duration::zero();
+            intervalEnd_ = Clock::time_point();
+            overloaded_  = false;
+        }
+
+        bool LoadShedder::shed(Clock::time_point received, Clock::time_point now)
+        {
+            if (inFlight_ && inFlight_->load(std::memory_order_relaxed) >= maxInFlight_)
+                return true;
+            if (target_.count() == 0)
+                return false;
+
+            const auto delay = std::max(now - received, Clock::duration::zero());
+            if (now >= intervalEnd_)
+            {
+                // No request of the interval got through the queue in time
+                overloaded_  = minDelay_ > target_;
+                minDelay_    = delay;
+                intervalEnd_ = now + interval_;
+            }
+            else if (delay < minDelay_)
+            {
+                minDelay_ = delay;
+            }
+
+            return overloaded_ && delay > 2 * target_;
+        }
+
+        const std::shared_ptr<std::atomic<size_t>>& LoadShedder::inFlight() const
+        {
+            return inFlight_;
+        }
+
+        bool BodyBudget::Counts::charge(size_t bytes)
+        {
+            const auto used = worker.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            if (workerLimit > 0 && used > workerLimit)
+            {
+                worker.fetch_sub(bytes, std::memory_order_relaxed);
+                return false;
+            }
+
+            if (global && global->fetch_add(bytes, std::memory_order_relaxed) + bytes > globalLimit)
+            {
+                global->fetch_sub(bytes, std::memory_order_relaxed);
+                worker.fetch_sub(bytes, std::memory_order_relaxed);
+                return false;
+            }
+            return true;
+        }
+
+        void BodyBudget::Counts::release(size_t bytes)
+        {
+            if (bytes == 0)
+                return;
+            worker.fetch_sub(bytes, std::memory_order_relaxed);
+            if (global)
+                global->fetch_sub(bytes, std::memory_order_relaxed);
+        }
+
+        bool BodyBudget::Counts::fits(size_t bytes) const
+        {
+            if (workerLimit > 0 && worker.load(std::memory_order_relaxed) + bytes > workerLimit)
+                return false;
+            return !global || global->load(std::memory_order_relaxed) + bytes <= globalLimit;
+        }
+
+        BodyBudget::BodyBudget(const BodyBudget& other) { *this = other; }
+
+        BodyBudget& BodyBudget::operator=(const BodyBudget& other)
+        {
+            if (this == &other)
+                return *this;
+
+            counts_.reset();
+            if (other.counts_)
+            {
+                counts_              = std::make_shared<Counts>();
+                counts_->globalLimit = other.counts_->globalLimit;
+                counts_->workerLimit = other.counts_->workerLimit;
+                counts_->global      = other.counts_->global;
+            }
+            return *this;
+        }
+
+        void BodyBudget::setLimits(size_t global, size_t perWorker)
+        {
+            counts_.reset();
+            if (global == 0 && perWorker == 0)
+                return;
+
+            counts_              = std::make_shared<Counts>();
+            counts_->globalLimit = global;
+            counts_->workerLimit = perWorker;
+            if (global > 0)
+                counts_->global = std::make_shared<std::atomic<size_t>>(0);
+        }
+    } // namespace Private
+
 } // namespace Pistache::Http
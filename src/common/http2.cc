@@ -0,0 +1,1746 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* http2.cc
+
+   Implementation of the HTTP/2 sessions, of the servers and of the clients
+*/
+
+#include <pistache/http2.h>
+#include <pistache/peer.h>
+#include <pistache/transport.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "string_utils.h"
+
+namespace Pistache::Http::Http2
+{
+
+    namespace
+    {
+        uint32_t readUint32(const char* data)
+        {
+            const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+            return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16)
+                | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+        }
+
+        uint16_t readUint16(const char* data)
+        {
+            const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+            return static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+        }
+
+        void appendUint32(std::string& out, uint32_t value)
+        {
+            out.push_back(static_cast<char>(value >> 24));
+            out.push_back(static_cast<char>(value >> 16));
+            out.push_back(static_cast<char>(value >> 8));
+            out.push_back(static_cast<char>(value));
+        }
+
+        void appendSetting(std::string& out, SettingId id, uint32_t value)
+        {
+            const auto raw = static_cast<uint16_t>(id);
+            out.push_back(static_cast<char>(raw >> 8));
+            out.push_back(static_cast<char>(raw));
+            appendUint32(out, value);
+        }
+
+        std::string lowercase(std::string_view name)
+        {
+            std::string result(name);
+            std::transform(result.begin(), result.end(), result.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return result;
+        }
+
+        // Meaningful to a single HTTP/1 connection only (RFC 9113 8.2.2)
+        bool isConnectionSpecific(std::string_view name)
+        {
+            return name == "connection" || name == "keep-alive" || name == "proxy-connection"
+                || name == "transfer-encoding" || name == "upgrade";
+        }
+
+        // The names of the fields of an HTTP/2 message are lowercase tokens
+        bool isValidName(std::string_view name)
+        {
+            if (name.empty())
+                return false;
+            return std::none_of(name.begin(), name.end(), [](unsigned char c) {
+                return c <= 0x20 || c >= 0x7f || (c >= 'A' && c <= 'Z') || c == ':';
+            });
+        }
+
+        size_t partSize(const BodyPart& part)
+        {
+            return std::visit([](const auto& buffer) { return buffer.size(); }, part);
+        }
+
+        using HttpMethods = std::unordered_map<std::string, Method>;
+
+        const HttpMethods httpMethods = {
+#define METHOD(repr, str) { str, Method::repr },
+            HTTP_METHODS
+#undef METHOD
+        };
+
+        void addHeader(Message& message, std::string name, std::string value, bool lazy)
+        {
+            auto& headers = message.headers();
+
+            if (lazy && Header::detail::knownSlotIgnoreCase(name) < Header::detail::KnownHeadersCount)
+            {
+                headers.addDeferred(Header::Raw(std::move(name), std::move(value)));
+                return;
+            }
+
+            if (Header::Registry::instance().isRegistered(name))
+            {
+                std::shared_ptr<Header::Header> header = Header::Registry::instance().makeHeader(name);
+                header->parseRaw(value.data(), value.size());
+                headers.add(header);
+            }
+
+            headers.addRaw(Header::Raw(std::move(name), std::move(value)));
+        }
+    } // namespace
+
+    bool startsWithPreface(const char* data, size_t size)
+    {
+        if (size == 0)
+            return false;
+        const auto length = std::min(size, Preface.size());
+        return std::memcmp(data, Preface.data(), length) == 0;
+    }
+
+    Priority Priority::parse(std::string_view value)
+    {
+        Priority priority;
+
+        // A dictionary of structured fields, the members that are not
+        // understood are ignored
+        while (!value.empty())
+        {
+            const auto end = value.find(',');
+            auto member    = Private::trim(value.substr(0, end));
+            value          = end == std::string_view::npos ? std::string_view() : value.substr(end + 1);
+
+            member           = member.substr(0, member.find(';'));
+            const auto equal = member.find('=');
+            const auto key   = Private::trim(member.substr(0, equal));
+            const auto item  = equal == std::string_view::npos ? std::string_view() : Private::trim(member.substr(equal + 1));
+
+            if (key == "u")
+            {
+                if (item.size() == 1 && item[0] >= '0' && item[0] <= '7')
+                    priority.urgency = static_cast<uint8_t>(item[0] - '0');
+            }
+            else if (key == "i")
+            {
+                if (equal == std::string_view::npos || item == "?1")
+                    priority.incremental = true;
+                else if (item == "?0")
+                    priority.incremental = false;
+            }
+        }
+
+        return priority;
+    }
+
+    SessionBase::SessionBase(size_t maxHeaderBlock)
+        : maxHeaderBlock_(maxHeaderBlock)
+    { }
+
+    void SessionBase::handleFrames()
+    {
+        size_t offset = 0;
+        while (!failed_ && input_.size() - offset >= FrameHeaderSize)
+        {
+            const char* header = input_.data() + offset;
+            const auto length  = readUint32(header) >> 8;
+            if (length > DefaultMaxFrameSize)
+                throw ConnectionError { ErrorCode::FrameSizeError, "Frame too large" };
+            if (input_.size() - offset < FrameHeaderSize + length)
+                break;
+
+            const auto type   = static_cast<FrameType>(header[3]);
+            const auto flags  = static_cast<uint8_t>(header[4]);
+            const auto stream = readUint32(header + 5) & 0x7fffffff;
+
+            handleFrame(type, flags, stream, header + FrameHeaderSize, length);
+            offset += FrameHeaderSize + length;
+        }
+
+        input_.erase(0, offset);
+    }
+
+    void SessionBase::handleFrame(FrameType type, uint8_t flags, uint32_t stream,
+                                  const char* payload, size_t length)
+    {
+        if (headerStream_ != 0 && type != FrameType::Continuation)
+            throw ConnectionError { ErrorCode::ProtocolError, "Expected a CONTINUATION frame" };
+        if (!settingsReceived_ && type != FrameType::Settings)
+            throw ConnectionError { ErrorCode::ProtocolError, "Expected the SETTINGS of the peer" };
+
+        switch (type)
+        {
+        case FrameType::Data:
+            handleData(flags, stream, payload, length);
+            break;
+        case FrameType::Headers:
+            handleHeaders(flags, stream, payload, length);
+            break;
+        case FrameType::RstStream:
+            handleRstStream(stream, payload, length);
+            break;
+        case FrameType::Settings:
+            handleSettings(flags, stream, payload, length);
+            break;
+        case FrameType::PushPromise:
+            // Never sent by a client, and disabled by the SETTINGS of ours
+            throw ConnectionError { ErrorCode::ProtocolError, "Unexpected PUSH_PROMISE" };
+        case FrameType::Ping:
+            if (stream != 0)
+                throw ConnectionError { ErrorCode::ProtocolError, "PING on a stream" };
+            if (length != 8)
+                throw ConnectionError { ErrorCode::FrameSizeError, "Invalid PING" };
+            if ((flags & Flag::Ack) == 0)
+                writeFrame(FrameType::Ping, Flag::Ack, 0, std::string_view(payload, length));
+            break;
+        case FrameType::GoAway:
+            if (stream != 0)
+                throw ConnectionError { ErrorCode::ProtocolError, "GOAWAY on a stream" };
+            handleGoAway(payload, length);
+            break;
+        case FrameType::WindowUpdate:
+            handleWindowUpdate(stream, payload, length);
+            break;
+        case FrameType::Continuation:
+            handleContinuation(flags, stream, payload, length);
+            break;
+        default:
+            handleOther(type, flags, stream, payload, length);
+            break;
+        }
+    }
+
+    void SessionBase::handleOther(FrameType /*type*/, uint8_t /*flags*/, uint32_t /*stream*/,
+                                  const char* /*payload*/, size_t /*length*/)
+    {
+        // Unknown frames are ignored (RFC 9113 5.5)
+    }
+
+    void SessionBase::handleHeaders(uint8_t flags, uint32_t stream, const char* payload, size_t length)
+    {
+        if (stream == 0 || stream % 2 == 0)
+            throw ConnectionError { ErrorCode::ProtocolError, "HEADERS on an invalid stream" };
+
+        size_t offset  = 0;
+        size_t padding = 0;
+        if (flags & Flag::Padded)
+        {
+            if (length < 1)
+                throw ConnectionError { ErrorCode::FrameSizeError, "Missing padding length" };
+            padding = static_cast<uint8_t>(payload[0]);
+            offset  = 1;
+        }
+        if (flags & Flag::Priority)
+        {
+            if (length < offset + 5)
+                throw ConnectionError { ErrorCode::FrameSizeError, "Truncated priority" };
+            if ((readUint32(payload + offset) & 0x7fffffff) == stream)
+                throw ConnectionError { ErrorCode::ProtocolError, "Stream depends on itself" };
+            offset += 5;
+        }
+        if (offset + padding > length)
+            throw ConnectionError { ErrorCode::ProtocolError, "Padding exceeds the frame" };
+
+        headerBlock_.assign(payload + offset, length - offset - padding);
+        headerStream_ = stream;
+        headerFlags_  = flags;
+
+        if (flags & Flag::EndHeaders)
+            handleHeaderBlock();
+    }
+
+    void SessionBase::handleContinuation(uint8_t flags, uint32_t stream, const char* payload, size_t length)
+    {
+        if (headerStream_ == 0 || stream != headerStream_)
+            throw ConnectionError { ErrorCode::ProtocolError, "Unexpected CONTINUATION frame" };
+        if (headerBlock_.size() + length > maxHeaderBlock_)
+            throw ConnectionError { ErrorCode::EnhanceYourCalm, "Header block too large" };
+
+        headerBlock_.append(payload, length);
+        if (flags & Flag::EndHeaders)
+            handleHeaderBlock();
+    }
+
+    void SessionBase::handleSettings(uint8_t flags, uint32_t stream, const char* payload, size_t length)
+    {
+        if (stream != 0)
+            throw ConnectionError { ErrorCode::ProtocolError, "SETTINGS on a stream" };
+
+        if (flags & Flag::Ack)
+        {
+            if (length != 0)
+                throw ConnectionError { ErrorCode::FrameSizeError, "SETTINGS acknowledgment with a payload" };
+            return;
+        }
+
+        if (length % 6 != 0)
+            throw ConnectionError { ErrorCode::FrameSizeError, "Invalid SETTINGS" };
+
+        for (size_t offset = 0; offset < length; offset += 6)
+        {
+            const auto id    = static_cast<SettingId>(readUint16(payload + offset));
+            const auto value = readUint32(payload + offset + 2);
+
+            switch (id)
+            {
+            case SettingId::HeaderTableSize:
+                encoder_.setMaxTableSize(value);
+                break;
+            case SettingId::InitialWindowSize:
+                if (value > MaxWindowSize)
+                    throw ConnectionError { ErrorCode::FlowControlError, "Invalid SETTINGS_INITIAL_WINDOW_SIZE" };
+
+                // Applies to the streams already open as well
+                adjustWindows(static_cast<int64_t>(value) - peerInitialWindow_);
+                peerInitialWindow_ = value;
+                break;
+            case SettingId::MaxFrameSize:
+                if (value < DefaultMaxFrameSize || value > MaxFrameSizeLimit)
+                    throw ConnectionError { ErrorCode::ProtocolError, "Invalid SETTINGS_MAX_FRAME_SIZE" };
+                peerMaxFrameSize_ = value;
+                break;
+            default:
+                applySetting(id, value);
+                break;
+            }
+        }
+
+        settingsReceived_ = true;
+        writeFrame(FrameType::Settings, Flag::Ack, 0, std::string_view());
+    }
+
+    void SessionBase::handleWindowUpdate(uint32_t stream, const char* payload, size_t length)
+    {
+        if (length != 4)
+            throw ConnectionError { ErrorCode::FrameSizeError, "Invalid WINDOW_UPDATE" };
+
+        const auto increment = readUint32(payload) & 0x7fffffff;
+        if (stream == 0)
+        {
+            if (increment == 0)
+                throw ConnectionError { ErrorCode::ProtocolError, "Empty WINDOW_UPDATE" };
+
+            sendWindow_ += increment;
+            if (sendWindow_ > MaxWindowSize)
+                throw ConnectionError { ErrorCode::FlowControlError, "Connection window overflow" };
+            return;
+        }
+
+        auto* window = streamWindow(stream);
+        if (!window)
+        {
+            if (isIdle(stream))
+                throw ConnectionError { ErrorCode::ProtocolError, "WINDOW_UPDATE on an idle stream" };
+            return;
+        }
+
+        if (increment == 0)
+        {
+            failStream(stream, ErrorCode::ProtocolError, "Empty WINDOW_UPDATE");
+            return;
+        }
+
+        *window += increment;
+        if (*window > MaxWindowSize)
+            failStream(stream, ErrorCode::FlowControlError, "Stream window overflow");
+    }
+
+    void SessionBase::writeFrame(FrameType type, uint8_t flags, uint32_t stream, std::string_view payload)
+    {
+        appendUint32(output_, static_cast<uint32_t>(payload.size() << 8) | static_cast<uint8_t>(type));
+        output_.push_back(static_cast<char>(flags));
+        appendUint32(output_, stream);
+        output_.append(payload.data(), payload.size());
+    }
+
+    void SessionBase::writeHead(uint32_t stream, const std::vector<Hpack::HeaderField>& head, bool end)
+    {
+        std::string block;
+        encoder_.encode(head, block);
+
+        // Split in CONTINUATION frames past the largest frame of the peer
+        size_t offset = 0;
+        do
+        {
+            const auto length = std::min<size_t>(block.size() - offset, peerMaxFrameSize_);
+            const bool first  = offset == 0;
+
+            uint8_t flags = offset + length == block.size() ? Flag::EndHeaders : 0;
+            if (first && end)
+                flags |= Flag::EndStream;
+
+            writeFrame(first ? FrameType::Headers : FrameType::Continuation, flags, stream,
+                       std::string_view(block).substr(offset, length));
+            offset += length;
+        } while (offset < block.size());
+    }
+
+    void SessionBase::writeGoAway(uint32_t lastStream, ErrorCode code)
+    {
+        std::string payload;
+        appendUint32(payload, lastStream);
+        appendUint32(payload, static_cast<uint32_t>(code));
+        writeFrame(FrameType::GoAway, 0, 0, payload);
+    }
+
+    void SessionBase::replenishWindow(uint32_t stream, int64_t& window, int64_t size)
+    {
+        if (window >= size / 2)
+            return;
+
+        std::string payload;
+        appendUint32(payload, static_cast<uint32_t>(size - window));
+        writeFrame(FrameType::WindowUpdate, 0, stream, payload);
+        window = size;
+    }
+
+    Session::Session(Handler* handler, Tcp::Transport* transport,
+                     const std::shared_ptr<Tcp::Peer>& peer,
+                     const std::shared_ptr<Private::ConnectionState>& connection)
+        : handler_(handler)
+        , transport_(transport)
+        , peer_(peer)
+        , connection_(connection)
+        , fd_(peer->fd())
+    { }
+
+    Session::~Session()
+    {
+        for (auto& [id, stream] : streams_)
+        {
+            for (auto& pending : stream.pending)
+            {
+                if (pending.done)
+                    pending.done->reject(Error("Connection closed"));
+            }
+        }
+
+        for (auto& [done, size] : written_)
+            done->reject(Error("Connection closed"));
+    }
+
+    void Session::start()
+    {
+        std::string settings;
+        appendSetting(settings, SettingId::MaxConcurrentStreams, DefaultMaxStreams);
+        appendSetting(settings, SettingId::MaxHeaderListSize,
+                      static_cast<uint32_t>(std::min<size_t>(handler_->getMaxRequestSize(), MaxWindowSize)));
+        appendSetting(settings, SettingId::NoRfc7540Priorities, 1);
+        writeFrame(FrameType::Settings, 0, 0, settings);
+
+        updateIdle();
+        flushOutput();
+    }
+
+    void Session::feed(const char* data, size_t size)
+    {
+        if (failed_)
+            return;
+
+        input_.append(data, size);
+        handling_ = true;
+
+        try
+        {
+            if (!prefaceReceived_)
+            {
+                if (!startsWithPreface(input_.data(), input_.size()))
+                    throw ConnectionError { ErrorCode::ProtocolError, "Invalid connection preface" };
+                if (input_.size() >= Preface.size())
+                {
+                    input_.erase(0, Preface.size());
+                    prefaceReceived_ = true;
+                }
+            }
+
+            if (prefaceReceived_)
+                handleFrames();
+        }
+        catch (const ConnectionError& error)
+        {
+            goAway(error.code);
+        }
+
+        handling_ = false;
+
+        if (auto state = connection_.lock())
+            state->since = std::chrono::steady_clock::now();
+
+        pump();
+        flushOutput();
+    }
+
+    Async::Promise<ssize_t> Session::respond(uint32_t stream, std::vector<Hpack::HeaderField> head,
+                                             std::vector<BodyPart> body, bool end)
+    {
+        return queue(stream, std::move(head), std::move(body), end);
+    }
+
+    Async::Promise<ssize_t> Session::sendData(uint32_t stream, std::vector<BodyPart> body, bool end)
+    {
+        return queue(stream, std::nullopt, std::move(body), end);
+    }
+
+    std::vector<Hpack::HeaderField>
+    Session::responseHead(const Message& response, std::optional<size_t> contentLength)
+    {
+        std::vector<Hpack::HeaderField> head;
+        head.push_back({ ":status", std::to_string(static_cast<int>(response.code())) });
+
+        for (const auto& header : response.headers().list())
+        {
+            auto name = lowercase(header->name());
+            if (isConnectionSpecific(name) || (contentLength && name == "content-length"))
+                continue;
+
+            std::ostringstream value;
+            header->write(value);
+            head.push_back({ std::move(name), value.str() });
+        }
+
+        for (const auto& cookie : response.cookies())
+        {
+            std::ostringstream value;
+            value << cookie;
+            head.push_back({ "set-cookie", value.str() });
+        }
+
+        if (contentLength)
+            head.push_back({ "content-length", std::to_string(*contentLength) });
+
+        return head;
+    }
+
+    size_t Session::openStreams() const { return streams_.size(); }
+
+    Async::Promise<ssize_t> Session::queue(uint32_t stream,
+                                           std::optional<std::vector<Hpack::HeaderField>> head,
+                                           std::vector<BodyPart> body, bool end)
+    {
+        return Async::Promise<ssize_t>([&](Async::Deferred<ssize_t> deferred) {
+            auto done = std::make_shared<Async::Deferred<ssize_t>>(std::move(deferred));
+            if (transport_->isInTransportThread())
+            {
+                queueNow(stream, std::move(head), std::move(body), end, std::move(done));
+                return;
+            }
+
+            transport_->post([self = shared_from_this(), stream, head = std::move(head),
+                              body = std::move(body), end, done = std::move(done)]() mutable {
+                self->queueNow(stream, std::move(head), std::move(body), end, std::move(done));
+            });
+        });
+    }
+
+    void Session::queueNow(uint32_t stream, std::optional<std::vector<Hpack::HeaderField>> head,
+                           std::vector<BodyPart> body, bool end,
+                           std::shared_ptr<Async::Deferred<ssize_t>> done)
+    {
+        auto it = streams_.find(stream);
+        if (it == std::end(streams_) || failed_)
+        {
+            done->reject(Error("The stream has been closed"));
+            return;
+        }
+
+        auto& state = it->second;
+        if (head ? state.responded : (!state.responded || state.ending))
+        {
+            done->reject(Error(head ? "A response already has been sent" : "No response to send data on"));
+            return;
+        }
+
+        // The response to a HEAD request is its head only
+        if (state.head)
+            body.clear();
+
+        ssize_t total = 0;
+        for (const auto& part : body)
+            total += static_cast<ssize_t>(partSize(part));
+        body.erase(std::remove_if(body.begin(), body.end(),
+                                  [](const BodyPart& part) { return partSize(part) == 0; }),
+                   body.end());
+
+        if (head)
+        {
+            state.responded = true;
+            if (end && body.empty())
+            {
+                writeHead(state.id, *head, true);
+                written_.emplace_back(std::move(done), 0);
+                if (!state.remoteClosed)
+                    writeFrame(FrameType::RstStream, 0, stream, std::string_view("\0\0\0\0", 4));
+                closeStream(it);
+
+                if (!handling_)
+                    flushOutput();
+                return;
+            }
+            writeHead(state.id, *head, false);
+        }
+
+        // The END_STREAM flag needs a frame of its own
+        if (body.empty() && end)
+            body.emplace_back(RawBuffer());
+
+        if (body.empty())
+            written_.emplace_back(std::move(done), 0);
+
+        for (auto& part : body)
+            state.pending.push_back(Pending { std::move(part), 0, nullptr, 0 });
+        if (!state.pending.empty() && !body.empty())
+        {
+            state.pending.back().done  = std::move(done);
+            state.pending.back().total = total;
+        }
+        state.ending = end;
+
+        if (!handling_)
+        {
+            pump();
+            flushOutput();
+        }
+    }
+
+    void Session::handleOther(FrameType type, uint8_t /*flags*/, uint32_t stream,
+                              const char* payload, size_t length)
+    {
+        if (type == FrameType::Priority)
+        {
+            // The dependencies of RFC 7540 are not used
+            if (stream == 0)
+                throw ConnectionError { ErrorCode::ProtocolError, "PRIORITY on the connection" };
+            if (length != 5)
+                resetStream(stream, ErrorCode::FrameSizeError);
+        }
+        else if (type == FrameType::PriorityUpdate)
+        {
+            handlePriorityUpdate(stream, payload, length);
+        }
+    }
+
+    void Session::handleData(uint8_t flags, uint32_t stream, const char* payload, size_t length)
+    {
+        if (stream == 0)
+            throw ConnectionError { ErrorCode::ProtocolError, "DATA on the connection" };
+
+        // Padding included, the whole frame counts against the windows
+        if (static_cast<int64_t>(length) > recvWindow_)
+            throw ConnectionError { ErrorCode::FlowControlError, "Connection window exceeded" };
+        recvWindow_ -= static_cast<int64_t>(length);
+
+        auto it = streams_.find(stream);
+        if (it == std::end(streams_))
+        {
+            if (stream > lastStreamId_)
+                throw ConnectionError { ErrorCode::ProtocolError, "DATA on an idle stream" };
+
+            // Sent before the peer knew about the reset of the stream
+            replenish(nullptr);
+            return;
+        }
+
+        auto& state = it->second;
+        if (state.remoteClosed)
+        {
+            replenish(nullptr);
+            resetStream(stream, ErrorCode::StreamClosed);
+            return;
+        }
+
+        if (static_cast<int64_t>(length) > state.recvWindow)
+        {
+            replenish(nullptr);
+            resetStream(stream, ErrorCode::FlowControlError);
+            return;
+        }
+        state.recvWindow -= static_cast<int64_t>(length);
+
+        size_t offset  = 0;
+        size_t padding = 0;
+        if (flags & Flag::Padded)
+        {
+            if (length < 1)
+                throw ConnectionError { ErrorCode::FrameSizeError, "Missing padding length" };
+            padding = static_cast<uint8_t>(payload[0]);
+            offset  = 1;
+        }
+        if (offset + padding > length)
+            throw ConnectionError { ErrorCode::ProtocolError, "Padding exceeds the frame" };
+
+        const auto size = length - offset - padding;
+        const bool end  = (flags & Flag::EndStream) != 0;
+
+        // A request answered early, with an error, is not received anymore
+        if (!state.responded)
+        {
+            if (state.request.body_.size() + size > handler_->getMaxRequestSize())
+            {
+                replenish(nullptr);
+                respondError(stream, Code::Request_Entity_Too_Large,
+                             "Request exceeded maximum buffer size");
+                if (end)
+                    endRequest(stream);
+                return;
+            }
+
+            state.request.body_.append(payload + offset, size);
+        }
+
+        replenish(end ? nullptr : &state);
+        if (end)
+            endRequest(stream);
+    }
+
+    void Session::handleHeaderBlock()
+    {
+        const auto id    = headerStream_;
+        const auto flags = headerFlags_;
+        headerStream_    = 0;
+
+        // Decoded even when the stream is refused, the table has to follow
+        // the one of the encoder
+        std::vector<Hpack::HeaderField> fields;
+        try
+        {
+            fields = decoder_.decode(headerBlock_.data(), headerBlock_.size(),
+                                     handler_->getMaxRequestSize());
+        }
+        catch (const Hpack::HeaderListTooLarge&)
+        {
+            throw ConnectionError { ErrorCode::EnhanceYourCalm, "Header list too large" };
+        }
+        catch (const Hpack::DecodeError&)
+        {
+            throw ConnectionError { ErrorCode::CompressionError, "Invalid header block" };
+        }
+        headerBlock_.clear();
+
+        const bool end = (flags & Flag::EndStream) != 0;
+
+        auto it = streams_.find(id);
+        if (it != std::end(streams_))
+        {
+            // Trailers, only the end of the request they mark matters
+            if (it->second.remoteClosed)
+                resetStream(id, ErrorCode::StreamClosed);
+            else if (!end)
+                resetStream(id, ErrorCode::ProtocolError);
+            else
+                endRequest(id);
+            return;
+        }
+
+        // On a stream that already is closed
+        if (id <= lastStreamId_)
+            return;
+        lastStreamId_ = id;
+
+        if (streams_.size() >= DefaultMaxStreams)
+        {
+            writeFrame(FrameType::RstStream, 0, id, std::string_view("\0\0\0\x7", 4));
+            return;
+        }
+
+        auto& state      = streams_[id];
+        state.id         = id;
+        state.sendWindow = peerInitialWindow_;
+
+        state.request.received_ = std::chrono::steady_clock::now();
+
+        auto early = earlyPriorities_.find(id);
+        if (early != std::end(earlyPriorities_))
+        {
+            state.priority = early->second;
+            earlyPriorities_.erase(early);
+        }
+        updateIdle();
+
+        try
+        {
+            if (!buildRequest(state, fields))
+            {
+                resetStream(id, ErrorCode::ProtocolError);
+                return;
+            }
+        }
+        catch (const HttpError& err)
+        {
+            respondError(id, static_cast<Code>(err.code()), err.reason());
+        }
+        catch (const std::exception& e)
+        {
+            respondError(id, Code::Internal_Server_Error, e.what());
+        }
+
+        if (end)
+            endRequest(id);
+    }
+
+    bool Session::buildRequest(Stream& stream, std::vector<Hpack::HeaderField>& fields)
+    {
+        auto& request    = stream.request;
+        request.version_ = Version::Http2;
+
+        std::string method;
+        std::string scheme;
+        std::string path;
+        std::string authority;
+
+        const bool lazy = handler_->getLazyHeaders();
+        bool regular    = false;
+
+        for (auto& field : fields)
+        {
+            // The pseudo-header fields come first (RFC 9113 8.3)
+            if (!field.name.empty() && field.name.front() == ':')
+            {
+                std::string* target = nullptr;
+                if (field.name == ":method")
+                    target = &method;
+                else if (field.name == ":scheme")
+                    target = &scheme;
+                else if (field.name == ":path")
+                    target = &path;
+                else if (field.name == ":authority")
+                    target = &authority;
+
+                if (regular || target == nullptr || !target->empty() || field.value.empty())
+                    return false;
+                *target = std::move(field.value);
+                continue;
+            }
+
+            regular = true;
+            if (!isValidName(field.name) || isConnectionSpecific(field.name))
+                return false;
+            if (field.name == "te" && field.value != "trailers")
+                return false;
+
+            // Split in several fields to compress better (RFC 9113 8.2.3)
+            if (field.name == "cookie")
+            {
+                request.cookies_.addFromRaw(field.value.data(), field.value.size());
+                continue;
+            }
+
+            if (field.name == "content-length")
+            {
+                if (field.value.empty()
+                    || !std::all_of(field.value.begin(), field.value.end(),
+                                    [](unsigned char c) { return std::isdigit(c); }))
+                    return false;
+                stream.contentLength = std::stoull(field.value);
+            }
+            else if (field.name == "priority")
+            {
+                stream.priority = Priority::parse(field.value);
+            }
+
+            addHeader(request, std::move(field.name), std::move(field.value), lazy);
+        }
+
+        // CONNECT, and its tunnels, are not supported
+        if (method.empty() || scheme.empty() || path.empty())
+            return false;
+
+        auto it = httpMethods.find(method);
+        if (it == std::end(httpMethods))
+            throw HttpError(Code::Bad_Request, "Unknown HTTP request method");
+        request.method_ = it->second;
+        stream.head     = request.method_ == Method::Head;
+
+        const auto query = path.find('?');
+        if (query != std::string::npos)
+        {
+            request.query_ = Uri::Query::fromRaw(path.substr(query + 1));
+            path.resize(query);
+        }
+        request.resource_ = std::move(path);
+
+        if (!authority.empty() && !request.headers().has<Header::Host>())
+            addHeader(request, "host", std::move(authority), lazy);
+
+        return true;
+    }
+
+    void Session::endRequest(uint32_t stream)
+    {
+        auto it = streams_.find(stream);
+        if (it == std::end(streams_))
+            return;
+
+        auto& state        = it->second;
+        state.remoteClosed = true;
+        if (state.responded)
+            return;
+
+        if (state.contentLength && *state.contentLength != state.request.body_.size())
+        {
+            resetStream(stream, ErrorCode::ProtocolError);
+            return;
+        }
+
+        dispatch(stream);
+    }
+
+    void Session::dispatch(uint32_t stream)
+    {
+        auto peer = peer_.lock();
+        if (!peer)
+            return;
+
+        // The handler may answer, and the stream be closed, before it
+        // returns: nothing of the stream is used past that call
+        Request request = std::move(streams_.at(stream).request);
+        request.copyAddress(peer->address());
+
+        ResponseWriter response(Version::Http2, transport_, handler_, peer);
+        response.attachHttp2(shared_from_this(), stream);
+
+        const auto& compression = handler_->getCompression();
+        if (compression.enabled)
+        {
+            if (auto accept = request.headers().tryGetRaw("Accept-Encoding"))
+                response.setCompression(Compression::negotiate(accept->value()));
+        }
+
+        try
+        {
+            handler_->dispatchRequest(std::move(request), std::move(response));
+        }
+        catch (const HttpError& err)
+        {
+            respondError(stream, static_cast<Code>(err.code()), err.reason());
+        }
+        catch (const std::exception& e)
+        {
+            respondError(stream, Code::Internal_Server_Error, e.what());
+        }
+    }
+
+    void Session::respondError(uint32_t stream, Code code, const std::string& body)
+    {
+        auto it = streams_.find(stream);
+        if (it == std::end(streams_) || it->second.responded)
+            return;
+
+        std::vector<Hpack::HeaderField> head {
+            { ":status", std::to_string(static_cast<int>(code)) },
+            { "content-length", std::to_string(body.size()) },
+        };
+
+        std::vector<BodyPart> parts;
+        parts.emplace_back(RawBuffer(body.data(), body.size()));
+
+        queueNow(stream, std::move(head), std::move(parts), true,
+                 std::make_shared<Async::Deferred<ssize_t>>());
+    }
+
+    void Session::applySetting(SettingId id, uint32_t value)
+    {
+        // The other ones do not constrain what a server sends
+        if (id == SettingId::EnablePush && value > 1)
+            throw ConnectionError { ErrorCode::ProtocolError, "Invalid SETTINGS_ENABLE_PUSH" };
+    }
+
+    void Session::adjustWindows(int64_t delta)
+    {
+        for (auto& [id, state] : streams_)
+        {
+            state.sendWindow += delta;
+            if (state.sendWindow > MaxWindowSize)
+                throw ConnectionError { ErrorCode::FlowControlError, "Stream window overflow" };
+        }
+    }
+
+    bool Session::isIdle(uint32_t stream) const { return stream > lastStreamId_; }
+
+    int64_t* Session::streamWindow(uint32_t stream)
+    {
+        auto it = streams_.find(stream);
+        return it == std::end(streams_) ? nullptr : &it->second.sendWindow;
+    }
+
+    void Session::failStream(uint32_t stream, ErrorCode code, const char* /*reason*/)
+    {
+        resetStream(stream, code);
+    }
+
+    void Session::handleGoAway(const char* /*payload*/, size_t /*length*/)
+    {
+        // The streams already opened are still answered
+    }
+
+    void Session::handleRstStream(uint32_t stream, const char* /*payload*/, size_t length)
+    {
+        if (stream == 0)
+            throw ConnectionError { ErrorCode::ProtocolError, "RST_STREAM on the connection" };
+        if (length != 4)
+            throw ConnectionError { ErrorCode::FrameSizeError, "Invalid RST_STREAM" };
+
+        auto it = streams_.find(stream);
+        if (it == std::end(streams_))
+        {
+            if (stream > lastStreamId_)
+                throw ConnectionError { ErrorCode::ProtocolError, "RST_STREAM on an idle stream" };
+            return;
+        }
+
+        closeStream(it);
+    }
+
+    void Session::handlePriorityUpdate(uint32_t stream, const char* payload, size_t length)
+    {
+        if (stream != 0)
+            throw ConnectionError { ErrorCode::ProtocolError, "PRIORITY_UPDATE on a stream" };
+        if (length < 4)
+            throw ConnectionError { ErrorCode::FrameSizeError, "Invalid PRIORITY_UPDATE" };
+
+        const auto prioritized = readUint32(payload) & 0x7fffffff;
+        if (prioritized == 0)
+            throw ConnectionError { ErrorCode::ProtocolError, "PRIORITY_UPDATE of the connection" };
+
+        const auto priority = Priority::parse(std::string_view(payload + 4, length - 4));
+
+        auto it = streams_.find(prioritized);
+        if (it != std::end(streams_))
+            it->second.priority = priority;
+        else if (prioritized > lastStreamId_ && earlyPriorities_.size() < DefaultMaxStreams)
+            earlyPriorities_[prioritized] = priority;
+    }
+
+    void Session::resetStream(uint32_t stream, ErrorCode code)
+    {
+        std::string payload;
+        appendUint32(payload, static_cast<uint32_t>(code));
+        writeFrame(FrameType::RstStream, 0, stream, payload);
+
+        auto it = streams_.find(stream);
+        if (it != std::end(streams_))
+            closeStream(it);
+    }
+
+    void Session::closeStream(std::map<uint32_t, Stream>::iterator it)
+    {
+        for (auto& pending : it->second.pending)
+        {
+            if (pending.done)
+                pending.done->reject(Error("The stream has been closed"));
+        }
+
+        streams_.erase(it);
+        updateIdle();
+    }
+
+    void Session::goAway(ErrorCode code)
+    {
+        if (failed_)
+            return;
+
+        writeGoAway(lastStreamId_, code);
+
+        while (!streams_.empty())
+            closeStream(streams_.begin());
+        failed_ = true;
+    }
+
+    void Session::replenish(Stream* stream)
+    {
+        // The bodies are held to the maximum size of a request anyway
+        replenishWindow(0, recvWindow_, DefaultWindowSize);
+        if (stream)
+            replenishWindow(stream->id, stream->recvWindow, DefaultWindowSize);
+    }
+
+    void Session::pump()
+    {
+        while (!failed_ && output_.size() + inFlight_ < MaxBuffered)
+        {
+            auto it = nextStream();
+            if (it == std::end(streams_))
+                break;
+
+            auto& state = it->second;
+            if (!sendFrame(state))
+            {
+                resetStream(it->first, ErrorCode::InternalError);
+                continue;
+            }
+            lastServed_ = it->first;
+
+            if (state.pending.empty() && state.ending)
+            {
+                // Answered before the whole request was received
+                if (!state.remoteClosed)
+                    writeFrame(FrameType::RstStream, 0, it->first, std::string_view("\0\0\0\0", 4));
+                closeStream(it);
+            }
+        }
+    }
+
+    std::map<uint32_t, Session::Stream>::iterator Session::nextStream()
+    {
+        auto ready = [this](const Stream& stream) {
+            if (stream.pending.empty())
+                return false;
+
+            const auto& front = stream.pending.front();
+            if (partSize(front.part) == front.offset)
+                return true;
+            return stream.sendWindow > 0 && sendWindow_ > 0;
+        };
+
+        // The most urgent stream. Within an urgency, the streams that are
+        // not incremental are sent one after the other, from the oldest, the
+        // incremental ones frame by frame in turn
+        auto best = std::end(streams_);
+        for (auto it = std::begin(streams_); it != std::end(streams_); ++it)
+        {
+            if (!ready(it->second))
+                continue;
+            if (best == std::end(streams_))
+            {
+                best = it;
+                continue;
+            }
+
+            const auto& candidate = it->second.priority;
+            const auto& current   = best->second.priority;
+            if (candidate.urgency != current.urgency)
+            {
+                if (candidate.urgency < current.urgency)
+                    best = it;
+                continue;
+            }
+
+            if (!current.incremental)
+                continue;
+            if (!candidate.incremental || (best->first <= lastServed_ && it->first > lastServed_))
+                best = it;
+        }
+
+        return best;
+    }
+
+    bool Session::sendFrame(Stream& stream)
+    {
+        auto& pending        = stream.pending.front();
+        const auto remaining = partSize(pending.part) - pending.offset;
+        const auto length    = static_cast<size_t>(
+            std::min<int64_t>({ static_cast<int64_t>(remaining), peerMaxFrameSize_,
+                                stream.sendWindow, sendWindow_ }));
+        const bool last = length == remaining;
+
+        const uint8_t flags = last && stream.pending.size() == 1 && stream.ending ? Flag::EndStream : 0;
+
+        const auto header = output_.size();
+        writeFrame(FrameType::Data, flags, stream.id, std::string_view());
+
+        if (const auto* raw = std::get_if<RawBuffer>(&pending.part))
+        {
+            output_.append(raw->data().data() + pending.offset, length);
+        }
+        else if (const auto* shared = std::get_if<SharedBuffer>(&pending.part))
+        {
+            output_.append(shared->data() + pending.offset, length);
+        }
+        else
+        {
+            // Read as the frames are sent, the file is not held in memory
+            const auto& file = std::get<FileBuffer>(pending.part);
+            const auto start = output_.size();
+            output_.resize(start + length);
+
+            size_t read = 0;
+            while (read < length)
+            {
+                const auto res = ::pread(file.fd(), output_.data() + start + read, length - read,
+                                         static_cast<off_t>(file.offset() + pending.offset + read));
+                if (res < 0 && errno == EINTR)
+                    continue;
+                if (res <= 0)
+                {
+                    output_.resize(header);
+                    return false;
+                }
+                read += static_cast<size_t>(res);
+            }
+        }
+
+        // The length of the frame, written once the payload is
+        const auto size      = static_cast<uint32_t>(length);
+        output_[header]      = static_cast<char>(size >> 16);
+        output_[header + 1]  = static_cast<char>(size >> 8);
+        output_[header + 2]  = static_cast<char>(size);
+
+        pending.offset += length;
+        stream.sendWindow -= static_cast<int64_t>(length);
+        sendWindow_ -= static_cast<int64_t>(length);
+
+        if (last)
+        {
+            if (pending.done)
+                written_.emplace_back(std::move(pending.done), pending.total);
+            stream.pending.pop_front();
+        }
+
+        return true;
+    }
+
+    void Session::flushOutput()
+    {
+        if (output_.empty())
+        {
+            // Nothing new to write, what was framed before is resolved
+            // along with it
+            if (!written_.empty() && inFlight_ == 0)
+            {
+                for (auto& [done, size] : written_)
+                    done->resolve(size);
+                written_.clear();
+            }
+            return;
+        }
+
+        auto peer = peer_.lock();
+        if (!peer)
+        {
+            output_.clear();
+            for (auto& [done, size] : written_)
+                done->reject(Error("Connection closed"));
+            written_.clear();
+            return;
+        }
+
+        const auto size = output_.size();
+        RawBuffer buffer(std::move(output_), size);
+        output_.clear();
+        inFlight_ += size;
+
+        auto waiters = std::make_shared<decltype(written_)>(std::move(written_));
+        written_.clear();
+
+        std::weak_ptr<Session> weak = shared_from_this();
+        auto onWritten              = [weak, size]() {
+            auto session = weak.lock();
+            if (!session)
+                return;
+
+            session->inFlight_ -= size;
+            if (session->failed_)
+            {
+                // The GOAWAY is out, the peer closes the connection
+                if (session->inFlight_ == 0)
+                {
+                    if (auto peer = session->peer_.lock())
+                        ::shutdown(peer->fd(), SHUT_WR);
+                }
+                return;
+            }
+
+            session->pump();
+            session->flushOutput();
+        };
+
+        transport_->asyncWrite(fd_, std::move(buffer))
+            .then(
+                [waiters, onWritten](ssize_t) {
+                    for (auto& [done, written] : *waiters)
+                        done->resolve(written);
+                    onWritten();
+                },
+                [waiters, onWritten](std::exception_ptr&) {
+                    for (auto& [done, written] : *waiters)
+                        done->reject(Error("Connection closed"));
+                    onWritten();
+                });
+    }
+
+    void Session::updateIdle()
+    {
+        if (auto peer = peer_.lock())
+            peer->setIdle(streams_.empty());
+        if (auto state = connection_.lock())
+            state->since = std::chrono::steady_clock::now();
+    }
+
+    ClientSession::ClientSession(Callbacks callbacks, size_t maxResponseSize, size_t maxStreams)
+        : SessionBase(std::max(MaxHeaderBlock, maxResponseSize))
+        , callbacks_(std::move(callbacks))
+        , maxResponseSize_(maxResponseSize)
+        , maxStreams_(std::max<size_t>(1, maxStreams))
+    { }
+
+    void ClientSession::start()
+    {
+        output_.append(Preface.data(), Preface.size());
+
+        std::string settings;
+        appendSetting(settings, SettingId::EnablePush, 0);
+        appendSetting(settings, SettingId::InitialWindowSize, StreamWindow);
+        appendSetting(settings, SettingId::MaxHeaderListSize,
+                      static_cast<uint32_t>(std::min<size_t>(maxResponseSize_, MaxWindowSize)));
+        writeFrame(FrameType::Settings, 0, 0, settings);
+
+        // The window of the connection only grows with a WINDOW_UPDATE
+        std::string increment;
+        appendUint32(increment, ConnectionWindow - DefaultWindowSize);
+        writeFrame(FrameType::WindowUpdate, 0, 0, increment);
+    }
+
+    uint32_t ClientSession::submit(std::vector<Hpack::HeaderField> head, std::string body)
+    {
+        if (isClosed() || nextStreamId_ > MaxWindowSize)
+            return 0;
+
+        const auto id = nextStreamId_;
+        nextStreamId_ += 2;
+
+        auto& stream      = streams_[id];
+        stream.id         = id;
+        stream.sendWindow = peerInitialWindow_;
+        stream.body       = std::move(body);
+        stream.ended      = stream.body.empty();
+
+        writeHead(id, head, stream.ended);
+        pump();
+        return id;
+    }
+
+    void ClientSession::cancel(uint32_t stream, ErrorCode code)
+    {
+        auto it = streams_.find(stream);
+        if (it == std::end(streams_))
+            return;
+
+        std::string payload;
+        appendUint32(payload, static_cast<uint32_t>(code));
+        writeFrame(FrameType::RstStream, 0, stream, payload);
+        streams_.erase(it);
+    }
+
+    void ClientSession::pause(uint32_t stream)
+    {
+        auto it = streams_.find(stream);
+        if (it != std::end(streams_))
+            it->second.paused = true;
+    }
+
+    void ClientSession::resume(uint32_t stream)
+    {
+        auto it = streams_.find(stream);
+        if (it == std::end(streams_) || !it->second.paused)
+            return;
+
+        it->second.paused = false;
+        replenish(&it->second);
+    }
+
+    bool ClientSession::feed(const char* data, size_t size)
+    {
+        if (failed_)
+            return false;
+
+        input_.append(data, size);
+
+        try
+        {
+            handleFrames();
+        }
+        catch (const ConnectionError& error)
+        {
+            // The last stream the server opened and that was processed,
+            // none with push disabled
+            writeGoAway(0, error.code);
+
+            failed_ = true;
+            error_  = error.reason;
+            input_.clear();
+
+            // Every stream left fails along with the connection
+            while (!streams_.empty())
+            {
+                const auto id = streams_.begin()->first;
+                streams_.erase(streams_.begin());
+                callbacks_.onReset(id, error_.c_str());
+            }
+            return false;
+        }
+
+        pump();
+        return true;
+    }
+
+    void ClientSession::consume(size_t size)
+    {
+        output_.erase(0, size);
+        pump();
+    }
+
+    size_t ClientSession::maxStreams() const
+    {
+        if (isClosed())
+            return 0;
+        return std::min<size_t>(maxStreams_, peerMaxStreams_);
+    }
+
+    void ClientSession::handleData(uint8_t flags, uint32_t stream, const char* payload, size_t length)
+    {
+        if (stream == 0)
+            throw ConnectionError { ErrorCode::ProtocolError, "DATA on the connection" };
+
+        if (static_cast<int64_t>(length) > recvWindow_)
+            throw ConnectionError { ErrorCode::FlowControlError, "Connection window exceeded" };
+        recvWindow_ -= static_cast<int64_t>(length);
+
+        auto it = streams_.find(stream);
+        if (it == std::end(streams_))
+        {
+            if (isIdle(stream))
+                throw ConnectionError { ErrorCode::ProtocolError, "DATA on an idle stream" };
+
+            // Sent before the server knew about the reset of the stream
+            replenish(nullptr);
+            return;
+        }
+
+        auto& state = it->second;
+        if (!state.headReceived)
+        {
+            replenish(nullptr);
+            failStream(stream, ErrorCode::ProtocolError, "DATA before the head of the response");
+            return;
+        }
+        if (static_cast<int64_t>(length) > state.recvWindow)
+        {
+            replenish(nullptr);
+            failStream(stream, ErrorCode::FlowControlError, "Stream window exceeded");
+            return;
+        }
+        state.recvWindow -= static_cast<int64_t>(length);
+
+        size_t offset  = 0;
+        size_t padding = 0;
+        if (flags & Flag::Padded)
+        {
+            if (length < 1)
+                throw ConnectionError { ErrorCode::FrameSizeError, "Missing padding length" };
+            padding = static_cast<uint8_t>(payload[0]);
+            offset  = 1;
+        }
+        if (offset + padding > length)
+            throw ConnectionError { ErrorCode::ProtocolError, "Padding exceeds the frame" };
+
+        const auto size = length - offset - padding;
+        if (state.streamed)
+        {
+            if (size > 0)
+                callbacks_.onData(stream, std::string_view(payload + offset, size));
+        }
+        else
+        {
+            if (state.response.body_.size() + size > maxResponseSize_)
+            {
+                replenish(nullptr);
+                failStream(stream, ErrorCode::Cancel, "Response exceeded the maximum size");
+                return;
+            }
+            state.response.body_.append(payload + offset, size);
+        }
+
+        // onData() may have cancelled the stream
+        it = streams_.find(stream);
+        if (it == std::end(streams_))
+        {
+            replenish(nullptr);
+            return;
+        }
+
+        const bool end = (flags & Flag::EndStream) != 0;
+        replenish(end ? nullptr : &it->second);
+        if (end)
+            endStream(it);
+    }
+
+    void ClientSession::handleHeaderBlock()
+    {
+        const auto id    = headerStream_;
+        const auto flags = headerFlags_;
+        headerStream_    = 0;
+
+        if (isIdle(id))
+            throw ConnectionError { ErrorCode::ProtocolError, "HEADERS on an idle stream" };
+
+        // Decoded even when the stream has been cancelled, the table has to
+        // follow the one of the encoder
+        std::vector<Hpack::HeaderField> fields;
+        try
+        {
+            fields = decoder_.decode(headerBlock_.data(), headerBlock_.size(), maxResponseSize_);
+        }
+        catch (const Hpack::HeaderListTooLarge&)
+        {
+            throw ConnectionError { ErrorCode::EnhanceYourCalm, "Response head too large" };
+        }
+        catch (const Hpack::DecodeError&)
+        {
+            throw ConnectionError { ErrorCode::CompressionError, "Invalid header block" };
+        }
+        headerBlock_.clear();
+
+        auto it = streams_.find(id);
+        if (it == std::end(streams_))
+            return;
+
+        auto& state    = it->second;
+        const bool end = (flags & Flag::EndStream) != 0;
+
+        // Trailers, only the end of the response they mark matters
+        if (state.headReceived)
+        {
+            if (!end)
+                failStream(id, ErrorCode::ProtocolError, "Trailers without the end of the stream");
+            else
+                endStream(it);
+            return;
+        }
+
+        if (!buildResponse(state, fields))
+        {
+            failStream(id, ErrorCode::ProtocolError, "Malformed response head");
+            return;
+        }
+
+        // An informational head, 100 Continue or 103 Early Hints, comes
+        // before the one of the response
+        const auto code = static_cast<int>(state.response.code_);
+        if (code < 200)
+        {
+            state.response = Response();
+            if (end)
+                failStream(id, ErrorCode::ProtocolError, "Informational response ending the stream");
+            return;
+        }
+
+        state.headReceived = true;
+        state.streamed     = callbacks_.onHead && callbacks_.onHead(id, state.response);
+
+        if (end)
+        {
+            it = streams_.find(id);
+            if (it != std::end(streams_))
+                endStream(it);
+        }
+    }
+
+    bool ClientSession::buildResponse(Stream& stream, std::vector<Hpack::HeaderField>& fields)
+    {
+        auto& response    = stream.response;
+        response.version_ = Version::Http2;
+
+        std::string status;
+        bool regular = false;
+
+        for (auto& field : fields)
+        {
+            // The pseudo-header fields come first, :status is the only one
+            // of a response
+            if (!field.name.empty() && field.name.front() == ':')
+            {
+                if (regular || field.name != ":status" || !status.empty())
+                    return false;
+                status = std::move(field.value);
+                continue;
+            }
+
+            regular = true;
+            if (!isValidName(field.name) || isConnectionSpecific(field.name))
+                return false;
+
+            if (field.name == "set-cookie")
+            {
+                response.cookies_.add(Cookie::fromRaw(field.value.data(), field.value.size()));
+                continue;
+            }
+
+            addHeader(response, std::move(field.name), std::move(field.value), false);
+        }
+
+        if (status.size() != 3
+            || !std::all_of(status.begin(), status.end(),
+                            [](unsigned char c) { return std::isdigit(c); }))
+            return false;
+
+        response.code_ = static_cast<Code>(std::stoi(status));
+        return true;
+    }
+
+    void ClientSession::endStream(std::map<uint32_t, Stream>::iterator it)
+    {
+        const auto id = it->first;
+        auto response = std::move(it->second.response);
+
+        // The server answered before the whole body of the request was sent,
+        // the rest of it is not needed anymore
+        if (!it->second.ended)
+            writeFrame(FrameType::RstStream, 0, id, std::string_view("\0\0\0\0", 4));
+        streams_.erase(it);
+
+        callbacks_.onResponse(id, std::move(response));
+    }
+
+    void ClientSession::failStream(uint32_t stream, ErrorCode code, const char* reason)
+    {
+        auto it = streams_.find(stream);
+        if (it == std::end(streams_))
+            return;
+
+        cancel(stream, code);
+        callbacks_.onReset(stream, reason);
+    }
+
+    bool ClientSession::isIdle(uint32_t stream) const { return stream >= nextStreamId_; }
+
+    int64_t* ClientSession::streamWindow(uint32_t stream)
+    {
+        auto it = streams_.find(stream);
+        return it == std::end(streams_) ? nullptr : &it->second.sendWindow;
+    }
+
+    void ClientSession::applySetting(SettingId id, uint32_t value)
+    {
+        switch (id)
+        {
+        case SettingId::EnablePush:
+            // Only a client may enable it
+            if (value != 0)
+                throw ConnectionError { ErrorCode::ProtocolError, "Invalid SETTINGS_ENABLE_PUSH" };
+            break;
+        case SettingId::MaxConcurrentStreams:
+            peerMaxStreams_ = value;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void ClientSession::adjustWindows(int64_t delta)
+    {
+        for (auto& [id, state] : streams_)
+        {
+            state.sendWindow += delta;
+            if (state.sendWindow > MaxWindowSize)
+                throw ConnectionError { ErrorCode::FlowControlError, "Stream window overflow" };
+        }
+    }
+
+    void ClientSession::handleRstStream(uint32_t stream, const char* payload, size_t length)
+    {
+        if (stream == 0)
+            throw ConnectionError { ErrorCode::ProtocolError, "RST_STREAM on the connection" };
+        if (length != 4)
+            throw ConnectionError { ErrorCode::FrameSizeError, "Invalid RST_STREAM" };
+
+        auto it = streams_.find(stream);
+        if (it == std::end(streams_))
+        {
+            if (isIdle(stream))
+                throw ConnectionError { ErrorCode::ProtocolError, "RST_STREAM on an idle stream" };
+            return;
+        }
+
+        streams_.erase(it);
+
+        const auto code = static_cast<ErrorCode>(readUint32(payload));
+        callbacks_.onReset(stream, code == ErrorCode::RefusedStream
+                                       ? "Stream refused by the server"
+                                       : "Stream reset by the server");
+    }
+
+    void ClientSession::handleGoAway(const char* payload, size_t length)
+    {
+        if (length < 8)
+            throw ConnectionError { ErrorCode::FrameSizeError, "Invalid GOAWAY" };
+
+        goingAway_ = true;
+
+        // The streams past the last one have not been processed, their
+        // requests can be sent again on another connection
+        const auto last = readUint32(payload) & 0x7fffffff;
+        while (!streams_.empty() && streams_.rbegin()->first > last)
+        {
+            const auto id = streams_.rbegin()->first;
+            streams_.erase(id);
+            callbacks_.onReset(id, "Stream refused by the server, going away");
+        }
+    }
+
+    void ClientSession::replenish(Stream* stream)
+    {
+        // The connection is always given back its window, a paused stream
+        // holds no more than the window of its own stream
+        replenishWindow(0, recvWindow_, ConnectionWindow);
+        if (stream && !stream->paused)
+            replenishWindow(stream->id, stream->recvWindow, StreamWindow);
+    }
+
+    void ClientSession::pump()
+    {
+        // The streams in the order they were opened, the oldest requests
+        // are sent first
+        for (auto it = std::begin(streams_);
+             it != std::end(streams_) && !failed_ && output_.size() < MaxBuffered; ++it)
+        {
+            auto& state = it->second;
+            while (!state.ended && output_.size() < MaxBuffered)
+            {
+                const auto remaining = state.body.size() - state.sent;
+                const auto length    = static_cast<size_t>(
+                    std::min<int64_t>({ static_cast<int64_t>(remaining), peerMaxFrameSize_,
+                                        state.sendWindow, sendWindow_ }));
+                if (length == 0)
+                    break;
+
+                state.ended = length == remaining;
+                writeFrame(FrameType::Data, state.ended ? Flag::EndStream : 0, state.id,
+                           std::string_view(state.body).substr(state.sent, length));
+
+                state.sent += length;
+                state.sendWindow -= static_cast<int64_t>(length);
+                sendWindow_ -= static_cast<int64_t>(length);
+            }
+
+            if (state.ended)
+                std::string().swap(state.body);
+        }
+    }
+
+} // namespace Pistache::Http::Http2
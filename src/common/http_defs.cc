@@ -10,8 +10,10 @@
    Implementation of http definitions
 */
 
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <string_view>
 
 #include <pistache/common.h>
 #ifdef __GNUC__
@@ -31,6 +33,308 @@ namespace Pistache::Http
     {
         using time_point = FullDate::time_point;
 
+        /* The fixed formats of RFC 9110 5.6.7 are parsed and written by hand,
+         * without streams or locale. date::parse stays the path of the other
+         * forms it accepts, a day of a single digit for instance.
+         */
+
+        constexpr char DayNames[][10] = { "Sunday", "Monday", "Tuesday", "Wednesday",
+                                          "Thursday", "Friday", "Saturday" };
+        constexpr char MonthNames[][4] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                           "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+        struct Civil
+        {
+            int64_t year;
+            int month; // 1 to 12
+            int day;   // 1 to 31
+        };
+
+        // From Howard Hinnant's chrono-compatible low-level date algorithms
+        int64_t daysFromCivil(const Civil& civil)
+        {
+            const int64_t y   = civil.year - (civil.month <= 2);
+            const int64_t era = (y >= 0 ? y : y - 399) / 400;
+            const int64_t yoe = y - era * 400;
+            const int64_t doy = (153 * (civil.month + (civil.month > 2 ? -3 : 9)) + 2) / 5 + civil.day - 1;
+            const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+            return era * 146097 + doe - 719468;
+        }
+
+        Civil civilFromDays(int64_t days)
+        {
+            days += 719468;
+            const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+            const int64_t doe = days - era * 146097;
+            const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+            const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+            const int64_t mp  = (5 * doy + 2) / 153;
+
+            Civil civil;
+            civil.day   = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+            civil.month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+            civil.year  = yoe + era * 400 + (civil.month <= 2);
+            return civil;
+        }
+
+        // 0 for Sunday
+        int weekday(int64_t days)
+        {
+            return static_cast<int>(days >= -4 ? (days + 4) % 7 : (days + 5) % 7 + 6);
+        }
+
+        int daysInMonth(int64_t year, int month)
+        {
+            static constexpr int Days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+            const bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+            return month == 2 && leap ? 29 : Days[month - 1];
+        }
+
+        class FixedScanner
+        {
+        public:
+            explicit FixedScanner(std::string_view text)
+                : text_(text)
+            { }
+
+            bool literal(std::string_view expected)
+            {
+                if (text_.substr(pos_, expected.size()) != expected)
+                    return false;
+                pos_ += expected.size();
+                return true;
+            }
+
+            bool digits(size_t count, int& value)
+            {
+                if (pos_ + count > text_.size())
+                    return false;
+                value = 0;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const char c = text_[pos_ + i];
+                    if (c < '0' || c > '9')
+                        return false;
+                    value = value * 10 + (c - '0');
+                }
+                pos_ += count;
+                return true;
+            }
+
+            // A name of the table, matched on its first letters
+            bool name(const char (*names)[4], size_t count, int& index)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    if (literal(std::string_view(names[i], 3)))
+                    {
+                        index = static_cast<int>(i);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            bool dayName(bool full, int& day)
+            {
+                for (int i = 0; i < 7; ++i)
+                {
+                    const std::string_view name(DayNames[i]);
+                    if (literal(full ? name : name.substr(0, 3)))
+                    {
+                        day = i;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            bool done() const { return pos_ == text_.size(); }
+
+        private:
+            std::string_view text_;
+            size_t pos_ = 0;
+        };
+
+        bool time(FixedScanner& scanner, int& hours, int& minutes, int& seconds)
+        {
+            return scanner.digits(2, hours) && scanner.literal(":") && scanner.digits(2, minutes)
+                && scanner.literal(":") && scanner.digits(2, seconds) && hours < 24 && minutes < 60
+                && seconds < 60;
+        }
+
+        bool toTimePoint(int dayName, const Civil& civil, int hours, int minutes, int seconds,
+                         time_point& tp)
+        {
+            if (civil.month < 1 || civil.month > 12 || civil.day < 1
+                || civil.day > daysInMonth(civil.year, civil.month))
+                return false;
+
+            const auto days = daysFromCivil(civil);
+            if (weekday(days) != dayName)
+                return false;
+
+            tp = time_point(std::chrono::seconds(days * 86400 + hours * 3600 + minutes * 60 + seconds));
+            return true;
+        }
+
+        // "Sun, 06 Nov 1994 08:49:37 GMT"
+        bool parseFixedRFC1123(std::string_view s, time_point& tp)
+        {
+            FixedScanner scanner(s);
+            int dayName, day, month, year, hours, minutes, seconds;
+            if (!scanner.dayName(false, dayName) || !scanner.literal(", ") || !scanner.digits(2, day)
+                || !scanner.literal(" ") || !scanner.name(MonthNames, 12, month) || !scanner.literal(" ")
+                || !scanner.digits(4, year) || !scanner.literal(" ") || !time(scanner, hours, minutes, seconds)
+                || !(scanner.literal(" GMT") || scanner.literal(" UTC")) || !scanner.done())
+                return false;
+
+            return toTimePoint(dayName, { year, month + 1, day }, hours, minutes, seconds, tp);
+        }
+
+        // "Sunday, 06-Nov-94 08:49:37 GMT"
+        bool parseFixedRFC850(std::string_view s, time_point& tp)
+        {
+            FixedScanner scanner(s);
+            int dayName, day, month, year, hours, minutes, seconds;
+            if (!scanner.dayName(true, dayName) || !scanner.literal(", ") || !scanner.digits(2, day)
+                || !scanner.literal("-") || !scanner.name(MonthNames, 12, month) || !scanner.literal("-")
+                || !scanner.digits(2, year) || !scanner.literal(" ") || !time(scanner, hours, minutes, seconds)
+                || !scanner.literal(" GMT") || !scanner.done())
+                return false;
+
+            // As %y of date::parse
+            year += year < 69 ? 2000 : 1900;
+            return toTimePoint(dayName, { year, month + 1, day }, hours, minutes, seconds, tp);
+        }
+
+        // "Sun Nov  6 08:49:37 1994"
+        bool parseFixedAsctime(std::string_view s, time_point& tp)
+        {
+            FixedScanner scanner(s);
+            int dayName, day, month, year, hours, minutes, seconds;
+            if (!scanner.dayName(false, dayName) || !scanner.literal(" ")
+                || !scanner.name(MonthNames, 12, month) || !scanner.literal(" "))
+                return false;
+            if (!(scanner.literal(" ") ? scanner.digits(1, day) : scanner.digits(2, day)))
+                return false;
+            if (!scanner.literal(" ") || !time(scanner, hours, minutes, seconds) || !scanner.literal(" ")
+                || !scanner.digits(4, year) || !scanner.done())
+                return false;
+
+            return toTimePoint(dayName, { year, month + 1, day }, hours, minutes, seconds, tp);
+        }
+
+        // Of the seconds written by %T, as many as the precision of the clock
+        constexpr size_t fractionDigits()
+        {
+            size_t digits = 0;
+            for (auto den = time_point::period::den; den > 1; den /= 10)
+                ++digits;
+            return digits;
+        }
+
+        constexpr int64_t powerOf10(size_t exponent)
+        {
+            return exponent == 0 ? 1 : 10 * powerOf10(exponent - 1);
+        }
+
+        char* writeDigits(char* out, int64_t value, size_t count)
+        {
+            for (size_t i = count; i > 0; --i)
+            {
+                out[i - 1] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            }
+            return out + count;
+        }
+
+        char* writeText(char* out, std::string_view text)
+        {
+            for (char c : text)
+                *out++ = c;
+            return out;
+        }
+
+        // The output of date::to_stream for the formats of FullDate::write,
+        // false for the years it writes otherwise
+        bool writeFixed(std::ostream& os, FullDate::Type type, time_point date)
+        {
+            using namespace std::chrono;
+            constexpr size_t Digits = fractionDigits();
+            if (time_point::period::num != 1 || powerOf10(Digits) != time_point::period::den
+                || Digits > 9)
+                return false;
+
+            const auto days = floor<duration<int64_t, std::ratio<86400>>>(date);
+            const auto civil = civilFromDays(days.time_since_epoch().count());
+            if (civil.year < 0 || civil.year > 9999)
+                return false;
+
+            const auto inDay = duration_cast<nanoseconds>(date - days).count();
+            const auto secs  = inDay / 1000000000;
+
+            char buffer[64];
+            char* out     = buffer;
+            auto timeOfDay = [&] {
+                out    = writeDigits(out, secs / 3600, 2);
+                *out++ = ':';
+                out    = writeDigits(out, secs / 60 % 60, 2);
+                *out++ = ':';
+                out    = writeDigits(out, secs % 60, 2);
+                if (Digits == 0)
+                    return;
+                *out++ = '.';
+                out    = writeDigits(out, inDay % 1000000000 / powerOf10(9 - Digits), Digits);
+            };
+            const std::string_view dayName(DayNames[weekday(days.time_since_epoch().count())], 3);
+            const std::string_view month(MonthNames[civil.month - 1], 3);
+
+            switch (type)
+            {
+            case FullDate::Type::RFC1123:
+                out    = writeText(out, dayName);
+                out    = writeText(out, ", ");
+                out    = writeDigits(out, civil.day, 2);
+                *out++ = ' ';
+                out    = writeText(out, month);
+                *out++ = ' ';
+                out    = writeDigits(out, civil.year, 4);
+                *out++ = ' ';
+                timeOfDay();
+                out = writeText(out, " UTC");
+                break;
+            case FullDate::Type::RFC850:
+                out    = writeText(out, dayName);
+                out    = writeText(out, ", ");
+                out    = writeDigits(out, civil.day, 2);
+                *out++ = '-';
+                out    = writeText(out, month);
+                *out++ = '-';
+                out    = writeDigits(out, civil.year % 100, 2);
+                *out++ = ' ';
+                timeOfDay();
+                out = writeText(out, " UTC");
+                break;
+            case FullDate::Type::AscTime:
+                out    = writeText(out, dayName);
+                *out++ = ' ';
+                out    = writeText(out, month);
+                *out++ = ' ';
+                out    = writeDigits(out, civil.day, 2);
+                *out++ = ' ';
+                timeOfDay();
+                *out++ = ' ';
+                out    = writeDigits(out, civil.year, 4);
+                break;
+            default:
+                return false;
+            }
+
+            os.write(buffer, out - buffer);
+            return true;
+        }
+
         bool parse_RFC_1123(const std::string& s, time_point& tp)
         {
             std::istringstream in { s };
@@ -111,6 +415,9 @@ namespace Pistache::Http
     {
 
         FullDate::time_point tp;
+        if (parseFixedRFC1123(str, tp) || parseFixedRFC850(str, tp) || parseFixedAsctime(str, tp))
+            return FullDate(tp);
+
         if (parse_RFC_1123(str, tp))
             return FullDate(tp);
         else if (parse_RFC_850(str, tp))
@@ -123,6 +430,9 @@ namespace Pistache::Http
 
     void FullDate::write(std::ostream& os, Type type) const
     {
+        if (writeFixed(os, type, date_))
+            return;
+
         switch (type)
         {
         case Type::RFC1123:
@@ -147,6 +457,8 @@ namespace Pistache::Http
             return "HTTP/1.0";
         case Version::Http11:
             return "HTTP/1.1";
+        case Version::Http2:
+            return "HTTP/2";
         }
 
         unreachable();
@@ -11,17 +11,24 @@
 */
 
 #include <pistache/base64.h>
+#include <pistache/clock.h>
 #include <pistache/common.h>
 #include <pistache/config.h>
 #include <pistache/http.h>
 #include <pistache/http_header.h>
 #include <pistache/stream.h>
 
+#include <date/date.h>
+
+#include <charconv>
 #include <cstring>
 #include <iostream>
 #include <iterator>
 #include <limits>
 #include <stdexcept>
+#include <string_view>
+
+#include "string_utils.h"
 
 namespace Pistache::Http::Header
 {
@@ -54,6 +61,10 @@ namespace Pistache::Http::Header
             return "identity";
         case Encoding::Chunked:
             return "chunked";
+        case Encoding::Br:
+            return "br";
+        case Encoding::Zstd:
+            return "zstd";
         case Encoding::Unknown:
             return "unknown";
         }
@@ -279,6 +290,22 @@ namespace Pistache::Http::Header
 
     void Connection::parseRaw(const char* str, size_t len)
     {
+        // An upgrade is usually asked along with keep-alive, the upgrade
+        // token wins wherever it is in the list
+        std::string_view options(str, len);
+        while (!options.empty())
+        {
+            auto end    = options.find(',');
+            auto option = Private::trim(options.substr(0, end));
+            options     = end == std::string_view::npos ? std::string_view() : options.substr(end + 1);
+
+            if (option.size() == 7 && strncasecmp(option.data(), "upgrade", 7) == 0)
+            {
+                control_ = ConnectionControl::Upgrade;
+                return;
+            }
+        }
+
         char* p = const_cast<char*>(str);
         RawStreamBuf<> buf(p, p + len);
         StreamCursor cursor(&buf);
@@ -307,6 +334,9 @@ namespace Pistache::Http::Header
         case ConnectionControl::KeepAlive:
             os << "Keep-Alive";
             break;
+        case ConnectionControl::Upgrade:
+            os << "Upgrade";
+            break;
         case ConnectionControl::Ext:
             os << "Ext";
             break;
@@ -380,6 +410,25 @@ namespace Pistache::Http::Header
         return true;
     }
 
+    namespace
+    {
+        // Decode the credentials following the basic method straight into the
+        //  string returned...
+        std::string decodeBasicCredentials(std::string_view Value)
+        {
+            Value.remove_prefix(std::string_view("Basic ").length());
+
+            std::string DecodedCredentials(Base64Decoder::MaxDecodedSize(Value.size()), '\0');
+            const auto DecodedSize = Base64Decoder::DecodeInto(
+                Value, reinterpret_cast<std::byte*>(DecodedCredentials.data()));
+            if (!DecodedSize)
+                throw std::runtime_error("Authorization header credentials are not base 64.");
+
+            DecodedCredentials.resize(*DecodedSize);
+            return DecodedCredentials;
+        }
+    } // namespace
+
     // Get decoded user ID if basic method was used...
     std::string Authorization::getBasicUser() const
     {
@@ -387,18 +436,8 @@ namespace Pistache::Http::Header
         if (!hasMethod<Authorization::Method::Basic>())
             throw std::runtime_error("Authorization header does not use Basic method.");
 
-        // Extract encoded credentials...
-        const std::string EncodedCredentials(
-            value_.begin() + std::string("Basic ").length(), value_.end());
-
-        // Decode them...
-        Base64Decoder Decoder(EncodedCredentials);
-        const std::vector<std::byte>& BinaryDecodedCredentials = Decoder.Decode();
-
-        // Transform to string...
-        std::string DecodedCredentials;
-        for (std::byte CurrentByte : BinaryDecodedCredentials)
-            DecodedCredentials.push_back(static_cast<char>(CurrentByte));
+        // Decode credentials...
+        const std::string DecodedCredentials = decodeBasicCredentials(value_);
 
         // Find user ID and password delimiter...
         const auto Delimiter = DecodedCredentials.find_first_of(':');
@@ -419,18 +458,8 @@ namespace Pistache::Http::Header
         if (!hasMethod<Authorization::Method::Basic>())
             throw std::runtime_error("Authorization header does not use Basic method.");
 
-        // Extract encoded credentials...
-        const std::string EncodedCredentials(
-            value_.begin() + std::string("Basic ").length(), value_.end());
-
-        // Decode them...
-        Base64Decoder Decoder(EncodedCredentials);
-        const std::vector<std::byte>& BinaryDecodedCredentials = Decoder.Decode();
-
-        // Transform to string...
-        std::string DecodedCredentials;
-        for (std::byte CurrentByte : BinaryDecodedCredentials)
-            DecodedCredentials.push_back(static_cast<char>(CurrentByte));
+        // Decode credentials...
+        const std::string DecodedCredentials = decodeBasicCredentials(value_);
 
         // Find user ID and password delimiter...
         const auto Delimiter = DecodedCredentials.find_first_of(':');
@@ -467,15 +496,47 @@ namespace Pistache::Http::Header
     void Authorization::write(std::ostream& os) const { os << value_; }
 
     void Date::parse(const std::string& str)
+    {
+        fullDate_ = FullDate::fromString(str);
+        current_  = false;
+    }
+
+    void Date::write(std::ostream& os) const
+    {
+        if (current_)
+            os << CachedClock::httpDate();
+        else
+            fullDate_.write(os);
+    }
+
+    FullDate Date::fullDate() const
+    {
+        if (current_)
+            return FullDate(std::chrono::system_clock::now());
+        return fullDate_;
+    }
+
+    void ETag::parse(const std::string& data) { tag_ = data; }
+
+    void ETag::write(std::ostream& os) const { os << tag_; }
+
+    void LastModified::parse(const std::string& str)
     {
         fullDate_ = FullDate::fromString(str);
     }
 
-    void Date::write(std::ostream& os) const { fullDate_.write(os); }
+    // Sent as an IMF-fixdate (RFC 9110 5.6.7), the only form a condition on
+    // it can be compared to exactly
+    void LastModified::write(std::ostream& os) const
+    {
+        date::to_stream(os, "%a, %d %b %Y %T GMT",
+                        date::floor<std::chrono::seconds>(fullDate_.date()));
+    }
 
-    void Expect::parseRaw(const char* str, size_t /*len*/)
+    void Expect::parseRaw(const char* str, size_t len)
     {
-        if (std::strcmp(str, "100-continue") == 0)
+        // The value is not terminated, and its token is case-insensitive
+        if (len == 12 && strncasecmp(str, "100-continue", len) == 0)
         {
             expectation_ = Expectation::Continue;
         }
@@ -539,6 +600,75 @@ namespace Pistache::Http::Header
 
     void UserAgent::write(std::ostream& os) const { os << ua_; }
 
+    void Vary::parse(const std::string& data) { fields_ = data; }
+
+    void Vary::write(std::ostream& os) const { os << fields_; }
+
+    void AcceptRanges::parse(const std::string& data) { unit_ = data; }
+
+    void AcceptRanges::write(std::ostream& os) const { os << unit_; }
+
+    ContentRange ContentRange::unsatisfied(size_t length)
+    {
+        ContentRange range;
+        range.length_ = length;
+        return range;
+    }
+
+    void ContentRange::parse(const std::string& data)
+    {
+        static constexpr std::string_view Unit = "bytes ";
+
+        std::string_view value(data);
+        if (value.substr(0, Unit.size()) != Unit)
+            throw std::runtime_error("Invalid Content-Range header: unknown unit");
+        value.remove_prefix(Unit.size());
+
+        auto number = [](std::string_view digits) {
+            size_t result  = 0;
+            auto end       = digits.data() + digits.size();
+            auto [ptr, ec] = std::from_chars(digits.data(), end, result);
+            if (digits.empty() || ec != std::errc() || ptr != end)
+                throw std::runtime_error("Invalid Content-Range header: invalid number");
+            return result;
+        };
+
+        const auto slash = value.find('/');
+        if (slash == std::string_view::npos)
+            throw std::runtime_error("Invalid Content-Range header: missing length");
+
+        const auto range = value.substr(0, slash);
+        length_          = number(value.substr(slash + 1));
+
+        if (range == "*")
+        {
+            satisfied_ = false;
+            first_     = 0;
+            last_      = 0;
+            return;
+        }
+
+        const auto dash = range.find('-');
+        if (dash == std::string_view::npos)
+            throw std::runtime_error("Invalid Content-Range header: missing range");
+
+        first_     = number(range.substr(0, dash));
+        last_      = number(range.substr(dash + 1));
+        satisfied_ = true;
+        if (last_ < first_)
+            throw std::runtime_error("Invalid Content-Range header: empty range");
+    }
+
+    void ContentRange::write(std::ostream& os) const
+    {
+        os << "bytes ";
+        if (satisfied_)
+            os << first_ << '-' << last_;
+        else
+            os << '*';
+        os << '/' << length_;
+    }
+
     void Accept::parseRaw(const char* str, size_t len)
     {
 
@@ -614,6 +744,14 @@ namespace Pistache::Http::Header
         {
             encoding_ = Encoding::Chunked;
         }
+        else if (!strncasecmp(str, "br", len))
+        {
+            encoding_ = Encoding::Br;
+        }
+        else if (!strncasecmp(str, "zstd", len))
+        {
+            encoding_ = Encoding::Zstd;
+        }
         else
         {
             encoding_ = Encoding::Unknown;
@@ -12,34 +12,21 @@
 
 #include <pistache/http_headers.h>
 
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <unordered_map>
 #include <vector>
 
+#include "striped_lock.h"
+
 namespace Pistache::Http::Header
 {
 
-    RegisterHeader(Accept);
-    RegisterHeader(AccessControlAllowOrigin);
-    RegisterHeader(AccessControlAllowHeaders);
-    RegisterHeader(AccessControlExposeHeaders);
-    RegisterHeader(AccessControlAllowMethods);
-    RegisterHeader(Allow);
-    RegisterHeader(CacheControl);
-    RegisterHeader(Connection);
-    RegisterHeader(ContentEncoding);
-    RegisterHeader(TransferEncoding);
-    RegisterHeader(ContentLength);
-    RegisterHeader(ContentType);
-    RegisterHeader(Authorization);
-    RegisterHeader(Date);
-    RegisterHeader(Expect);
-    RegisterHeader(Host);
-    RegisterHeader(Location);
-    RegisterHeader(Server);
-    RegisterHeader(UserAgent);
-
     std::string toLowercase(std::string str)
     {
         std::transform(str.begin(), str.end(), str.begin(), ::tolower);
@@ -54,6 +41,113 @@ namespace Pistache::Http::Header
             [](const char& a, const char& b) { return std::tolower(a) == b; });
     }
 
+    namespace
+    {
+        // The typed headers of the library are created through a table that
+        // is indexed by their slot, the map of the Registry only holds the
+        // headers registered by the user
+        using BuiltinFactory = std::unique_ptr<Header> (*)();
+
+        constexpr uint32_t bitOf(size_t slot) { return uint32_t(1) << slot; }
+
+        template <typename H>
+        std::unique_ptr<Header> makeBuiltin()
+        {
+            return std::make_unique<H>();
+        }
+
+        template <typename... H>
+        constexpr std::array<BuiltinFactory, detail::KnownHeadersCount> builtinFactories()
+        {
+            std::array<BuiltinFactory, detail::KnownHeadersCount> factories {};
+            ((factories[detail::knownSlot(H::Name)] = &makeBuiltin<H>), ...);
+            return factories;
+        }
+
+        constexpr auto BuiltinFactories = builtinFactories<
+            Accept, AccessControlAllowOrigin, AccessControlAllowHeaders,
+            AccessControlExposeHeaders, AccessControlAllowMethods, Allow,
+            Authorization, CacheControl, Connection, ContentEncoding,
+            ContentLength, ContentType, Date, Expect, Host, Location, Server,
+            TransferEncoding, UserAgent>();
+
+        constexpr bool allBuiltinsHaveAFactory()
+        {
+            for (auto factory : BuiltinFactories)
+            {
+                if (factory == nullptr)
+                    return false;
+            }
+            return true;
+        }
+
+        static_assert(allBuiltinsHaveAFactory(),
+                      "Every known header needs a typed header to create");
+
+        // Perfect hash of the lowercased names of the known headers, the seed
+        // is searched for at compile time
+        constexpr char lowerAscii(char c)
+        {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        constexpr uint32_t hashLowercase(std::string_view name, uint32_t seed)
+        {
+            uint32_t hash = 2166136261u ^ seed;
+            for (char c : name)
+            {
+                hash ^= static_cast<unsigned char>(lowerAscii(c));
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+        constexpr size_t SlotTableSize = 64;
+        static_assert(detail::KnownHeadersCount * 2 <= SlotTableSize,
+                      "The table of known headers is too small");
+
+        constexpr size_t tableIndex(std::string_view name, uint32_t seed)
+        {
+            return hashLowercase(name, seed) & (SlotTableSize - 1);
+        }
+
+        constexpr bool isPerfectSeed(uint32_t seed)
+        {
+            std::array<bool, SlotTableSize> used {};
+            for (auto name : detail::KnownHeaders)
+            {
+                const auto index = tableIndex(name, seed);
+                if (used[index])
+                    return false;
+                used[index] = true;
+            }
+            return true;
+        }
+
+        constexpr uint32_t findPerfectSeed()
+        {
+            uint32_t seed = 0;
+            while (!isPerfectSeed(seed))
+                ++seed;
+            return seed;
+        }
+
+        constexpr uint32_t SlotSeed = findPerfectSeed();
+
+        constexpr std::array<uint8_t, SlotTableSize> makeSlotTable()
+        {
+            std::array<uint8_t, SlotTableSize> table {};
+            for (auto& slot : table)
+                slot = static_cast<uint8_t>(detail::KnownHeadersCount);
+
+            for (size_t i = 0; i < detail::KnownHeadersCount; ++i)
+                table[tableIndex(detail::KnownHeaders[i], SlotSeed)] = static_cast<uint8_t>(i);
+            return table;
+        }
+
+        constexpr auto SlotTable = makeSlotTable();
+    } // namespace
+
     Registry& Registry::instance()
     {
         static Registry instance;
@@ -68,6 +162,11 @@ namespace Pistache::Http::Header
     void Registry::registerHeader(const std::string& name,
                                   Registry::RegistryFunc func)
     {
+        if (detail::knownSlotIgnoreCase(name) < detail::KnownHeadersCount)
+        {
+            throw std::runtime_error("Header already registered");
+        }
+
         auto it = registry.find(name);
         if (it != std::end(registry))
         {
@@ -80,7 +179,12 @@ namespace Pistache::Http::Header
     std::vector<std::string> Registry::headersList()
     {
         std::vector<std::string> names;
-        names.reserve(registry.size());
+        names.reserve(detail::KnownHeadersCount + registry.size());
+
+        for (auto name : detail::KnownHeaders)
+        {
+            names.emplace_back(name);
+        }
 
         for (const auto& header : registry)
         {
@@ -92,6 +196,12 @@ namespace Pistache::Http::Header
 
     std::unique_ptr<Header> Registry::makeHeader(const std::string& name)
     {
+        const auto slot = detail::knownSlotIgnoreCase(name);
+        if (slot < detail::KnownHeadersCount)
+        {
+            return BuiltinFactories[slot]();
+        }
+
         auto it = registry.find(name);
         if (it == std::end(registry))
         {
@@ -103,43 +213,153 @@ namespace Pistache::Http::Header
 
     bool Registry::isRegistered(const std::string& name)
     {
+        if (detail::knownSlotIgnoreCase(name) < detail::KnownHeadersCount)
+            return true;
+
         auto it = registry.find(name);
         return it != std::end(registry);
     }
 
+    namespace
+    {
+        bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs)
+        {
+            return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                              [](char a, char b) {
+                                  return std::tolower(static_cast<unsigned char>(a))
+                                      == std::tolower(static_cast<unsigned char>(b));
+                              });
+        }
+    } // namespace
+
+    size_t detail::knownSlotIgnoreCase(std::string_view name)
+    {
+        const size_t slot = SlotTable[tableIndex(name, SlotSeed)];
+        if (slot < KnownHeadersCount && equalsIgnoreCase(KnownHeaders[slot], name))
+            return slot;
+
+        return KnownHeadersCount;
+    }
+
+    RawList::const_iterator RawList::find(std::string_view name) const
+    {
+        return std::find_if(entries_.begin(), entries_.end(), [name](const value_type& entry) {
+            return equalsIgnoreCase(entry.first, name);
+        });
+    }
+
+    bool RawList::insert(const Raw& raw)
+    {
+        auto name = raw.name();
+        if (find(name) != end())
+            return false;
+
+        entries_.emplace_back(std::move(name), raw);
+        return true;
+    }
+
+    bool RawList::erase(std::string_view name)
+    {
+        auto it = find(name);
+        if (it == end())
+            return false;
+
+        entries_.erase(it);
+        return true;
+    }
+
+    Collection::Collection(const Collection& other)
+        : known_()
+        , deferred_(0)
+    {
+        *this = other;
+    }
+
+    Collection::Collection(Collection&& other) noexcept
+        : known_(std::move(other.known_))
+        , deferred_(other.deferred_.exchange(0, std::memory_order_relaxed))
+        , others_(std::move(other.others_))
+        , rawHeaders(std::move(other.rawHeaders))
+    { }
+
+    Collection& Collection::operator=(const Collection& other)
+    {
+        if (this == &other)
+            return *this;
+
+        // Taken along with their bits, a slot of the other collection may be
+        // parsed meanwhile
+        std::lock_guard<std::mutex> guard(Private::stripedLock(&other));
+        known_ = other.known_;
+        deferred_.store(other.deferred_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        others_    = other.others_;
+        rawHeaders = other.rawHeaders;
+        return *this;
+    }
+
+    Collection& Collection::operator=(Collection&& other) noexcept
+    {
+        known_ = std::move(other.known_);
+        deferred_.store(other.deferred_.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        others_    = std::move(other.others_);
+        rawHeaders = std::move(other.rawHeaders);
+        return *this;
+    }
+
     Collection& Collection::add(const std::shared_ptr<Header>& header)
     {
-        headers.insert(std::make_pair(header->name(), header));
+        const auto slot = detail::knownSlotIgnoreCase(header->name());
+        if (slot < detail::KnownHeadersCount)
+        {
+            if (!known_[slot] && !isDeferred(slot))
+                known_[slot] = header;
+        }
+        else if (!getImpl(header->name()))
+        {
+            others_.push_back(header);
+        }
 
         return *this;
     }
 
     Collection& Collection::addRaw(const Raw& raw)
     {
-        rawHeaders.insert(std::make_pair(raw.name(), raw));
+        rawHeaders.insert(raw);
+        return *this;
+    }
+
+    Collection& Collection::addDeferred(const Raw& raw)
+    {
+        if (!rawHeaders.insert(raw))
+            return *this;
+
+        const auto slot = detail::knownSlotIgnoreCase(raw.name());
+        if (slot < detail::KnownHeadersCount && !known_[slot])
+            deferred_.fetch_or(bitOf(slot), std::memory_order_relaxed);
+
         return *this;
     }
 
     std::shared_ptr<const Header> Collection::get(const std::string& name) const
     {
         auto header = getImpl(name);
-        if (!header.first)
+        if (!header)
         {
             throw std::runtime_error("Could not find header");
         }
 
-        return header.second;
+        return header;
     }
 
     std::shared_ptr<Header> Collection::get(const std::string& name)
     {
         auto header = getImpl(name);
-        if (!header.first)
+        if (!header)
         {
             throw std::runtime_error("Could not find header");
         }
 
-        return header.second;
+        return header;
     }
 
     Raw Collection::getRaw(const std::string& name) const
@@ -156,20 +376,12 @@ namespace Pistache::Http::Header
     std::shared_ptr<const Header>
     Collection::tryGet(const std::string& name) const
     {
-        auto header = getImpl(name);
-        if (!header.first)
-            return nullptr;
-
-        return header.second;
+        return getImpl(name);
     }
 
     std::shared_ptr<Header> Collection::tryGet(const std::string& name)
     {
-        auto header = getImpl(name);
-        if (!header.first)
-            return nullptr;
-
-        return header.second;
+        return getImpl(name);
     }
 
     std::optional<Raw> Collection::tryGetRaw(const std::string& name) const
@@ -185,53 +397,107 @@ namespace Pistache::Http::Header
 
     bool Collection::has(const std::string& name) const
     {
-        return getImpl(name).first;
+        const auto slot = detail::knownSlotIgnoreCase(name);
+        if (slot < detail::KnownHeadersCount && isDeferred(slot))
+            return true;
+
+        return getImpl(name) != nullptr;
     }
 
     std::vector<std::shared_ptr<Header>> Collection::list() const
     {
         std::vector<std::shared_ptr<Header>> ret;
-        ret.reserve(headers.size());
-        for (const auto& h : headers)
+        ret.reserve(known_.size() + others_.size());
+        for (size_t i = 0; i < known_.size(); ++i)
         {
-            ret.push_back(h.second);
+            if (auto header = slot(i))
+                ret.push_back(std::move(header));
         }
+        ret.insert(ret.end(), others_.begin(), others_.end());
 
         return ret;
     }
 
     bool Collection::remove(const std::string& name)
     {
-        auto tit = headers.find(name);
-        if (tit == std::end(headers))
+        const auto slot = detail::knownSlotIgnoreCase(name);
+        if (slot < detail::KnownHeadersCount && (known_[slot] || isDeferred(slot)))
         {
-            auto rit = rawHeaders.find(name);
-            if (rit == std::end(rawHeaders))
-                return false;
+            known_[slot].reset();
+            deferred_.fetch_and(~bitOf(slot), std::memory_order_relaxed);
+            return true;
+        }
 
-            rawHeaders.erase(rit);
+        auto it = std::find_if(others_.begin(), others_.end(), [&name](const auto& header) {
+            return equalsIgnoreCase(header->name(), name);
+        });
+        if (it != others_.end())
+        {
+            others_.erase(it);
             return true;
         }
-        headers.erase(tit);
-        return true;
+
+        return rawHeaders.erase(name);
     }
 
     void Collection::clear()
     {
-        headers.clear();
+        known_.fill(nullptr);
+        deferred_.store(0, std::memory_order_relaxed);
+        others_.clear();
         rawHeaders.clear();
     }
 
-    std::pair<bool, std::shared_ptr<Header>>
-    Collection::getImpl(const std::string& name) const
+    std::shared_ptr<Header> Collection::getImpl(std::string_view name) const
     {
-        auto it = headers.find(name);
-        if (it == std::end(headers))
+        const auto slot = detail::knownSlotIgnoreCase(name);
+        if (slot < detail::KnownHeadersCount)
+            return this->slot(slot);
+
+        for (const auto& header : others_)
         {
-            return std::make_pair(false, nullptr);
+            if (equalsIgnoreCase(header->name(), name))
+                return header;
         }
 
-        return std::make_pair(true, it->second);
+        return nullptr;
+    }
+
+    bool Collection::hasTyped(std::string_view name) const
+    {
+        const auto slot = detail::knownSlotIgnoreCase(name);
+        if (slot < detail::KnownHeadersCount)
+            return known_[slot] && !isDeferred(slot);
+
+        return getImpl(name) != nullptr;
+    }
+
+    std::shared_ptr<Header> Collection::materialize(size_t index) const
+    {
+        std::lock_guard<std::mutex> guard(Private::stripedLock(this));
+
+        // Parsed by another thread meanwhile
+        if (!isDeferred(index))
+            return known_[index];
+
+        const auto name = detail::KnownHeaders[index];
+
+        auto raw = rawHeaders.find(name);
+        if (raw == std::end(rawHeaders))
+        {
+            deferred_.fetch_and(~bitOf(index), std::memory_order_release);
+            return nullptr;
+        }
+
+        std::shared_ptr<Header> header = BuiltinFactories[index]();
+        const auto value               = raw->second.value();
+
+        // Stays deferred when the value does not parse, every access throws
+        header->parseRaw(value.data(), value.size());
+
+        known_[index] = std::move(header);
+        deferred_.fetch_and(~bitOf(index), std::memory_order_release);
+        return known_[index];
     }
 
 } // namespace Pistache::Http::Header
@@ -0,0 +1,344 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* multipart.cc
+
+   Incremental multipart/form-data parser
+*/
+
+#include <pistache/multipart.h>
+#include <pistache/stream.h>
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+#include "string_utils.h"
+
+namespace Pistache::Http::Multipart
+{
+
+    namespace
+    {
+        // Longest line allowed after a boundary, transport padding included
+        constexpr size_t MaxBoundaryLine = 256;
+
+        bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs)
+        {
+            return lhs.size() == rhs.size()
+                && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b) {
+                       return std::tolower(static_cast<unsigned char>(a))
+                           == std::tolower(static_cast<unsigned char>(b));
+                   });
+        }
+
+        // Parameters of a Content-Disposition, as in
+        // form-data; name="field"; filename="file.txt"
+        void parseDisposition(std::string_view value, Part& part)
+        {
+            auto semicolon = value.find(';');
+            while (semicolon != std::string_view::npos)
+            {
+                value.remove_prefix(semicolon + 1);
+
+                const auto equal = value.find('=');
+                if (equal == std::string_view::npos)
+                    return;
+                const auto key = Private::trim(value.substr(0, equal));
+                value          = Private::trim(value.substr(equal + 1));
+
+                std::string parameter;
+                if (!value.empty() && value.front() == '"')
+                {
+                    size_t i = 1;
+                    for (; i < value.size() && value[i] != '"'; ++i)
+                    {
+                        if (value[i] == '\\' && i + 1 < value.size())
+                            ++i;
+                        parameter.push_back(value[i]);
+                    }
+                    value.remove_prefix(std::min(i + 1, value.size()));
+                }
+                else
+                {
+                    const auto end = value.find(';');
+                    parameter      = std::string(Private::trim(value.substr(0, end)));
+                    value.remove_prefix(end == std::string_view::npos ? value.size() : end);
+                }
+
+                if (equalsIgnoreCase(key, "name"))
+                    part.name = std::move(parameter);
+                else if (equalsIgnoreCase(key, "filename"))
+                    part.filename = std::move(parameter);
+
+                semicolon = value.find(';');
+            }
+        }
+    } // namespace
+
+    void Handler::onPart(const Part& /*part*/) { }
+
+    void Handler::onPartEnd(const Part& /*part*/) { }
+
+    void Handler::onEnd() { }
+
+    void Handler::onError(const std::string& /*reason*/) { }
+
+    Parser::Parser(std::string_view boundary, Handler& handler)
+        : delimiter_("\r\n--")
+        , handler_(handler)
+        // The first boundary may open the body, as if a line ended before it
+        , held_("\r\n")
+    {
+        if (boundary.empty() || boundary.size() > MaxBoundarySize
+            || boundary.find_first_of("\r\n") != std::string_view::npos)
+            throw HttpError(Code::Bad_Request, "Invalid multipart boundary");
+
+        delimiter_.append(boundary);
+    }
+
+    std::optional<std::string> Parser::boundary(const Request& request)
+    {
+        auto contentType = request.headers().tryGet<Header::ContentType>();
+        if (!contentType)
+            return std::nullopt;
+
+        const auto& mime = contentType->mime();
+        if (mime.top() != Mime::Type::Multipart || mime.sub() != Mime::Subtype::FormData)
+            return std::nullopt;
+
+        auto boundary = mime.getParam("boundary");
+        if (boundary && boundary->size() >= 2 && boundary->front() == '"' && boundary->back() == '"')
+            *boundary = boundary->substr(1, boundary->size() - 2);
+        return boundary;
+    }
+
+    void Parser::feed(std::string_view data)
+    {
+        while (!data.empty())
+        {
+            size_t used = 0;
+            switch (step_)
+            {
+            case Step::Preamble:
+            case Step::Content:
+            {
+                bool found = false;
+                used       = scan(data, found);
+                if (found)
+                {
+                    if (step_ == Step::Content)
+                        handler_.onPartEnd(part_);
+                    step_ = Step::BoundaryLine;
+                }
+                break;
+            }
+            case Step::BoundaryLine:
+                used = readBoundaryLine(data);
+                break;
+            case Step::Headers:
+                used = readHeaders(data);
+                break;
+            case Step::Epilogue:
+                return;
+            }
+            data.remove_prefix(used);
+        }
+    }
+
+    size_t Parser::scan(std::string_view data, bool& found)
+    {
+        const std::string_view delimiter(delimiter_);
+
+        if (!held_.empty())
+        {
+            const size_t need  = delimiter.size() - held_.size();
+            const size_t bytes = std::min(need, data.size());
+            if (data.substr(0, bytes) == delimiter.substr(held_.size(), bytes))
+            {
+                if (bytes < need)
+                {
+                    held_.append(data);
+                    return bytes;
+                }
+                held_.clear();
+                found = true;
+                return bytes;
+            }
+
+            // Not the delimiter after all. The boundary has no CR, so none
+            // starts past the first byte of what was held
+            std::string held;
+            held.swap(held_);
+            emit(held);
+        }
+
+        const auto pos = data.find(delimiter);
+        if (pos != std::string_view::npos)
+        {
+            emit(data.substr(0, pos));
+            found = true;
+            return pos + delimiter.size();
+        }
+
+        // The end of the piece may start the delimiter, it waits for the next
+        size_t keep     = 0;
+        const auto from = data.size() >= delimiter.size() ? data.size() - delimiter.size() + 1 : 0;
+        for (auto cr = data.find('\r', from); cr != std::string_view::npos; cr = data.find('\r', cr + 1))
+        {
+            if (delimiter.substr(0, data.size() - cr) == data.substr(cr))
+            {
+                keep = data.size() - cr;
+                break;
+            }
+        }
+
+        emit(data.substr(0, data.size() - keep));
+        held_.assign(data.substr(data.size() - keep));
+        return data.size();
+    }
+
+    void Parser::emit(std::string_view data)
+    {
+        // The preamble is dropped
+        if (step_ == Step::Content && !data.empty())
+            handler_.onData(part_, data);
+    }
+
+    size_t Parser::readBoundaryLine(std::string_view data)
+    {
+        const auto eol   = data.find('\n');
+        const size_t end = eol == std::string_view::npos ? data.size() : eol + 1;
+        line_.append(data.substr(0, end));
+
+        // The closing delimiter, the body may well end right after it
+        if (line_.size() >= 2 && line_.compare(0, 2, "--") == 0)
+        {
+            line_.clear();
+            step_ = Step::Epilogue;
+            handler_.onEnd();
+            return data.size();
+        }
+
+        if (line_.size() > MaxBoundaryLine)
+            throw HttpError(Code::Bad_Request, "Invalid multipart boundary line");
+        if (eol == std::string_view::npos)
+            return end;
+
+        // Only transport padding may follow the boundary
+        std::string_view line(line_);
+        line.remove_suffix(1);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (!Private::trim(line).empty())
+            throw HttpError(Code::Bad_Request, "Invalid multipart boundary line");
+
+        line_.clear();
+        part_ = Part();
+        step_ = Step::Headers;
+        return end;
+    }
+
+    size_t Parser::readHeaders(std::string_view data)
+    {
+        size_t used = 0;
+        while (used < data.size())
+        {
+            const auto eol   = data.find('\n', used);
+            const size_t end = eol == std::string_view::npos ? data.size() : eol + 1;
+
+            const size_t lineStart = line_.rfind('\n') == std::string::npos ? 0 : line_.rfind('\n') + 1;
+            line_.append(data.substr(used, end - used));
+            used = end;
+
+            if (line_.size() > MaxHeadersSize)
+                throw HttpError(Code::Bad_Request, "Multipart headers too large");
+            if (eol == std::string_view::npos)
+                break;
+
+            // An empty line ends the headers
+            if (line_.compare(lineStart, std::string::npos, "\r\n") == 0)
+            {
+                parseHeaders();
+                line_.clear();
+                step_ = Step::Content;
+                handler_.onPart(part_);
+                break;
+            }
+        }
+        return used;
+    }
+
+    void Parser::parseHeaders()
+    {
+        RawStreamBuf<char> buffer(line_.data(), line_.size());
+        StreamCursor cursor(&buffer);
+
+        while (!cursor.eol())
+        {
+            size_t start = cursor;
+            if (!match_until(':', cursor) || !cursor.advance(1))
+                throw HttpError(Code::Bad_Request, "Invalid multipart header");
+
+            std::string name(cursor.offset(start), cursor.diff(start) - 1);
+            skip_whitespaces(cursor);
+
+            start = cursor;
+            if (!match_until_eol(cursor))
+                throw HttpError(Code::Bad_Request, "Invalid multipart header");
+            std::string value(cursor.offset(start), cursor.diff(start));
+            cursor.advance(2);
+
+            if (equalsIgnoreCase(name, "Content-Disposition"))
+            {
+                parseDisposition(value, part_);
+            }
+            else if (equalsIgnoreCase(name, "Content-Type"))
+            {
+                try
+                {
+                    part_.contentType = Mime::MediaType::fromString(value);
+                }
+                catch (const std::exception&)
+                {
+                    throw HttpError(Code::Bad_Request, "Invalid multipart Content-Type");
+                }
+            }
+
+            part_.headers.addRaw(Header::Raw(std::move(name), std::move(value)));
+        }
+
+        if (part_.contentType.top() == Mime::Type::None)
+            part_.contentType = Mime::MediaType(Mime::Type::Text, Mime::Subtype::Plain);
+    }
+
+    Reader::Reader(std::string boundary, std::shared_ptr<Handler> handler)
+        : handler_(std::move(handler))
+        , parser_(boundary, *handler_)
+    { }
+
+    std::shared_ptr<Reader> Reader::create(const Request& request, std::shared_ptr<Handler> handler)
+    {
+        auto boundary = Parser::boundary(request);
+        if (!boundary)
+            return nullptr;
+        return std::make_shared<Reader>(std::move(*boundary), std::move(handler));
+    }
+
+    void Reader::onData(std::string_view data) { parser_.feed(data); }
+
+    void Reader::onEnd()
+    {
+        if (parser_.done())
+            return;
+
+        handler_->onError("Incomplete multipart body");
+        throw HttpError(Code::Bad_Request, "Incomplete multipart body");
+    }
+
+    void Reader::onError(const std::string& reason) { handler_->onError(reason); }
+
+} // namespace Pistache::Http::Multipart
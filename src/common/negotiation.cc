@@ -0,0 +1,224 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* negotiation.cc
+
+   Implementation of the negotiation of the media type of the responses
+*/
+
+#include <pistache/negotiation.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <functional>
+#include <stdexcept>
+
+#include "string_utils.h"
+
+namespace Pistache::Http::Mime
+{
+
+    namespace
+    {
+        std::atomic<uint64_t> nextNegotiatorId { 0 };
+
+        constexpr size_t CacheSlots = 256;
+        constexpr uint32_t NoneAcceptable = UINT32_MAX;
+
+        // Results of the Accept values a thread negotiated last, for all the
+        // negotiators
+        struct CacheSlot
+        {
+            uint64_t owner = UINT64_MAX;
+            std::string accept;
+            uint32_t result = NoneAcceptable;
+        };
+
+        std::array<CacheSlot, CacheSlots>& cache()
+        {
+            thread_local std::array<CacheSlot, CacheSlots> slots;
+            return slots;
+        }
+
+        std::string lower(std::string_view value)
+        {
+            std::string result(value);
+            for (auto& c : result)
+                c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            return result;
+        }
+
+        bool equalsLower(std::string_view value, const std::string& lowered)
+        {
+            return std::equal(value.begin(), value.end(), lowered.begin(), lowered.end(),
+                              [](char a, char b) {
+                                  return std::tolower(static_cast<unsigned char>(a)) == b;
+                              });
+        }
+
+        // Weight of a media range in thousandths, 1000 without a q
+        // parameter and 0 when it is not a valid qvalue
+        unsigned weightOf(std::string_view params)
+        {
+            while (!params.empty())
+            {
+                auto end   = params.find(';');
+                auto param = Private::trim(params.substr(0, end));
+                params     = end == std::string_view::npos ? std::string_view() : params.substr(end + 1);
+
+                if (param.size() < 2 || (param[0] != 'q' && param[0] != 'Q') || param[1] != '=')
+                    continue;
+
+                const auto value = param.substr(2);
+                if (value.empty() || (value[0] != '0' && value[0] != '1'))
+                    return 0;
+
+                unsigned weight = (value[0] - '0') * 1000;
+                if (value.size() > 1)
+                {
+                    if (value[1] != '.' || value.size() > 5)
+                        return 0;
+
+                    unsigned scale = 100;
+                    for (size_t i = 2; i < value.size(); ++i, scale /= 10)
+                    {
+                        if (!std::isdigit(static_cast<unsigned char>(value[i])))
+                            return 0;
+                        weight += (value[i] - '0') * scale;
+                    }
+                }
+                return std::min(weight, 1000u);
+            }
+
+            return 1000;
+        }
+    } // namespace
+
+    Negotiator::Negotiator(const std::vector<MediaType>& produces)
+        : produces_(produces)
+        , id_(nextNegotiatorId.fetch_add(1, std::memory_order_relaxed))
+    {
+        if (produces.empty() || produces.size() > MaxTypes)
+            throw std::invalid_argument("A negotiator needs between 1 and 32 media types");
+
+        for (const auto& type : produces)
+        {
+            // The name without its parameters
+            auto name        = type.toString();
+            const auto slash = name.find('/');
+            const auto end   = name.find(';');
+            if (slash == std::string::npos || slash == 0 || slash + 1 >= std::min(end, name.size()))
+                throw std::invalid_argument("Invalid media type to negotiate: " + name);
+
+            const std::string_view view(name);
+            compiled_.push_back(Compiled {
+                lower(Private::trim(view.substr(0, slash))),
+                lower(Private::trim(view.substr(slash + 1, end == std::string::npos ? end : end - slash - 1))) });
+        }
+    }
+
+    std::optional<size_t> Negotiator::negotiate(std::string_view accept) const
+    {
+        accept = Private::trim(accept);
+        if (accept.empty())
+            return 0;
+
+        if (accept.size() > MaxCachedAccept)
+            return match(accept);
+
+        const size_t hash = std::hash<std::string_view> {}(accept) ^ (id_ * 0x9e3779b97f4a7c15ULL);
+        auto& slot        = cache()[hash % CacheSlots];
+        if (slot.owner != id_ || slot.accept != accept)
+        {
+            const auto result = match(accept);
+            slot.owner        = id_;
+            slot.accept.assign(accept);
+            slot.result = result ? static_cast<uint32_t>(*result) : NoneAcceptable;
+            return result;
+        }
+
+        if (slot.result == NoneAcceptable)
+            return std::nullopt;
+        return slot.result;
+    }
+
+    const MediaType* Negotiator::select(const Request& request) const
+    {
+        const auto& raw = request.headers().rawList();
+        auto it         = raw.find("Accept");
+
+        const auto chosen = negotiate(it == raw.end() ? std::string_view() : std::string_view(it->second.value()));
+        return chosen ? &produces_[*chosen] : nullptr;
+    }
+
+    std::optional<size_t> Negotiator::match(std::string_view accept) const
+    {
+        // How specific the range matching every type is, from */* to
+        // type/subtype, and the weight it gives to the type
+        std::array<uint8_t, MaxTypes> specificity {};
+        std::array<uint16_t, MaxTypes> weights {};
+
+        while (!accept.empty())
+        {
+            auto end    = accept.find(',');
+            auto member = accept.substr(0, end);
+            accept      = end == std::string_view::npos ? std::string_view() : accept.substr(end + 1);
+
+            const auto paramsStart = member.find(';');
+            const auto range       = Private::trim(member.substr(0, paramsStart));
+            if (range.empty())
+                continue;
+
+            std::string_view top = range;
+            std::string_view sub = "*";
+            const auto slash     = range.find('/');
+            if (slash != std::string_view::npos)
+            {
+                top = Private::trim(range.substr(0, slash));
+                sub = Private::trim(range.substr(slash + 1));
+            }
+            else if (range != "*")
+            {
+                continue;
+            }
+
+            uint8_t level = 3;
+            if (top == "*")
+                level = 1;
+            else if (sub == "*")
+                level = 2;
+
+            const auto weight = static_cast<uint16_t>(
+                paramsStart == std::string_view::npos ? 1000 : weightOf(member.substr(paramsStart + 1)));
+
+            for (size_t i = 0; i < compiled_.size(); ++i)
+            {
+                if (level <= specificity[i])
+                    continue;
+
+                const auto& type = compiled_[i];
+                if (level >= 2 && !equalsLower(top, type.top))
+                    continue;
+                if (level == 3 && !equalsLower(sub, type.sub))
+                    continue;
+
+                specificity[i] = level;
+                weights[i]     = weight;
+            }
+        }
+
+        std::optional<size_t> best;
+        for (size_t i = 0; i < compiled_.size(); ++i)
+        {
+            if (weights[i] > 0 && (!best || weights[i] > weights[*best]))
+                best = i;
+        }
+        return best;
+    }
+
+} // namespace Pistache::Http::Mime
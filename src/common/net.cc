@@ -19,6 +19,7 @@
 #include <vector>
 
 #include <cassert>
+#include <cstddef>
 #include <cstring>
 
 #include <arpa/inet.h>
@@ -26,6 +27,7 @@
 #include <netdb.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
 
 namespace Pistache
 {
@@ -379,6 +381,20 @@ namespace Pistache
             assert(addr);
             return Address(ip, port);
         }
+        if (addr->sa_family == AF_UNIX)
+        {
+            // Unnamed for a peer that did not bind its socket. Without the
+            // length, an abstract name ends at its first null byte
+            const auto* un     = reinterpret_cast<const struct sockaddr_un*>(addr);
+            const size_t max   = sizeof(un->sun_path);
+            Address address;
+            address.unixDomain_ = true;
+            if (un->sun_path[0] != '\0')
+                address.path_.assign(un->sun_path, strnlen(un->sun_path, max));
+            else if (un->sun_path[1] != '\0')
+                address.path_ = "@" + std::string(un->sun_path + 1, strnlen(un->sun_path + 1, max - 1));
+            return address;
+        }
         throw Error("Not an IP socket");
     }
 
@@ -387,14 +403,68 @@ namespace Pistache
         return Address::fromUnix(reinterpret_cast<struct sockaddr*>(addr));
     }
 
-    std::string Address::host() const { return ip_.toString(); }
+    Address Address::unixSocket(std::string path)
+    {
+        // The terminating null byte of a file path
+        struct sockaddr_un un;
+        if (path.empty() || path.size() >= sizeof(un.sun_path))
+            throw std::invalid_argument("Invalid Unix socket path: " + path);
+
+        Address address;
+        address.unixDomain_ = true;
+        address.path_       = std::move(path);
+        return address;
+    }
+
+    std::string Address::host() const { return unixDomain_ ? path_ : ip_.toString(); }
 
     Port Address::port() const { return port_; }
 
-    int Address::family() const { return ip_.getFamily(); }
+    int Address::family() const { return unixDomain_ ? AF_UNIX : ip_.getFamily(); }
+
+    socklen_t Address::toSockaddr(struct sockaddr_storage& storage) const
+    {
+        memset(&storage, 0, sizeof(storage));
+
+        if (unixDomain_)
+        {
+            auto* un       = reinterpret_cast<struct sockaddr_un*>(&storage);
+            un->sun_family = AF_UNIX;
+            memcpy(un->sun_path, path_.data(), path_.size());
+            // The name of an abstract socket is as long as the address says
+            if (path_.front() == '@')
+            {
+                un->sun_path[0] = '\0';
+                return static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + path_.size());
+            }
+            return sizeof(struct sockaddr_un);
+        }
+
+        const auto port = htons(static_cast<uint16_t>(port_));
+        if (ip_.getFamily() == AF_INET6)
+        {
+            auto* addr6        = reinterpret_cast<struct sockaddr_in6*>(&storage);
+            addr6->sin6_family = AF_INET6;
+            addr6->sin6_port   = port;
+            ip_.toNetwork(&addr6->sin6_addr);
+            return sizeof(struct sockaddr_in6);
+        }
+
+        auto* addr4       = reinterpret_cast<struct sockaddr_in*>(&storage);
+        addr4->sin_family = AF_INET;
+        addr4->sin_port   = port;
+        ip_.toNetwork(&addr4->sin_addr.s_addr);
+        return sizeof(struct sockaddr_in);
+    }
 
     void Address::init(const std::string& addr)
     {
+        if (addr.rfind("unix:", 0) == 0)
+        {
+            *this = unixSocket(addr.substr(std::strlen("unix:")));
+            return;
+        }
+
         AddressParser parser(addr);
         const int family = parser.family();
 
@@ -461,7 +531,10 @@ namespace Pistache
 
     std::ostream& operator<<(std::ostream& os, const Address& address)
     {
-        os << address.host() << ":" << address.port();
+        if (address.family() == AF_UNIX)
+            os << "unix:" << address.host();
+        else
+            os << address.host() << ":" << address.port();
         return os;
     }
 
@@ -13,15 +13,30 @@
 #include <pistache/config.h>
 #include <pistache/os.h>
 
+#include <dirent.h>
 #include <fcntl.h>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
 #include <unistd.h>
 
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define PISTACHE_HAS_IO_URING
+#endif
+
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iterator>
+#include <mutex>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
 
 namespace Pistache
 {
@@ -137,6 +152,172 @@ namespace Pistache
         return cpu_set;
     }
 
+    std::vector<size_t> availableCpus()
+    {
+        std::vector<size_t> cpus;
+
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0)
+            return cpus;
+
+        for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &cpu_set))
+                cpus.push_back(cpu);
+        }
+
+        return cpus;
+    }
+
+    namespace
+    {
+        // The cgroup of the process in the v1 hierarchy of the controller, or
+        // in the v2 one for an empty controller
+        std::optional<std::string> cgroupOf(const std::string& selfCgroup,
+                                            std::string_view controller)
+        {
+            std::ifstream file(selfCgroup);
+            std::string line;
+            while (std::getline(file, line))
+            {
+                // hierarchy-ID:controller-list:cgroup-path
+                const auto first = line.find(':');
+                if (first == std::string::npos)
+                    continue;
+                const auto second = line.find(':', first + 1);
+                if (second == std::string::npos)
+                    continue;
+
+                std::string_view controllers(line.data() + first + 1, second - first - 1);
+                bool matches = controller.empty() && controllers.empty();
+                while (!controller.empty() && !matches && !controllers.empty())
+                {
+                    const auto comma = controllers.find(',');
+                    matches          = controllers.substr(0, comma) == controller;
+                    controllers      = comma == std::string_view::npos ? std::string_view()
+                                                                       : controllers.substr(comma + 1);
+                }
+
+                if (matches)
+                    return line.substr(second + 1);
+            }
+
+            return std::nullopt;
+        }
+
+        // "max <period>" or "<quota> <period>"
+        std::optional<double> readCpuMax(const std::string& dir)
+        {
+            std::ifstream file(dir + "/cpu.max");
+            std::string quota;
+            long period = 0;
+            if (!(file >> quota >> period) || period <= 0)
+                return std::nullopt;
+
+            char* end        = nullptr;
+            const long value = std::strtol(quota.c_str(), &end, 10);
+            if (end == quota.c_str() || *end != '\0' || value <= 0)
+                return std::nullopt;
+
+            return static_cast<double>(value) / static_cast<double>(period);
+        }
+
+        // A quota of -1 is no quota
+        std::optional<double> readCfsQuota(const std::string& dir)
+        {
+            long quota  = 0;
+            long period = 0;
+            std::ifstream(dir + "/cpu.cfs_quota_us") >> quota;
+            std::ifstream(dir + "/cpu.cfs_period_us") >> period;
+            if (quota <= 0 || period <= 0)
+                return std::nullopt;
+
+            return static_cast<double>(quota) / static_cast<double>(period);
+        }
+
+        // The smallest quota from the cgroup up to the root of the mount, a
+        // parent limits all of its children
+        template <typename Read>
+        std::optional<double> smallestQuota(const std::string& mount, std::string path, Read read)
+        {
+            std::optional<double> smallest;
+            for (;;)
+            {
+                if (auto quota = read(mount + path))
+                    smallest = smallest ? std::min(*smallest, *quota) : *quota;
+
+                const auto slash = path.rfind('/');
+                if (slash == std::string::npos || path.size() <= 1)
+                    break;
+                path.erase(slash);
+            }
+
+            return smallest;
+        }
+    } // namespace
+
+    std::optional<double> cpuQuota(const std::string& cgroupRoot, const std::string& selfCgroup)
+    {
+        if (auto path = cgroupOf(selfCgroup, ""))
+        {
+            if (auto quota = smallestQuota(cgroupRoot, *path, readCpuMax))
+                return quota;
+        }
+
+        if (auto path = cgroupOf(selfCgroup, "cpu"))
+        {
+            // Named after the controllers mounted together
+            for (const char* mount : { "/cpu,cpuacct", "/cpu", "/cpuacct,cpu" })
+            {
+                if (auto quota = smallestQuota(cgroupRoot + mount, *path, readCfsQuota))
+                    return quota;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    size_t usableCpus()
+    {
+        size_t cpus = availableCpus().size();
+        if (cpus == 0)
+            cpus = hardware_concurrency();
+
+        if (auto quota = cpuQuota())
+            cpus = std::min(cpus, static_cast<size_t>(std::ceil(*quota)));
+
+        return std::max<size_t>(cpus, 1);
+    }
+
+    int cpuNode(size_t cpu)
+    {
+        // The cpu directory holds a "nodeN" link to the node it belongs to
+        const auto path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+
+        DIR* dir = opendir(path.c_str());
+        if (dir == nullptr)
+            return -1;
+
+        int node = -1;
+        while (const auto* entry = readdir(dir))
+        {
+            if (std::strncmp(entry->d_name, "node", 4) != 0)
+                continue;
+
+            char* end         = nullptr;
+            const long number = std::strtol(entry->d_name + 4, &end, 10);
+            if (end != entry->d_name + 4 && *end == '\0')
+            {
+                node = static_cast<int>(number);
+                break;
+            }
+        }
+
+        closedir(dir);
+        return node;
+    }
+
     namespace Polling
     {
 
@@ -145,10 +326,415 @@ namespace Pistache
             , tag(_tag)
         { }
 
+#ifdef PISTACHE_HAS_IO_URING
+
+        /*
+         * A minimal io_uring ring used as a readiness notification facility.
+         *
+         * Every registered fd gets an IORING_OP_POLL_ADD request. Level-triggered
+         * registrations are re-armed after each completion, edge-triggered ones
+         * use a multishot poll and one-shot registrations wait for an explicit
+         * rearm, which matches the semantics we get with epoll.
+         *
+         * Registration requests coming from any thread are submitted right away,
+         * as we would do with epoll_ctl(). Re-arms issued while reaping
+         * completions are only queued and get submitted with the next wait, in
+         * the same io_uring_enter() call.
+         */
+        class IoUring
+        {
+        public:
+            explicit IoUring(unsigned entries)
+                : ring_fd(-1)
+            {
+                io_uring_params params;
+                std::memset(&params, 0, sizeof params);
+                // Re-arms can produce more completions than ready fds, give the
+                // completion ring some headroom
+                params.flags      = IORING_SETUP_CLAMP | IORING_SETUP_CQSIZE;
+                params.cq_entries = entries * 4;
+
+                auto fd = TRY_RET(::syscall(__NR_io_uring_setup, entries, &params));
+                ring_fd = static_cast<Fd>(fd);
+
+                static constexpr uint32_t RequiredFeatures = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+                if ((params.features & RequiredFeatures) != RequiredFeatures)
+                {
+                    close(ring_fd);
+                    throw std::runtime_error("The kernel io_uring implementation is too old");
+                }
+
+                ringSize = std::max(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+                                    params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+                ring     = ::mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  ring_fd, IORING_OFF_SQ_RING);
+                if (ring == MAP_FAILED)
+                {
+                    close(ring_fd);
+                    throw std::runtime_error("Could not map the io_uring rings");
+                }
+
+                sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+                sqes     = static_cast<io_uring_sqe*>(::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                                                             MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+                if (sqes == MAP_FAILED)
+                {
+                    munmap(ring, ringSize);
+                    close(ring_fd);
+                    throw std::runtime_error("Could not map the io_uring submission entries");
+                }
+
+                auto* base = static_cast<char*>(ring);
+                sqHead     = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+                sqTail     = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+                sqMask     = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+                sqArray    = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+                sqEntries  = params.sq_entries;
+
+                cqHead = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+                cqTail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+                cqMask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+                cqes   = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+            }
+
+            ~IoUring()
+            {
+                munmap(sqes, sqesSize);
+                munmap(ring, ringSize);
+                close(ring_fd);
+            }
+
+            void add(Fd fd, Flags<NotifyOn> interest, Tag tag, Mode mode, bool oneShot)
+            {
+                Guard guard(lock);
+
+                auto& reg = registrations[fd];
+                if (reg.armed)
+                {
+                    // The fd has been closed without being removed and the number
+                    // has been reused, get rid of the stale poll request
+                    prepRemove(fd, reg);
+                }
+
+                reg.interest = interest;
+                reg.tag      = tag;
+                reg.mode     = mode;
+                reg.oneShot  = oneShot;
+                prepPoll(fd, reg);
+
+                submit(0);
+            }
+
+            void rearm(Fd fd, Flags<NotifyOn> interest, Tag tag, Mode mode)
+            {
+                Guard guard(lock);
+
+                auto it = registrations.find(fd);
+                if (it == std::end(registrations))
+                    throw std::runtime_error("Can not rearm an unregistered fd");
+
+                auto& reg = it->second;
+                if (reg.armed)
+                    prepRemove(fd, reg);
+
+                reg.interest = interest;
+                reg.tag      = tag;
+                reg.mode     = mode;
+                prepPoll(fd, reg);
+
+                submit(0);
+            }
+
+            void remove(Fd fd)
+            {
+                Guard guard(lock);
+
+                auto it = registrations.find(fd);
+                if (it == std::end(registrations))
+                    throw std::runtime_error("Can not remove an unregistered fd");
+
+                if (it->second.armed)
+                    prepRemove(fd, it->second);
+                registrations.erase(it);
+
+                submit(0);
+            }
+
+            int poll(std::vector<Event>& events, std::chrono::milliseconds timeout)
+            {
+                // EBUSY means that completions are waiting to be flushed from the
+                // kernel overflow list, reaping the ring will make room for them
+                int res = wait(timeout);
+                if (res < 0 && errno != EBUSY)
+                    return res;
+
+                Guard guard(lock);
+
+                unsigned head = *cqHead;
+                unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+
+                int ready = 0;
+                for (; head != tail && ready < static_cast<int>(Const::MaxEvents); ++head)
+                {
+                    const io_uring_cqe& cqe = cqes[head & cqMask];
+                    if (handleCompletion(cqe, events))
+                        ++ready;
+                }
+
+                __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+                return ready;
+            }
+
+        private:
+            using Lock  = std::mutex;
+            using Guard = std::lock_guard<Lock>;
+
+            // Requests that do not carry a registration, e.g POLL_REMOVE
+            static constexpr uint64_t InternalRequest = uint64_t(-1);
+
+            struct Registration
+            {
+                Flags<NotifyOn> interest;
+                Tag tag { 0 };
+                Mode mode    = Mode::Level;
+                bool oneShot = false;
+                bool armed   = false;
+                uint32_t gen = 0;
+            };
+
+            static uint64_t encodeRequest(Fd fd, uint32_t gen)
+            {
+                return static_cast<uint64_t>(gen) << 32 | static_cast<uint32_t>(fd);
+            }
+
+            static std::pair<Fd, uint32_t> decodeRequest(uint64_t data)
+            {
+                return std::make_pair(static_cast<Fd>(data & 0xFFFFFFFF),
+                                      static_cast<uint32_t>(data >> 32));
+            }
+
+            static unsigned toPollEvents(const Flags<NotifyOn>& interest)
+            {
+                unsigned events = 0;
+
+                if (interest.hasFlag(NotifyOn::Read))
+                    events |= POLLIN;
+                if (interest.hasFlag(NotifyOn::Write))
+                    events |= POLLOUT;
+                if (interest.hasFlag(NotifyOn::Hangup))
+                    events |= POLLHUP;
+                if (interest.hasFlag(NotifyOn::Shutdown))
+                    events |= POLLRDHUP;
+
+                return events;
+            }
+
+            static Flags<NotifyOn> toNotifyOn(int events)
+            {
+                Flags<NotifyOn> flags;
+
+                if (events & POLLIN)
+                    flags.setFlag(NotifyOn::Read);
+                if (events & POLLOUT)
+                    flags.setFlag(NotifyOn::Write);
+                if (events & POLLHUP)
+                    flags.setFlag(NotifyOn::Hangup);
+                if (events & POLLRDHUP)
+                    flags.setFlag(NotifyOn::Shutdown);
+                if (events & POLLERR)
+                    flags.setFlag(NotifyOn::Error);
+
+                return flags;
+            }
+
+            bool handleCompletion(const io_uring_cqe& cqe, std::vector<Event>& events)
+            {
+                if (cqe.user_data == InternalRequest)
+                    return false;
+
+                Fd fd;
+                uint32_t gen;
+                std::tie(fd, gen) = decodeRequest(cqe.user_data);
+
+                auto it = registrations.find(fd);
+                if (it == std::end(registrations) || it->second.gen != gen)
+                    return false;
+
+                auto& reg = it->second;
+
+                // A multishot poll stays armed as long as the kernel tells us so
+                if (!(cqe.flags & IORING_CQE_F_MORE))
+                {
+                    reg.armed = false;
+                    if (!reg.oneShot)
+                        prepPoll(fd, reg);
+                }
+
+                if (cqe.res < 0)
+                    return false;
+
+                Event event(reg.tag);
+                event.flags = toNotifyOn(cqe.res);
+                events.push_back(event);
+                return true;
+            }
+
+            io_uring_sqe* nextSqe()
+            {
+                unsigned tail = *sqTail;
+                if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries)
+                {
+                    submit(0);
+                    tail = *sqTail;
+                }
+
+                auto* sqe = &sqes[tail & sqMask];
+                std::memset(sqe, 0, sizeof *sqe);
+                sqArray[tail & sqMask] = tail & sqMask;
+
+                return sqe;
+            }
+
+            // The reactor thread might be entering the kernel concurrently, so
+            // only make the entry visible once it has been completely filled
+            void commitSqe()
+            {
+                __atomic_store_n(sqTail, *sqTail + 1, __ATOMIC_RELEASE);
+            }
+
+            void prepPoll(Fd fd, Registration& reg)
+            {
+                ++reg.gen;
+
+                auto* sqe          = nextSqe();
+                sqe->opcode        = IORING_OP_POLL_ADD;
+                sqe->fd            = fd;
+                sqe->poll32_events = toPollEvents(reg.interest);
+                if (reg.mode == Mode::Edge && !reg.oneShot)
+                    sqe->len = IORING_POLL_ADD_MULTI;
+                sqe->user_data = encodeRequest(fd, reg.gen);
+                commitSqe();
+
+                reg.armed = true;
+            }
+
+            void prepRemove(Fd fd, Registration& reg)
+            {
+                auto* sqe      = nextSqe();
+                sqe->opcode    = IORING_OP_POLL_REMOVE;
+                sqe->fd        = -1;
+                sqe->addr      = encodeRequest(fd, reg.gen);
+                sqe->user_data = InternalRequest;
+                commitSqe();
+
+                reg.armed = false;
+            }
+
+            // The kernel does not wait for completions when it submitted less
+            // entries than requested, so we must not overestimate this count
+            unsigned pendingSqes() const
+            {
+                return __atomic_load_n(sqTail, __ATOMIC_ACQUIRE) - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+            }
+
+            int submit(unsigned waitNr)
+            {
+                int res;
+                do
+                {
+                    res = static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, pendingSqes(), waitNr,
+                                                     waitNr > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+                } while (res < 0 && errno == EINTR);
+
+                return res;
+            }
+
+            int wait(std::chrono::milliseconds timeout)
+            {
+                io_uring_getevents_arg arg;
+                __kernel_timespec ts;
+                std::memset(&arg, 0, sizeof arg);
+
+                if (timeout.count() >= 0)
+                {
+                    ts.tv_sec  = timeout.count() / 1000;
+                    ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+                    arg.ts     = reinterpret_cast<uint64_t>(&ts);
+                }
+
+                int res;
+                do
+                {
+                    // Pending re-arms are submitted along with the wait
+                    res = static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, pendingSqes(), 1,
+                                                     IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                                     &arg, sizeof arg));
+                } while (res < 0 && errno == EINTR);
+
+                if (res < 0 && errno == ETIME)
+                    return 0;
+
+                return res;
+            }
+
+            Fd ring_fd;
+
+            void* ring;
+            size_t ringSize;
+
+            io_uring_sqe* sqes;
+            size_t sqesSize;
+
+            unsigned* sqHead;
+            unsigned* sqTail;
+            unsigned* sqArray;
+            unsigned sqMask;
+            unsigned sqEntries;
+
+            unsigned* cqHead;
+            unsigned* cqTail;
+            unsigned cqMask;
+            io_uring_cqe* cqes;
+
+            Lock lock;
+            std::unordered_map<Fd, Registration> registrations;
+        };
+
+#else
+
+        class IoUring
+        {
+        public:
+            explicit IoUring(unsigned)
+            {
+                throw std::runtime_error("Pistache has been compiled without io_uring support");
+            }
+
+            void add(Fd, Flags<NotifyOn>, Tag, Mode, bool) { }
+            void rearm(Fd, Flags<NotifyOn>, Tag, Mode) { }
+            void remove(Fd) { }
+            int poll(std::vector<Event>&, std::chrono::milliseconds) { return -1; }
+        };
+
+#endif /* PISTACHE_HAS_IO_URING */
+
         Epoll::Epoll()
             : epoll_fd([&]() { return TRY_RET(epoll_create(Const::MaxEvents)); }())
         { }
 
+        Epoll::Epoll(Backend backend)
+            : epoll_fd(-1)
+        {
+            if (backend == Backend::IoUring)
+            {
+                uring_ = std::make_unique<IoUring>(Const::MaxEvents);
+            }
+            else
+            {
+                epoll_fd = TRY_RET(epoll_create(Const::MaxEvents));
+            }
+        }
+
         Epoll::~Epoll()
         {
             if (epoll_fd >= 0)
@@ -157,12 +743,57 @@ namespace Pistache
             }
         }
 
+        Backend Epoll::backend() const
+        {
+            return uring_ ? Backend::IoUring : Backend::Epoll;
+        }
+
+        bool Epoll::isSupported(Backend backend)
+        {
+            if (backend == Backend::Epoll)
+                return true;
+
+            try
+            {
+                IoUring ring(1);
+                return true;
+            }
+            catch (const std::exception&)
+            {
+                return false;
+            }
+        }
+
+        namespace
+        {
+            thread_local uint64_t scopeBits = 0;
+        } // namespace
+
+        TagScope::TagScope(uint64_t bits)
+            : previous_(scopeBits)
+        {
+            scopeBits = bits;
+        }
+
+        TagScope::~TagScope() { scopeBits = previous_; }
+
+        uint64_t TagScope::bits() { return scopeBits; }
+
         void Epoll::addFd(Fd fd, Flags<NotifyOn> interest, Tag tag, Mode mode)
         {
+            tag.value_ |= TagScope::bits();
+            if (uring_)
+            {
+                uring_->add(fd, interest, tag, mode, false);
+                return;
+            }
+
             struct epoll_event ev;
             ev.events = toEpollEvents(interest);
             if (mode == Mode::Edge)
                 ev.events |= EPOLLET;
+            else if (mode == Mode::Exclusive)
+                ev.events |= EPOLLEXCLUSIVE;
             ev.data.u64 = tag.value_;
 
             TRY(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev));
@@ -170,6 +801,13 @@ namespace Pistache
 
         void Epoll::addFdOneShot(Fd fd, Flags<NotifyOn> interest, Tag tag, Mode mode)
         {
+            tag.value_ |= TagScope::bits();
+            if (uring_)
+            {
+                uring_->add(fd, interest, tag, mode, true);
+                return;
+            }
+
             struct epoll_event ev;
             ev.events = toEpollEvents(interest);
             ev.events |= EPOLLONESHOT;
@@ -182,12 +820,24 @@ namespace Pistache
 
         void Epoll::removeFd(Fd fd)
         {
+            if (uring_)
+            {
+                uring_->remove(fd);
+                return;
+            }
+
             struct epoll_event ev;
             TRY(epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev));
         }
 
         void Epoll::rearmFd(Fd fd, Flags<NotifyOn> interest, Tag tag, Mode mode)
         {
+            if (uring_)
+            {
+                uring_->rearm(fd, interest, tag, mode);
+                return;
+            }
+
             struct epoll_event ev;
             ev.events = toEpollEvents(interest);
             if (mode == Mode::Edge)
@@ -200,6 +850,9 @@ namespace Pistache
         int Epoll::poll(std::vector<Event>& events,
                         const std::chrono::milliseconds timeout) const
         {
+            if (uring_)
+                return uring_->poll(events, timeout);
+
             struct epoll_event evs[Const::MaxEvents];
 
             int ready_fds = -1;
@@ -253,6 +906,8 @@ namespace Pistache
             {
                 flags.setFlag(NotifyOn::Shutdown);
             }
+            if (events & EPOLLERR)
+                flags.setFlag(NotifyOn::Error);
 
             return flags;
         }
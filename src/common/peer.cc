@@ -12,12 +12,11 @@
 #include <iostream>
 #include <stdexcept>
 
-#include <arpa/inet.h>
-#include <netdb.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 
 #include <pistache/async.h>
+#include <pistache/dns_resolver.h>
 #include <pistache/peer.h>
 #include <pistache/transport.h>
 
@@ -39,14 +38,26 @@ namespace Pistache::Tcp
         , addr(addr)
         , ssl_(ssl)
         , id_(getUniqueId())
+        , handshakePending_(ssl != nullptr)
     { }
 
     Peer::~Peer()
     {
 #ifdef PISTACHE_USE_SSL
         if (ssl_)
-            SSL_free(static_cast<SSL*>(ssl_));
+        {
+            auto* ssl = static_cast<SSL*>(ssl_);
+
+            // The socket may be closed already, no close_notify is sent. The
+            // connection still ended cleanly unless an alert said otherwise,
+            // which keeps its session resumable
+            SSL_set_shutdown(ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+            SSL_free(ssl);
+        }
 #endif /* PISTACHE_USE_SSL */
+
+        for (auto& waiter : drainWaiters_)
+            waiter(false);
     }
 
     std::shared_ptr<Peer> Peer::Create(Fd fd, const Address& addr)
@@ -66,33 +77,89 @@ namespace Pistache::Tcp
 
     const std::string& Peer::hostname()
     {
-        if (hostname_.empty())
+        if (!hostnameResolved_)
         {
-            char host[NI_MAXHOST];
-            struct sockaddr_in sa;
-            sa.sin_family = AF_INET;
-            if (inet_pton(AF_INET, addr.host().c_str(), &sa.sin_addr) == 0)
-            {
-                hostname_ = addr.host();
-            }
-            else
+            auto name = DnsResolver::shared().cachedName(addr.host());
+            if (name && !name->empty())
             {
-                if (!getnameinfo(reinterpret_cast<struct sockaddr*>(&sa), sizeof(sa), host, sizeof(host),
-                                 nullptr, 0 // Service info
-                                 ,
-                                 NI_NAMEREQD // Raise an error if name resolution failed
-                                 ))
-                {
-                    hostname_.assign(static_cast<char*>(host));
-                }
+                hostname_         = std::move(*name);
+                hostnameResolved_ = true;
             }
+            else if (hostname_.empty())
+                hostname_ = addr.host();
         }
         return hostname_;
     }
 
+    Async::Promise<std::string> Peer::resolveHostname() const
+    {
+        return DnsResolver::shared().resolveName(addr.host());
+    }
+
     void* Peer::ssl() const { return ssl_; }
+
+    bool Peer::kernelTls() const { return kernelTls_; }
+
+    std::string Peer::alpnProtocol() const
+    {
+#ifdef PISTACHE_USE_SSL
+        if (ssl_ != nullptr)
+        {
+            const unsigned char* protocol = nullptr;
+            unsigned int length           = 0;
+            SSL_get0_alpn_selected(static_cast<SSL*>(ssl_), &protocol, &length);
+            if (protocol != nullptr)
+                return std::string(reinterpret_cast<const char*>(protocol), length);
+        }
+#endif /* PISTACHE_USE_SSL */
+        return std::string();
+    }
+
     size_t Peer::getID() const { return id_; }
 
+    size_t Peer::queuedBytes() const { return queuedBytes_.load(); }
+
+    void Peer::setWatermarks(size_t high, size_t low)
+    {
+        if (low > high)
+            throw std::invalid_argument("The low watermark is above the high one");
+
+        highWatermark_ = high;
+        lowWatermark_  = low;
+    }
+
+    void Peer::queueBytes(size_t bytes) { queuedBytes_ += bytes; }
+
+    void Peer::releaseBytes(size_t bytes)
+    {
+        const size_t queued = (queuedBytes_ -= bytes);
+        if (queued > lowWatermark_)
+            return;
+
+        std::vector<std::function<void(bool)>> waiters;
+        {
+            std::lock_guard<std::mutex> guard(drainLock_);
+            waiters.swap(drainWaiters_);
+        }
+        for (auto& waiter : waiters)
+            waiter(true);
+    }
+
+    void Peer::whenDrained(std::function<void(bool)> callback)
+    {
+        {
+            std::lock_guard<std::mutex> guard(drainLock_);
+            // Checked under the lock, a release in between would have missed
+            // the callback otherwise
+            if (queuedBytes_.load() > lowWatermark_)
+            {
+                drainWaiters_.push_back(std::move(callback));
+                return;
+            }
+        }
+        callback(true);
+    }
+
     int Peer::fd() const
     {
         if (fd_ == -1)
@@ -163,4 +230,18 @@ namespace Pistache::Tcp
         return idCounter++;
     }
 
+    size_t Peer::allocateSlot()
+    {
+        static std::atomic<size_t> slotsCounter { 0 };
+
+        auto index = slotsCounter.load(std::memory_order_relaxed);
+        do
+        {
+            if (index >= SlotsCount)
+                throw std::runtime_error("Every slot of the peers is taken");
+        } while (!slotsCounter.compare_exchange_weak(index, index + 1, std::memory_order_relaxed));
+
+        return index;
+    }
+
 } // namespace Pistache::Tcp
@@ -10,14 +10,16 @@
    Implementation of the Reactor
 */
 
+#include <pistache/clock.h>
 #include <pistache/reactor.h>
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 using namespace std::string_literals;
@@ -63,6 +65,8 @@ namespace Pistache::Aio
 
         virtual void shutdown() = 0;
 
+        virtual std::vector<LoopStats> loopStats() const = 0;
+
         Reactor* reactor_;
     };
 
@@ -72,30 +76,53 @@ namespace Pistache::Aio
     class SyncImpl : public Reactor::Impl
     {
     public:
-        explicit SyncImpl(Reactor* reactor)
+        explicit SyncImpl(Reactor* reactor,
+                          Polling::Backend backend       = Polling::Backend::Epoll,
+                          std::chrono::microseconds spin = std::chrono::microseconds(0))
             : Reactor::Impl(reactor)
             , handlers_()
+            , events_()
+            , ready_()
             , shutdown_()
             , shutdownFd()
-            , poller()
+            , poller(backend)
+            , spin_(spin)
         {
+            events_.reserve(Const::MaxEvents);
             shutdownFd.bind(poller);
         }
 
+        // Can be called while the loop runs, the handler is published last
         Reactor::Key addHandler(const std::shared_ptr<Handler>& handler,
                                 bool setKey = true) override
         {
-            handler->registerPoller(poller);
+            std::lock_guard<std::mutex> guard(handlersLock_);
 
-            handler->reactor_ = reactor_;
+            const Reactor::Key key(handlers_.size());
+            if (key.data() == MaxHandlers())
+                throw std::runtime_error("Maximum handlers reached");
+
+            if (spin_.count() > 0)
+                handler->spinning_ = &spinning_;
+            {
+                // The fds the handler adds itself carry its index, like the
+                // ones of registerFd()
+                Polling::TagScope scope(encodeTag(key, Polling::Tag(0)).value());
+                handler->registerPoller(poller);
+            }
 
-            auto key = handlers_.add(handler);
+            handler->reactor_ = reactor_;
             if (setKey)
                 handler->key_ = key;
+            if (loopThread_ != std::thread::id())
+                handler->context_.tid = loopThread_;
 
+            handlers_.add(handler);
             return key;
         }
 
+        size_t handlersCount() const { return handlers_.size(); }
+
         std::shared_ptr<Handler> handler(const Reactor::Key& key) const
         {
             return handlers_.at(key.data());
@@ -149,8 +176,13 @@ namespace Pistache::Aio
 
             for (;;)
             {
-                std::vector<Polling::Event> events;
-                int ready_fds = poller.poll(events);
+                events_.clear();
+                const auto polling = Clock::now();
+                int ready_fds      = spin_.count() > 0 ? spinPoll() : poller.poll(events_);
+                const auto polled  = Clock::now();
+
+                add(stats_.waiting, polled - polling);
+                add(stats_.iterations, 1);
 
                 switch (ready_fds)
                 {
@@ -162,16 +194,30 @@ namespace Pistache::Aio
                     if (shutdown_)
                         return;
 
-                    handleFds(std::move(events));
+                    const auto events = static_cast<uint64_t>(ready_fds);
+                    add(stats_.events, events);
+                    if (events > stats_.maxBatch.load(std::memory_order_relaxed))
+                        stats_.maxBatch.store(events, std::memory_order_relaxed);
+
+                    stats_.busySince.store(polled.time_since_epoch().count(),
+                                           std::memory_order_relaxed);
+                    CachedClock::update(polled);
+                    handleFds(polled);
+                    CachedClock::reset();
+                    stats_.busySince.store(0, std::memory_order_relaxed);
                 }
             }
         }
 
         void run() override
         {
-            handlers_.forEachHandler([](const std::shared_ptr<Handler> handler) {
-                handler->context_.tid = std::this_thread::get_id();
-            });
+            {
+                std::lock_guard<std::mutex> guard(handlersLock_);
+                loopThread_ = std::this_thread::get_id();
+                handlers_.forEachHandler([this](const std::shared_ptr<Handler> handler) {
+                    handler->context_.tid = loopThread_;
+                });
+            }
 
             while (!shutdown_)
                 runOnce();
@@ -183,6 +229,33 @@ namespace Pistache::Aio
             shutdownFd.notify();
         }
 
+        std::vector<LoopStats> loopStats() const override
+        {
+            return { stats() };
+        }
+
+        LoopStats stats() const
+        {
+            auto nanos = [](const std::atomic<int64_t>& value) {
+                return std::chrono::nanoseconds(value.load(std::memory_order_relaxed));
+            };
+
+            LoopStats stats;
+            stats.iterations   = stats_.iterations.load(std::memory_order_relaxed);
+            stats.events       = stats_.events.load(std::memory_order_relaxed);
+            stats.maxBatch     = stats_.maxBatch.load(std::memory_order_relaxed);
+            stats.waiting      = nanos(stats_.waiting);
+            stats.busy         = nanos(stats_.busy);
+            stats.handlerCalls = stats_.handlerCalls.load(std::memory_order_relaxed);
+            stats.maxHandler   = nanos(stats_.maxHandler);
+
+            const auto since = stats_.busySince.load(std::memory_order_relaxed);
+            if (since != 0)
+                stats.lag = std::chrono::duration_cast<std::chrono::nanoseconds>(std::max(
+                    Clock::now().time_since_epoch() - Clock::duration(since), Clock::duration::zero()));
+            return stats;
+        }
+
         static constexpr size_t MaxHandlers() { return HandlerList::MaxHandlers; }
 
     private:
@@ -197,33 +270,103 @@ namespace Pistache::Aio
             return HandlerList::decodeTag(tag);
         }
 
-        void handleFds(std::vector<Polling::Event> events) const
+        using Clock = std::chrono::steady_clock;
+
+        // Polls without blocking until an event comes, or the spin budget
+        // went by without any. The handlers look at the queues that do not
+        // wake the loop up while it spins before every poll, so that they
+        // are drained while events keep coming as well. The flag goes down
+        // before the loop blocks, and the queues are looked at once more
+        // for what was pushed just before
+        int spinPoll()
         {
-            // Fast-path: if we only have one handler, do not bother scanning the fds to
-            // find the right handlers
-            if (handlers_.size() == 1)
-                handlers_.at(0)->onReady(FdSet(std::move(events)));
-            else
+            const auto deadline = Clock::now() + spin_;
+            spinning_.store(true);
+            for (;;)
             {
-                std::unordered_map<std::shared_ptr<Handler>, std::vector<Polling::Event>>
-                    fdHandlers;
+                handlers_.forEachHandler([](const std::shared_ptr<Handler>& handler) {
+                    handler->onSpin();
+                });
 
-                for (auto& event : events)
-                {
-                    size_t index;
-                    uint64_t value;
+                const int ready = poller.poll(events_, std::chrono::milliseconds(0));
+                if (ready != 0)
+                    return ready;
+                if (Clock::now() >= deadline)
+                    break;
+            }
 
-                    std::tie(index, value) = decodeTag(event.tag);
-                    auto handler_          = handlers_.at(index);
-                    auto& evs              = fdHandlers.at(handler_);
-                    evs.push_back(std::move(event));
-                }
+            spinning_.store(false);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            handlers_.forEachHandler([](const std::shared_ptr<Handler>& handler) {
+                handler->onSpin();
+            });
+            return poller.poll(events_);
+        }
 
-                for (auto& data : fdHandlers)
-                {
-                    data.first->onReady(FdSet(std::move(data.second)));
-                }
+        // Only the thread of the loop writes the counters, a plain store
+        // is enough and other threads read them without a lock
+        template <typename T>
+        static void add(std::atomic<T>& counter, uint64_t value)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + static_cast<T>(value),
+                          std::memory_order_relaxed);
+        }
+
+        static void add(std::atomic<int64_t>& counter, Clock::duration duration)
+        {
+            add(counter, static_cast<uint64_t>(
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+        }
+
+        // The events are sorted by handler into buffers that are kept from
+        // one iteration to the next, dispatching does not allocate once they
+        // reached their working size. The end of a handler is the start of
+        // the next, the clock is read once per call
+        void handleFds(Clock::time_point start)
+        {
+            const auto busyStart = start;
+
+            const auto count = handlers_.size();
+            if (ready_.size() < count)
+                ready_.resize(count);
+
+            for (size_t i = 0; i < count; ++i)
+                ready_[i].clear();
+
+            for (const auto& event : events_)
+            {
+                size_t index;
+                uint64_t value;
+
+                std::tie(index, value) = decodeTag(event.tag);
+                // Registered by a handler being added, not published yet.
+                // Level-triggered, the event comes back on the next poll
+                if (index >= count)
+                    continue;
+
+                Polling::Event decoded { Polling::Tag(value) };
+                decoded.flags = event.flags;
+                ready_[index].emplace_back(std::move(decoded));
             }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (ready_[i].empty())
+                    continue;
+
+                FdSet fds(std::move(ready_[i]));
+                handlers_.get(i)->onReady(fds);
+                ready_[i] = std::move(fds).release();
+
+                const auto end     = Clock::now();
+                const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+                add(stats_.handlerCalls, 1);
+                if (elapsed.count() > stats_.maxHandler.load(std::memory_order_relaxed))
+                    stats_.maxHandler.store(elapsed.count(), std::memory_order_relaxed);
+                start = end;
+            }
+
+            add(stats_.busy, start - busyStart);
         }
 
         struct HandlerList
@@ -232,7 +375,7 @@ namespace Pistache::Aio
             // We are using the highest 8 bits of the fd to encode the index of the
             // handler, which gives us a maximum of 2**8 - 1 handler, 255
             static constexpr size_t HandlerBits  = 8;
-            static constexpr size_t HandlerShift = sizeof(uint64_t) - HandlerBits;
+            static constexpr size_t HandlerShift = sizeof(uint64_t) * 8 - HandlerBits;
             static constexpr uint64_t DataMask   = uint64_t(-1) >> HandlerBits;
 
             static constexpr size_t MaxHandlers = (1 << HandlerBits) - 1;
@@ -247,29 +390,17 @@ namespace Pistache::Aio
             HandlerList(const HandlerList& other) = delete;
             HandlerList& operator=(const HandlerList& other) = delete;
 
-            HandlerList(HandlerList&& other) = default;
-            HandlerList& operator=(HandlerList&& other) = default;
-
-            HandlerList clone() const
-            {
-                HandlerList list;
-
-                for (size_t i = 0; i < index_; ++i)
-                {
-                    list.handlers.at(i) = handlers.at(i)->clone();
-                }
-                list.index_ = index_;
-
-                return list;
-            }
-
+            // The slot is filled before the size covers it, for the loop to
+            // read the list without a lock. Writers hold handlersLock_
             Reactor::Key add(const std::shared_ptr<Handler>& handler)
             {
-                if (index_ == MaxHandlers)
+                const size_t index = index_.load(std::memory_order_relaxed);
+                if (index == MaxHandlers)
                     throw std::runtime_error("Maximum handlers reached");
 
-                Reactor::Key key(index_);
-                handlers.at(index_++) = handler;
+                Reactor::Key key(index);
+                handlers.at(index) = handler;
+                index_.store(index + 1, std::memory_order_release);
 
                 return key;
             }
@@ -281,15 +412,18 @@ namespace Pistache::Aio
 
             std::shared_ptr<Handler> at(size_t index) const
             {
-                if (index >= index_)
+                if (index >= size())
                     throw std::runtime_error("Attempting to retrieve invalid handler");
 
                 return handlers.at(index);
             }
 
-            bool empty() const { return index_ == 0; }
+            // Unchecked, for the dispatch of the events
+            Handler* get(size_t index) const { return handlers[index].get(); }
 
-            size_t size() const { return index_; }
+            bool empty() const { return size() == 0; }
+
+            size_t size() const { return index_.load(std::memory_order_acquire); }
 
             static Polling::Tag encodeTag(const Reactor::Key& key, uint64_t value)
             {
@@ -314,21 +448,47 @@ namespace Pistache::Aio
             template <typename Func>
             void forEachHandler(Func func) const
             {
-                for (size_t i = 0; i < index_; ++i)
+                const size_t count = size();
+                for (size_t i = 0; i < count; ++i)
                     func(handlers.at(i));
             }
 
         private:
             std::array<std::shared_ptr<Handler>, MaxHandlers> handlers;
-            size_t index_;
+            std::atomic<size_t> index_;
         };
 
         HandlerList handlers_;
+        std::mutex handlersLock_;
+        // Set once the loop runs, for the handlers added later
+        std::thread::id loopThread_;
+
+        std::vector<Polling::Event> events_;
+        std::vector<std::vector<FdSet::Entry>> ready_;
 
         std::atomic<bool> shutdown_;
         NotifyFd shutdownFd;
 
         Polling::Epoll poller;
+
+        std::chrono::microseconds spin_;
+        std::atomic<bool> spinning_ { false };
+
+        // Counters behind LoopStats, durations in nanoseconds
+        struct Stats
+        {
+            std::atomic<uint64_t> iterations { 0 };
+            std::atomic<uint64_t> events { 0 };
+            std::atomic<uint64_t> maxBatch { 0 };
+            std::atomic<int64_t> waiting { 0 };
+            std::atomic<int64_t> busy { 0 };
+            std::atomic<uint64_t> handlerCalls { 0 };
+            std::atomic<int64_t> maxHandler { 0 };
+            // Steady clock when poll() returned the current batch, zero
+            // while polling
+            std::atomic<Clock::rep> busySince { 0 };
+        };
+        Stats stats_;
     };
 
     /* Asynchronous implementation of the reactor that spawns a number N of threads
@@ -362,7 +522,10 @@ namespace Pistache::Aio
     public:
         static constexpr uint32_t KeyMarker = 0xBADB0B;
 
-        AsyncImpl(Reactor* reactor, size_t threads, const std::string& threadsName)
+        AsyncImpl(Reactor* reactor, size_t threads, const std::string& threadsName,
+                  Polling::Backend backend           = Polling::Backend::Epoll,
+                  const std::vector<CpuSet>& affinity = {},
+                  std::chrono::microseconds spin      = std::chrono::microseconds(0))
             : Reactor::Impl(reactor)
         {
 
@@ -370,28 +533,30 @@ namespace Pistache::Aio
                 throw std::runtime_error("Too many worker threads requested (max "s + std::to_string(SyncImpl::MaxHandlers()) + ")."s);
 
             for (size_t i = 0; i < threads; ++i)
-                workers_.emplace_back(std::make_unique<Worker>(reactor, threadsName));
+            {
+                auto cpus = i < affinity.size() ? affinity[i] : CpuSet();
+                workers_.emplace_back(std::make_unique<Worker>(reactor, threadsName, backend, cpus, spin));
+            }
         }
 
+        // The clones get the same index on every worker, handlers added
+        // concurrently take their turn
         Reactor::Key addHandler(const std::shared_ptr<Handler>& handler,
                                 bool) override
         {
+            std::lock_guard<std::mutex> guard(addLock_);
 
-            std::array<Reactor::Key, SyncImpl::MaxHandlers()> keys;
-
+            const Reactor::Key key(workers_.empty() ? 0 : workers_.front()->sync->handlersCount());
             for (size_t i = 0; i < workers_.size(); ++i)
             {
                 auto& wrk = workers_.at(i);
 
-                auto cl     = handler->clone();
-                auto key    = wrk->sync->addHandler(cl, false /* setKey */);
-                auto newKey = encodeKey(key, static_cast<uint32_t>(i));
-                cl->key_    = newKey;
-
-                keys.at(i) = key;
+                auto cl  = handler->clone();
+                cl->key_ = encodeKey(key, static_cast<uint32_t>(i));
+                wrk->sync->addHandler(cl, false /* setKey */);
             }
 
-            auto data = keys.at(0).data() << 32 | KeyMarker;
+            auto data = key.data() << 32 | KeyMarker;
 
             return Reactor::Key(data);
         }
@@ -456,6 +621,15 @@ namespace Pistache::Aio
                 wrk->shutdown();
         }
 
+        std::vector<LoopStats> loopStats() const override
+        {
+            std::vector<LoopStats> stats;
+            stats.reserve(workers_.size());
+            for (const auto& wrk : workers_)
+                stats.push_back(wrk->sync->stats());
+            return stats;
+        }
+
     private:
         static Reactor::Key encodeKey(const Reactor::Key& originalKey,
                                       uint32_t value)
@@ -492,10 +666,12 @@ namespace Pistache::Aio
         struct Worker
         {
 
-            explicit Worker(Reactor* reactor, const std::string& threadsName)
+            Worker(Reactor* reactor, const std::string& threadsName,
+                   Polling::Backend backend, const CpuSet& cpus, std::chrono::microseconds spin)
                 : thread()
-                , sync(new SyncImpl(reactor))
+                , sync(new SyncImpl(reactor, backend, spin))
                 , threadsName_(threadsName)
+                , cpus_(cpus)
             { }
 
             ~Worker()
@@ -506,12 +682,21 @@ namespace Pistache::Aio
 
             void run()
             {
-                thread = std::thread([=]() {
+                thread = std::thread([this]() {
                     if (!threadsName_.empty())
                     {
                         pthread_setname_np(pthread_self(),
                                            threadsName_.substr(0, 15).c_str());
                     }
+
+                    // Pinned before the handlers touch their buffers, so that
+                    // the kernel places them on the node of the cpu
+                    if (cpus_.count() > 0)
+                    {
+                        auto cpu_set = cpus_.toPosix();
+                        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+                    }
+
                     sync->run();
                 });
             }
@@ -521,9 +706,11 @@ namespace Pistache::Aio
             std::thread thread;
             std::unique_ptr<SyncImpl> sync;
             std::string threadsName_;
+            CpuSet cpus_;
         };
 
         std::vector<std::unique_ptr<Worker>> workers_;
+        std::mutex addLock_;
     };
 
     Reactor::Key::Key()
@@ -620,6 +807,8 @@ namespace Pistache::Aio
 
     void Reactor::runOnce() { impl()->runOnce(); }
 
+    std::vector<LoopStats> Reactor::loopStats() const { return impl()->loopStats(); }
+
     Reactor::Impl* Reactor::impl() const
     {
         if (!impl_)
@@ -631,12 +820,24 @@ namespace Pistache::Aio
 
     Reactor::Impl* SyncContext::makeImpl(Reactor* reactor) const
     {
-        return new SyncImpl(reactor);
+        return new SyncImpl(reactor, backend_);
     }
 
     Reactor::Impl* AsyncContext::makeImpl(Reactor* reactor) const
     {
-        return new AsyncImpl(reactor, threads_, threadsName_);
+        return new AsyncImpl(reactor, threads_, threadsName_, backend_, affinity_, spin_);
+    }
+
+    AsyncContext& AsyncContext::pinWorkers(std::vector<CpuSet> cpus)
+    {
+        affinity_ = std::move(cpus);
+        return *this;
+    }
+
+    AsyncContext& AsyncContext::busyPoll(std::chrono::microseconds spin)
+    {
+        spin_ = spin;
+        return *this;
     }
 
     AsyncContext AsyncContext::singleThreaded() { return AsyncContext(1); }
@@ -0,0 +1,699 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* scan.cc
+
+   Implementation of the byte scanning primitives
+*/
+
+#include <pistache/scan.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PISTACHE_SCAN_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define PISTACHE_SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Pistache::Scan
+{
+
+    namespace
+    {
+        using FindFirstOfFn = const char* (*)(const char*, const char*, const char*, size_t);
+        // The key is already rotated to the phase of the first byte
+        using ApplyMaskFn = void (*)(char*, size_t, uint32_t);
+        // The base 64 kernels go through whole blocks and leave the rest, and
+        // the block holding an invalid character, to the scalar code. They
+        // return the number of bytes, or characters, consumed
+        using Base64EncodeFn = size_t (*)(const uint8_t*, size_t, char*);
+        using Base64DecodeFn = size_t (*)(const char*, size_t, uint8_t*);
+
+        constexpr char Base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                          "abcdefghijklmnopqrstuvwxyz"
+                                          "0123456789+/";
+
+        // The sextet of every character, 0xff outside of the alphabet
+        struct Base64Table
+        {
+            constexpr Base64Table()
+                : values {}
+            {
+                for (auto& value : values)
+                    value = 0xff;
+                for (uint8_t i = 0; i < 64; ++i)
+                    values[static_cast<uint8_t>(Base64Alphabet[i])] = i;
+            }
+
+            uint8_t values[256];
+        };
+
+        constexpr Base64Table Base64Values;
+
+        bool isOneOf(char c, const char* set, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (set[i] == c)
+                    return true;
+            }
+
+            return false;
+        }
+
+        const char* findFirstOfScalar(const char* begin, const char* end,
+                                      const char* set, size_t count)
+        {
+            for (; begin < end; ++begin)
+            {
+                if (isOneOf(*begin, set, count))
+                    return begin;
+            }
+
+            return end;
+        }
+
+        void applyMaskScalar(char* data, size_t size, uint32_t key)
+        {
+            uint64_t wide = (static_cast<uint64_t>(key) << 32) | key;
+            for (; size >= 8; data += 8, size -= 8)
+            {
+                uint64_t word;
+                std::memcpy(&word, data, 8);
+                word ^= wide;
+                std::memcpy(data, &word, 8);
+            }
+
+            const auto* bytes = reinterpret_cast<const uint8_t*>(&key);
+            for (size_t i = 0; i < size; ++i)
+                data[i] = static_cast<char>(data[i] ^ bytes[i & 3]);
+        }
+
+        size_t base64EncodeScalar(const uint8_t* data, size_t size, char* out)
+        {
+            size_t i = 0;
+            for (; size - i >= 3; i += 3, out += 4)
+            {
+                const uint32_t triplet = (static_cast<uint32_t>(data[i]) << 16)
+                    | (static_cast<uint32_t>(data[i + 1]) << 8) | data[i + 2];
+                out[0] = Base64Alphabet[triplet >> 18];
+                out[1] = Base64Alphabet[(triplet >> 12) & 0x3f];
+                out[2] = Base64Alphabet[(triplet >> 6) & 0x3f];
+                out[3] = Base64Alphabet[triplet & 0x3f];
+            }
+
+            return i;
+        }
+
+        size_t base64DecodeScalar(const char* data, size_t size, uint8_t* out)
+        {
+            size_t i = 0;
+            for (; size - i >= 4; i += 4, out += 3)
+            {
+                const auto* chars = reinterpret_cast<const uint8_t*>(data + i);
+                const uint32_t a  = Base64Values.values[chars[0]];
+                const uint32_t b  = Base64Values.values[chars[1]];
+                const uint32_t c  = Base64Values.values[chars[2]];
+                const uint32_t d  = Base64Values.values[chars[3]];
+                if ((a | b | c | d) & 0x80)
+                    break;
+
+                const uint32_t quantum = (a << 18) | (b << 12) | (c << 6) | d;
+                out[0]                 = static_cast<uint8_t>(quantum >> 16);
+                out[1]                 = static_cast<uint8_t>(quantum >> 8);
+                out[2]                 = static_cast<uint8_t>(quantum);
+            }
+
+            return i;
+        }
+
+#ifdef PISTACHE_SCAN_X86
+        // The pshufb based codec of W. Mula and D. Lemire, "Faster Base64
+        // Encoding and Decoding using AVX2 Instructions"
+        __attribute__((target("avx2"))) size_t
+        base64EncodeAvx2(const uint8_t* data, size_t size, char* out)
+        {
+            // Every lane spreads 12 bytes over 16 characters. The load of the
+            // second lane reads 4 bytes past the 24 of the block
+            const __m256i spread = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                                    1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+            // The offset from the sextet to its character, by range
+            const __m256i offsets = _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+                                                     65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+            size_t i = 0;
+            for (; size - i >= 28; i += 24, out += 32)
+            {
+                const __m256i bytes = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 12)), 1);
+                const __m256i in = _mm256_shuffle_epi8(bytes, spread);
+
+                // The 4 sextets of every 3 bytes, one per byte
+                const __m256i ac      = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+                                                           _mm256_set1_epi32(0x04000040));
+                const __m256i bd      = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+                                                           _mm256_set1_epi32(0x01000010));
+                const __m256i sextets = _mm256_or_si256(ac, bd);
+
+                __m256i ranges = _mm256_subs_epu8(sextets, _mm256_set1_epi8(51));
+                ranges         = _mm256_sub_epi8(ranges, _mm256_cmpgt_epi8(sextets, _mm256_set1_epi8(25)));
+                const __m256i chars = _mm256_add_epi8(sextets, _mm256_shuffle_epi8(offsets, ranges));
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chars);
+            }
+
+            return i;
+        }
+
+        __attribute__((target("avx2"))) size_t
+        base64DecodeAvx2(const char* data, size_t size, uint8_t* out)
+        {
+            // A character is valid when the bits of its low and high nibbles
+            // have nothing in common
+            const __m256i lowNibbles  = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                                         0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+                                                         0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                                         0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+            const __m256i highNibbles = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                                         0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+            // The offset from the character to its sextet, by high nibble,
+            // with '/' apart
+            const __m256i offsets = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                     0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+            const __m256i slash   = _mm256_set1_epi8(0x2f);
+            // The 3 bytes of every 4 sextets at the front of every lane, then
+            // the 24 bytes at the front of the register
+            const __m256i pack    = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                     2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+            const __m256i lanes   = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+            size_t i = 0;
+            for (; size - i >= 32; i += 32, out += 24)
+            {
+                const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+
+                const __m256i high = _mm256_and_si256(_mm256_srli_epi32(chars, 4), slash);
+                const __m256i low  = _mm256_and_si256(chars, slash);
+                if (!_mm256_testz_si256(_mm256_shuffle_epi8(lowNibbles, low),
+                                        _mm256_shuffle_epi8(highNibbles, high)))
+                    break;
+
+                const __m256i roll    = _mm256_add_epi8(_mm256_cmpeq_epi8(chars, slash), high);
+                const __m256i sextets = _mm256_add_epi8(chars, _mm256_shuffle_epi8(offsets, roll));
+
+                const __m256i pairs = _mm256_maddubs_epi16(sextets, _mm256_set1_epi32(0x01400140));
+                __m256i bytes       = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+                bytes               = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(bytes, pack), lanes);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(bytes));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16), _mm256_extracti128_si256(bytes, 1));
+            }
+
+            return i;
+        }
+
+        // SSE2 is part of x86-64, it serves the CPUs without AVX2
+        void applyMaskSse2(char* data, size_t size, uint32_t key)
+        {
+            const __m128i mask = _mm_set1_epi32(static_cast<int>(key));
+            for (; size >= 16; data += 16, size -= 16)
+            {
+                auto* block = reinterpret_cast<__m128i*>(data);
+                _mm_storeu_si128(block, _mm_xor_si128(_mm_loadu_si128(block), mask));
+            }
+
+            applyMaskScalar(data, size, key);
+        }
+
+        __attribute__((target("avx2"))) void
+        applyMaskAvx2(char* data, size_t size, uint32_t key)
+        {
+            const __m256i mask = _mm256_set1_epi32(static_cast<int>(key));
+            for (; size >= 32; data += 32, size -= 32)
+            {
+                auto* block = reinterpret_cast<__m256i*>(data);
+                _mm256_storeu_si256(block, _mm256_xor_si256(_mm256_loadu_si256(block), mask));
+            }
+
+            applyMaskSse2(data, size, key);
+        }
+
+        // pcmpestri compares against at most 16 bytes
+        constexpr size_t Sse42MaxSet = 16;
+
+        __attribute__((target("sse4.2"))) const char*
+        findFirstOfSse42(const char* begin, const char* end,
+                         const char* set, size_t count)
+        {
+            if (count > Sse42MaxSet)
+                return findFirstOfScalar(begin, end, set, count);
+
+            char padded[Sse42MaxSet] = {};
+            std::memcpy(padded, set, count);
+
+            const __m128i needles = _mm_loadu_si128(reinterpret_cast<const __m128i*>(padded));
+            const int needlesLen  = static_cast<int>(count);
+
+            constexpr int Mode = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT;
+            for (; end - begin >= 16; begin += 16)
+            {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+                const int index     = _mm_cmpestri(needles, needlesLen, block, 16, Mode);
+                if (index < 16)
+                    return begin + index;
+            }
+
+            return findFirstOfScalar(begin, end, set, count);
+        }
+
+        __attribute__((target("avx2"))) const char*
+        findFirstOfAvx2(const char* begin, const char* end,
+                        const char* set, size_t count)
+        {
+            // Every byte of the set costs a compare, large sets are better
+            // served by pcmpestri
+            if (count > 4)
+                return findFirstOfSse42(begin, end, set, count);
+
+            __m256i needles[4];
+            for (size_t i = 0; i < count; ++i)
+                needles[i] = _mm256_set1_epi8(set[i]);
+
+            for (; end - begin >= 32; begin += 32)
+            {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+
+                __m256i matches = _mm256_setzero_si256();
+                for (size_t i = 0; i < count; ++i)
+                    matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(block, needles[i]));
+
+                const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(matches));
+                if (mask != 0)
+                    return begin + __builtin_ctz(mask);
+            }
+
+            return findFirstOfScalar(begin, end, set, count);
+        }
+#endif /* PISTACHE_SCAN_X86 */
+
+#ifdef PISTACHE_SCAN_NEON
+        const char* findFirstOfNeon(const char* begin, const char* end,
+                                    const char* set, size_t count)
+        {
+            if (count > 4)
+                return findFirstOfScalar(begin, end, set, count);
+
+            uint8x16_t needles[4];
+            for (size_t i = 0; i < count; ++i)
+                needles[i] = vdupq_n_u8(static_cast<uint8_t>(set[i]));
+
+            for (; end - begin >= 16; begin += 16)
+            {
+                const uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(begin));
+
+                uint8x16_t matches = vdupq_n_u8(0);
+                for (size_t i = 0; i < count; ++i)
+                    matches = vorrq_u8(matches, vceqq_u8(block, needles[i]));
+
+                if (vmaxvq_u8(matches) != 0)
+                    return findFirstOfScalar(begin, begin + 16, set, count);
+            }
+
+            return findFirstOfScalar(begin, end, set, count);
+        }
+
+        size_t base64EncodeNeon(const uint8_t* data, size_t size, char* out)
+        {
+            const auto* alphabet     = reinterpret_cast<const uint8_t*>(Base64Alphabet);
+            const uint8x16x4_t table = { { vld1q_u8(alphabet), vld1q_u8(alphabet + 16),
+                                           vld1q_u8(alphabet + 32), vld1q_u8(alphabet + 48) } };
+            const uint8x16_t sixBits = vdupq_n_u8(0x3f);
+
+            size_t i = 0;
+            for (; size - i >= 48; i += 48, out += 64)
+            {
+                // Deinterleaved, the first, second and third bytes of the
+                // triplets
+                const uint8x16x3_t bytes = vld3q_u8(data + i);
+
+                uint8x16x4_t sextets;
+                sextets.val[0] = vshrq_n_u8(bytes.val[0], 2);
+                sextets.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(bytes.val[0], 4), vshrq_n_u8(bytes.val[1], 4)), sixBits);
+                sextets.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(bytes.val[1], 2), vshrq_n_u8(bytes.val[2], 6)), sixBits);
+                sextets.val[3] = vandq_u8(bytes.val[2], sixBits);
+
+                uint8x16x4_t chars;
+                for (int j = 0; j < 4; ++j)
+                    chars.val[j] = vqtbl4q_u8(table, sextets.val[j]);
+                vst4q_u8(reinterpret_cast<uint8_t*>(out), chars);
+            }
+
+            return i;
+        }
+
+        size_t base64DecodeNeon(const char* data, size_t size, uint8_t* out)
+        {
+            // The sextets of the 128 ASCII characters, split over two tables
+            // of 64. Out of range indices look up 0
+            const uint8_t* values   = Base64Values.values;
+            const uint8x16x4_t low  = { { vld1q_u8(values), vld1q_u8(values + 16),
+                                          vld1q_u8(values + 32), vld1q_u8(values + 48) } };
+            const uint8x16x4_t high = { { vld1q_u8(values + 64), vld1q_u8(values + 80),
+                                          vld1q_u8(values + 96), vld1q_u8(values + 112) } };
+            const uint8x16_t half   = vdupq_n_u8(64);
+
+            size_t i = 0;
+            for (; size - i >= 64; i += 64, out += 48)
+            {
+                const uint8x16x4_t chars = vld4q_u8(reinterpret_cast<const uint8_t*>(data + i));
+
+                // Invalid characters look up 0xff, the ones past ASCII have
+                // their top bit set already
+                uint8x16x4_t sextets;
+                uint8x16_t invalid = vdupq_n_u8(0);
+                for (int j = 0; j < 4; ++j)
+                {
+                    sextets.val[j] = vorrq_u8(vqtbl4q_u8(low, chars.val[j]),
+                                              vqtbl4q_u8(high, vsubq_u8(chars.val[j], half)));
+                    invalid        = vorrq_u8(invalid, vorrq_u8(sextets.val[j], chars.val[j]));
+                }
+                if (vmaxvq_u8(invalid) & 0x80)
+                    break;
+
+                uint8x16x3_t bytes;
+                bytes.val[0] = vorrq_u8(vshlq_n_u8(sextets.val[0], 2), vshrq_n_u8(sextets.val[1], 4));
+                bytes.val[1] = vorrq_u8(vshlq_n_u8(sextets.val[1], 4), vshrq_n_u8(sextets.val[2], 2));
+                bytes.val[2] = vorrq_u8(vshlq_n_u8(sextets.val[2], 6), sextets.val[3]);
+                vst3q_u8(out, bytes);
+            }
+
+            return i;
+        }
+
+        void applyMaskNeon(char* data, size_t size, uint32_t key)
+        {
+            const uint8x16_t mask = vreinterpretq_u8_u32(vdupq_n_u32(key));
+            for (; size >= 16; data += 16, size -= 16)
+            {
+                auto* block = reinterpret_cast<uint8_t*>(data);
+                vst1q_u8(block, veorq_u8(vld1q_u8(block), mask));
+            }
+
+            applyMaskScalar(data, size, key);
+        }
+#endif /* PISTACHE_SCAN_NEON */
+
+        ApplyMaskFn maskImplementation(Backend backend)
+        {
+            switch (backend)
+            {
+#ifdef PISTACHE_SCAN_X86
+            case Backend::Sse42:
+                return applyMaskSse2;
+            case Backend::Avx2:
+                return applyMaskAvx2;
+#endif
+#ifdef PISTACHE_SCAN_NEON
+            case Backend::Neon:
+                return applyMaskNeon;
+#endif
+            default:
+                return applyMaskScalar;
+            }
+        }
+
+        // Without a SSSE3 kernel, SSE 4.2 CPUs take the scalar one
+        Base64EncodeFn base64EncodeImplementation(Backend backend)
+        {
+            switch (backend)
+            {
+#ifdef PISTACHE_SCAN_X86
+            case Backend::Avx2:
+                return base64EncodeAvx2;
+#endif
+#ifdef PISTACHE_SCAN_NEON
+            case Backend::Neon:
+                return base64EncodeNeon;
+#endif
+            default:
+                return base64EncodeScalar;
+            }
+        }
+
+        Base64DecodeFn base64DecodeImplementation(Backend backend)
+        {
+            switch (backend)
+            {
+#ifdef PISTACHE_SCAN_X86
+            case Backend::Avx2:
+                return base64DecodeAvx2;
+#endif
+#ifdef PISTACHE_SCAN_NEON
+            case Backend::Neon:
+                return base64DecodeNeon;
+#endif
+            default:
+                return base64DecodeScalar;
+            }
+        }
+
+        FindFirstOfFn implementation(Backend backend)
+        {
+            switch (backend)
+            {
+#ifdef PISTACHE_SCAN_X86
+            case Backend::Sse42:
+                return findFirstOfSse42;
+            case Backend::Avx2:
+                return findFirstOfAvx2;
+#endif
+#ifdef PISTACHE_SCAN_NEON
+            case Backend::Neon:
+                return findFirstOfNeon;
+#endif
+            default:
+                return findFirstOfScalar;
+            }
+        }
+
+        Backend detectBackend()
+        {
+#if defined(PISTACHE_SCAN_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return Backend::Avx2;
+            if (__builtin_cpu_supports("sse4.2"))
+                return Backend::Sse42;
+#elif defined(PISTACHE_SCAN_NEON)
+            return Backend::Neon;
+#endif
+            return Backend::Scalar;
+        }
+
+        struct Dispatch
+        {
+            Dispatch()
+                : backend(detectBackend())
+                , findFirstOf(implementation(backend))
+                , applyMask(maskImplementation(backend))
+                , base64Encode(base64EncodeImplementation(backend))
+                , base64Decode(base64DecodeImplementation(backend))
+            { }
+
+            Backend backend;
+            FindFirstOfFn findFirstOf;
+            ApplyMaskFn applyMask;
+            Base64EncodeFn base64Encode;
+            Base64DecodeFn base64Decode;
+        };
+
+        const Dispatch& dispatch()
+        {
+            static const Dispatch instance;
+            return instance;
+        }
+
+        // The 4 bytes of the key starting at phase, in memory order
+        uint32_t rotatedKey(const uint8_t key[4], size_t phase)
+        {
+            uint8_t bytes[4];
+            for (size_t i = 0; i < 4; ++i)
+                bytes[i] = key[(phase + i) & 3];
+
+            uint32_t rotated;
+            std::memcpy(&rotated, bytes, 4);
+            return rotated;
+        }
+
+        size_t encodeBase64(Base64EncodeFn kernel, const uint8_t* data, size_t size, char* out)
+        {
+            size_t done = kernel(data, size, out);
+            done += base64EncodeScalar(data + done, size - done, out + done / 3 * 4);
+
+            char* next        = out + done / 3 * 4;
+            const size_t rest = size - done;
+            if (rest > 0)
+            {
+                uint32_t triplet = static_cast<uint32_t>(data[done]) << 16;
+                if (rest == 2)
+                    triplet |= static_cast<uint32_t>(data[done + 1]) << 8;
+
+                next[0] = Base64Alphabet[triplet >> 18];
+                next[1] = Base64Alphabet[(triplet >> 12) & 0x3f];
+                next[2] = rest == 2 ? Base64Alphabet[(triplet >> 6) & 0x3f] : '=';
+                next[3] = '=';
+                next += 4;
+            }
+
+            return static_cast<size_t>(next - out);
+        }
+
+        size_t decodeBase64(Base64DecodeFn kernel, const char* data, size_t size, uint8_t* out)
+        {
+            // The padding, if any, completes the last quantum
+            size_t padding = 0;
+            while (padding < 2 && padding < size && data[size - 1 - padding] == '=')
+                ++padding;
+            if (padding > 0 && size % 4 != 0)
+                return Base64Invalid;
+            size -= padding;
+            if (size % 4 == 1)
+                return Base64Invalid;
+
+            size_t done = kernel(data, size, out);
+            done += base64DecodeScalar(data + done, size - done, out + done / 4 * 3);
+
+            uint8_t* next     = out + done / 4 * 3;
+            const size_t rest = size - done;
+            if (rest >= 4)
+                return Base64Invalid;
+
+            if (rest > 0)
+            {
+                const auto* chars = reinterpret_cast<const uint8_t*>(data + done);
+                const uint32_t a  = Base64Values.values[chars[0]];
+                const uint32_t b  = Base64Values.values[chars[1]];
+                const uint32_t c  = rest == 3 ? Base64Values.values[chars[2]] : 0;
+                if ((a | b | c) & 0x80)
+                    return Base64Invalid;
+
+                const uint32_t quantum = (a << 18) | (b << 12) | (c << 6);
+                *next++                = static_cast<uint8_t>(quantum >> 16);
+                if (rest == 3)
+                    *next++ = static_cast<uint8_t>(quantum >> 8);
+            }
+
+            return static_cast<size_t>(next - out);
+        }
+    } // namespace
+
+    Backend activeBackend() { return dispatch().backend; }
+
+    bool isSupported(Backend backend)
+    {
+        switch (backend)
+        {
+        case Backend::Scalar:
+            return true;
+        case Backend::Sse42:
+            return activeBackend() == Backend::Sse42 || activeBackend() == Backend::Avx2;
+        case Backend::Avx2:
+        case Backend::Neon:
+            return activeBackend() == backend;
+        }
+
+        return false;
+    }
+
+    const char* findFirstOf(const char* begin, const char* end,
+                            const char* set, size_t count)
+    {
+        if (count == 1)
+        {
+            const auto* found = static_cast<const char*>(
+                std::memchr(begin, set[0], static_cast<size_t>(end - begin)));
+            return found ? found : end;
+        }
+
+        return dispatch().findFirstOf(begin, end, set, count);
+    }
+
+    const char* findFirstOf(Backend backend, const char* begin, const char* end,
+                            const char* set, size_t count)
+    {
+        if (!isSupported(backend))
+            throw std::invalid_argument("Scan backend is not supported by this CPU");
+
+        return implementation(backend)(begin, end, set, count);
+    }
+
+    size_t applyMask(char* data, size_t size, const uint8_t key[4], size_t phase)
+    {
+        dispatch().applyMask(data, size, rotatedKey(key, phase));
+        return (phase + size) & 3;
+    }
+
+    size_t applyMask(Backend backend, char* data, size_t size, const uint8_t key[4], size_t phase)
+    {
+        if (!isSupported(backend))
+            throw std::invalid_argument("Scan backend is not supported by this CPU");
+
+        maskImplementation(backend)(data, size, rotatedKey(key, phase));
+        return (phase + size) & 3;
+    }
+
+    const char* findCrlf(const char* begin, const char* end)
+    {
+        // memchr already is vectorized, and CR is rare enough in headers that
+        // a hit is almost always the end of the line
+        while (begin < end)
+        {
+            const auto* cr = static_cast<const char*>(
+                std::memchr(begin, '\r', static_cast<size_t>(end - begin)));
+            if (cr == nullptr || cr + 1 == end)
+                break;
+            if (cr[1] == '\n')
+                return cr;
+            begin = cr + 1;
+        }
+
+        return end;
+    }
+
+    size_t base64Encode(const uint8_t* data, size_t size, char* out)
+    {
+        return encodeBase64(dispatch().base64Encode, data, size, out);
+    }
+
+    size_t base64Encode(Backend backend, const uint8_t* data, size_t size, char* out)
+    {
+        if (!isSupported(backend))
+            throw std::invalid_argument("Scan backend is not supported by this CPU");
+
+        return encodeBase64(base64EncodeImplementation(backend), data, size, out);
+    }
+
+    size_t base64Decode(const char* data, size_t size, uint8_t* out)
+    {
+        return decodeBase64(dispatch().base64Decode, data, size, out);
+    }
+
+    size_t base64Decode(Backend backend, const char* data, size_t size, uint8_t* out)
+    {
+        if (!isSupported(backend))
+            throw std::invalid_argument("Scan backend is not supported by this CPU");
+
+        return decodeBase64(base64DecodeImplementation(backend), data, size, out);
+    }
+
+} // namespace Pistache::Scan
@@ -9,10 +9,12 @@
 
 */
 
+#include <pistache/scan.h>
 #include <pistache/stream.h>
 
 #include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <iostream>
 #include <string>
 
@@ -56,9 +58,21 @@ namespace Pistache
 
     size_t RawBuffer::size() const { return length_; }
 
+    SharedBuffer::SharedBuffer(std::string data)
+        : data_(std::make_shared<const std::string>(std::move(data)))
+    { }
+
+    SharedBuffer::SharedBuffer(const char* data, size_t length)
+        : data_(std::make_shared<const std::string>(data, length))
+    { }
+
+    const char* SharedBuffer::data() const { return data_ ? data_->data() : ""; }
+
+    size_t SharedBuffer::size() const { return data_ ? data_->size() : 0; }
+
     FileBuffer::FileBuffer(const std::string& fileName)
         : fileName_(fileName)
-        , fd_(-1)
+        , fd_()
         , size_(0)
     {
         if (fileName.empty())
@@ -80,25 +94,43 @@ namespace Pistache
             throw std::runtime_error("Could not get file stats");
         }
 
-        fd_   = fd;
+        fd_   = own(fd);
         size_ = sb.st_size;
     }
 
-    Fd FileBuffer::fd() const { return fd_; }
+    FileBuffer::FileBuffer(std::shared_ptr<const Fd> file, size_t size, size_t offset)
+        : fileName_()
+        , fd_(std::move(file))
+        , size_(size)
+        , offset_(offset)
+    {
+        if (!fd_ || *fd_ < 0)
+            throw std::runtime_error("Invalid file descriptor");
+    }
+
+    std::shared_ptr<const Fd> FileBuffer::own(Fd fd)
+    {
+        return std::shared_ptr<const Fd>(new Fd(fd), [](const Fd* file) {
+            ::close(*file);
+            delete file;
+        });
+    }
+
+    Fd FileBuffer::fd() const { return fd_ ? *fd_ : -1; }
 
     size_t FileBuffer::size() const { return size_; }
 
     DynamicStreamBuf::DynamicStreamBuf(size_t size, size_t maxSize)
         : data_()
+        , initialSize_(size)
         , maxSize_(maxSize)
     {
         assert(size <= maxSize);
-
-        reserve(size);
     }
 
     DynamicStreamBuf::DynamicStreamBuf(DynamicStreamBuf&& other)
         : data_(std::move(other.data_))
+        , initialSize_(other.initialSize_)
         , maxSize_(other.maxSize_)
     {
         setp(other.pptr(), other.epptr());
@@ -109,8 +141,9 @@ namespace Pistache
     {
         if (&other != this)
         {
-            data_    = std::move(other.data_);
-            maxSize_ = other.maxSize_;
+            data_        = std::move(other.data_);
+            initialSize_ = other.initialSize_;
+            maxSize_     = other.maxSize_;
             setp(other.pptr(), other.epptr());
             other.setp(nullptr, nullptr);
         }
@@ -120,15 +153,24 @@ namespace Pistache
 
     RawBuffer DynamicStreamBuf::buffer() const
     {
+        if (data_.data() == nullptr)
+            return RawBuffer();
         return RawBuffer(data_.data(), pptr() - data_.data());
     }
 
+    PooledBuffer DynamicStreamBuf::detach()
+    {
+        data_.resize(pptr() - data_.data());
+        this->setp(nullptr, nullptr);
+        return std::move(data_);
+    }
+
     size_t DynamicStreamBuf::maxSize() const { return maxSize_; }
 
     void DynamicStreamBuf::clear()
     {
         // reset stream buffer to the whole backing storage.
-        this->setp(data_.data(), data_.data() + data_.size());
+        this->setp(data_.data(), data_.data() + std::min(data_.capacity(), maxSize_));
     }
 
     DynamicStreamBuf::int_type
@@ -136,10 +178,10 @@ namespace Pistache
     {
         if (!traits_type::eq_int_type(ch, traits_type::eof()))
         {
-            const auto size = data_.size();
+            const auto size = static_cast<size_t>(epptr() - data_.data());
             if (size < maxSize_)
             {
-                reserve((size ? size : 1u) * 2);
+                reserve(size ? size * 2 : std::max<size_t>(initialSize_, 1));
                 *pptr() = static_cast<char>(ch);
                 pbump(1);
                 return traits_type::not_eof(ch);
@@ -156,9 +198,12 @@ namespace Pistache
             size = maxSize_;
         }
 
-        const size_t oldSize = data_.size();
-        data_.resize(size);
-        this->setp(data_.data() + oldSize, data_.data() + size);
+        // The blocks come in sizes of the pool, the stream never writes past
+        // the maximum though
+        const size_t used = pptr() - data_.data();
+        data_.resize(used);
+        data_.reserve(size);
+        this->setp(data_.data() + used, data_.data() + std::min(data_.capacity(), maxSize_));
     }
 
     bool StreamCursor::advance(size_t count)
@@ -166,11 +211,7 @@ namespace Pistache
         if (static_cast<ssize_t>(count) > buf->in_avail())
             return false;
 
-        for (size_t i = 0; i < count; ++i)
-        {
-            buf->sbumpc();
-        }
-
+        buf->setArea(buf->begptr(), buf->curptr() + count, buf->endptr());
         return true;
     }
 
@@ -285,6 +326,20 @@ namespace Pistache
         if (cursor.eof())
             return false;
 
+        // Case only matters for letters, delimiters can be searched for as is
+        const bool anyAlpha = std::any_of(chars.begin(), chars.end(), [](char c) {
+            return std::isalpha(static_cast<unsigned char>(c)) != 0;
+        });
+        if (!anyAlpha)
+        {
+            const char* begin = cursor.offset();
+            const char* end   = cursor.buf->endptr();
+            const char* found = Scan::findFirstOf(begin, end, chars.begin(), chars.size());
+
+            cursor.advance(static_cast<size_t>(found - begin));
+            return found != end;
+        }
+
         auto find = [&](char val) {
             for (auto c : chars)
             {
@@ -313,6 +368,16 @@ namespace Pistache
         return false;
     }
 
+    bool match_until_eol(StreamCursor& cursor)
+    {
+        const char* begin = cursor.offset();
+        const char* end   = cursor.buf->endptr();
+        const char* found = Scan::findCrlf(begin, end);
+
+        cursor.advance(static_cast<size_t>(found - begin));
+        return found != end;
+    }
+
     bool match_double(double* val, StreamCursor& cursor)
     {
         // @Todo: strtod does not support a length argument
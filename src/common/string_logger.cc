@@ -11,13 +11,36 @@
    or passed into a Pistache library function as a logging endpoint.
 */
 
+#include <algorithm>
 #include <iostream>
+#include <utility>
 
+#include <pistache/mailbox.h>
 #include <pistache/string_logger.h>
 
 namespace Pistache::Log
 {
 
+    struct AsyncStringLogger::Ring
+    {
+        explicit Ring(size_t capacity)
+            : records(capacity)
+        { }
+
+        RecordRing records;
+
+        // Set once the logger is gone, the thread forgets the ring then
+        std::atomic<bool> closed { false };
+    };
+
+    namespace
+    {
+        std::atomic<uint64_t> nextLoggerId { 0 };
+
+        // Rings of the calling thread, by logger
+        thread_local std::vector<std::pair<uint64_t, std::shared_ptr<void>>> threadRings;
+    } // namespace
+
     void StringToStreamLogger::log(Level level, const std::string& message)
     {
         if (out_ && isEnabledFor(level))
@@ -31,4 +54,130 @@ namespace Pistache::Log
         return static_cast<int>(level) >= static_cast<int>(level_);
     }
 
+    AsyncStringLogger::AsyncStringLogger(Level level, std::ostream* out, size_t ringSize,
+                                         std::chrono::milliseconds interval)
+        : id_(nextLoggerId.fetch_add(1, std::memory_order_relaxed))
+        , level_(level)
+        , out_(out)
+        , ringSize_(ringSize)
+        , interval_(interval)
+    {
+        writer_ = std::thread([this] { run(); });
+    }
+
+    AsyncStringLogger::~AsyncStringLogger()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stop_ = true;
+        }
+        wakeup_.notify_one();
+        writer_.join();
+
+        std::lock_guard<std::mutex> guard(lock_);
+        drain();
+        for (const auto& ring : rings_)
+            ring->closed.store(true, std::memory_order_release);
+    }
+
+    void AsyncStringLogger::log(Level level, const std::string& message)
+    {
+        if (!out_ || !isEnabledFor(level))
+            return;
+
+        if (!ring()->records.push(message))
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool AsyncStringLogger::isEnabledFor(Level level) const
+    {
+        return static_cast<int>(level) >= static_cast<int>(level_);
+    }
+
+    void AsyncStringLogger::flush()
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        drain();
+    }
+
+    AsyncStringLogger::Ring* AsyncStringLogger::ring()
+    {
+        for (const auto& entry : threadRings)
+        {
+            if (entry.first == id_)
+                return static_cast<Ring*>(entry.second.get());
+        }
+
+        // First message of the thread, the rings of the loggers that are
+        // gone are forgotten along the way
+        threadRings.erase(std::remove_if(threadRings.begin(), threadRings.end(),
+                                         [](const auto& entry) {
+                                             return static_cast<Ring*>(entry.second.get())
+                                                 ->closed.load(std::memory_order_acquire);
+                                         }),
+                          threadRings.end());
+
+        auto ring = std::make_shared<Ring>(ringSize_);
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            rings_.push_back(ring);
+        }
+        threadRings.emplace_back(id_, ring);
+        return ring.get();
+    }
+
+    void AsyncStringLogger::run()
+    {
+        std::unique_lock<std::mutex> lock(lock_);
+        while (!stop_)
+        {
+            wakeup_.wait_for(lock, interval_);
+            drain();
+        }
+    }
+
+    void AsyncStringLogger::drain()
+    {
+        batch_.clear();
+        for (auto it = rings_.begin(); it != rings_.end();)
+        {
+            // Its thread is gone, nothing can be pushed to it anymore once
+            // what it holds has been read
+            const bool orphan = it->use_count() == 1;
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            (*it)->records.drain([this](std::string_view message) {
+                batch_.append(message);
+                batch_.push_back('\n');
+            });
+            if (orphan)
+                it = rings_.erase(it);
+            else
+                ++it;
+        }
+
+        if (batch_.empty())
+            return;
+
+        out_->write(batch_.data(), static_cast<std::streamsize>(batch_.size()));
+        out_->flush();
+    }
+
+    const std::string& MessageBuilder::str()
+    {
+        if (stream_)
+            text_ = stream_->str();
+        return text_;
+    }
+
+    std::ostream& MessageBuilder::toStream()
+    {
+        if (!stream_)
+        {
+            stream_ = std::make_unique<std::ostringstream>();
+            *stream_ << text_;
+        }
+        return *stream_;
+    }
+
 } // namespace Pistache::Log
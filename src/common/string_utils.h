@@ -0,0 +1,31 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* string_utils.h
+
+   Helpers shared by the parsers of header values of the server and of the
+   client. Not installed.
+*/
+
+#pragma once
+
+#include <string_view>
+
+namespace Pistache::Http::Private
+{
+
+    // Strips the optional whitespace around a value or a list member, the
+    // spaces and tabs of RFC 9110 section 5.6.3
+    inline std::string_view trim(std::string_view value)
+    {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+            value.remove_prefix(1);
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+            value.remove_suffix(1);
+        return value;
+    }
+
+} // namespace Pistache::Http::Private
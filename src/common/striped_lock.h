@@ -0,0 +1,30 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* striped_lock.h
+
+   The locks of the objects that parse their content on first access from
+   const accessors, the headers and the query of a request. Not installed.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+
+namespace Pistache::Http::Private
+{
+
+    // One of a fixed set of mutexes, picked by the address of an object too
+    // small and too often copied to hold one of its own
+    inline std::mutex& stripedLock(const void* object)
+    {
+        static std::array<std::mutex, 64> locks;
+        return locks[(reinterpret_cast<uintptr_t>(object) >> 6) % locks.size()];
+    }
+
+} // namespace Pistache::Http::Private
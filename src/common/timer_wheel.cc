@@ -0,0 +1,150 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* timer_wheel.cc
+
+   Implementation of the hashed timing wheel
+*/
+
+#include <pistache/timer_wheel.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Pistache
+{
+
+    TimerWheel::TimerWheel(std::chrono::milliseconds resolution, size_t slots,
+                           Clock::time_point now)
+        : slots_(slots)
+        , resolution_(resolution)
+        , origin_(now)
+    {
+        if (resolution.count() <= 0)
+            throw std::invalid_argument("Timer wheel resolution must be positive");
+        if (slots == 0)
+            throw std::invalid_argument("Timer wheel must have at least one slot");
+    }
+
+    TimerWheel::TimerId TimerWheel::schedule(std::chrono::milliseconds delay,
+                                             Callback callback,
+                                             Clock::time_point now)
+    {
+        auto deadline = now + std::max(delay, std::chrono::milliseconds(0));
+
+        // Round up, a timer must never fire before its deadline
+        auto tick = tickOf(deadline);
+        if (origin_ + resolution_ * static_cast<int64_t>(tick) < deadline)
+            ++tick;
+        tick = std::max(tick, currentTick_);
+
+        auto id   = nextId_++;
+        auto slot = static_cast<size_t>(tick % slots_.size());
+
+        auto& entries = slots_[slot];
+        auto it       = entries.insert(entries.end(), Entry { id, deadline, std::move(callback) });
+        index_.emplace(id, std::make_pair(slot, it));
+
+        return id;
+    }
+
+    bool TimerWheel::cancel(TimerId id)
+    {
+        auto it = index_.find(id);
+        if (it == std::end(index_))
+            return false;
+
+        auto [slot, entry] = it->second;
+        slots_[slot].erase(entry);
+        index_.erase(it);
+
+        return true;
+    }
+
+    bool TimerWheel::isScheduled(TimerId id) const
+    {
+        return index_.find(id) != std::end(index_);
+    }
+
+    std::vector<TimerWheel::Callback> TimerWheel::expire(Clock::time_point now)
+    {
+        std::vector<Callback> expired;
+        if (now < origin_)
+            return expired;
+
+        auto target = tickOf(now);
+        if (target < currentTick_)
+            return expired;
+
+        // Past a full rotation every slot has to be visited exactly once
+        auto ticks = std::min<uint64_t>(target - currentTick_ + 1, slots_.size());
+        for (uint64_t i = 0; i < ticks; ++i)
+        {
+            auto slot     = static_cast<size_t>((currentTick_ + i) % slots_.size());
+            auto& entries = slots_[slot];
+
+            for (auto it = entries.begin(); it != entries.end();)
+            {
+                // Timers of a later rotation share the slot
+                if (it->deadline > now)
+                {
+                    ++it;
+                    continue;
+                }
+
+                expired.push_back(std::move(it->callback));
+                index_.erase(it->id);
+                it = entries.erase(it);
+            }
+        }
+
+        currentTick_ = target + 1;
+        return expired;
+    }
+
+    size_t TimerWheel::advance(Clock::time_point now)
+    {
+        auto expired = expire(now);
+        for (auto& callback : expired)
+            callback();
+
+        return expired.size();
+    }
+
+    std::optional<TimerWheel::Clock::duration>
+    TimerWheel::nextTimeout(Clock::time_point now) const
+    {
+        if (index_.empty())
+            return std::nullopt;
+
+        for (uint64_t i = 0; i < slots_.size(); ++i)
+        {
+            auto tick = currentTick_ + i;
+            if (slots_[static_cast<size_t>(tick % slots_.size())].empty())
+                continue;
+
+            auto when = origin_ + resolution_ * static_cast<int64_t>(tick);
+            return std::max(when - now, Clock::duration(0));
+        }
+
+        return std::nullopt;
+    }
+
+    size_t TimerWheel::size() const { return index_.size(); }
+
+    bool TimerWheel::empty() const { return index_.empty(); }
+
+    std::chrono::milliseconds TimerWheel::resolution() const { return resolution_; }
+
+    uint64_t TimerWheel::tickOf(Clock::time_point time) const
+    {
+        if (time < origin_)
+            return 0;
+
+        return static_cast<uint64_t>((time - origin_) / resolution_);
+    }
+
+} // namespace Pistache
@@ -0,0 +1,106 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* tls_session.cc
+
+   Implementation of the in-memory cache of TLS sessions
+*/
+
+#include <pistache/tls_session.h>
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace Pistache::Tcp
+{
+
+    TlsSessionCache::TlsSessionCache(size_t maxSessions, size_t shards)
+    {
+        if (maxSessions == 0 || shards == 0)
+            throw std::invalid_argument("A session cache needs room for sessions");
+
+        shardCount_  = std::min(shards, maxSessions);
+        maxPerShard_ = (maxSessions + shardCount_ - 1) / shardCount_;
+        shards_      = std::make_unique<Shard[]>(shardCount_);
+    }
+
+    void TlsSessionCache::put(const std::string& id, std::string session,
+                              std::chrono::seconds timeout)
+    {
+        auto& shard        = shardOf(id);
+        const auto expires = Clock::now() + timeout;
+
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.entries.find(id);
+        if (it != std::end(shard.entries))
+        {
+            it->second.session = std::move(session);
+            it->second.expires = expires;
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+            return;
+        }
+
+        shard.lru.push_front(id);
+        shard.entries.emplace(id, Entry { std::move(session), expires, shard.lru.begin() });
+
+        while (shard.entries.size() > maxPerShard_)
+        {
+            shard.entries.erase(shard.lru.back());
+            shard.lru.pop_back();
+        }
+    }
+
+    std::optional<std::string> TlsSessionCache::get(const std::string& id)
+    {
+        auto& shard = shardOf(id);
+
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.entries.find(id);
+        if (it == std::end(shard.entries))
+            return std::nullopt;
+
+        if (Clock::now() >= it->second.expires)
+        {
+            shard.lru.erase(it->second.lru);
+            shard.entries.erase(it);
+            return std::nullopt;
+        }
+
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+        return it->second.session;
+    }
+
+    void TlsSessionCache::remove(const std::string& id)
+    {
+        auto& shard = shardOf(id);
+
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto it = shard.entries.find(id);
+        if (it == std::end(shard.entries))
+            return;
+
+        shard.lru.erase(it->second.lru);
+        shard.entries.erase(it);
+    }
+
+    size_t TlsSessionCache::size() const
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < shardCount_; ++i)
+        {
+            std::lock_guard<std::mutex> guard(shards_[i].lock);
+            total += shards_[i].entries.size();
+        }
+        return total;
+    }
+
+    TlsSessionCache::Shard& TlsSessionCache::shardOf(const std::string& id)
+    {
+        return shards_[std::hash<std::string> {}(id) % shardCount_];
+    }
+
+} // namespace Pistache::Tcp
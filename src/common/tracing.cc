@@ -0,0 +1,366 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* tracing.cc
+
+   Timestamps of the phases of the requests, and their export as
+   OpenTelemetry spans
+*/
+
+#include <pistache/tracing.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <utility>
+
+namespace Pistache::Tracing
+{
+
+    namespace
+    {
+        struct Sample
+        {
+            Ticks ticks;
+            std::chrono::steady_clock::time_point steady;
+            uint64_t unixNanos;
+        };
+
+        Sample sample()
+        {
+            Sample sample;
+            sample.ticks     = now();
+            sample.steady    = std::chrono::steady_clock::now();
+            sample.unixNanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                         std::chrono::system_clock::now().time_since_epoch())
+                                                         .count());
+            return sample;
+        }
+
+        // Taken as the library is loaded, the frequency of the TSC is known
+        // from the time elapsed since then
+        const Sample origin = sample();
+
+        constexpr auto CalibrationDelay = std::chrono::milliseconds(10);
+
+        // Traces queued past this many batches are dropped
+        constexpr size_t MaxQueuedBatches = 4;
+
+        std::mt19937_64& generator()
+        {
+            thread_local std::mt19937_64 generator { std::random_device {}() };
+            return generator;
+        }
+
+        template <size_t N>
+        void randomize(std::array<uint8_t, N>& id)
+        {
+            for (size_t i = 0; i < N; i += sizeof(uint64_t))
+            {
+                const auto value = generator()();
+                for (size_t j = 0; j < sizeof(uint64_t) && i + j < N; ++j)
+                    id[i + j] = static_cast<uint8_t>(value >> (8 * j));
+            }
+        }
+
+        template <size_t N>
+        bool isZero(const std::array<uint8_t, N>& id)
+        {
+            return std::all_of(id.begin(), id.end(), [](uint8_t byte) { return byte == 0; });
+        }
+
+        int hexValue(char c)
+        {
+            if (c >= '0' && c <= '9')
+                return c - '0';
+            if (c >= 'a' && c <= 'f')
+                return c - 'a' + 10;
+            return -1;
+        }
+
+        template <size_t N>
+        bool parseHex(std::string_view text, std::array<uint8_t, N>& id)
+        {
+            if (text.size() != 2 * N)
+                return false;
+            for (size_t i = 0; i < N; ++i)
+            {
+                const int high = hexValue(text[2 * i]);
+                const int low  = hexValue(text[2 * i + 1]);
+                if (high < 0 || low < 0)
+                    return false;
+                id[i] = static_cast<uint8_t>(high << 4 | low);
+            }
+            return true;
+        }
+
+        template <size_t N>
+        void writeHex(std::ostream& os, const std::array<uint8_t, N>& id)
+        {
+            static constexpr char Digits[] = "0123456789abcdef";
+            for (auto byte : id)
+                os << Digits[byte >> 4] << Digits[byte & 0xF];
+        }
+
+        void writeString(std::ostream& os, std::string_view value)
+        {
+            os << '"';
+            for (char c : value)
+            {
+                if (c == '"' || c == '\\')
+                    os << '\\' << c;
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    os << escaped;
+                }
+                else
+                    os << c;
+            }
+            os << '"';
+        }
+
+        void writeAttribute(std::ostream& os, const char* key, std::string_view value)
+        {
+            os << "{\"key\":\"" << key << "\",\"value\":{\"stringValue\":";
+            writeString(os, value);
+            os << "}}";
+        }
+    } // namespace
+
+    uint64_t toUnixNanos(Ticks ticks)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        static const double nanosPerTick = [] {
+            const auto elapsed = std::chrono::steady_clock::now() - origin.steady;
+            if (elapsed < CalibrationDelay)
+                std::this_thread::sleep_for(CalibrationDelay - elapsed);
+
+            const auto end   = sample();
+            const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(end.steady - origin.steady);
+            return static_cast<double>(nanos.count()) / static_cast<double>(end.ticks - origin.ticks);
+        }();
+
+        const auto delta = static_cast<int64_t>(ticks - origin.ticks);
+        return origin.unixNanos + static_cast<int64_t>(static_cast<double>(delta) * nanosPerTick);
+#else
+        return origin.unixNanos + (ticks - origin.ticks);
+#endif
+    }
+
+    const char* phaseName(Phase phase)
+    {
+        switch (phase)
+        {
+        case Phase::Accept:
+            return "accept";
+        case Phase::FirstByte:
+            return "first_byte";
+        case Phase::HeadersParsed:
+            return "headers_parsed";
+        case Phase::BodyComplete:
+            return "body_complete";
+        case Phase::Dispatch:
+            return "dispatch";
+        case Phase::Written:
+            return "written";
+        }
+        return "unknown";
+    }
+
+    bool RequestTrace::setParent(std::string_view traceparent)
+    {
+        // version "-" trace-id "-" parent-id "-" flags
+        if (traceparent.size() < 55 || traceparent[2] != '-' || traceparent[35] != '-'
+            || traceparent[52] != '-' || traceparent.substr(0, 2) == "ff")
+            return false;
+
+        std::array<uint8_t, 16> trace;
+        std::array<uint8_t, 8> parent;
+        std::array<uint8_t, 1> version;
+        if (!parseHex(traceparent.substr(0, 2), version) || !parseHex(traceparent.substr(3, 32), trace)
+            || !parseHex(traceparent.substr(36, 16), parent) || isZero(trace) || isZero(parent))
+            return false;
+
+        traceId      = trace;
+        parentSpanId = parent;
+        return true;
+    }
+
+    void RequestTrace::generateIds()
+    {
+        if (isZero(traceId))
+            randomize(traceId);
+        randomize(spanId);
+    }
+
+    OtlpExporter::OtlpExporter(Sink sink, std::string serviceName, size_t batchSize,
+                               std::chrono::milliseconds interval)
+        : sink_(std::move(sink))
+        , serviceName_(std::move(serviceName))
+        , batchSize_(std::max<size_t>(batchSize, 1))
+        , interval_(interval)
+    {
+        thread_ = std::thread([this] { run(); });
+    }
+
+    OtlpExporter::~OtlpExporter()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stop_ = true;
+        }
+        wakeup_.notify_one();
+        thread_.join();
+    }
+
+    void OtlpExporter::onTrace(RequestTrace trace)
+    {
+        std::unique_lock<std::mutex> lock(lock_);
+        if (queue_.size() >= batchSize_ * MaxQueuedBatches)
+        {
+            lock.unlock();
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        queue_.push_back(std::move(trace));
+        const bool full = queue_.size() >= batchSize_;
+        lock.unlock();
+
+        if (full)
+            wakeup_.notify_one();
+    }
+
+    void OtlpExporter::flush()
+    {
+        std::unique_lock<std::mutex> lock(lock_);
+        exportQueued(lock);
+    }
+
+    void OtlpExporter::run()
+    {
+        std::unique_lock<std::mutex> lock(lock_);
+        while (!stop_)
+        {
+            wakeup_.wait_for(lock, interval_, [this] { return stop_ || queue_.size() >= batchSize_; });
+            exportQueued(lock);
+        }
+        exportQueued(lock);
+    }
+
+    void OtlpExporter::exportQueued(std::unique_lock<std::mutex>& lock)
+    {
+        if (queue_.empty())
+            return;
+
+        std::vector<RequestTrace> traces;
+        traces.swap(queue_);
+        lock.unlock();
+
+        {
+            std::lock_guard<std::mutex> guard(sinkLock_);
+            for (size_t first = 0; first < traces.size(); first += batchSize_)
+            {
+                const auto last = std::min(first + batchSize_, traces.size());
+                const std::vector<RequestTrace> batch(std::make_move_iterator(traces.begin() + first),
+                                                      std::make_move_iterator(traces.begin() + last));
+                try
+                {
+                    sink_(toJson(batch, serviceName_));
+                    exported_.fetch_add(batch.size(), std::memory_order_relaxed);
+                }
+                catch (const std::exception&)
+                {
+                    dropped_.fetch_add(batch.size(), std::memory_order_relaxed);
+                }
+            }
+        }
+
+        lock.lock();
+    }
+
+    std::string OtlpExporter::toJson(const std::vector<RequestTrace>& traces,
+                                     const std::string& serviceName)
+    {
+        std::ostringstream os;
+        os << "{\"resourceSpans\":[{\"resource\":{\"attributes\":[";
+        writeAttribute(os, "service.name", serviceName);
+        os << "]},\"scopeSpans\":[{\"scope\":{\"name\":\"pistache\"},\"spans\":[";
+
+        for (size_t i = 0; i < traces.size(); ++i)
+        {
+            const auto& trace = traces[i];
+            if (i > 0)
+                os << ',';
+
+            // From the first phase reached to the last
+            Ticks start = 0, end = 0;
+            for (auto ticks : trace.at)
+            {
+                if (ticks == 0)
+                    continue;
+                if (start == 0 || ticks < start)
+                    start = ticks;
+                end = std::max(end, ticks);
+            }
+
+            os << "{\"traceId\":\"";
+            writeHex(os, trace.traceId);
+            os << "\",\"spanId\":\"";
+            writeHex(os, trace.spanId);
+            os << '"';
+            if (!isZero(trace.parentSpanId))
+            {
+                os << ",\"parentSpanId\":\"";
+                writeHex(os, trace.parentSpanId);
+                os << '"';
+            }
+
+            os << ",\"name\":";
+            writeString(os, Http::methodString(trace.method));
+            // SPAN_KIND_SERVER
+            os << ",\"kind\":2"
+               << ",\"startTimeUnixNano\":\"" << (start ? toUnixNanos(start) : 0) << '"'
+               << ",\"endTimeUnixNano\":\"" << (end ? toUnixNanos(end) : 0) << '"';
+
+            os << ",\"attributes\":[";
+            writeAttribute(os, "http.request.method", Http::methodString(trace.method));
+            os << ',';
+            writeAttribute(os, "url.path", trace.resource);
+            os << ',';
+            writeAttribute(os, "network.protocol.version",
+                           trace.version == Http::Version::Http10 ? "1.0" : "1.1");
+            os << ",{\"key\":\"http.response.status_code\",\"value\":{\"intValue\":\""
+               << static_cast<int>(trace.status) << "\"}}]";
+
+            os << ",\"events\":[";
+            bool first = true;
+            for (size_t phase = 0; phase < PhasesCount; ++phase)
+            {
+                if (trace.at[phase] == 0)
+                    continue;
+                if (!first)
+                    os << ',';
+                first = false;
+                os << "{\"timeUnixNano\":\"" << toUnixNanos(trace.at[phase]) << "\",\"name\":\""
+                   << phaseName(static_cast<Phase>(phase)) << "\"}";
+            }
+            os << ']';
+
+            // STATUS_CODE_ERROR for the server errors and the responses that
+            // could not be written, unset otherwise
+            const bool failed = !trace.written || static_cast<int>(trace.status) >= 500;
+            os << ",\"status\":{" << (failed ? "\"code\":2" : "") << "}}";
+        }
+
+        os << "]}]}]}";
+        return os.str();
+    }
+
+} // namespace Pistache::Tracing
@@ -11,24 +11,56 @@
 
 */
 
+#include <fcntl.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
 #include <sys/sendfile.h>
+#include <sys/socket.h>
 #include <sys/timerfd.h>
+#include <sys/uio.h>
 
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+#include <pistache/buffer_pool.h>
 #include <pistache/os.h>
 #include <pistache/peer.h>
 #include <pistache/tcp.h>
+#include <pistache/tracing.h>
 #include <pistache/transport.h>
 #include <pistache/utils.h>
 
+#ifdef PISTACHE_USE_SSL
+
+#include <openssl/err.h>
+
+#endif /* PISTACHE_USE_SSL */
+
 namespace Pistache::Tcp
 {
     using namespace Polling;
 
     Transport::Transport(const std::shared_ptr<Tcp::Handler>& handler)
+        : anchor_(std::make_shared<Anchor>())
     {
+        anchor_->transport = this;
         init(handler);
     }
 
+    Transport::~Transport()
+    {
+        {
+            std::lock_guard<std::mutex> guard(anchor_->lock);
+            anchor_->transport = nullptr;
+        }
+
+        if (wheelTimerFd_ != -1)
+            close(wheelTimerFd_);
+    }
+
     void Transport::init(const std::shared_ptr<Tcp::Handler>& handler)
     {
         handler_ = handler;
@@ -37,12 +69,123 @@ namespace Pistache::Tcp
 
     std::shared_ptr<Aio::Handler> Transport::clone() const
     {
-        return std::make_shared<Transport>(handler_->clone());
+        auto transport = std::make_shared<Transport>(handler_->clone());
+        transport->setMaxReceiveBufferSize(maxRecvBufferSize_);
+        transport->setSendFileBudget(sendFileBudget_);
+        transport->setFilePrefetcher(prefetcher_);
+        transport->setMaxPeers(maxPeers_);
+        transport->setIdleEviction(idleEviction_);
+        transport->setZeroCopyThreshold(zeroCopyThreshold_);
+        transport->setSocketBusyPoll(socketBusyPoll_);
+        transport->setBufferPool(bufferPoolBytes_);
+        return transport;
     }
 
     void Transport::flush()
     {
+        if (!isInTransportThread())
+        {
+            post([this] { flush(); });
+            return;
+        }
+
+        handleWriteQueue(true);
+        if (corking_)
+            return;
+
+        std::vector<Fd> pending;
+        peers.forEach([&](Fd fd, const std::shared_ptr<Peer>& peer) {
+            if (!peer->writeQueue_.empty())
+                pending.push_back(fd);
+        });
+        for (auto fd : pending)
+            asyncWriteImpl(fd);
+    }
+
+    void Transport::flush(Fd fd)
+    {
+        if (!isInTransportThread())
+        {
+            post([this, fd] { flush(fd); });
+            return;
+        }
+
         handleWriteQueue(true);
+        if (!corking_)
+            asyncWriteImpl(fd);
+    }
+
+    void Transport::setAutoCork(bool enabled) { autoCork_ = enabled; }
+
+    bool Transport::autoCork() const { return autoCork_; }
+
+    void Transport::setSendFileBudget(size_t bytes)
+    {
+        if (bytes == 0)
+            throw std::invalid_argument("Send file budget must be positive");
+
+        sendFileBudget_ = bytes;
+    }
+
+    size_t Transport::sendFileBudget() const { return sendFileBudget_; }
+
+    void Transport::setBufferPool(size_t bytes) { bufferPoolBytes_ = bytes; }
+
+    size_t Transport::bufferPool() const { return bufferPoolBytes_; }
+
+    void Transport::setFilePrefetcher(std::shared_ptr<FilePrefetcher> prefetcher)
+    {
+        prefetcher_ = std::move(prefetcher);
+    }
+
+    const std::shared_ptr<FilePrefetcher>& Transport::filePrefetcher() const
+    {
+        return prefetcher_;
+    }
+
+    void Transport::setSslHandshakeTimeout(std::chrono::milliseconds timeout)
+    {
+        sslHandshakeTimeout_ = timeout;
+    }
+
+    void Transport::setMaxReceiveBufferSize(size_t size)
+    {
+        if (size == 0)
+            throw std::invalid_argument("Receive buffer size must be positive");
+
+        maxRecvBufferSize_ = size;
+        recvBuffer_.clear();
+    }
+
+    size_t Transport::peerCount() const
+    {
+        return peerCount_.load(std::memory_order_relaxed);
+    }
+
+    TlsHandshakes Transport::tlsHandshakes() const
+    {
+        TlsHandshakes count;
+        count.full    = fullHandshakes_.load(std::memory_order_relaxed);
+        count.resumed = resumedHandshakes_.load(std::memory_order_relaxed);
+        return count;
+    }
+
+    TransportStats Transport::stats() const
+    {
+        TransportStats stats;
+        stats.queuedWrites      = queuedWrites_.load(std::memory_order_relaxed);
+        stats.queuedTimers      = queuedTimers_.load(std::memory_order_relaxed);
+        stats.queuedPeers       = queuedPeers_.load(std::memory_order_relaxed);
+        stats.pendingWriteBytes = pendingWriteBytes_.load(std::memory_order_relaxed);
+        stats.evictedPeers      = evictedPeers_.load(std::memory_order_relaxed);
+        stats.zeroCopySends     = zeroCopySends_.load(std::memory_order_relaxed);
+        stats.zeroCopyCopied    = zeroCopyCopied_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    size_t Transport::maxReceiveBufferSize() const
+    {
+        return maxRecvBufferSize_;
     }
 
     void Transport::registerPoller(Polling::Epoll& poller)
@@ -50,33 +193,180 @@ namespace Pistache::Tcp
         writesQueue.bind(poller);
         timersQueue.bind(poller);
         peersQueue.bind(poller);
+        tasksQueue.bind(poller);
         notifier.bind(poller);
+
+        // The hot ones, the timers and the tasks still wake the loop up
+        writesQueue.setSpinFlag(spinning());
+        peersQueue.setSpinFlag(spinning());
+
+        wheelTimerFd_ = TRY_RET(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC));
+        poller.addFd(wheelTimerFd_, Flags<Polling::NotifyOn>(NotifyOn::Read),
+                     Polling::Tag(wheelTimerFd_));
+
+        std::unique_lock<std::mutex> lock(wheelLock_);
+        armWheelTimer(lock);
+
+        // Filled from the thread of the transport, its pool is its own
+        if (bufferPoolBytes_ > 0)
+            post([bytes = bufferPoolBytes_] { BufferPool::reserve(bytes); });
     }
 
     void Transport::handleNewPeer(const std::shared_ptr<Tcp::Peer>& peer)
     {
+        peerCount_.fetch_add(1, std::memory_order_relaxed);
+
         auto ctx                   = context();
         const bool isInRightThread = std::this_thread::get_id() == ctx.thread();
         if (!isInRightThread)
         {
             PeerEntry entry(peer);
+            queuedPeers_.fetch_add(1, std::memory_order_relaxed);
             peersQueue.push(std::move(entry));
         }
         else
         {
             handlePeer(peer);
         }
-        int fd = peer->fd();
+    }
+
+    void Transport::setListenSocket(Fd fd, Acceptor acceptor)
+    {
+        listenFd_ = fd;
+        acceptor_ = std::move(acceptor);
+
+        reactor()->registerFd(key(), fd, NotifyOn::Read);
+    }
+
+    void Transport::setMaxPeers(size_t value) { maxPeers_ = value; }
+
+    void Transport::setSocketBusyPoll(std::chrono::microseconds budget)
+    {
+        socketBusyPoll_ = budget;
+    }
+
+    std::chrono::microseconds Transport::socketBusyPoll() const { return socketBusyPoll_; }
+
+    size_t Transport::maxPeers() const { return maxPeers_; }
+
+    void Transport::setIdleEviction(size_t peers) { idleEviction_ = peers; }
+
+    void Transport::setZeroCopyThreshold(size_t bytes)
+    {
+        zeroCopyThreshold_ = bytes == 0 ? 0 : std::max(bytes, Const::MinZeroCopySize);
+    }
+
+    size_t Transport::zeroCopyThreshold() const { return zeroCopyThreshold_; }
+
+    size_t Transport::idleEviction() const { return idleEviction_; }
+
+    void Transport::touchPeer(Peer& peer)
+    {
+        if (lruHead_ == &peer)
+            return;
+
+        unlinkPeer(peer);
+        peer.lruNext_ = lruHead_;
+        if (lruHead_)
+            lruHead_->lruPrev_ = &peer;
+        lruHead_ = &peer;
+        if (!lruTail_)
+            lruTail_ = &peer;
+    }
+
+    void Transport::unlinkPeer(Peer& peer)
+    {
+        if (peer.lruPrev_)
+            peer.lruPrev_->lruNext_ = peer.lruNext_;
+        else if (lruHead_ == &peer)
+            lruHead_ = peer.lruNext_;
+        else
+            return;
+
+        if (peer.lruNext_)
+            peer.lruNext_->lruPrev_ = peer.lruPrev_;
+        else
+            lruTail_ = peer.lruPrev_;
+
+        peer.lruPrev_ = nullptr;
+        peer.lruNext_ = nullptr;
+    }
+
+    bool Transport::evictIdlePeer()
+    {
+        if (idleEviction_ == 0)
+            return false;
+
+        for (auto* peer = lruTail_; peer != nullptr; peer = peer->lruPrev_)
         {
-            Guard guard(toWriteLock);
-            toWrite.emplace(fd, std::deque<WriteEntry> {});
+            if (!peer->isIdle() || peer->handshakePending_)
+                continue;
+
+            auto* entry = peers.find(peer->fd());
+            if (entry == nullptr || entry->get() != peer)
+                continue;
+
+            // Held, the entry of the table goes away along with the peer
+            auto evicted = *entry;
+            evictedPeers_.fetch_add(1, std::memory_order_relaxed);
+            handlePeerDisconnection(evicted);
+            return true;
         }
+        return false;
+    }
+
+    void Transport::drain()
+    {
+        post([this] {
+            if (draining_)
+                return;
+            draining_ = true;
+
+            // The socket belongs to the listener, it is only left alone
+            if (listenFd_ != -1)
+            {
+                if (!acceptPaused_)
+                    reactor()->removeFd(key(), listenFd_);
+                listenFd_     = -1;
+                acceptPaused_ = false;
+            }
+            closeIdlePeers();
+        });
+    }
+
+    void Transport::closeIdlePeers()
+    {
+        // How often the peers still busy are looked at again
+        static constexpr std::chrono::milliseconds DrainPoll { 20 };
+
+        std::vector<std::shared_ptr<Peer>> idle;
+        peers.forEach([&](Fd, const std::shared_ptr<Peer>& peer) {
+            if ((peer->isIdle() || !peer->received_) && !peer->handshakePending_
+                && peer->writeQueue_.empty())
+                idle.push_back(peer);
+        });
+        for (const auto& peer : idle)
+            handlePeerDisconnection(peer);
+
+        if (peerCount() > 0)
+            scheduleTimer(DrainPoll, [this] { closeIdlePeers(); });
     }
 
     void Transport::onReady(const Aio::FdSet& fds)
     {
+        corking_ = autoCork_;
+
         for (const auto& entry : fds)
         {
+            // The error queue holds the completions of the sends without a
+            // copy, or the socket failed and the read that follows tells
+            if (entry.isError() && isPeerFd(entry.getTag()))
+            {
+                auto& peer = getPeer(entry.getTag());
+                if (peer->zeroCopy_ == Peer::ZeroCopy::Enabled)
+                    reapZeroCopy(*peer);
+            }
+
             if (entry.getTag() == writesQueue.tag())
             {
                 handleWriteQueue();
@@ -89,10 +379,22 @@ namespace Pistache::Tcp
             {
                 handlePeerQueue();
             }
+            else if (entry.getTag() == tasksQueue.tag())
+            {
+                handleTaskQueue();
+            }
             else if (entry.getTag() == notifier.tag())
             {
                 handleNotify();
             }
+            else if (wheelTimerFd_ != -1 && entry.getTag() == Polling::Tag(wheelTimerFd_))
+            {
+                handleWheelTimer();
+            }
+            else if (listenFd_ != -1 && entry.getTag() == Polling::Tag(listenFd_))
+            {
+                handleListenSocket();
+            }
 
             else if (entry.isReadable())
             {
@@ -100,14 +402,19 @@ namespace Pistache::Tcp
                 if (isPeerFd(tag))
                 {
                     auto& peer = getPeer(tag);
-                    handleIncoming(peer);
+                    if (peer->handshakePending_)
+                    {
+                        handleHandshake(std::shared_ptr<Peer>(peer));
+                    }
+                    else
+                    {
+                        handleIncoming(peer);
+                    }
                 }
                 else if (isTimerFd(tag))
                 {
-                    auto it      = timers.find(static_cast<decltype(timers)::key_type>(tag.value()));
-                    auto& entry_ = it->second;
-                    handleTimer(std::move(entry_));
-                    timers.erase(it->first);
+                    auto timer = timers.take(static_cast<Fd>(tag.value()));
+                    handleTimer(std::move(*timer));
                 }
             }
             else if (entry.isWritable())
@@ -115,56 +422,246 @@ namespace Pistache::Tcp
                 auto tag = entry.getTag();
                 auto fd  = static_cast<Fd>(tag.value());
 
+                if (isPeerFd(tag) && getPeer(tag)->handshakePending_)
                 {
-                    Guard guard(toWriteLock);
-                    auto it = toWrite.find(fd);
-                    if (it == std::end(toWrite))
-                    {
-                        throw std::runtime_error(
-                            "Assertion Error: could not find write data");
-                    }
+                    handleHandshake(std::shared_ptr<Peer>(getPeer(tag)));
+                    continue;
                 }
 
+                if (!isPeerFd(tag))
+                    continue;
+
                 reactor()->modifyFd(key(), fd, NotifyOn::Read, Polling::Mode::Edge);
 
                 // Try to drain the queue
                 asyncWriteImpl(fd);
             }
         }
+
+        if (corking_)
+        {
+            corking_ = false;
+            flushCorked();
+        }
+    }
+
+    void Transport::onSpin()
+    {
+        if (writesQueue.empty() && peersQueue.empty())
+            return;
+
+        corking_ = autoCork_;
+        handleWriteQueue();
+        handlePeerQueue();
+        if (corking_)
+        {
+            corking_ = false;
+            flushCorked();
+        }
+    }
+
+    void Transport::flushCorked()
+    {
+        // Nothing gets corked anymore, what the writes resolve runs with the
+        // regular write path
+        for (auto fd : corked_)
+            asyncWriteImpl(fd);
+        corked_.clear();
+    }
+
+    TimerWheel::TimerId Transport::scheduleTimer(std::chrono::milliseconds delay,
+                                                 TimerWheel::Callback callback)
+    {
+        std::unique_lock<std::mutex> lock(wheelLock_);
+
+        auto id = wheel_.schedule(delay, std::move(callback));
+        armWheelTimer(lock);
+
+        return id;
+    }
+
+    bool Transport::cancelTimer(TimerWheel::TimerId id)
+    {
+        // The timerfd is left armed, an early wake-up simply finds nothing to
+        // expire and re-arms it for the next timer
+        std::lock_guard<std::mutex> guard(wheelLock_);
+        return wheel_.cancel(id);
+    }
+
+    bool Transport::isTimerScheduled(TimerWheel::TimerId id) const
+    {
+        std::lock_guard<std::mutex> guard(wheelLock_);
+        return wheel_.isScheduled(id);
+    }
+
+    void Transport::post(std::function<void()> task)
+    {
+        tasksQueue.push(std::move(task));
+    }
+
+    bool Transport::isInTransportThread() const
+    {
+        return std::this_thread::get_id() == context().thread();
+    }
+
+    Peer* Transport::findPeer(PeerHandle handle) const
+    {
+        const auto* peer = peers.find(handle.fd);
+        if (peer == nullptr || (*peer)->getID() != handle.id)
+            return nullptr;
+        return peer->get();
+    }
+
+    bool Transport::Poster::operator()(std::function<void()> task) const
+    {
+        if (!anchor_)
+            return false;
+
+        std::lock_guard<std::mutex> guard(anchor_->lock);
+        if (anchor_->transport == nullptr)
+            return false;
+
+        anchor_->transport->post(std::move(task));
+        return true;
+    }
+
+    bool Transport::Dispatcher::operator()(std::function<void()> task) const
+    {
+        if (!anchor_)
+            return false;
+
+        {
+            std::lock_guard<std::mutex> guard(anchor_->lock);
+            if (anchor_->transport == nullptr)
+                return false;
+
+            if (!anchor_->transport->isInTransportThread())
+            {
+                anchor_->transport->post(std::move(task));
+                return true;
+            }
+        }
+
+        // The transport is not destroyed while its own thread runs
+        task();
+        return true;
+    }
+
+    bool Transport::Poster::alive() const
+    {
+        if (!anchor_)
+            return false;
+
+        std::lock_guard<std::mutex> guard(anchor_->lock);
+        return anchor_->transport != nullptr;
+    }
+
+    void Transport::handleWheelTimer()
+    {
+        uint64_t wakeups;
+        (void)::read(wheelTimerFd_, &wakeups, sizeof wakeups);
+
+        std::vector<TimerWheel::Callback> expired;
+        {
+            std::unique_lock<std::mutex> lock(wheelLock_);
+            wheelArmedAt_.reset();
+
+            expired = wheel_.expire();
+            armWheelTimer(lock);
+        }
+
+        for (auto& callback : expired)
+            callback();
+    }
+
+    void Transport::armWheelTimer(std::unique_lock<std::mutex>& /*lock*/)
+    {
+        if (wheelTimerFd_ == -1)
+            return;
+
+        auto now   = TimerWheel::Clock::now();
+        auto delay = wheel_.nextTimeout(now);
+        if (!delay)
+            return;
+
+        // Only move the timer earlier, a later wake-up would be missed
+        auto when = now + *delay;
+        if (wheelArmedAt_ && *wheelArmedAt_ <= when)
+            return;
+
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(*delay);
+        ns      = std::max(ns, std::chrono::nanoseconds(1));
+
+        itimerspec spec {};
+        spec.it_value.tv_sec  = static_cast<time_t>(ns.count() / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(ns.count() % 1000000000);
+
+        TRY(timerfd_settime(wheelTimerFd_, 0, &spec, nullptr));
+        wheelArmedAt_ = when;
     }
 
     void Transport::disarmTimer(Fd fd)
     {
-        auto it = timers.find(fd);
-        if (it == std::end(timers))
+        auto* entry = timers.find(fd);
+        if (entry == nullptr)
             throw std::runtime_error("Timer has not been armed");
 
-        auto& entry = it->second;
-        entry.disable();
+        entry->disable();
     }
 
     void Transport::handleIncoming(const std::shared_ptr<Peer>& peer)
     {
-        char buffer[Const::MaxBuffer] = { 0 };
+        if (splices_.contains(peer->fd()))
+        {
+            handleSplice(peer);
+            return;
+        }
+
+        // Edge triggered, the readiness is lost until resumeReading() reads
+        if (peer->readPaused_)
+            return;
+
+        peer->received_ = true;
+        if (idleEviction_ > 0)
+            touchPeer(*peer);
 
-        ssize_t totalBytes = 0;
-        int fd             = peer->fd();
+        if (recvBuffer_.empty())
+            recvBuffer_.resize(std::min(Const::MaxBuffer, maxRecvBufferSize_));
+
+        size_t totalBytes = 0;
+        int fd            = peer->fd();
 
         for (;;)
         {
+            if (totalBytes == recvBuffer_.size())
+            {
+                // More data is probably pending, hand over what we have and
+                // read the rest in a bigger buffer
+                handler_->onInput(recvBuffer_.data(), totalBytes, peer);
+                totalBytes = 0;
+
+                if (peer->readPaused_ || splices_.contains(fd))
+                    break;
+
+                if (recvBuffer_.size() < maxRecvBufferSize_)
+                    recvBuffer_.resize(std::min(recvBuffer_.size() * 2, maxRecvBufferSize_));
+            }
+
+            char* buffer     = recvBuffer_.data() + totalBytes;
+            size_t available = recvBuffer_.size() - totalBytes;
 
             ssize_t bytes;
 
 #ifdef PISTACHE_USE_SSL
             if (peer->ssl() != NULL)
             {
-                bytes = SSL_read((SSL*)peer->ssl(), buffer + totalBytes,
-                                 static_cast<int>(Const::MaxBuffer - totalBytes));
+                bytes = SSL_read((SSL*)peer->ssl(), buffer,
+                                 static_cast<int>(std::min<size_t>(available, INT_MAX)));
             }
             else
             {
 #endif /* PISTACHE_USE_SSL */
-                bytes = recv(fd, buffer + totalBytes, Const::MaxBuffer - totalBytes, 0);
+                bytes = recv(fd, buffer, available, 0);
 #ifdef PISTACHE_USE_SSL
             }
 #endif /* PISTACHE_USE_SSL */
@@ -175,7 +672,7 @@ namespace Pistache::Tcp
                 {
                     if (totalBytes > 0)
                     {
-                        handler_->onInput(buffer, totalBytes, peer);
+                        handler_->onInput(recvBuffer_.data(), totalBytes, peer);
                     }
                 }
                 else
@@ -186,15 +683,235 @@ namespace Pistache::Tcp
             }
             else if (bytes == 0)
             {
+                if (totalBytes > 0)
+                {
+                    handler_->onInput(recvBuffer_.data(), totalBytes, peer);
+                }
                 handlePeerDisconnection(peer);
                 break;
             }
 
             else
             {
-                handler_->onInput(buffer, bytes, peer);
+#ifdef PISTACHE_USE_TRACING
+                if (peer->firstByteAt_ == 0)
+                    PISTACHE_TRACE_MARK(peer->firstByteAt_);
+#endif
+                totalBytes += static_cast<size_t>(bytes);
+            }
+        }
+    }
+
+    void Transport::pauseReading(const std::shared_ptr<Peer>& peer)
+    {
+        peer->readPaused_ = true;
+    }
+
+    void Transport::resumeReading(const std::shared_ptr<Peer>& peer)
+    {
+        if (!peer->readPaused_)
+            return;
+
+        peer->readPaused_ = false;
+
+        // The peer may have been removed while paused
+        auto* current = peers.find(peer->fd());
+        if (current != nullptr && *current == peer)
+            handleIncoming(peer);
+    }
+
+    bool Transport::spliceToFile(const std::shared_ptr<Peer>& peer,
+                                 std::shared_ptr<const Fd> file, size_t bytes,
+                                 SpliceProgress progress)
+    {
+        if (peer->ssl() != nullptr || splices_.contains(peer->fd()))
+            return false;
+
+        int pipeFds[2];
+        if (::pipe2(pipeFds, O_NONBLOCK | O_CLOEXEC) == -1)
+            return false;
+
+        Splice splice;
+        splice.file      = std::move(file);
+        splice.pipeOut   = FileBuffer::own(pipeFds[0]);
+        splice.pipeIn    = FileBuffer::own(pipeFds[1]);
+        splice.remaining = bytes;
+        splice.progress  = std::move(progress);
+        splices_.insert(peer->fd(), std::move(splice));
+
+        // The bytes may already wait in the socket, their readiness has been
+        // consumed by the read that got the ones before them
+        post([this, weak = std::weak_ptr<Peer>(peer)] {
+            auto peer = weak.lock();
+            if (!peer)
+                return;
+            auto* current = peers.find(peer->fd());
+            if (current != nullptr && *current == peer && splices_.contains(peer->fd()))
+                handleSplice(peer);
+        });
+        return true;
+    }
+
+    void Transport::handleSplice(const std::shared_ptr<Peer>& peer)
+    {
+        // Large enough for the default size of a pipe
+        static constexpr size_t SpliceChunk = 64 * 1024;
+
+        const Fd fd  = peer->fd();
+        auto* splice = splices_.find(fd);
+
+        const size_t before = splice->remaining;
+        bool fileFailed     = false;
+        bool peerFailed     = false;
+        for (;;)
+        {
+            // The pipe is emptied into the file before more is taken in
+            while (splice->inPipe > 0)
+            {
+                auto written = ::splice(*splice->pipeOut, nullptr, *splice->file, nullptr,
+                                        splice->inPipe, SPLICE_F_MOVE);
+                if (written == -1 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                {
+                    fileFailed = true;
+                    break;
+                }
+                splice->inPipe -= static_cast<size_t>(written);
             }
+            if (fileFailed || splice->remaining == 0)
+                break;
+
+            auto moved = ::splice(fd, nullptr, *splice->pipeIn, nullptr,
+                                  std::min(splice->remaining, SpliceChunk),
+                                  SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (moved > 0)
+            {
+                splice->remaining -= static_cast<size_t>(moved);
+                splice->inPipe += static_cast<size_t>(moved);
+                continue;
+            }
+            if (moved == -1 && errno == EINTR)
+                continue;
+            if (moved == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+
+            // Closed by the client, or failed, before the end
+            peerFailed = true;
+            break;
+        }
+
+        if (peerFailed)
+        {
+            splices_.erase(fd);
+            handlePeerDisconnection(peer);
+            return;
         }
+
+        if (!fileFailed && splice->remaining > 0)
+        {
+            if (splice->remaining != before)
+                splice->progress(static_cast<ssize_t>(splice->remaining));
+            return;
+        }
+
+        auto progress = std::move(splice->progress);
+        splices_.erase(fd);
+        progress(fileFailed ? -1 : 0);
+
+        // What the client sent behind the bytes is read as usual, it is
+        // ready already
+        auto* current = peers.find(fd);
+        if (!fileFailed && current != nullptr && *current == peer && !splices_.contains(fd))
+            handleIncoming(peer);
+    }
+
+    void Transport::handleListenSocket()
+    {
+        // Bound the batch so that a connection storm does not starve the peers
+        // already served by this transport
+        for (size_t i = 0; i < Const::MaxBacklog; ++i)
+        {
+            if (maxPeers_ > 0 && peerCount() >= maxPeers_ && !evictIdlePeer())
+            {
+                // Left in the backlog until removePeer() makes room
+                reactor()->removeFd(key(), listenFd_);
+                acceptPaused_ = true;
+                break;
+            }
+
+            std::shared_ptr<Peer> peer;
+            try
+            {
+                peer = acceptor_(listenFd_);
+            }
+            catch (const std::exception&)
+            {
+                // The connection was dropped before we could accept it, or we
+                // ran out of descriptors: the socket stays readable, try again
+                // on the next iteration of the loop
+                break;
+            }
+
+            if (!peer)
+                break;
+
+            peerCount_.fetch_add(1, std::memory_order_relaxed);
+            handlePeer(peer);
+        }
+    }
+
+    void Transport::handleHandshake(const std::shared_ptr<Peer>& peer)
+    {
+#ifdef PISTACHE_USE_SSL
+        auto* ssl = static_cast<SSL*>(peer->ssl());
+        int fd    = peer->fd();
+
+        ERR_clear_error();
+        int res = SSL_accept(ssl);
+        if (res == 1)
+        {
+            peer->handshakePending_ = false;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+            peer->kernelTls_ = BIO_get_ktls_send(SSL_get_wbio(ssl));
+#endif
+            auto& handshakes = SSL_session_reused(ssl) ? resumedHandshakes_ : fullHandshakes_;
+            handshakes.fetch_add(1, std::memory_order_relaxed);
+            cancelHandshakeTimer(fd);
+
+            handler_->onConnection(peer);
+            reactor()->modifyFd(key(), fd, NotifyOn::Read | NotifyOn::Shutdown,
+                                Polling::Mode::Edge);
+
+            // The first request may have been received along with the end of
+            // the handshake
+            handleIncoming(peer);
+            return;
+        }
+
+        switch (SSL_get_error(ssl, res))
+        {
+        case SSL_ERROR_WANT_READ:
+            break;
+        case SSL_ERROR_WANT_WRITE:
+            reactor()->modifyFd(key(), fd,
+                                NotifyOn::Read | NotifyOn::Write | NotifyOn::Shutdown,
+                                Polling::Mode::Edge);
+            break;
+        default:
+            removePeer(peer);
+            break;
+        }
+#else
+        (void)peer;
+#endif /* PISTACHE_USE_SSL */
+    }
+
+    void Transport::cancelHandshakeTimer(Fd fd)
+    {
+        auto timer = handshakeTimers_.take(fd);
+        if (timer)
+            cancelTimer(*timer);
     }
 
     void Transport::handlePeerDisconnection(const std::shared_ptr<Peer>& peer)
@@ -206,17 +923,29 @@ namespace Pistache::Tcp
 
     void Transport::removePeer(const std::shared_ptr<Peer>& peer)
     {
-        int fd  = peer->fd();
-        auto it = peers.find(fd);
-        if (it == std::end(peers))
+        int fd = peer->fd();
+        if (!peers.contains(fd))
             throw std::runtime_error("Could not find peer to erase");
 
-        peers.erase(it->first);
-
+        // Clean up buffers, peer may refer to the entry of the table
+        auto& wq = peer->writeQueue_;
+        if (!wq.empty() && wq.front().zeroCopy)
+            holdZeroCopy(*peer, std::move(wq.front().buffer));
+        dropWrites(wq);
+        lingerZeroCopy(*peer);
+        splices_.erase(fd);
+
+        unlinkPeer(*peer);
+        peers.erase(fd);
+        cancelHandshakeTimer(fd);
+        peerCount_.fetch_sub(1, std::memory_order_relaxed);
+
+        // Polled again, the connections that waited are accepted from the
+        // next iteration of the loop
+        if (acceptPaused_ && peerCount() < maxPeers_)
         {
-            // Clean up buffers
-            Guard guard(toWriteLock);
-            toWrite.erase(fd);
+            acceptPaused_ = false;
+            reactor()->registerFd(key(), listenFd_, NotifyOn::Read);
         }
 
         // Don't rely on close deleting this FD from the epoll "interest" list.
@@ -232,38 +961,69 @@ namespace Pistache::Tcp
 
     void Transport::asyncWriteImpl(Fd fd)
     {
+        // Shared by the files of the queue, the peer gives way to the others
+        // once it is spent
+        size_t fileBudget = sendFileBudget_;
+
         bool stop = false;
         while (!stop)
         {
-            std::unique_lock<std::mutex> lock(toWriteLock);
-
-            auto it = toWrite.find(fd);
+            auto* peer = peers.find(fd);
 
             // cleanup will have been handled by handlePeerDisconnection
-            if (it == std::end(toWrite))
+            if (peer == nullptr)
             {
                 return;
             }
-            auto& wq = it->second;
+            // Resumed once the prefetcher read the file
+            if ((*peer)->prefetching_)
+            {
+                return;
+            }
+            auto& wq = (*peer)->writeQueue_;
             if (wq.empty())
             {
                 break;
             }
 
+            if (isCoalescable(fd, wq))
+            {
+                stop = !asyncWriteVectored(fd, wq);
+                continue;
+            }
+
             auto& entry                       = wq.front();
             int flags                         = entry.flags;
             BufferHolder& buffer              = entry.buffer;
             Async::Deferred<ssize_t> deferred = std::move(entry.deferred);
 
             auto cleanUp = [&]() {
+                if (entry.zeroCopy)
+                    holdZeroCopy(**peer, std::move(buffer));
                 wq.pop_front();
                 if (wq.empty())
                 {
-                    toWrite.erase(fd);
                     reactor()->modifyFd(key(), fd, NotifyOn::Read, Polling::Mode::Edge);
                     stop = true;
                 }
-                lock.unlock();
+            };
+
+            // Puts what is left of the buffer back at the front of the queue
+            auto requeue = [&](size_t written) {
+                // The kernel may be reading the buffer, it is not moved
+                if (entry.zeroCopy)
+                {
+                    buffer.seek(written);
+                    entry.deferred = std::move(deferred);
+                    return;
+                }
+
+                auto bufferHolder = buffer.detach(written);
+
+                // pop_front kills buffer - so we cannot continue loop or use buffer
+                // after this point
+                wq.pop_front();
+                wq.push_front(WriteEntry(std::move(deferred), std::move(bufferHolder), fd, flags));
             };
 
             size_t totalWritten = buffer.offset();
@@ -272,29 +1032,53 @@ namespace Pistache::Tcp
                 ssize_t bytesWritten = 0;
                 auto len             = buffer.size() - totalWritten;
 
-                if (buffer.isRaw())
+                if (buffer.inMemory())
                 {
-                    auto raw        = buffer.raw();
-                    const auto* ptr = raw.data().c_str() + totalWritten;
-                    bytesWritten    = sendRawBuffer(fd, ptr, len, flags);
+                    const auto* ptr = buffer.bytes() + totalWritten;
+                    if (zeroCopyThreshold_ > 0 && (entry.zeroCopy || len >= zeroCopyThreshold_))
+                        bytesWritten = sendZeroCopy(**peer, ptr, len, flags, entry.zeroCopy);
+                    else
+                        bytesWritten = sendRawBuffer(fd, ptr, len, flags);
                 }
                 else
                 {
-                    auto file    = buffer.fd();
+                    if (fileBudget == 0)
+                    {
+                        requeue(totalWritten);
+                        resumeWrites(*peer);
+                        stop = true;
+                        break;
+                    }
+                    len = std::min(len, fileBudget);
+
+                    auto file = buffer.fd();
+                    if (prefetcher_ && !FilePrefetcher::isCached(file, totalWritten, len))
+                    {
+                        auto handle = buffer.file();
+                        requeue(totalWritten);
+
+                        (*peer)->prefetching_ = true;
+                        prefetcher_->prefetch(
+                            std::move(handle), totalWritten, len,
+                            [anchor = anchor_, weak = std::weak_ptr<Peer>(*peer)] {
+                                std::lock_guard<std::mutex> guard(anchor->lock);
+                                if (anchor->transport != nullptr)
+                                    anchor->transport->resumeWrites(weak, true);
+                            });
+                        stop = true;
+                        break;
+                    }
+
                     off_t offset = totalWritten;
                     bytesWritten = sendFile(fd, file, offset, len);
+                    if (bytesWritten > 0)
+                        fileBudget -= std::min(fileBudget, static_cast<size_t>(bytesWritten));
                 }
                 if (bytesWritten < 0)
                 {
                     if (errno == EAGAIN || errno == EWOULDBLOCK)
                     {
-
-                        auto bufferHolder = buffer.detach(totalWritten);
-
-                        // pop_front kills buffer - so we cannot continue loop or use buffer
-                        // after this point
-                        wq.pop_front();
-                        wq.push_front(WriteEntry(std::move(deferred), bufferHolder, flags));
+                        requeue(totalWritten);
                         reactor()->modifyFd(key(), fd, NotifyOn::Read | NotifyOn::Write,
                                             Polling::Mode::Edge);
                     }
@@ -303,12 +1087,12 @@ namespace Pistache::Tcp
                     // https://github.com/pistacheio/pistache/issues/501
                     else if (errno == EBADF || errno == EPIPE || errno == ECONNRESET)
                     {
-                        wq.pop_front();
-                        toWrite.erase(fd);
+                        dropWrites(wq);
                         stop = true;
                     }
                     else
                     {
+                        unqueueBytes(buffer.size() - totalWritten);
                         cleanUp();
                         deferred.reject(Pistache::Error::system("Could not write data"));
                     }
@@ -316,21 +1100,17 @@ namespace Pistache::Tcp
                 }
                 else
                 {
+                    unqueueBytes(static_cast<size_t>(bytesWritten));
                     totalWritten += bytesWritten;
                     if (totalWritten >= buffer.size())
                     {
-                        if (buffer.isFile())
-                        {
-                            // done with the file buffer, nothing else knows whether to
-                            // close it with the way the code is written.
-                            ::close(buffer.fd());
-                        }
-
+                        // A slice of a file counts from where it starts
+                        const size_t sent = totalWritten - buffer.start();
                         cleanUp();
 
                         // Cast to match the type of defered template
                         // to avoid a BadType exception
-                        deferred.resolve(static_cast<ssize_t>(totalWritten));
+                        deferred.resolve(static_cast<ssize_t>(sent));
                         break;
                     }
                 }
@@ -338,19 +1118,259 @@ namespace Pistache::Tcp
         }
     }
 
+    void Transport::resumeWrites(std::weak_ptr<Peer> weak, bool prefetched)
+    {
+        post([this, weak = std::move(weak), prefetched] {
+            auto peer = weak.lock();
+            if (!peer)
+                return;
+            if (prefetched)
+                peer->prefetching_ = false;
+
+            // The descriptor may have been reused by another peer already
+            auto* current = peers.find(peer->fd());
+            if (current != nullptr && *current == peer)
+                asyncWriteImpl(peer->fd());
+        });
+    }
+
+    bool Transport::isCoalescable(Fd fd, const std::deque<WriteEntry>& wq) const
+    {
+        if (wq.size() < 2)
+            return false;
+
+        const auto& first  = wq[0];
+        const auto& second = wq[1];
+        if (!first.buffer.inMemory() || !second.buffer.inMemory() || first.flags != second.flags)
+            return false;
+
+        // Sent on its own, without a copy
+        if (zeroCopyThreshold_ > 0
+            && (first.zeroCopy || first.buffer.size() - first.buffer.offset() >= zeroCopyThreshold_))
+            return false;
+
+#ifdef PISTACHE_USE_SSL
+        auto* peer = peers.find(fd);
+        if (peer != nullptr && (*peer)->ssl() != NULL)
+            return false;
+#else
+        (void)fd;
+#endif /* PISTACHE_USE_SSL */
+
+        return true;
+    }
+
+    void Transport::dropWrites(std::deque<WriteEntry>& wq)
+    {
+        size_t bytes = 0;
+        for (const auto& entry : wq)
+            bytes += entry.buffer.size() - entry.buffer.offset();
+        unqueueBytes(bytes);
+        wq.clear();
+    }
+
+    void Transport::unqueueBytes(size_t bytes)
+    {
+        pendingWriteBytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    bool Transport::asyncWriteVectored(Fd fd, std::deque<WriteEntry>& wq)
+    {
+        std::array<struct iovec, IOV_MAX> iov;
+        size_t count    = 0;
+        const int flags = wq.front().flags;
+
+        for (const auto& entry : wq)
+        {
+            if (count == iov.size() || !entry.buffer.inMemory() || entry.flags != flags)
+                break;
+
+            auto offset = entry.buffer.offset();
+
+            iov[count].iov_base = const_cast<char*>(entry.buffer.bytes() + offset);
+            iov[count].iov_len  = entry.buffer.size() - offset;
+            ++count;
+        }
+
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof msg);
+        msg.msg_iov    = iov.data();
+        msg.msg_iovlen = count;
+
+        // MSG_NOSIGNAL is used to prevent SIGPIPE on client connection termination
+        ssize_t bytesWritten = ::sendmsg(fd, &msg, flags | MSG_NOSIGNAL);
+        if (bytesWritten < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                reactor()->modifyFd(key(), fd, NotifyOn::Read | NotifyOn::Write,
+                                    Polling::Mode::Edge);
+            }
+            else if (errno == EBADF || errno == EPIPE || errno == ECONNRESET)
+            {
+                dropWrites(wq);
+            }
+            else
+            {
+                const auto& front = wq.front().buffer;
+                unqueueBytes(front.size() - front.offset());
+                auto deferred = std::move(wq.front().deferred);
+                wq.pop_front();
+                deferred.reject(Pistache::Error::system("Could not write data"));
+                return true;
+            }
+            return false;
+        }
+
+        unqueueBytes(static_cast<size_t>(bytesWritten));
+
+        std::vector<std::pair<Async::Deferred<ssize_t>, ssize_t>> written;
+        written.reserve(count);
+
+        auto remaining = static_cast<size_t>(bytesWritten);
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto& entry = wq.front();
+            auto offset = entry.buffer.offset();
+            auto len    = entry.buffer.size() - offset;
+
+            if (remaining < len)
+            {
+                // Partial write, keep the rest of the buffer at the front of the queue
+                if (remaining > 0)
+                    entry.buffer = entry.buffer.detach(offset + remaining);
+                break;
+            }
+
+            remaining -= len;
+            written.emplace_back(std::move(entry.deferred), static_cast<ssize_t>(entry.buffer.size()));
+            wq.pop_front();
+        }
+
+        bool empty = wq.empty();
+        if (empty)
+        {
+            reactor()->modifyFd(key(), fd, NotifyOn::Read, Polling::Mode::Edge);
+        }
+
+        for (auto& entry : written)
+        {
+            entry.first.resolve(entry.second);
+        }
+
+        return !empty;
+    }
+
+    ssize_t Transport::sendZeroCopy(Peer& peer, const char* buffer, size_t len, int flags,
+                                    bool& pinned)
+    {
+        const Fd fd = peer.fd();
+#if defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY)
+        if (peer.zeroCopy_ == Peer::ZeroCopy::Unknown)
+        {
+            // SSL_write() copies the bytes to encrypt them anyway
+            int one        = 1;
+            const bool set = peer.ssl() == nullptr
+                && ::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+            peer.zeroCopy_ = set ? Peer::ZeroCopy::Enabled : Peer::ZeroCopy::Unsupported;
+        }
+
+        if (peer.zeroCopy_ == Peer::ZeroCopy::Enabled)
+        {
+            ssize_t bytesWritten = ::send(fd, buffer, len, flags | MSG_NOSIGNAL | MSG_ZEROCOPY);
+            if (bytesWritten > 0)
+            {
+                ++peer.nextZeroCopyId_;
+                pinned = true;
+                return bytesWritten;
+            }
+
+            // Out of the memory the socket may pin, this part is copied
+            if (bytesWritten == 0 || errno != ENOBUFS)
+                return bytesWritten;
+        }
+#else
+        (void)pinned;
+#endif
+        return sendRawBuffer(fd, buffer, len, flags);
+    }
+
+    void Transport::holdZeroCopy(Peer& peer, BufferHolder buffer)
+    {
+        peer.zeroCopyHeld_.emplace_back(peer.nextZeroCopyId_ - 1, std::move(buffer));
+    }
+
+    void Transport::reapZeroCopy(Peer& peer)
+    {
+#ifdef SO_EE_ORIGIN_ZEROCOPY
+        std::array<char, 256> control;
+        for (;;)
+        {
+            struct msghdr msg;
+            std::memset(&msg, 0, sizeof msg);
+            msg.msg_control    = control.data();
+            msg.msg_controllen = control.size();
+            if (::recvmsg(peer.fd(), &msg, MSG_ERRQUEUE) < 0)
+                break;
+
+            for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                const bool v4 = cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR;
+                const bool v6 = cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR;
+                if (!v4 && !v6)
+                    continue;
+
+                struct sock_extended_err err;
+                std::memcpy(&err, CMSG_DATA(cmsg), sizeof err);
+                if (err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                    continue;
+
+                // The sends from ee_info to ee_data, in order on a stream
+                const size_t sends = err.ee_data - err.ee_info + 1;
+                zeroCopySends_.fetch_add(sends, std::memory_order_relaxed);
+                if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                    zeroCopyCopied_.fetch_add(sends, std::memory_order_relaxed);
+
+                auto& held = peer.zeroCopyHeld_;
+                while (!held.empty() && static_cast<int32_t>(held.front().first - err.ee_data) <= 0)
+                    held.pop_front();
+            }
+        }
+#else
+        (void)peer;
+#endif
+    }
+
+    void Transport::lingerZeroCopy(Peer& peer)
+    {
+        if (peer.zeroCopy_ != Peer::ZeroCopy::Enabled)
+            return;
+
+        reapZeroCopy(peer);
+        if (peer.zeroCopyHeld_.empty())
+            return;
+
+        // Closed, the socket may still be sending them
+        auto held = std::make_shared<std::deque<std::pair<uint32_t, BufferHolder>>>(
+            std::move(peer.zeroCopyHeld_));
+        peer.zeroCopyHeld_.clear();
+        scheduleTimer(std::chrono::duration_cast<std::chrono::milliseconds>(Const::ZeroCopyLinger),
+                      [held] { held->clear(); });
+    }
+
     ssize_t Transport::sendRawBuffer(Fd fd, const char* buffer, size_t len, int flags)
     {
         ssize_t bytesWritten = 0;
 
 #ifdef PISTACHE_USE_SSL
-        auto it_ = peers.find(fd);
+        auto* peer = peers.find(fd);
 
-        if (it_ == std::end(peers))
+        if (peer == nullptr)
             throw std::runtime_error("No peer found for fd: " + std::to_string(fd));
 
-        if (it_->second->ssl() != NULL)
+        if ((*peer)->ssl() != NULL)
         {
-            auto ssl_    = static_cast<SSL*>(it_->second->ssl());
+            auto ssl_    = static_cast<SSL*>((*peer)->ssl());
             bytesWritten = SSL_write(ssl_, buffer, static_cast<int>(len));
         }
         else
@@ -370,15 +1390,22 @@ namespace Pistache::Tcp
         ssize_t bytesWritten = 0;
 
 #ifdef PISTACHE_USE_SSL
-        auto it_ = peers.find(fd);
+        auto* peer = peers.find(fd);
 
-        if (it_ == std::end(peers))
+        if (peer == nullptr)
             throw std::runtime_error("No peer found for fd: " + std::to_string(fd));
 
-        if (it_->second->ssl() != NULL)
+        if ((*peer)->ssl() != NULL)
         {
-            auto ssl_    = static_cast<SSL*>(it_->second->ssl());
-            bytesWritten = SSL_sendfile(ssl_, file, &offset, len);
+            auto ssl_ = static_cast<SSL*>((*peer)->ssl());
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+            // The kernel encrypts the pages of the file itself, they are
+            // never copied to userspace
+            if ((*peer)->kernelTls())
+                bytesWritten = ::SSL_sendfile(ssl_, file, offset, len, 0);
+            else
+#endif
+                bytesWritten = SSL_sendfile(ssl_, file, &offset, len);
         }
         else
         {
@@ -401,6 +1428,7 @@ namespace Pistache::Tcp
 
         if (!isInRightThread)
         {
+            queuedTimers_.fetch_add(1, std::memory_order_relaxed);
             timersQueue.push(std::move(entry));
         }
         else
@@ -412,8 +1440,7 @@ namespace Pistache::Tcp
     void Transport::armTimerMsImpl(TimerEntry entry)
     {
 
-        auto it = timers.find(entry.fd);
-        if (it != std::end(timers))
+        if (timers.contains(entry.fd))
         {
             entry.deferred.reject(std::runtime_error("Timer is already armed"));
             return;
@@ -444,7 +1471,8 @@ namespace Pistache::Tcp
 
         reactor()->registerFdOneShot(key(), entry.fd, NotifyOn::Read,
                                      Polling::Mode::Edge);
-        timers.insert(std::make_pair(entry.fd, std::move(entry)));
+        auto fd = entry.fd;
+        timers.insert(fd, std::move(entry));
     }
 
     void Transport::handleWriteQueue(bool flush)
@@ -455,22 +1483,62 @@ namespace Pistache::Tcp
             auto write = writesQueue.popSafe();
             if (!write)
                 break;
+            queuedWrites_.fetch_sub(1, std::memory_order_relaxed);
 
             auto fd = write->peerFd;
-            if (!isPeerFd(fd))
+            if (!enqueueWrite(std::move(*write)))
                 continue;
 
-            {
-                Guard guard(toWriteLock);
-                toWrite[fd].push_back(std::move(*write));
-            }
+            if (flush && !corking_)
+                asyncWriteImpl(fd);
+        }
+    }
 
-            reactor()->modifyFd(key(), fd, NotifyOn::Read | NotifyOn::Write,
-                                Polling::Mode::Edge);
+    void Transport::pushWrite(WriteEntry write)
+    {
+        pendingWriteBytes_.fetch_add(write.buffer.size() - write.buffer.offset(),
+                                     std::memory_order_relaxed);
 
-            if (flush)
-                asyncWriteImpl(fd);
+        // From the thread of the transport the write goes straight to the queue
+        // of its peer, after the ones other threads already queued for it
+        if (isInTransportThread())
+        {
+            handleWriteQueue();
+            enqueueWrite(std::move(write));
+        }
+        else
+        {
+            queuedWrites_.fetch_add(1, std::memory_order_relaxed);
+            writesQueue.push(std::move(write));
+        }
+    }
+
+    bool Transport::enqueueWrite(WriteEntry write)
+    {
+        auto fd = write.peerFd;
+        auto* peer = peers.find(fd);
+        if (peer == nullptr)
+        {
+            unqueueBytes(write.buffer.size() - write.buffer.offset());
+            return false;
         }
+
+        auto& wq           = (*peer)->writeQueue_;
+        const bool started = wq.empty();
+        wq.push_back(std::move(write));
+
+        // A queue that already held writes is either corked or waiting for
+        // the socket to be writable
+        if (corking_)
+        {
+            if (started)
+                corked_.push_back(fd);
+            return true;
+        }
+
+        reactor()->modifyFd(key(), fd, NotifyOn::Read | NotifyOn::Write,
+                            Polling::Mode::Edge);
+        return true;
     }
 
     void Transport::handleTimerQueue()
@@ -480,6 +1548,7 @@ namespace Pistache::Tcp
             auto timer = timersQueue.popSafe();
             if (!timer)
                 break;
+            queuedTimers_.fetch_sub(1, std::memory_order_relaxed);
 
             armTimerMsImpl(std::move(*timer));
         }
@@ -492,18 +1561,75 @@ namespace Pistache::Tcp
             auto data = peersQueue.popSafe();
             if (!data)
                 break;
+            queuedPeers_.fetch_sub(1, std::memory_order_relaxed);
 
             handlePeer(data->peer);
         }
     }
 
+    void Transport::handleTaskQueue()
+    {
+        for (;;)
+        {
+            auto task = tasksQueue.popSafe();
+            if (!task)
+                break;
+
+            (*task)();
+        }
+    }
+
     void Transport::handlePeer(const std::shared_ptr<Peer>& peer)
     {
         int fd = peer->fd();
-        peers.insert(std::make_pair(fd, peer));
+        peers.insert(fd, peer);
+
+        if (idleEviction_ > 0)
+        {
+            touchPeer(*peer);
+            if (peerCount() > idleEviction_)
+                evictIdlePeer();
+        }
+
+        if (socketBusyPoll_.count() > 0)
+        {
+            // Best effort, raising it above net.core.busy_read takes
+            // CAP_NET_ADMIN
+            int budget = static_cast<int>(socketBusyPoll_.count());
+            ::setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &budget, sizeof(budget));
+#ifdef SO_PREFER_BUSY_POLL
+            int one = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &one, sizeof(one));
+#endif
+        }
 
         peer->associateTransport(this);
 
+        if (peer->handshakePending_)
+        {
+            reactor()->registerFd(key(), fd, NotifyOn::Read | NotifyOn::Shutdown,
+                                  Polling::Mode::Edge);
+
+            if (sslHandshakeTimeout_ > std::chrono::milliseconds(0))
+            {
+                std::weak_ptr<Peer> weakPeer = peer;
+
+                auto timer = scheduleTimer(sslHandshakeTimeout_, [=]() {
+                    handshakeTimers_.erase(fd);
+
+                    auto pending  = weakPeer.lock();
+                    auto* current = peers.find(fd);
+                    if (pending && current != nullptr && *current == pending)
+                        removePeer(pending);
+                });
+                handshakeTimers_.erase(fd);
+                handshakeTimers_.insert(fd, timer);
+            }
+
+            handleHandshake(peer);
+            return;
+        }
+
         handler_->onConnection(peer);
         reactor()->registerFd(key(), fd, NotifyOn::Read | NotifyOn::Shutdown,
                               Polling::Mode::Edge);
@@ -555,12 +1681,12 @@ namespace Pistache::Tcp
 
     bool Transport::isPeerFd(Fd fd) const
     {
-        return peers.find(fd) != std::end(peers);
+        return peers.contains(fd);
     }
 
     bool Transport::isTimerFd(Fd fd) const
     {
-        return timers.find(fd) != std::end(timers);
+        return timers.contains(fd);
     }
 
     bool Transport::isPeerFd(Polling::Tag tag) const
@@ -574,12 +1700,12 @@ namespace Pistache::Tcp
 
     std::shared_ptr<Peer>& Transport::getPeer(Fd fd)
     {
-        auto it = peers.find(fd);
-        if (it == std::end(peers))
+        auto* peer = peers.find(fd);
+        if (peer == nullptr)
         {
             throw std::runtime_error("No peer found for fd: " + std::to_string(fd));
         }
-        return it->second;
+        return *peer;
     }
 
     std::shared_ptr<Peer>& Transport::getPeer(Polling::Tag tag)
@@ -587,16 +1713,17 @@ namespace Pistache::Tcp
         return getPeer(static_cast<Fd>(tag.value()));
     }
 
+    void Transport::disconnectPeers()
+    {
+        post([this] {
+            peers.forEach([](Fd fd, const std::shared_ptr<Peer>&) { ::shutdown(fd, SHUT_RDWR); });
+        });
+    }
+
     std::deque<std::shared_ptr<Peer>> Transport::getAllPeer()
     {
         std::deque<std::shared_ptr<Peer>> dqPeers;
-        for (const auto& peerPair : peers)
-        {
-            if (isPeerFd(peerPair.first))
-            {
-                dqPeers.push_back(peerPair.second);
-            }
-        }
+        peers.forEach([&](Fd, const std::shared_ptr<Peer>& peer) { dqPeers.push_back(peer); });
         return dqPeers;
     }
 
@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* value_stream.h
+
+   The ostream the typed headers write their values to, shared by the
+   writers of the responses of the server and of the requests of the
+   client. Not installed.
+*/
+
+#pragma once
+
+#include <ios>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+namespace Pistache::Http::Private
+{
+
+    // Appends to a string, the head of a request for instance
+    class StringAppendBuf : public std::streambuf
+    {
+    public:
+        explicit StringAppendBuf(std::string& target)
+            : target_(target)
+        { }
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            if (traits_type::eq_int_type(ch, traits_type::eof()))
+                return traits_type::eof();
+
+            target_.push_back(traits_type::to_char_type(ch));
+            return ch;
+        }
+
+        std::streamsize xsputn(const char* data, std::streamsize size) override
+        {
+            target_.append(data, static_cast<size_t>(size));
+            return size;
+        }
+
+    private:
+        std::string& target_;
+    };
+
+    // The values of the typed headers are written by the headers themselves
+    // to an ostream. It is made once per thread, and pointed at the buffer
+    // being written for as long as it is needed.
+    class ValueStream
+    {
+    public:
+        explicit ValueStream(std::streambuf& buf)
+            : os_(stream())
+        {
+            // Clears the state left by the previous use too
+            os_.rdbuf(&buf);
+            os_.flags(std::ios_base::dec | std::ios_base::skipws);
+            os_.width(0);
+            os_.precision(6);
+            os_.fill(' ');
+        }
+
+        ValueStream(const ValueStream&)            = delete;
+        ValueStream& operator=(const ValueStream&) = delete;
+
+        ~ValueStream() { os_.rdbuf(nullptr); }
+
+        std::ostream& get() { return os_; }
+
+    private:
+        static std::ostream& stream()
+        {
+            thread_local std::ostream os(nullptr);
+            return os;
+        }
+
+        std::ostream& os_;
+    };
+
+} // namespace Pistache::Http::Private
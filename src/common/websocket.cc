@@ -0,0 +1,922 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* websocket.cc
+
+   Implementation of the WebSocket handshake and framing
+*/
+
+#include <pistache/base64.h>
+#include <pistache/net.h>
+#include <pistache/peer.h>
+#include <pistache/scan.h>
+#include <pistache/transport.h>
+#include <pistache/websocket.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/socket.h>
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+#include <zlib.h>
+#endif
+
+#include "string_utils.h"
+
+namespace Pistache::Http::WebSocket
+{
+
+    namespace
+    {
+        constexpr size_t MaxControlPayload = 125;
+
+        uint32_t rotateLeft(uint32_t value, int bits)
+        {
+            return (value << bits) | (value >> (32 - bits));
+        }
+
+        // Only used for the handshake (RFC 3174)
+        std::array<uint8_t, 20> sha1(std::string_view input)
+        {
+            uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+            std::string message(input);
+            const uint64_t bits = static_cast<uint64_t>(input.size()) * 8;
+            message.push_back(static_cast<char>(0x80));
+            while (message.size() % 64 != 56)
+                message.push_back('\0');
+            for (int i = 7; i >= 0; --i)
+                message.push_back(static_cast<char>(bits >> (i * 8)));
+
+            for (size_t block = 0; block < message.size(); block += 64)
+            {
+                uint32_t w[80];
+                for (int i = 0; i < 16; ++i)
+                {
+                    const auto* p = reinterpret_cast<const uint8_t*>(&message[block + i * 4]);
+                    w[i]          = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16)
+                        | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+                }
+                for (int i = 16; i < 80; ++i)
+                    w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+                uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+                for (int i = 0; i < 80; ++i)
+                {
+                    uint32_t f, k;
+                    if (i < 20)
+                    {
+                        f = (b & c) | (~b & d);
+                        k = 0x5A827999;
+                    }
+                    else if (i < 40)
+                    {
+                        f = b ^ c ^ d;
+                        k = 0x6ED9EBA1;
+                    }
+                    else if (i < 60)
+                    {
+                        f = (b & c) | (b & d) | (c & d);
+                        k = 0x8F1BBCDC;
+                    }
+                    else
+                    {
+                        f = b ^ c ^ d;
+                        k = 0xCA62C1D6;
+                    }
+
+                    const uint32_t temp = rotateLeft(a, 5) + f + e + k + w[i];
+                    e                   = d;
+                    d                   = c;
+                    c                   = rotateLeft(b, 30);
+                    b                   = a;
+                    a                   = temp;
+                }
+
+                h[0] += a;
+                h[1] += b;
+                h[2] += c;
+                h[3] += d;
+                h[4] += e;
+            }
+
+            std::array<uint8_t, 20> digest;
+            for (int i = 0; i < 20; ++i)
+                digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+            return digest;
+        }
+
+        bool validUtf8(std::string_view text)
+        {
+            const auto* p   = reinterpret_cast<const uint8_t*>(text.data());
+            const auto* end = p + text.size();
+            while (p < end)
+            {
+                const uint8_t c = *p;
+                if (c < 0x80)
+                {
+                    ++p;
+                    continue;
+                }
+
+                size_t length;
+                uint32_t codepoint;
+                if ((c & 0xE0) == 0xC0)
+                {
+                    length    = 2;
+                    codepoint = c & 0x1F;
+                }
+                else if ((c & 0xF0) == 0xE0)
+                {
+                    length    = 3;
+                    codepoint = c & 0x0F;
+                }
+                else if ((c & 0xF8) == 0xF0)
+                {
+                    length    = 4;
+                    codepoint = c & 0x07;
+                }
+                else
+                {
+                    return false;
+                }
+
+                if (static_cast<size_t>(end - p) < length)
+                    return false;
+                for (size_t i = 1; i < length; ++i)
+                {
+                    if ((p[i] & 0xC0) != 0x80)
+                        return false;
+                    codepoint = (codepoint << 6) | (p[i] & 0x3F);
+                }
+
+                // Overlong forms, surrogates and what is past Unicode
+                static constexpr uint32_t Minimum[] = { 0, 0, 0x80, 0x800, 0x10000 };
+                if (codepoint < Minimum[length] || codepoint > 0x10FFFF
+                    || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+                    return false;
+
+                p += length;
+            }
+            return true;
+        }
+
+        bool equalsIgnoreCase(std::string_view left, std::string_view right)
+        {
+            return left.size() == right.size()
+                && std::equal(left.begin(), left.end(), right.begin(), [](char a, char b) {
+                       return std::tolower(static_cast<unsigned char>(a))
+                           == std::tolower(static_cast<unsigned char>(b));
+                   });
+        }
+
+        // Trimmed elements of a list separated by the delimiter
+        std::vector<std::string_view> split(std::string_view value, char delimiter)
+        {
+            std::vector<std::string_view> elements;
+            for (;;)
+            {
+                const auto end = value.find(delimiter);
+                elements.push_back(Private::trim(value.substr(0, end)));
+                if (end == std::string_view::npos)
+                    break;
+                value.remove_prefix(end + 1);
+            }
+            return elements;
+        }
+
+        bool hasToken(const Request& request, const std::string& name, std::string_view token)
+        {
+            auto header = request.headers().tryGetRaw(name);
+            if (!header)
+                return false;
+
+            const auto value = header->value();
+            for (auto element : split(value, ','))
+            {
+                if (equalsIgnoreCase(element, token))
+                    return true;
+            }
+            return false;
+        }
+
+        std::string frameHeader(Opcode opcode, bool rsv1, size_t size)
+        {
+            std::string head;
+            head.reserve(10);
+            head.push_back(static_cast<char>(0x80 | (rsv1 ? 0x40 : 0) | static_cast<uint8_t>(opcode)));
+
+            if (size < 126)
+            {
+                head.push_back(static_cast<char>(size));
+            }
+            else if (size <= 0xFFFF)
+            {
+                head.push_back(static_cast<char>(126));
+                head.push_back(static_cast<char>(size >> 8));
+                head.push_back(static_cast<char>(size));
+            }
+            else
+            {
+                head.push_back(static_cast<char>(127));
+                for (int i = 7; i >= 0; --i)
+                    head.push_back(static_cast<char>(static_cast<uint64_t>(size) >> (i * 8)));
+            }
+            return head;
+        }
+
+        // Codes a peer may send in a close frame (RFC 6455 7.4)
+        bool validCloseCode(uint16_t code)
+        {
+            if (code >= 3000 && code <= 4999)
+                return true;
+            return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011);
+        }
+
+        std::string closePayload(CloseCode code, std::string_view reason)
+        {
+            std::string payload;
+            const auto value = static_cast<uint16_t>(code);
+            payload.push_back(static_cast<char>(value >> 8));
+            payload.push_back(static_cast<char>(value));
+            payload.append(reason.substr(0, MaxControlPayload - 2));
+            return payload;
+        }
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+        struct DeflateOffer
+        {
+            bool serverNoContextTakeover = false;
+            bool clientNoContextTakeover = false;
+            int serverMaxWindowBits      = 15;
+            bool windowBitsAsked         = false;
+        };
+
+        // The first permessage-deflate offer of the client that can be
+        // accepted (RFC 7692 7.1)
+        std::optional<DeflateOffer> negotiateDeflate(const Request& request)
+        {
+            auto header = request.headers().tryGetRaw("Sec-WebSocket-Extensions");
+            if (!header)
+                return std::nullopt;
+
+            const auto offers = header->value();
+            for (auto extension : split(offers, ','))
+            {
+                auto params = split(extension, ';');
+                if (!equalsIgnoreCase(params.front(), "permessage-deflate"))
+                    continue;
+
+                DeflateOffer offer;
+                bool acceptable = true;
+                for (size_t i = 1; i < params.size() && acceptable; ++i)
+                {
+                    auto param       = params[i];
+                    const auto equal = param.find('=');
+                    auto name        = Private::trim(param.substr(0, equal));
+                    std::string_view value;
+                    if (equal != std::string_view::npos)
+                    {
+                        value = Private::trim(param.substr(equal + 1));
+                        if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+                            value = value.substr(1, value.size() - 2);
+                    }
+
+                    if (equalsIgnoreCase(name, "server_no_context_takeover"))
+                    {
+                        offer.serverNoContextTakeover = true;
+                    }
+                    else if (equalsIgnoreCase(name, "client_no_context_takeover"))
+                    {
+                        offer.clientNoContextTakeover = true;
+                    }
+                    else if (equalsIgnoreCase(name, "server_max_window_bits"))
+                    {
+                        // zlib cannot produce a raw deflate stream with a
+                        // window of 8 bits
+                        const int bits = value.empty() ? 0 : std::atoi(std::string(value).c_str());
+                        acceptable     = bits >= 9 && bits <= 15;
+                        offer.serverMaxWindowBits = bits;
+                        offer.windowBitsAsked     = true;
+                    }
+                    else if (equalsIgnoreCase(name, "client_max_window_bits"))
+                    {
+                        // The inflater takes any window, the parameter is
+                        // not answered
+                        if (!value.empty())
+                        {
+                            const int bits = std::atoi(std::string(value).c_str());
+                            acceptable     = bits >= 8 && bits <= 15;
+                        }
+                    }
+                    else
+                    {
+                        acceptable = false;
+                    }
+                }
+
+                if (acceptable)
+                    return offer;
+            }
+            return std::nullopt;
+        }
+#endif
+    } // namespace
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+    // The contexts of a permessage-deflate connection. They are kept from one
+    // message to the next unless a side asked for no context takeover, the
+    // compression of a message then benefits from the previous ones
+    struct Connection::Deflate
+    {
+        enum class Result { Ok,
+                            Invalid,
+                            TooLarge };
+
+        Deflate(int level, const DeflateOffer& offer)
+            : resetDeflater(offer.serverNoContextTakeover)
+            , resetInflater(offer.clientNoContextTakeover)
+        {
+            deflater = z_stream {};
+            inflater = z_stream {};
+
+            // Negative window bits ask zlib for a raw deflate stream
+            if (deflateInit2(&deflater, level, Z_DEFLATED, -offer.serverMaxWindowBits, 8,
+                             Z_DEFAULT_STRATEGY)
+                != Z_OK)
+                throw Error("Could not initialize the zlib compressor");
+            if (inflateInit2(&inflater, -15) != Z_OK)
+            {
+                deflateEnd(&deflater);
+                throw Error("Could not initialize the zlib decompressor");
+            }
+        }
+
+        ~Deflate()
+        {
+            deflateEnd(&deflater);
+            inflateEnd(&inflater);
+        }
+
+        Deflate(const Deflate&)            = delete;
+        Deflate& operator=(const Deflate&) = delete;
+
+        std::string compress(const char* data, size_t size)
+        {
+            static constexpr size_t MaxInput = std::numeric_limits<uInt>::max();
+
+            std::string out;
+            out.reserve(size / 2 + 64);
+            do
+            {
+                const size_t slice = std::min(size, MaxInput);
+
+                deflater.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+                deflater.avail_in = static_cast<uInt>(slice);
+                do
+                {
+                    const size_t offset = out.size();
+                    const size_t step   = std::max<size_t>(slice / 2, 1024);
+                    out.resize(offset + step);
+
+                    deflater.next_out  = reinterpret_cast<Bytef*>(&out[offset]);
+                    deflater.avail_out = static_cast<uInt>(step);
+                    deflate(&deflater, slice == size ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+                    out.resize(out.size() - deflater.avail_out);
+                } while (deflater.avail_out == 0);
+
+                data += slice;
+                size -= slice;
+            } while (size > 0);
+
+            // The empty block ending the flush is implied (RFC 7692 7.2.1)
+            if (out.size() >= 4 && out.compare(out.size() - 4, 4, "\x00\x00\xff\xff", 4) == 0)
+                out.resize(out.size() - 4);
+
+            if (resetDeflater)
+                deflateReset(&deflater);
+            return out;
+        }
+
+        Result decompress(std::string& message, size_t maxSize, std::string& out)
+        {
+            message.append("\x00\x00\xff\xff", 4);
+
+            inflater.next_in  = reinterpret_cast<Bytef*>(message.data());
+            inflater.avail_in = static_cast<uInt>(message.size());
+
+            Result result = Result::Ok;
+            for (;;)
+            {
+                const size_t offset = out.size();
+                const size_t step   = std::max<size_t>(message.size() * 2, 4096);
+                out.resize(offset + step);
+
+                inflater.next_out  = reinterpret_cast<Bytef*>(&out[offset]);
+                inflater.avail_out = static_cast<uInt>(step);
+                const int ret      = inflate(&inflater, Z_SYNC_FLUSH);
+                out.resize(out.size() - inflater.avail_out);
+
+                if (ret != Z_OK && ret != Z_BUF_ERROR && ret != Z_STREAM_END)
+                {
+                    result = Result::Invalid;
+                    break;
+                }
+                if (out.size() > maxSize)
+                {
+                    result = Result::TooLarge;
+                    break;
+                }
+                if (inflater.avail_out != 0 || ret == Z_STREAM_END)
+                    break;
+            }
+
+            if (resetInflater || result != Result::Ok)
+                inflateReset(&inflater);
+            return result;
+        }
+
+        z_stream deflater;
+        z_stream inflater;
+        bool resetDeflater;
+        bool resetInflater;
+    };
+#else
+    struct Connection::Deflate
+    { };
+#endif
+
+    void Handler::onOpen(const std::shared_ptr<Connection>& /*connection*/) { }
+
+    void Handler::onClose(const std::shared_ptr<Connection>& /*connection*/, CloseCode /*code*/,
+                          const std::string& /*reason*/)
+    { }
+
+    std::string acceptKey(std::string_view key)
+    {
+        std::string input(key);
+        input.append(Guid);
+
+        const auto digest = sha1(input);
+        std::string accept(Base64Encoder::CalculateEncodedSize(digest.size()), '\0');
+        Base64Encoder::EncodeInto(reinterpret_cast<const std::byte*>(digest.data()),
+                                  digest.size(), accept.data());
+        return accept;
+    }
+
+    bool isUpgrade(const Request& request)
+    {
+        auto connection = request.headers().tryGet<Header::Connection>();
+        return connection && connection->control() == ConnectionControl::Upgrade
+            && hasToken(request, "Upgrade", "websocket");
+    }
+
+    std::shared_ptr<Connection> upgrade(const Request& request, ResponseWriter response,
+                                        std::shared_ptr<Handler> handler, const Options& options)
+    {
+        auto* transport = response.transport();
+        if (!transport->isInTransportThread())
+            throw std::logic_error("WebSocket::upgrade() must be called from the thread of the transport");
+
+        // Upgrading an HTTP/2 stream (RFC 8441) is not supported
+        if (request.version() != Version::Http11 || request.method() != Method::Get
+            || !isUpgrade(request))
+        {
+            response.send(Code::Bad_Request, "Not a WebSocket upgrade request");
+            return nullptr;
+        }
+
+        auto version = request.headers().tryGetRaw("Sec-WebSocket-Version");
+        if (!version || Private::trim(version->value()) != "13")
+        {
+            response.headers().add<Header::SecWebSocketVersion>("13");
+            response.send(Code::Upgrade_Required);
+            return nullptr;
+        }
+
+        // A nonce of 16 bytes, encoded in base64
+        auto key = request.headers().tryGetRaw("Sec-WebSocket-Key");
+        std::string nonce = key ? std::string(Private::trim(key->value())) : std::string();
+        bool validKey     = nonce.size() == 24;
+        if (validKey)
+        {
+            std::byte decoded[18];
+            const auto size = Base64Decoder::DecodeInto(nonce, decoded);
+            validKey        = size && *size == 16;
+        }
+        if (!validKey)
+        {
+            response.send(Code::Bad_Request, "Invalid Sec-WebSocket-Key");
+            return nullptr;
+        }
+
+        auto peer = response.peer();
+        auto connection = std::shared_ptr<Connection>(new Connection(transport, peer, std::move(handler), options));
+
+        auto& headers = response.headers();
+        headers.remove<Header::Connection>();
+        headers.add<Header::Connection>(ConnectionControl::Upgrade);
+        headers.add<Header::Upgrade>("websocket");
+        headers.add<Header::SecWebSocketAccept>(acceptKey(nonce));
+
+        if (!options.protocol.empty() && hasToken(request, "Sec-WebSocket-Protocol", options.protocol))
+        {
+            connection->protocol_ = options.protocol;
+            headers.add<Header::SecWebSocketProtocol>(options.protocol);
+        }
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+        if (options.compression)
+        {
+            if (auto offer = negotiateDeflate(request))
+            {
+                std::string extension = "permessage-deflate";
+                if (offer->serverNoContextTakeover)
+                    extension += "; server_no_context_takeover";
+                if (offer->clientNoContextTakeover)
+                    extension += "; client_no_context_takeover";
+                if (offer->windowBitsAsked)
+                    extension += "; server_max_window_bits=" + std::to_string(offer->serverMaxWindowBits);
+
+                connection->deflate_ = std::make_unique<Connection::Deflate>(options.compressionLevel, *offer);
+                headers.add<Header::SecWebSocketExtensions>(extension);
+            }
+        }
+#endif
+
+        // The bytes of the connection go to the frames from now on
+        auto state       = Http::Handler::getConnectionState(peer);
+        state->websocket = connection;
+
+        response.setCompression(Header::Encoding::Identity);
+        response.send(Code::Switching_Protocols);
+
+        connection->handler_->onOpen(connection);
+        return connection;
+    }
+
+    Connection::Connection(Tcp::Transport* transport, const std::shared_ptr<Tcp::Peer>& peer,
+                           std::shared_ptr<Handler> handler, const Options& options)
+        : transport_(transport)
+        , peer_(peer)
+        , fd_(peer->fd())
+        , handler_(std::move(handler))
+        , maxMessageSize_(options.maxMessageSize)
+        , compressionMinSize_(options.compressionMinSize)
+    { }
+
+    Connection::~Connection() = default;
+
+    bool Connection::compressed() const { return deflate_ != nullptr; }
+
+    Async::Promise<ssize_t> Connection::send(std::string_view data, Opcode opcode)
+    {
+        if (opcode != Opcode::Text && opcode != Opcode::Binary)
+            return Async::Promise<ssize_t>::rejected(Error("Not a message opcode"));
+        return sendFrame(opcode, data.data(), data.size(), nullptr);
+    }
+
+    Async::Promise<ssize_t> Connection::send(const SharedBuffer& payload, Opcode opcode)
+    {
+        if (opcode != Opcode::Text && opcode != Opcode::Binary)
+            return Async::Promise<ssize_t>::rejected(Error("Not a message opcode"));
+        return sendFrame(opcode, payload.data(), payload.size(), &payload);
+    }
+
+    Async::Promise<ssize_t> Connection::ping(std::string_view payload)
+    {
+        if (payload.size() > MaxControlPayload)
+            return Async::Promise<ssize_t>::rejected(Error("Ping payload too large"));
+        return sendFrame(Opcode::Ping, payload.data(), payload.size(), nullptr);
+    }
+
+    void Connection::close(CloseCode code, std::string_view reason)
+    {
+        const auto payload = closePayload(code, reason);
+        sendFrame(Opcode::Close, payload.data(), payload.size(), nullptr);
+    }
+
+    Async::Promise<ssize_t> Connection::sendFrame(Opcode opcode, const char* data, size_t size,
+                                                  const SharedBuffer* shared)
+    {
+        std::lock_guard<std::mutex> guard(sendLock_);
+
+        // The descriptor may have been given to another connection
+        if (closeSent_.load() || peer_.expired())
+            return Async::Promise<ssize_t>::rejected(Error("WebSocket connection closed"));
+
+        if (opcode == Opcode::Close)
+            closeSent_.store(true);
+
+        bool rsv1 = false;
+        std::string compressed;
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+        if (deflate_ && (opcode == Opcode::Text || opcode == Opcode::Binary)
+            && size >= compressionMinSize_)
+        {
+            compressed = deflate_->compress(data, size);
+            data       = compressed.data();
+            size       = compressed.size();
+            shared     = nullptr;
+            rsv1       = true;
+        }
+#endif
+
+        auto head = frameHeader(opcode, rsv1, size);
+
+        // Both are queued under the lock, the frame stays in one piece
+        if (shared)
+        {
+            const auto headSize = static_cast<ssize_t>(head.size());
+            transport_->asyncWrite(fd_, RawBuffer(std::move(head), headSize));
+            return transport_->asyncWrite(fd_, *shared).then(
+                [headSize](ssize_t bytes) { return headSize + bytes; },
+                Async::Throw);
+        }
+
+        head.append(data, size);
+        const auto length = head.size();
+        return transport_->asyncWrite(fd_, RawBuffer(std::move(head), length));
+    }
+
+    void Connection::shutdownAfter(Async::Promise<ssize_t> written)
+    {
+        std::weak_ptr<Connection> weak = shared_from_this();
+        auto shutdown                  = [weak]() {
+            auto connection = weak.lock();
+            if (!connection)
+                return;
+            if (auto peer = connection->peer_.lock())
+                ::shutdown(peer->fd(), SHUT_WR);
+        };
+
+        written.then([shutdown](ssize_t) { shutdown(); },
+                     [shutdown](std::exception_ptr) { shutdown(); });
+    }
+
+    void Connection::feed(const char* data, size_t size)
+    {
+        // The handler may let go of the connection meanwhile
+        auto self = shared_from_this();
+
+        if (!input_.empty())
+        {
+            input_.append(data, size);
+            data = input_.data();
+            size = input_.size();
+        }
+
+        size_t offset = 0;
+        while (!done_ && !closeReceived_ && offset < size)
+        {
+            const size_t used = parseFrame(data + offset, size - offset);
+            if (used == 0)
+                break;
+            offset += used;
+        }
+
+        if (done_ || closeReceived_)
+            input_.clear();
+        else if (data == input_.data())
+            input_.erase(0, offset);
+        else
+            input_.assign(data + offset, size - offset);
+    }
+
+    size_t Connection::parseFrame(const char* data, size_t size)
+    {
+        if (size < 2)
+            return 0;
+
+        const auto b0     = static_cast<uint8_t>(data[0]);
+        const auto b1     = static_cast<uint8_t>(data[1]);
+        const bool fin    = b0 & 0x80;
+        const bool rsv1   = b0 & 0x40;
+        const auto opcode = static_cast<Opcode>(b0 & 0x0F);
+        const bool control = b0 & 0x08;
+
+        if (b0 & 0x30)
+        {
+            fail(CloseCode::ProtocolError, "Reserved bits set");
+            return 0;
+        }
+        if (!(b1 & 0x80))
+        {
+            fail(CloseCode::ProtocolError, "Unmasked frame");
+            return 0;
+        }
+
+        uint64_t length = b1 & 0x7F;
+        size_t head     = 2;
+        if (length == 126)
+        {
+            if (size < 4)
+                return 0;
+            length = (uint64_t(uint8_t(data[2])) << 8) | uint8_t(data[3]);
+            head   = 4;
+        }
+        else if (length == 127)
+        {
+            if (size < 10)
+                return 0;
+            length = 0;
+            for (int i = 0; i < 8; ++i)
+                length = (length << 8) | uint8_t(data[2 + i]);
+            head = 10;
+        }
+
+        if (control)
+        {
+            if (opcode != Opcode::Close && opcode != Opcode::Ping && opcode != Opcode::Pong)
+            {
+                fail(CloseCode::ProtocolError, "Unknown opcode");
+                return 0;
+            }
+            if (!fin || rsv1 || length > MaxControlPayload)
+            {
+                fail(CloseCode::ProtocolError, "Invalid control frame");
+                return 0;
+            }
+        }
+        else
+        {
+            if (opcode != Opcode::Continuation && opcode != Opcode::Text && opcode != Opcode::Binary)
+            {
+                fail(CloseCode::ProtocolError, "Unknown opcode");
+                return 0;
+            }
+
+            // A new message starts where none is in progress, and only its
+            // first frame tells whether it is compressed
+            const bool inMessage = messageOpcode_ != Opcode::Continuation;
+            if ((opcode == Opcode::Continuation) != inMessage
+                || (rsv1 && (!deflate_ || opcode == Opcode::Continuation)))
+            {
+                fail(CloseCode::ProtocolError, "Unexpected frame");
+                return 0;
+            }
+
+            // Checked before waiting for the payload, which is then never
+            // buffered
+            if (length > maxMessageSize_ - message_.size())
+            {
+                fail(CloseCode::MessageTooBig, "Message too big");
+                return 0;
+            }
+        }
+
+        if (size - head < 4 || size - head - 4 < length)
+            return 0;
+
+        const auto* key     = reinterpret_cast<const uint8_t*>(data + head);
+        const char* payload = data + head + 4;
+
+        if (control)
+        {
+            std::string unmasked(payload, length);
+            Scan::applyMask(unmasked.data(), unmasked.size(), key);
+            onControl(opcode, std::move(unmasked));
+        }
+        else
+        {
+            if (opcode != Opcode::Continuation)
+            {
+                messageOpcode_     = opcode;
+                messageCompressed_ = rsv1;
+            }
+
+            // Unmasked in place, once appended to the message
+            const size_t start = message_.size();
+            message_.append(payload, length);
+            Scan::applyMask(message_.data() + start, length, key);
+
+            if (fin)
+                onMessage();
+        }
+
+        return head + 4 + length;
+    }
+
+    void Connection::onMessage()
+    {
+        std::string message;
+        message.swap(message_);
+        const auto opcode = messageOpcode_;
+        messageOpcode_    = Opcode::Continuation;
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+        if (messageCompressed_)
+        {
+            std::string inflated;
+            const auto result = deflate_->decompress(message, maxMessageSize_, inflated);
+            if (result == Deflate::Result::TooLarge)
+            {
+                fail(CloseCode::MessageTooBig, "Message too big");
+                return;
+            }
+            if (result == Deflate::Result::Invalid)
+            {
+                fail(CloseCode::InvalidPayload, "Invalid compressed data");
+                return;
+            }
+            message.swap(inflated);
+        }
+#endif
+
+        if (opcode == Opcode::Text && !validUtf8(message))
+        {
+            fail(CloseCode::InvalidPayload, "Invalid UTF-8");
+            return;
+        }
+
+        handler_->onMessage(shared_from_this(), std::move(message), opcode);
+    }
+
+    void Connection::onControl(Opcode opcode, std::string payload)
+    {
+        if (opcode == Opcode::Ping)
+        {
+            if (!closeSent_.load())
+                sendFrame(Opcode::Pong, payload.data(), payload.size(), nullptr);
+            return;
+        }
+        if (opcode == Opcode::Pong)
+            return;
+
+        closeReceived_ = true;
+
+        auto code = CloseCode::NoStatus;
+        std::string reason;
+        if (payload.size() == 1)
+        {
+            fail(CloseCode::ProtocolError, "Invalid close frame");
+            return;
+        }
+        if (payload.size() >= 2)
+        {
+            const auto value = static_cast<uint16_t>((uint8_t(payload[0]) << 8) | uint8_t(payload[1]));
+            reason.assign(payload, 2);
+            if (!validCloseCode(value) || !validUtf8(reason))
+            {
+                fail(CloseCode::ProtocolError, "Invalid close frame");
+                return;
+            }
+            code = static_cast<CloseCode>(value);
+        }
+
+        if (closeSent_.load())
+        {
+            // The answer to our close frame, the handshake is over
+            if (auto peer = peer_.lock())
+                ::shutdown(peer->fd(), SHUT_WR);
+        }
+        else
+        {
+            const auto echo = code == CloseCode::NoStatus ? std::string() : closePayload(code, "");
+            shutdownAfter(sendFrame(Opcode::Close, echo.data(), echo.size(), nullptr));
+        }
+
+        closed(code, reason);
+    }
+
+    void Connection::fail(CloseCode code, const char* reason)
+    {
+        if (!closeSent_.load())
+        {
+            const auto payload = closePayload(code, reason);
+            shutdownAfter(sendFrame(Opcode::Close, payload.data(), payload.size(), nullptr));
+        }
+        else if (auto peer = peer_.lock())
+        {
+            ::shutdown(peer->fd(), SHUT_WR);
+        }
+
+        closed(code, reason);
+    }
+
+    void Connection::closed(CloseCode code, const std::string& reason)
+    {
+        if (done_)
+            return;
+        done_ = true;
+
+        message_.clear();
+        handler_->onClose(shared_from_this(), code, reason);
+    }
+
+    void Connection::disconnected()
+    {
+        closeSent_.store(true);
+        closed(CloseCode::Abnormal, std::string());
+    }
+
+} // namespace Pistache::Http::WebSocket
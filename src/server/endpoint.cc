@@ -10,13 +10,17 @@
    Implementation of the http endpoint
 */
 
+#include <pistache/buffer_pool.h>
+#include <pistache/clock.h>
 #include <pistache/config.h>
 #include <pistache/endpoint.h>
+#include <pistache/os.h>
 #include <pistache/peer.h>
 #include <pistache/tcp.h>
 
 #include <array>
 #include <chrono>
+#include <thread>
 
 namespace Pistache::Http
 {
@@ -29,7 +33,6 @@ namespace Pistache::Http
         explicit TransportImpl(const std::shared_ptr<Tcp::Handler>& handler);
 
         void registerPoller(Polling::Epoll& poller) override;
-        void onReady(const Aio::FdSet& fds) override;
 
         void setHeaderTimeout(std::chrono::milliseconds timeout);
         void setBodyTimeout(std::chrono::milliseconds timeout);
@@ -43,8 +46,7 @@ namespace Pistache::Http
         std::chrono::milliseconds bodyTimeout_;
         std::chrono::milliseconds keepaliveTimeout_;
 
-        int timerFd;
-
+        void scheduleIdleCheck();
         void checkIdlePeers();
         bool checkTimeout(bool idle, Private::StepId id, std::chrono::milliseconds elapsed);
         void closePeer(std::shared_ptr<Tcp::Peer>& peer);
@@ -59,42 +61,21 @@ namespace Pistache::Http
     {
         Base::registerPoller(poller);
 
-        timerFd = TRY_RET(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK));
-
-        static constexpr auto TimerInterval   = std::chrono::milliseconds(500);
-        static constexpr auto TimerIntervalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(TimerInterval);
-
-        static_assert(
-            TimerInterval < std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::seconds(1)),
-            "Timer frequency should be less than 1 second");
-
-        itimerspec spec;
-        spec.it_value.tv_sec  = 0;
-        spec.it_value.tv_nsec = TimerIntervalNs.count();
-
-        spec.it_interval.tv_sec  = 0;
-        spec.it_interval.tv_nsec = TimerIntervalNs.count();
-
-        TRY(timerfd_settime(timerFd, 0, &spec, nullptr));
-
-        Polling::Tag tag(timerFd);
-        poller.addFd(timerFd, Flags<Polling::NotifyOn>(Polling::NotifyOn::Read), Polling::Tag(timerFd));
+        scheduleIdleCheck();
     }
 
-    void TransportImpl::onReady(const Aio::FdSet& fds)
+    void TransportImpl::scheduleIdleCheck()
     {
-        for (const auto& entry : fds)
-        {
-            if (entry.getTag() == Polling::Tag(timerFd))
-            {
-                uint64_t wakeups;
-                ::read(timerFd, &wakeups, sizeof wakeups);
-                checkIdlePeers();
-                break;
-            }
-        }
+        static constexpr auto CheckInterval = std::chrono::milliseconds(500);
+
+        static_assert(
+            CheckInterval < std::chrono::seconds(1),
+            "Idle check frequency should be less than 1 second");
 
-        Base::onReady(fds);
+        scheduleTimer(CheckInterval, [this]() {
+            checkIdlePeers();
+            scheduleIdleCheck();
+        });
     }
 
     void TransportImpl::setHeaderTimeout(std::chrono::milliseconds timeout)
@@ -113,22 +94,29 @@ namespace Pistache::Http
     void TransportImpl::checkIdlePeers()
     {
         std::vector<std::shared_ptr<Tcp::Peer>> idlePeers;
+        const auto now = CachedClock::now();
 
-        for (const auto& peerPair : peers)
-        {
-            const auto& peer = peerPair.second;
-            auto parser      = Http::Handler::getParser(peer);
-            auto time        = parser->time();
+        peers.forEach([&](Fd, const std::shared_ptr<Tcp::Peer>& peer) {
+            // Still going through its TLS handshake, the transport owns the
+            // timeout of that phase
+            auto* state = Http::Handler::connectionState(*peer);
+            if (!state)
+                return;
 
-            auto now     = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - time);
+            // The handler holds the body back itself, the client is not the
+            // one being slow
+            if (peer->isReadPaused())
+                return;
 
-            auto* step = parser->step();
-            if (checkTimeout(peer->isIdle(), step->id(), elapsed))
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - state->since);
+
+            // A connection without a parser is waiting for its next request
+            auto stepId = state->parser ? state->parser->step()->id() : Private::RequestLineStep::Id;
+            if (checkTimeout(peer->isIdle(), stepId, elapsed))
             {
                 idlePeers.push_back(peer);
             }
-        }
+        });
 
         for (auto& idlePeer : idlePeers)
         {
@@ -161,7 +149,8 @@ namespace Pistache::Http
     {
         // true: there is no http request on the keepalive peer -> only call removePeer
         // false: there is at least one http request on the peer(keepalive or not) -> send 408 message firsst, then call removePeer
-        if (peer->isIdle())
+        // An HTTP/2 connection has no single request to answer, it is closed
+        if (peer->isIdle() || Http::Handler::connectionState(*peer)->http2)
         {
             removePeer(peer);
         }
@@ -178,6 +167,14 @@ namespace Pistache::Http
         transport->setHeaderTimeout(headerTimeout_);
         transport->setBodyTimeout(bodyTimeout_);
         transport->setKeepaliveTimeout(keepaliveTimeout_);
+        transport->setMaxReceiveBufferSize(maxReceiveBufferSize());
+        transport->setAutoCork(autoCork());
+        transport->setSendFileBudget(sendFileBudget());
+        transport->setFilePrefetcher(filePrefetcher());
+        transport->setBufferPool(bufferPool());
+        transport->setSocketBusyPoll(socketBusyPoll());
+        transport->setIdleEviction(idleEviction());
+        transport->setZeroCopyThreshold(zeroCopyThreshold());
         return transport;
     }
 
@@ -193,6 +190,39 @@ namespace Pistache::Http
         , logger_(PISTACHE_NULL_STRING_LOGGER)
         // This should be moved after "keepaliveTimeout_" in the next ABI change
         , sslHandshakeTimeout_(Const::DefaultSSLHandshakeTimeout)
+        , pollingBackend_(Polling::Backend::Epoll)
+        , maxReceiveBufferSize_(Const::DefaultMaxReceiveBuffer)
+        , reuseRequestStorage_(false)
+        , lazyHeaders_(false)
+        , inPlaceChunks_(false)
+        , acceptPerWorker_(false)
+        , dispatchPolicy_(Tcp::DispatchPolicy::FdModulo)
+        , acceptThreads_(1)
+        , numaAware_(false)
+        , pinWorkers_(false)
+        , autoCork_(false)
+        , compression_()
+        , sendFileBudget_(Const::DefaultSendFileBudget)
+        , zeroCopyThreshold_(0)
+        , filePrefetchThreads_(0)
+        , bufferPoolBytes_(0)
+        , hugePageBuffers_(false)
+        , http2_(false)
+        , streamHighWatermark_(Const::DefaultHighWatermark)
+        , streamLowWatermark_(Const::DefaultLowWatermark)
+        , bodySpoolThreshold_(0)
+        , bodySpoolDirectory_("/tmp")
+        , maxConnections_(0)
+        , idleEviction_(0)
+        , workerPool_()
+        , busyPollSpin_(0)
+        , socketBusyPoll_(false)
+        , maxInFlight_(0)
+        , bodyBudget_(0)
+        , workerBodyBudget_(0)
+        , rateLimiter_()
+        , shedTarget_(0)
+        , shedInterval_(Const::DefaultShedInterval)
     { }
 
     Endpoint::Options& Endpoint::Options::threads(int val)
@@ -236,12 +266,196 @@ namespace Pistache::Http
         return *this;
     }
 
+    Endpoint::Options& Endpoint::Options::maxReceiveBufferSize(size_t val)
+    {
+        maxReceiveBufferSize_ = val;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::reuseRequestStorage(bool val)
+    {
+        reuseRequestStorage_ = val;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::lazyHeaders(bool val)
+    {
+        lazyHeaders_ = val;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::inPlaceChunks(bool val)
+    {
+        inPlaceChunks_ = val;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::acceptPerWorker(bool val)
+    {
+        acceptPerWorker_ = val;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::dispatchPolicy(Tcp::DispatchPolicy policy)
+    {
+        dispatchPolicy_ = policy;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::acceptThreads(size_t count)
+    {
+        acceptThreads_ = count;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::numaAware(bool val)
+    {
+        numaAware_ = val;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::pinWorkers(bool val)
+    {
+        pinWorkers_ = val;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::workerPool(std::shared_ptr<Tcp::WorkerPool> pool)
+    {
+        workerPool_ = std::move(pool);
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::maxConnections(size_t perWorker)
+    {
+        maxConnections_ = perWorker;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::evictIdleConnections(size_t perWorker)
+    {
+        idleEviction_ = perWorker;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::maxInFlight(size_t perWorker)
+    {
+        maxInFlight_ = perWorker;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::bodyBudget(size_t global, size_t perWorker)
+    {
+        bodyBudget_       = global;
+        workerBodyBudget_ = perWorker;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::rateLimit(std::shared_ptr<Http::RateLimiter> limiter)
+    {
+        rateLimiter_ = std::move(limiter);
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::autoCork(bool val)
+    {
+        autoCork_ = val;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::sendFileBudget(size_t bytes)
+    {
+        if (bytes == 0)
+            throw std::invalid_argument("Send file budget must be positive");
+
+        sendFileBudget_ = bytes;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::zeroCopySends(size_t threshold)
+    {
+        zeroCopyThreshold_ = threshold;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::filePrefetchThreads(size_t threads)
+    {
+        filePrefetchThreads_ = threads;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::bufferPool(size_t bytes, bool hugePages)
+    {
+        bufferPoolBytes_ = bytes;
+        hugePageBuffers_ = hugePages;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::compression(bool val)
+    {
+        compression_.enabled = val;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::compressionLevel(int val)
+    {
+        compression_.level = val;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::compressionMinSize(size_t val)
+    {
+        compression_.minSize = val;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::http2(bool val)
+    {
+        http2_ = val;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::streamWatermarks(size_t high, size_t low)
+    {
+        if (low > high)
+            throw std::invalid_argument("The low watermark is above the high one");
+
+        streamHighWatermark_ = high;
+        streamLowWatermark_  = low;
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::bodySpool(size_t threshold, std::string directory)
+    {
+        bodySpoolThreshold_ = threshold;
+        bodySpoolDirectory_ = std::move(directory);
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::accessLog(std::shared_ptr<Http::AccessLog> log)
+    {
+        accessLog_ = std::move(log);
+        return *this;
+    }
+
+    Endpoint::Options& Endpoint::Options::tracer(std::shared_ptr<Tracing::Tracer> tracer)
+    {
+        tracer_ = std::move(tracer);
+        return *this;
+    }
+
     Endpoint::Options& Endpoint::Options::logger(PISTACHE_STRING_LOGGER_T logger)
     {
         logger_ = logger;
         return *this;
     }
 
+    Endpoint::Options& Endpoint::Options::pollingBackend(Polling::Backend backend)
+    {
+        pollingBackend_ = backend;
+        return *this;
+    }
+
     Endpoint::Endpoint() = default;
 
     Endpoint::Endpoint(const Address& addr)
@@ -250,8 +464,19 @@ namespace Pistache::Http
 
     void Endpoint::init(const Endpoint::Options& options)
     {
-        listener.init(options.threads_, options.flags_, options.threadsName_);
-        listener.setTransportFactory([this, options] {
+        const size_t threads = options.threads_ == Options::AutoThreads
+            ? usableCpus()
+            : static_cast<size_t>(options.threads_);
+        listener.init(threads, options.flags_, options.threadsName_);
+        if (options.hugePageBuffers_)
+            BufferPool::setHugePages(true);
+
+        // One pool for all the workers
+        std::shared_ptr<Tcp::FilePrefetcher> prefetcher;
+        if (options.filePrefetchThreads_ > 0)
+            prefetcher = std::make_shared<Tcp::FilePrefetcher>(options.filePrefetchThreads_);
+
+        listener.setTransportFactory([this, options, prefetcher] {
             if (!handler_)
                 throw std::runtime_error("Must call setHandler()");
 
@@ -259,6 +484,15 @@ namespace Pistache::Http
             transport->setHeaderTimeout(options.headerTimeout_);
             transport->setBodyTimeout(options.bodyTimeout_);
             transport->setKeepaliveTimeout(options.keepaliveTimeout_);
+            transport->setMaxReceiveBufferSize(options.maxReceiveBufferSize_);
+            transport->setAutoCork(options.autoCork_);
+            transport->setSendFileBudget(options.sendFileBudget_);
+            transport->setFilePrefetcher(prefetcher);
+            transport->setBufferPool(options.bufferPoolBytes_);
+            transport->setIdleEviction(options.idleEviction_);
+            transport->setZeroCopyThreshold(options.zeroCopyThreshold_);
+            if (options.socketBusyPoll_)
+                transport->setSocketBusyPoll(options.busyPollSpin_);
 
             return transport;
         });
@@ -267,10 +501,40 @@ namespace Pistache::Http
         {
             handler_->setMaxRequestSize(options.maxRequestSize_);
             handler_->setMaxResponseSize(options.maxResponseSize_);
+            handler_->setRequestStorageReuse(options.reuseRequestStorage_);
+            handler_->setLazyHeaders(options.lazyHeaders_);
+            handler_->setInPlaceChunks(options.inPlaceChunks_);
+            handler_->setCompression(options.compression_);
+            handler_->setHttp2(options.http2_);
+            handler_->setStreamWatermarks(options.streamHighWatermark_, options.streamLowWatermark_);
+            handler_->setBodySpool(options.bodySpoolThreshold_, options.bodySpoolDirectory_);
+            handler_->setAccessLog(options.accessLog_);
+            handler_->setTracer(options.tracer_);
+            handler_->setMaxInFlight(options.maxInFlight_);
+            handler_->setBodyBudget(options.bodyBudget_, options.workerBodyBudget_);
+            handler_->setRateLimiter(options.rateLimiter_);
+            handler_->setLoadShedding(options.shedTarget_, options.shedInterval_);
         }
 
         options_ = options;
         logger_  = options.logger_;
+
+        auto backend = options.pollingBackend_;
+        if (!Polling::Epoll::isSupported(backend))
+        {
+            PISTACHE_LOG_STRING_WARN(logger_, "io_uring is not available, falling back to epoll");
+            backend = Polling::Backend::Epoll;
+        }
+        listener.setPollingBackend(backend);
+        listener.setAcceptPerWorker(options.acceptPerWorker_);
+        listener.setDispatchPolicy(options.dispatchPolicy_);
+        listener.setAcceptThreads(options.acceptThreads_);
+        listener.setNumaAware(options.numaAware_);
+        listener.setPinWorkers(options.pinWorkers_);
+        listener.setMaxConnections(options.maxConnections_);
+        listener.setBusyPoll(options.busyPollSpin_);
+        listener.setWorkerPool(options.workerPool_);
+        listener.setHttp2(options.http2_);
     }
 
     void Endpoint::setHandler(const std::shared_ptr<Handler>& handler)
@@ -278,6 +542,19 @@ namespace Pistache::Http
         handler_ = handler;
         handler_->setMaxRequestSize(options_.maxRequestSize_);
         handler_->setMaxResponseSize(options_.maxResponseSize_);
+        handler_->setRequestStorageReuse(options_.reuseRequestStorage_);
+        handler_->setLazyHeaders(options_.lazyHeaders_);
+        handler_->setInPlaceChunks(options_.inPlaceChunks_);
+        handler_->setCompression(options_.compression_);
+        handler_->setHttp2(options_.http2_);
+        handler_->setStreamWatermarks(options_.streamHighWatermark_, options_.streamLowWatermark_);
+        handler_->setBodySpool(options_.bodySpoolThreshold_, options_.bodySpoolDirectory_);
+        handler_->setAccessLog(options_.accessLog_);
+        handler_->setTracer(options_.tracer_);
+        handler_->setMaxInFlight(options_.maxInFlight_);
+        handler_->setBodyBudget(options_.bodyBudget_, options_.workerBodyBudget_);
+        handler_->setRateLimiter(options_.rateLimiter_);
+        handler_->setLoadShedding(options_.shedTarget_, options_.shedInterval_);
     }
 
     void Endpoint::bind() { listener.bind(); }
@@ -290,6 +567,23 @@ namespace Pistache::Http
 
     void Endpoint::shutdown() { listener.shutdown(); }
 
+    bool Endpoint::drain(std::chrono::milliseconds timeout)
+    {
+        // The workers close the peers as they go idle, they do not tell
+        static constexpr auto Poll = std::chrono::milliseconds(10);
+
+        listener.drain();
+
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (listener.connectionCount() > 0)
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::sleep_for(Poll);
+        }
+        return true;
+    }
+
     void Endpoint::useSSL([[maybe_unused]] const std::string& cert, [[maybe_unused]] const std::string& key, [[maybe_unused]] bool use_compression, [[maybe_unused]] int (*pass_cb)(char*, int, int, void*))
     {
 #ifndef PISTACHE_USE_SSL
@@ -309,6 +603,26 @@ namespace Pistache::Http
 #endif /* PISTACHE_USE_SSL */
     }
 
+    void Endpoint::useSSLSessions([[maybe_unused]] std::shared_ptr<Tcp::TlsSessionStore> store,
+                                  [[maybe_unused]] std::chrono::seconds timeout,
+                                  [[maybe_unused]] std::chrono::seconds ticketKeyRotation)
+    {
+#ifndef PISTACHE_USE_SSL
+        throw std::runtime_error("Pistache is not compiled with SSL support.");
+#else
+        listener.setupSSLSessions(std::move(store), timeout, ticketKeyRotation);
+#endif /* PISTACHE_USE_SSL */
+    }
+
+    void Endpoint::useKTLS()
+    {
+#ifndef PISTACHE_USE_SSL
+        throw std::runtime_error("Pistache is not compiled with SSL support.");
+#else
+        listener.setupKTLS();
+#endif /* PISTACHE_USE_SSL */
+    }
+
     Async::Promise<Tcp::Listener::Load>
     Endpoint::requestLoad(const Tcp::Listener::Load& old)
     {
@@ -0,0 +1,333 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* file_cache.cc
+
+   Implementation of the cache of static files
+*/
+
+#include <pistache/compression.h>
+#include <pistache/file_cache.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../common/string_utils.h"
+
+namespace Pistache::Http
+{
+
+    namespace
+    {
+        enum Which { Identity,
+                     Br,
+                     Gzip };
+
+        constexpr const char* Suffixes[] = { "", ".br", ".gz" };
+
+        // Strong validator built from what identifies a version of the file
+        std::string makeETag(const struct stat& sb, const char* tagSuffix)
+        {
+            const auto mtime = static_cast<unsigned long long>(sb.st_mtim.tv_sec) * 1000000000ULL
+                + static_cast<unsigned long long>(sb.st_mtim.tv_nsec);
+
+            char buf[96];
+            std::snprintf(buf, sizeof(buf), "\"%llx-%llx-%llx%s\"",
+                          static_cast<unsigned long long>(sb.st_ino),
+                          static_cast<unsigned long long>(sb.st_size), mtime, tagSuffix);
+            return buf;
+        }
+
+        // If-None-Match uses the weak comparison (RFC 9110 13.1.2)
+        bool tagMatches(std::string_view ifNoneMatch, const std::string& etag)
+        {
+            while (!ifNoneMatch.empty())
+            {
+                auto end    = ifNoneMatch.find(',');
+                auto tag    = Private::trim(ifNoneMatch.substr(0, end));
+                ifNoneMatch = end == std::string_view::npos ? std::string_view() : ifNoneMatch.substr(end + 1);
+
+                if (tag == "*")
+                    return true;
+                if (tag.substr(0, 2) == "W/")
+                    tag.remove_prefix(2);
+
+                if (tag == etag)
+                    return true;
+            }
+
+            return false;
+        }
+    } // namespace
+
+    bool FileCache::Stat::operator==(const Stat& other) const
+    {
+        if (exists != other.exists)
+            return false;
+        if (!exists)
+            return true;
+
+        return dev == other.dev && ino == other.ino && size == other.size
+            && mtime == other.mtime && mtimeNs == other.mtimeNs;
+    }
+
+    FileCache::FileCache(std::chrono::milliseconds revalidateAfter, size_t maxEntries)
+        : revalidateAfter_(revalidateAfter)
+        , maxEntries_(maxEntries)
+    { }
+
+    Async::Promise<ssize_t> FileCache::serve(const Request& request, ResponseWriter& writer,
+                                             const std::string& fileName,
+                                             const Mime::MediaType& contentType)
+    {
+        auto entry = lookup(fileName);
+
+        Which which = Identity;
+        if (entry->br || entry->gzip)
+        {
+            if (auto accept = request.headers().tryGetRaw("Accept-Encoding"))
+            {
+                const auto value = accept->value();
+                const double br  = entry->br ? Compression::acceptWeight(value, Header::Encoding::Br) : 0.0;
+                const double gz  = entry->gzip ? Compression::acceptWeight(value, Header::Encoding::Gzip) : 0.0;
+
+                if (br > 0.0 && br >= gz)
+                    which = Br;
+                else if (gz > 0.0)
+                    which = Gzip;
+            }
+        }
+
+        const Variant* variant = &entry->identity;
+        if (which == Br)
+            variant = &*entry->br;
+        else if (which == Gzip)
+            variant = &*entry->gzip;
+
+        auto& headers = writer.headers();
+        headers.add<Header::ETag>(variant->etag);
+        headers.add<Header::LastModified>(entry->lastModified);
+        if (entry->br || entry->gzip)
+            headers.add<Header::Vary>("Accept-Encoding");
+
+        // If-None-Match takes precedence over If-Modified-Since (RFC 9110 13.2.2)
+        bool notModified = false;
+        if (auto ifNoneMatch = request.headers().tryGetRaw("If-None-Match"))
+        {
+            notModified = tagMatches(ifNoneMatch->value(), variant->etag);
+        }
+        else if (auto ifModifiedSince = request.headers().tryGetRaw("If-Modified-Since"))
+        {
+            try
+            {
+                auto since  = FullDate::fromString(ifModifiedSince->value());
+                notModified = entry->lastModified.date() <= since.date();
+            }
+            catch (const std::exception&)
+            {
+                // An invalid date is ignored
+            }
+        }
+
+        if (notModified)
+            return writer.send(Code::Not_Modified);
+
+        if (which == Br)
+            headers.add<Header::ContentEncoding>(Header::Encoding::Br);
+        else if (which == Gzip)
+            headers.add<Header::ContentEncoding>(Header::Encoding::Gzip);
+
+        return serveFile(request, writer, FileBuffer(variant->file, variant->size),
+                         contentType.isValid() ? contentType : entry->mime);
+    }
+
+    void FileCache::setPrecompressed(bool enabled) { precompressed_ = enabled; }
+
+    size_t FileCache::size() const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return slots_.size();
+    }
+
+    void FileCache::clear()
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        slots_.clear();
+        lru_.clear();
+    }
+
+    std::shared_ptr<const FileCache::Entry> FileCache::lookup(const std::string& fileName)
+    {
+        const auto now = std::chrono::steady_clock::now();
+
+        std::shared_ptr<const Entry> cached;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            auto it = slots_.find(fileName);
+            if (it != std::end(slots_))
+            {
+                lru_.splice(lru_.begin(), lru_, it->second.lru);
+                if (now - it->second.validated < revalidateAfter_)
+                    return it->second.entry;
+
+                cached = it->second.entry;
+            }
+        }
+
+        // The entry is too old to be trusted, it still is when neither the
+        // file nor its siblings changed since they were opened
+        if (cached)
+        {
+            Stat current[3];
+            stat(fileName, current);
+
+            bool unchanged = true;
+            for (size_t i = 0; i < 3; ++i)
+                unchanged = unchanged && current[i] == cached->stats[i];
+
+            if (unchanged)
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                auto it = slots_.find(fileName);
+                if (it != std::end(slots_) && it->second.entry == cached)
+                    it->second.validated = now;
+                return cached;
+            }
+        }
+
+        std::shared_ptr<const Entry> entry;
+        try
+        {
+            entry = load(fileName);
+        }
+        catch (const HttpError&)
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            auto it = slots_.find(fileName);
+            if (it != std::end(slots_))
+            {
+                lru_.erase(it->second.lru);
+                slots_.erase(it);
+            }
+            throw;
+        }
+
+        std::lock_guard<std::mutex> guard(lock_);
+        auto it = slots_.find(fileName);
+        if (it != std::end(slots_))
+        {
+            it->second.entry     = entry;
+            it->second.validated = now;
+            return entry;
+        }
+
+        lru_.push_front(fileName);
+        slots_.emplace(fileName, Slot { entry, now, lru_.begin() });
+
+        while (slots_.size() > maxEntries_)
+        {
+            slots_.erase(lru_.back());
+            lru_.pop_back();
+        }
+
+        return entry;
+    }
+
+    std::shared_ptr<const FileCache::Entry> FileCache::load(const std::string& fileName) const
+    {
+        auto entry = std::make_shared<Entry>();
+
+        const size_t variants = precompressed_ ? 3 : 1;
+        for (size_t i = 0; i < variants; ++i)
+        {
+            const auto path = fileName + Suffixes[i];
+
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1)
+            {
+                if (i != Identity)
+                    continue;
+
+                std::string error(strerror(errno));
+                throw HttpError(errno == ENOENT ? Code::Not_Found : Code::Internal_Server_Error,
+                                std::move(error));
+            }
+
+            auto file = FileBuffer::own(fd);
+
+            struct stat sb;
+            if (::fstat(fd, &sb) == -1 || !S_ISREG(sb.st_mode))
+            {
+                if (i != Identity)
+                    continue;
+                throw HttpError(Code::Internal_Server_Error, "Not a regular file");
+            }
+
+            // A sibling older than the file has not been compressed from it
+            if (i != Identity && sb.st_mtim.tv_sec < entry->stats[Identity].mtime)
+                continue;
+
+            auto& stats   = entry->stats[i];
+            stats.exists  = true;
+            stats.dev     = sb.st_dev;
+            stats.ino     = sb.st_ino;
+            stats.size    = sb.st_size;
+            stats.mtime   = sb.st_mtim.tv_sec;
+            stats.mtimeNs = sb.st_mtim.tv_nsec;
+
+            Variant variant { std::move(file), static_cast<size_t>(sb.st_size),
+                              makeETag(sb, i == Br ? "-br" : i == Gzip ? "-gz" : "") };
+
+            switch (i)
+            {
+            case Identity:
+                entry->identity     = std::move(variant);
+                entry->lastModified = FullDate(std::chrono::system_clock::from_time_t(sb.st_mtim.tv_sec));
+                entry->mime         = Mime::MediaType::fromFile(fileName.c_str());
+                break;
+            case Br:
+                entry->br = std::move(variant);
+                break;
+            case Gzip:
+                entry->gzip = std::move(variant);
+                break;
+            }
+        }
+
+        return entry;
+    }
+
+    void FileCache::stat(const std::string& fileName, Stat (&stats)[3]) const
+    {
+        const size_t variants = precompressed_ ? 3 : 1;
+        for (size_t i = 0; i < variants; ++i)
+        {
+            const auto path = fileName + Suffixes[i];
+
+            struct stat sb;
+            if (::stat(path.c_str(), &sb) == -1 || !S_ISREG(sb.st_mode))
+                continue;
+
+            // Mirrors load(), which skips the siblings older than the file
+            if (i != Identity && sb.st_mtim.tv_sec < stats[Identity].mtime)
+                continue;
+
+            stats[i].exists  = true;
+            stats[i].dev     = sb.st_dev;
+            stats[i].ino     = sb.st_ino;
+            stats[i].size    = sb.st_size;
+            stats[i].mtime   = sb.st_mtim.tv_sec;
+            stats[i].mtimeNs = sb.st_mtim.tv_nsec;
+        }
+    }
+
+} // namespace Pistache::Http
@@ -15,19 +15,29 @@
 #include <pistache/os.h>
 #include <pistache/peer.h>
 #include <pistache/ssl_wrappers.h>
+#include <pistache/tracing.h>
 #include <pistache/transport.h>
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/timerfd.h>
 #include <sys/types.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <cerrno>
@@ -36,8 +46,14 @@
 #ifdef PISTACHE_USE_SSL
 
 #include <openssl/err.h>
+#include <openssl/rand.h>
 #include <openssl/ssl.h>
 
+// Names of the parameters of the ticket key callback, OpenSSL 3 only
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif /* OPENSSL_VERSION_NUMBER */
+
 #endif /* PISTACHE_USE_SSL */
 
 using namespace std::chrono_literals;
@@ -145,6 +161,214 @@ namespace Pistache::Tcp
             return ctx;
         }
 
+        // Key that encrypts the session tickets, named by 16 random bytes
+        struct TicketKey
+        {
+            unsigned char name[16];
+            unsigned char aes[32];
+            unsigned char hmac[32];
+            std::chrono::steady_clock::time_point created;
+            std::chrono::steady_clock::time_point expires;
+        };
+
+        // State of the session resumption, owned by the SSL context
+        struct SessionState
+        {
+            std::shared_ptr<TlsSessionStore> store;
+            std::chrono::seconds timeout;
+            std::chrono::seconds rotation;
+
+            std::mutex lock;
+            // The first key encrypts the new tickets, the others still
+            // decrypt the tickets they issued until these expire
+            std::deque<TicketKey> keys;
+
+            bool currentKey(TicketKey& key)
+            {
+                const auto now = std::chrono::steady_clock::now();
+
+                std::lock_guard<std::mutex> guard(lock);
+                while (!keys.empty() && keys.back().expires <= now)
+                    keys.pop_back();
+
+                if (keys.empty() || now - keys.front().created >= rotation)
+                {
+                    TicketKey fresh;
+                    if (RAND_bytes(fresh.name, sizeof(fresh.name)) <= 0
+                        || RAND_bytes(fresh.aes, sizeof(fresh.aes)) <= 0
+                        || RAND_bytes(fresh.hmac, sizeof(fresh.hmac)) <= 0)
+                        return false;
+
+                    fresh.created = now;
+                    fresh.expires = std::chrono::steady_clock::time_point::max();
+                    if (!keys.empty())
+                        keys.front().expires = now + timeout;
+                    keys.push_front(fresh);
+                }
+
+                key = keys.front();
+                return true;
+            }
+
+            // Whether a key decrypts the ticket, and whether it still is the
+            // one tickets are encrypted with
+            bool findKey(const unsigned char* name, TicketKey& key, bool& current)
+            {
+                const auto now = std::chrono::steady_clock::now();
+
+                std::lock_guard<std::mutex> guard(lock);
+                for (size_t i = 0; i < keys.size(); ++i)
+                {
+                    if (std::memcmp(keys[i].name, name, sizeof(keys[i].name)) != 0)
+                        continue;
+                    if (keys[i].expires <= now)
+                        return false;
+
+                    key     = keys[i];
+                    current = i == 0 && now - key.created < rotation;
+                    return true;
+                }
+
+                return false;
+            }
+        };
+
+        int sessionStateIndex()
+        {
+            static const int index = SSL_CTX_get_ex_new_index(
+                0, nullptr, nullptr, nullptr,
+                [](void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*) {
+                    delete static_cast<SessionState*>(ptr);
+                });
+            return index;
+        }
+
+        SessionState* sessionState(SSL_CTX* ctx)
+        {
+            return static_cast<SessionState*>(SSL_CTX_get_ex_data(ctx, sessionStateIndex()));
+        }
+
+        std::string sessionId(const SSL_SESSION* session)
+        {
+            unsigned int length = 0;
+            const auto* id      = SSL_SESSION_get_id(session, &length);
+            return std::string(reinterpret_cast<const char*>(id), length);
+        }
+
+        // The callbacks below are called by OpenSSL, the exceptions of the
+        // store must not unwind through it: a failure is a cache miss
+
+        int storeSession(SSL* ssl, SSL_SESSION* session)
+        {
+            auto* state = sessionState(SSL_get_SSL_CTX(ssl));
+
+            const int size = i2d_SSL_SESSION(session, nullptr);
+            if (size <= 0)
+                return 0;
+
+            std::string der(static_cast<size_t>(size), '\0');
+            auto* out = reinterpret_cast<unsigned char*>(der.data());
+            i2d_SSL_SESSION(session, &out);
+
+            try
+            {
+                state->store->put(sessionId(session), std::move(der),
+                                  std::chrono::seconds(SSL_SESSION_get_timeout(session)));
+            }
+            catch (...)
+            { }
+
+            // The session is serialized, no reference is kept on it
+            return 0;
+        }
+
+        SSL_SESSION* loadSession(SSL* ssl, const unsigned char* id, int length, int* copy)
+        {
+            auto* state = sessionState(SSL_get_SSL_CTX(ssl));
+            *copy       = 0;
+
+            std::optional<std::string> der;
+            try
+            {
+                der = state->store->get(std::string(reinterpret_cast<const char*>(id),
+                                                    static_cast<size_t>(length)));
+            }
+            catch (...)
+            { }
+
+            if (!der)
+                return nullptr;
+
+            const auto* in = reinterpret_cast<const unsigned char*>(der->data());
+            return d2i_SSL_SESSION(nullptr, &in, static_cast<long>(der->size()));
+        }
+
+        void removeSession(SSL_CTX* ctx, SSL_SESSION* session)
+        {
+            try
+            {
+                sessionState(ctx)->store->remove(sessionId(session));
+            }
+            catch (...)
+            { }
+        }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        int ticketKey(SSL* ssl, unsigned char* name, unsigned char* iv,
+                      EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac, int encrypt)
+        {
+            auto* state = sessionState(SSL_get_SSL_CTX(ssl));
+
+            TicketKey key;
+            bool current = true;
+            if (encrypt)
+            {
+                if (!state->currentKey(key) || RAND_bytes(iv, EVP_MAX_IV_LENGTH) <= 0)
+                    return -1;
+
+                std::memcpy(name, key.name, sizeof(key.name));
+                if (!EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aes, iv))
+                    return -1;
+            }
+            else
+            {
+                // Unknown or expired, a full handshake follows
+                if (!state->findKey(name, key, current))
+                    return 0;
+                if (!EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aes, iv))
+                    return -1;
+            }
+
+            char digest[] = "SHA256";
+            OSSL_PARAM params[] {
+                OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmac, sizeof(key.hmac)),
+                OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+                OSSL_PARAM_construct_end()
+            };
+            if (!EVP_MAC_CTX_set_params(mac, params))
+                return -1;
+
+            // A ticket decrypted with a retired key is renewed
+            return current ? 1 : 2;
+        }
+#endif
+
+        // The protocols of the server in its order of preference, the
+        // client is answered with the first one it offers as well
+        int selectProtocol(SSL* /*ssl*/, const unsigned char** out, unsigned char* outlen,
+                           const unsigned char* in, unsigned int inlen, void* /*arg*/)
+        {
+            static const unsigned char protocols[] = "\x02h2\x08http/1.1";
+
+            unsigned char* selected = nullptr;
+            if (SSL_select_next_proto(&selected, outlen, protocols, sizeof(protocols) - 1, in, inlen)
+                != OPENSSL_NPN_NEGOTIATED)
+                return SSL_TLSEXT_ERR_NOACK;
+
+            *out = selected;
+            return SSL_TLSEXT_ERR_OK;
+        }
+
     }
 #endif /* PISTACHE_USE_SSL */
 
@@ -180,8 +404,76 @@ namespace Pistache::Tcp
             int one = 1;
             TRY(::setsockopt(fd, SOL_TCP, TCP_NODELAY, &one, sizeof(one)));
         }
+
+        if (options.hasFlag(Options::DeferAccept))
+        {
+            int timeout = static_cast<int>(Const::DeferAcceptTimeout.count());
+            TRY(::setsockopt(fd, SOL_TCP, TCP_DEFER_ACCEPT, &timeout, sizeof(timeout)));
+        }
+    }
+
+    namespace
+    {
+        Fd bindUnixSocket(const Address& address, Flags<Options> options, int backlog)
+        {
+            int socktype = SOCK_STREAM;
+            if (options.hasFlag(Options::CloseOnExec))
+                socktype |= SOCK_CLOEXEC;
+
+            Fd fd = TRY_RET(::socket(AF_UNIX, socktype, 0));
+
+            // Options of the TCP level, which a Unix domain socket does not have
+            auto socketOptions = options;
+            for (auto tcpOnly : { Options::ReusePort, Options::FastOpen, Options::NoDelay,
+                                  Options::DeferAccept })
+            {
+                if (socketOptions.hasFlag(tcpOnly))
+                    socketOptions.toggleFlag(tcpOnly);
+            }
+            setSocketOptions(fd, socketOptions);
+
+            // The file of a previous server is in the way, as long as it is a
+            // socket nobody listens on anymore
+            const auto path = address.host();
+            struct stat st;
+            if (options.hasFlag(Options::ReuseAddr) && path.front() != '@'
+                && ::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+            {
+                const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                struct sockaddr_storage storage;
+                const auto len = address.toSockaddr(storage);
+                if (probe >= 0
+                    && ::connect(probe, reinterpret_cast<struct sockaddr*>(&storage), len) < 0
+                    && errno == ECONNREFUSED)
+                    ::unlink(path.c_str());
+                if (probe >= 0)
+                    ::close(probe);
+            }
+
+            struct sockaddr_storage storage;
+            const auto len = address.toSockaddr(storage);
+            if (::bind(fd, reinterpret_cast<struct sockaddr*>(&storage), len) < 0
+                || ::listen(fd, backlog) < 0)
+            {
+                const int error = errno;
+                ::close(fd);
+                throw std::runtime_error(strerror(error));
+            }
+            return fd;
+        }
+    } // namespace
+
+    WorkerPool::WorkerPool(const Aio::AsyncContext& context) { reactor_.init(context); }
+
+    WorkerPool::~WorkerPool() { shutdown(); }
+
+    void WorkerPool::start()
+    {
+        std::call_once(started_, [this] { reactor_.run(); });
     }
 
+    void WorkerPool::shutdown() { reactor_.shutdown(); }
+
     Listener::Listener()
         : transportFactory_(defaultTransportFactory())
     { }
@@ -197,12 +489,24 @@ namespace Pistache::Tcp
             shutdown();
         if (acceptThread.joinable())
             acceptThread.join();
+        for (auto& loop : acceptLoops_)
+        {
+            if (loop->thread.joinable())
+                loop->thread.join();
+        }
 
         if (listen_fd >= 0)
         {
             close(listen_fd);
             listen_fd = -1;
+
+            // The file of the socket would keep the next server from binding
+            if (ownsSocketFile_ && addr_.family() == AF_UNIX && addr_.host().front() != '@')
+                ::unlink(addr_.host().c_str());
         }
+
+        for (auto fd : workerListenFds_)
+            close(fd);
     }
 
     void Listener::init(size_t workers, Flags<Options> options,
@@ -227,32 +531,302 @@ namespace Pistache::Tcp
         transportFactory_ = std::move(factory);
     }
 
+    void Listener::setPollingBackend(Polling::Backend backend)
+    {
+        backend_ = backend;
+    }
+
+    void Listener::setAcceptPerWorker(bool value) { acceptPerWorker_ = value; }
+
+    void Listener::setDispatchPolicy(DispatchPolicy policy) { dispatchPolicy_ = policy; }
+
+    void Listener::setMaxConnections(size_t perWorker) { maxConnections_ = perWorker; }
+
+    void Listener::setBusyPoll(std::chrono::microseconds spin) { busyPoll_ = spin; }
+
+    void Listener::setWorkerPool(std::shared_ptr<WorkerPool> pool)
+    {
+        if (isBound())
+            throw std::domain_error("Invalid operation, the worker pool must be set before bind()");
+        workerPool_ = std::move(pool);
+    }
+
+    void Listener::setAcceptThreads(size_t count)
+    {
+        if (isBound())
+            throw std::domain_error("Invalid operation, accept threads must be set before bind()");
+        if (count == 0)
+            throw std::invalid_argument("At least one accept thread is needed");
+
+        acceptThreads_ = count;
+    }
+
     void Listener::setHandler(const std::shared_ptr<Handler>& handler)
     {
         handler_ = handler;
     }
 
-    void Listener::pinWorker([[maybe_unused]] size_t worker, [[maybe_unused]] const CpuSet& set)
+    void Listener::setNumaAware(bool value) { numaAware_ = value; }
+
+    void Listener::setPinWorkers(bool value) { pinWorkers_ = value; }
+
+    void Listener::setHttp2(bool value)
     {
-#if 0
-    if (ioGroup.empty()) {
-        throw std::domain_error("Invalid operation, did you call init() before ?");
+        http2_ = value;
+#ifdef PISTACHE_USE_SSL
+        if (ssl_ctx_ != nullptr)
+            setupALPN();
+#endif /* PISTACHE_USE_SSL */
     }
-    if (worker > ioGroup.size()) {
-        throw std::invalid_argument("Trying to pin invalid worker");
+
+    void Listener::pinWorker(size_t worker, const CpuSet& set)
+    {
+        if (isBound())
+            throw std::domain_error("Invalid operation, workers must be pinned before bind()");
+        if (worker >= workers_)
+            throw std::invalid_argument("Trying to pin invalid worker");
+
+        if (workerAffinity_.size() < workers_)
+            workerAffinity_.resize(workers_);
+        workerAffinity_[worker] = set;
     }
 
-    auto &wrk = ioGroup[worker];
-    wrk->pin(set);
-#endif
+    void Listener::assignWorkerCpus()
+    {
+        workerAffinity_.resize(workers_);
+
+        const auto cpus = availableCpus();
+        for (auto cpu : cpus)
+        {
+            if (cpuNodes_.size() <= cpu)
+                cpuNodes_.resize(cpu + 1, -1);
+            cpuNodes_[cpu] = cpuNode(cpu);
+        }
+
+        if ((numaAware_ || pinWorkers_) && !cpus.empty())
+        {
+            // Take the cpus of every node in turn, so that each node gets its
+            // share of the workers
+            std::map<int, std::vector<size_t>> nodes;
+            for (auto cpu : cpus)
+                nodes[cpuNodes_[cpu]].push_back(cpu);
+
+            std::vector<size_t> order;
+            order.reserve(cpus.size());
+            for (size_t round = 0; order.size() < cpus.size(); ++round)
+            {
+                for (const auto& node : nodes)
+                {
+                    if (round < node.second.size())
+                        order.push_back(node.second[round]);
+                }
+            }
+
+            size_t next = 0;
+            for (auto& affinity : workerAffinity_)
+            {
+                if (affinity.count() == 0)
+                    affinity.set(order[next++ % order.size()]);
+            }
+        }
+
+        workerNodes_.assign(workers_, -1);
+        for (size_t i = 0; i < workers_; ++i)
+        {
+            const auto& affinity = workerAffinity_[i];
+            if (affinity.count() == 0)
+                continue;
+
+            std::optional<int> node;
+            for (size_t cpu = 0; cpu < CpuSet::Size; ++cpu)
+            {
+                if (!affinity.isSet(cpu))
+                    continue;
+
+                const int cpuNodeId = cpu < cpuNodes_.size() ? cpuNodes_[cpu] : cpuNode(cpu);
+                if (node && *node != cpuNodeId)
+                {
+                    node = -1;
+                    break;
+                }
+                node = cpuNodeId;
+            }
+
+            workerNodes_[i] = node.value_or(-1);
+        }
+    }
+
+    void Listener::bind()
+    {
+        if (adoptedFd_ == -1)
+        {
+            bind(addr_);
+            return;
+        }
+
+        if (workerPool_ && acceptPerWorker_)
+            throw std::invalid_argument("acceptPerWorker needs workers of its own");
+
+        struct sockaddr_storage bound_addr;
+        socklen_t bound_len = sizeof(bound_addr);
+        auto* bound_alias   = reinterpret_cast<struct sockaddr*>(&bound_addr);
+        TRY(::getsockname(adoptedFd_, bound_alias, &bound_len));
+
+        addr_           = Address::fromUnix(bound_alias);
+        ownsSocketFile_ = false;
+        bindListenSocket(std::exchange(adoptedFd_, -1));
+    }
+
+    void Listener::adoptListenSocket(Fd fd)
+    {
+        if (isBound())
+            throw std::domain_error("Invalid operation, the listener is already bound");
+
+        int listening = 0;
+        socklen_t len = sizeof(listening);
+        if (::getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) < 0 || !listening)
+            throw std::invalid_argument("The socket is not listening");
+
+        if (options_.hasFlag(Options::CloseOnExec))
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        adoptedFd_ = fd;
+    }
+
+    std::vector<Fd> Listener::activationSockets()
+    {
+        // SD_LISTEN_FDS_START, the sockets follow the standard streams
+        static constexpr Fd First = 3;
+
+        const char* pid   = std::getenv("LISTEN_PID");
+        const char* count = std::getenv("LISTEN_FDS");
+        if (pid == nullptr || count == nullptr || std::strtol(pid, nullptr, 10) != ::getpid())
+            return {};
+
+        std::vector<Fd> fds;
+        for (long i = 0; i < std::strtol(count, nullptr, 10); ++i)
+        {
+            const Fd fd = First + static_cast<Fd>(i);
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+            fds.push_back(fd);
+        }
+        return fds;
+    }
+
+    void Listener::sendListenSocket(Fd channel)
+    {
+        if (!isBound())
+            throw std::domain_error("Invalid operation, the listener is not bound");
+
+        char byte = 0;
+        struct iovec iov;
+        iov.iov_base = &byte;
+        iov.iov_len  = 1;
+
+        alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(Fd))];
+        std::memset(control, 0, sizeof(control));
+
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+
+        auto* cmsg       = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_RIGHTS;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(Fd));
+        std::memcpy(CMSG_DATA(cmsg), &listen_fd, sizeof(Fd));
+
+        TRY(::sendmsg(channel, &msg, MSG_NOSIGNAL));
+
+        // The file now names the socket of the other process as well
+        ownsSocketFile_ = false;
+    }
+
+    Fd Listener::receiveListenSocket(Fd channel)
+    {
+        char byte = 0;
+        struct iovec iov;
+        iov.iov_base = &byte;
+        iov.iov_len  = 1;
+
+        alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(Fd))];
+        std::memset(control, 0, sizeof(control));
+
+        struct msghdr msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+
+        TRY(::recvmsg(channel, &msg, MSG_CMSG_CLOEXEC));
+
+        auto* cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+            throw std::runtime_error("No listening socket was received");
+
+        Fd fd = -1;
+        std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(Fd));
+        return fd;
+    }
+
+    void Listener::drain()
+    {
+        if (draining_.exchange(true) || !isBound())
+            return;
+
+        // The accept threads leave the socket alone from now on, the
+        // one of a full listener is not polled already
+        if (!acceptPerWorker_)
+        {
+            std::vector<Polling::Epoll*> pollers { &poller };
+            for (auto& loop : acceptLoops_)
+                pollers.push_back(&loop->poller);
+
+            for (auto* accepting : pollers)
+            {
+                try
+                {
+                    accepting->removeFd(listen_fd);
+                }
+                catch (const std::exception&)
+                { }
+            }
+        }
+
+        for (const auto& handler : reactor().handlers(transportKey))
+            std::static_pointer_cast<Transport>(handler)->drain();
     }
 
-    void Listener::bind() { bind(addr_); }
+    size_t Listener::connectionCount()
+    {
+        if (!isBound())
+            return 0;
+
+        size_t count = 0;
+        for (const auto& handler : reactor().handlers(transportKey))
+            count += std::static_pointer_cast<Transport>(handler)->peerCount();
+        return count;
+    }
 
     void Listener::bind(const Address& address)
     {
+        // The listening sockets of the workers would outlive the listener
+        if (workerPool_ && acceptPerWorker_)
+            throw std::invalid_argument("acceptPerWorker needs workers of its own");
+
         addr_ = address;
 
+        if (address.family() == AF_UNIX)
+            bindListenSocket(bindUnixSocket(address, options_, backlog_));
+        else
+            bindListenSocket(bindTcpSocket(address));
+    }
+
+    Fd Listener::bindTcpSocket(const Address& address)
+    {
         struct addrinfo hints;
         memset(&hints, 0, sizeof(struct addrinfo));
         hints.ai_family   = address.family();
@@ -279,7 +853,7 @@ namespace Pistache::Tcp
             if (fd < 0)
                 continue;
 
-            setSocketOptions(fd, options_);
+            setSocketOptions(fd, acceptPerWorker_ ? options_ | Options::ReusePort : options_);
 
             if (::bind(fd, addr->ai_addr, addr->ai_addrlen) < 0)
             {
@@ -299,15 +873,86 @@ namespace Pistache::Tcp
             throw std::runtime_error(strerror(errno));
         }
 
+        return fd;
+    }
+
+    void Listener::bindListenSocket(Fd fd)
+    {
         make_non_blocking(fd);
-        poller.addFd(fd, Flags<Polling::NotifyOn>(Polling::NotifyOn::Read),
-                     Polling::Tag(fd));
         listen_fd = fd;
+        if (!acceptPerWorker_)
+        {
+            watchListenSocket(poller);
+            for (size_t i = 1; i < acceptThreads_; ++i)
+            {
+                auto loop = std::make_unique<AcceptLoop>();
+                loop->shutdownFd.bind(loop->poller);
+                watchListenSocket(loop->poller);
+                acceptLoops_.push_back(std::move(loop));
+            }
+        }
 
         auto transport = transportFactory_();
 
-        reactor_.init(Aio::AsyncContext(workers_, workersName_));
-        transportKey = reactor_.addHandler(transport);
+        if (!workerPool_)
+        {
+            assignWorkerCpus();
+
+            reactor_.init(Aio::AsyncContext(workers_, workersName_, backend_)
+                              .pinWorkers(workerAffinity_)
+                              .busyPoll(busyPoll_));
+        }
+        transportKey = reactor().addHandler(transport);
+
+        if (acceptPerWorker_)
+            bindWorkerSockets(fd);
+
+        if (useSSL_)
+        {
+            for (const auto& handler : reactor().handlers(transportKey))
+            {
+                std::static_pointer_cast<Transport>(handler)->setSslHandshakeTimeout(
+                    sslHandshakeTimeout_);
+            }
+        }
+    }
+
+    void Listener::bindWorkerSockets(Fd fd)
+    {
+        // Bind the other sockets to the address actually obtained by the first
+        // one, so that they share its port when an ephemeral one was requested
+        struct sockaddr_storage bound_addr;
+        socklen_t bound_len = sizeof(bound_addr);
+        auto* bound_alias   = reinterpret_cast<struct sockaddr*>(&bound_addr);
+        TRY(::getsockname(fd, bound_alias, &bound_len));
+
+        auto handlers = reactor().handlers(transportKey);
+        for (size_t i = 0; i < handlers.size(); ++i)
+        {
+            // SO_REUSEPORT does not spread the connections of a Unix domain
+            // socket, its workers accept from the same one
+            Fd worker_fd = fd;
+            if (i > 0 && bound_addr.ss_family != AF_UNIX)
+            {
+                int socktype = SOCK_STREAM;
+                if (options_.hasFlag(Options::CloseOnExec))
+                    socktype |= SOCK_CLOEXEC;
+
+                worker_fd = TRY_RET(::socket(bound_addr.ss_family, socktype, 0));
+                workerListenFds_.push_back(worker_fd);
+
+                setSocketOptions(worker_fd, options_ | Options::ReusePort);
+                TRY(::bind(worker_fd, bound_alias, bound_len));
+                TRY(::listen(worker_fd, backlog_));
+                make_non_blocking(worker_fd);
+            }
+
+            auto transport = std::static_pointer_cast<Transport>(handlers[i]);
+            transport->setMaxPeers(maxConnections_);
+            transport->setListenSocket(worker_fd, [this](Fd listenFd) {
+                return acceptPeer(listenFd);
+            });
+        }
     }
 
     bool Listener::isBound() const { return listen_fd != -1; }
@@ -327,6 +972,11 @@ namespace Pistache::Tcp
             return Port();
         }
 
+        if (addr_.family() == AF_UNIX)
+        {
+            return Port();
+        }
+
         struct sockaddr_in sock_addr = { 0 };
         socklen_t addrlen            = sizeof(sock_addr);
         auto* sock_addr_alias        = reinterpret_cast<struct sockaddr*>(&sock_addr);
@@ -343,30 +993,85 @@ namespace Pistache::Tcp
     {
         if (!shutdownFd.isBound())
             shutdownFd.bind(poller);
-        reactor_.run();
+        if (workerPool_)
+            workerPool_->start();
+        else
+            reactor_.run();
+
+        for (auto& loop : acceptLoops_)
+        {
+            auto* current = loop.get();
+            current->thread = std::thread([this, current] {
+                try
+                {
+                    acceptLoop(current->poller, current->shutdownFd);
+                }
+                catch (const std::exception&)
+                {
+                    // Logged already, the other accept threads carry on
+                }
+            });
+        }
 
+        try
+        {
+            acceptLoop(poller, shutdownFd);
+        }
+        catch (...)
+        {
+            for (auto& loop : acceptLoops_)
+            {
+                loop->shutdownFd.notify();
+                loop->thread.join();
+            }
+            throw;
+        }
+
+        for (auto& loop : acceptLoops_)
+            loop->thread.join();
+    }
+
+    void Listener::acceptLoop(Polling::Epoll& poller, const NotifyFd& shutdown)
+    {
+        // The workers do not tell when a peer goes away, a paused accept
+        // checks for room this often
+        static constexpr auto PausedPoll = std::chrono::milliseconds(10);
+
+        bool paused = false;
         for (;;)
         {
             std::vector<Polling::Event> events;
-            int ready_fds = poller.poll(events);
+            int ready_fds = poller.poll(events, paused ? PausedPoll
+                                                       : std::chrono::milliseconds(-1));
 
             if (ready_fds == -1)
             {
                 throw Error::system("Polling");
             }
+            if (paused && !isDraining() && hasRoom(reactor().handlers(transportKey)))
+            {
+                watchListenSocket(poller);
+                paused = false;
+            }
             for (const auto& event : events)
             {
-                if (event.tag == shutdownFd.tag())
+                if (event.tag == shutdown.tag())
                     return;
 
                 if (event.flags.hasFlag(Polling::NotifyOn::Read))
                 {
                     auto fd = event.tag.value();
-                    if (static_cast<ssize_t>(fd) == listen_fd)
+                    if (static_cast<ssize_t>(fd) == listen_fd && !paused && !isDraining())
                     {
                         try
                         {
-                            handleNewConnection();
+                            if (!handleNewConnection())
+                            {
+                                // Level-triggered, the socket would be
+                                // reported over and over
+                                poller.removeFd(listen_fd);
+                                paused = true;
+                            }
                         }
                         catch (SocketError& ex)
                         {
@@ -386,6 +1091,15 @@ namespace Pistache::Tcp
     void Listener::runThreaded()
     {
         shutdownFd.bind(poller);
+
+        // Workers accept their own connections, there is nothing left for the
+        // accept thread to do
+        if (acceptPerWorker_)
+        {
+            reactor_.run();
+            return;
+        }
+
         acceptThread = std::thread([=]() { this->run(); });
     }
 
@@ -393,13 +1107,27 @@ namespace Pistache::Tcp
     {
         if (shutdownFd.isBound())
             shutdownFd.notify();
-        reactor_.shutdown();
+        for (auto& loop : acceptLoops_)
+            loop->shutdownFd.notify();
+
+        if (!workerPool_)
+        {
+            reactor_.shutdown();
+            return;
+        }
+
+        // The transports stay with the workers of the pool
+        if (isBound())
+        {
+            for (const auto& handler : reactor().handlers(transportKey))
+                std::static_pointer_cast<Transport>(handler)->disconnectPeers();
+        }
     }
 
     Async::Promise<Listener::Load>
     Listener::requestLoad(const Listener::Load& old)
     {
-        auto handlers = reactor_.handlers(transportKey);
+        auto handlers = reactor().handlers(transportKey);
 
         std::vector<Async::Promise<rusage>> loads;
         for (const auto& handler : handlers)
@@ -446,6 +1174,9 @@ namespace Pistache::Tcp
                         }
 
                         res.global /= static_cast<double>(usages.size());
+
+                        std::lock_guard<std::mutex> guard(workersLoadLock_);
+                        workersLoad_ = res.workers;
                     }
 
                     return res;
@@ -457,10 +1188,38 @@ namespace Pistache::Tcp
 
     Options Listener::options() const { return options_; }
 
-    void Listener::handleNewConnection()
+    void Listener::watchListenSocket(Polling::Epoll& poller)
+    {
+        const auto mode = acceptThreads_ > 1 ? Polling::Mode::Exclusive : Polling::Mode::Level;
+        poller.addFd(listen_fd, Flags<Polling::NotifyOn>(Polling::NotifyOn::Read),
+                     Polling::Tag(listen_fd), mode);
+    }
+
+    bool Listener::handleNewConnection()
+    {
+        // Bounded so that the shutdown is not left waiting by a connection
+        // storm, the socket is still readable on the next poll
+        static constexpr size_t AcceptBatch = 64;
+
+        for (size_t i = 0; i < AcceptBatch; ++i)
+        {
+            if (maxConnections_ > 0 && !hasRoom(reactor().handlers(transportKey)))
+                return false;
+
+            auto peer = acceptPeer(listen_fd);
+            if (!peer)
+                break;
+            dispatchPeer(peer);
+        }
+        return true;
+    }
+
+    std::shared_ptr<Peer> Listener::acceptPeer(Fd fd)
     {
         struct sockaddr_storage peer_addr;
-        int client_fd = acceptConnection(peer_addr);
+        int client_fd = acceptConnection(fd, peer_addr);
+        if (client_fd < 0)
+            return nullptr;
 
         void* ssl = nullptr;
 
@@ -477,49 +1236,12 @@ namespace Pistache::Tcp
                 throw ServerError(err.c_str());
             }
 
-            // If user requested SSL handshake timeout, enable it on the socket.
-            //  This is sometimes necessary if a client connects, sends nothing,
-            //  or possibly refuses to accept any bytes, and never completes a
-            //  handshake. This would have left SSL_accept hanging indefinitely
-            //  and is effectively a DoS...
-            if (sslHandshakeTimeout_ > 0ms)
-            {
-                struct timeval timeout;
-
-                timeout.tv_sec = std::chrono::duration_cast<std::chrono::seconds>(sslHandshakeTimeout_).count();
-
-                const auto residual_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(sslHandshakeTimeout_) - std::chrono::duration_cast<std::chrono::seconds>(sslHandshakeTimeout_);
-                timeout.tv_usec                  = residual_microseconds.count();
-
-                TRY(::setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)));
-                TRY(::setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)));
-            }
-
+            // The handshake itself is performed by the worker transport once
+            // the peer has been dispatched, so that a slow client can not
+            // stall the accept loop
             SSL_set_fd(ssl_data, client_fd);
             SSL_set_accept_state(ssl_data);
 
-            if (SSL_accept(ssl_data) <= 0)
-            {
-                std::string err = "SSL connection error: "
-                    + ssl_print_errors_to_string();
-                PISTACHE_LOG_STRING_INFO(logger_, err);
-                SSL_free(ssl_data);
-                close(client_fd);
-                return;
-            }
-
-            // Remove socket timeouts if they were enabled now that we have
-            //  handshaked...
-            if (sslHandshakeTimeout_ > 0ms)
-            {
-                struct timeval timeout;
-                timeout.tv_sec  = 0;
-                timeout.tv_usec = 0;
-
-                TRY(::setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)));
-                TRY(::setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)));
-            }
-
             ssl = static_cast<void*>(ssl_data);
         }
 #endif /* PISTACHE_USE_SSL */
@@ -528,6 +1250,8 @@ namespace Pistache::Tcp
 
         std::shared_ptr<Peer> peer;
         auto* peer_alias = reinterpret_cast<struct sockaddr*>(&peer_addr);
+        Tracing::Ticks accepted = 0;
+        PISTACHE_TRACE_MARK(accepted);
         if (this->useSSL_)
         {
             peer = Peer::CreateSSL(client_fd, Address::fromUnix(peer_alias), ssl);
@@ -536,18 +1260,23 @@ namespace Pistache::Tcp
         {
             peer = Peer::Create(client_fd, Address::fromUnix(peer_alias));
         }
+        peer->acceptedAt_ = accepted;
 
-        dispatchPeer(peer);
+        return peer;
     }
 
-    int Listener::acceptConnection(struct sockaddr_storage& peer_addr) const
+    int Listener::acceptConnection(Fd fd, struct sockaddr_storage& peer_addr) const
     {
         socklen_t peer_addr_len = sizeof(peer_addr);
         // Do not share open FD with forked processes
         int client_fd = ::accept4(
-            listen_fd, reinterpret_cast<struct sockaddr*>(&peer_addr), &peer_addr_len, SOCK_CLOEXEC);
+            fd, reinterpret_cast<struct sockaddr*>(&peer_addr), &peer_addr_len, SOCK_CLOEXEC);
         if (client_fd < 0)
         {
+            // Another worker sharing the socket may have taken the connection
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return -1;
+
             if (errno == EBADF || errno == ENOTSOCK)
                 throw ServerError(strerror(errno));
             else
@@ -558,13 +1287,132 @@ namespace Pistache::Tcp
 
     void Listener::dispatchPeer(const std::shared_ptr<Peer>& peer)
     {
-        auto handlers  = reactor_.handlers(transportKey);
-        auto idx       = peer->fd() % handlers.size();
-        auto transport = std::static_pointer_cast<Transport>(handlers[idx]);
+        auto handlers = reactor().handlers(transportKey);
+
+        std::optional<size_t> idx;
+        if (numaAware_)
+            idx = pickLocalWorker(peer, handlers);
+        if (!idx)
+            idx = pickWorker(peer, handlers);
 
+        // A full worker hands the peer over to the least busy one
+        auto peerCount = [&](size_t i) {
+            return std::static_pointer_cast<Transport>(handlers[i])->peerCount();
+        };
+        if (maxConnections_ > 0 && peerCount(*idx) >= maxConnections_)
+        {
+            for (size_t i = 0; i < handlers.size(); ++i)
+            {
+                if (peerCount(i) < peerCount(*idx))
+                    idx = i;
+            }
+        }
+
+        auto transport = std::static_pointer_cast<Transport>(handlers[*idx]);
         transport->handleNewPeer(peer);
     }
 
+    bool Listener::hasRoom(const std::vector<std::shared_ptr<Aio::Handler>>& handlers) const
+    {
+        return std::any_of(handlers.begin(), handlers.end(), [this](const auto& handler) {
+            return std::static_pointer_cast<Transport>(handler)->peerCount() < maxConnections_;
+        });
+    }
+
+    std::optional<size_t>
+    Listener::pickLocalWorker(const std::shared_ptr<Peer>& peer,
+                              const std::vector<std::shared_ptr<Aio::Handler>>& handlers)
+    {
+        // Cpu that processed the last packets of the connection, which is
+        // the one serving the interrupts of its receive queue
+        int incoming  = -1;
+        socklen_t len = sizeof(incoming);
+        if (::getsockopt(peer->fd(), SOL_SOCKET, SO_INCOMING_CPU, &incoming, &len) != 0
+            || incoming < 0)
+            return std::nullopt;
+
+        const auto cpu = static_cast<size_t>(incoming);
+        const int node = cpu < cpuNodes_.size() ? cpuNodes_[cpu] : -1;
+
+        auto peerCount = [&](size_t idx) {
+            return std::static_pointer_cast<Transport>(handlers[idx])->peerCount();
+        };
+
+        // Least busy worker running on that cpu, or else on its node
+        std::optional<size_t> sameCpu;
+        std::optional<size_t> sameNode;
+        for (size_t i = 0; i < handlers.size() && i < workerNodes_.size(); ++i)
+        {
+            if (cpu < CpuSet::Size && workerAffinity_[i].isSet(cpu))
+            {
+                if (!sameCpu || peerCount(i) < peerCount(*sameCpu))
+                    sameCpu = i;
+            }
+            else if (node >= 0 && workerNodes_[i] == node)
+            {
+                if (!sameNode || peerCount(i) < peerCount(*sameNode))
+                    sameNode = i;
+            }
+        }
+
+        return sameCpu ? sameCpu : sameNode;
+    }
+
+    size_t Listener::pickWorker(const std::shared_ptr<Peer>& peer,
+                                const std::vector<std::shared_ptr<Aio::Handler>>& handlers)
+    {
+        auto peerCount = [&](size_t idx) {
+            return std::static_pointer_cast<Transport>(handlers[idx])->peerCount();
+        };
+
+        auto leastConnections = [&]() {
+            size_t best = 0;
+            for (size_t i = 1; i < handlers.size(); ++i)
+            {
+                if (peerCount(i) < peerCount(best))
+                    best = i;
+            }
+            return best;
+        };
+
+        switch (dispatchPolicy_)
+        {
+        case DispatchPolicy::FdModulo:
+            break;
+        case DispatchPolicy::RoundRobin:
+            return nextWorker_++ % handlers.size();
+        case DispatchPolicy::LeastConnections:
+            return leastConnections();
+        case DispatchPolicy::PowerOfTwoChoices:
+        {
+            std::uniform_int_distribution<size_t> dist(0, handlers.size() - 1);
+            size_t first = 0, second = 0;
+            {
+                std::lock_guard<std::mutex> guard(dispatchRngLock_);
+                first  = dist(dispatchRng_);
+                second = dist(dispatchRng_);
+            }
+            return peerCount(second) < peerCount(first) ? second : first;
+        }
+        case DispatchPolicy::LeastLoaded:
+        {
+            std::lock_guard<std::mutex> guard(workersLoadLock_);
+            if (workersLoad_.size() != handlers.size())
+                return leastConnections();
+
+            size_t best = 0;
+            for (size_t i = 1; i < handlers.size(); ++i)
+            {
+                if (workersLoad_[i] < workersLoad_[best])
+                    best = i;
+            }
+            return best;
+        }
+        }
+
+        return peer->fd() % handlers.size();
+    }
+
     Listener::TransportFactory Listener::defaultTransportFactory() const
     {
         return [&] {
@@ -637,14 +1485,124 @@ namespace Pistache::Tcp
         }
         sslHandshakeTimeout_ = sslHandshakeTimeout;
         useSSL_              = true;
+
+        setupALPN();
+    }
+
+    void Listener::setupALPN()
+    {
+        if (http2_)
+            SSL_CTX_set_alpn_select_cb(GetSSLContext(ssl_ctx_), selectProtocol, nullptr);
+        else
+            SSL_CTX_set_alpn_select_cb(GetSSLContext(ssl_ctx_), nullptr, nullptr);
+    }
+
+    void Listener::setupSSLSessions(std::shared_ptr<TlsSessionStore> store,
+                                    std::chrono::seconds timeout,
+                                    std::chrono::seconds ticketKeyRotation)
+    {
+        if (ssl_ctx_ == nullptr)
+        {
+            std::string err = "SSL Context is not initialized";
+            PISTACHE_LOG_STRING_FATAL(logger_, err);
+            throw std::runtime_error(err);
+        }
+
+        auto* ctx = GetSSLContext(ssl_ctx_);
+
+        // Sessions are only resumed in the context they were created in,
+        // which must be named once client certificates are verified
+        static const unsigned char context[] = "pistache";
+        SSL_CTX_set_session_id_context(ctx, context, sizeof(context) - 1);
+        SSL_CTX_set_timeout(ctx, static_cast<long>(timeout.count()));
+
+        auto state      = std::make_unique<SessionState>();
+        state->store    = std::move(store);
+        state->timeout  = timeout;
+        state->rotation = ticketKeyRotation;
+
+        delete sessionState(ctx);
+        SSL_CTX_set_ex_data(ctx, sessionStateIndex(), state.get());
+        auto* current = state.release();
+
+        if (current->store)
+        {
+            SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+            SSL_CTX_sess_set_new_cb(ctx, storeSession);
+            SSL_CTX_sess_set_get_cb(ctx, loadSession);
+            SSL_CTX_sess_set_remove_cb(ctx, removeSession);
+        }
+        else
+        {
+            SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+        }
+
+        // Without tickets, TLS 1.3 resumes the sessions of the store
+        if (ticketKeyRotation.count() > 0)
+        {
+            SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+            SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticketKey);
+#endif
+        }
+        else
+        {
+            SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+        }
+    }
+
+    void Listener::setupKTLS()
+    {
+        if (ssl_ctx_ == nullptr)
+        {
+            std::string err = "SSL Context is not initialized";
+            PISTACHE_LOG_STRING_FATAL(logger_, err);
+            throw std::runtime_error(err);
+        }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS)
+        // Each connection falls back to userspace encryption on its own when
+        // the kernel or the negotiated cipher does not support it
+        SSL_CTX_set_options(GetSSLContext(ssl_ctx_), SSL_OP_ENABLE_KTLS);
+#else
+        std::string err = "OpenSSL is not built with kTLS support";
+        PISTACHE_LOG_STRING_FATAL(logger_, err);
+        throw std::runtime_error(err);
+#endif
     }
 
 #endif /* PISTACHE_USE_SSL */
 
+    TlsHandshakes Listener::tlsHandshakes()
+    {
+        TlsHandshakes total;
+        for (const auto& handler : reactor().handlers(transportKey))
+        {
+            auto count = std::static_pointer_cast<Transport>(handler)->tlsHandshakes();
+            total.full += count.full;
+            total.resumed += count.resumed;
+        }
+        return total;
+    }
+
+    std::vector<Listener::WorkerStats> Listener::workerStats()
+    {
+        const auto loops    = reactor().loopStats();
+        const auto handlers = reactor().handlers(transportKey);
+
+        std::vector<WorkerStats> stats(std::min(loops.size(), handlers.size()));
+        for (size_t i = 0; i < stats.size(); ++i)
+        {
+            stats[i].loop      = loops[i];
+            stats[i].transport = std::static_pointer_cast<Transport>(handlers[i])->stats();
+        }
+        return stats;
+    }
+
     std::vector<std::shared_ptr<Tcp::Peer>> Listener::getAllPeer()
     {
         std::vector<std::shared_ptr<Tcp::Peer>> vecPeers;
-        auto handlers = reactor_.handlers(transportKey);
+        auto handlers = reactor().handlers(transportKey);
 
         for (const auto& handler : handlers)
         {
@@ -0,0 +1,252 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* proxy.cc
+
+   Forwarding of the requests to the upstream servers, and streaming of
+   their responses back to the downstream connections
+*/
+
+#include <pistache/peer.h>
+#include <pistache/proxy.h>
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include "../common/string_utils.h"
+
+namespace Pistache::Http
+{
+
+    namespace
+    {
+        bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs)
+        {
+            return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                              [](char a, char b) {
+                                  return std::tolower(static_cast<unsigned char>(a))
+                                      == std::tolower(static_cast<unsigned char>(b));
+                              });
+        }
+
+        // RFC 9110 section 7.6.1: the headers named by the Connection header
+        // only concern this connection as well
+        bool isListedIn(const Header::Collection& headers, std::string_view name)
+        {
+            auto connection = headers.rawList().find("Connection");
+            if (connection == headers.rawList().end())
+                return false;
+
+            std::string_view tokens = connection->second.value();
+            while (!tokens.empty())
+            {
+                const auto comma = tokens.find(',');
+                if (equalsIgnoreCase(Private::trim(tokens.substr(0, comma)), name))
+                    return true;
+                if (comma == std::string_view::npos)
+                    break;
+                tokens.remove_prefix(comma + 1);
+            }
+            return false;
+        }
+
+        // The framing of the body is the one of each connection, it is not
+        // forwarded either
+        bool isForwarded(const Header::Collection& headers, const std::string& name)
+        {
+            return !Proxy::isHopByHop(name) && !equalsIgnoreCase(name, Header::ContentLength::Name)
+                && !isListedIn(headers, name);
+        }
+
+        bool hasBody(Code code)
+        {
+            return static_cast<int>(code) >= 200 && code != Code::No_Content
+                && code != Code::Not_Modified;
+        }
+
+        // The downstream side of a request in flight. The response is answered
+        // once, either with the head of the upstream or with an error
+        struct Exchange
+        {
+            explicit Exchange(ResponseWriter response)
+                : response(std::move(response))
+            { }
+
+            std::optional<ResponseWriter> take()
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                return std::exchange(response, std::nullopt);
+            }
+
+            std::mutex lock;
+            std::optional<ResponseWriter> response;
+        };
+
+        // Relays the body of the upstream response to the downstream stream.
+        // Reading from the upstream is paused while the downstream connection
+        // has more queued than its high watermark
+        class Relay : public BodyReader
+        {
+        public:
+            Relay(ResponseStream stream, std::weak_ptr<Tcp::Peer> peer,
+                  Experimental::ResponseFlow flow)
+                : stream_(std::move(stream))
+                , peer_(std::move(peer))
+                , flow_(std::move(flow))
+            { }
+
+            void onData(std::string_view data) override
+            {
+                stream_.write(RawBuffer(data.data(), data.size()));
+                if (stream_.writable())
+                    return;
+
+                flow_.pause();
+                const auto flow = flow_;
+                stream_.whenWritable().then([flow]() { flow.resume(); },
+                                            // The downstream is gone, the rest is
+                                            // read and dropped
+                                            [flow](std::exception_ptr) { flow.resume(); });
+            }
+
+            void onEnd() override { stream_.ends(); }
+
+            void onError(const std::string&) override
+            {
+                // Without its last chunk, the response would seem complete
+                if (auto peer = peer_.lock())
+                    ::shutdown(peer->fd(), SHUT_RDWR);
+            }
+
+        private:
+            ResponseStream stream_;
+            std::weak_ptr<Tcp::Peer> peer_;
+            Experimental::ResponseFlow flow_;
+        };
+
+        void forwardHead(const Response& upstream, ResponseWriter& response)
+        {
+            const auto& headers = upstream.headers();
+            for (const auto& [name, raw] : headers.rawList())
+            {
+                if (isForwarded(headers, name))
+                    response.headers().addDeferred(raw);
+            }
+
+            for (const auto& cookie : upstream.cookies())
+                response.cookies().add(cookie);
+        }
+    } // namespace
+
+    Proxy::Proxy(std::shared_ptr<Experimental::Client> client, std::vector<std::string> upstreams,
+                 std::chrono::milliseconds timeout)
+        : client_(std::move(client))
+        , upstreams_(std::make_shared<const std::vector<std::string>>(std::move(upstreams)))
+        , next_(std::make_shared<std::atomic<size_t>>(0))
+        , timeout_(timeout)
+    {
+        if (upstreams_->empty())
+            throw std::invalid_argument("A proxy needs at least one upstream");
+    }
+
+    bool Proxy::isHopByHop(std::string_view name)
+    {
+        static constexpr std::string_view HopByHop[] = {
+            "Connection", "Keep-Alive", "Proxy-Connection", "Proxy-Authenticate",
+            "Proxy-Authorization", "TE", "Trailer", "Transfer-Encoding", "Upgrade",
+        };
+
+        return std::any_of(std::begin(HopByHop), std::end(HopByHop),
+                           [name](std::string_view hop) { return equalsIgnoreCase(hop, name); });
+    }
+
+    const std::string& Proxy::nextUpstream()
+    {
+        const auto index = next_->fetch_add(1, std::memory_order_relaxed);
+        return (*upstreams_)[index % upstreams_->size()];
+    }
+
+    void Proxy::onRequest(const Request& request, ResponseWriter response)
+    {
+        // The body is passed through with the encoding of the upstream
+        response.setCompression(Header::Encoding::Identity);
+
+        auto builder = client_->get(nextUpstream() + request.resource());
+        builder.method(request.method()).params(request.query()).timeout(timeout_);
+
+        const auto& headers = request.headers();
+        std::string forwardedFor;
+        for (const auto& [name, raw] : headers.rawList())
+        {
+            if (equalsIgnoreCase(name, "X-Forwarded-For"))
+                forwardedFor = raw.value() + ", ";
+            // The client names the upstream in its own Host header
+            else if (isForwarded(headers, name) && !equalsIgnoreCase(name, Header::Host::Name))
+                builder.header(raw);
+        }
+        forwardedFor += request.address().host();
+        builder.header(Header::Raw("X-Forwarded-For", std::move(forwardedFor)));
+
+        for (const auto& cookie : request.cookies())
+            builder.cookie(cookie);
+
+        if (!request.body().empty())
+            builder.body(request.body());
+
+        auto exchange       = std::make_shared<Exchange>(std::move(response));
+        const bool headOnly = request.method() == Method::Head;
+
+        builder.onBodyStart([exchange, headOnly](const Response& upstream,
+                                                 Experimental::ResponseFlow flow)
+                                -> std::shared_ptr<BodyReader> {
+            auto response = exchange->take();
+            if (!response)
+                return nullptr;
+
+            forwardHead(upstream, *response);
+
+            const auto code = upstream.code();
+            if (headOnly || !hasBody(code))
+            {
+                response->send(code);
+                return nullptr;
+            }
+
+            std::weak_ptr<Tcp::Peer> peer = response->getPeer();
+            return std::make_shared<Relay>(response->stream(code), std::move(peer), std::move(flow));
+        });
+
+        builder.send().then(
+            [](const Response&) {},
+            [exchange](std::exception_ptr error) {
+                auto response = exchange->take();
+                if (!response)
+                    return;
+
+                auto code = Code::Bad_Gateway;
+                try
+                {
+                    std::rethrow_exception(error);
+                }
+                catch (const std::exception& e)
+                {
+                    if (std::string_view(e.what()) == "Timeout")
+                        code = Code::Gateway_Timeout;
+                }
+                catch (...)
+                { }
+                response->send(code);
+            });
+    }
+
+} // namespace Pistache::Http
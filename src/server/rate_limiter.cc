@@ -0,0 +1,271 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* rate_limiter.cc
+
+   Implementation of the token buckets limiting the requests of the clients
+*/
+
+#include <pistache/rate_limiter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace Pistache::Http
+{
+
+    namespace
+    {
+        std::atomic<uint64_t> nextLimiterId { 0 };
+
+        // Leases of the calling thread, by limiter
+        thread_local std::vector<std::pair<uint64_t, std::shared_ptr<void>>> threadLeases;
+
+        constexpr char RefusedBody[] = "Too Many Requests";
+    } // namespace
+
+    struct RateLimiter::Leases
+    {
+        KeyMap<size_t> tokens;
+        Clock::time_point reconciled;
+
+        // Set once the limiter is gone, the thread forgets the leases then
+        std::atomic<bool> closed { false };
+    };
+
+    RateLimiter::RateLimiter(double rate, size_t burst, KeyFunction key,
+                             std::chrono::milliseconds reconcile)
+        : rate_(rate)
+        , burst_(static_cast<double>(burst))
+        , leaseSize_(std::max<size_t>(1, burst / LeaseDivisor))
+        , key_(std::move(key))
+        , reconcile_(reconcile)
+        , id_(nextLimiterId.fetch_add(1, std::memory_order_relaxed))
+        , retryAfter_(std::to_string(
+              std::max<long long>(1, static_cast<long long>(std::ceil(1.0 / rate)))))
+    {
+        if (rate <= 0 || burst == 0)
+            throw std::invalid_argument("A rate limiter needs a positive rate and burst");
+
+        std::string headers = " 429 Too Many Requests\r\nRetry-After: " + retryAfter_;
+        headers += "\r\nContent-Type: text/plain\r\nContent-Length: ";
+        headers += std::to_string(sizeof(RefusedBody) - 1) + "\r\n";
+
+        heads_[0] = SharedBuffer("HTTP/1.0" + headers);
+        heads_[1] = SharedBuffer("HTTP/1.1" + headers);
+        tails_[0] = SharedBuffer(std::string("Connection: Close\r\n\r\n") + RefusedBody);
+        tails_[1] = SharedBuffer(std::string("Connection: Keep-Alive\r\n\r\n") + RefusedBody);
+    }
+
+    RateLimiter::~RateLimiter()
+    {
+        std::lock_guard<std::mutex> guard(leasesLock_);
+        for (const auto& own : leases_)
+        {
+            // Held by their thread until it meets another limiter
+            own->tokens.clear();
+            own->closed.store(true, std::memory_order_release);
+        }
+    }
+
+    RateLimiter::KeyFunction RateLimiter::byAddress()
+    {
+        return [](const Request& request) { return request.address().host(); };
+    }
+
+    RateLimiter::KeyFunction RateLimiter::byHeader(std::string name)
+    {
+        return [name = std::move(name)](const Request& request) {
+            auto header = request.headers().tryGetRaw(name);
+            return header ? header->value() : std::string();
+        };
+    }
+
+    bool RateLimiter::allow(std::string_view key) { return allow(key, Clock::now()); }
+
+    bool RateLimiter::allow(std::string_view key, Clock::time_point now)
+    {
+        auto& own = leases();
+        if (now - own.reconciled >= reconcile_)
+            reconcile(own, now);
+
+        if (key.empty())
+            return true;
+
+        auto it = own.tokens.find(key);
+        if (it != own.tokens.end() && it->second > 0)
+        {
+            --it->second;
+            return true;
+        }
+
+        const size_t leased = lease(key, now);
+        if (leased == 0)
+        {
+            limited_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (it != own.tokens.end())
+            it->second = leased - 1;
+        else
+            own.tokens.emplace(key, leased - 1);
+        return true;
+    }
+
+    bool RateLimiter::admit(const Request& request) { return allow(key_(request)); }
+
+    Async::Promise<ssize_t> RateLimiter::refuse(const Request& request, ResponseWriter& response,
+                                                bool close) const
+    {
+        // The parts of the status line, headers and body are framed for HTTP/1
+        if (request.version() == Version::Http2)
+        {
+            response.headers().addRaw(Header::Raw("Retry-After", retryAfter_));
+            return response.send(Code::Too_Many_Requests, RefusedBody);
+        }
+
+        auto connection = response.headers().tryGet<Header::Connection>();
+        const bool keepAlive = !close && connection
+            && connection->control() == ConnectionControl::KeepAlive;
+
+        const size_t version = request.version() == Version::Http10 ? 0 : 1;
+        return response.sendSerialized(Code::Too_Many_Requests,
+                                       { heads_[version], tails_[keepAlive ? 1 : 0] });
+    }
+
+    size_t RateLimiter::size() const
+    {
+        size_t count = 0;
+        for (const auto& shard : shards_)
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            count += shard.buckets.size();
+        }
+        return count;
+    }
+
+    RateLimiter::Leases& RateLimiter::leases()
+    {
+        for (const auto& entry : threadLeases)
+        {
+            if (entry.first == id_)
+                return *static_cast<Leases*>(entry.second.get());
+        }
+
+        // First request of the thread, the leases of the limiters that are
+        // gone are forgotten along the way
+        threadLeases.erase(std::remove_if(threadLeases.begin(), threadLeases.end(),
+                                          [](const auto& entry) {
+                                              return static_cast<Leases*>(entry.second.get())
+                                                  ->closed.load(std::memory_order_acquire);
+                                          }),
+                           threadLeases.end());
+
+        auto own = std::make_shared<Leases>();
+        {
+            std::lock_guard<std::mutex> guard(leasesLock_);
+            // Along with the ones of the threads that are gone
+            leases_.erase(std::remove_if(leases_.begin(), leases_.end(),
+                                         [](const auto& leases) { return leases.use_count() == 1; }),
+                          leases_.end());
+            leases_.push_back(own);
+        }
+        threadLeases.emplace_back(id_, own);
+        return *own;
+    }
+
+    RateLimiter::Shard& RateLimiter::shardOf(std::string_view key)
+    {
+        return shards_[std::hash<std::string_view> {}(key) % ShardsCount];
+    }
+
+    void RateLimiter::refill(Bucket& bucket, Clock::time_point now) const
+    {
+        if (now <= bucket.updated)
+            return;
+
+        const std::chrono::duration<double> elapsed = now - bucket.updated;
+        bucket.tokens  = std::min(burst_, bucket.tokens + elapsed.count() * rate_);
+        bucket.updated = now;
+    }
+
+    size_t RateLimiter::lease(std::string_view key, Clock::time_point now)
+    {
+        auto& shard = shardOf(key);
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        auto it = shard.buckets.lower_bound(key);
+        if (it == shard.buckets.end() || it->first != key)
+            it = shard.buckets.emplace_hint(it, key, Bucket { burst_, now });
+
+        auto& bucket = it->second;
+        refill(bucket, now);
+        if (bucket.tokens < 1)
+            return 0;
+
+        const auto leased = std::min(leaseSize_, static_cast<size_t>(bucket.tokens));
+        bucket.tokens -= static_cast<double>(leased);
+        return leased;
+    }
+
+    void RateLimiter::reconcile(Leases& own, Clock::time_point now)
+    {
+        for (const auto& [key, tokens] : own.tokens)
+        {
+            if (tokens == 0)
+                continue;
+
+            auto& shard = shardOf(key);
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            // Dropped by a sweep, the bucket already is full
+            auto it = shard.buckets.find(key);
+            if (it == shard.buckets.end())
+                continue;
+
+            refill(it->second, now);
+            it->second.tokens = std::min(burst_, it->second.tokens + static_cast<double>(tokens));
+            if (it->second.tokens >= burst_)
+                shard.buckets.erase(it);
+        }
+        own.tokens.clear();
+        own.reconciled = now;
+
+        sweep(shards_[nextSweep_.fetch_add(1, std::memory_order_relaxed) % ShardsCount], now);
+    }
+
+    void RateLimiter::sweep(Shard& shard, Clock::time_point now)
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        for (auto it = shard.buckets.begin(); it != shard.buckets.end();)
+        {
+            refill(it->second, now);
+            if (it->second.tokens >= burst_)
+                it = shard.buckets.erase(it);
+            else
+                ++it;
+        }
+    }
+
+} // namespace Pistache::Http
+
+namespace Pistache::Rest::Routes
+{
+    Route::Middleware rateLimit(std::shared_ptr<Http::RateLimiter> limiter)
+    {
+        return [limiter = std::move(limiter)](Http::Request& request,
+                                              Http::ResponseWriter& response) {
+            if (limiter->admit(request))
+                return true;
+
+            limiter->refuse(request, response);
+            return false;
+        };
+    }
+} // namespace Pistache::Rest::Routes
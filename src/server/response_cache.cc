@@ -0,0 +1,378 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* response_cache.cc
+
+   Implementation of the in-memory cache of the responses of a router
+*/
+
+#include <pistache/response_cache.h>
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "../common/string_utils.h"
+
+namespace Pistache::Rest
+{
+
+    namespace
+    {
+        bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs)
+        {
+            return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                              [](char a, char b) {
+                                  return std::tolower(static_cast<unsigned char>(a))
+                                      == std::tolower(static_cast<unsigned char>(b));
+                              });
+        }
+
+        // RFC 9110 section 15.1
+        bool isCacheableByDefault(Http::Code code)
+        {
+            switch (code)
+            {
+            case Http::Code::Ok:
+            case Http::Code::NonAuthoritative_Information:
+            case Http::Code::No_Content:
+            case Http::Code::Multiple_Choices:
+            case Http::Code::Moved_Permanently:
+            case Http::Code::Permanent_Redirect:
+            case Http::Code::Not_Found:
+            case Http::Code::Method_Not_Allowed:
+            case Http::Code::Gone:
+            case Http::Code::RequestURI_Too_Long:
+            case Http::Code::Not_Implemented:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        // The Cache-Control header of a message, typed or raw
+        std::optional<Http::Header::CacheControl> cacheControl(const Http::Header::Collection& headers)
+        {
+            if (auto typed = headers.tryGet<Http::Header::CacheControl>())
+                return *typed;
+
+            if (auto raw = headers.tryGetRaw(Http::Header::CacheControl::Name))
+            {
+                Http::Header::CacheControl parsed;
+                try
+                {
+                    parsed.parse(raw->value());
+                }
+                catch (const std::exception&)
+                { }
+                return parsed;
+            }
+            return std::nullopt;
+        }
+
+        // Received headers are raw, the ones added by a handler may be typed
+        bool present(const Http::Header::Collection& headers, const std::string& name)
+        {
+            return headers.tryGetRaw(name).has_value() || headers.has(name);
+        }
+
+        std::string rawValue(const Http::Header::Collection& headers, const std::string& name)
+        {
+            auto raw = headers.tryGetRaw(name);
+            return raw ? raw->value() : std::string();
+        }
+    } // namespace
+
+    // Stores the response of a request that missed, once it is serialized
+    class ResponseCache::Recorder : public Http::ResponseRecorder
+    {
+    public:
+        Recorder(std::shared_ptr<ResponseCache> cache, std::string key)
+            : cache_(std::move(cache))
+            , key_(std::move(key))
+        { }
+
+        void onSerialized(const Http::Response& response, std::string_view head,
+                          std::string_view body) override
+        {
+            cache_->store(key_, response, head, body);
+        }
+
+    private:
+        std::shared_ptr<ResponseCache> cache_;
+        std::string key_;
+    };
+
+    ResponseCache::ResponseCache(std::vector<std::string> varyHeaders, size_t maxBytes,
+                                 std::chrono::seconds defaultTtl)
+        : varyHeaders_(std::move(varyHeaders))
+        , maxShardBytes_(maxBytes / ShardsCount)
+        , defaultTtl_(defaultTtl)
+    { }
+
+    bool ResponseCache::serve(const Http::Request& request, Http::ResponseWriter& response)
+    {
+        const auto method = request.method();
+        // A hit is written as it was serialized, for an HTTP/1 connection
+        if ((method != Http::Method::Get && method != Http::Method::Head)
+            || request.version() == Http::Version::Http2)
+            return false;
+
+        const auto& headers = request.headers();
+        if (present(headers, "Authorization") || present(headers, "If-None-Match")
+            || present(headers, "If-Modified-Since"))
+            return false;
+
+        bool lookup = true;
+        if (auto control = cacheControl(headers))
+        {
+            for (const auto& directive : control->directives())
+            {
+                switch (directive.directive())
+                {
+                case Http::CacheDirective::NoStore:
+                    return false;
+                case Http::CacheDirective::NoCache:
+                    lookup = false;
+                    break;
+                case Http::CacheDirective::MaxAge:
+                    if (directive.delta().count() == 0)
+                        lookup = false;
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+        auto key = keyOf(request);
+
+        std::shared_ptr<const Entry> entry;
+        if (lookup)
+        {
+            auto& shard = shardOf(key);
+            std::lock_guard<std::mutex> guard(shard.lock);
+
+            auto it = shard.slots.find(key);
+            if (it != shard.slots.end())
+            {
+                if (it->second.entry->expiry <= Clock::now())
+                {
+                    erase(shard, it);
+                }
+                else
+                {
+                    shard.lru.splice(shard.lru.begin(), shard.lru, it->second.lru);
+                    entry = it->second.entry;
+                }
+            }
+        }
+
+        if (!entry)
+        {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            response.record(std::make_shared<Recorder>(shared_from_this(), std::move(key)));
+            return false;
+        }
+
+        hits_.fetch_add(1, std::memory_order_relaxed);
+
+        // RFC 9111 section 5.1, for the caches further down to count the time
+        // spent here
+        const auto age = std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - entry->stored);
+        SharedBuffer ageHeader("Age: " + std::to_string(age.count()) + "\r\n\r\n");
+
+        response.sendSerialized(entry->code, { entry->head, ageHeader, entry->body });
+        return true;
+    }
+
+    size_t ResponseCache::size() const
+    {
+        size_t total = 0;
+        for (const auto& shard : shards_)
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            total += shard.slots.size();
+        }
+        return total;
+    }
+
+    size_t ResponseCache::bytes() const
+    {
+        size_t total = 0;
+        for (const auto& shard : shards_)
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            total += shard.bytes;
+        }
+        return total;
+    }
+
+    void ResponseCache::clear()
+    {
+        for (auto& shard : shards_)
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            shard.slots.clear();
+            shard.lru.clear();
+            shard.bytes = 0;
+        }
+    }
+
+    std::string ResponseCache::keyOf(const Http::Request& request) const
+    {
+        std::string key = Http::methodString(request.method());
+        key += ' ';
+        key += request.resource();
+        key += request.query().as_str();
+        key += ' ';
+        key += Http::versionString(request.version());
+        for (const auto& name : varyHeaders_)
+        {
+            key += '\n';
+            key += rawValue(request.headers(), name);
+        }
+        return key;
+    }
+
+    ResponseCache::Shard& ResponseCache::shardOf(const std::string& key)
+    {
+        return shards_[std::hash<std::string> {}(key) % ShardsCount];
+    }
+
+    std::chrono::seconds ResponseCache::freshness(const Http::Response& response) const
+    {
+        if (!isCacheableByDefault(response.code()))
+            return std::chrono::seconds(0);
+
+        // Someone else's cookie
+        const auto& headers = response.headers();
+        if (response.cookies().begin() != response.cookies().end() || present(headers, "Set-Cookie"))
+            return std::chrono::seconds(0);
+
+        // Only the headers of the key can tell the variants apart
+        const auto vary        = headers.tryGet<Http::Header::Vary>();
+        const auto varyFields  = vary ? vary->fields() : rawValue(headers, Http::Header::Vary::Name);
+        std::string_view fields = varyFields;
+        while (!fields.empty())
+        {
+            const auto comma = fields.find(',');
+            const auto field = Http::Private::trim(fields.substr(0, comma));
+            const bool known = std::any_of(varyHeaders_.begin(), varyHeaders_.end(),
+                                           [field](const std::string& name) {
+                                               return equalsIgnoreCase(name, field);
+                                           });
+            if (!field.empty() && !known)
+                return std::chrono::seconds(0);
+            if (comma == std::string_view::npos)
+                break;
+            fields.remove_prefix(comma + 1);
+        }
+
+        auto ttl = defaultTtl_;
+        if (auto control = cacheControl(headers))
+        {
+            std::optional<std::chrono::seconds> maxAge, sMaxAge;
+            for (const auto& directive : control->directives())
+            {
+                switch (directive.directive())
+                {
+                case Http::CacheDirective::NoStore:
+                case Http::CacheDirective::NoCache:
+                case Http::CacheDirective::Private:
+                    return std::chrono::seconds(0);
+                case Http::CacheDirective::MaxAge:
+                    maxAge = directive.delta();
+                    break;
+                case Http::CacheDirective::SMaxAge:
+                    sMaxAge = directive.delta();
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            // s-maxage is the one meant for a shared cache
+            if (sMaxAge)
+                ttl = *sMaxAge;
+            else if (maxAge)
+                ttl = *maxAge;
+        }
+        return ttl;
+    }
+
+    void ResponseCache::store(const std::string& key, const Http::Response& response,
+                              std::string_view head, std::string_view body)
+    {
+        const auto ttl = freshness(response);
+        if (ttl.count() <= 0)
+            return;
+
+        // The blank line ending the headers comes after the Age header
+        if (head.size() < 2 || head.substr(head.size() - 2) != "\r\n")
+            return;
+        head.remove_suffix(2);
+
+        const size_t bytes = key.size() + head.size() + body.size();
+        if (bytes > maxShardBytes_)
+            return;
+
+        const auto now = Clock::now();
+        auto entry     = std::make_shared<Entry>(Entry {
+            response.code(),
+            SharedBuffer(head.data(), head.size()),
+            SharedBuffer(body.data(), body.size()),
+            now,
+            now + ttl,
+        });
+
+        auto& shard = shardOf(key);
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        auto it = shard.slots.find(key);
+        if (it != shard.slots.end())
+            erase(shard, it);
+
+        while (shard.bytes + bytes > maxShardBytes_ && !shard.lru.empty())
+            erase(shard, shard.slots.find(shard.lru.back()));
+
+        shard.lru.push_front(key);
+        shard.slots.emplace(key, Slot { std::move(entry), bytes, shard.lru.begin() });
+        shard.bytes += bytes;
+    }
+
+    void ResponseCache::erase(Shard& shard, std::unordered_map<std::string, Slot>::iterator it)
+    {
+        shard.bytes -= it->second.bytes;
+        shard.lru.erase(it->second.lru);
+        shard.slots.erase(it);
+    }
+
+    namespace Routes
+    {
+        Route::Middleware cache(std::shared_ptr<ResponseCache> cache)
+        {
+            return [cache = std::move(cache)](Http::Request& request,
+                                              Http::ResponseWriter& response) {
+                return !cache->serve(request, response);
+            };
+        }
+
+        Route::Handler cached(std::shared_ptr<ResponseCache> cache, Route::Handler handler)
+        {
+            return [cache = std::move(cache), handler = std::move(handler)](
+                       const Request& request, Http::ResponseWriter response) {
+                if (cache->serve(request, response))
+                    return Route::Result::Ok;
+                return handler(request, std::move(response));
+            };
+        }
+    } // namespace Routes
+
+} // namespace Pistache::Rest
@@ -0,0 +1,317 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* route_metrics.cc
+
+   Latency histograms and counters of the routes of a Rest::Router
+*/
+
+#include <pistache/route_metrics.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <utility>
+
+namespace Pistache::Rest
+{
+
+    namespace
+    {
+        std::atomic<size_t> nextThreadSlot { 0 };
+
+        size_t threadSlot()
+        {
+            thread_local const size_t slot = nextThreadSlot.fetch_add(1, std::memory_order_relaxed);
+            return slot % RouteMetrics::MaxShards;
+        }
+
+        // Label values escape backslashes, quotes and line feeds
+        void writeLabel(std::ostream& os, const std::string& value)
+        {
+            for (char c : value)
+            {
+                if (c == '\\' || c == '"')
+                    os << '\\' << c;
+                else if (c == '\n')
+                    os << "\\n";
+                else
+                    os << c;
+            }
+        }
+
+        constexpr std::pair<const char*, double> Quantiles[] = {
+            { "0.5", 0.5 }, { "0.99", 0.99 }, { "0.999", 0.999 }
+        };
+
+        void writeSeconds(std::ostream& os, uint64_t micros)
+        {
+            os << static_cast<double>(micros) / 1e6;
+        }
+    } // namespace
+
+    size_t LatencyHistogram::bucketOf(uint64_t value)
+    {
+        value = std::min(value, MaxValue);
+        if (value < SubBuckets)
+            return static_cast<size_t>(value);
+
+        const size_t exponent = 63 - static_cast<size_t>(__builtin_clzll(value));
+        const size_t sub = static_cast<size_t>(value >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+        return (exponent - SubBucketBits + 1) * SubBuckets + sub;
+    }
+
+    uint64_t LatencyHistogram::upperBound(size_t bucket)
+    {
+        if (bucket < SubBuckets)
+            return bucket;
+
+        const size_t group = bucket / SubBuckets;
+        const size_t sub   = bucket % SubBuckets;
+        const size_t shift = group - 1;
+        return ((SubBuckets + sub + 1) << shift) - 1;
+    }
+
+    void LatencyHistogram::record(std::chrono::microseconds duration)
+    {
+        const auto value = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+
+        counts_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+
+        auto max = max_.load(std::memory_order_relaxed);
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        { }
+    }
+
+    void LatencyHistogram::addTo(Snapshot& snapshot) const
+    {
+        for (size_t i = 0; i < BucketsCount; ++i)
+        {
+            const auto count = counts_[i].load(std::memory_order_relaxed);
+            snapshot.counts[i] += count;
+            snapshot.count += count;
+        }
+        snapshot.sum += sum_.load(std::memory_order_relaxed);
+        snapshot.max = std::max(snapshot.max, max_.load(std::memory_order_relaxed));
+    }
+
+    std::chrono::microseconds LatencyHistogram::Snapshot::quantile(double q) const
+    {
+        if (count == 0)
+            return std::chrono::microseconds(0);
+
+        const auto rank = std::max<uint64_t>(
+            1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count))));
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BucketsCount; ++i)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+                return std::chrono::microseconds(std::min(upperBound(i), max));
+        }
+        return std::chrono::microseconds(max);
+    }
+
+    LatencyHistogram::Snapshot& LatencyHistogram::Snapshot::operator+=(const Snapshot& other)
+    {
+        for (size_t i = 0; i < BucketsCount; ++i)
+            counts[i] += other.counts[i];
+        count += other.count;
+        sum += other.sum;
+        max = std::max(max, other.max);
+        return *this;
+    }
+
+    RouteMetrics::~RouteMetrics()
+    {
+        for (auto& shard : shards_)
+            delete shard.load(std::memory_order_acquire);
+    }
+
+    void RouteMetrics::onDispatch(const Http::Request& request,
+                                  std::chrono::steady_clock::time_point now)
+    {
+        auto& current = shard();
+        current.requests.fetch_add(1, std::memory_order_relaxed);
+
+        // Not received by a server, such as a request routed by hand
+        if (request.receivedAt() == std::chrono::steady_clock::time_point())
+            return;
+
+        current.dispatch.record(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - request.receivedAt()));
+    }
+
+    void RouteMetrics::onWritten(Http::Code code, std::chrono::steady_clock::time_point since,
+                                 bool written)
+    {
+        auto& current = shard();
+        if (!written)
+        {
+            current.failed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const auto statusClass = static_cast<size_t>(code) / 100;
+        if (statusClass >= 1 && statusClass <= 5)
+            current.responses[statusClass - 1].fetch_add(1, std::memory_order_relaxed);
+
+        current.response.record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - since));
+    }
+
+    RouteMetrics::Snapshot RouteMetrics::snapshot() const
+    {
+        Snapshot snapshot;
+        for (const auto& slot : shards_)
+        {
+            const auto* shard = slot.load(std::memory_order_acquire);
+            if (shard == nullptr)
+                continue;
+
+            snapshot.requests += shard->requests.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < snapshot.responses.size(); ++i)
+                snapshot.responses[i] += shard->responses[i].load(std::memory_order_relaxed);
+            snapshot.failed += shard->failed.load(std::memory_order_relaxed);
+
+            shard->dispatch.addTo(snapshot.dispatch);
+            shard->response.addTo(snapshot.response);
+        }
+        return snapshot;
+    }
+
+    RouteMetrics::Shard& RouteMetrics::shard()
+    {
+        auto& slot   = shards_[threadSlot()];
+        auto* shard = slot.load(std::memory_order_acquire);
+        if (shard != nullptr)
+            return *shard;
+
+        // Two threads sharing the slot may race to create it
+        auto* created = new Shard();
+        if (slot.compare_exchange_strong(shard, created, std::memory_order_acq_rel))
+            return *created;
+
+        delete created;
+        return *shard;
+    }
+
+    std::shared_ptr<RouteMetrics> RouteMetricsRegistry::add(Http::Method method,
+                                                            const std::string& resource)
+    {
+        auto metrics = std::make_shared<RouteMetrics>();
+
+        std::lock_guard<std::mutex> guard(lock_);
+        entries_.push_back({ method, resource, metrics });
+        return metrics;
+    }
+
+    void RouteMetricsRegistry::remove(Http::Method method, const std::string& resource)
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                      [&](const Entry& entry) {
+                                          return entry.method == method && entry.resource == resource;
+                                      }),
+                       entries_.end());
+    }
+
+    std::vector<RouteMetricsRegistry::Stats> RouteMetricsRegistry::collect() const
+    {
+        std::vector<Entry> entries;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            entries = entries_;
+        }
+
+        std::vector<Stats> stats;
+        stats.reserve(entries.size());
+        for (const auto& entry : entries)
+            stats.push_back({ entry.method, entry.resource, entry.metrics->snapshot() });
+        return stats;
+    }
+
+    std::string RouteMetricsRegistry::prometheus() const
+    {
+        const auto stats = collect();
+
+        std::ostringstream os;
+        auto labels = [&os](const Stats& route) {
+            os << "method=\"" << Http::methodString(route.method) << "\",route=\"";
+            writeLabel(os, route.resource);
+            os << '"';
+        };
+
+        os << "# HELP pistache_route_requests_total Requests handed to the handler of the route\n"
+           << "# TYPE pistache_route_requests_total counter\n";
+        for (const auto& route : stats)
+        {
+            os << "pistache_route_requests_total{";
+            labels(route);
+            os << "} " << route.metrics.requests << '\n';
+        }
+
+        os << "# HELP pistache_route_responses_total Responses written, by class of status\n"
+           << "# TYPE pistache_route_responses_total counter\n";
+        for (const auto& route : stats)
+        {
+            for (size_t i = 0; i < route.metrics.responses.size(); ++i)
+            {
+                os << "pistache_route_responses_total{";
+                labels(route);
+                os << ",code=\"" << i + 1 << "xx\"} " << route.metrics.responses[i] << '\n';
+            }
+        }
+
+        os << "# HELP pistache_route_failed_responses_total Responses that could not be written\n"
+           << "# TYPE pistache_route_failed_responses_total counter\n";
+        for (const auto& route : stats)
+        {
+            os << "pistache_route_failed_responses_total{";
+            labels(route);
+            os << "} " << route.metrics.failed << '\n';
+        }
+
+        auto summary = [&](const char* name, const char* help,
+                           LatencyHistogram::Snapshot RouteMetrics::Snapshot::*histogram) {
+            os << "# HELP " << name << ' ' << help << '\n'
+               << "# TYPE " << name << " summary\n";
+            for (const auto& route : stats)
+            {
+                const auto& snapshot = route.metrics.*histogram;
+                for (const auto& [label, quantile] : Quantiles)
+                {
+                    os << name << '{';
+                    labels(route);
+                    os << ",quantile=\"" << label << "\"} ";
+                    writeSeconds(os, static_cast<uint64_t>(snapshot.quantile(quantile).count()));
+                    os << '\n';
+                }
+
+                os << name << "_sum{";
+                labels(route);
+                os << "} ";
+                writeSeconds(os, snapshot.sum);
+                os << '\n'
+                   << name << "_count{";
+                labels(route);
+                os << "} " << snapshot.count << '\n';
+            }
+        };
+
+        summary("pistache_route_dispatch_seconds",
+                "From the start of the request to the call of its handler",
+                &RouteMetrics::Snapshot::dispatch);
+        summary("pistache_route_response_seconds",
+                "From the call of the handler until the response has been written",
+                &RouteMetrics::Snapshot::response);
+
+        return os.str();
+    }
+
+} // namespace Pistache::Rest
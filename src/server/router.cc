@@ -13,6 +13,7 @@
 #include <algorithm>
 
 #include <pistache/description.h>
+#include <pistache/route_metrics.h>
 #include <pistache/router.h>
 
 namespace Pistache::Rest
@@ -59,8 +60,6 @@ namespace Pistache::Rest
 
     std::vector<TypedParam> Request::splat() const { return splats_; }
 
-    std::regex SegmentTreeNode::multiple_slash = std::regex("//+", std::regex_constants::optimize);
-
     SegmentTreeNode::SegmentTreeNode()
         : resource_ref_()
         , fixed_()
@@ -118,76 +117,89 @@ namespace Pistache::Rest
 
     std::string SegmentTreeNode::sanitizeResource(const std::string& path)
     {
-        const auto& dup = std::regex_replace(path, SegmentTreeNode::multiple_slash,
-                                             std::string("/"));
-        if (dup[dup.length() - 1] == '/')
+        std::string storage;
+        return std::string(sanitizeResource(std::string_view(path), storage));
+    }
+
+    std::string_view SegmentTreeNode::sanitizeResource(std::string_view path,
+                                                       std::string& storage)
+    {
+        const auto first = path.find_first_not_of('/');
+        if (first == std::string_view::npos)
+            return {};
+
+        const auto last = path.find_last_not_of('/');
+        path            = path.substr(first, last - first + 1);
+
+        // Request paths rarely contain duplicate slashes
+        if (path.find("//") == std::string_view::npos)
+            return path;
+
+        storage.clear();
+        storage.reserve(path.size());
+        for (size_t i = 0; i < path.size(); ++i)
         {
-            return dup.substr(1, dup.length() - 2);
+            if (path[i] == '/' && storage.back() == '/')
+                continue;
+            storage.push_back(path[i]);
         }
-        return dup.substr(1);
+
+        return storage;
     }
 
-    void SegmentTreeNode::addRoute(
-        const std::string_view& path, const Route::Handler& handler,
+    SegmentTreeNode& SegmentTreeNode::makeNode(
+        const std::string_view& path,
         const std::shared_ptr<char>& resource_reference)
     {
         // recursion to correct path segment
-        if (!path.empty())
+        if (path.empty())
+            return *this;
+
+        const auto segment_delimiter = path.find('/');
+        // current segment value
+        auto current_segment = path.substr(0, segment_delimiter);
+        // complete child path (path without this segment)
+        // if no '/' was found, it means that it is a leaf resource
+        const auto lower_path = (segment_delimiter == std::string_view::npos)
+            ? std::string_view { nullptr, 0 }
+            : path.substr(segment_delimiter + 1);
+
+        std::unordered_map<std::string_view, std::shared_ptr<SegmentTreeNode>>* collection = nullptr;
+        const auto fragmentType                                                            = getSegmentType(current_segment);
+        switch (fragmentType)
         {
-            const auto segment_delimiter = path.find('/');
-            // current segment value
-            auto current_segment = path.substr(0, segment_delimiter);
-            // complete child path (path without this segment)
-            // if no '/' was found, it means that it is a leaf resource
-            const auto lower_path = (segment_delimiter == std::string_view::npos)
-                ? std::string_view { nullptr, 0 }
-                : path.substr(segment_delimiter + 1);
-
-            std::unordered_map<std::string_view, std::shared_ptr<SegmentTreeNode>>* collection = nullptr;
-            const auto fragmentType                                                            = getSegmentType(current_segment);
-            switch (fragmentType)
+        case SegmentType::Fixed:
+            collection = &fixed_;
+            break;
+        case SegmentType::Param:
+            collection = &param_;
+            break;
+        case SegmentType::Optional:
+            // remove the trailing question mark
+            current_segment = current_segment.substr(0, current_segment.length() - 1);
+            collection      = &optional_;
+            break;
+        case SegmentType::Splat:
+            if (splat_ == nullptr)
             {
-            case SegmentType::Fixed:
-                collection = &fixed_;
-                break;
-            case SegmentType::Param:
-                collection = &param_;
-                break;
-            case SegmentType::Optional:
-                // remove the trailing question mark
-                current_segment = current_segment.substr(0, current_segment.length() - 1);
-                collection      = &optional_;
-                break;
-            case SegmentType::Splat:
-                if (splat_ == nullptr)
-                {
-                    splat_ = std::make_shared<SegmentTreeNode>(resource_reference);
-                }
-                splat_->addRoute(lower_path, handler, resource_reference);
-                return;
-            }
-
-            // if the segment tree nodes for the lower path does not exist
-            if (collection->count(current_segment) == 0)
-            {
-                // first create it
-                collection->insert(std::make_pair(
-                    current_segment,
-                    std::make_shared<SegmentTreeNode>(resource_reference)));
+                splat_ = std::make_shared<SegmentTreeNode>(resource_reference);
             }
-            collection->at(current_segment)
-                ->addRoute(lower_path, handler, resource_reference);
+            return splat_->makeNode(lower_path, resource_reference);
         }
-        else
-        { // current path segment requested
-            if (route_ != nullptr)
-                throw std::runtime_error("Requested route already exist.");
-            route_ = std::make_shared<Route>(handler);
+
+        // if the segment tree nodes for the lower path does not exist
+        if (collection->count(current_segment) == 0)
+        {
+            // first create it
+            collection->insert(std::make_pair(
+                current_segment,
+                std::make_shared<SegmentTreeNode>(resource_reference)));
         }
+        return collection->at(current_segment)->makeNode(lower_path, resource_reference);
     }
 
-    bool Pistache::Rest::SegmentTreeNode::removeRoute(
-        const std::string_view& path)
+    template <typename Clear>
+    bool SegmentTreeNode::removeNode(const std::string_view& path, Clear clear)
     {
         // recursion to correct path segment
         if (!path.empty())
@@ -217,12 +229,12 @@ namespace Pistache::Rest
                 collection      = &optional_;
                 break;
             case SegmentType::Splat:
-                return splat_->removeRoute(lower_path);
+                return splat_->removeNode(lower_path, clear);
             }
 
             try
             {
-                const bool removable = collection->at(current_segment)->removeRoute(lower_path);
+                const bool removable = collection->at(current_segment)->removeNode(lower_path, clear);
                 if (removable)
                 {
                     collection->erase(current_segment);
@@ -235,9 +247,80 @@ namespace Pistache::Rest
         }
         else
         { // current leaf requested
-            route_.reset();
+            clear(*this);
         }
-        return fixed_.empty() && param_.empty() && optional_.empty() && splat_ == nullptr && route_ == nullptr;
+        return isEmpty();
+    }
+
+    bool SegmentTreeNode::isEmpty() const
+    {
+        return fixed_.empty() && param_.empty() && optional_.empty() && splat_ == nullptr && route_ == nullptr && methods_.none();
+    }
+
+    Route& SegmentTreeNode::addRoute(
+        const std::string_view& path, const Route::Handler& handler,
+        const std::shared_ptr<char>& resource_reference,
+        const Route::BodyHandler& bodyHandler)
+    {
+        auto& node = makeNode(path, resource_reference);
+        if (node.route_ != nullptr)
+            throw std::runtime_error("Requested route already exist.");
+        node.route_ = std::make_shared<Route>(handler, bodyHandler);
+        return *node.route_;
+    }
+
+    bool Pistache::Rest::SegmentTreeNode::removeRoute(
+        const std::string_view& path)
+    {
+        return removeNode(path, [](SegmentTreeNode& node) { node.route_.reset(); });
+    }
+
+    void SegmentTreeNode::addMethod(const std::string_view& path, Http::Method method,
+                                    const std::shared_ptr<char>& resource_reference)
+    {
+        makeNode(path, resource_reference).methods_.set(static_cast<size_t>(method));
+    }
+
+    void SegmentTreeNode::removeMethod(const std::string_view& path, Http::Method method)
+    {
+        removeNode(path, [method](SegmentTreeNode& node) {
+            node.methods_.reset(static_cast<size_t>(method));
+        });
+    }
+
+    MethodSet SegmentTreeNode::allowedMethods(const std::string_view& path) const
+    {
+        // Same walk as findRoute, except that every matching branch is visited
+        if (path.empty())
+        {
+            auto methods = methods_;
+            if (!optional_.empty())
+                methods |= optional_.begin()->second->allowedMethods(path);
+            return methods;
+        }
+
+        const auto segment_delimiter = path.find('/');
+        const auto current_segment   = path.substr(0, segment_delimiter);
+        const auto lower_path        = (segment_delimiter == std::string_view::npos)
+                   ? std::string_view { nullptr, 0 }
+                   : path.substr(segment_delimiter + 1);
+
+        MethodSet methods;
+
+        auto fixed = fixed_.find(current_segment);
+        if (fixed != std::end(fixed_))
+            methods |= fixed->second->allowedMethods(lower_path);
+
+        for (const auto& param : param_)
+            methods |= param.second->allowedMethods(lower_path);
+
+        for (const auto& optional : optional_)
+            methods |= optional.second->allowedMethods(lower_path);
+
+        if (splat_ != nullptr)
+            methods |= splat_->allowedMethods(lower_path);
+
+        return methods;
     }
 
     std::tuple<std::shared_ptr<Route>, std::vector<TypedParam>,
@@ -350,6 +433,160 @@ namespace Pistache::Rest
         return findRoute(path, params, splats);
     }
 
+    RouteTable::RouteTable(const SegmentTreeNode& root) { compile(root, 0); }
+
+    bool RouteTable::find(std::string_view path, Match& match) const
+    {
+        match.route       = nullptr;
+        match.paramsCount = 0;
+        match.splatsCount = 0;
+
+        if (nodes_.empty())
+            return false;
+
+        return find(0, path, match);
+    }
+
+    bool RouteTable::empty() const { return routes_.empty(); }
+
+    uint32_t RouteTable::compile(const SegmentTreeNode& node, size_t depth)
+    {
+        if (depth > MaxCaptures)
+            throw std::runtime_error("Too many parameters in route");
+
+        const auto index = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+
+        if (node.route_ != nullptr)
+        {
+            nodes_[index].route = static_cast<uint32_t>(routes_.size());
+            routes_.push_back(node.route_);
+        }
+
+        // The edges of a node are stored next to each other, fixed ones first
+        // and sorted so that they can be binary searched
+        using Child = std::pair<std::string_view, const SegmentTreeNode*>;
+        std::vector<Child> children;
+        children.reserve(node.fixed_.size() + node.param_.size() + node.optional_.size());
+
+        for (const auto& fixed : node.fixed_)
+            children.emplace_back(fixed.first, fixed.second.get());
+        std::sort(children.begin(), children.end(),
+                  [](const Child& lhs, const Child& rhs) { return lhs.first < rhs.first; });
+
+        // Parameters are tried in the order SegmentTreeNode would try them
+        for (const auto& param : node.param_)
+            children.emplace_back(param.first, param.second.get());
+        for (const auto& optional : node.optional_)
+            children.emplace_back(optional.first, optional.second.get());
+
+        const auto first      = static_cast<uint32_t>(edges_.size());
+        auto& current         = nodes_[index];
+        current.fixedBegin    = first;
+        current.paramBegin    = first + static_cast<uint32_t>(node.fixed_.size());
+        current.optionalBegin = current.paramBegin + static_cast<uint32_t>(node.param_.size());
+        current.optionalEnd   = current.optionalBegin + static_cast<uint32_t>(node.optional_.size());
+        const auto paramBegin = current.paramBegin;
+
+        for (const auto& child : children)
+        {
+            const auto offset = addName(child.first);
+            edges_.push_back({ offset, static_cast<uint32_t>(child.first.size()), None });
+        }
+
+        // nodes_ may be reallocated from here on
+        for (size_t i = 0; i < children.size(); ++i)
+        {
+            const auto edge     = first + static_cast<uint32_t>(i);
+            const bool captures = edge >= paramBegin;
+            const auto child    = compile(*children[i].second, depth + (captures ? 1 : 0));
+            edges_[edge].child  = child;
+        }
+
+        if (node.splat_ != nullptr)
+        {
+            const auto splat    = compile(*node.splat_, depth + 1);
+            nodes_[index].splat = splat;
+        }
+
+        return index;
+    }
+
+    uint32_t RouteTable::addName(std::string_view name)
+    {
+        const auto offset = static_cast<uint32_t>(names_.size());
+        names_.append(name.data(), name.size());
+        return offset;
+    }
+
+    std::string_view RouteTable::name(const Edge& edge) const
+    {
+        return std::string_view(names_).substr(edge.nameOffset, edge.nameLength);
+    }
+
+    bool RouteTable::find(uint32_t index, std::string_view path, Match& match) const
+    {
+        const auto& node = nodes_[index];
+
+        if (path.empty())
+        {
+            // Same as SegmentTreeNode, a missing trailing optional parameter
+            // resolves to the first one
+            if (node.optionalBegin != node.optionalEnd)
+                return find(edges_[node.optionalBegin].child, path, match);
+
+            if (node.route == None)
+                return false;
+
+            match.route = routes_[node.route].get();
+            return true;
+        }
+
+        const auto delimiter = path.find('/');
+        const auto segment   = path.substr(0, delimiter);
+        const auto lower     = (delimiter == std::string_view::npos)
+                ? std::string_view {}
+                : path.substr(delimiter + 1);
+
+        const auto* edges = edges_.data();
+
+        const auto* fixedEnd = edges + node.paramBegin;
+        const auto* fixed    = std::lower_bound(
+            edges + node.fixedBegin, fixedEnd, segment,
+            [this](const Edge& edge, std::string_view value) { return name(edge) < value; });
+        if (fixed != fixedEnd && name(*fixed) == segment && find(fixed->child, lower, match))
+            return true;
+
+        for (auto i = node.paramBegin; i < node.optionalBegin; ++i)
+        {
+            match.params[match.paramsCount++] = { name(edges[i]), segment };
+            if (find(edges[i].child, lower, match))
+                return true;
+            --match.paramsCount;
+        }
+
+        for (auto i = node.optionalBegin; i < node.optionalEnd; ++i)
+        {
+            match.params[match.paramsCount++] = { name(edges[i]), segment };
+            if (find(edges[i].child, lower, match))
+                return true;
+            --match.paramsCount;
+
+            if (find(edges[i].child, lower, match))
+                return true;
+        }
+
+        if (node.splat != None)
+        {
+            match.splats[match.splatsCount++] = segment;
+            if (find(node.splat, lower, match))
+                return true;
+            --match.splatsCount;
+        }
+
+        return false;
+    }
+
     namespace Private
     {
 
@@ -364,11 +601,30 @@ namespace Pistache::Rest
         void RouterHandler::onRequest(const Http::Request& req,
                                       Http::ResponseWriter response)
         {
-            router->route(req, std::move(response));
+            router->route(Http::Request(req), std::move(response), snapshot);
+        }
+
+        void RouterHandler::dispatchRequest(Http::Request&& req,
+                                            Http::ResponseWriter response)
+        {
+            router->route(std::move(req), std::move(response), snapshot);
+        }
+
+        std::shared_ptr<Http::BodyReader> RouterHandler::onBodyStart(const Http::Request& req,
+                                                                     Http::BodyFlow flow)
+        {
+            return router->bodyReader(req, std::move(flow), snapshot);
+        }
+
+        bool RouterHandler::onExpectContinue(const Http::Request& req,
+                                             Http::ResponseWriter& response)
+        {
+            return router->expectContinue(req, response, snapshot);
         }
 
         void RouterHandler::onDisconnection(const std::shared_ptr<Tcp::Peer>& peer)
         {
+            Http::Handler::onDisconnection(peer);
             router->disconnectPeer(peer);
         }
 
@@ -446,10 +702,16 @@ namespace Pistache::Rest
     {
         if (resource.empty())
             throw std::runtime_error("Invalid zero-length URL.");
-        auto& r              = routes[method];
-        const auto sanitized = SegmentTreeNode::sanitizeResource(resource);
-        const std::string_view path { sanitized.data(), sanitized.size() };
+        if (frozen)
+            throw std::runtime_error("Can not remove a route from a frozen router.");
+        std::lock_guard<std::mutex> guard(published_->lock);
+        auto& r = routes[method];
+        std::string storage;
+        const auto path = SegmentTreeNode::sanitizeResource(resource, storage);
         r.removeRoute(path);
+        allowedMethods.removeMethod(path, method);
+        if (metrics_)
+            metrics_->remove(method, "/" + std::string(path));
     }
 
     void Router::head(const std::string& resource, Route::Handler handler)
@@ -479,6 +741,14 @@ namespace Pistache::Rest
 
     void Router::invokeNotFoundHandler(const Http::Request& req,
                                        Http::ResponseWriter resp) const
+    {
+        notFoundHandler(Rest::Request(req, std::vector<TypedParam>(),
+                                      std::vector<TypedParam>()),
+                        std::move(resp));
+    }
+
+    void Router::invokeNotFoundHandler(Http::Request&& req,
+                                       Http::ResponseWriter resp) const
     {
         notFoundHandler(Rest::Request(std::move(req), std::vector<TypedParam>(),
                                       std::vector<TypedParam>()),
@@ -488,65 +758,98 @@ namespace Pistache::Rest
     Route::Status Router::route(const Http::Request& request,
                                 Http::ResponseWriter response)
     {
-        const auto& resource = request.resource();
-        if (resource.empty())
-            throw std::runtime_error("Invalid zero-length URL.");
+        return route(Http::Request(request), std::move(response));
+    }
 
-        auto req  = request;
-        auto resp = response.clone();
+    Route::Status Router::route(Http::Request&& request,
+                                Http::ResponseWriter response)
+    {
+        SnapshotCache cache;
+        return route(std::move(request), std::move(response), cache);
+    }
+
+    Route::Status Router::route(Http::Request&& request, Http::ResponseWriter response,
+                                SnapshotCache& cache)
+    {
+        const auto* snapshot = refresh(cache);
+
+        if (request.resource().empty())
+            throw std::runtime_error("Invalid zero-length URL.");
 
         for (const auto& middleware : middlewares)
         {
-            auto result = middleware(req, resp);
+            auto result = middleware(request, response);
 
             // Handler returns true, go to the next piped handler, otherwise break and return
             if (!result)
                 return Route::Status::Match;
         }
 
-        auto& r              = routes[req.method()];
-        const auto sanitized = SegmentTreeNode::sanitizeResource(resource);
-        const std::string_view path { sanitized.data(), sanitized.size() };
-        auto result = r.findRoute(path);
+        std::string storage;
+        auto path = SegmentTreeNode::sanitizeResource(request.resource(), storage);
 
-        auto route = std::get<0>(result);
-        if (route != nullptr)
+        std::vector<TypedParam> params;
+        std::vector<TypedParam> splats;
+        if (const auto* route = findRoute(snapshot, request.method(), path, params, splats))
         {
-            auto params = std::get<1>(result);
-            auto splats = std::get<2>(result);
-            route->invokeHandler(Request(std::move(req), std::move(params), std::move(splats)),
-                                 std::move(resp));
+            if (route->metrics_)
+            {
+                const auto now = std::chrono::steady_clock::now();
+                route->metrics_->onDispatch(request, now);
+                response.listen(route->metrics_, now);
+            }
+            route->invokeHandler(Request(std::move(request), std::move(params), std::move(splats)),
+                                 std::move(response));
             return Route::Status::Match;
         }
 
+        // From here on the request is only read through rest, the path may
+        // have moved along with the resource
+        Request rest(std::move(request), std::vector<TypedParam>(), std::vector<TypedParam>());
+        path = SegmentTreeNode::sanitizeResource(rest.resource(), storage);
+
         for (const auto& handler : customHandlers)
         {
-            auto resp     = response.clone();
-            auto handler1 = handler(
-                Request(req, std::vector<TypedParam>(), std::vector<TypedParam>()),
-                std::move(resp));
-            if (handler1 == Route::Result::Ok)
+            auto result = handler(rest, response.clone());
+            if (result == Route::Result::Ok)
                 return Route::Status::Match;
         }
 
-        // No route or custom handler found. Let's walk through the
-        // list of other methods and see if any of them support
-        // this resource.
+        return sendUnrouted(snapshot, std::move(rest), path, std::move(response));
+    }
+
+    Route::Status Router::sendUnrouted(const Snapshot* snapshot, Request&& request,
+                                       std::string_view path, Http::ResponseWriter response)
+    {
+        // No route or custom handler found. Let's see if other methods
+        // support this resource, the tree of all routes tells it in a
+        // single walk.
         // This will allow server to send a
         // HTTP 405 (method not allowed) response.
         // RFC 7231 requires HTTP 405 responses to include a list of
         // supported methods for the requested resource.
-        std::vector<Http::Method> supportedMethods;
-        for (auto& methods : routes)
+        MethodSet allowed;
+        if (snapshot != nullptr)
         {
-            if (methods.first == req.method())
-                continue;
+            RouteTable::Match match;
+            for (const auto& [method, table] : snapshot->tables)
+            {
+                if (table.find(path, match))
+                    allowed.set(static_cast<size_t>(method));
+            }
+        }
+        else
+        {
+            allowed = allowedMethods.allowedMethods(path);
+        }
+        allowed.reset(static_cast<size_t>(request.method()));
 
-            auto res = methods.second.findRoute(path);
-            auto rte = std::get<0>(res);
-            if (rte != nullptr)
+        std::vector<Http::Method> supportedMethods;
+        for (size_t i = 0; i < allowed.size(); ++i)
+        {
+            if (allowed.test(i))
             {
-                supportedMethods.push_back(methods.first);
+                supportedMethods.push_back(static_cast<Http::Method>(i));
             }
         }
 
@@ -558,7 +861,7 @@ namespace Pistache::Rest
 
         if (hasNotFoundHandler())
         {
-            invokeNotFoundHandler(req, std::move(response));
+            invokeNotFoundHandler(std::move(request), std::move(response));
         }
         else
         {
@@ -567,20 +870,192 @@ namespace Pistache::Rest
         return Route::Status::NotFound;
     }
 
+    std::shared_ptr<Http::BodyReader> Router::bodyReader(const Http::Request& request,
+                                                         Http::BodyFlow flow)
+    {
+        SnapshotCache cache;
+        return bodyReader(request, std::move(flow), cache);
+    }
+
+    std::shared_ptr<Http::BodyReader> Router::bodyReader(const Http::Request& request,
+                                                         Http::BodyFlow flow, SnapshotCache& cache)
+    {
+        const auto* snapshot = refresh(cache);
+        if (!(snapshot != nullptr ? snapshot->bodyRoutes : bodyRoutes) || request.resource().empty())
+            return nullptr;
+
+        std::string storage;
+        const auto path = SegmentTreeNode::sanitizeResource(request.resource(), storage);
+
+        std::vector<TypedParam> params;
+        std::vector<TypedParam> splats;
+        const auto* route = findRoute(snapshot, request.method(), path, params, splats);
+        if (route == nullptr || !route->bodyHandler_)
+            return nullptr;
+
+        return route->bodyHandler_(Request(request, std::move(params), std::move(splats)),
+                                   std::move(flow));
+    }
+
+    bool Router::expectContinue(const Http::Request& request, Http::ResponseWriter& response)
+    {
+        SnapshotCache cache;
+        return expectContinue(request, response, cache);
+    }
+
+    bool Router::expectContinue(const Http::Request& request, Http::ResponseWriter& response,
+                                SnapshotCache& cache)
+    {
+        const auto* snapshot = refresh(cache);
+
+        // Fails once dispatched
+        if (request.resource().empty())
+            return true;
+
+        Http::Request head(request);
+        for (const auto& middleware : middlewares)
+        {
+            if (!middleware(head, response))
+                return false;
+        }
+
+        // Any request may be theirs
+        if (!customHandlers.empty())
+            return true;
+
+        std::string storage;
+        const auto path = SegmentTreeNode::sanitizeResource(head.resource(), storage);
+
+        std::vector<TypedParam> params;
+        std::vector<TypedParam> splats;
+        if (findRoute(snapshot, head.method(), path, params, splats) != nullptr)
+            return true;
+
+        // The path may move along with the resource
+        Request rest(std::move(head), std::vector<TypedParam>(), std::vector<TypedParam>());
+        const auto restPath = SegmentTreeNode::sanitizeResource(rest.resource(), storage);
+        sendUnrouted(snapshot, std::move(rest), restPath, std::move(response));
+        return false;
+    }
+
+    const Route* Router::findRoute(const Snapshot* snapshot, Http::Method method,
+                                   std::string_view path, std::vector<TypedParam>& params,
+                                   std::vector<TypedParam>& splats)
+    {
+        if (snapshot != nullptr || frozen)
+        {
+            const auto& tables = snapshot != nullptr ? snapshot->tables : frozenRoutes;
+
+            RouteTable::Match match;
+            auto table = tables.find(method);
+            if (table == std::end(tables) || !table->second.find(path, match))
+                return nullptr;
+
+            params.reserve(match.paramsCount);
+            for (size_t i = 0; i < match.paramsCount; ++i)
+            {
+                const auto& param = match.params[i];
+                params.emplace_back(std::string(param.name), std::string(param.value));
+            }
+
+            splats.reserve(match.splatsCount);
+            for (size_t i = 0; i < match.splatsCount; ++i)
+            {
+                std::string splat(match.splats[i]);
+                splats.emplace_back(splat, splat);
+            }
+            return match.route;
+        }
+
+        auto& r     = routes[method];
+        auto result = r.findRoute(path);
+
+        const auto& route = std::get<0>(result);
+        if (route == nullptr)
+            return nullptr;
+
+        params = std::move(std::get<1>(result));
+        splats = std::move(std::get<2>(result));
+        return route.get();
+    }
+
     void Router::addRoute(Http::Method method, const std::string& resource,
-                          Route::Handler handler)
+                          Route::Handler handler, Route::BodyHandler bodyHandler)
     {
         if (resource.empty())
             throw std::runtime_error("Invalid zero-length URL.");
-        auto& r              = routes[method];
-        const auto sanitized = SegmentTreeNode::sanitizeResource(resource);
+        if (frozen)
+            throw std::runtime_error("Can not add a route to a frozen router.");
+        std::lock_guard<std::mutex> guard(published_->lock);
+        auto& r = routes[method];
+        std::string storage;
+        const auto sanitized = SegmentTreeNode::sanitizeResource(resource, storage);
         std::shared_ptr<char> ptr(new char[sanitized.length()],
                                   std::default_delete<char[]>());
         memcpy(ptr.get(), sanitized.data(), sanitized.length());
         const std::string_view path { ptr.get(), sanitized.length() };
-        r.addRoute(path, handler, ptr);
+        if (bodyHandler)
+            bodyRoutes = true;
+        auto& route = r.addRoute(path, handler, ptr, bodyHandler);
+        allowedMethods.addMethod(path, method, ptr);
+        if (metrics_)
+            route.metrics_ = metrics_->add(method, "/" + std::string(path));
+    }
+
+    void Router::freeze()
+    {
+        frozenRoutes.clear();
+        for (const auto& methods : routes)
+            frozenRoutes.emplace(methods.first, RouteTable(methods.second));
+
+        frozen = true;
+    }
+
+    bool Router::isFrozen() const { return frozen; }
+
+    void Router::publish()
+    {
+        if (frozen)
+            throw std::runtime_error("Can not publish the routes of a frozen router.");
+
+        std::lock_guard<std::mutex> guard(published_->lock);
+
+        auto snapshot     = std::make_shared<Snapshot>();
+        snapshot->version = published_->version.load(std::memory_order_relaxed) + 1;
+        for (const auto& methods : routes)
+            snapshot->tables.emplace(methods.first, RouteTable(methods.second));
+        snapshot->bodyRoutes = bodyRoutes;
+
+        published_->current = std::move(snapshot);
+        published_->version.store(published_->current->version, std::memory_order_release);
+    }
+
+    uint64_t Router::version() const
+    {
+        return published_->version.load(std::memory_order_acquire);
+    }
+
+    const Router::Snapshot* Router::refresh(SnapshotCache& cache) const
+    {
+        // The common case, nothing new was published
+        const auto version = published_->version.load(std::memory_order_acquire);
+        if (version == cache.version)
+            return cache.snapshot.get();
+
+        std::lock_guard<std::mutex> guard(published_->lock);
+        cache.snapshot = published_->current;
+        cache.version  = cache.snapshot ? cache.snapshot->version : 0;
+        return cache.snapshot.get();
+    }
+
+    void Router::enableMetrics()
+    {
+        if (!metrics_)
+            metrics_ = std::make_shared<RouteMetricsRegistry>();
     }
 
+    std::shared_ptr<RouteMetricsRegistry> Router::metrics() const { return metrics_; }
+
     void Router::disconnectPeer(const std::shared_ptr<Tcp::Peer>& peer)
     {
         for (const auto& handler : disconnectHandlers)
@@ -640,5 +1115,48 @@ namespace Pistache::Rest
             router.head(resource, std::move(handler));
         }
 
+        Route::Handler offload(std::shared_ptr<Executor> executor, Route::Handler handler)
+        {
+            return [executor = std::move(executor), handler = std::move(handler)](
+                       const Request& request, Http::ResponseWriter response) {
+                // The request only lives for the call
+                auto copy   = std::make_shared<Request>(request);
+                auto writer = std::make_shared<Http::ResponseWriter>(std::move(response));
+
+                executor->submit([handler, copy, writer] {
+                    // Taken before the handler can arm the timeout of the writer
+                    auto fallback = writer->clone();
+                    try
+                    {
+                        handler(*copy, std::move(*writer));
+                    }
+                    catch (const Http::HttpError& err)
+                    {
+                        fallback.send(static_cast<Http::Code>(err.code()), err.reason());
+                    }
+                    catch (const std::exception& e)
+                    {
+                        fallback.send(Http::Code::Internal_Server_Error, e.what());
+                    }
+                });
+                return Route::Result::Ok;
+            };
+        }
+
+        void Metrics(Router& router, const std::string& resource)
+        {
+            router.enableMetrics();
+            std::weak_ptr<RouteMetricsRegistry> weak = router.metrics();
+            router.get(resource, [weak](const Request&, Http::ResponseWriter response) {
+                auto metrics = weak.lock();
+                if (!metrics)
+                    return Route::Result::Failure;
+
+                response.send(Http::Code::Ok, metrics->prometheus(),
+                              Http::Mime::MediaType::fromString("text/plain; version=0.0.4"));
+                return Route::Result::Ok;
+            });
+        }
+
     } // namespace Routes
 } // namespace Pistache::Rest
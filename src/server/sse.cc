@@ -0,0 +1,235 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* sse.cc
+
+   Implementation of the server-sent events channels
+*/
+
+#include <pistache/peer.h>
+#include <pistache/sse.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace Pistache::Http::Sse
+{
+
+    std::string Event::serialize() const
+    {
+        std::string out;
+        out.reserve(data.size() + event.size() + id.size() + 32);
+
+        if (!event.empty())
+            out.append("event: ").append(event).append("\n");
+        if (!id.empty())
+            out.append("id: ").append(id).append("\n");
+        if (retry)
+            out.append("retry: ").append(std::to_string(retry->count())).append("\n");
+
+        // A line break inside the data would end the field
+        size_t start = 0;
+        for (;;)
+        {
+            const auto end = data.find('\n', start);
+            out.append("data: ").append(data, start, end - start).append("\n");
+            if (end == std::string::npos)
+                break;
+            start = end + 1;
+        }
+
+        out.append("\n");
+        return out;
+    }
+
+    std::shared_ptr<Channel> Channel::create(std::chrono::milliseconds heartbeat)
+    {
+        return std::shared_ptr<Channel>(new Channel(heartbeat));
+    }
+
+    Channel::Channel(std::chrono::milliseconds heartbeat)
+        : heartbeat_(heartbeat)
+        , heartbeatComment_(std::string(":\n\n"))
+    { }
+
+    void Channel::subscribe(ResponseWriter response)
+    {
+        response.setCompression(Header::Encoding::Identity);
+        response.headers()
+            .add<Header::ContentType>(MIME(Text, EventStream))
+            .add<Header::CacheControl>(CacheDirective::NoCache);
+
+        auto stream = std::make_shared<ResponseStream>(response.stream(Code::Ok));
+        // The head goes out right away, the client knows it is subscribed
+        stream->flush();
+
+        auto* transport = stream->transport_;
+        auto peer       = stream->peer();
+        auto worker     = this->worker(transport);
+
+        ++subscribers_;
+        const bool posted = worker->post(
+            [self = shared_from_this(), worker, transport, stream, peerId = peer->getID()] {
+                worker->subscribers.push_back(Subscriber { stream, peerId });
+                self->armHeartbeat(worker, transport);
+            });
+        if (!posted)
+            --subscribers_;
+    }
+
+    void Channel::publish(const Event& event) { publish(SharedBuffer(event.serialize())); }
+
+    void Channel::publish(const SharedBuffer& payload)
+    {
+        std::vector<std::shared_ptr<Worker>> workers;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            workers.reserve(workers_.size());
+            for (auto it = workers_.begin(); it != workers_.end();)
+            {
+                // Its thread is gone along with the transport, and its streams
+                // with their connections
+                if (!it->second->post.alive())
+                {
+                    subscribers_ -= it->second->subscribers.size();
+                    it = workers_.erase(it);
+                    continue;
+                }
+                workers.push_back(it->second);
+                ++it;
+            }
+        }
+
+        for (auto& worker : workers)
+        {
+            worker->post([self = shared_from_this(), worker, payload] {
+                self->send(*worker, payload);
+            });
+        }
+    }
+
+    void Channel::disconnect(const std::shared_ptr<Tcp::Peer>& peer)
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        for (const auto& entry : workers_)
+        {
+            entry.second->post([self = shared_from_this(), worker = entry.second,
+                                peerId = peer->getID()] { self->prune(*worker, peerId); });
+        }
+    }
+
+    void Channel::close()
+    {
+        std::unordered_map<Tcp::Transport*, std::shared_ptr<Worker>> workers;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            workers.swap(workers_);
+        }
+
+        for (auto& entry : workers)
+        {
+            entry.second->post([self = shared_from_this(), worker = entry.second] {
+                for (auto& subscriber : worker->subscribers)
+                {
+                    try
+                    {
+                        subscriber.stream->ends();
+                    }
+                    catch (const std::runtime_error&)
+                    { }
+                }
+                self->subscribers_ -= worker->subscribers.size();
+                worker->subscribers.clear();
+            });
+        }
+    }
+
+    std::shared_ptr<Channel::Worker> Channel::worker(Tcp::Transport* transport)
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+
+        // A transport that went away may have left its address to a new one
+        auto& worker = workers_[transport];
+        if (!worker || !worker->post.alive())
+        {
+            worker       = std::make_shared<Worker>();
+            worker->post = transport->poster();
+        }
+        return worker;
+    }
+
+    void Channel::send(Worker& worker, const SharedBuffer& payload)
+    {
+        worker.active = true;
+
+        auto it = worker.subscribers.begin();
+        while (it != worker.subscribers.end())
+        {
+            // The connection may also go away while the event is written
+            bool open = !it->stream->peer_.expired();
+            if (open)
+            {
+                try
+                {
+                    it->stream->write(payload);
+                }
+                catch (const std::runtime_error&)
+                {
+                    open = false;
+                }
+            }
+
+            if (open)
+            {
+                ++it;
+            }
+            else
+            {
+                it = worker.subscribers.erase(it);
+                --subscribers_;
+            }
+        }
+    }
+
+    void Channel::prune(Worker& worker, size_t peerId)
+    {
+        auto& subscribers = worker.subscribers;
+        const auto end    = std::remove_if(subscribers.begin(), subscribers.end(),
+                                           [peerId](const Subscriber& subscriber) {
+                                            return subscriber.peerId == peerId
+                                                || subscriber.stream->peer_.expired();
+                                        });
+        subscribers_ -= static_cast<size_t>(std::distance(end, subscribers.end()));
+        subscribers.erase(end, subscribers.end());
+    }
+
+    void Channel::armHeartbeat(const std::shared_ptr<Worker>& worker, Tcp::Transport* transport)
+    {
+        if (heartbeat_.count() == 0 || worker->heartbeatArmed)
+            return;
+
+        // The timer fires from the thread of the transport, which it does not
+        // outlive. The worker is left alone once nobody is subscribed anymore
+        worker->heartbeatArmed = true;
+        transport->scheduleTimer(
+            heartbeat_,
+            [weakSelf = weak_from_this(), weakWorker = std::weak_ptr<Worker>(worker), transport] {
+                auto self   = weakSelf.lock();
+                auto worker = weakWorker.lock();
+                if (!self || !worker)
+                    return;
+
+                worker->heartbeatArmed = false;
+                if (!worker->active)
+                    self->send(*worker, self->heartbeatComment_);
+                worker->active = false;
+
+                if (!worker->subscribers.empty())
+                    self->armHeartbeat(worker, transport);
+            });
+    }
+
+} // namespace Pistache::Http::Sse
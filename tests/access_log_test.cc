@@ -0,0 +1,212 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/access_log.h>
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "tcp_client.h"
+
+using namespace Pistache;
+
+namespace
+{
+    class LoggedHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(LoggedHandler)
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter response) override
+        {
+            if (request.resource() == "/stream")
+            {
+                auto stream = response.stream(Http::Code::Ok);
+                stream << "streamed";
+                stream.ends();
+                return;
+            }
+            if (request.resource() == "/missing")
+            {
+                response.send(Http::Code::Not_Found, "missing");
+                return;
+            }
+            response.send(Http::Code::Ok, "hello");
+        }
+    };
+
+    std::string tempPath(const char* name)
+    {
+        return "/tmp/pistache_" + std::string(name) + "_" + std::to_string(::getpid());
+    }
+
+    // Sends the requests on one connection, and waits for all the answers
+    void request(Http::Endpoint& endpoint, const std::vector<std::string>& resources)
+    {
+        TcpClient client;
+        ASSERT_TRUE(client.connect(Address(IP::loopback(), endpoint.getPort())));
+
+        std::string requests;
+        for (const auto& resource : resources)
+            requests += "GET " + resource + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        ASSERT_TRUE(client.send(requests));
+
+        std::string responses;
+        size_t answered = 0;
+        char buffer[1024];
+        while (answered < resources.size())
+        {
+            size_t bytes = 0;
+            if (!client.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                break;
+            responses.append(buffer, bytes);
+
+            answered = 0;
+            for (auto pos = responses.find("HTTP/1.1 "); pos != std::string::npos;
+                 pos      = responses.find("HTTP/1.1 ", pos + 1))
+                ++answered;
+            // The last chunk of a stream may still be on its way
+            if (answered == resources.size() && responses.find("streamed") != std::string::npos
+                && responses.find("0\r\n\r\n") == std::string::npos)
+                answered--;
+        }
+        ASSERT_EQ(answered, resources.size()) << responses;
+    }
+
+    // A record is taken once the response is queued, which may be after the
+    // client got it
+    void waitForRecords(Http::AccessLog& log, uint64_t count)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        log.flush();
+        while (log.written() < count && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            log.flush();
+        }
+    }
+} // namespace
+
+TEST(access_log_test, records_responses_to_a_file)
+{
+    const auto path = tempPath("access_log");
+    std::remove(path.c_str());
+    auto log = Http::AccessLog::toFile(path);
+
+    Http::Endpoint endpoint(Address(IP::loopback(), Port(0)));
+    endpoint.init(Http::Endpoint::options().threads(1).flags(Tcp::Options::ReuseAddr).accessLog(log));
+    endpoint.setHandler(Http::make_handler<LoggedHandler>());
+    endpoint.serveThreaded();
+
+    const auto start = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+    request(endpoint, { "/hello", "/missing", "/stream" });
+    waitForRecords(*log, 3);
+    endpoint.shutdown();
+
+    EXPECT_EQ(log->written(), 3u);
+    EXPECT_EQ(log->dropped(), 0u);
+
+    std::ifstream file(path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(path.c_str());
+
+    const auto records = Http::AccessLog::decode(data);
+    ASSERT_EQ(records.size(), 3u);
+
+    EXPECT_EQ(records[0].resource, "/hello");
+    EXPECT_EQ(records[0].method, Http::Method::Get);
+    EXPECT_EQ(records[0].version, Http::Version::Http11);
+    EXPECT_EQ(records[0].status, Http::Code::Ok);
+    // The head, and the body
+    EXPECT_GT(records[0].bytes, 5u);
+    EXPECT_GE(records[0].time + 1000, static_cast<uint64_t>(start));
+    EXPECT_LT(records[0].duration, std::chrono::seconds(5));
+
+    EXPECT_EQ(records[1].resource, "/missing");
+    EXPECT_EQ(records[1].status, Http::Code::Not_Found);
+
+    EXPECT_EQ(records[2].resource, "/stream");
+    EXPECT_EQ(records[2].status, Http::Code::Ok);
+    EXPECT_GT(records[2].bytes, 8u);
+
+    // An incomplete record is left for the next read
+    EXPECT_EQ(Http::AccessLog::decode(data.substr(0, data.size() - 1)).size(), 2u);
+}
+
+TEST(access_log_test, samples_requests)
+{
+    const auto path = tempPath("access_log_sampled");
+    std::remove(path.c_str());
+    auto log = Http::AccessLog::toFile(path);
+    log->setSampling(3);
+
+    Http::Endpoint endpoint(Address(IP::loopback(), Port(0)));
+    endpoint.init(Http::Endpoint::options().threads(1).flags(Tcp::Options::ReuseAddr).accessLog(log));
+    endpoint.setHandler(Http::make_handler<LoggedHandler>());
+    endpoint.serveThreaded();
+
+    request(endpoint, std::vector<std::string>(9, "/hello"));
+    waitForRecords(*log, 3);
+    endpoint.shutdown();
+
+    EXPECT_EQ(log->written(), 3u);
+    std::remove(path.c_str());
+}
+
+TEST(access_log_test, sends_datagrams_to_a_unix_socket)
+{
+    const auto path = tempPath("access_log_socket");
+    ::unlink(path.c_str());
+
+    int receiver = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    ASSERT_GE(receiver, 0);
+    struct sockaddr_un addr = {};
+    addr.sun_family         = AF_UNIX;
+    std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path.c_str());
+    ASSERT_EQ(::bind(receiver, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+
+    auto log = Http::AccessLog::toUnixSocket(path);
+
+    Http::Endpoint endpoint(Address(IP::loopback(), Port(0)));
+    endpoint.init(Http::Endpoint::options().threads(1).flags(Tcp::Options::ReuseAddr).accessLog(log));
+    endpoint.setHandler(Http::make_handler<LoggedHandler>());
+    endpoint.serveThreaded();
+
+    request(endpoint, { "/a", "/b" });
+    waitForRecords(*log, 2);
+    endpoint.shutdown();
+
+    std::vector<Http::AccessRecord> records;
+    char datagram[Http::AccessLog::MaxDatagramSize];
+    while (records.size() < 2)
+    {
+        const auto bytes = ::recv(receiver, datagram, sizeof(datagram), MSG_DONTWAIT);
+        if (bytes <= 0)
+            break;
+        for (auto& record : Http::AccessLog::decode(std::string_view(datagram, static_cast<size_t>(bytes))))
+            records.push_back(std::move(record));
+    }
+    ::close(receiver);
+    ::unlink(path.c_str());
+
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].resource, "/a");
+    EXPECT_EQ(records[1].resource, "/b");
+}
@@ -315,6 +315,189 @@ TEST(async_test, when_any)
     ASSERT_TRUE(resolved);
 }
 
+TEST(async_test, gather_and_when_each)
+{
+    // Resolved from several threads, in any order
+    std::vector<Async::Promise<int>> promises;
+    std::vector<Async::Resolver> resolvers;
+    for (int i = 0; i < 64; ++i)
+        promises.emplace_back([&](Async::Resolver& resolve, Async::Rejection&) {
+            resolvers.push_back(resolve.clone());
+        });
+
+    std::vector<int> gathered;
+    Async::gather(promises.begin(), promises.end())
+        .then([&](const std::vector<int>& results) { gathered = results; }, Async::NoExcept);
+
+    std::mutex lock;
+    std::vector<size_t> indices;
+    bool done = false;
+    Async::whenEach(promises.begin(), promises.end(), [&](size_t index, int value) {
+        ASSERT_EQ(value, static_cast<int>(index) * 2);
+        std::lock_guard<std::mutex> guard(lock);
+        indices.push_back(index);
+    }).then([&] { done = true; }, Async::NoExcept);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&, t] {
+            for (int i = 63 - t; i >= 0; i -= 4)
+                resolvers[i](i * 2);
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    ASSERT_EQ(gathered.size(), 64u);
+    for (int i = 0; i < 64; ++i)
+        EXPECT_EQ(gathered[i], i * 2);
+    ASSERT_TRUE(done);
+    EXPECT_EQ(indices.size(), 64u);
+
+    // An empty range resolves right away
+    std::vector<Async::Promise<void>> none;
+    bool empty = false;
+    Async::gather(none.begin(), none.end()).then([&] { empty = true; }, Async::NoExcept);
+    EXPECT_TRUE(empty);
+}
+
+TEST(async_test, gather_rejects_with_the_first_rejection)
+{
+    std::vector<Async::Promise<int>> promises;
+    std::vector<Async::Resolver> resolvers;
+    std::vector<Async::Rejection> rejections;
+    for (int i = 0; i < 3; ++i)
+        promises.emplace_back([&](Async::Resolver& resolve, Async::Rejection& reject) {
+            resolvers.push_back(resolve.clone());
+            rejections.push_back(reject.clone());
+        });
+
+    int rejected = 0;
+    std::string what;
+    Async::gather(promises.begin(), promises.end())
+        .then([](const std::vector<int>&) { FAIL() << "resolved"; },
+              [&](std::exception_ptr exc) {
+                  ++rejected;
+                  try
+                  {
+                      std::rethrow_exception(exc);
+                  }
+                  catch (const std::runtime_error& err)
+                  {
+                      what = err.what();
+                  }
+              });
+
+    size_t calls = 0;
+    bool eachRejected = false;
+    Async::whenEach(promises.begin(), promises.end(), [&](size_t, int) { ++calls; })
+        .then([] { FAIL() << "resolved"; },
+              [&](std::exception_ptr) { eachRejected = true; });
+
+    resolvers[0](1);
+    rejections[1](std::runtime_error("first"));
+    rejections[2](std::runtime_error("second"));
+
+    EXPECT_EQ(rejected, 1);
+    EXPECT_EQ(what, "first");
+    EXPECT_TRUE(eachRejected);
+    EXPECT_EQ(calls, 1u);
+
+    // An exception thrown by the function rejects the promise as well
+    auto values   = std::vector<Async::Promise<int>> {};
+    values.push_back(Async::Promise<int>::resolved(1));
+    bool thrown = false;
+    Async::whenEach(values.begin(), values.end(), [](size_t, int) {
+        throw std::runtime_error("thrown");
+    }).then([] { FAIL() << "resolved"; }, [&](std::exception_ptr) { thrown = true; });
+    EXPECT_TRUE(thrown);
+}
+
+TEST(async_test, cancelled_chains_stop_running)
+{
+    Async::CancellationSource source;
+    Async::Resolver* resolver = nullptr;
+    Async::Promise<int> promise([&](Async::Resolver& resolve, Async::Rejection&) {
+        resolver = &resolve;
+    });
+    promise.cancelWith(source.token());
+
+    int ran = 0;
+    bool cancelled = false;
+    promise
+        .then([&](int value) {
+            ++ran;
+            return value + 1;
+        },
+              Async::Throw)
+        .then([&](int) { ++ran; },
+              [&](std::exception_ptr exc) {
+                  try
+                  {
+                      std::rethrow_exception(exc);
+                  }
+                  catch (const Async::Cancelled&)
+                  {
+                      cancelled = true;
+                  }
+              });
+
+    int callbacks = 0;
+    auto token    = source.token();
+    auto kept     = token.onCancel([&] { ++callbacks; });
+    auto dropped  = token.onCancel([&] { ++callbacks; });
+    token.forget(dropped);
+    EXPECT_NE(kept, 0u);
+
+    source.cancel();
+    source.cancel();
+    EXPECT_EQ(callbacks, 1);
+    EXPECT_TRUE(token.isCancelled());
+
+    // The producer still settles its promise, the continuations do not run
+    (*resolver)(1);
+    EXPECT_EQ(ran, 0);
+    EXPECT_TRUE(cancelled);
+
+    // Too late to register, the callback runs right away
+    EXPECT_EQ(token.onCancel([&] { ++callbacks; }), 0u);
+    EXPECT_EQ(callbacks, 2);
+
+    EXPECT_FALSE(Async::CancellationToken().canBeCancelled());
+    EXPECT_FALSE(Async::CancellationToken().isCancelled());
+}
+
+TEST(async_test, then_on_runs_continuations_from_the_executor)
+{
+    std::deque<std::function<void()>> tasks;
+    auto executor = [&tasks](std::function<void()> task) { tasks.push_back(std::move(task)); };
+
+    Async::Resolver* resolver = nullptr;
+    Async::Promise<int> promise([&](Async::Resolver& resolve, Async::Rejection&) {
+        resolver = &resolve;
+    });
+
+    int result = 0;
+    auto next  = promise.thenOn(executor, [](int value) { return value * 2; }, Async::Throw);
+    next.then([&](int value) { result = value; }, Async::NoExcept);
+
+    (*resolver)(21);
+    EXPECT_TRUE(next.isPending());
+    ASSERT_EQ(tasks.size(), 1u);
+
+    tasks.front()();
+    tasks.pop_front();
+    EXPECT_EQ(result, 42);
+
+    // Rejections go through the executor as well
+    bool rejected = false;
+    Async::Promise<void>::rejected(std::runtime_error("failed"))
+        .thenOn(executor, [] { }, [&](std::exception_ptr) { rejected = true; });
+    EXPECT_FALSE(rejected);
+    ASSERT_EQ(tasks.size(), 1u);
+    tasks.front()();
+    EXPECT_TRUE(rejected);
+}
+
 TEST(async_test, rethrow_test)
 {
     auto p1 = Async::Promise<void>(
@@ -500,3 +683,73 @@ TEST(async_test, chain_rejects)
     (*rejecter)(std::runtime_error("foo"));
     ASSERT_TRUE(ok);
 }
+
+TEST(async_test, every_continuation_runs_once)
+{
+    static constexpr int Rounds        = 2000;
+    static constexpr int Continuations = 4;
+
+    for (int round = 0; round < Rounds; ++round)
+    {
+        Async::Deferred<int> deferred;
+        Async::Promise<int> promise(
+            [&](Async::Deferred<int> d) { deferred = std::move(d); });
+
+        std::atomic<int> calls(0);
+        std::atomic<bool> go(false);
+
+        // Races the first (lock-free) and the following (locked)
+        // continuations against the resolution
+        std::vector<std::thread> attachers;
+        for (int i = 0; i < Continuations; ++i)
+        {
+            attachers.emplace_back([&] {
+                while (!go)
+                    ;
+                promise.then([&](int value) { calls += value; }, Async::NoExcept);
+            });
+        }
+
+        go = true;
+        deferred.resolve(1);
+
+        for (auto& thread : attachers)
+            thread.join();
+
+        ASSERT_EQ(calls.load(), Continuations);
+    }
+}
+
+TEST(async_test, continuation_can_attach_to_its_own_promise)
+{
+    Async::Deferred<int> deferred;
+    Async::Promise<int> promise(
+        [&](Async::Deferred<int> d) { deferred = std::move(d); });
+
+    int inner = 0;
+    promise.then([&](int) {
+        promise.then([&](int value) { inner = value; }, Async::NoExcept);
+    },
+                 Async::NoExcept);
+
+    deferred.resolve(42);
+    ASSERT_EQ(inner, 42);
+}
+
+TEST(async_test, already_resolved_promise_runs_continuations)
+{
+    auto promise = Async::Promise<int>::resolved(7);
+
+    int first  = 0;
+    int second = 0;
+    promise.then([&](int value) { first = value; }, Async::NoExcept);
+    promise.then([&](int value) { second = value; }, Async::NoExcept);
+
+    ASSERT_EQ(first, 7);
+    ASSERT_EQ(second, 7);
+
+    bool rejected = false;
+    Async::Promise<int>::rejected(std::runtime_error("nope"))
+        .then([](int) {}, [&](std::exception_ptr) { rejected = true; });
+    ASSERT_TRUE(rejected);
+}
@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* async_benchmark.cc
+
+   Chains of continuations of an Async::Promise
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <pistache/async.h>
+
+#include <optional>
+#include <utility>
+
+using namespace Pistache;
+
+namespace
+{
+    // The continuations run as they are attached
+    void BM_PromiseChainResolved(benchmark::State& state)
+    {
+        const auto length = state.range(0);
+        for (auto _ : state)
+        {
+            auto promise = Async::Promise<int>::resolved(0);
+            for (int64_t i = 0; i < length; ++i)
+                promise = promise.then([](int value) { return value + 1; }, Async::NoExcept);
+            benchmark::DoNotOptimize(promise.isFulfilled());
+        }
+        state.SetItemsProcessed(state.iterations() * length);
+    }
+
+    // The continuations are stored, then run by the resolve
+    void BM_PromiseChainPending(benchmark::State& state)
+    {
+        const auto length = state.range(0);
+        for (auto _ : state)
+        {
+            std::optional<Async::Resolver> resolver;
+            Async::Promise<int> promise(
+                [&](Async::Resolver& resolve, Async::Rejection&) { resolver.emplace(std::move(resolve)); });
+            for (int64_t i = 0; i < length; ++i)
+                promise = promise.then([](int value) { return value + 1; }, Async::NoExcept);
+
+            (*resolver)(0);
+            benchmark::DoNotOptimize(promise.isFulfilled());
+        }
+        state.SetItemsProcessed(state.iterations() * length);
+    }
+} // namespace
+
+BENCHMARK(BM_PromiseChainResolved)->Arg(1)->Arg(8)->Arg(64);
+BENCHMARK(BM_PromiseChainPending)->Arg(1)->Arg(8)->Arg(64);
@@ -0,0 +1,128 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* headers_benchmark.cc
+
+   Header::Collection, as filled by the parser and read by a handler
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <pistache/http_headers.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace Pistache;
+using namespace Pistache::Http;
+
+namespace
+{
+    const std::vector<std::pair<std::string, std::string>> Headers = {
+        { "Host", "www.example.com" },
+        { "User-Agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36" },
+        { "Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8" },
+        { "Accept-Encoding", "gzip, deflate, br" },
+        { "Accept-Language", "en-US,en;q=0.9" },
+        { "Connection", "keep-alive" },
+        { "Cookie", "session=7f1c2a9e4b3d; theme=dark" },
+        { "Content-Type", "application/json" },
+        { "Content-Length", "86" },
+        { "X-Request-Id", "5b0d1f3c-7e1a-4a5b-9d3e-2f6c8a9b0c1d" },
+        { "X-Forwarded-For", "203.0.113.7" },
+    };
+
+    Header::Collection filled(bool deferred)
+    {
+        Header::Collection headers;
+        for (const auto& [name, value] : Headers)
+        {
+            if (deferred)
+                headers.addDeferred(Header::Raw(name, value));
+            else
+                headers.addRaw(Header::Raw(name, value));
+        }
+        return headers;
+    }
+
+    void BM_CollectionAddRaw(benchmark::State& state)
+    {
+        for (auto _ : state)
+            benchmark::DoNotOptimize(filled(false));
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * Headers.size()));
+    }
+
+    void BM_CollectionAddDeferred(benchmark::State& state)
+    {
+        for (auto _ : state)
+            benchmark::DoNotOptimize(filled(true));
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * Headers.size()));
+    }
+
+    void BM_CollectionAddTyped(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            Header::Collection headers;
+            headers.add<Header::Host>("www.example.com");
+            headers.add<Header::ContentLength>(86);
+            headers.add<Header::ContentType>(MIME(Application, Json));
+            headers.add<Header::Connection>(ConnectionControl::KeepAlive);
+            benchmark::DoNotOptimize(headers);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * 4));
+    }
+
+    // A typed header of a known slot, and one looked up by its name
+    void BM_CollectionTryGetTyped(benchmark::State& state)
+    {
+        auto headers = filled(false);
+        headers.add<Header::ContentLength>(86);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(headers.tryGet<Header::ContentLength>());
+    }
+
+    void BM_CollectionTryGetRaw(benchmark::State& state)
+    {
+        const auto headers = filled(false);
+        const std::string name = "x-forwarded-for";
+        for (auto _ : state)
+            benchmark::DoNotOptimize(headers.tryGetRaw(name));
+    }
+
+    void BM_CollectionHas(benchmark::State& state)
+    {
+        const auto headers = filled(false);
+        const std::string present = "Accept-Language", missing = "Authorization";
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(headers.has(present));
+            benchmark::DoNotOptimize(headers.has(missing));
+        }
+    }
+
+    // The first access of a deferred header parses it
+    void BM_CollectionMaterialize(benchmark::State& state)
+    {
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            auto headers = filled(true);
+            state.ResumeTiming();
+            benchmark::DoNotOptimize(headers.tryGet<Header::Accept>());
+            benchmark::DoNotOptimize(headers.tryGet<Header::ContentLength>());
+        }
+    }
+} // namespace
+
+BENCHMARK(BM_CollectionAddRaw);
+BENCHMARK(BM_CollectionAddDeferred);
+BENCHMARK(BM_CollectionAddTyped);
+BENCHMARK(BM_CollectionTryGetTyped);
+BENCHMARK(BM_CollectionTryGetRaw);
+BENCHMARK(BM_CollectionHas);
+BENCHMARK(BM_CollectionMaterialize);
@@ -0,0 +1,765 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* loadtest.cc
+
+   End-to-end load test: starts one of the reference servers, then loads it
+   from raw sockets for every combination of worker threads, connections and
+   pipelining depth, reporting the requests per second and the latency
+   percentiles.
+
+   With --rate, requests are sent on a fixed schedule and their latency is
+   counted from the time they were due, not from the time they could be
+   sent, so that a stalled server is not hidden by a stalled client
+   (coordinated omission). Without it, every connection keeps its pipeline
+   full and the latency is counted from the send.
+
+   Every connection is a thread of the load generator, which is meant for
+   up to a few hundred connections.
+*/
+
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+#include <pistache/route_metrics.h>
+#include <pistache/router.h>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef PISTACHE_USE_SSL
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Pistache;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        std::string server = "hello";
+        // host:port of a server to load instead of a reference one
+        std::string target;
+        std::string path;
+
+        std::vector<size_t> workers     = { 1 };
+        std::vector<size_t> connections = { 16 };
+        std::vector<size_t> pipeline    = { 1 };
+
+        // Requests per second over all the connections, 0 for as many as
+        // the server takes
+        double rate = 0;
+        std::chrono::seconds duration { 5 };
+        std::chrono::seconds warmup { 1 };
+
+        bool tls = false;
+        std::string cert;
+        std::string key;
+
+        size_t fileSize    = 16384;
+        size_t chunks      = 8;
+        size_t chunkSize   = 1024;
+        size_t routesCount = 100;
+    };
+
+    void usage(const char* program)
+    {
+        std::cerr
+            << "Usage: " << program << " [options]\n"
+            << "  --server hello|rest|file|stream  reference server to start (hello)\n"
+            << "  --target host:port               load this server instead\n"
+            << "  --path /resource                 resource to request\n"
+            << "  --workers 1,4                    worker threads of the server (1)\n"
+            << "  --connections 1,16,64            connections of the load (16)\n"
+            << "  --pipeline 1,8                   requests in flight per connection (1)\n"
+            << "  --rate N                         requests per second, fixed schedule (none)\n"
+            << "  --duration S                     seconds measured per run (5)\n"
+            << "  --warmup S                       seconds left out of the results (1)\n"
+            << "  --tls --cert FILE --key FILE     serve and load over TLS\n"
+            << "  --file-size N                    bytes of the file server (16384)\n"
+            << "  --chunks N --chunk-size N        chunks of the stream server (8 x 1024)\n"
+            << "  --routes N                       routes of the REST server (100)\n";
+    }
+
+    std::vector<size_t> parseList(const std::string& value)
+    {
+        std::vector<size_t> values;
+        size_t start = 0;
+        while (start <= value.size())
+        {
+            auto end = value.find(',', start);
+            if (end == std::string::npos)
+                end = value.size();
+            values.push_back(std::stoul(value.substr(start, end - start)));
+            start = end + 1;
+        }
+        return values;
+    }
+
+    Options parseOptions(int argc, char* argv[])
+    {
+        Options options;
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            auto value            = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("Missing value of " + arg);
+                return argv[++i];
+            };
+
+            if (arg == "--server")
+                options.server = value();
+            else if (arg == "--target")
+                options.target = value();
+            else if (arg == "--path")
+                options.path = value();
+            else if (arg == "--workers")
+                options.workers = parseList(value());
+            else if (arg == "--connections")
+                options.connections = parseList(value());
+            else if (arg == "--pipeline")
+                options.pipeline = parseList(value());
+            else if (arg == "--rate")
+                options.rate = std::stod(value());
+            else if (arg == "--duration")
+                options.duration = std::chrono::seconds(std::stoul(value()));
+            else if (arg == "--warmup")
+                options.warmup = std::chrono::seconds(std::stoul(value()));
+            else if (arg == "--tls")
+                options.tls = true;
+            else if (arg == "--cert")
+                options.cert = value();
+            else if (arg == "--key")
+                options.key = value();
+            else if (arg == "--file-size")
+                options.fileSize = std::stoul(value());
+            else if (arg == "--chunks")
+                options.chunks = std::stoul(value());
+            else if (arg == "--chunk-size")
+                options.chunkSize = std::stoul(value());
+            else if (arg == "--routes")
+                options.routesCount = std::stoul(value());
+            else
+                throw std::invalid_argument("Unknown option " + arg);
+        }
+
+        if (options.server != "hello" && options.server != "rest" && options.server != "file"
+            && options.server != "stream")
+            throw std::invalid_argument("Unknown server " + options.server);
+        if (options.tls && options.target.empty() && (options.cert.empty() || options.key.empty()))
+            throw std::invalid_argument("--tls needs --cert and --key");
+        for (const auto* list : { &options.workers, &options.connections, &options.pipeline })
+        {
+            if (std::find(list->begin(), list->end(), 0) != list->end())
+                throw std::invalid_argument("Counts must be positive");
+        }
+        return options;
+    }
+
+    // Reference servers
+
+    class HelloHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(HelloHandler)
+
+        void onRequest(const Http::Request&, Http::ResponseWriter response) override
+        {
+            response.send(Http::Code::Ok, "Hello World\n");
+        }
+    };
+
+    class FileHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(FileHandler)
+
+        explicit FileHandler(std::shared_ptr<FileBuffer> file)
+            : file_(std::move(file))
+        { }
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter response) override
+        {
+            Http::serveFile(request, response, *file_, MIME(Application, OctetStream));
+        }
+
+    private:
+        std::shared_ptr<FileBuffer> file_;
+    };
+
+    class StreamHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(StreamHandler)
+
+        StreamHandler(size_t chunks, size_t chunkSize)
+            : chunks_(chunks)
+            , chunk_(chunkSize, 'x')
+        { }
+
+        void onRequest(const Http::Request&, Http::ResponseWriter response) override
+        {
+            auto stream = response.stream(Http::Code::Ok);
+            for (size_t i = 0; i < chunks_; ++i)
+            {
+                stream.write(chunk_.data(), chunk_.size());
+                stream.flush();
+            }
+            stream.ends();
+        }
+
+    private:
+        size_t chunks_;
+        std::string chunk_;
+    };
+
+    // A file of the given size, removed once the server is done with it
+    class TemporaryFile
+    {
+    public:
+        explicit TemporaryFile(size_t size)
+        {
+            char name[] = "/tmp/pistache_loadtest_XXXXXX";
+            const int fd = mkstemp(name);
+            if (fd == -1)
+                throw std::runtime_error("Could not create the file to serve");
+            name_ = name;
+
+            const std::string data(size, 'x');
+            const bool written = ::write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size());
+            ::close(fd);
+            if (!written)
+                throw std::runtime_error("Could not write the file to serve");
+        }
+
+        ~TemporaryFile() { ::unlink(name_.c_str()); }
+
+        const std::string& name() const { return name_; }
+
+    private:
+        std::string name_;
+    };
+
+    class ReferenceServer
+    {
+    public:
+        ReferenceServer(const Options& options, size_t workers)
+            : endpoint_(Address(IP::loopback(), Port(0)))
+        {
+            endpoint_.init(Http::Endpoint::options()
+                               .threads(static_cast<int>(workers))
+                               .flags(Tcp::Options::ReuseAddr | Tcp::Options::NoDelay)
+                               .backlog(1024));
+            if (options.tls)
+                endpoint_.useSSL(options.cert, options.key);
+
+            if (options.server == "hello")
+                endpoint_.setHandler(Http::make_handler<HelloHandler>());
+            else if (options.server == "rest")
+            {
+                for (size_t i = 0; i < options.routesCount; ++i)
+                {
+                    router_.get("/api/v1/resource" + std::to_string(i) + "/:id",
+                                [](const Rest::Request& request, Http::ResponseWriter response) {
+                                    response.send(Http::Code::Ok,
+                                                  "{\"id\":" + request.param(":id").as<std::string>() + "}",
+                                                  MIME(Application, Json));
+                                    return Rest::Route::Result::Ok;
+                                });
+                }
+                router_.freeze();
+                endpoint_.setHandler(router_.handler());
+            }
+            else if (options.server == "file")
+            {
+                file_ = std::make_unique<TemporaryFile>(options.fileSize);
+                endpoint_.setHandler(
+                    Http::make_handler<FileHandler>(std::make_shared<FileBuffer>(file_->name())));
+            }
+            else
+                endpoint_.setHandler(Http::make_handler<StreamHandler>(options.chunks, options.chunkSize));
+
+            endpoint_.serveThreaded();
+        }
+
+        ~ReferenceServer() { endpoint_.shutdown(); }
+
+        uint16_t port() const { return endpoint_.getPort(); }
+
+        static std::string defaultPath(const Options& options)
+        {
+            if (options.server == "rest")
+                return "/api/v1/resource" + std::to_string(options.routesCount / 2) + "/1234";
+            if (options.server == "file")
+                return "/file";
+            if (options.server == "stream")
+                return "/stream";
+            return "/";
+        }
+
+    private:
+        std::unique_ptr<TemporaryFile> file_;
+        Rest::Router router_;
+        Http::Endpoint endpoint_;
+    };
+
+    // Load generator
+
+    /* Splits the bytes of a connection into responses, of a Content-Length
+     * or chunked. Returns the status of each complete response.
+     */
+    class ResponseReader
+    {
+    public:
+        template <typename OnResponse>
+        bool feed(const char* data, size_t size, OnResponse onResponse)
+        {
+            buffer_.append(data, size);
+
+            size_t start = 0;
+            while (true)
+            {
+                const auto headEnd = buffer_.find("\r\n\r\n", start);
+                if (headEnd == std::string::npos)
+                    break;
+                if (buffer_.compare(start, 5, "HTTP/") != 0)
+                    return false;
+
+                const int status = std::atoi(buffer_.c_str() + start + 9);
+                const auto head  = lowercase(buffer_.substr(start, headEnd - start));
+                size_t end       = std::string::npos;
+
+                if (head.find("\r\ntransfer-encoding: chunked") != std::string::npos)
+                    end = chunkedEnd(headEnd + 4);
+                else
+                {
+                    size_t length = 0;
+                    const auto cl = head.find("\r\ncontent-length:");
+                    if (cl != std::string::npos)
+                        length = std::strtoul(head.c_str() + cl + 17, nullptr, 10);
+                    if (buffer_.size() >= headEnd + 4 + length)
+                        end = headEnd + 4 + length;
+                }
+
+                if (end == std::string::npos)
+                    break;
+                onResponse(status);
+                start = end;
+            }
+
+            buffer_.erase(0, start);
+            return true;
+        }
+
+        void clear() { buffer_.clear(); }
+
+    private:
+        static std::string lowercase(std::string value)
+        {
+            std::transform(value.begin(), value.end(), value.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return value;
+        }
+
+        // End of the chunked body starting at pos, npos while incomplete.
+        // Trailers are not expected
+        size_t chunkedEnd(size_t pos) const
+        {
+            while (true)
+            {
+                const auto lineEnd = buffer_.find("\r\n", pos);
+                if (lineEnd == std::string::npos)
+                    return std::string::npos;
+
+                const size_t size = std::strtoul(buffer_.c_str() + pos, nullptr, 16);
+                if (size == 0)
+                {
+                    if (buffer_.size() < lineEnd + 4)
+                        return std::string::npos;
+                    return lineEnd + 4;
+                }
+
+                pos = lineEnd + 2 + size + 2;
+                if (pos > buffer_.size())
+                    return std::string::npos;
+            }
+        }
+
+        std::string buffer_;
+    };
+
+    class Connection
+    {
+    public:
+        Connection() = default;
+
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+
+        ~Connection() { close(); }
+
+        bool open(const addrinfo* address, void* tls)
+        {
+            close();
+
+            fd_ = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (fd_ == -1)
+                return false;
+            if (::connect(fd_, address->ai_addr, address->ai_addrlen) == -1)
+            {
+                close();
+                return false;
+            }
+
+            int one = 1;
+            ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+#ifdef PISTACHE_USE_SSL
+            if (tls != nullptr)
+            {
+                ssl_ = SSL_new(static_cast<SSL_CTX*>(tls));
+                SSL_set_fd(ssl_, fd_);
+                if (SSL_connect(ssl_) != 1)
+                {
+                    close();
+                    return false;
+                }
+            }
+#else
+            (void)tls;
+#endif
+            return true;
+        }
+
+        void close()
+        {
+#ifdef PISTACHE_USE_SSL
+            if (ssl_ != nullptr)
+            {
+                SSL_free(ssl_);
+                ssl_ = nullptr;
+            }
+#endif
+            if (fd_ != -1)
+            {
+                ::close(fd_);
+                fd_ = -1;
+            }
+        }
+
+        bool send(const std::string& data)
+        {
+            size_t sent = 0;
+            while (sent < data.size())
+            {
+                ssize_t bytes;
+#ifdef PISTACHE_USE_SSL
+                if (ssl_ != nullptr)
+                    bytes = SSL_write(ssl_, data.data() + sent, static_cast<int>(data.size() - sent));
+                else
+#endif
+                    bytes = ::send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+                if (bytes <= 0)
+                    return false;
+                sent += static_cast<size_t>(bytes);
+            }
+            return true;
+        }
+
+        // Whether bytes can be read before the timeout
+        bool wait(std::chrono::milliseconds timeout)
+        {
+#ifdef PISTACHE_USE_SSL
+            if (ssl_ != nullptr && SSL_pending(ssl_) > 0)
+                return true;
+#endif
+            pollfd pfd { fd_, POLLIN, 0 };
+            return ::poll(&pfd, 1, static_cast<int>(timeout.count())) > 0;
+        }
+
+        ssize_t receive(char* buffer, size_t size)
+        {
+#ifdef PISTACHE_USE_SSL
+            if (ssl_ != nullptr)
+                return SSL_read(ssl_, buffer, static_cast<int>(size));
+#endif
+            return ::recv(fd_, buffer, size, 0);
+        }
+
+    private:
+        int fd_ = -1;
+#ifdef PISTACHE_USE_SSL
+        SSL* ssl_ = nullptr;
+#endif
+    };
+
+    struct Run
+    {
+        const addrinfo* address;
+        void* tls;
+        std::string request;
+        size_t connections;
+        size_t depth;
+        double rate;
+        Clock::time_point start;
+        Clock::time_point measuredFrom;
+        Clock::time_point end;
+    };
+
+    struct ConnectionResult
+    {
+        Rest::LatencyHistogram latency;
+        uint64_t errors = 0;
+    };
+
+    void load(const Run& run, ConnectionResult& result)
+    {
+        Connection connection;
+        ResponseReader reader;
+        // When each request in flight was due, or sent
+        std::deque<Clock::time_point> inFlight;
+
+        const bool scheduled = run.rate > 0;
+        const auto interval  = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(scheduled ? static_cast<double>(run.connections) / run.rate : 0));
+        auto next = run.start;
+
+        bool connected = connection.open(run.address, run.tls);
+        std::this_thread::sleep_until(run.start);
+
+        char buffer[16384];
+        std::string batch;
+        while (Clock::now() < run.end)
+        {
+            if (!connected)
+            {
+                ++result.errors;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                connected = connection.open(run.address, run.tls);
+                continue;
+            }
+
+            auto now = Clock::now();
+            batch.clear();
+            while (inFlight.size() < run.depth && (!scheduled || next <= now))
+            {
+                batch += run.request;
+                inFlight.push_back(scheduled ? next : now);
+                next += interval;
+            }
+
+            if (!batch.empty() && !connection.send(batch))
+            {
+                result.errors += inFlight.size();
+                inFlight.clear();
+                reader.clear();
+                connected = false;
+                continue;
+            }
+
+            // Until the next request is due, when there is room for it
+            auto timeout = std::chrono::milliseconds(100);
+            if (scheduled && inFlight.size() < run.depth)
+            {
+                const auto untilNext = std::chrono::duration_cast<std::chrono::milliseconds>(next - Clock::now());
+                timeout              = std::clamp(untilNext, std::chrono::milliseconds(0), timeout);
+            }
+            if (!connection.wait(timeout))
+                continue;
+
+            const auto bytes = connection.receive(buffer, sizeof(buffer));
+            now              = Clock::now();
+            const bool valid = bytes > 0 && reader.feed(buffer, static_cast<size_t>(bytes), [&](int status) {
+                if (inFlight.empty())
+                    return;
+                const auto since = inFlight.front();
+                inFlight.pop_front();
+                if (since < run.measuredFrom)
+                    return;
+
+                if (status < 200 || status >= 400)
+                    ++result.errors;
+                else
+                    result.latency.record(std::chrono::duration_cast<std::chrono::microseconds>(now - since));
+            });
+
+            if (!valid)
+            {
+                result.errors += inFlight.size();
+                inFlight.clear();
+                reader.clear();
+                connected = connection.open(run.address, run.tls);
+            }
+        }
+    }
+
+    void report(const Options& options, size_t workers, const Run& run,
+                const std::vector<std::unique_ptr<ConnectionResult>>& results)
+    {
+        Rest::LatencyHistogram::Snapshot latency;
+        uint64_t errors = 0;
+        for (const auto& result : results)
+        {
+            result->latency.addTo(latency);
+            errors += result->errors;
+        }
+
+        const auto seconds = std::chrono::duration<double>(run.end - run.measuredFrom).count();
+        std::printf("%-7s %7zu %11zu %8zu %4s %12.0f %8llu %8lld %8lld %8lld %8lld %8llu\n",
+                    options.target.empty() ? options.server.c_str() : "target", workers, run.connections, run.depth,
+                    options.tls ? "on" : "off", static_cast<double>(latency.count) / seconds,
+                    static_cast<unsigned long long>(errors),
+                    static_cast<long long>(latency.quantile(0.5).count()),
+                    static_cast<long long>(latency.quantile(0.9).count()),
+                    static_cast<long long>(latency.quantile(0.99).count()),
+                    static_cast<long long>(latency.quantile(0.999).count()),
+                    static_cast<unsigned long long>(latency.max));
+        std::fflush(stdout);
+    }
+
+    struct AddressInfo
+    {
+        explicit AddressInfo(const std::string& target)
+        {
+            const auto colon = target.rfind(':');
+            if (colon == std::string::npos)
+                throw std::invalid_argument("The target is host:port");
+
+            addrinfo hints {};
+            hints.ai_family   = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            const int error   = getaddrinfo(target.substr(0, colon).c_str(),
+                                            target.substr(colon + 1).c_str(), &hints, &info);
+            if (error != 0)
+                throw std::runtime_error(std::string("Could not resolve the target: ") + gai_strerror(error));
+        }
+
+        ~AddressInfo() { freeaddrinfo(info); }
+
+        AddressInfo(const AddressInfo&) = delete;
+        AddressInfo& operator=(const AddressInfo&) = delete;
+
+        addrinfo* info = nullptr;
+    };
+
+    void loadTarget(const Options& options, const std::string& target, size_t workers, void* tls)
+    {
+        const AddressInfo address(target);
+        const auto path = options.path.empty() ? ReferenceServer::defaultPath(options) : options.path;
+        const auto host = target.substr(0, target.rfind(':'));
+
+        for (auto connections : options.connections)
+        {
+            for (auto depth : options.pipeline)
+            {
+                Run run;
+                run.address      = address.info;
+                run.tls          = tls;
+                run.request      = "GET " + path + " HTTP/1.1\r\nHost: " + host + "\r\n\r\n";
+                run.connections  = connections;
+                run.depth        = depth;
+                run.rate         = options.rate;
+                run.start        = Clock::now() + std::chrono::milliseconds(100);
+                run.measuredFrom = run.start + options.warmup;
+                run.end          = run.measuredFrom + options.duration;
+
+                std::vector<std::unique_ptr<ConnectionResult>> results;
+                std::vector<std::thread> threads;
+                for (size_t i = 0; i < connections; ++i)
+                {
+                    results.push_back(std::make_unique<ConnectionResult>());
+                    threads.emplace_back(load, std::cref(run), std::ref(*results.back()));
+                }
+                for (auto& thread : threads)
+                    thread.join();
+
+                report(options, workers, run, results);
+            }
+        }
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        usage(argv[0]);
+        return 1;
+    }
+
+    // A connection closed by the server is counted, not fatal
+    ::signal(SIGPIPE, SIG_IGN);
+
+    void* tls = nullptr;
+#ifdef PISTACHE_USE_SSL
+    std::unique_ptr<SSL_CTX, decltype(&SSL_CTX_free)> context(nullptr, SSL_CTX_free);
+    if (options.tls)
+    {
+        context.reset(SSL_CTX_new(TLS_client_method()));
+        SSL_CTX_set_verify(context.get(), SSL_VERIFY_NONE, nullptr);
+        tls = context.get();
+    }
+#else
+    if (options.tls)
+    {
+        std::cerr << "TLS needs pistache to be compiled with PISTACHE_USE_SSL\n";
+        return 1;
+    }
+#endif
+
+    std::printf("%-7s %7s %11s %8s %4s %12s %8s %8s %8s %8s %8s %8s\n", "server", "workers",
+                "connections", "pipeline", "tls", "req/s", "errors", "p50(us)", "p90(us)",
+                "p99(us)", "p99.9(us)", "max(us)");
+
+    try
+    {
+        if (!options.target.empty())
+        {
+            loadTarget(options, options.target, 0, tls);
+            return 0;
+        }
+
+        for (auto workers : options.workers)
+        {
+            ReferenceServer server(options, workers);
+            loadTarget(options, "127.0.0.1:" + std::to_string(server.port()), workers, tls);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
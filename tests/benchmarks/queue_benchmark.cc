@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* queue_benchmark.cc
+
+   Pushes and pops of the queues of the mailbox, from contending threads
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <pistache/mailbox.h>
+
+#include <cstdint>
+
+using namespace Pistache;
+
+namespace
+{
+    Queue<uint64_t> queue;
+    MPMCQueue<uint64_t, 1024> mpmcQueue;
+
+    // Every thread pushes, the first one also pops, the queue having a
+    // single consumer
+    void BM_QueuePushPop(benchmark::State& state)
+    {
+        uint64_t value = 0;
+        for (auto _ : state)
+        {
+            queue.push(value++);
+            if (state.thread_index() == 0)
+            {
+                while (auto entry = queue.popSafe())
+                    benchmark::DoNotOptimize(*entry);
+            }
+        }
+        state.SetItemsProcessed(state.iterations());
+
+        if (state.thread_index() == 0)
+        {
+            // The pushes of the other threads that came last
+            while (queue.popSafe())
+                ;
+        }
+    }
+
+    // Every thread pushes and pops
+    void BM_MPMCQueuePushPop(benchmark::State& state)
+    {
+        uint64_t value = 0;
+        for (auto _ : state)
+        {
+            while (!mpmcQueue.enqueue(value))
+                ;
+            while (!mpmcQueue.dequeue(value))
+                ;
+            benchmark::DoNotOptimize(value);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+} // namespace
+
+BENCHMARK(BM_QueuePushPop)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_MPMCQueuePushPop)->ThreadRange(1, 8)->UseRealTime();
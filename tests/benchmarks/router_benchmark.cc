@@ -0,0 +1,93 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* router_benchmark.cc
+
+   Routing of requests through routers of 10, 100 and 2,000 routes
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <pistache/http.h>
+#include <pistache/router.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Pistache;
+
+namespace
+{
+    // A mix of fixed and parametric routes, as an API would have them
+    std::string resource(size_t i)
+    {
+        const auto name = "/api/v1/resource" + std::to_string(i / 4);
+        switch (i % 4)
+        {
+        case 0:
+            return name;
+        case 1:
+            return name + "/:id";
+        case 2:
+            return name + "/:id/children";
+        default:
+            return name + "/:id/children/:child";
+        }
+    }
+
+    Http::Request request(size_t i)
+    {
+        auto path = resource(i);
+        for (auto pos = path.find(':'); pos != std::string::npos; pos = path.find(':'))
+        {
+            const auto end = path.find('/', pos);
+            path.replace(pos, end == std::string::npos ? std::string::npos : end - pos, "1234");
+        }
+
+        const auto data = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        Http::Private::ParserImpl<Http::Request> parser(Const::DefaultMaxRequestSize);
+        parser.feed(data.data(), data.size());
+        parser.parse();
+        return parser.request;
+    }
+
+    void BM_RouterRoute(benchmark::State& state)
+    {
+        const auto routes = static_cast<size_t>(state.range(0));
+
+        auto router = std::make_shared<Rest::Router>();
+        for (size_t i = 0; i < routes; ++i)
+        {
+            router->get(resource(i), [](const Rest::Request& request, Http::ResponseWriter) {
+                benchmark::DoNotOptimize(request.resource().data());
+                return Rest::Route::Result::Ok;
+            });
+        }
+        if (state.range(1) != 0)
+            router->freeze();
+
+        // Requests spread over the whole table
+        std::vector<Http::Request> requests;
+        for (size_t i = 0; i < 64; ++i)
+            requests.push_back(request(i * routes / 64));
+
+        auto handler = router->handler();
+        size_t next  = 0;
+        for (auto _ : state)
+        {
+            Http::ResponseWriter response(Http::Version::Http11, nullptr, handler.get(), {});
+            if (router->route(requests[next], std::move(response)) != Rest::Route::Status::Match)
+            {
+                state.SkipWithError("The request was not routed");
+                break;
+            }
+            next = (next + 1) % requests.size();
+        }
+    }
+} // namespace
+
+BENCHMARK(BM_RouterRoute)->ArgsProduct({ { 10, 100, 2000 }, { 0, 1 } })->ArgNames({ "routes", "frozen" });
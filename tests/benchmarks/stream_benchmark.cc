@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* stream_benchmark.cc
+
+   Writes into a DynamicStreamBuf, as a response is serialized
+*/
+
+#include <benchmark/benchmark.h>
+
+#include <pistache/stream.h>
+
+#include <ostream>
+#include <string>
+
+using namespace Pistache;
+
+namespace
+{
+    // Writes of a given size until about 64 KiB are written, from a buffer
+    // of the default size of a response
+    void BM_DynamicStreamBufWrite(benchmark::State& state)
+    {
+        const auto size    = static_cast<size_t>(state.range(0));
+        const size_t count = 65536 / size;
+        const std::string chunk(size, 'x');
+
+        for (auto _ : state)
+        {
+            DynamicStreamBuf buf(512, Const::MaxBuffer * 64);
+            for (size_t i = 0; i < count; ++i)
+                buf.sputn(chunk.data(), static_cast<std::streamsize>(size));
+            benchmark::DoNotOptimize(buf.buffer().size());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count * size));
+    }
+
+    // A status line and headers through an ostream, into a buffer cleared
+    // from one response to the next
+    void BM_DynamicStreamBufHeaders(benchmark::State& state)
+    {
+        DynamicStreamBuf buf(512, Const::MaxBuffer);
+        for (auto _ : state)
+        {
+            buf.clear();
+            std::ostream os(&buf);
+            os << "HTTP/1.1 " << 200 << ' ' << "OK" << "\r\n"
+               << "Content-Type: " << "application/json" << "\r\n"
+               << "Content-Length: " << 1234 << "\r\n"
+               << "Date: " << "Thu, 15 Oct 2026 12:00:00 GMT" << "\r\n"
+               << "\r\n";
+            benchmark::DoNotOptimize(buf.buffer().size());
+        }
+    }
+} // namespace
+
+BENCHMARK(BM_DynamicStreamBufWrite)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK(BM_DynamicStreamBufHeaders);
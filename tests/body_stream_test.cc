@@ -0,0 +1,514 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+#include <pistache/router.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tcp_client.h"
+
+using namespace Pistache;
+
+namespace
+{
+    // What the readers of a server received, shared with the test
+    struct Recorder
+    {
+        size_t size() const
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return data.size();
+        }
+
+        mutable std::mutex lock;
+        std::string data;
+        bool ended = false;
+        std::string error;
+
+        // Pauses the connection on the first bytes
+        bool pause = false;
+        Http::BodyFlow flow;
+    };
+
+    class RecordingReader : public Http::BodyReader
+    {
+    public:
+        RecordingReader(std::shared_ptr<Recorder> recorder, Http::BodyFlow flow)
+            : recorder_(std::move(recorder))
+            , flow_(std::move(flow))
+        { }
+
+        void onData(std::string_view data) override
+        {
+            std::lock_guard<std::mutex> guard(recorder_->lock);
+            if (recorder_->pause && recorder_->data.empty())
+            {
+                recorder_->flow = flow_;
+                flow_.pause();
+            }
+            recorder_->data.append(data);
+        }
+
+        void onEnd() override
+        {
+            std::lock_guard<std::mutex> guard(recorder_->lock);
+            recorder_->ended = true;
+        }
+
+        void onError(const std::string& reason) override
+        {
+            std::lock_guard<std::mutex> guard(recorder_->lock);
+            recorder_->error = reason;
+        }
+
+    private:
+        std::shared_ptr<Recorder> recorder_;
+        Http::BodyFlow flow_;
+    };
+
+    // Streams the bodies, except the ones sent to /buffered
+    class StreamingHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(StreamingHandler)
+
+        explicit StreamingHandler(std::shared_ptr<Recorder> recorder)
+            : recorder_(std::move(recorder))
+        { }
+
+        std::shared_ptr<Http::BodyReader> onBodyStart(const Http::Request& request,
+                                                      Http::BodyFlow flow) override
+        {
+            if (request.resource() == "/buffered")
+                return nullptr;
+            return std::make_shared<RecordingReader>(recorder_, std::move(flow));
+        }
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter response) override
+        {
+            response.send(Http::Code::Ok,
+                          "streamed " + std::to_string(recorder_->size()) + " buffered "
+                              + std::to_string(request.body().size()));
+        }
+
+    private:
+        std::shared_ptr<Recorder> recorder_;
+    };
+
+    // Answers with where the body was kept, and a digest of it
+    class SpoolHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(SpoolHandler)
+
+        explicit SpoolHandler(std::shared_ptr<std::string> lastPath)
+            : lastPath_(std::move(lastPath))
+        { }
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter response) override
+        {
+            const auto& file = request.bodyFile();
+            if (!file)
+            {
+                response.send(Http::Code::Ok, "memory " + std::to_string(request.body().size()));
+                return;
+            }
+
+            std::string content(file->size(), '\0');
+            EXPECT_EQ(::pread(file->fd(), content.data(), content.size(), 0),
+                      static_cast<ssize_t>(content.size()));
+            *lastPath_ = file->path();
+            if (request.resource() == "/keep")
+            {
+                file->keep(file->path() + ".kept");
+                *lastPath_ = file->path();
+            }
+
+            response.send(Http::Code::Ok, "file " + std::to_string(file->size()) + " "
+                                              + std::to_string(std::hash<std::string>()(content))
+                                              + " memory " + std::to_string(request.body().size()));
+        }
+
+    private:
+        std::shared_ptr<std::string> lastPath_;
+    };
+
+    bool exists(const std::string& path)
+    {
+        struct stat st;
+        return ::stat(path.c_str(), &st) == 0;
+    }
+
+    bool waitFor(const std::function<bool()>& condition)
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            if (condition())
+                return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return condition();
+    }
+
+    // Wants the body of authorized requests only
+    class ContinueHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(ContinueHandler)
+
+        bool onExpectContinue(const Http::Request& request, Http::ResponseWriter& response) override
+        {
+            if (request.headers().tryGetRaw("Authorization"))
+                return true;
+            response.send(Http::Code::Unauthorized, "no credentials");
+            return false;
+        }
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter response) override
+        {
+            response.send(Http::Code::Ok, "got " + request.body());
+        }
+    };
+
+    struct Server
+    {
+        explicit Server(const std::shared_ptr<Http::Handler>& handler,
+                        Http::Endpoint::Options options = Http::Endpoint::options())
+            : endpoint(Address(IP::loopback(), Port(0)))
+        {
+            endpoint.init(options.threads(1).flags(Tcp::Options::ReuseAddr));
+            endpoint.setHandler(handler);
+            endpoint.serveThreaded();
+        }
+
+        ~Server() { endpoint.shutdown(); }
+
+        Address address() const { return Address(IP::loopback(), endpoint.getPort()); }
+
+        Http::Endpoint endpoint;
+    };
+
+    // Reads until the response contains the text
+    std::string receiveUntil(TcpClient& client, const std::string& text)
+    {
+        std::string response;
+        char buffer[1024];
+        while (response.find(text) == std::string::npos)
+        {
+            size_t bytes = 0;
+            if (!client.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                break;
+            response.append(buffer, bytes);
+        }
+        return response;
+    }
+
+    std::string pattern(size_t size)
+    {
+        std::string data(size, '\0');
+        for (size_t i = 0; i < size; ++i)
+            data[i] = static_cast<char>('a' + i % 26);
+        return data;
+    }
+} // namespace
+
+TEST(body_stream_test, content_length_body_larger_than_request_limit)
+{
+    auto recorder = std::make_shared<Recorder>();
+    Server server(Http::make_handler<StreamingHandler>(recorder));
+
+    // Far past the 4096 bytes a buffered request may hold
+    const auto body = pattern(1024 * 1024);
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(server.address()));
+    ASSERT_TRUE(client.send("POST /upload HTTP/1.1\r\nHost: localhost\r\nContent-Length: "
+                            + std::to_string(body.size()) + "\r\n\r\n" + body));
+
+    const auto response = receiveUntil(client, "buffered 0");
+    EXPECT_NE(response.find("HTTP/1.1 200 OK"), std::string::npos) << response;
+    EXPECT_NE(response.find("streamed 1048576 buffered 0"), std::string::npos) << response;
+
+    std::lock_guard<std::mutex> guard(recorder->lock);
+    EXPECT_TRUE(recorder->ended);
+    EXPECT_EQ(recorder->data, body);
+}
+
+TEST(body_stream_test, chunked_body_and_pipelined_request)
+{
+    auto recorder = std::make_shared<Recorder>();
+    Server server(Http::make_handler<StreamingHandler>(recorder));
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(server.address()));
+    ASSERT_TRUE(client.send("POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+                            "Transfer-Encoding: chunked\r\n\r\n"
+                            "5\r\nhello\r\n"
+                            "1;name=value\r\n \r\n"));
+    // The rest of the body arrives later, with the next request behind it
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(client.send("5\r\nworld\r\n0\r\nTrailer: x\r\n\r\n"
+                            "POST /buffered HTTP/1.1\r\nHost: localhost\r\n"
+                            "Content-Length: 3\r\n\r\nabc"));
+
+    const auto response = receiveUntil(client, "buffered 3");
+    EXPECT_NE(response.find("streamed 11 buffered 0"), std::string::npos) << response;
+    EXPECT_NE(response.find("streamed 11 buffered 3"), std::string::npos) << response;
+
+    std::lock_guard<std::mutex> guard(recorder->lock);
+    EXPECT_TRUE(recorder->ended);
+    EXPECT_EQ(recorder->data, "hello world");
+}
+
+TEST(body_stream_test, malformed_chunk_fails_the_reader)
+{
+    auto recorder = std::make_shared<Recorder>();
+    Server server(Http::make_handler<StreamingHandler>(recorder));
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(server.address()));
+    ASSERT_TRUE(client.send("POST /upload HTTP/1.1\r\nHost: localhost\r\n"
+                            "Transfer-Encoding: chunked\r\n\r\n"
+                            "3\r\nabc\r\nzz\r\n"));
+
+    const auto response = receiveUntil(client, "\r\n\r\n");
+    EXPECT_NE(response.find("HTTP/1.1 400 Bad Request"), std::string::npos) << response;
+
+    std::lock_guard<std::mutex> guard(recorder->lock);
+    EXPECT_FALSE(recorder->ended);
+    EXPECT_EQ(recorder->error, "Invalid chunk size");
+}
+
+TEST(body_stream_test, paused_body_stops_reading_the_connection)
+{
+    auto recorder   = std::make_shared<Recorder>();
+    recorder->pause = true;
+    Server server(Http::make_handler<StreamingHandler>(recorder));
+
+    // More than the socket buffers hold, the client blocks while paused
+    const auto body = pattern(32 * 1024 * 1024);
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(server.address()));
+    std::thread sender([&] {
+        client.send("PUT /upload HTTP/1.1\r\nHost: localhost\r\nContent-Length: "
+                    + std::to_string(body.size()) + "\r\n\r\n" + body);
+    });
+
+    size_t paused = 0;
+    for (int i = 0; i < 200 && paused == 0; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        paused = recorder->size();
+    }
+    ASSERT_GT(paused, 0u);
+
+    // Nothing more is read until the reader resumes
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(recorder->size(), paused);
+    EXPECT_LT(paused, body.size());
+
+    Http::BodyFlow flow;
+    {
+        std::lock_guard<std::mutex> guard(recorder->lock);
+        flow = recorder->flow;
+    }
+    flow.resume();
+
+    const auto response = receiveUntil(client, "buffered 0");
+    sender.join();
+    EXPECT_NE(response.find("streamed " + std::to_string(body.size()) + " buffered 0"),
+              std::string::npos)
+        << response;
+}
+
+TEST(body_stream_test, router_streams_the_routes_with_a_body_handler)
+{
+    auto recorder = std::make_shared<Recorder>();
+
+    Rest::Router router;
+    router.addRoute(
+        Http::Method::Post, "/files/:name",
+        [recorder](const Rest::Request& request, Http::ResponseWriter response) {
+            response.send(Http::Code::Ok, request.param(":name").as<std::string>() + " "
+                                              + std::to_string(recorder->size()) + " "
+                                              + std::to_string(request.body().size()));
+            return Rest::Route::Result::Ok;
+        },
+        [recorder](const Rest::Request& request, Http::BodyFlow flow) {
+            EXPECT_EQ(request.param(":name").as<std::string>(), "report");
+            return std::make_shared<RecordingReader>(recorder, std::move(flow));
+        });
+    router.addRoute(Http::Method::Post, "/echo",
+                    [](const Rest::Request& request, Http::ResponseWriter response) {
+                        response.send(Http::Code::Ok, request.body());
+                        return Rest::Route::Result::Ok;
+                    });
+
+    Server server(router.handler());
+
+    const auto body = pattern(64 * 1024);
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(server.address()));
+    ASSERT_TRUE(client.send("POST /files/report HTTP/1.1\r\nHost: localhost\r\nContent-Length: "
+                            + std::to_string(body.size()) + "\r\n\r\n" + body
+                            + "POST /echo HTTP/1.1\r\nHost: localhost\r\n"
+                              "Content-Length: 5\r\n\r\nhello"));
+
+    const auto response = receiveUntil(client, "hello");
+    EXPECT_NE(response.find("report 65536 0"), std::string::npos) << response;
+    EXPECT_NE(response.find("\r\n\r\nhello"), std::string::npos) << response;
+}
+
+TEST(body_stream_test, large_bodies_are_spooled_to_files)
+{
+    char directory[] = "/tmp/pistache-spool-XXXXXX";
+    ASSERT_NE(::mkdtemp(directory), nullptr);
+
+    auto lastPath = std::make_shared<std::string>();
+    Server server(Http::make_handler<SpoolHandler>(lastPath),
+                  Http::Endpoint::options().bodySpool(1024, directory));
+
+    const auto body  = pattern(4 * 1024 * 1024);
+    const auto small = pattern(100);
+    const auto hash  = std::to_string(std::hash<std::string>()(body));
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(server.address()));
+    // Spliced, with a small request pipelined behind it
+    ASSERT_TRUE(client.send("POST /upload HTTP/1.1\r\nHost: localhost\r\nContent-Length: "
+                            + std::to_string(body.size()) + "\r\n\r\n" + body
+                            + "POST /small HTTP/1.1\r\nHost: localhost\r\nContent-Length: 100\r\n\r\n"
+                            + small));
+
+    auto response = receiveUntil(client, "memory 100");
+    EXPECT_NE(response.find("file 4194304 " + hash + " memory 0"), std::string::npos) << response;
+    EXPECT_NE(response.find("\r\n\r\nmemory 100"), std::string::npos) << response;
+
+    // Gone along with the request
+    const auto spliced = *lastPath;
+    EXPECT_EQ(spliced.rfind(directory, 0), 0u) << spliced;
+    EXPECT_TRUE(waitFor([&] { return !exists(spliced); }));
+
+    // Chunked bodies go through the writer of the handler
+    const std::string chunked = "4\r\nwiki\r\n5\r\npedia\r\n0\r\n\r\n";
+    ASSERT_TRUE(client.send("POST /keep HTTP/1.1\r\nHost: localhost\r\n"
+                            "Transfer-Encoding: chunked\r\n\r\n"
+                            + chunked));
+    response = receiveUntil(client, "memory 0");
+    EXPECT_NE(response.find("file 9 " + std::to_string(std::hash<std::string>()("wikipedia"))),
+              std::string::npos)
+        << response;
+
+    const auto kept = *lastPath;
+    EXPECT_TRUE(exists(kept)) << kept;
+    ::unlink(kept.c_str());
+    ::rmdir(directory);
+}
+
+TEST(body_stream_test, expect_continue_before_the_body)
+{
+    Server server(Http::make_handler<ContinueHandler>());
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(server.address()));
+    ASSERT_TRUE(client.send("PUT /upload HTTP/1.1\r\nHost: localhost\r\nAuthorization: x\r\n"
+                            "Expect: 100-continue\r\nContent-Length: 5\r\n\r\n"));
+    auto response = receiveUntil(client, "\r\n\r\n");
+    EXPECT_EQ(response, "HTTP/1.1 100 Continue\r\n\r\n");
+
+    ASSERT_TRUE(client.send("hello"));
+    response = receiveUntil(client, "got hello");
+    EXPECT_NE(response.find("HTTP/1.1 200 OK"), std::string::npos) << response;
+
+    // Sent along with the headers, the interim response is left out
+    ASSERT_TRUE(client.send("PUT /upload HTTP/1.1\r\nHost: localhost\r\nAuthorization: x\r\n"
+                            "Expect: 100-continue\r\nContent-Length: 5\r\n\r\nagain"));
+    response = receiveUntil(client, "got again");
+    EXPECT_EQ(response.find("100 Continue"), std::string::npos) << response;
+}
+
+TEST(body_stream_test, expect_continue_rejected_after_the_headers)
+{
+    Server server(Http::make_handler<ContinueHandler>());
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(server.address()));
+    ASSERT_TRUE(client.send("PUT /upload HTTP/1.1\r\nHost: localhost\r\n"
+                            "Expect: 100-continue\r\nContent-Length: 1000000\r\n\r\n"));
+    auto response = receiveUntil(client, "no credentials");
+    EXPECT_EQ(response.rfind("HTTP/1.1 401 Unauthorized", 0), 0u) << response;
+    EXPECT_NE(response.find("Connection: Close"), std::string::npos) << response;
+
+    // Whatever follows is dropped, it could be the body as well as a request
+    ASSERT_TRUE(client.send("GET / HTTP/1.1\r\nHost: localhost\r\nAuthorization: x\r\n\r\n"));
+    char buffer[64];
+    size_t bytes = 0;
+    client.receive(buffer, sizeof(buffer), &bytes, std::chrono::milliseconds(200));
+    EXPECT_EQ(bytes, 0u);
+
+    // Beyond the maximum request size, the body would not fit anyway
+    TcpClient large;
+    ASSERT_TRUE(large.connect(server.address()));
+    ASSERT_TRUE(large.send("PUT /upload HTTP/1.1\r\nHost: localhost\r\nAuthorization: x\r\n"
+                           "Expect: 100-continue\r\nContent-Length: 1000000\r\n\r\n"));
+    response = receiveUntil(large, "buffer size");
+    EXPECT_EQ(response.rfind("HTTP/1.1 413 Request Entity Too Large", 0), 0u) << response;
+}
+
+TEST(body_stream_test, router_rejects_expect_continue_requests)
+{
+    Rest::Router router;
+    router.addMiddleware([](Http::Request& request, Http::ResponseWriter& response) {
+        if (request.headers().tryGetRaw("Authorization"))
+            return true;
+        response.send(Http::Code::Forbidden, "denied");
+        return false;
+    });
+    router.addRoute(Http::Method::Put, "/files/:name",
+                    [](const Rest::Request& request, Http::ResponseWriter response) {
+                        response.send(Http::Code::Ok, request.body());
+                        return Rest::Route::Result::Ok;
+                    });
+
+    Server server(router.handler());
+
+    const auto send = [&](const std::string& head) {
+        TcpClient client;
+        EXPECT_TRUE(client.connect(server.address()));
+        EXPECT_TRUE(client.send(head + "Host: localhost\r\nExpect: 100-continue\r\n"
+                                       "Content-Length: 5\r\n\r\n"));
+        auto response = receiveUntil(client, "\r\n\r\n");
+        if (response == "HTTP/1.1 100 Continue\r\n\r\n")
+        {
+            EXPECT_TRUE(client.send("hello"));
+            response = receiveUntil(client, "hello");
+        }
+        return response;
+    };
+
+    EXPECT_NE(send("PUT /files/a HTTP/1.1\r\nAuthorization: x\r\n").find("200 OK"),
+              std::string::npos);
+    EXPECT_NE(send("PUT /files/a HTTP/1.1\r\n").find("403 Forbidden"), std::string::npos);
+    EXPECT_NE(send("PUT /other HTTP/1.1\r\nAuthorization: x\r\n").find("404 Not Found"),
+              std::string::npos);
+    EXPECT_NE(send("POST /files/a HTTP/1.1\r\nAuthorization: x\r\n").find("405 Method Not Allowed"),
+              std::string::npos);
+}
@@ -0,0 +1,292 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/compression.h>
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+
+#include <curl/curl.h>
+
+#include <string>
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+#include <zlib.h>
+#endif
+
+using namespace Pistache;
+using Http::Header::Encoding;
+
+namespace
+{
+#ifdef PISTACHE_USE_CONTENT_ENCODING_BROTLI
+    constexpr bool HasBrotli = true;
+#else
+    constexpr bool HasBrotli = false;
+#endif
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+    std::string inflate(const std::string& data, Encoding encoding)
+    {
+        z_stream stream {};
+        const int windowBits = encoding == Encoding::Gzip ? 15 + 16 : 15;
+        if (inflateInit2(&stream, windowBits) != Z_OK)
+            throw std::runtime_error("inflateInit2");
+
+        stream.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+
+        std::string out;
+        int ret = Z_OK;
+        while (ret == Z_OK)
+        {
+            char buf[4096];
+            stream.next_out  = reinterpret_cast<Bytef*>(buf);
+            stream.avail_out = sizeof(buf);
+            ret              = ::inflate(&stream, Z_NO_FLUSH);
+            out.append(buf, sizeof(buf) - stream.avail_out);
+        }
+        inflateEnd(&stream);
+
+        if (ret != Z_STREAM_END)
+            throw std::runtime_error("Truncated or corrupted stream");
+        return out;
+    }
+#endif
+
+    std::string jsonBody(size_t records)
+    {
+        std::string body = "[";
+        for (size_t i = 0; i < records; ++i)
+        {
+            if (i > 0)
+                body += ",";
+            body += "{\"id\":" + std::to_string(i) + ",\"name\":\"record\",\"active\":true}";
+        }
+        return body + "]";
+    }
+
+    struct CompressingHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(CompressingHandler)
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter writer) override
+        {
+            if (request.resource() == "/small")
+            {
+                writer.send(Http::Code::Ok, "tiny");
+            }
+            else if (request.resource() == "/stream")
+            {
+                auto stream = writer.stream(Http::Code::Ok);
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    const auto part = jsonBody(50);
+                    stream.write(part.data(), static_cast<std::streamsize>(part.size()));
+                    stream.flush();
+                }
+                stream.ends();
+            }
+            else
+            {
+                writer.send(Http::Code::Ok, jsonBody(200));
+            }
+        }
+    };
+
+    struct Reply
+    {
+        std::string body;
+        std::string headers;
+    };
+
+    // Fetches the body as it went on the wire, undecoded
+    Reply fetch(Port port, const std::string& resource, const std::string& acceptEncoding)
+    {
+        Reply reply;
+        auto append = +[](char* ptr, size_t size, size_t nmemb, void* userdata) -> size_t {
+            static_cast<std::string*>(userdata)->append(ptr, size * nmemb);
+            return size * nmemb;
+        };
+
+        CURL* curl = curl_easy_init();
+        const auto url = "http://localhost:" + port.toString() + resource;
+
+        struct curl_slist* headers = nullptr;
+        if (!acceptEncoding.empty())
+            headers = curl_slist_append(headers, ("Accept-Encoding: " + acceptEncoding).c_str());
+
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_HTTP_CONTENT_DECODING, 0L);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, append);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &reply.body);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, append);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &reply.headers);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+
+        const auto res = curl_easy_perform(curl);
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+
+        if (res != CURLE_OK)
+            throw std::runtime_error(curl_easy_strerror(res));
+        return reply;
+    }
+
+    class CompressionServer
+    {
+    public:
+        explicit CompressionServer(bool compression)
+            : endpoint(Address(IP::loopback(), Port(0)))
+        {
+            endpoint.init(Http::Endpoint::options().threads(1).compression(compression));
+            endpoint.setHandler(Http::make_handler<CompressingHandler>());
+            endpoint.serveThreaded();
+        }
+
+        ~CompressionServer() { endpoint.shutdown(); }
+
+        Port port() { return endpoint.getPort(); }
+
+    private:
+        Http::Endpoint endpoint;
+    };
+} // namespace
+
+TEST(compression_test, refused_or_unknown_codings_are_not_picked)
+{
+    ASSERT_EQ(Http::Compression::negotiate(""), Encoding::Identity);
+    ASSERT_EQ(Http::Compression::negotiate("identity"), Encoding::Identity);
+    ASSERT_EQ(Http::Compression::negotiate("compress, unknown"), Encoding::Identity);
+    ASSERT_EQ(Http::Compression::negotiate("gzip;q=0, deflate;q=0, br;q=0"), Encoding::Identity);
+    ASSERT_EQ(Http::Compression::negotiate("*;q=0"), Encoding::Identity);
+
+    ASSERT_FALSE(Http::Compression::isSupported(Encoding::Identity));
+    ASSERT_FALSE(Http::Compression::isSupported(Encoding::Compress));
+    ASSERT_FALSE(Http::Compression::acquire(Encoding::Compress));
+}
+
+TEST(compression_test, negotiates_by_weight_then_preference)
+{
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+    ASSERT_EQ(Http::Compression::negotiate("deflate, gzip"), Encoding::Gzip);
+    ASSERT_EQ(Http::Compression::negotiate("gzip;q=0.5, deflate"), Encoding::Deflate);
+    ASSERT_EQ(Http::Compression::negotiate("GZIP ; Q=0.8, deflate;q=0.2"), Encoding::Gzip);
+    ASSERT_EQ(Http::Compression::negotiate("x-gzip"), Encoding::Gzip);
+    ASSERT_EQ(Http::Compression::negotiate("*;q=0.5, gzip;q=0, br;q=0"), Encoding::Deflate);
+    ASSERT_EQ(Http::Compression::negotiate("gzip, br"), HasBrotli ? Encoding::Br : Encoding::Gzip);
+    ASSERT_EQ(Http::Compression::negotiate("*"), HasBrotli ? Encoding::Br : Encoding::Gzip);
+#else
+    ASSERT_EQ(Http::Compression::negotiate("gzip, deflate"), Encoding::Identity);
+#endif
+
+    ASSERT_EQ(Http::Compression::negotiate("br"), HasBrotli ? Encoding::Br : Encoding::Identity);
+}
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+TEST(compression_test, released_compressors_are_reused)
+{
+    const auto before = Http::Compression::pooled();
+
+    auto compressor  = Http::Compression::acquire(Encoding::Gzip, 6);
+    auto* const addr = compressor.get();
+    ASSERT_NE(addr, nullptr);
+
+    std::string out;
+    compressor->compress("abc", 3, Http::Compression::Compressor::Flush::Finish, out);
+    compressor.reset();
+    ASSERT_EQ(Http::Compression::pooled(), before + 1);
+
+    // Another level needs another compressor
+    auto other = Http::Compression::acquire(Encoding::Gzip, 1);
+    ASSERT_NE(other.get(), addr);
+
+    compressor = Http::Compression::acquire(Encoding::Gzip, 6);
+    ASSERT_EQ(compressor.get(), addr);
+
+    // The state has been reset, a new stream comes out
+    out.clear();
+    compressor->compress("def", 3, Http::Compression::Compressor::Flush::Finish, out);
+    ASSERT_EQ(inflate(out, Encoding::Gzip), "def");
+}
+
+TEST(compression_test, streamed_chunks_decompress_to_the_input)
+{
+    for (auto encoding : { Encoding::Gzip, Encoding::Deflate })
+    {
+        auto compressor = Http::Compression::acquire(encoding);
+        ASSERT_TRUE(compressor);
+
+        std::string input;
+        std::string out;
+        for (size_t i = 0; i < 16; ++i)
+        {
+            const auto part = jsonBody(i * 10);
+            input += part;
+            compressor->compress(part.data(), part.size(), Http::Compression::Compressor::Flush::Sync, out);
+
+            // Everything received so far can be decoded
+            ASSERT_FALSE(out.empty());
+        }
+        compressor->compress(nullptr, 0, Http::Compression::Compressor::Flush::Finish, out);
+
+        ASSERT_EQ(inflate(out, encoding), input);
+        ASSERT_LT(out.size(), input.size() / 4);
+    }
+}
+
+TEST(compression_test, responses_are_compressed_when_accepted)
+{
+    CompressionServer server(true);
+
+    auto reply = fetch(server.port(), "/json", "gzip");
+    ASSERT_NE(reply.headers.find("Content-Encoding: gzip"), std::string::npos) << reply.headers;
+    ASSERT_NE(reply.headers.find("Vary: Accept-Encoding"), std::string::npos) << reply.headers;
+    ASSERT_EQ(inflate(reply.body, Encoding::Gzip), jsonBody(200));
+
+    reply = fetch(server.port(), "/json", "deflate;q=1, gzip;q=0.1");
+    ASSERT_NE(reply.headers.find("Content-Encoding: deflate"), std::string::npos) << reply.headers;
+    ASSERT_EQ(inflate(reply.body, Encoding::Deflate), jsonBody(200));
+
+    // Below the minimum size
+    reply = fetch(server.port(), "/small", "gzip");
+    ASSERT_EQ(reply.headers.find("Content-Encoding"), std::string::npos) << reply.headers;
+    ASSERT_EQ(reply.body, "tiny");
+
+    reply = fetch(server.port(), "/json", "");
+    ASSERT_EQ(reply.headers.find("Content-Encoding"), std::string::npos) << reply.headers;
+    ASSERT_EQ(reply.body, jsonBody(200));
+}
+
+TEST(compression_test, streams_are_compressed_chunk_by_chunk)
+{
+    CompressionServer server(true);
+
+    std::string expected;
+    for (size_t i = 0; i < 8; ++i)
+        expected += jsonBody(50);
+
+    auto reply = fetch(server.port(), "/stream", "gzip");
+    ASSERT_NE(reply.headers.find("Transfer-Encoding: chunked"), std::string::npos) << reply.headers;
+    ASSERT_NE(reply.headers.find("Content-Encoding: gzip"), std::string::npos) << reply.headers;
+    ASSERT_EQ(inflate(reply.body, Encoding::Gzip), expected);
+
+    reply = fetch(server.port(), "/stream", "identity");
+    ASSERT_EQ(reply.headers.find("Content-Encoding"), std::string::npos) << reply.headers;
+    ASSERT_EQ(reply.body, expected);
+}
+#endif /* PISTACHE_USE_CONTENT_ENCODING_DEFLATE */
+
+TEST(compression_test, responses_are_sent_as_is_when_disabled)
+{
+    CompressionServer server(false);
+
+    auto reply = fetch(server.port(), "/json", "gzip, deflate, br");
+    ASSERT_EQ(reply.headers.find("Content-Encoding"), std::string::npos) << reply.headers;
+    ASSERT_EQ(reply.body, jsonBody(200));
+}
@@ -9,6 +9,9 @@
 #include <date/date.h>
 #include <pistache/cookie.h>
 
+#include <optional>
+#include <string_view>
+
 using namespace Pistache;
 using namespace Pistache::Http;
 
@@ -171,6 +174,39 @@ TEST(cookie_test, cookiejar_test)
     ASSERT_THROW(jar.addFromRaw("key4", strlen("key4")), std::runtime_error);
 }
 
+TEST(cookie_test, cookiejar_parses_lazily)
+{
+    CookieJar jar;
+    jar.addFromRaw("a=1; b=2;\tc=x=y", strlen("a=1; b=2;\tc=x=y"));
+    jar.add(Cookie("d", "4"));
+    const std::string second = "e=5";
+    jar.addFromRaw(second.data(), second.size());
+
+    ASSERT_EQ(jar.value("b"), std::optional<std::string_view>("2"));
+    ASSERT_EQ(jar.value("c"), std::optional<std::string_view>("x=y"));
+    ASSERT_EQ(jar.value("d"), std::optional<std::string_view>("4"));
+    ASSERT_EQ(jar.value("e"), std::optional<std::string_view>("5"));
+    ASSERT_FALSE(jar.value("f").has_value());
+    ASSERT_TRUE(jar.has("a"));
+    ASSERT_EQ(jar.get("e").value, "5");
+
+    // Iterating builds every cookie once
+    size_t count = 0;
+    for (const auto& cookie : jar)
+    {
+        ASSERT_EQ(jar.get(cookie.name).value, cookie.value);
+        ++count;
+    }
+    ASSERT_EQ(count, 5u);
+    ASSERT_EQ(jar.value("a"), std::optional<std::string_view>("1"));
+
+    CookieJar copy = jar;
+    copy.removeAllCookies();
+    ASSERT_FALSE(copy.has("a"));
+    ASSERT_TRUE(copy.begin() == copy.end());
+    ASSERT_TRUE(jar.has("a"));
+}
+
 TEST(cookie_test, cookiejar_test_2)
 {
     CookieJar jar;
@@ -0,0 +1,175 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/coroutine.h>
+#include <pistache/endpoint.h>
+#include <pistache/router.h>
+
+#include <httplib.h>
+
+#ifdef PISTACHE_HAS_COROUTINES
+
+#include <chrono>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace Pistache;
+using namespace std::chrono_literals;
+
+namespace
+{
+    Async::Task awaitValue(Async::Promise<int> promise, std::promise<int>& result)
+    {
+        try
+        {
+            result.set_value(co_await promise);
+        }
+        catch (const std::exception&)
+        {
+            result.set_exception(std::current_exception());
+        }
+    }
+
+    Async::Task awaitVoid(Async::Promise<void> promise, std::promise<std::thread::id>& result)
+    {
+        co_await promise;
+        result.set_value(std::this_thread::get_id());
+    }
+
+    class CoroutineEndpoint
+    {
+    public:
+        CoroutineEndpoint()
+            : httpEndpoint(std::make_shared<Http::Endpoint>(Address(IP::loopback(), Port(0))))
+        {
+            httpEndpoint->init(Http::Endpoint::options().threads(1));
+
+            Rest::Routes::Get(router, "/hop", Rest::Routes::bind(&CoroutineEndpoint::hop, this));
+            Rest::Routes::Get(router, "/fail", Rest::Routes::bind(&CoroutineEndpoint::fail, this));
+
+            httpEndpoint->setHandler(router.handler());
+            httpEndpoint->serveThreaded();
+        }
+
+        ~CoroutineEndpoint() { httpEndpoint->shutdown(); }
+
+        Port port() const { return httpEndpoint->getPort(); }
+
+    private:
+        // Resolves the promise from another thread, the handler must still
+        // resume on the thread of the transport
+        Async::Task hop(const Rest::Request& request, Http::ResponseWriter response)
+        {
+            const auto before = std::this_thread::get_id();
+
+            auto value = co_await Async::Promise<std::string>(
+                [](Async::Resolver& resolve, Async::Rejection&) {
+                    std::thread([resolve = std::move(resolve)]() mutable {
+                        std::this_thread::sleep_for(20ms);
+                        resolve(std::string("hopped"));
+                    }).detach();
+                });
+
+            const bool sameThread = std::this_thread::get_id() == before;
+            response.send(Http::Code::Ok,
+                          value + " " + request.resource() + (sameThread ? " same" : " other"));
+        }
+
+        Async::Task fail(const Rest::Request&, Http::ResponseWriter)
+        {
+            co_await Async::Promise<void>::rejected(std::runtime_error("Broken"));
+        }
+
+        std::shared_ptr<Http::Endpoint> httpEndpoint;
+        Rest::Router router;
+    };
+} // namespace
+
+TEST(coroutine_test, resumes_inline_on_a_settled_promise)
+{
+    std::promise<int> result;
+    awaitValue(Async::Promise<int>::resolved(42), result).start();
+
+    auto future = result.get_future();
+    ASSERT_EQ(future.wait_for(0s), std::future_status::ready);
+    ASSERT_EQ(future.get(), 42);
+}
+
+TEST(coroutine_test, rethrows_rejections)
+{
+    std::promise<int> result;
+    awaitValue(Async::Promise<int>::rejected(std::runtime_error("Nope")), result).start();
+
+    ASSERT_THROW(result.get_future().get(), std::runtime_error);
+}
+
+TEST(coroutine_test, resumes_on_the_resolving_thread_without_a_transport)
+{
+    std::optional<Async::Resolver> resolver;
+    Async::Promise<void> promise([&](Async::Resolver& resolve, Async::Rejection&) {
+        resolver.emplace(std::move(resolve));
+    });
+
+    std::promise<std::thread::id> result;
+    awaitVoid(std::move(promise), result).start();
+
+    auto future = result.get_future();
+    ASSERT_EQ(future.wait_for(0s), std::future_status::timeout);
+
+    std::thread::id resolving;
+    std::thread thread([&] {
+        resolving = std::this_thread::get_id();
+        (*resolver)();
+    });
+    thread.join();
+
+    ASSERT_EQ(future.get(), resolving);
+}
+
+TEST(coroutine_test, route_handler_resumes_on_the_transport_thread)
+{
+    CoroutineEndpoint endpoint;
+
+    httplib::Client client("localhost", endpoint.port());
+    client.set_connection_timeout(5s);
+    client.set_read_timeout(5s);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        auto res = client.Get("/hop");
+        ASSERT_TRUE(res);
+        ASSERT_EQ(res->status, 200);
+        ASSERT_EQ(res->body, "hopped /hop same");
+    }
+}
+
+TEST(coroutine_test, escaping_exceptions_are_answered_with_a_500)
+{
+    CoroutineEndpoint endpoint;
+
+    httplib::Client client("localhost", endpoint.port());
+    client.set_connection_timeout(5s);
+    client.set_read_timeout(5s);
+
+    auto res = client.Get("/fail");
+    ASSERT_TRUE(res);
+    ASSERT_EQ(res->status, 500);
+    ASSERT_EQ(res->body, "Broken");
+}
+
+#else
+
+TEST(coroutine_test, coroutines_are_not_supported)
+{
+    GTEST_SKIP() << "The compiler does not support coroutines";
+}
+
+#endif /* PISTACHE_HAS_COROUTINES */
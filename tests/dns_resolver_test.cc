@@ -0,0 +1,152 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+#include <pistache/dns_resolver.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+
+using namespace Pistache;
+using namespace std::chrono_literals;
+
+namespace
+{
+    template <typename T>
+    T waitFor(Async::Promise<T> promise)
+    {
+        std::promise<T> result;
+        promise.then([&](const T& value) { result.set_value(value); },
+                     [&](std::exception_ptr exc) { result.set_exception(exc); });
+
+        auto future = result.get_future();
+        if (future.wait_for(5s) != std::future_status::ready)
+            throw std::runtime_error("Timed out waiting for the resolver");
+        return future.get();
+    }
+} // namespace
+
+TEST(dns_resolver_test, resolves_and_caches)
+{
+    DnsResolver resolver(1, 60s);
+
+    ASSERT_FALSE(resolver.cached("localhost:8080").has_value());
+
+    auto addr = waitFor(resolver.resolve("localhost:8080"));
+    ASSERT_EQ(addr.port(), Port(8080));
+
+    auto cached = resolver.cached("localhost:8080");
+    ASSERT_TRUE(cached.has_value());
+    ASSERT_EQ(cached->host(), addr.host());
+    ASSERT_EQ(resolver.cacheSize(), 1u);
+
+    // Served from the cache, the promise already is resolved
+    bool resolved = false;
+    resolver.resolve("localhost:8080").then([&](const Address&) { resolved = true; },
+                                            Async::NoExcept);
+    ASSERT_TRUE(resolved);
+
+    resolver.clearCache();
+    ASSERT_EQ(resolver.cacheSize(), 0u);
+}
+
+TEST(dns_resolver_test, concurrent_lookups_share_a_result)
+{
+    DnsResolver resolver(2, 60s);
+
+    std::vector<Async::Promise<Address>> promises;
+    for (int i = 0; i < 16; ++i)
+        promises.push_back(resolver.resolve("127.0.0.1:9080"));
+
+    for (auto& promise : promises)
+    {
+        auto addr = waitFor(std::move(promise));
+        ASSERT_EQ(addr.host(), "127.0.0.1");
+        ASSERT_EQ(addr.port(), Port(9080));
+    }
+
+    ASSERT_EQ(resolver.cacheSize(), 1u);
+}
+
+TEST(dns_resolver_test, zero_ttl_disables_the_cache)
+{
+    DnsResolver resolver(1, 0s);
+
+    waitFor(resolver.resolve("127.0.0.1:9080"));
+    ASSERT_EQ(resolver.cacheSize(), 0u);
+}
+
+TEST(dns_resolver_test, failures_are_rejected_and_not_cached)
+{
+    DnsResolver resolver(1, 60s);
+
+    ASSERT_THROW(waitFor(resolver.resolve("host.invalid:80")), Error);
+    ASSERT_EQ(resolver.cacheSize(), 0u);
+}
+
+TEST(dns_resolver_test, resolves_every_address)
+{
+    DnsResolver resolver(1, 60s);
+
+    std::promise<std::vector<Address>> result;
+    resolver.resolveAll("[::1]:9080").then(
+        [&](const std::vector<Address>& addresses) { result.set_value(addresses); },
+        [&](std::exception_ptr exc) { result.set_exception(exc); });
+
+    auto future = result.get_future();
+    ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+    auto addresses = future.get();
+    ASSERT_EQ(addresses.size(), 1u);
+    ASSERT_EQ(addresses[0].family(), AF_INET6);
+    ASSERT_EQ(addresses[0].host(), "::1");
+    ASSERT_EQ(addresses[0].port(), Port(9080));
+
+    // The first address is the one resolve() returns
+    ASSERT_EQ(waitFor(resolver.resolve("[::1]:9080")).host(), "::1");
+}
+
+TEST(dns_resolver_test, interleaves_the_address_families)
+{
+    const auto interleaved = DnsResolver::interleaveFamilies({
+        Address("[::1]:80"),
+        Address("[::2]:80"),
+        Address("[::3]:80"),
+        Address("10.0.0.1:80"),
+        Address("10.0.0.2:80"),
+    });
+
+    std::vector<std::string> hosts;
+    for (const auto& address : interleaved)
+        hosts.push_back(address.host());
+
+    const std::vector<std::string> expected { "::1", "10.0.0.1", "::2", "10.0.0.2", "::3" };
+    ASSERT_EQ(hosts, expected);
+}
+
+TEST(dns_resolver_test, resolves_names_back)
+{
+    DnsResolver resolver(1, 60s);
+
+    ASSERT_FALSE(resolver.cachedName("127.0.0.1").has_value());
+
+    const auto name = waitFor(resolver.resolveName("127.0.0.1"));
+    ASSERT_FALSE(name.empty());
+    ASSERT_EQ(resolver.cachedName("127.0.0.1"), name);
+
+    ASSERT_THROW(waitFor(resolver.resolveName("not-an-address")), std::exception);
+    ASSERT_FALSE(resolver.cachedName("not-an-address").has_value());
+}
+
+TEST(dns_resolver_test, rejects_after_shutdown)
+{
+    DnsResolver resolver(1, 60s);
+    resolver.shutdown();
+
+    ASSERT_THROW(waitFor(resolver.resolve("127.0.0.1:9080")), Error);
+}
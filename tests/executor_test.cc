@@ -0,0 +1,184 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/endpoint.h>
+#include <pistache/executor.h>
+#include <pistache/http.h>
+#include <pistache/router.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "tcp_client.h"
+
+using namespace Pistache;
+
+namespace
+{
+    // Reads until the text shows up, the connection closes or nothing
+    // arrives for the timeout
+    std::string receiveUntil(TcpClient& client, const std::string& text,
+                             std::chrono::milliseconds timeout = std::chrono::seconds(5))
+    {
+        std::string response;
+        char buffer[4096];
+        while (response.find(text) == std::string::npos)
+        {
+            size_t bytes = 0;
+            if (!client.receive(buffer, sizeof(buffer), &bytes, timeout) || bytes == 0)
+                break;
+            response.append(buffer, bytes);
+        }
+        return response;
+    }
+
+    std::string get(const std::string& resource)
+    {
+        return "GET " + resource + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    }
+
+    struct Server
+    {
+        explicit Server(Rest::Router& router)
+            : endpoint(Address(IP::loopback(), Port(0)))
+        {
+            endpoint.init(Http::Endpoint::options().threads(1).flags(Tcp::Options::ReuseAddr));
+            endpoint.setHandler(router.handler());
+            endpoint.serveThreaded();
+        }
+
+        ~Server() { endpoint.shutdown(); }
+
+        bool connect(TcpClient& client)
+        {
+            return client.connect(Address(IP::loopback(), endpoint.getPort()));
+        }
+
+        Http::Endpoint endpoint;
+    };
+} // namespace
+
+TEST(executor_test, runs_every_task)
+{
+    std::atomic<int> ran { 0 };
+    {
+        Executor executor(4);
+        EXPECT_EQ(executor.threads(), 4u);
+
+        for (int i = 0; i < 1000; ++i)
+            executor.submit([&ran] { ++ran; });
+    }
+    EXPECT_EQ(ran.load(), 1000);
+}
+
+TEST(executor_test, idle_threads_steal_queued_tasks)
+{
+    Executor executor(4);
+    std::atomic<int> ran { 0 };
+
+    // Submitted from a thread of the pool, the tasks go to its own queue
+    std::promise<void> done;
+    executor.submit([&] {
+        for (int i = 0; i < 40; ++i)
+            executor.submit([&ran] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                ++ran;
+            });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        done.set_value();
+    });
+    done.get_future().wait();
+
+    executor.shutdown();
+    EXPECT_EQ(ran.load(), 40);
+    EXPECT_GT(executor.stolen(), 0u);
+}
+
+TEST(executor_test, refuses_tasks_once_shut_down)
+{
+    Executor executor(1);
+    executor.shutdown();
+    EXPECT_THROW(executor.submit([] { }), std::runtime_error);
+    EXPECT_THROW(Executor(0), std::invalid_argument);
+}
+
+TEST(executor_test, offloaded_routes_leave_the_worker_responsive)
+{
+    auto executor = std::make_shared<Executor>(2);
+    std::promise<void> release;
+    auto released = release.get_future().share();
+
+    Rest::Router router;
+    router.get("/heavy", Rest::Routes::offload(executor, [released](const Rest::Request&,
+                                                                     Http::ResponseWriter response) {
+                   released.wait();
+                   response.send(Http::Code::Ok, "heavy");
+                   return Rest::Route::Result::Ok;
+               }));
+    router.get("/light", [](const Rest::Request&, Http::ResponseWriter response) {
+        response.send(Http::Code::Ok, "light");
+        return Rest::Route::Result::Ok;
+    });
+
+    Server server(router);
+
+    TcpClient heavy;
+    ASSERT_TRUE(server.connect(heavy));
+    ASSERT_TRUE(heavy.send(get("/heavy")));
+
+    // The single worker thread still serves the other peers
+    TcpClient light;
+    ASSERT_TRUE(server.connect(light));
+    ASSERT_TRUE(light.send(get("/light")));
+    EXPECT_NE(receiveUntil(light, "\r\n\r\nlight").find("200 OK"), std::string::npos);
+
+    release.set_value();
+    EXPECT_NE(receiveUntil(heavy, "\r\n\r\nheavy").find("200 OK"), std::string::npos);
+}
+
+TEST(executor_test, offloaded_responses_keep_the_pipeline_order)
+{
+    auto executor = std::make_shared<Executor>(2);
+
+    Rest::Router router;
+    router.get("/heavy", Rest::Routes::offload(executor, [](const Rest::Request& request,
+                                                             Http::ResponseWriter response) {
+                   std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                   response.send(Http::Code::Ok, "heavy " + request.query().get("n").value_or(""));
+                   return Rest::Route::Result::Ok;
+               }));
+    router.get("/light", [](const Rest::Request&, Http::ResponseWriter response) {
+        response.send(Http::Code::Ok, "light");
+        return Rest::Route::Result::Ok;
+    });
+    router.get("/failing", Rest::Routes::offload(executor, [](const Rest::Request&,
+                                                               Http::ResponseWriter) -> Rest::Route::Result {
+                   throw std::runtime_error("failed");
+               }));
+
+    Server server(router);
+
+    TcpClient client;
+    ASSERT_TRUE(server.connect(client));
+    ASSERT_TRUE(client.send(get("/heavy?n=1") + get("/light") + get("/heavy?n=2") + get("/failing")));
+
+    const auto responses = receiveUntil(client, "failed");
+    const auto first     = responses.find("heavy 1");
+    const auto second    = responses.find("light");
+    const auto third     = responses.find("heavy 2");
+    const auto fourth    = responses.find("500 Internal Server Error");
+    ASSERT_NE(fourth, std::string::npos) << responses;
+    EXPECT_LT(first, second) << responses;
+    EXPECT_LT(second, third) << responses;
+    EXPECT_LT(third, fourth) << responses;
+}
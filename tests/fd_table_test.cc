@@ -0,0 +1,79 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+#include <pistache/fd_table.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Pistache;
+
+TEST(fd_table_test, finds_what_was_inserted)
+{
+    FdTable<std::string> table;
+
+    ASSERT_TRUE(table.empty());
+    ASSERT_EQ(table.find(3), nullptr);
+    ASSERT_EQ(table.find(-1), nullptr);
+
+    ASSERT_TRUE(table.insert(3, "three"));
+    ASSERT_TRUE(table.insert(12, "twelve"));
+    ASSERT_FALSE(table.insert(3, "again"));
+    ASSERT_FALSE(table.insert(-1, "invalid"));
+
+    ASSERT_EQ(table.size(), 2u);
+    ASSERT_TRUE(table.contains(3));
+    ASSERT_FALSE(table.contains(4));
+    ASSERT_EQ(*table.find(3), "three");
+    ASSERT_EQ(*table.find(12), "twelve");
+}
+
+TEST(fd_table_test, a_reused_fd_gets_its_new_value)
+{
+    FdTable<std::shared_ptr<int>> table;
+
+    auto first = std::make_shared<int>(1);
+    table.insert(5, first);
+
+    ASSERT_TRUE(table.erase(5));
+    ASSERT_FALSE(table.erase(5));
+    ASSERT_FALSE(table.contains(5));
+    ASSERT_EQ(first.use_count(), 1);
+
+    table.insert(5, std::make_shared<int>(2));
+    ASSERT_EQ(**table.find(5), 2);
+
+    auto taken = table.take(5);
+    ASSERT_TRUE(taken.has_value());
+    ASSERT_EQ(**taken, 2);
+    ASSERT_FALSE(table.take(5).has_value());
+    ASSERT_TRUE(table.empty());
+}
+
+TEST(fd_table_test, visits_the_values_by_ascending_fd)
+{
+    FdTable<int> table;
+    table.insert(9, 90);
+    table.insert(2, 20);
+    table.insert(4, 40);
+    table.erase(4);
+
+    std::vector<int> fds;
+    table.forEach([&](Fd fd, int& value) {
+        fds.push_back(fd);
+        value += 1;
+    });
+
+    ASSERT_EQ(fds, (std::vector<int> { 2, 9 }));
+    ASSERT_EQ(*table.find(2), 21);
+    ASSERT_EQ(*table.find(9), 91);
+
+    table.clear();
+    ASSERT_TRUE(table.empty());
+    ASSERT_FALSE(table.contains(2));
+}
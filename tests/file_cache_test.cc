@@ -0,0 +1,261 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/endpoint.h>
+#include <pistache/file_cache.h>
+#include <pistache/http.h>
+
+#include <curl/curl.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Pistache;
+
+namespace
+{
+    struct CachedFileHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(CachedFileHandler)
+
+        CachedFileHandler(std::shared_ptr<Http::FileCache> cache, std::string directory)
+            : cache_(std::move(cache))
+            , directory_(std::move(directory))
+        { }
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter writer) override
+        {
+            try
+            {
+                cache_->serve(request, writer, directory_ + request.resource());
+            }
+            catch (const Http::HttpError& err)
+            {
+                writer.send(static_cast<Http::Code>(err.code()));
+            }
+        }
+
+    private:
+        std::shared_ptr<Http::FileCache> cache_;
+        std::string directory_;
+    };
+
+    struct Reply
+    {
+        long code = 0;
+        std::string body;
+        std::string headers;
+    };
+
+    Reply fetch(Port port, const std::string& resource, const std::vector<std::string>& requestHeaders = {})
+    {
+        Reply reply;
+        auto append = +[](char* ptr, size_t size, size_t nmemb, void* userdata) -> size_t {
+            static_cast<std::string*>(userdata)->append(ptr, size * nmemb);
+            return size * nmemb;
+        };
+
+        CURL* curl     = curl_easy_init();
+        const auto url = "http://localhost:" + port.toString() + resource;
+
+        struct curl_slist* headers = nullptr;
+        for (const auto& header : requestHeaders)
+            headers = curl_slist_append(headers, header.c_str());
+
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_HTTP_CONTENT_DECODING, 0L);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, append);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &reply.body);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, append);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &reply.headers);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+
+        const auto res = curl_easy_perform(curl);
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &reply.code);
+        curl_slist_free_all(headers);
+        curl_easy_cleanup(curl);
+
+        if (res != CURLE_OK)
+            throw std::runtime_error(curl_easy_strerror(res));
+        return reply;
+    }
+
+    std::string headerValue(const std::string& headers, const std::string& name)
+    {
+        auto pos = headers.find(name + ": ");
+        if (pos == std::string::npos)
+            return "";
+        pos += name.size() + 2;
+        return headers.substr(pos, headers.find("\r\n", pos) - pos);
+    }
+
+    void writeFile(const std::string& path, const std::string& content)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << content;
+    }
+
+    class FileCacheServer
+    {
+    public:
+        explicit FileCacheServer(std::chrono::milliseconds revalidateAfter)
+            : cache(std::make_shared<Http::FileCache>(revalidateAfter))
+            , endpoint(Address(IP::loopback(), Port(0)))
+        {
+            char pattern[] = "/tmp/pistache_file_cache_XXXXXX";
+            directory      = mkdtemp(pattern);
+
+            endpoint.init(Http::Endpoint::options().threads(1));
+            endpoint.setHandler(Http::make_handler<CachedFileHandler>(cache, directory));
+            endpoint.serveThreaded();
+        }
+
+        ~FileCacheServer()
+        {
+            endpoint.shutdown();
+            for (const char* name : { "/page.txt", "/page.txt.gz", "/page.txt.br" })
+                std::remove((directory + name).c_str());
+            ::rmdir(directory.c_str());
+        }
+
+        Port port() { return endpoint.getPort(); }
+
+        std::shared_ptr<Http::FileCache> cache;
+        std::string directory;
+
+    private:
+        Http::Endpoint endpoint;
+    };
+} // namespace
+
+TEST(file_cache_test, conditional_requests_are_not_modified)
+{
+    FileCacheServer server(std::chrono::seconds(10));
+    writeFile(server.directory + "/page.txt", "cached");
+
+    auto reply = fetch(server.port(), "/page.txt");
+    ASSERT_EQ(reply.code, 200);
+    ASSERT_EQ(reply.body, "cached");
+    ASSERT_NE(reply.headers.find("Content-Type: text/plain"), std::string::npos) << reply.headers;
+    ASSERT_EQ(server.cache->size(), 1U);
+
+    const auto etag         = headerValue(reply.headers, "ETag");
+    const auto lastModified = headerValue(reply.headers, "Last-Modified");
+    ASSERT_FALSE(etag.empty()) << reply.headers;
+    ASSERT_EQ(lastModified.substr(lastModified.size() - 4), " GMT") << reply.headers;
+
+    reply = fetch(server.port(), "/page.txt", { "If-None-Match: W/\"other\", " + etag });
+    ASSERT_EQ(reply.code, 304);
+    ASSERT_TRUE(reply.body.empty());
+    ASSERT_EQ(headerValue(reply.headers, "ETag"), etag);
+
+    reply = fetch(server.port(), "/page.txt", { "If-Modified-Since: " + lastModified });
+    ASSERT_EQ(reply.code, 304);
+
+    // If-None-Match wins over If-Modified-Since
+    reply = fetch(server.port(), "/page.txt",
+                  { "If-None-Match: \"other\"", "If-Modified-Since: " + lastModified });
+    ASSERT_EQ(reply.code, 200);
+    ASSERT_EQ(reply.body, "cached");
+
+    reply = fetch(server.port(), "/page.txt", { "If-Modified-Since: Sat, 01 Jan 2000 00:00:00 GMT" });
+    ASSERT_EQ(reply.code, 200);
+
+    reply = fetch(server.port(), "/page.txt", { "Range: bytes=0-2", "If-Range: " + etag });
+    ASSERT_EQ(reply.code, 206);
+    ASSERT_EQ(reply.body, "cac");
+}
+
+TEST(file_cache_test, precompressed_siblings_are_served_when_accepted)
+{
+    FileCacheServer server(std::chrono::seconds(10));
+    writeFile(server.directory + "/page.txt", "plain");
+    writeFile(server.directory + "/page.txt.gz", "gzipped bytes");
+
+    auto reply = fetch(server.port(), "/page.txt", { "Accept-Encoding: br, gzip" });
+    ASSERT_EQ(reply.code, 200);
+    ASSERT_EQ(reply.body, "gzipped bytes");
+    ASSERT_NE(reply.headers.find("Content-Encoding: gzip"), std::string::npos) << reply.headers;
+    ASSERT_NE(reply.headers.find("Vary: Accept-Encoding"), std::string::npos) << reply.headers;
+    ASSERT_NE(reply.headers.find("Content-Type: text/plain"), std::string::npos) << reply.headers;
+    const auto gzipTag = headerValue(reply.headers, "ETag");
+
+    reply = fetch(server.port(), "/page.txt", { "Accept-Encoding: gzip;q=0, deflate" });
+    ASSERT_EQ(reply.body, "plain");
+    ASSERT_EQ(reply.headers.find("Content-Encoding"), std::string::npos) << reply.headers;
+    ASSERT_NE(reply.headers.find("Vary: Accept-Encoding"), std::string::npos) << reply.headers;
+
+    // The validators differ between the representations
+    ASSERT_NE(headerValue(reply.headers, "ETag"), gzipTag);
+    reply = fetch(server.port(), "/page.txt", { "If-None-Match: " + gzipTag });
+    ASSERT_EQ(reply.code, 200);
+
+    server.cache->setPrecompressed(false);
+    server.cache->clear();
+    reply = fetch(server.port(), "/page.txt", { "Accept-Encoding: gzip" });
+    ASSERT_EQ(reply.body, "plain");
+    ASSERT_EQ(reply.headers.find("Vary"), std::string::npos) << reply.headers;
+}
+
+TEST(file_cache_test, changed_files_are_opened_again)
+{
+    FileCacheServer server(std::chrono::milliseconds(0));
+    const auto path = server.directory + "/page.txt";
+    writeFile(path, "first version");
+
+    auto reply = fetch(server.port(), "/page.txt");
+    ASSERT_EQ(reply.body, "first version");
+    const auto etag = headerValue(reply.headers, "ETag");
+
+    // Unchanged, the entry is kept
+    reply = fetch(server.port(), "/page.txt", { "If-None-Match: " + etag });
+    ASSERT_EQ(reply.code, 304);
+
+    // Replaced by another file, as deployments usually do
+    writeFile(path + ".new", "second, longer version");
+    ASSERT_EQ(::rename((path + ".new").c_str(), path.c_str()), 0);
+
+    reply = fetch(server.port(), "/page.txt", { "If-None-Match: " + etag });
+    ASSERT_EQ(reply.code, 200);
+    ASSERT_EQ(reply.body, "second, longer version");
+    ASSERT_NE(headerValue(reply.headers, "ETag"), etag);
+
+    ASSERT_EQ(::unlink(path.c_str()), 0);
+    reply = fetch(server.port(), "/page.txt");
+    ASSERT_EQ(reply.code, 404);
+    ASSERT_EQ(server.cache->size(), 0U);
+}
+
+TEST(file_cache_test, files_are_served_from_the_cache_until_revalidated)
+{
+    FileCacheServer server(std::chrono::seconds(10));
+    const auto path = server.directory + "/page.txt";
+    writeFile(path, "kept open");
+
+    auto reply = fetch(server.port(), "/page.txt");
+    ASSERT_EQ(reply.body, "kept open");
+
+    // The descriptor outlives the name of the file
+    ASSERT_EQ(::unlink(path.c_str()), 0);
+    reply = fetch(server.port(), "/page.txt");
+    ASSERT_EQ(reply.code, 200);
+    ASSERT_EQ(reply.body, "kept open");
+
+    reply = fetch(server.port(), "/missing.txt");
+    ASSERT_EQ(reply.code, 404);
+    ASSERT_EQ(server.cache->size(), 1U);
+}
@@ -0,0 +1,230 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/endpoint.h>
+#include <pistache/file_prefetcher.h>
+#include <pistache/http.h>
+
+#include <curl/curl.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace Pistache;
+
+namespace
+{
+    constexpr size_t FileSize = 4 * 1024 * 1024 + 123;
+
+    std::string fileContent()
+    {
+        std::string content(FileSize, '\0');
+        for (size_t i = 0; i < content.size(); ++i)
+            content[i] = static_cast<char>('a' + (i * 7 + i / 4096) % 26);
+        return content;
+    }
+
+    class TempFile
+    {
+    public:
+        explicit TempFile(const std::string& content)
+        {
+            char pattern[] = "/tmp/pistache_prefetch_XXXXXX";
+            int fd         = mkstemp(pattern);
+            if (fd == -1)
+                throw std::runtime_error("mkstemp");
+            ::close(fd);
+
+            path = pattern;
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out << content;
+        }
+
+        ~TempFile() { std::remove(path.c_str()); }
+
+        // Drops the file from the page cache, the first reads go to the disk
+        void evict() const
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd == -1)
+                throw std::runtime_error("open");
+            ::fdatasync(fd);
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+
+        std::string path;
+    };
+
+    struct LargeFileHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(LargeFileHandler)
+
+        explicit LargeFileHandler(std::string fileName)
+            : fileName_(std::move(fileName))
+        { }
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter writer) override
+        {
+            if (request.resource() == "/ping")
+                writer.send(Http::Code::Ok, "pong");
+            else
+                Http::serveFile(writer, fileName_);
+        }
+
+    private:
+        std::string fileName_;
+    };
+
+    std::string fetch(Port port, const std::string& resource)
+    {
+        std::string body;
+        auto append = +[](char* ptr, size_t size, size_t nmemb, void* userdata) -> size_t {
+            static_cast<std::string*>(userdata)->append(ptr, size * nmemb);
+            return size * nmemb;
+        };
+
+        CURL* curl     = curl_easy_init();
+        const auto url = "http://localhost:" + port.toString() + resource;
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, append);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+
+        const auto res = curl_easy_perform(curl);
+        curl_easy_cleanup(curl);
+
+        if (res != CURLE_OK)
+            throw std::runtime_error(curl_easy_strerror(res));
+        return body;
+    }
+
+    void downloadWith(Http::Endpoint::Options options)
+    {
+        const auto content = fileContent();
+        TempFile file(content);
+        file.evict();
+
+        Http::Endpoint endpoint(Address(IP::loopback(), Port(0)));
+        endpoint.init(options.threads(1));
+        endpoint.setHandler(Http::make_handler<LargeFileHandler>(file.path));
+        endpoint.serveThreaded();
+
+        // Both downloads share the worker, their slices take turns
+        auto first  = std::async(std::launch::async, [&] { return fetch(endpoint.getPort(), "/file"); });
+        auto second = std::async(std::launch::async, [&] { return fetch(endpoint.getPort(), "/file"); });
+        ASSERT_EQ(fetch(endpoint.getPort(), "/ping"), "pong");
+
+        const auto firstBody  = first.get();
+        const auto secondBody = second.get();
+        endpoint.shutdown();
+
+        ASSERT_EQ(firstBody.size(), content.size());
+        ASSERT_TRUE(firstBody == content);
+        ASSERT_TRUE(secondBody == content);
+    }
+} // namespace
+
+TEST(file_prefetcher_test, prefetched_ranges_are_cached)
+{
+    TempFile file(fileContent());
+    file.evict();
+
+    auto fd = std::shared_ptr<const Fd>(new Fd(::open(file.path.c_str(), O_RDONLY)), [](const Fd* fd) {
+        ::close(*fd);
+        delete fd;
+    });
+    ASSERT_NE(*fd, -1);
+    ASSERT_FALSE(Tcp::FilePrefetcher::isCached(*fd, 4096, 256 * 1024));
+
+    Tcp::FilePrefetcher prefetcher(1);
+    ASSERT_EQ(prefetcher.threads(), 1U);
+
+    std::promise<std::thread::id> done;
+    prefetcher.prefetch(fd, 4096, 256 * 1024, [&done] { done.set_value(std::this_thread::get_id()); });
+    auto doneFuture = done.get_future();
+    ASSERT_EQ(doneFuture.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    ASSERT_NE(doneFuture.get(), std::this_thread::get_id());
+
+    ASSERT_TRUE(Tcp::FilePrefetcher::isCached(*fd, 4096, 256 * 1024));
+    ASSERT_TRUE(Tcp::FilePrefetcher::isCached(*fd, 0, 0));
+}
+
+TEST(file_prefetcher_test, queued_prefetches_are_dropped_on_destruction)
+{
+    TempFile file("small");
+    auto open = [&file] {
+        return std::shared_ptr<const Fd>(new Fd(::open(file.path.c_str(), O_RDONLY)), [](const Fd* fd) {
+            ::close(*fd);
+            delete fd;
+        });
+    };
+
+    std::promise<void> started;
+    std::promise<void> release;
+    auto released = release.get_future().share();
+
+    std::atomic<size_t> calls { 0 };
+    std::weak_ptr<const Fd> queuedFd;
+
+    auto prefetcher = std::make_unique<Tcp::FilePrefetcher>(1);
+
+    // Holds the only thread of the pool while the others are queued
+    prefetcher->prefetch(open(), 0, 5, [&started, released] {
+        started.set_value();
+        released.wait();
+    });
+    started.get_future().wait();
+
+    {
+        auto fd  = open();
+        queuedFd = fd;
+        for (size_t i = 0; i < 64; ++i)
+            prefetcher->prefetch(fd, 0, 5, [&calls] { ++calls; });
+    }
+
+    auto destroyed = std::async(std::launch::async, [&prefetcher] { prefetcher.reset(); });
+
+    // The queued jobs held the last references to their file, it is closed
+    // once the destructor dropped them
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!queuedFd.expired() && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_TRUE(queuedFd.expired());
+
+    release.set_value();
+    ASSERT_EQ(destroyed.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+
+    ASSERT_EQ(calls.load(), 0U);
+    ASSERT_THROW(Tcp::FilePrefetcher(0), std::invalid_argument);
+}
+
+TEST(file_prefetcher_test, zero_send_file_budget_is_rejected)
+{
+    ASSERT_THROW(Http::Endpoint::options().sendFileBudget(0), std::invalid_argument);
+}
+
+TEST(file_prefetcher_test, large_files_are_sent_in_slices)
+{
+    downloadWith(Http::Endpoint::options().sendFileBudget(64 * 1024));
+}
+
+TEST(file_prefetcher_test, large_files_are_sent_once_prefetched)
+{
+    downloadWith(Http::Endpoint::options().sendFileBudget(256 * 1024).filePrefetchThreads(2));
+}
@@ -311,6 +311,10 @@ TEST(headers_test, authorization_basic_test)
     // Verify it decoded correctly...
     ASSERT_TRUE(au.getBasicUser() == "Aladdin");
     ASSERT_TRUE(au.getBasicPassword() == "OpenSesame");
+
+    // Verify credentials that are not base 64 are refused...
+    au.parse("Basic QWxhZGRp*jpPcGVuU2VzYW1l");
+    ASSERT_THROW(au.getBasicUser(), std::runtime_error);
 }
 
 TEST(headers_test, authorization_bearer_test)
@@ -361,6 +365,11 @@ TEST(headers_test, expect_test)
     ASSERT_TRUE(oss.str().empty());
     ASSERT_TRUE(e.expectation() == Pistache::Http::Expectation::Ext);
     oss.str("");
+
+    // As found in a request, followed by the end of its line
+    const char raw[] = "100-Continue\r\n";
+    e.parseRaw(raw, 12);
+    ASSERT_TRUE(e.expectation() == Pistache::Http::Expectation::Continue);
 }
 
 TEST(headers_test, connection)
@@ -388,6 +397,10 @@ TEST(headers_test, connection)
         { "KEEP-ALIVE", Pistache::Http::ConnectionControl::KeepAlive,
           "Keep-Alive" },
 
+        { "Upgrade", Pistache::Http::ConnectionControl::Upgrade, "Upgrade" },
+        { "keep-alive, Upgrade", Pistache::Http::ConnectionControl::Upgrade, "Upgrade" },
+        { "Upgrade-Insecure", Pistache::Http::ConnectionControl::Ext, "Ext" },
+
         { "Ext", Pistache::Http::ConnectionControl::Ext, "Ext" },
         { "ext", Pistache::Http::ConnectionControl::Ext, "Ext" },
         { "eXt", Pistache::Http::ConnectionControl::Ext, "Ext" },
@@ -457,6 +470,86 @@ TEST(headers_test, date_test_ostream)
     ASSERT_TRUE("Fri, 25 Jan 2019 21:04:45.000000000 UTC" == os.str());
 }
 
+TEST(headers_test, date_test_matches_date_library)
+{
+    using namespace std::chrono;
+    using Pistache::Http::FullDate;
+
+    const std::pair<FullDate::Type, const char*> formats[] = {
+        { FullDate::Type::RFC1123, "%a, %d %b %Y %T %Z" },
+        { FullDate::Type::RFC850, "%a, %d-%b-%y %T %Z" },
+        { FullDate::Type::AscTime, "%a %b %d %T %Y" },
+    };
+
+    // From year 100 to year 9000, leap days and fractions of seconds
+    // included
+    std::vector<FullDate::time_point> points = {
+        FullDate::time_point(),
+        date::sys_days(date::year { 2000 } / 2 / 29) + hours(23) + minutes(59) + seconds(59),
+        date::sys_days(date::year { 1900 } / 3 / 1) + nanoseconds(1),
+    };
+    int64_t value = -59000000000;
+    for (int i = 0; i < 1000; ++i)
+    {
+        value = (value * 6364136223846793005LL + 1442695040888963407LL) % 220000000000LL;
+        points.push_back(FullDate::time_point(duration_cast<FullDate::time_point::duration>(
+            seconds(value < 0 ? -value - 59000000000 : value - 59000000000) + nanoseconds(i * 7919))));
+    }
+
+    for (const auto& point : points)
+    {
+        for (const auto& [type, format] : formats)
+        {
+            std::ostringstream expected, written;
+            date::to_stream(expected, format, point);
+            FullDate(point).write(written, type);
+            ASSERT_EQ(written.str(), expected.str());
+        }
+
+        // The fixed formats parse back to the second
+        const auto second = floor<seconds>(point);
+        for (const char* format : { "%a, %d %b %Y %T GMT", "%A, %d-%b-%y %T GMT", "%a %b %e %T %Y" })
+        {
+            std::ostringstream os;
+            date::to_stream(os, format, second);
+            const auto text = os.str();
+            if (std::string(format).find("%y") != std::string::npos
+                && (date::year_month_day(floor<date::days>(second)).year() < date::year { 1969 }
+                    || date::year_month_day(floor<date::days>(second)).year() > date::year { 2068 }))
+                continue;
+
+            ASSERT_EQ(FullDate::fromString(text).date(), second) << text;
+        }
+    }
+
+    ASSERT_THROW(FullDate::fromString("Mon, 06 Nov 1994 08:49:37 GMT extra"), std::runtime_error);
+    ASSERT_THROW(FullDate::fromString("Sun, 31 Nov 1994 08:49:37 GMT"), std::runtime_error);
+    ASSERT_THROW(FullDate::fromString("Sun, 06 Nov 1994 25:49:37 GMT"), std::runtime_error);
+}
+
+TEST(headers_test, date_test_current)
+{
+    using namespace std::chrono;
+    const auto before = floor<seconds>(system_clock::now()) - seconds(1);
+
+    std::ostringstream os;
+    Pistache::Http::Header::Date date;
+    date.write(os);
+
+    const auto text = os.str();
+    ASSERT_EQ(text.size(), 29u) << text;
+    ASSERT_EQ(text.substr(25), " GMT") << text;
+
+    Pistache::Http::Header::Date parsed;
+    parsed.parse(text);
+    ASSERT_GE(parsed.fullDate().date(), before) << text;
+    ASSERT_LE(parsed.fullDate().date(), system_clock::now()) << text;
+
+    std::ostringstream rfc1123;
+    Pistache::Http::Header::Date(parsed.fullDate()).write(rfc1123);
+    ASSERT_EQ(rfc1123.str().substr(0, 25), text.substr(0, 25));
+}
+
 TEST(headers_test, host)
 {
 
@@ -562,6 +655,18 @@ TEST(headers_test, content_encoding)
     ASSERT_TRUE(ce.encoding() == Pistache::Http::Header::Encoding::Chunked);
     oss.str("");
 
+    ce.parse("br");
+    ce.write(oss);
+    ASSERT_TRUE("br" == oss.str());
+    ASSERT_TRUE(ce.encoding() == Pistache::Http::Header::Encoding::Br);
+    oss.str("");
+
+    ce.parse("zstd");
+    ce.write(oss);
+    ASSERT_TRUE("zstd" == oss.str());
+    ASSERT_TRUE(ce.encoding() == Pistache::Http::Header::Encoding::Zstd);
+    oss.str("");
+
     ce.parse("unknown");
     ce.write(oss);
     ASSERT_TRUE("unknown" == oss.str());
@@ -679,6 +784,34 @@ TEST(headers_test, server_test)
     oss.str("");
 }
 
+TEST(headers_test, content_range_test)
+{
+    Pistache::Http::Header::ContentRange r0(0, 499, 1234);
+    std::ostringstream oss;
+    r0.write(oss);
+    ASSERT_EQ(oss.str(), "bytes 0-499/1234");
+    oss.str("");
+
+    auto r1 = Pistache::Http::Header::ContentRange::unsatisfied(1234);
+    r1.write(oss);
+    ASSERT_EQ(oss.str(), "bytes */1234");
+
+    Pistache::Http::Header::ContentRange r2;
+    r2.parse("bytes 21010-47021/47022");
+    ASSERT_TRUE(r2.satisfied());
+    ASSERT_EQ(r2.first(), 21010U);
+    ASSERT_EQ(r2.last(), 47021U);
+    ASSERT_EQ(r2.length(), 47022U);
+
+    r2.parse("bytes */47022");
+    ASSERT_FALSE(r2.satisfied());
+    ASSERT_EQ(r2.length(), 47022U);
+
+    ASSERT_THROW(r2.parse("items 0-1/2"), std::runtime_error);
+    ASSERT_THROW(r2.parse("bytes 10-1/20"), std::runtime_error);
+    ASSERT_THROW(r2.parse("bytes 0-1"), std::runtime_error);
+}
+
 CUSTOM_HEADER(TestHeader)
 
 TEST(headers_test, macro_for_custom_headers)
@@ -860,3 +993,130 @@ TEST(headers_test, cookie_headers_are_case_insensitive)
         ASSERT_TRUE(request.cookies().get("x").value == "y");
     }
 }
+
+TEST(headers_test, collection_keeps_typed_headers_in_slots)
+{
+    // TestHeader has no slot of its own and lives next to the known ones
+    static_assert(detail::knownSlot(ContentLength::Name) < detail::KnownHeadersCount);
+    static_assert(detail::knownSlot(TestHeader::Name) == detail::KnownHeadersCount);
+
+    Collection headers;
+    headers.add<ContentLength>(10);
+    headers.add<ContentLength>(20);
+    headers.add<Host>("localhost");
+    headers.add(std::make_shared<TestHeader>());
+
+    // The first header of a given name wins
+    ASSERT_EQ(headers.get<ContentLength>()->value(), 10u);
+
+    // Looking up by name ignores the case, whatever the storage
+    ASSERT_TRUE(headers.has("content-length"));
+    ASSERT_TRUE(headers.has("HOST"));
+    ASSERT_TRUE(headers.has<TestHeader>());
+    ASSERT_TRUE(headers.tryGet(toLowercase(TestHeader::Name)) != nullptr);
+    ASSERT_EQ(headers.list().size(), 3u);
+
+    // Visited in the order of the list
+    std::vector<const Header*> visited;
+    headers.forEach([&](const Header& header) { visited.push_back(&header); });
+    const auto list = headers.list();
+    ASSERT_EQ(visited.size(), list.size());
+    for (size_t i = 0; i < list.size(); ++i)
+        ASSERT_EQ(visited[i], list[i].get());
+
+    ASSERT_TRUE(headers.remove<Host>());
+    ASSERT_FALSE(headers.has<Host>());
+    ASSERT_TRUE(headers.remove(TestHeader::Name));
+    ASSERT_FALSE(headers.has<TestHeader>());
+    ASSERT_FALSE(headers.remove<Host>());
+
+    headers.addRaw(Raw("X-Custom", "1"));
+    headers.addRaw(Raw("x-custom", "2"));
+    ASSERT_EQ(headers.rawList().size(), 1u);
+    ASSERT_EQ(headers.getRaw("X-CUSTOM").value(), "1");
+
+    headers.clear();
+    ASSERT_FALSE(headers.has<ContentLength>());
+    ASSERT_TRUE(headers.list().empty());
+    ASSERT_TRUE(headers.rawList().empty());
+}
+
+TEST(headers_test, deferred_headers_are_parsed_on_first_access)
+{
+    Collection headers;
+    headers.addDeferred(Raw("content-length", "42"));
+    headers.addDeferred(Raw("Content-Length", "7"));
+    headers.addDeferred(Raw("Host", "localhost:8080"));
+    headers.addDeferred(Raw("Accept", "not a media type"));
+    headers.addDeferred(Raw("X-Custom", "1"));
+
+    // Nothing has been parsed, the raw headers are there all the same
+    ASSERT_TRUE(headers.has<ContentLength>());
+    ASSERT_TRUE(headers.has("HOST"));
+    ASSERT_EQ(headers.rawList().size(), 4u);
+    ASSERT_FALSE(headers.has("X-Custom"));
+
+    ASSERT_EQ(headers.get<ContentLength>()->value(), 42u);
+    ASSERT_EQ(headers.get("host")->name(), "Host");
+    ASSERT_EQ(headers.get<Host>()->port(), Pistache::Port(8080));
+
+    // A malformed value only throws once it is read
+    ASSERT_THROW(headers.tryGet<Accept>(), std::exception);
+    ASSERT_THROW(headers.tryGet<Accept>(), std::exception);
+    ASSERT_TRUE(headers.remove<Accept>());
+    ASSERT_EQ(headers.tryGet<Accept>(), nullptr);
+    ASSERT_EQ(headers.list().size(), 2u);
+
+    // A typed header added later does not replace the received one
+    headers.addDeferred(Raw("Server", "pistache"));
+    headers.add<Server>("other");
+    ASSERT_EQ(headers.get<Server>()->tokens().front(), "pistache");
+
+    headers.clear();
+    ASSERT_FALSE(headers.has<ContentLength>());
+    ASSERT_TRUE(headers.list().empty());
+}
+
+TEST(headers_test, headers_on_the_wire_are_written_once)
+{
+    Collection headers;
+    headers.addDeferred(Raw("Host", "localhost:8080"));
+    headers.addDeferred(Raw("Content-Length", "42"));
+    headers.addRaw(Raw("X-Custom", "1"));
+    headers.add<Server>("pistache");
+    ASSERT_EQ(headers.get<ContentLength>()->value(), 42u);
+
+    std::vector<std::string> typed, raw;
+    headers.forEachOnWire([&](const Header& header) { typed.emplace_back(header.name()); },
+                          [&](const Raw& header) { raw.push_back(header.name() + ": " + header.value()); });
+
+    // The parsed Content-Length is written from its typed header, the
+    // deferred Host as it was received
+    ASSERT_EQ(typed, (std::vector<std::string> { "Content-Length", "Server" }));
+    ASSERT_EQ(raw, (std::vector<std::string> { "Host: localhost:8080", "X-Custom: 1" }));
+}
+
+TEST(headers_test, registry_knows_the_builtin_headers_in_any_case)
+{
+    auto& registry = Registry::instance();
+
+    for (size_t i = 0; i < detail::KnownHeadersCount; ++i)
+    {
+        const std::string name(detail::KnownHeaders[i]);
+        ASSERT_EQ(detail::knownSlotIgnoreCase(name), i) << name;
+        ASSERT_EQ(detail::knownSlotIgnoreCase(toLowercase(name)), i) << name;
+        ASSERT_TRUE(registry.isRegistered(toLowercase(name))) << name;
+        ASSERT_EQ(registry.makeHeader(toLowercase(name))->name(), name);
+    }
+
+    // Close to a known name is not good enough
+    ASSERT_EQ(detail::knownSlotIgnoreCase("Content-Lengt"), detail::KnownHeadersCount);
+    ASSERT_EQ(detail::knownSlotIgnoreCase("Content-Lengthh"), detail::KnownHeadersCount);
+    ASSERT_EQ(detail::knownSlotIgnoreCase(""), detail::KnownHeadersCount);
+    ASSERT_FALSE(registry.isRegistered("X-Not-Registered"));
+
+    const auto names = registry.headersList();
+    ASSERT_TRUE(std::find(names.begin(), names.end(), "Content-Length") != names.end());
+
+    ASSERT_THROW(registry.registerHeader<ContentLength>(), std::runtime_error);
+}
@@ -0,0 +1,309 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/hpack.h>
+
+#include <string>
+#include <vector>
+
+using namespace Pistache::Http;
+
+namespace
+{
+    std::string fromHex(const std::string& hex)
+    {
+        std::string out;
+        std::string digits;
+        for (char c : hex)
+        {
+            if (c == ' ')
+                continue;
+            digits.push_back(c);
+            if (digits.size() == 2)
+            {
+                out.push_back(static_cast<char>(std::stoi(digits, nullptr, 16)));
+                digits.clear();
+            }
+        }
+        return out;
+    }
+
+    std::vector<Hpack::HeaderField> decode(Hpack::Decoder& decoder, const std::string& hex)
+    {
+        const auto block = fromHex(hex);
+        return decoder.decode(block.data(), block.size());
+    }
+
+    void expectFields(const std::vector<Hpack::HeaderField>& fields,
+                      const std::vector<Hpack::HeaderField>& expected)
+    {
+        ASSERT_EQ(fields.size(), expected.size());
+        for (size_t i = 0; i < fields.size(); ++i)
+        {
+            EXPECT_EQ(fields[i].name, expected[i].name);
+            EXPECT_EQ(fields[i].value, expected[i].value);
+        }
+    }
+
+    const std::vector<Hpack::HeaderField> firstRequest = {
+        { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" }, { ":authority", "www.example.com" }
+    };
+    const std::vector<Hpack::HeaderField> secondRequest = {
+        { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/" }, { ":authority", "www.example.com" },
+        { "cache-control", "no-cache" }
+    };
+    const std::vector<Hpack::HeaderField> thirdRequest = {
+        { ":method", "GET" }, { ":scheme", "https" }, { ":path", "/index.html" },
+        { ":authority", "www.example.com" }, { "custom-key", "custom-value" }
+    };
+
+    const std::vector<Hpack::HeaderField> firstResponse = {
+        { ":status", "302" }, { "cache-control", "private" },
+        { "date", "Mon, 21 Oct 2013 20:13:21 GMT" }, { "location", "https://www.example.com" }
+    };
+    const std::vector<Hpack::HeaderField> secondResponse = {
+        { ":status", "307" }, { "cache-control", "private" },
+        { "date", "Mon, 21 Oct 2013 20:13:21 GMT" }, { "location", "https://www.example.com" }
+    };
+    const std::vector<Hpack::HeaderField> thirdResponse = {
+        { ":status", "200" }, { "cache-control", "private" },
+        { "date", "Mon, 21 Oct 2013 20:13:22 GMT" }, { "location", "https://www.example.com" },
+        { "content-encoding", "gzip" },
+        { "set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1" }
+    };
+} // namespace
+
+// RFC 7541 C.2
+TEST(hpack_test, decodes_single_representations)
+{
+    Hpack::Decoder literal;
+    expectFields(decode(literal, "400a 6375 7374 6f6d 2d6b 6579 0d63 7573 746f 6d2d 6865 6164 6572"),
+                 { { "custom-key", "custom-header" } });
+    EXPECT_EQ(literal.table().entries(), 1U);
+    EXPECT_EQ(literal.table().size(), 55U);
+
+    Hpack::Decoder notIndexed;
+    expectFields(decode(notIndexed, "040c 2f73 616d 706c 652f 7061 7468"), { { ":path", "/sample/path" } });
+    EXPECT_EQ(notIndexed.table().entries(), 0U);
+
+    Hpack::Decoder neverIndexed;
+    expectFields(decode(neverIndexed, "1008 7061 7373 776f 7264 0673 6563 7265 74"),
+                 { { "password", "secret" } });
+    EXPECT_EQ(neverIndexed.table().entries(), 0U);
+
+    Hpack::Decoder indexed;
+    expectFields(decode(indexed, "82"), { { ":method", "GET" } });
+    EXPECT_EQ(indexed.table().entries(), 0U);
+}
+
+// RFC 7541 C.3
+TEST(hpack_test, decodes_requests_without_huffman)
+{
+    Hpack::Decoder decoder;
+
+    expectFields(decode(decoder, "8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d"), firstRequest);
+    EXPECT_EQ(decoder.table().size(), 57U);
+
+    expectFields(decode(decoder, "8286 84be 5808 6e6f 2d63 6163 6865"), secondRequest);
+    EXPECT_EQ(decoder.table().size(), 110U);
+
+    expectFields(decode(decoder, "8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d 7661 6c75 65"),
+                 thirdRequest);
+    EXPECT_EQ(decoder.table().size(), 164U);
+    EXPECT_EQ(decoder.table().entries(), 3U);
+}
+
+// RFC 7541 C.4
+TEST(hpack_test, decodes_requests_with_huffman)
+{
+    Hpack::Decoder decoder;
+
+    expectFields(decode(decoder, "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff"), firstRequest);
+    expectFields(decode(decoder, "8286 84be 5886 a8eb 1064 9cbf"), secondRequest);
+    expectFields(decode(decoder, "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf"),
+                 thirdRequest);
+    EXPECT_EQ(decoder.table().size(), 164U);
+}
+
+// RFC 7541 C.5, with a table of 256 bytes
+TEST(hpack_test, decodes_responses_with_eviction)
+{
+    Hpack::Decoder decoder(256);
+
+    expectFields(decode(decoder, "4803 3330 3258 0770 7269 7661 7465 611d 4d6f 6e2c 2032 3120 4f63 7420 "
+                                 "3230 3133 2032 303a 3133 3a32 3120 474d 546e 1768 7474 7073 3a2f 2f77 "
+                                 "7777 2e65 7861 6d70 6c65 2e63 6f6d"),
+                 firstResponse);
+    EXPECT_EQ(decoder.table().size(), 222U);
+
+    expectFields(decode(decoder, "4803 3330 37c1 c0bf"), secondResponse);
+    EXPECT_EQ(decoder.table().size(), 222U);
+    EXPECT_EQ(decoder.table().entries(), 4U);
+
+    expectFields(decode(decoder, "88c1 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133 2032 303a 3133 3a32 "
+                                 "3220 474d 54c0 5a04 677a 6970 7738 666f 6f3d 4153 444a 4b48 514b 425a "
+                                 "584f 5157 454f 5049 5541 5851 5745 4f49 553b 206d 6178 2d61 6765 3d33 "
+                                 "3630 303b 2076 6572 7369 6f6e 3d31"),
+                 thirdResponse);
+    EXPECT_EQ(decoder.table().size(), 215U);
+    EXPECT_EQ(decoder.table().entries(), 3U);
+}
+
+// RFC 7541 C.6
+TEST(hpack_test, decodes_responses_with_huffman)
+{
+    Hpack::Decoder decoder(256);
+
+    expectFields(decode(decoder, "4882 6402 5885 aec3 771a 4b61 96d0 7abe 9410 54d4 44a8 2005 9504 0b81 "
+                                 "66e0 82a6 2d1b ff6e 919d 29ad 1718 63c7 8f0b 97c8 e9ae 82ae 43d3"),
+                 firstResponse);
+    expectFields(decode(decoder, "4883 640e ffc1 c0bf"), secondResponse);
+    expectFields(decode(decoder, "88c1 6196 d07a be94 1054 d444 a820 0595 040b 8166 e084 a62d 1bff c05a "
+                                 "839b d9ab 77ad 94e7 821d d7f2 e6c7 b335 dfdf cd5b 3960 d5af 2708 7f36 "
+                                 "72c1 ab27 0fb5 291f 9587 3160 65c0 03ed 4ee5 b106 3d50 07"),
+                 thirdResponse);
+    EXPECT_EQ(decoder.table().size(), 215U);
+}
+
+TEST(hpack_test, huffman_round_trip)
+{
+    std::string all;
+    for (int c = 0; c < 256; ++c)
+        all.push_back(static_cast<char>(c));
+
+    for (const std::string& data : { std::string("www.example.com"), std::string("no-cache"), all, std::string() })
+    {
+        std::string encoded;
+        Hpack::huffmanEncode(data, encoded);
+        EXPECT_EQ(encoded.size(), Hpack::huffmanEncodedSize(data));
+        EXPECT_EQ(Hpack::huffmanDecode(encoded), data);
+    }
+
+    std::string encoded;
+    Hpack::huffmanEncode("www.example.com", encoded);
+    EXPECT_EQ(encoded, fromHex("f1e3 c2e5 f23a 6ba0 ab90 f4ff"));
+}
+
+TEST(hpack_test, rejects_invalid_huffman_padding)
+{
+    // Padded with zeros rather than with the beginning of EOS
+    EXPECT_THROW(Hpack::huffmanDecode(fromHex("f1e3 c2e5 f23a 6ba0 ab90 f400")), Hpack::DecodeError);
+    // A whole byte of padding
+    EXPECT_THROW(Hpack::huffmanDecode(fromHex("f1e3 c2e5 f23a 6ba0 ab90 f4ff ff")), Hpack::DecodeError);
+}
+
+TEST(hpack_test, rejects_invalid_blocks)
+{
+    Hpack::Decoder decoder;
+
+    // No entry at that index
+    EXPECT_THROW(decode(decoder, "be"), Hpack::DecodeError);
+    // Truncated literal
+    EXPECT_THROW(decode(decoder, "400a 6375 7374"), Hpack::DecodeError);
+    // Size update past the one advertised
+    EXPECT_THROW(decode(decoder, "3fe1 3f"), Hpack::DecodeError);
+    // Size update after a field
+    EXPECT_THROW(decode(decoder, "8220"), Hpack::DecodeError);
+    // Integer overflow
+    EXPECT_THROW(decode(decoder, "ffff ffff ffff ff"), Hpack::DecodeError);
+}
+
+TEST(hpack_test, stops_decoding_past_the_header_list_limit)
+{
+    // x-large, a value of 1000 bytes indexed in the dynamic table
+    const auto entry = fromHex("4007 782d 6c61 7267 65 7fe9 06") + std::string(1000, 'a');
+
+    // Right at the limit
+    Hpack::Decoder decoder;
+    EXPECT_EQ(decoder.decode(entry.data(), entry.size(), 7 + 1000 + 32).size(), 1U);
+
+    // Then references to it
+    Hpack::Decoder bombed;
+    const auto block = entry + std::string(1000, static_cast<char>(0xbe));
+    EXPECT_THROW(bombed.decode(block.data(), block.size(), 4096), Hpack::HeaderListTooLarge);
+}
+
+TEST(hpack_test, encoder_round_trip)
+{
+    Hpack::Encoder encoder;
+    Hpack::Decoder decoder;
+
+    for (const auto& fields : { firstResponse, secondResponse, thirdResponse, firstResponse })
+    {
+        std::string block;
+        encoder.encode(fields, block);
+        expectFields(decoder.decode(block.data(), block.size()), fields);
+        EXPECT_EQ(encoder.table().size(), decoder.table().size());
+    }
+
+    // Fields seen before are sent as their index
+    std::string block;
+    encoder.encode({ { "cache-control", "private" } }, block);
+    EXPECT_EQ(block.size(), 1U);
+}
+
+TEST(hpack_test, encoder_does_not_index_sensitive_fields)
+{
+    Hpack::Encoder encoder;
+    Hpack::Decoder decoder;
+
+    const std::vector<Hpack::HeaderField> fields = {
+        { "authorization", "Basic dXNlcjpwYXNz" }, { "set-cookie", "id=42" }
+    };
+
+    std::string block;
+    encoder.encode(fields, block);
+    expectFields(decoder.decode(block.data(), block.size()), fields);
+    EXPECT_EQ(encoder.table().entries(), 0U);
+    EXPECT_EQ(decoder.table().entries(), 0U);
+}
+
+TEST(hpack_test, encoder_follows_table_size_of_peer)
+{
+    Hpack::Encoder encoder;
+    Hpack::Decoder decoder;
+
+    std::string block;
+    encoder.encode(thirdResponse, block);
+    decoder.decode(block.data(), block.size());
+    ASSERT_GT(decoder.table().entries(), 0U);
+
+    // Going through zero empties both tables
+    encoder.setMaxTableSize(0);
+    encoder.setMaxTableSize(256);
+
+    block.clear();
+    encoder.encode(firstResponse, block);
+    expectFields(decoder.decode(block.data(), block.size()), firstResponse);
+    EXPECT_EQ(decoder.table().maxSize(), 256U);
+    EXPECT_EQ(encoder.table().size(), decoder.table().size());
+    EXPECT_LE(decoder.table().size(), 256U);
+}
+
+TEST(hpack_test, table_evicts_oldest_entries)
+{
+    Hpack::Table table(100);
+
+    table.add("first", std::string(10, 'a'));
+    table.add("second", std::string(10, 'b'));
+    EXPECT_EQ(table.entries(), 2U);
+
+    table.add("third", std::string(40, 'c'));
+    EXPECT_EQ(table.entries(), 1U);
+    EXPECT_EQ(table.at(62).name, "third");
+
+    // An entry larger than the table empties it
+    table.add("fourth", std::string(100, 'd'));
+    EXPECT_EQ(table.entries(), 0U);
+    EXPECT_EQ(table.size(), 0U);
+
+    EXPECT_EQ(table.find(":method", "POST"), std::make_pair(size_t(3), true));
+    EXPECT_EQ(table.find(":method", "PUT").first, 2U);
+    EXPECT_FALSE(table.find(":method", "PUT").second);
+    EXPECT_EQ(table.find("x-unknown", "").first, 0U);
+}
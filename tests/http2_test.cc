@@ -0,0 +1,633 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/client.h>
+#include <pistache/endpoint.h>
+#include <pistache/hpack.h>
+#include <pistache/http.h>
+#include <pistache/http2.h>
+
+#include <curl/curl.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_client.h"
+
+using namespace Pistache;
+
+namespace
+{
+    size_t write_cb(void* contents, size_t size, size_t nmemb, void* userp)
+    {
+        (static_cast<std::string*>(userp))->append(static_cast<char*>(contents), size * nmemb);
+        return size * nmemb;
+    }
+
+    const std::string FileContent = std::string(100000, 'x') + "end";
+
+    std::mutex delayedLock;
+    std::vector<Http::ResponseWriter> delayed;
+
+    size_t delayedCount()
+    {
+        std::lock_guard<std::mutex> guard(delayedLock);
+        return delayed.size();
+    }
+
+    void answerDelayed(const std::string& body)
+    {
+        std::vector<Http::ResponseWriter> writers;
+        {
+            std::lock_guard<std::mutex> guard(delayedLock);
+            writers.swap(delayed);
+        }
+        for (auto& writer : writers)
+            writer.send(Http::Code::Ok, body);
+    }
+
+    struct Http2Handler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(Http2Handler)
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter writer) override
+        {
+            const auto& resource = request.resource();
+            if (resource == "/echo")
+            {
+                writer.send(Http::Code::Ok, request.body());
+            }
+            else if (resource == "/version")
+            {
+                writer.send(Http::Code::Ok, Http::versionString(request.version()));
+            }
+            else if (resource == "/query")
+            {
+                writer.send(Http::Code::Ok, request.query().get("name").value_or(""));
+            }
+            else if (resource == "/headers")
+            {
+                writer.headers().add<Http::Header::Location>("/elsewhere");
+                writer.cookies().add(Http::Cookie("id", "42"));
+                writer.send(Http::Code::Created,
+                            request.headers().getRaw("x-request").value() + " "
+                                + request.headers().get<Http::Header::Host>()->host());
+            }
+            else if (resource == "/stream")
+            {
+                auto stream = writer.stream(Http::Code::Ok);
+                stream << "first ";
+                stream.flush();
+                stream << "second";
+                stream.ends();
+            }
+            else if (resource == "/file")
+            {
+                Http::serveFile(writer, "http2_test_file.txt");
+            }
+            else if (resource == "/large")
+            {
+                writer.send(Http::Code::Ok, std::string(200000, 'a'));
+            }
+            else if (resource == "/delayed")
+            {
+                // Answered by the test
+                std::lock_guard<std::mutex> guard(delayedLock);
+                delayed.push_back(std::move(writer));
+            }
+            else
+            {
+                writer.send(Http::Code::Not_Found, "Not found");
+            }
+        }
+    };
+
+    class Http2Test : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            std::ofstream("http2_test_file.txt") << FileContent;
+
+            server.init(Http::Endpoint::options()
+                            .flags(Tcp::Options::ReuseAddr)
+                            .maxRequestSize(1024 * 1024)
+                            .http2(true));
+            server.setHandler(Http::make_handler<Http2Handler>());
+            server.serveThreaded();
+        }
+
+        void TearDown() override
+        {
+            {
+                std::lock_guard<std::mutex> guard(delayedLock);
+                delayed.clear();
+            }
+            server.shutdown();
+            std::remove("http2_test_file.txt");
+        }
+
+        std::string url(const std::string& resource) const
+        {
+            return "http://localhost:" + server.getPort().toString() + resource;
+        }
+
+        // Body of the response, its version and status through the last
+        // arguments
+        std::string get(const std::string& resource, long* version = nullptr, long* code = nullptr,
+                        const std::string& post = "", bool http2 = true, std::string* headers = nullptr)
+        {
+            CURL* curl = curl_easy_init();
+            std::string buffer;
+
+            curl_easy_setopt(curl, CURLOPT_URL, url(resource).c_str());
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION,
+                             http2 ? CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE : CURL_HTTP_VERSION_1_1);
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
+            curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+            if (headers)
+            {
+                curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, write_cb);
+                curl_easy_setopt(curl, CURLOPT_HEADERDATA, headers);
+            }
+
+            struct curl_slist* list = curl_slist_append(nullptr, "X-Request: request");
+            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, list);
+            if (!post.empty())
+            {
+                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post.c_str());
+                curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(post.size()));
+            }
+
+            EXPECT_EQ(curl_easy_perform(curl), CURLE_OK);
+            if (version)
+                curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, version);
+            if (code)
+                curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, code);
+
+            curl_slist_free_all(list);
+            curl_easy_cleanup(curl);
+            return buffer;
+        }
+
+        Http::Endpoint server { Address("localhost", Port(0)) };
+    };
+
+    // Frames written and read by hand, for what curl cannot be made to do
+    std::string frame(Http::Http2::FrameType type, uint8_t flags, uint32_t stream,
+                      const std::string& payload)
+    {
+        std::string out;
+        const auto length = static_cast<uint32_t>(payload.size());
+        out.push_back(static_cast<char>(length >> 16));
+        out.push_back(static_cast<char>(length >> 8));
+        out.push_back(static_cast<char>(length));
+        out.push_back(static_cast<char>(type));
+        out.push_back(static_cast<char>(flags));
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.push_back(static_cast<char>(stream >> shift));
+        return out + payload;
+    }
+
+    struct Frame
+    {
+        Http::Http2::FrameType type;
+        uint8_t flags;
+        uint32_t stream;
+        std::string payload;
+    };
+
+    class RawConnection
+    {
+    public:
+        explicit RawConnection(const Http::Endpoint& server)
+        {
+            EXPECT_TRUE(client_.connect(Address("localhost", server.getPort())));
+        }
+
+        void send(const std::string& data) { EXPECT_TRUE(client_.send(data)); }
+
+        // The next frame, false when none arrived in time
+        bool next(Frame& frame)
+        {
+            while (true)
+            {
+                if (input_.size() >= Http::Http2::FrameHeaderSize)
+                {
+                    const auto* bytes = reinterpret_cast<const uint8_t*>(input_.data());
+                    const size_t length = (size_t(bytes[0]) << 16) | (size_t(bytes[1]) << 8) | bytes[2];
+                    if (input_.size() >= Http::Http2::FrameHeaderSize + length)
+                    {
+                        frame.type   = static_cast<Http::Http2::FrameType>(bytes[3]);
+                        frame.flags  = bytes[4];
+                        frame.stream = (uint32_t(bytes[5] & 0x7f) << 24) | (uint32_t(bytes[6]) << 16)
+                            | (uint32_t(bytes[7]) << 8) | bytes[8];
+                        frame.payload = input_.substr(Http::Http2::FrameHeaderSize, length);
+                        input_.erase(0, Http::Http2::FrameHeaderSize + length);
+                        return true;
+                    }
+                }
+
+                char buffer[4096];
+                size_t bytes = 0;
+                if (!client_.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                    return false;
+                input_.append(buffer, bytes);
+            }
+        }
+
+        // Skips the frames up to the first one of that type
+        bool next(Http::Http2::FrameType type, Frame& frame)
+        {
+            while (next(frame))
+            {
+                if (frame.type == type)
+                    return true;
+            }
+            return false;
+        }
+
+    private:
+        TcpClient client_;
+        std::string input_;
+    };
+
+    std::string setting(Http::Http2::SettingId id, uint32_t value)
+    {
+        std::string out;
+        out.push_back(static_cast<char>(static_cast<uint16_t>(id) >> 8));
+        out.push_back(static_cast<char>(id));
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.push_back(static_cast<char>(value >> shift));
+        return out;
+    }
+
+    std::string windowUpdate(uint32_t stream, uint32_t increment)
+    {
+        std::string payload;
+        for (int shift = 24; shift >= 0; shift -= 8)
+            payload.push_back(static_cast<char>(increment >> shift));
+        return frame(Http::Http2::FrameType::WindowUpdate, 0, stream, payload);
+    }
+
+    std::string requestHeaders(Http::Hpack::Encoder& encoder, uint32_t stream, const std::string& path,
+                               const std::string& priority = "")
+    {
+        std::vector<Http::Hpack::HeaderField> fields = {
+            { ":method", "GET" }, { ":scheme", "http" }, { ":path", path }, { ":authority", "localhost" }
+        };
+        if (!priority.empty())
+            fields.push_back({ "priority", priority });
+
+        std::string block;
+        encoder.encode(fields, block);
+        return frame(Http::Http2::FrameType::Headers,
+                     Http::Http2::Flag::EndHeaders | Http::Http2::Flag::EndStream, stream, block);
+    }
+} // namespace
+
+TEST(http2_unit_test, recognizes_connection_preface)
+{
+    const std::string preface(Http::Http2::Preface);
+    EXPECT_TRUE(Http::Http2::startsWithPreface(preface.data(), preface.size()));
+    EXPECT_TRUE(Http::Http2::startsWithPreface("PRI", 3));
+    EXPECT_FALSE(Http::Http2::startsWithPreface("POST", 4));
+    EXPECT_FALSE(Http::Http2::startsWithPreface("GET / HTTP/1.1", 14));
+    EXPECT_FALSE(Http::Http2::startsWithPreface("", 0));
+}
+
+TEST(http2_unit_test, parses_priority_field)
+{
+    auto priority = Http::Http2::Priority::parse("u=1, i");
+    EXPECT_EQ(priority.urgency, 1);
+    EXPECT_TRUE(priority.incremental);
+
+    priority = Http::Http2::Priority::parse("i=?0;foo=bar, u=7");
+    EXPECT_EQ(priority.urgency, 7);
+    EXPECT_FALSE(priority.incremental);
+
+    // Invalid members keep their default
+    priority = Http::Http2::Priority::parse("u=9, x=1");
+    EXPECT_EQ(priority.urgency, Http::Http2::Priority::DefaultUrgency);
+    EXPECT_FALSE(priority.incremental);
+}
+
+TEST_F(Http2Test, serves_request_with_prior_knowledge)
+{
+    long version = 0;
+    long code    = 0;
+    EXPECT_EQ(get("/version", &version, &code), "HTTP/2");
+    EXPECT_EQ(version, CURL_HTTP_VERSION_2_0);
+    EXPECT_EQ(code, 200);
+
+    EXPECT_EQ(get("/query?name=pistache"), "pistache");
+
+    get("/unknown", nullptr, &code);
+    EXPECT_EQ(code, 404);
+}
+
+TEST_F(Http2Test, receives_request_body)
+{
+    const std::string body(150000, 'b');
+    EXPECT_EQ(get("/echo", nullptr, nullptr, body), body);
+}
+
+TEST_F(Http2Test, sends_headers_and_cookies)
+{
+    long code = 0;
+    std::string headers;
+    EXPECT_EQ(get("/headers", nullptr, &code, "", true, &headers), "request localhost");
+    EXPECT_EQ(code, 201);
+    EXPECT_NE(headers.find("location: /elsewhere"), std::string::npos);
+    EXPECT_NE(headers.find("set-cookie: id=42"), std::string::npos);
+}
+
+TEST_F(Http2Test, streams_response)
+{
+    EXPECT_EQ(get("/stream"), "first second");
+}
+
+TEST_F(Http2Test, serves_file)
+{
+    EXPECT_EQ(get("/file"), FileContent);
+}
+
+TEST_F(Http2Test, still_serves_http1)
+{
+    long version = 0;
+    EXPECT_EQ(get("/version", &version, nullptr, "", false), "HTTP/1.1");
+    EXPECT_EQ(version, CURL_HTTP_VERSION_1_1);
+
+    EXPECT_EQ(get("/echo", nullptr, nullptr, "posted", false), "posted");
+}
+
+TEST_F(Http2Test, multiplexes_streams_after_their_priority)
+{
+    RawConnection connection(server);
+    Http::Hpack::Encoder encoder;
+
+    // The least urgent request first, its response is sent last. The
+    // blocks are encoded in the order they are sent
+    std::string requests = requestHeaders(encoder, 1, "/large", "u=5");
+    requests += requestHeaders(encoder, 3, "/large", "u=1");
+
+    connection.send(std::string(Http::Http2::Preface)
+                    + frame(Http::Http2::FrameType::Settings, 0, 0,
+                            setting(Http::Http2::SettingId::InitialWindowSize, 1024 * 1024))
+                    + windowUpdate(0, 1024 * 1024) + requests);
+
+    std::map<uint32_t, size_t> received;
+    std::vector<uint32_t> ended;
+
+    Frame next;
+    while (ended.size() < 2)
+    {
+        ASSERT_TRUE(connection.next(Http::Http2::FrameType::Data, next));
+        if (next.stream == 1)
+        {
+            EXPECT_EQ(received[3], 200000U);
+        }
+        received[next.stream] += next.payload.size();
+        if (next.flags & Http::Http2::Flag::EndStream)
+            ended.push_back(next.stream);
+    }
+
+    EXPECT_EQ(ended, std::vector<uint32_t>({ 3, 1 }));
+    EXPECT_EQ(received[1], 200000U);
+    EXPECT_EQ(received[3], 200000U);
+}
+
+TEST_F(Http2Test, acknowledges_settings_and_ping)
+{
+    RawConnection connection(server);
+    connection.send(std::string(Http::Http2::Preface)
+                    + frame(Http::Http2::FrameType::Settings, 0, 0, "")
+                    + frame(Http::Http2::FrameType::Ping, 0, 0, "12345678"));
+
+    Frame received;
+    ASSERT_TRUE(connection.next(received));
+    EXPECT_EQ(received.type, Http::Http2::FrameType::Settings);
+    EXPECT_EQ(received.flags, 0);
+
+    ASSERT_TRUE(connection.next(received));
+    EXPECT_EQ(received.type, Http::Http2::FrameType::Settings);
+    EXPECT_EQ(received.flags, Http::Http2::Flag::Ack);
+
+    ASSERT_TRUE(connection.next(received));
+    EXPECT_EQ(received.type, Http::Http2::FrameType::Ping);
+    EXPECT_EQ(received.flags, Http::Http2::Flag::Ack);
+    EXPECT_EQ(received.payload, "12345678");
+}
+
+TEST_F(Http2Test, respects_flow_control_window)
+{
+    constexpr uint32_t Window = 1000;
+
+    RawConnection connection(server);
+    Http::Hpack::Encoder encoder;
+    connection.send(std::string(Http::Http2::Preface)
+                    + frame(Http::Http2::FrameType::Settings, 0, 0,
+                            setting(Http::Http2::SettingId::InitialWindowSize, Window))
+                    + requestHeaders(encoder, 1, "/large"));
+
+    Frame received;
+    ASSERT_TRUE(connection.next(Http::Http2::FrameType::Headers, received));
+    EXPECT_EQ(received.stream, 1U);
+
+    size_t body = 0;
+    while (body < Window)
+    {
+        ASSERT_TRUE(connection.next(Http::Http2::FrameType::Data, received));
+        body += received.payload.size();
+    }
+    EXPECT_EQ(body, Window);
+
+    // Nothing more until the window is opened again
+    connection.send(frame(Http::Http2::FrameType::Ping, 0, 0, "abcdefgh"));
+    ASSERT_TRUE(connection.next(received));
+    EXPECT_EQ(received.type, Http::Http2::FrameType::Ping);
+
+    connection.send(windowUpdate(1, 200000) + windowUpdate(0, 200000));
+    received.flags = 0;
+    while (!(received.flags & Http::Http2::Flag::EndStream))
+    {
+        ASSERT_TRUE(connection.next(Http::Http2::FrameType::Data, received));
+        EXPECT_LE(received.payload.size(), Http::Http2::DefaultMaxFrameSize);
+        body += received.payload.size();
+    }
+    EXPECT_EQ(body, 200000U);
+}
+
+TEST_F(Http2Test, answers_protocol_error_with_goaway)
+{
+    RawConnection connection(server);
+    Http::Hpack::Encoder encoder;
+
+    // The SETTINGS of the client have to come first
+    connection.send(std::string(Http::Http2::Preface) + requestHeaders(encoder, 1, "/version"));
+
+    Frame received;
+    ASSERT_TRUE(connection.next(Http::Http2::FrameType::GoAway, received));
+    ASSERT_EQ(received.payload.size(), 8U);
+    EXPECT_EQ(received.payload[7], static_cast<char>(Http::Http2::ErrorCode::ProtocolError));
+}
+
+TEST_F(Http2Test, refuses_header_list_past_the_limit_while_decoding)
+{
+    RawConnection connection(server);
+    Http::Hpack::Encoder encoder;
+
+    // A block of a few kilobytes that indexes a large entry in the dynamic
+    // table, x-large, then references it over and over
+    std::string block;
+    encoder.encode({ { ":method", "GET" }, { ":scheme", "http" }, { ":path", "/version" } }, block);
+    block += std::string("\x40\x07x-large\x7f\xd1\x0e", 12) + std::string(2000, 'a');
+    block.append(4000, static_cast<char>(0xbe));
+
+    connection.send(std::string(Http::Http2::Preface)
+                    + frame(Http::Http2::FrameType::Settings, 0, 0, "")
+                    + frame(Http::Http2::FrameType::Headers,
+                            Http::Http2::Flag::EndHeaders | Http::Http2::Flag::EndStream, 1, block));
+
+    Frame received;
+    ASSERT_TRUE(connection.next(Http::Http2::FrameType::GoAway, received));
+    ASSERT_EQ(received.payload.size(), 8U);
+    EXPECT_EQ(received.payload[7], static_cast<char>(Http::Http2::ErrorCode::EnhanceYourCalm));
+}
+
+TEST_F(Http2Test, refuses_malformed_request)
+{
+    RawConnection connection(server);
+    Http::Hpack::Encoder encoder;
+
+    // No :path
+    std::string block;
+    encoder.encode({ { ":method", "GET" }, { ":scheme", "http" } }, block);
+    connection.send(std::string(Http::Http2::Preface)
+                    + frame(Http::Http2::FrameType::Settings, 0, 0, "")
+                    + frame(Http::Http2::FrameType::Headers,
+                            Http::Http2::Flag::EndHeaders | Http::Http2::Flag::EndStream, 1, block)
+                    + requestHeaders(encoder, 3, "/version"));
+
+    Frame received;
+    ASSERT_TRUE(connection.next(Http::Http2::FrameType::RstStream, received));
+    EXPECT_EQ(received.stream, 1U);
+    EXPECT_EQ(received.payload[3], static_cast<char>(Http::Http2::ErrorCode::ProtocolError));
+
+    // The connection goes on with the other streams
+    ASSERT_TRUE(connection.next(Http::Http2::FrameType::Headers, received));
+    EXPECT_EQ(received.stream, 3U);
+}
+
+namespace
+{
+    // Code and body of the response, or the error it failed with
+    std::string outcome(Async::Promise<Http::Response>& promise)
+    {
+        std::string result = "pending";
+        promise.then(
+            [&result](Http::Response response) {
+                result = std::to_string(static_cast<int>(response.code())) + " " + response.body();
+            },
+            [&result](std::exception_ptr exc) {
+                try
+                {
+                    std::rethrow_exception(exc);
+                }
+                catch (const std::exception& e)
+                {
+                    result = e.what();
+                }
+            });
+
+        Async::Barrier<Http::Response> barrier(promise);
+        barrier.wait_for(std::chrono::seconds(10));
+        return result;
+    }
+} // namespace
+
+TEST_F(Http2Test, client_multiplexes_requests_on_a_connection)
+{
+    Http::Experimental::Client client;
+    client.init(Http::Experimental::Client::options()
+                    .maxConnectionsPerHost(1)
+                    .http2(Http::Experimental::Http2Mode::PriorKnowledge));
+
+    // Every request reaches the server before any is answered, on the
+    // single connection of the host
+    std::vector<Async::Promise<Http::Response>> responses;
+    for (int i = 0; i < 20; ++i)
+        responses.push_back(client.get(url("/delayed")).send());
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (delayedCount() < responses.size() && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(delayedCount(), responses.size());
+    answerDelayed("later");
+
+    for (auto& response : responses)
+        EXPECT_EQ(outcome(response), "200 later");
+
+    auto version = client.get(url("/version")).send();
+    EXPECT_EQ(outcome(version), "200 HTTP/2");
+    client.shutdown();
+}
+
+TEST_F(Http2Test, client_stream_timeout_keeps_the_connection)
+{
+    Http::Experimental::Client client;
+    client.init(Http::Experimental::Client::options()
+                    .maxConnectionsPerHost(1)
+                    .http2(Http::Experimental::Http2Mode::PriorKnowledge));
+
+    auto warm = client.get(url("/version")).send();
+    ASSERT_EQ(outcome(warm), "200 HTTP/2");
+
+    auto slow = client.get(url("/delayed")).timeout(std::chrono::milliseconds(100)).send();
+    auto fast = client.get(url("/query?name=fast")).send();
+
+    EXPECT_EQ(outcome(slow), "Timeout");
+    EXPECT_EQ(outcome(fast), "200 fast");
+
+    // Only the stream was reset, the next request shares the connection
+    auto after = client.get(url("/headers")).header(Http::Header::Raw("X-Request", "next")).send();
+    std::string cookie;
+    after.then(
+        [&cookie](Http::Response response) {
+            if (response.cookies().has("id"))
+                cookie = response.cookies().get("id").value;
+        },
+        Async::IgnoreException);
+    EXPECT_EQ(outcome(after), "201 next localhost");
+    client.shutdown();
+
+    EXPECT_EQ(cookie, "42");
+}
+
+TEST_F(Http2Test, client_sends_large_bodies_within_the_windows)
+{
+    Http::Experimental::Client client;
+    client.init(Http::Experimental::Client::options().http2(Http::Experimental::Http2Mode::PriorKnowledge));
+
+    // Larger than the windows of the server, which are given back as the
+    // body is received
+    const std::string body(300000, 'b');
+    auto echo  = client.post(url("/echo")).body(body).send();
+    auto large = client.get(url("/large")).send();
+
+    EXPECT_EQ(outcome(echo), "200 " + body);
+    EXPECT_EQ(outcome(large), "200 " + std::string(200000, 'a'));
+    client.shutdown();
+}
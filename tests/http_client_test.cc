@@ -10,8 +10,20 @@
 
 #include <gtest/gtest.h>
 
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <future>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace Pistache;
 
@@ -124,6 +136,72 @@ TEST(http_client_test, one_client_with_one_request)
     ASSERT_TRUE(done);
 }
 
+TEST(http_client_test, one_client_with_one_request_over_ipv6)
+{
+    if (!IP::supported())
+        GTEST_SKIP() << "No IPv6 support";
+
+    Http::Endpoint server(Address(IP::loopback(true), Port(0)));
+    server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr));
+    server.setHandler(Http::make_handler<HelloHandler>());
+    server.serveThreaded();
+
+    Http::Experimental::Client client;
+    client.init();
+
+    auto response = client.get("[::1]:" + server.getPort().toString()).send();
+    bool done     = false;
+    response.then(
+        [&done](Http::Response rsp) {
+            if (rsp.code() == Http::Code::Ok)
+                done = true;
+        },
+        Async::IgnoreException);
+
+    Async::Barrier<Http::Response> barrier(response);
+    barrier.wait_for(std::chrono::seconds(5));
+
+    server.shutdown();
+    client.shutdown();
+
+    ASSERT_TRUE(done);
+}
+
+TEST(http_client_test, one_client_with_one_request_over_a_unix_socket)
+{
+    const std::string path = "/tmp/pistache_client_test_" + std::to_string(getpid()) + ".sock";
+    const std::string abstractName = "@pistache_client_test_" + std::to_string(getpid());
+
+    for (const auto& address : { Address::unixSocket(path), Address("unix:" + abstractName) })
+    {
+        {
+            Http::Endpoint server(address);
+            server.init(Http::Endpoint::options().threads(2).flags(Tcp::Options::ReuseAddr));
+            server.setHandler(Http::make_handler<HelloHandler>());
+            server.serveThreaded();
+
+            Http::Experimental::Client client;
+            client.init(Http::Experimental::Client::options().connectTo(address));
+
+            // The url only names the host of the requests
+            auto response = client.get("http://localhost/").send();
+            std::string body;
+            response.then([&body](Http::Response rsp) { body = rsp.body(); },
+                          Async::IgnoreException);
+
+            Async::Barrier<Http::Response> barrier(response);
+            barrier.wait_for(std::chrono::seconds(5));
+
+            server.shutdown();
+            client.shutdown();
+
+            EXPECT_EQ(body, "Hello, World!") << address;
+        }
+
+        EXPECT_NE(access(path.c_str(), F_OK), 0) << "The socket file is left behind";
+    }
+}
+
 TEST(http_client_test, one_client_with_multiple_requests)
 {
     const Pistache::Address address("localhost", Pistache::Port(0));
@@ -574,3 +652,757 @@ TEST(http_client_test, client_do_not_get_large_content)
     ASSERT_FALSE(ok_flag);
     ASSERT_TRUE(exception_flag);
 }
+
+TEST(http_client_test, connection_pool_creates_connections_lazily)
+{
+    Http::Experimental::ConnectionPool pool;
+    pool.init(2, Http::Experimental::Default::MaxResponseSize);
+
+    const std::string domain = "127.0.0.1:9080";
+    ASSERT_EQ(pool.idleConnections(domain), 0u);
+
+    auto first  = pool.pickConnection(domain);
+    auto second = pool.pickConnection(domain);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    ASSERT_NE(first, second);
+    ASSERT_EQ(pool.pickConnection(domain), nullptr);
+    ASSERT_EQ(pool.idleConnections(domain), 0u);
+
+    pool.releaseConnection(first);
+    // Releasing twice must not hand the connection out twice
+    pool.releaseConnection(first);
+    ASSERT_EQ(pool.idleConnections(domain), 1u);
+
+    ASSERT_EQ(pool.pickConnection(domain), first);
+    ASSERT_EQ(pool.pickConnection(domain), nullptr);
+}
+
+TEST(http_client_test, connection_pool_concurrent_checkout)
+{
+    Http::Experimental::ConnectionPool pool;
+    pool.init(4, Http::Experimental::Default::MaxResponseSize);
+
+    const std::string domain = "127.0.0.1:9080";
+    std::atomic<int> inUse { 0 };
+    std::atomic<bool> overcommitted { false };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 10000; ++i)
+            {
+                auto conn = pool.pickConnection(domain);
+                if (!conn)
+                    continue;
+
+                if (inUse.fetch_add(1) + 1 > 4)
+                    overcommitted = true;
+                inUse.fetch_sub(1);
+                pool.releaseConnection(conn);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    ASSERT_FALSE(overcommitted);
+
+    // Every connection made it back to the pool
+    std::set<std::shared_ptr<Http::Experimental::Connection>> picked;
+    for (int i = 0; i < 4; ++i)
+        picked.insert(pool.pickConnection(domain));
+    ASSERT_EQ(picked.size(), 4u);
+    ASSERT_EQ(picked.count(nullptr), 0u);
+    ASSERT_EQ(pool.pickConnection(domain), nullptr);
+}
+
+TEST(http_client_test, connection_pool_prefers_the_lane_of_the_caller)
+{
+    Http::Experimental::ConnectionPool pool;
+    pool.init(3, Http::Experimental::Default::MaxResponseSize,
+              Http::Experimental::Default::PipelineDepth, 2);
+
+    const std::string domain = "127.0.0.1:9080";
+    auto first               = pool.pickConnection(domain, true, 0);
+    auto second              = pool.pickConnection(domain, true, 1);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    EXPECT_EQ(first->lane(), 0u);
+    EXPECT_EQ(second->lane(), 1u);
+
+    pool.releaseConnection(first);
+    pool.releaseConnection(second);
+
+    // Any idle connection will do, from the lane on
+    ASSERT_EQ(pool.pickConnection(domain, true, 1), second);
+
+    // An affine checkout opens a connection in its lane rather than taking
+    // one from another lane, as long as it can
+    auto third = pool.pickConnection(domain, true, 1, true);
+    ASSERT_NE(third, nullptr);
+    EXPECT_EQ(third->lane(), 1u);
+
+    pool.releaseConnection(third);
+    pool.releaseConnection(second);
+    ASSERT_EQ(pool.pickConnection(domain, true, 1, true), second);
+    ASSERT_EQ(pool.pickConnection(domain, true, 1, true), third);
+    ASSERT_EQ(pool.pickConnection(domain, true, 1, true), first);
+    ASSERT_EQ(pool.pickConnection(domain, true, 1, true), nullptr);
+}
+
+namespace
+{
+    // Answers every request with its own path, in order, after holding the
+    // first one back long enough for pipelined requests to pile up
+    class PipeliningServer
+    {
+    public:
+        PipeliningServer()
+        {
+            fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+
+            sockaddr_in addr {};
+            addr.sin_family      = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port        = 0;
+            ::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            ::listen(fd_, 8);
+
+            socklen_t len = sizeof(addr);
+            ::getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+            port_ = ntohs(addr.sin_port);
+
+            thread_ = std::thread([this] { serve(); });
+        }
+
+        ~PipeliningServer()
+        {
+            ::shutdown(fd_, SHUT_RDWR);
+            ::close(fd_);
+            thread_.join();
+        }
+
+        std::string address() const { return "127.0.0.1:" + std::to_string(port_); }
+
+        int connections() const { return connections_; }
+        size_t maxQueued() const { return maxQueued_; }
+
+    private:
+        void serve()
+        {
+            int client = ::accept(fd_, nullptr, nullptr);
+            if (client < 0)
+                return;
+            ++connections_;
+
+            std::string buffer;
+            bool first = true;
+            char chunk[4096];
+            for (;;)
+            {
+                ssize_t bytes = ::recv(client, chunk, sizeof(chunk), 0);
+                if (bytes <= 0)
+                    break;
+                buffer.append(chunk, static_cast<size_t>(bytes));
+
+                if (first)
+                {
+                    first = false;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                    ssize_t more;
+                    while ((more = ::recv(client, chunk, sizeof(chunk), MSG_DONTWAIT)) > 0)
+                        buffer.append(chunk, static_cast<size_t>(more));
+                }
+
+                size_t queued = 0;
+                for (size_t pos = 0; (pos = buffer.find("\r\n\r\n", pos)) != std::string::npos; pos += 4)
+                    ++queued;
+                maxQueued_ = std::max(maxQueued_.load(), queued);
+
+                size_t end;
+                while ((end = buffer.find("\r\n\r\n")) != std::string::npos)
+                {
+                    const auto pathBegin = buffer.find(' ') + 1;
+                    const auto path      = buffer.substr(pathBegin, buffer.find(' ', pathBegin) - pathBegin);
+                    buffer.erase(0, end + 4);
+
+                    const std::string response = "HTTP/1.1 200 OK\r\nContent-Length: "
+                        + std::to_string(path.size()) + "\r\n\r\n" + path;
+                    ::send(client, response.data(), response.size(), 0);
+                }
+            }
+            ::close(client);
+        }
+
+        int fd_;
+        uint16_t port_;
+        std::thread thread_;
+        std::atomic<int> connections_ { 0 };
+        std::atomic<size_t> maxQueued_ { 0 };
+    };
+
+    size_t sendPipelined(PipeliningServer& server, Http::Method method)
+    {
+        Http::Experimental::Client client;
+        client.init(Http::Experimental::Client::options().maxConnectionsPerHost(1).pipelining(4));
+
+        const int RequestsCount = 8;
+        std::vector<Async::Promise<Http::Response>> responses;
+        std::atomic<int> matched { 0 };
+        for (int i = 0; i < RequestsCount; ++i)
+        {
+            const auto page = "/" + std::to_string(i);
+            auto builder    = method == Http::Method::Get ? client.get(server.address() + page)
+                                                          : client.post(server.address() + page);
+            auto response   = builder.header<Http::Header::Connection>(Http::ConnectionControl::KeepAlive)
+                                .send();
+            response.then(
+                [&matched, page](Http::Response rsp) {
+                    if (rsp.body() == page)
+                        ++matched;
+                },
+                Async::IgnoreException);
+            responses.push_back(std::move(response));
+
+            // Lets the first request open the connection
+            if (i == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+
+        auto sync = Async::whenAll(responses.begin(), responses.end());
+        Async::Barrier<std::vector<Http::Response>> barrier(sync);
+        barrier.wait_for(std::chrono::seconds(5));
+
+        client.shutdown();
+
+        EXPECT_EQ(matched, RequestsCount);
+        EXPECT_EQ(server.connections(), 1);
+        return server.maxQueued();
+    }
+} // namespace
+
+TEST(http_client_test, bursts_wait_on_the_queue_of_their_host)
+{
+    Http::Endpoint server(Address("localhost", Port(0)));
+    server.init(Http::Endpoint::options().threads(2).flags(Tcp::Options::ReuseAddr));
+    server.setHandler(Http::make_handler<HelloHandler>());
+    server.serveThreaded();
+
+    Http::Experimental::Client client;
+    client.init(Http::Experimental::Client::options().threads(2).maxConnectionsPerHost(2));
+
+    // Two hosts for the same server, each with its own connections
+    const auto port                     = server.getPort().toString();
+    const std::vector<std::string> urls = { "localhost:" + port, "127.0.0.1:" + port };
+
+    constexpr int Threads = 4;
+    constexpr int PerThread = 32;
+    std::atomic<int> ok { 0 };
+    std::vector<std::thread> senders;
+    for (int t = 0; t < Threads; ++t)
+    {
+        senders.emplace_back([&, t]() {
+            std::vector<Async::Promise<Http::Response>> responses;
+            for (int i = 0; i < PerThread; ++i)
+            {
+                auto response = client.get(urls[(t + i) % urls.size()]).send();
+                response.then(
+                    [&](Http::Response rsp) {
+                        if (rsp.code() == Http::Code::Ok)
+                            ++ok;
+                    },
+                    Async::IgnoreException);
+                responses.push_back(std::move(response));
+            }
+
+            auto sync = Async::whenAll(responses.begin(), responses.end());
+            Async::Barrier<std::vector<Http::Response>> barrier(sync);
+            barrier.wait_for(std::chrono::seconds(10));
+        });
+    }
+    for (auto& sender : senders)
+        sender.join();
+
+    client.shutdown();
+    server.shutdown();
+
+    ASSERT_EQ(ok.load(), Threads * PerThread);
+}
+
+TEST(http_client_test, pipelined_responses_are_matched_in_order)
+{
+    PipeliningServer server;
+    ASSERT_GT(sendPipelined(server, Http::Method::Get), 1u);
+}
+
+TEST(http_client_test, non_idempotent_requests_are_not_pipelined)
+{
+    PipeliningServer server;
+    ASSERT_EQ(sendPipelined(server, Http::Method::Post), 1u);
+}
+
+namespace
+{
+    const std::string streamedContent = [] {
+        std::string content;
+        for (size_t i = 0; i < 256 * 1024; ++i)
+            content += static_cast<char>('a' + i % 26);
+        return content;
+    }();
+
+    struct StreamedContentHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(StreamedContentHandler)
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter writer) override
+        {
+            if (request.resource() != "/chunked")
+            {
+                writer.send(Http::Code::Ok, streamedContent);
+                return;
+            }
+
+            auto stream = writer.stream(Http::Code::Ok);
+            for (size_t i = 0; i < streamedContent.size(); i += 10000)
+            {
+                const auto size = std::min<size_t>(10000, streamedContent.size() - i);
+                stream.write(streamedContent.data() + i, static_cast<std::streamsize>(size));
+                stream.flush();
+            }
+            stream.ends();
+        }
+    };
+
+    class CollectingReader : public Http::BodyReader
+    {
+    public:
+        void onData(std::string_view data) override
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            body_.append(data);
+            ++parts_;
+        }
+
+        void onEnd() override { ended_ = true; }
+
+        void onError(const std::string& /*reason*/) override { failed_ = true; }
+
+        std::string body()
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            return body_;
+        }
+
+        size_t parts()
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            return parts_;
+        }
+
+        bool waitEnd()
+        {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (!ended_ && !failed_ && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return ended_;
+        }
+
+        std::atomic<bool> ended_ { false };
+        std::atomic<bool> failed_ { false };
+
+    private:
+        std::mutex lock_;
+        std::string body_;
+        size_t parts_ = 0;
+    };
+
+    void streamResponse(const std::string& page, bool paused)
+    {
+        Http::Endpoint server(Address(IP::loopback(), Port(0)));
+        server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr));
+        server.setHandler(Http::make_handler<StreamedContentHandler>());
+        server.serveThreaded();
+
+        // The body does not have to fit in a response
+        Http::Experimental::Client client;
+        client.init(Http::Experimental::Client::options().maxResponseSize(8192));
+
+        auto reader = std::make_shared<CollectingReader>();
+        Http::Experimental::ResponseFlow flow;
+        std::atomic<bool> started { false };
+        auto response = client.get("127.0.0.1:" + server.getPort().toString() + page)
+                            .onBodyStart([&](const Http::Response& rsp, Http::Experimental::ResponseFlow f) {
+                                EXPECT_EQ(rsp.code(), Http::Code::Ok);
+                                flow = f;
+                                if (paused)
+                                    flow.pause();
+                                started = true;
+                                return reader;
+                            })
+                            .send();
+
+        // Resolved with the headers, before the body
+        bool resolved = false;
+        response.then([&](Http::Response rsp) { resolved = rsp.body().empty(); }, Async::IgnoreException);
+        Async::Barrier<Http::Response> barrier(response);
+        barrier.wait_for(std::chrono::seconds(5));
+        EXPECT_TRUE(resolved);
+        EXPECT_TRUE(started);
+
+        if (paused)
+        {
+            // Nothing past the first receive buffer while paused
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            EXPECT_FALSE(reader->ended_);
+            EXPECT_LE(reader->parts(), 1u);
+            flow.resume();
+        }
+
+        EXPECT_TRUE(reader->waitEnd());
+        EXPECT_FALSE(reader->failed_);
+        EXPECT_EQ(reader->body(), streamedContent);
+
+        client.shutdown();
+        server.shutdown();
+    }
+} // namespace
+
+TEST(http_client_test, streams_a_response_body)
+{
+    streamResponse("/", false);
+}
+
+TEST(http_client_test, streams_a_chunked_response_body)
+{
+    streamResponse("/chunked", false);
+}
+
+TEST(http_client_test, streamed_response_body_can_be_paused)
+{
+    streamResponse("/", true);
+}
+
+TEST(http_client_test, warmup_establishes_connections_ahead_of_requests)
+{
+    // Never accepted, the handshakes are completed by the kernel all the same
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(listener, 0);
+    sockaddr_in addr {};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len        = sizeof(addr);
+    ASSERT_EQ(::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(::listen(listener, 16), 0);
+    ASSERT_EQ(::getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+    const std::string host = "127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+
+    Http::Experimental::Client client;
+    client.init(Http::Experimental::Client::options().maxConnectionsPerHost(4));
+
+    size_t connected = 0;
+    auto warmup      = client.warmup(host, 3);
+    warmup.then([&](size_t count) { connected = count; }, Async::IgnoreException);
+    Async::Barrier<size_t> barrier(warmup);
+    barrier.wait_for(std::chrono::seconds(5));
+    EXPECT_EQ(connected, 3u);
+
+    // More than the pool holds is capped to its size
+    connected   = 0;
+    auto second = client.warmup(host, 8);
+    second.then([&](size_t count) { connected = count; }, Async::IgnoreException);
+    Async::Barrier<size_t> secondBarrier(second);
+    secondBarrier.wait_for(std::chrono::seconds(5));
+    EXPECT_EQ(connected, 4u);
+
+    client.shutdown();
+    ::close(listener);
+}
+
+namespace
+{
+    struct PortHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(PortHandler)
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter writer) override
+        {
+            writer.send(Http::Code::Ok, request.address().port().toString());
+        }
+    };
+
+    // The port the connection of the request came from
+    std::string sourcePort(Http::Experimental::Client& client, const std::string& address)
+    {
+        std::string port;
+        auto response = client.get(address).send();
+        response.then([&](Http::Response rsp) { port = rsp.body(); }, Async::IgnoreException);
+        Async::Barrier<Http::Response> barrier(response);
+        barrier.wait_for(std::chrono::seconds(5));
+        return port;
+    }
+} // namespace
+
+TEST(http_client_test, idle_connections_are_reaped)
+{
+    Http::Endpoint server(Address("localhost", Port(0)));
+    server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr));
+    server.setHandler(Http::make_handler<PortHandler>());
+    server.serveThreaded();
+    const std::string address = "localhost:" + server.getPort().toString();
+
+    Http::Experimental::Client client;
+    client.init(Http::Experimental::Client::options().maxConnectionsPerHost(1).idleTimeout(
+        std::chrono::milliseconds(50)));
+
+    const auto first = sourcePort(client, address);
+    ASSERT_FALSE(first.empty());
+    EXPECT_EQ(sourcePort(client, address), first);
+
+    // Closed once idle past its timeout, the next request reconnects
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    const auto second = sourcePort(client, address);
+    ASSERT_FALSE(second.empty());
+    EXPECT_NE(second, first);
+
+    client.shutdown();
+    server.shutdown();
+}
+
+namespace
+{
+    // Answers once the client had the time to chain a callback
+    struct SlowHelloHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(SlowHelloHandler)
+
+        void onRequest(const Http::Request& /*request*/, Http::ResponseWriter writer) override
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            writer.send(Http::Code::Ok, "Hello, World!");
+        }
+    };
+} // namespace
+
+TEST(http_client_test, requests_issued_from_a_transport_stay_on_its_thread)
+{
+    Http::Endpoint server(Address(IP::loopback(), Port(0)));
+    server.init(Http::Endpoint::options().threads(2).flags(Tcp::Options::ReuseAddr));
+    server.setHandler(Http::make_handler<SlowHelloHandler>());
+    server.serveThreaded();
+
+    const std::string address = "127.0.0.1:" + server.getPort().toString();
+
+    Http::Experimental::Client client;
+    client.init(Http::Experimental::Client::options().threads(4).maxConnectionsPerHost(8));
+
+    size_t chained = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        // The second request is sent from the callback of the first one, on
+        // the thread of the transport that received its response
+        std::promise<std::pair<std::thread::id, std::thread::id>> threads;
+        auto first = client.get(address).send();
+        first.then(
+            [&](Http::Response) {
+                const auto self = std::this_thread::get_id();
+                client.get(address).send().then(
+                    [&, self](Http::Response) {
+                        threads.set_value({ self, std::this_thread::get_id() });
+                    },
+                    [&, self](std::exception_ptr) {
+                        threads.set_value({ self, std::thread::id() });
+                    });
+            },
+            [&](std::exception_ptr) { threads.set_value({}); });
+
+        auto result = threads.get_future();
+        ASSERT_EQ(result.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+        const auto [sender, receiver] = result.get();
+        ASSERT_NE(sender, std::thread::id());
+
+        // Resolved before the callback was attached, it ran right here
+        if (sender == std::this_thread::get_id())
+            continue;
+
+        EXPECT_EQ(sender, receiver);
+        ++chained;
+    }
+    EXPECT_GT(chained, 0u);
+
+    client.shutdown();
+    server.shutdown();
+}
+
+namespace
+{
+    // Holds the first request back, then answers every other one right away
+    // with its rank
+    struct FirstSlowHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(FirstSlowHandler)
+
+        explicit FirstSlowHandler(std::chrono::milliseconds delay)
+            : delay(delay)
+            , count(std::make_shared<std::atomic<int>>(0))
+        { }
+
+        void onRequest(const Http::Request& /*request*/, Http::ResponseWriter writer) override
+        {
+            const int rank = count->fetch_add(1);
+            if (rank == 0)
+                std::this_thread::sleep_for(delay);
+            writer.send(Http::Code::Ok, std::to_string(rank));
+        }
+
+        std::chrono::milliseconds delay;
+        std::shared_ptr<std::atomic<int>> count;
+    };
+
+    struct Outcome
+    {
+        std::string body;
+        std::string error;
+    };
+
+    Outcome wait(Async::Promise<Http::Response> response)
+    {
+        Outcome outcome;
+        response.then([&](Http::Response rsp) { outcome.body = rsp.body(); },
+                      [&](std::exception_ptr error) {
+                          try
+                          {
+                              std::rethrow_exception(error);
+                          }
+                          catch (const std::exception& e)
+                          {
+                              outcome.error = e.what();
+                          }
+                      });
+        Async::Barrier<Http::Response> barrier(response);
+        barrier.wait_for(std::chrono::seconds(5));
+        return outcome;
+    }
+
+    // Each connection on a worker of its own, the first one holds its
+    // worker back
+    void serveSlowFirst(Http::Endpoint& server, std::chrono::milliseconds delay)
+    {
+        server.init(Http::Endpoint::options()
+                        .threads(2)
+                        .dispatchPolicy(Tcp::DispatchPolicy::RoundRobin)
+                        .flags(Tcp::Options::ReuseAddr));
+        server.setHandler(Http::make_handler<FirstSlowHandler>(delay));
+        server.serveThreaded();
+    }
+} // namespace
+
+TEST(http_client_test, hedged_request_takes_the_first_response)
+{
+    Http::Endpoint server(Address(IP::loopback(), Port(0)));
+    serveSlowFirst(server, std::chrono::milliseconds(1000));
+    const std::string address = "127.0.0.1:" + server.getPort().toString();
+
+    Http::Experimental::Client client;
+    client.init();
+
+    const auto start   = std::chrono::steady_clock::now();
+    const auto outcome = wait(client.get(address).hedge(std::chrono::milliseconds(50)).send());
+    EXPECT_EQ(outcome.body, "1") << outcome.error;
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(800));
+
+    client.shutdown();
+    server.shutdown();
+}
+
+TEST(http_client_test, idempotent_requests_are_retried_within_the_budget)
+{
+    const auto delay   = std::chrono::milliseconds(500);
+    const auto timeout = std::chrono::milliseconds(100);
+
+    {
+        Http::Endpoint server(Address(IP::loopback(), Port(0)));
+        serveSlowFirst(server, delay);
+        const std::string address = "127.0.0.1:" + server.getPort().toString();
+
+        Http::Experimental::Client client;
+        client.init();
+
+        // The first attempt times out, the retry gets the answer
+        auto outcome = wait(client.get(address).timeout(timeout).retries(1).send());
+        EXPECT_EQ(outcome.body, "1") << outcome.error;
+
+        client.shutdown();
+        server.shutdown();
+    }
+
+    {
+        Http::Endpoint server(Address(IP::loopback(), Port(0)));
+        serveSlowFirst(server, delay);
+        const std::string address = "127.0.0.1:" + server.getPort().toString();
+
+        Http::Experimental::Client client;
+        client.init();
+
+        // Not idempotent, the request is sent once
+        auto outcome = wait(client.post(address).timeout(timeout).retries(1).send());
+        EXPECT_EQ(outcome.error, "Timeout");
+
+        client.shutdown();
+        server.shutdown();
+    }
+
+    {
+        Http::Endpoint server(Address(IP::loopback(), Port(0)));
+        serveSlowFirst(server, delay);
+        const std::string address = "127.0.0.1:" + server.getPort().toString();
+
+        // An empty budget allows no retry
+        Http::Experimental::Client client;
+        client.init(Http::Experimental::Client::options().retryBudget(0, 0));
+
+        auto outcome = wait(client.get(address).timeout(timeout).retries(1).send());
+        EXPECT_EQ(outcome.error, "Timeout");
+
+        client.shutdown();
+        server.shutdown();
+    }
+}
+
+TEST(http_client_test, cancelled_requests_free_their_connection)
+{
+    Http::Endpoint server(Address(IP::loopback(), Port(0)));
+    serveSlowFirst(server, std::chrono::milliseconds(1000));
+    const std::string address = "127.0.0.1:" + server.getPort().toString();
+
+    Http::Experimental::Client client;
+    client.init(Http::Experimental::Client::options().maxConnectionsPerHost(1));
+
+    Async::CancellationSource source;
+    std::atomic<bool> chained { false };
+    auto response = client.get(address).cancellation(source.token()).send();
+    auto next     = response.then([&](Http::Response rsp) {
+        chained = true;
+        return rsp;
+    },
+                                  Async::Throw);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    source.cancel();
+
+    EXPECT_EQ(wait(std::move(next)).error, "Cancelled");
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(800));
+    EXPECT_FALSE(chained.load());
+
+    // The single connection of the host went back to the pool
+    EXPECT_EQ(wait(client.get(address).send()).body, "1");
+
+    // Already cancelled, the request is not sent
+    EXPECT_EQ(wait(client.get(address).cancellation(source.token()).send()).error, "Cancelled");
+
+    client.shutdown();
+    server.shutdown();
+}
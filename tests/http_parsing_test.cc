@@ -9,6 +9,7 @@
 #include <pistache/stream.h>
 
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -76,6 +77,184 @@ TEST(http_parsing_test, parser_reset)
     ASSERT_EQ(parser.request.body(), "");
 }
 
+TEST(http_parsing_test, parser_pool_reuses_released_parsers)
+{
+    Http::Private::ParserPool pool;
+
+    auto parser = pool.acquire(Const::DefaultMaxRequestSize, false);
+    auto* raw   = parser.get();
+    ASSERT_EQ(pool.active(), 1u);
+    ASSERT_EQ(pool.pooled(), 0u);
+
+    pool.release(std::move(parser));
+    ASSERT_EQ(pool.active(), 0u);
+    ASSERT_EQ(pool.pooled(), 1u);
+
+    auto reused = pool.acquire(Const::DefaultMaxRequestSize, false);
+    ASSERT_EQ(reused.get(), raw);
+    ASSERT_EQ(pool.pooled(), 0u);
+
+    // The parser of a dropped connection is not handed back
+    reused.reset();
+    ASSERT_EQ(pool.active(), 0u);
+    ASSERT_EQ(pool.pooled(), 0u);
+
+    // Copies of a handler do not share their parsers
+    pool.release(pool.acquire(Const::DefaultMaxRequestSize, false));
+    Http::Private::ParserPool copy(pool);
+    ASSERT_EQ(copy.pooled(), 0u);
+    ASSERT_EQ(pool.pooled(), 1u);
+}
+
+TEST(http_parsing_test, lazy_headers_are_parsed_on_first_access)
+{
+    Http::RequestParser parser(Const::DefaultMaxRequestSize);
+    parser.setLazyHeaders(true);
+
+    auto feed = [&parser](const char* data) {
+        parser.feed(data, std::strlen(data));
+    };
+
+    // The malformed Accept header does not fail the request up front
+    feed("POST /hello HTTP/1.1\r\n");
+    feed("Host: localhost\r\n");
+    feed("Accept: not a media type\r\n");
+    feed("Content-Length: 5\r\n");
+    feed("\r\n");
+    feed("HELLO");
+
+    ASSERT_EQ(parser.parse(), Http::Private::State::Done);
+    ASSERT_EQ(parser.request.body(), "HELLO");
+
+    const auto& headers = parser.request.headers();
+    ASSERT_EQ(headers.rawList().size(), 3u);
+    ASSERT_EQ(headers.get<Http::Header::Host>()->host(), "localhost");
+    ASSERT_THROW(headers.get<Http::Header::Accept>(), std::exception);
+}
+
+TEST(http_parsing_test, lazy_headers_keep_the_raw_list_of_the_eager_ones)
+{
+    const std::string request = "GET / HTTP/1.1\r\n"
+                                "Host: localhost\r\n"
+                                "Accept: text/html\r\n"
+                                "X-Custom: value\r\n"
+                                "\r\n";
+
+    std::vector<std::string> names[2];
+    for (const bool lazy : { false, true })
+    {
+        Http::RequestParser parser(Const::DefaultMaxRequestSize);
+        parser.setLazyHeaders(lazy);
+        parser.feed(request.data(), request.size());
+        ASSERT_EQ(parser.parse(), Http::Private::State::Done);
+
+        for (const auto& entry : parser.request.headers().rawList())
+            names[lazy].push_back(entry.first);
+    }
+
+    ASSERT_EQ(names[0], names[1]);
+    ASSERT_EQ(names[1].size(), 3u);
+}
+
+TEST(http_parsing_test, lazy_headers_are_parsed_once_across_threads)
+{
+    Http::RequestParser parser(Const::DefaultMaxRequestSize);
+    parser.setLazyHeaders(true);
+
+    const std::string request = "GET / HTTP/1.1\r\n"
+                                "Host: localhost\r\n"
+                                "User-Agent: test\r\n"
+                                "\r\n";
+    parser.feed(request.data(), request.size());
+    ASSERT_EQ(parser.parse(), Http::Private::State::Done);
+
+    // Read from several threads, as a handler may with a const request
+    const auto& headers = parser.request.headers();
+    std::vector<std::shared_ptr<const Http::Header::Host>> seen(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < seen.size(); ++i)
+    {
+        threads.emplace_back([&headers, &seen, i] {
+            seen[i] = headers.get<Http::Header::Host>();
+            ASSERT_EQ(headers.list().size(), 2u);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    for (const auto& host : seen)
+        ASSERT_EQ(host, seen[0]);
+    ASSERT_EQ(seen[0]->host(), "localhost");
+}
+
+TEST(http_parsing_test, chunked_bodies_split_anywhere)
+{
+    const std::string request = "POST /upload HTTP/1.1\r\n"
+                                "Host: localhost\r\n"
+                                "Transfer-Encoding: chunked\r\n"
+                                "\r\n"
+                                "5\r\nhello\r\n"
+                                "1;name=value\r\n \r\n"
+                                "A \r\n0123456789\r\n"
+                                "0\r\n\r\n";
+
+    for (const bool inPlace : { false, true })
+    {
+        Http::RequestParser parser(Const::DefaultMaxRequestSize);
+        parser.setInPlaceChunks(inPlace);
+
+        // Every chunk line and payload is split, its CRLF included
+        for (int round = 0; round < 2; ++round)
+        {
+            Http::Private::State state = Http::Private::State::Again;
+            for (size_t i = 0; i < request.size(); ++i)
+            {
+                ASSERT_EQ(state, Http::Private::State::Again);
+                parser.feed(&request[i], 1);
+                state = parser.parse();
+            }
+            ASSERT_EQ(state, Http::Private::State::Done);
+            ASSERT_EQ(parser.request.body(), "hello 0123456789") << inPlace;
+            parser.reset();
+        }
+    }
+}
+
+TEST(http_parsing_test, chunked_bodies_refuse_bad_sizes)
+{
+    auto parse = [](const std::string& chunks) {
+        Http::RequestParser parser(1024);
+        const std::string request = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n" + chunks;
+        parser.feed(request.data(), request.size());
+        try
+        {
+            parser.parse();
+        }
+        catch (const Http::HttpError& err)
+        {
+            return static_cast<Http::Code>(err.code());
+        }
+        return Http::Code::Ok;
+    };
+
+    ASSERT_EQ(parse("5\r\nhello\r\n0\r\n\r\n"), Http::Code::Ok);
+    ASSERT_EQ(parse("x\r\n"), Http::Code::Bad_Request);
+    ASSERT_EQ(parse("-5\r\n"), Http::Code::Bad_Request);
+    ASSERT_EQ(parse("5x\r\n"), Http::Code::Bad_Request);
+    ASSERT_EQ(parse("5\r\nhelloXX"), Http::Code::Bad_Request);
+
+    // Larger than the request may be, refused before its payload
+    ASSERT_EQ(parse("800\r\n"), Http::Code::Request_Entity_Too_Large);
+    ASSERT_EQ(parse("ffffffffffffffffff\r\n"), Http::Code::Request_Entity_Too_Large);
+
+    // Less is left of the body than a single digit may be
+    ASSERT_EQ(Http::Private::parseChunkSize("3", 3), 3u);
+    ASSERT_EQ(Http::Private::parseChunkSize("0", 0), 0u);
+    ASSERT_THROW(Http::Private::parseChunkSize("4", 3), Http::HttpError);
+    ASSERT_THROW(Http::Private::parseChunkSize("f", 3), Http::HttpError);
+    ASSERT_THROW(Http::Private::parseChunkSize("10", 15), Http::HttpError);
+}
+
 TEST(http_parsing_test, succ_response_line_step)
 {
     Http::Response response;
@@ -331,6 +331,292 @@ TEST(http_server_test, multiple_client_with_requests_to_multithreaded_server)
     ASSERT_EQ(res2, SECOND_CLIENT_REQUEST_SIZE);
 }
 
+TEST(http_server_test, multiple_client_with_requests_to_io_uring_server)
+{
+    if (!Polling::Epoll::isSupported(Polling::Backend::IoUring))
+        GTEST_SKIP() << "io_uring is not supported by the running kernel";
+
+    const Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto flags       = Tcp::Options::ReuseAddr;
+    auto server_opts = Http::Endpoint::options()
+                           .flags(flags)
+                           .threads(2)
+                           .pollingBackend(Polling::Backend::IoUring);
+    server.init(server_opts);
+    server.setHandler(Http::make_handler<HelloHandlerWithDelay>());
+    ASSERT_NO_THROW(server.serveThreaded());
+
+    const std::string server_address = "localhost:" + server.getPort().toString();
+    LOGGER("test", "Server address: " << server_address);
+
+    const int NO_TIMEOUT          = 0;
+    const int SIX_SECONDS_TIMOUT  = 6;
+    const int CLIENT_REQUEST_SIZE = 8;
+    int counter                   = clientLogicFunc(CLIENT_REQUEST_SIZE, server_address,
+                                  NO_TIMEOUT, SIX_SECONDS_TIMOUT);
+
+    server.shutdown();
+
+    ASSERT_EQ(counter, CLIENT_REQUEST_SIZE);
+}
+
+TEST(http_server_test, multiple_client_with_requests_with_each_dispatch_policy)
+{
+    const Tcp::DispatchPolicy policies[] = {
+        Tcp::DispatchPolicy::FdModulo,
+        Tcp::DispatchPolicy::RoundRobin,
+        Tcp::DispatchPolicy::LeastConnections,
+        Tcp::DispatchPolicy::PowerOfTwoChoices,
+        Tcp::DispatchPolicy::LeastLoaded,
+    };
+
+    for (auto policy : policies)
+    {
+        const Pistache::Address address("localhost", Pistache::Port(0));
+
+        Http::Endpoint server(address);
+        auto flags       = Tcp::Options::ReuseAddr;
+        auto server_opts = Http::Endpoint::options()
+                               .flags(flags)
+                               .threads(3)
+                               .dispatchPolicy(policy);
+        server.init(server_opts);
+        server.setHandler(Http::make_handler<HelloHandlerWithDelay>());
+        ASSERT_NO_THROW(server.serveThreaded());
+
+        const std::string server_address = "localhost:" + server.getPort().toString();
+
+        const int NO_TIMEOUT          = 0;
+        const int SIX_SECONDS_TIMOUT  = 6;
+        const int CLIENT_REQUEST_SIZE = 8;
+        int counter                   = clientLogicFunc(CLIENT_REQUEST_SIZE, server_address,
+                                      NO_TIMEOUT, SIX_SECONDS_TIMOUT);
+
+        server.shutdown();
+
+        ASSERT_EQ(counter, CLIENT_REQUEST_SIZE) << "policy " << static_cast<int>(policy);
+    }
+}
+
+TEST(http_server_test, multiple_client_with_requests_to_accept_per_worker_server)
+{
+    const Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto flags       = Tcp::Options::ReuseAddr;
+    auto server_opts = Http::Endpoint::options()
+                           .flags(flags)
+                           .threads(4)
+                           .acceptPerWorker(true);
+    server.init(server_opts);
+    server.setHandler(Http::make_handler<HelloHandlerWithDelay>());
+    ASSERT_NO_THROW(server.serveThreaded());
+
+    const std::string server_address = "localhost:" + server.getPort().toString();
+    LOGGER("test", "Server address: " << server_address);
+
+    const int NO_TIMEOUT          = 0;
+    const int SIX_SECONDS_TIMOUT  = 6;
+    const int CLIENT_REQUEST_SIZE = 16;
+    std::future<int> result1(std::async(clientLogicFunc,
+                                        CLIENT_REQUEST_SIZE, server_address,
+                                        NO_TIMEOUT, SIX_SECONDS_TIMOUT));
+    std::future<int> result2(std::async(clientLogicFunc,
+                                        CLIENT_REQUEST_SIZE, server_address,
+                                        NO_TIMEOUT, SIX_SECONDS_TIMOUT));
+
+    int res1 = result1.get();
+    int res2 = result2.get();
+
+    server.shutdown();
+
+    ASSERT_EQ(res1, CLIENT_REQUEST_SIZE);
+    ASSERT_EQ(res2, CLIENT_REQUEST_SIZE);
+}
+
+TEST(http_server_test, multiple_client_with_requests_to_several_accept_threads)
+{
+    const Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto flags       = Tcp::Options::ReuseAddr | Tcp::Options::DeferAccept;
+    auto server_opts = Http::Endpoint::options()
+                           .flags(flags)
+                           .threads(3)
+                           .acceptThreads(3)
+                           .dispatchPolicy(Tcp::DispatchPolicy::RoundRobin);
+    server.init(server_opts);
+    server.setHandler(Http::make_handler<HelloHandlerWithDelay>());
+    ASSERT_NO_THROW(server.serveThreaded());
+
+    const std::string server_address = "localhost:" + server.getPort().toString();
+
+    const int NO_TIMEOUT          = 0;
+    const int SIX_SECONDS_TIMOUT  = 6;
+    const int CLIENT_REQUEST_SIZE = 16;
+    std::future<int> result1(std::async(clientLogicFunc,
+                                        CLIENT_REQUEST_SIZE, server_address,
+                                        NO_TIMEOUT, SIX_SECONDS_TIMOUT));
+    std::future<int> result2(std::async(clientLogicFunc,
+                                        CLIENT_REQUEST_SIZE, server_address,
+                                        NO_TIMEOUT, SIX_SECONDS_TIMOUT));
+
+    int res1 = result1.get();
+    int res2 = result2.get();
+
+    server.shutdown();
+
+    ASSERT_EQ(res1, CLIENT_REQUEST_SIZE);
+    ASSERT_EQ(res2, CLIENT_REQUEST_SIZE);
+}
+
+TEST(http_server_test, multiple_client_with_requests_to_busy_polling_server)
+{
+    const Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto flags       = Tcp::Options::ReuseAddr;
+    auto server_opts = Http::Endpoint::options()
+                           .flags(flags)
+                           .threads(2)
+                           .busyPoll(std::chrono::microseconds(200), true);
+    server.init(server_opts);
+    server.setHandler(Http::make_handler<HelloHandlerWithDelay>());
+    ASSERT_NO_THROW(server.serveThreaded());
+
+    const std::string server_address = "localhost:" + server.getPort().toString();
+
+    const int NO_TIMEOUT          = 0;
+    const int SIX_SECONDS_TIMOUT  = 6;
+    const int CLIENT_REQUEST_SIZE = 16;
+    std::future<int> result1(std::async(clientLogicFunc,
+                                        CLIENT_REQUEST_SIZE, server_address,
+                                        NO_TIMEOUT, SIX_SECONDS_TIMOUT));
+    std::future<int> result2(std::async(clientLogicFunc,
+                                        CLIENT_REQUEST_SIZE, server_address,
+                                        NO_TIMEOUT, SIX_SECONDS_TIMOUT));
+
+    int res1 = result1.get();
+    int res2 = result2.get();
+
+    server.shutdown();
+
+    ASSERT_EQ(res1, CLIENT_REQUEST_SIZE);
+    ASSERT_EQ(res2, CLIENT_REQUEST_SIZE);
+}
+
+TEST(http_server_test, endpoints_sharing_a_worker_pool)
+{
+    auto pool = std::make_shared<Tcp::WorkerPool>(Aio::AsyncContext(2, "shared"));
+
+    Http::Endpoint first(Address(IP::loopback(), Port(0)));
+    Http::Endpoint second(Address(IP::loopback(), Port(0)));
+    for (auto* endpoint : { &first, &second })
+    {
+        endpoint->init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr).workerPool(pool));
+        endpoint->setHandler(Http::make_handler<HelloHandlerWithDelay>());
+        ASSERT_NO_THROW(endpoint->serveThreaded());
+    }
+
+    const int NO_TIMEOUT          = 0;
+    const int SIX_SECONDS_TIMOUT  = 6;
+    const int CLIENT_REQUEST_SIZE = 8;
+    for (auto* endpoint : { &first, &second })
+    {
+        const std::string address = "localhost:" + endpoint->getPort().toString();
+        ASSERT_EQ(clientLogicFunc(CLIENT_REQUEST_SIZE, address, NO_TIMEOUT, SIX_SECONDS_TIMOUT),
+                  CLIENT_REQUEST_SIZE);
+    }
+
+    // Its connections go away, the workers keep serving the other one
+    first.shutdown();
+    const std::string address = "localhost:" + second.getPort().toString();
+    ASSERT_EQ(clientLogicFunc(CLIENT_REQUEST_SIZE, address, NO_TIMEOUT, SIX_SECONDS_TIMOUT),
+              CLIENT_REQUEST_SIZE);
+    second.shutdown();
+}
+
+TEST(http_server_test, multiple_client_with_requests_to_numa_aware_server)
+{
+    const Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto flags       = Tcp::Options::ReuseAddr;
+    auto server_opts = Http::Endpoint::options()
+                           .flags(flags)
+                           .threads(3)
+                           .numaAware(true);
+    server.init(server_opts);
+    server.setHandler(Http::make_handler<HelloHandlerWithDelay>());
+    ASSERT_NO_THROW(server.serveThreaded());
+
+    const std::string server_address = "localhost:" + server.getPort().toString();
+
+    const int NO_TIMEOUT          = 0;
+    const int SIX_SECONDS_TIMOUT  = 6;
+    const int CLIENT_REQUEST_SIZE = 8;
+    int counter                   = clientLogicFunc(CLIENT_REQUEST_SIZE, server_address,
+                                  NO_TIMEOUT, SIX_SECONDS_TIMOUT);
+
+    server.shutdown();
+
+    ASSERT_EQ(counter, CLIENT_REQUEST_SIZE);
+}
+
+TEST(http_server_test, multiple_client_with_requests_to_auto_sized_server)
+{
+    const Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto server_opts = Http::Endpoint::options()
+                           .flags(Tcp::Options::ReuseAddr)
+                           .threads(Http::Endpoint::Options::AutoThreads)
+                           .pinWorkers(true);
+    server.init(server_opts);
+    server.setHandler(Http::make_handler<HelloHandlerWithDelay>());
+    ASSERT_NO_THROW(server.serveThreaded());
+
+    const std::string server_address = "localhost:" + server.getPort().toString();
+
+    const int NO_TIMEOUT          = 0;
+    const int SIX_SECONDS_TIMOUT  = 6;
+    const int CLIENT_REQUEST_SIZE = 8;
+    int counter                   = clientLogicFunc(CLIENT_REQUEST_SIZE, server_address,
+                                  NO_TIMEOUT, SIX_SECONDS_TIMOUT);
+
+    server.shutdown();
+
+    ASSERT_EQ(counter, CLIENT_REQUEST_SIZE);
+}
+
+TEST(http_server_test, multiple_client_with_requests_to_server_with_buffer_pool)
+{
+    const Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto server_opts = Http::Endpoint::options()
+                           .flags(Tcp::Options::ReuseAddr)
+                           .threads(2)
+                           .bufferPool(1024 * 1024);
+    server.init(server_opts);
+    server.setHandler(Http::make_handler<HelloHandlerWithDelay>());
+    ASSERT_NO_THROW(server.serveThreaded());
+
+    const std::string server_address = "localhost:" + server.getPort().toString();
+
+    const int NO_TIMEOUT          = 0;
+    const int SIX_SECONDS_TIMOUT  = 6;
+    const int CLIENT_REQUEST_SIZE = 8;
+    int counter                   = clientLogicFunc(CLIENT_REQUEST_SIZE, server_address,
+                                  NO_TIMEOUT, SIX_SECONDS_TIMOUT);
+
+    server.shutdown();
+
+    ASSERT_EQ(counter, CLIENT_REQUEST_SIZE);
+}
+
 TEST(http_server_test,
      multiple_client_with_different_requests_to_multithreaded_server)
 {
@@ -741,95 +1027,1280 @@ TEST(http_server_test, client_request_no_timeout)
     server.shutdown();
 }
 
-namespace
+struct ManyChunksHandler : public Http::Handler
 {
+    HTTP_PROTOTYPE(ManyChunksHandler)
 
-    class WaitHelper
+    static constexpr size_t ChunksCount = 64;
+
+    void onRequest(const Http::Request&, Http::ResponseWriter writer) override
     {
-    public:
-        void increment()
+        auto stream = writer.stream(Http::Code::Ok);
+        for (size_t i = 0; i < ChunksCount; ++i)
         {
-            std::lock_guard<std::mutex> lock(counterLock_);
-            ++counter_;
-            cv_.notify_one();
+            stream << "chunk";
+            stream.flush();
         }
+        stream.ends();
+    }
+};
 
-        template <typename Duration>
-        bool wait(const size_t count, const Duration timeout)
-        {
-            std::unique_lock<std::mutex> lock(counterLock_);
-            return cv_.wait_for(lock, timeout,
-                                [this, count]() { return counter_ >= count; });
-        }
+// Half of the chunks are written from another thread, the rest from the
+// thread of the transport once the first half has been queued
+struct OffloadedChunksHandler : public Http::Handler
+{
+    HTTP_PROTOTYPE(OffloadedChunksHandler)
 
-    private:
-        size_t counter_ = 0;
-        std::mutex counterLock_;
-        std::condition_variable cv_;
-    };
+    static constexpr size_t ChunksCount = ManyChunksHandler::ChunksCount;
 
-    struct ClientCountingHandler : public Http::Handler
+    void onRequest(const Http::Request&, Http::ResponseWriter writer) override
     {
-        HTTP_PROTOTYPE(ClientCountingHandler)
-
-        explicit ClientCountingHandler(std::shared_ptr<WaitHelper> waitHelper)
-            : waitHelper(waitHelper)
-        { }
+        auto stream = std::make_shared<Http::ResponseStream>(writer.stream(Http::Code::Ok));
+        auto* transport = writer.transport();
 
-        void onRequest(const Http::Request& request,
-                       Http::ResponseWriter writer) override
-        {
-            auto peer = writer.getPeer();
-            if (peer)
-            {
-                activeConnections.insert(peer->getID());
-            }
-            else
+        std::thread([stream, transport] {
+            for (size_t i = 0; i < ChunksCount / 2; ++i)
             {
-                return;
+                *stream << "chunk";
+                stream->flush();
             }
-            std::string requestAddress = request.address().host();
-            writer.send(Http::Code::Ok, requestAddress);
-            LOGGER("server", "Sent `" << requestAddress << "` to " << *peer);
-        }
-
-        void onDisconnection(const std::shared_ptr<Tcp::Peer>& peer) override
-        {
-            LOGGER("server", "Disconnect from " << *peer);
-            activeConnections.erase(peer->getID());
-            waitHelper->increment();
-        }
-
-    private:
-        std::unordered_set<size_t> activeConnections;
-        std::shared_ptr<WaitHelper> waitHelper;
-    };
 
-} // namespace
+            transport->post([stream] {
+                for (size_t i = ChunksCount / 2; i < ChunksCount; ++i)
+                {
+                    *stream << "chunk";
+                    stream->flush();
+                }
+                stream->ends();
+            });
+        }).detach();
+    }
+};
 
-TEST(http_server_test, client_multiple_requests_disconnects_handled)
+template <typename Handler>
+void expectAllChunksInOrder(bool autoCork = false)
 {
-    const Pistache::Address address("localhost", Pistache::Port(0));
+    Pistache::Address address("localhost", Pistache::Port(0));
 
     Http::Endpoint server(address);
-    auto flags       = Tcp::Options::ReuseAddr;
-    auto server_opts = Http::Endpoint::options().flags(flags);
-    server.init(server_opts);
+    auto flags = Tcp::Options::ReuseAddr;
+    auto opts  = Http::Endpoint::options().flags(flags).autoCork(autoCork);
 
-    std::cout << "Trying to run server...\n";
-    auto waitHelper = std::make_shared<WaitHelper>();
-    auto handler    = Http::make_handler<ClientCountingHandler>(waitHelper);
-    server.setHandler(handler);
+    server.init(opts);
+    server.setHandler(Http::make_handler<Handler>());
     server.serveThreaded();
 
-    const std::string server_address = "localhost:" + server.getPort().toString();
-    std::cout << "Server address: " << server_address << "\n";
+    auto port = server.getPort();
 
-    const size_t CLIENT_REQUEST_SIZE = 3;
-    clientLogicFunc(CLIENT_REQUEST_SIZE, server_address, 1, 6);
+    TcpClient client;
+    EXPECT_TRUE(client.connect(Pistache::Address("localhost", port))) << client.lastError();
+    EXPECT_TRUE(client.send("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n")) << client.lastError();
+
+    std::string received;
+    while (received.find("\r\n0\r\n\r\n") == std::string::npos)
+    {
+        char recvBuf[1024];
+        size_t bytes;
+        if (!client.receive(recvBuf, sizeof(recvBuf), &bytes, std::chrono::seconds(5)) || bytes == 0)
+            break;
+
+        received.append(recvBuf, bytes);
+    }
 
-    const bool result = waitHelper->wait(CLIENT_REQUEST_SIZE, std::chrono::seconds(2));
     server.shutdown();
 
-    ASSERT_EQ(result, true);
+    std::string expected;
+    for (size_t i = 0; i < Handler::ChunksCount; ++i)
+        expected += "5\r\nchunk\r\n";
+    expected += "0\r\n\r\n";
+
+    auto body = received.find("\r\n\r\n");
+    ASSERT_NE(body, std::string::npos);
+    ASSERT_EQ(received.substr(body + 4), expected);
+}
+
+TEST(http_server_test, many_small_chunks_are_all_sent_in_order)
+{
+    expectAllChunksInOrder<ManyChunksHandler>();
+}
+
+TEST(http_server_test, chunks_written_from_several_threads_are_sent_in_order)
+{
+    expectAllChunksInOrder<OffloadedChunksHandler>();
+}
+
+TEST(http_server_test, corked_chunks_are_all_sent_in_order)
+{
+    expectAllChunksInOrder<ManyChunksHandler>(true);
+    expectAllChunksInOrder<OffloadedChunksHandler>(true);
+}
+
+TEST(http_server_test, corked_responses_are_sent_on_a_kept_alive_connection)
+{
+    Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto flags = Tcp::Options::ReuseAddr;
+    auto opts  = Http::Endpoint::options().flags(flags).autoCork(true);
+
+    server.init(opts);
+    server.setHandler(Http::make_handler<PingHandler>());
+    server.serveThreaded();
+
+    TcpClient client;
+    EXPECT_TRUE(client.connect(Pistache::Address("localhost", server.getPort()))) << client.lastError();
+
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_TRUE(client.send("GET /ping HTTP/1.1\r\nHost: localhost\r\n\r\n")) << client.lastError();
+
+        std::string received;
+        while (received.find("PONG") == std::string::npos)
+        {
+            char recvBuf[1024];
+            size_t bytes;
+            if (!client.receive(recvBuf, sizeof(recvBuf), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                break;
+
+            received.append(recvBuf, bytes);
+        }
+
+        ASSERT_EQ(received.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << received;
+        ASSERT_NE(received.find("PONG"), std::string::npos) << received;
+    }
+
+    server.shutdown();
+}
+
+namespace
+{
+    std::string receiveUntil(TcpClient& client, const std::string& marker, size_t count)
+    {
+        std::string received;
+        auto seen = [&] {
+            size_t found = 0;
+            for (auto pos = received.find(marker); pos != std::string::npos;
+                 pos      = received.find(marker, pos + marker.size()))
+                ++found;
+            return found;
+        };
+
+        while (seen() < count)
+        {
+            char recvBuf[1024];
+            size_t bytes;
+            if (!client.receive(recvBuf, sizeof(recvBuf), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                break;
+
+            received.append(recvBuf, bytes);
+        }
+
+        return received;
+    }
+} // namespace
+
+TEST(http_server_test, pipelined_requests_are_answered_in_order)
+{
+    Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto flags = Tcp::Options::ReuseAddr;
+    auto opts  = Http::Endpoint::options().flags(flags);
+
+    server.init(opts);
+    server.setHandler(Http::make_handler<PingHandler>());
+    server.serveThreaded();
+
+    TcpClient client;
+    EXPECT_TRUE(client.connect(Pistache::Address("localhost", server.getPort()))) << client.lastError();
+
+    const std::string requests = "GET /ping HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n"
+                                 "GET /missing HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n"
+                                 "GET /ping HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n";
+    EXPECT_TRUE(client.send(requests)) << client.lastError();
+
+    const auto received = receiveUntil(client, "HTTP/1.1 ", 3);
+
+    const auto first  = received.find("HTTP/1.1 200 OK");
+    const auto second = received.find("HTTP/1.1 404 Not Found");
+    const auto third  = received.find("HTTP/1.1 200 OK", first + 1);
+    ASSERT_NE(first, std::string::npos) << received;
+    ASSERT_NE(second, std::string::npos) << received;
+    ASSERT_NE(third, std::string::npos) << received;
+    ASSERT_LT(first, second) << received;
+    ASSERT_LT(second, third) << received;
+
+    server.shutdown();
+}
+
+TEST(http_server_test, worker_stats_settle_once_the_responses_are_written)
+{
+    Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    server.init(Http::Endpoint::options().threads(2).flags(Tcp::Options::ReuseAddr));
+    server.setHandler(Http::make_handler<OffloadedChunksHandler>());
+    server.serveThreaded();
+
+    TcpClient client;
+    EXPECT_TRUE(client.connect(Pistache::Address("localhost", server.getPort()))) << client.lastError();
+    EXPECT_TRUE(client.send("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n")) << client.lastError();
+    const auto received = receiveUntil(client, "0\r\n\r\n", 1);
+    ASSERT_NE(received.find("0\r\n\r\n"), std::string::npos) << received;
+
+    // The counters are updated by the workers as they go, the last ones may
+    // follow the response
+    auto idle = [&] {
+        for (const auto& worker : server.workerStats())
+        {
+            const auto& queues = worker.transport;
+            if (queues.queuedWrites + queues.queuedTimers + queues.queuedPeers
+                    + queues.pendingWriteBytes
+                != 0)
+                return false;
+        }
+        return true;
+    };
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!idle() && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_TRUE(idle());
+
+    const auto stats = server.workerStats();
+    ASSERT_EQ(stats.size(), 2u);
+
+    uint64_t events = 0, calls = 0;
+    for (const auto& worker : stats)
+    {
+        events += worker.loop.events;
+        calls += worker.loop.handlerCalls;
+        EXPECT_GE(worker.loop.events, worker.loop.maxBatch);
+        EXPECT_LE(worker.loop.maxHandler, worker.loop.busy);
+    }
+    EXPECT_GT(events, 0u);
+    EXPECT_GT(calls, 0u);
+
+    server.shutdown();
+}
+
+struct BlobHandler : public Http::Handler
+{
+    HTTP_PROTOTYPE(BlobHandler)
+
+    static std::string blob()
+    {
+        std::string bytes(4 * 1024 * 1024, '\0');
+        for (size_t i = 0; i < bytes.size(); ++i)
+            bytes[i] = static_cast<char>('a' + i % 26);
+        return bytes;
+    }
+
+    void onRequest(const Http::Request&, Http::ResponseWriter response) override
+    {
+        static const SharedBuffer cached(blob());
+        response.sendSerialized(Http::Code::Ok,
+                                { SharedBuffer("HTTP/1.1 200 OK\r\nContent-Length: "
+                                               + std::to_string(cached.size()) + "\r\n\r\n"),
+                                  cached });
+    }
+};
+
+TEST(http_server_test, large_buffers_are_sent_without_a_copy)
+{
+    Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr).zeroCopySends(64 * 1024));
+    server.setHandler(Http::make_handler<BlobHandler>());
+    server.serveThreaded();
+
+    TcpClient client;
+    EXPECT_TRUE(client.connect(Pistache::Address("localhost", server.getPort()))) << client.lastError();
+
+    const auto expected = BlobHandler::blob();
+    for (int i = 0; i < 2; ++i)
+    {
+        EXPECT_TRUE(client.send("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n")) << client.lastError();
+
+        // Read slowly at first, the socket fills up and the send resumes
+        // from where the kernel stopped
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::string received;
+        size_t body = std::string::npos;
+        while (body == std::string::npos || received.size() < body + expected.size())
+        {
+            char recvBuf[64 * 1024];
+            size_t bytes;
+            if (!client.receive(recvBuf, sizeof(recvBuf), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                break;
+            received.append(recvBuf, bytes);
+            if (body == std::string::npos && received.find("\r\n\r\n") != std::string::npos)
+                body = received.find("\r\n\r\n") + 4;
+        }
+        ASSERT_NE(body, std::string::npos);
+        ASSERT_EQ(received.size(), body + expected.size());
+        EXPECT_TRUE(received.compare(body, expected.size(), expected) == 0);
+    }
+
+    // The kernel tells through the error queue, on the loopback it copies
+    auto sends = [&] {
+        size_t total = 0;
+        for (const auto& worker : server.workerStats())
+            total += worker.transport.zeroCopySends;
+        return total;
+    };
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (sends() == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    EXPECT_GT(sends(), 0u);
+
+    server.shutdown();
+}
+
+struct NamedHandler : public Http::Handler
+{
+    HTTP_PROTOTYPE(NamedHandler)
+
+    explicit NamedHandler(std::string name)
+        : name_(std::move(name))
+    { }
+
+    void onRequest(const Http::Request& request, Http::ResponseWriter response) override
+    {
+        if (request.resource() == "/slow")
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        response.send(Http::Code::Ok, name_);
+    }
+
+private:
+    std::string name_;
+};
+
+TEST(http_server_test, listening_socket_is_handed_over_and_drained)
+{
+    Http::Endpoint previous(Pistache::Address(IP::loopback(), Pistache::Port(0)));
+    previous.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr));
+    previous.setHandler(Http::make_handler<NamedHandler>("previous"));
+    previous.serveThreaded();
+    const auto port = previous.getPort();
+
+    // Both connections are served by the previous process
+    const std::string keepAlive = "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: Keep-Alive\r\n\r\n";
+    TcpClient idle, busy;
+    for (auto* client : { &idle, &busy })
+    {
+        ASSERT_TRUE(client->connect(Pistache::Address(IP::loopback(), port))) << client->lastError();
+        ASSERT_TRUE(client->send(keepAlive));
+        EXPECT_NE(receiveUntil(*client, "previous", 1).find("previous"), std::string::npos);
+    }
+    ASSERT_TRUE(busy.send("GET /slow HTTP/1.1\r\nHost: localhost\r\nConnection: Keep-Alive\r\n\r\n"));
+
+    // The next process serves from the same socket
+    int channel[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, channel), 0);
+    previous.sendListenSocket(channel[0]);
+    const Fd inherited = Tcp::Listener::receiveListenSocket(channel[1]);
+    ::close(channel[0]);
+    ::close(channel[1]);
+
+    Http::Endpoint next(Pistache::Address(IP::loopback(), Pistache::Port(0)));
+    next.init(Http::Endpoint::options());
+    next.setHandler(Http::make_handler<NamedHandler>("next"));
+    next.useListenSocket(inherited);
+    next.serveThreaded();
+    EXPECT_EQ(next.getPort(), port);
+
+    auto drained = std::async(std::launch::async, [&] { return previous.drain(std::chrono::seconds(5)); });
+
+    // The request being handled is answered, then the connections close
+    const auto answered = receiveUntil(busy, "previous", 1);
+    EXPECT_NE(answered.find("HTTP/1.1 200 OK"), std::string::npos) << answered;
+    EXPECT_TRUE(receiveUntil(busy, "previous", 1).empty());
+    EXPECT_TRUE(receiveUntil(idle, "previous", 1).empty());
+    EXPECT_TRUE(drained.get());
+
+    TcpClient fresh;
+    ASSERT_TRUE(fresh.connect(Pistache::Address(IP::loopback(), port))) << fresh.lastError();
+    ASSERT_TRUE(fresh.send(keepAlive));
+    EXPECT_NE(receiveUntil(fresh, "next", 1).find("next"), std::string::npos);
+
+    previous.shutdown();
+    next.shutdown();
+}
+
+struct SlowHandler : public Http::Handler
+{
+    HTTP_PROTOTYPE(SlowHandler)
+
+    void onRequest(const Http::Request& request,
+                   Http::ResponseWriter writer) override
+    {
+        if (request.resource() != "/slow")
+        {
+            writer.send(Http::Code::Ok, "FAST");
+            return;
+        }
+
+        auto response = std::make_shared<Http::ResponseWriter>(std::move(writer));
+        std::thread([response] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            response->send(Http::Code::Ok, "SLOW");
+        }).detach();
+    }
+};
+
+TEST(http_server_test, pipelined_requests_wait_for_a_deferred_response)
+{
+    Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto flags = Tcp::Options::ReuseAddr;
+    auto opts  = Http::Endpoint::options().flags(flags);
+
+    server.init(opts);
+    server.setHandler(Http::make_handler<SlowHandler>());
+    server.serveThreaded();
+
+    TcpClient client;
+    EXPECT_TRUE(client.connect(Pistache::Address("localhost", server.getPort()))) << client.lastError();
+
+    const std::string requests = "GET /slow HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n"
+                                 "GET /fast HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\n\r\n";
+    EXPECT_TRUE(client.send(requests)) << client.lastError();
+
+    const auto received = receiveUntil(client, "HTTP/1.1 ", 2);
+
+    const auto slow = received.find("SLOW");
+    const auto fast = received.find("FAST");
+    ASSERT_NE(slow, std::string::npos) << received;
+    ASSERT_NE(fast, std::string::npos) << received;
+    ASSERT_LT(slow, fast) << received;
+
+    server.shutdown();
+}
+
+struct RangeFileHandler : public Http::Handler
+{
+    HTTP_PROTOTYPE(RangeFileHandler)
+
+    explicit RangeFileHandler(const std::string& fileName)
+        : fileName_(fileName)
+    { }
+
+    void onRequest(const Http::Request& request,
+                   Http::ResponseWriter writer) override
+    {
+        Http::serveFile(request, writer, fileName_, MIME(Text, Plain));
+    }
+
+private:
+    std::string fileName_;
+};
+
+namespace
+{
+    class RangeFileServer
+    {
+    public:
+        RangeFileServer()
+            : server(Pistache::Address("localhost", Pistache::Port(0)))
+        {
+            std::ofstream file(fileName, std::ios::trunc);
+            file << "0123456789abcdefghij";
+            file.close();
+
+            server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr));
+            server.setHandler(Http::make_handler<RangeFileHandler>(fileName));
+            server.serveThreaded();
+        }
+
+        ~RangeFileServer()
+        {
+            server.shutdown();
+            std::remove(fileName.c_str());
+        }
+
+        // Head and body of the response, up to its Content-Length
+        std::string get(const std::string& headers)
+        {
+            TcpClient client;
+            EXPECT_TRUE(client.connect(Pistache::Address("localhost", server.getPort()))) << client.lastError();
+            EXPECT_TRUE(client.send("GET / HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n"))
+                << client.lastError();
+
+            std::string received = receiveUntil(client, "\r\n\r\n", 1);
+            const auto headEnd   = received.find("\r\n\r\n");
+            const auto length    = received.find("Content-Length: ");
+            if (headEnd == std::string::npos || length == std::string::npos)
+                return received;
+
+            const auto expected = headEnd + 4 + std::stoul(received.substr(length + 16));
+            while (received.size() < expected)
+            {
+                char recvBuf[1024];
+                size_t bytes;
+                if (!client.receive(recvBuf, sizeof(recvBuf), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                    break;
+                received.append(recvBuf, bytes);
+            }
+
+            return received;
+        }
+
+        const std::string fileName = "/tmp/pistache_range_" + std::to_string(::getpid());
+
+    private:
+        Http::Endpoint server;
+    };
+
+    std::string bodyOf(const std::string& response)
+    {
+        const auto pos = response.find("\r\n\r\n");
+        return pos == std::string::npos ? "" : response.substr(pos + 4);
+    }
+} // namespace
+
+TEST(http_server_test, ranges_of_a_file_are_partial_content)
+{
+    RangeFileServer server;
+
+    auto response = server.get("Range: bytes=2-5\r\n");
+    ASSERT_NE(response.find("HTTP/1.1 206 Partial Content"), std::string::npos) << response;
+    ASSERT_NE(response.find("Content-Range: bytes 2-5/20"), std::string::npos) << response;
+    ASSERT_NE(response.find("Content-Length: 4"), std::string::npos) << response;
+    ASSERT_EQ(bodyOf(response), "2345");
+
+    // Open-ended and suffix ranges, clamped to the file
+    response = server.get("Range: bytes=15-\r\n");
+    ASSERT_EQ(bodyOf(response), "fghij");
+    response = server.get("Range: bytes=-3\r\n");
+    ASSERT_NE(response.find("Content-Range: bytes 17-19/20"), std::string::npos) << response;
+    ASSERT_EQ(bodyOf(response), "hij");
+    response = server.get("Range: bytes=10-100\r\n");
+    ASSERT_EQ(bodyOf(response), "abcdefghij");
+
+    response = server.get("Range: bytes=20-30\r\n");
+    ASSERT_NE(response.find("HTTP/1.1 416"), std::string::npos) << response;
+    ASSERT_NE(response.find("Content-Range: bytes */20"), std::string::npos) << response;
+
+    // Not understood, the whole file is sent
+    response = server.get("Range: bytes=5-2\r\n");
+    ASSERT_NE(response.find("HTTP/1.1 200 OK"), std::string::npos) << response;
+    ASSERT_NE(response.find("Accept-Ranges: bytes"), std::string::npos) << response;
+    ASSERT_EQ(bodyOf(response), "0123456789abcdefghij");
+    response = server.get("Range: lines=1-2\r\n");
+    ASSERT_EQ(bodyOf(response), "0123456789abcdefghij");
+}
+
+TEST(http_server_test, several_ranges_are_a_multipart_body)
+{
+    RangeFileServer server;
+
+    auto response = server.get("Range: bytes=0-1, 18-\r\n");
+    ASSERT_NE(response.find("HTTP/1.1 206 Partial Content"), std::string::npos) << response;
+
+    const std::string marker = "multipart/byteranges; boundary=";
+    const auto pos           = response.find(marker);
+    ASSERT_NE(pos, std::string::npos) << response;
+    const auto boundary = response.substr(pos + marker.size(), response.find("\r\n", pos) - pos - marker.size());
+
+    const auto expected = "\r\n--" + boundary + "\r\nContent-Type: text/plain\r\nContent-Range: bytes 0-1/20\r\n\r\n01"
+        + "\r\n--" + boundary + "\r\nContent-Type: text/plain\r\nContent-Range: bytes 18-19/20\r\n\r\nij"
+        + "\r\n--" + boundary + "--\r\n";
+    ASSERT_EQ(bodyOf(response), expected);
+    ASSERT_NE(response.find("Content-Length: " + std::to_string(expected.size())), std::string::npos) << response;
+}
+
+TEST(http_server_test, ranges_are_ignored_when_if_range_does_not_match)
+{
+    RangeFileServer server;
+
+    auto response = server.get("");
+    const std::string marker = "Last-Modified: ";
+    const auto pos           = response.find(marker);
+    ASSERT_NE(pos, std::string::npos) << response;
+    const auto lastModified = response.substr(pos + marker.size(), response.find("\r\n", pos) - pos - marker.size());
+
+    response = server.get("Range: bytes=0-3\r\nIf-Range: " + lastModified + "\r\n");
+    ASSERT_EQ(bodyOf(response), "0123") << response;
+
+    response = server.get("Range: bytes=0-3\r\nIf-Range: Sat, 01 Jan 2000 00:00:00 GMT\r\n");
+    ASSERT_EQ(bodyOf(response), "0123456789abcdefghij") << response;
+
+    // There is no ETag to compare it to
+    response = server.get("Range: bytes=0-3\r\nIf-Range: \"abc\"\r\n");
+    ASSERT_EQ(bodyOf(response), "0123456789abcdefghij") << response;
+}
+
+struct MovedBodyHandler : public Http::Handler
+{
+    HTTP_PROTOTYPE(MovedBodyHandler)
+
+    static constexpr size_t BodySize = 256 * 1024;
+
+    void onRequest(const Http::Request& /*request*/,
+                   Http::ResponseWriter writer) override
+    {
+        std::string body(BodySize, 'a');
+        for (size_t i = 0; i < body.size(); i += 1024)
+            body[i] = 'b';
+
+        writer.send(Http::Code::Ok, std::move(body));
+    }
+};
+
+TEST(http_server_test, moved_body_is_sent_after_headers)
+{
+    Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto flags = Tcp::Options::ReuseAddr;
+    auto opts  = Http::Endpoint::options().flags(flags);
+
+    server.init(opts);
+    server.setHandler(Http::make_handler<MovedBodyHandler>());
+    server.serveThreaded();
+
+    auto port = server.getPort();
+
+    TcpClient client;
+    EXPECT_TRUE(client.connect(Pistache::Address("localhost", port))) << client.lastError();
+    EXPECT_TRUE(client.send("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n")) << client.lastError();
+
+    std::string received;
+    size_t body = std::string::npos;
+    while (body == std::string::npos || received.size() < body + 4 + MovedBodyHandler::BodySize)
+    {
+        char recvBuf[4096];
+        size_t bytes;
+        if (!client.receive(recvBuf, sizeof(recvBuf), &bytes, std::chrono::seconds(5)) || bytes == 0)
+            break;
+
+        received.append(recvBuf, bytes);
+        body = received.find("\r\n\r\n");
+    }
+
+    server.shutdown();
+
+    ASSERT_NE(body, std::string::npos);
+    ASSERT_NE(received.find("Content-Length: " + std::to_string(MovedBodyHandler::BodySize)),
+              std::string::npos);
+
+    std::string expected(MovedBodyHandler::BodySize, 'a');
+    for (size_t i = 0; i < expected.size(); i += 1024)
+        expected[i] = 'b';
+    ASSERT_EQ(received.substr(body + 4), expected);
+}
+
+struct UploadCheckHandler : public Http::Handler
+{
+    HTTP_PROTOTYPE(UploadCheckHandler)
+
+    static std::string makeBody(size_t size)
+    {
+        std::string body;
+        body.reserve(size);
+        for (size_t i = 0; i < size; ++i)
+            body.push_back(static_cast<char>('a' + (i % 26)));
+        return body;
+    }
+
+    void onRequest(const Http::Request& request,
+                   Http::ResponseWriter writer) override
+    {
+        const auto& body = request.body();
+        if (body == makeBody(body.size()))
+            writer.send(Http::Code::Ok, std::to_string(body.size()));
+        else
+            writer.send(Http::Code::Bad_Request);
+    }
+};
+
+TEST(http_server_test, large_upload_is_received_through_growing_buffer)
+{
+    Pistache::Address address("localhost", Pistache::Port(0));
+
+    const size_t BodySize = 512 * 1024;
+
+    Http::Endpoint server(address);
+    auto flags = Tcp::Options::ReuseAddr;
+    auto opts  = Http::Endpoint::options()
+                    .flags(flags)
+                    .maxRequestSize(BodySize + 1024)
+                    .maxReceiveBufferSize(16 * 1024);
+
+    server.init(opts);
+    server.setHandler(Http::make_handler<UploadCheckHandler>());
+    server.serveThreaded();
+
+    auto port = server.getPort();
+
+    TcpClient client;
+    EXPECT_TRUE(client.connect(Pistache::Address("localhost", port))) << client.lastError();
+
+    std::string request = "POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: "
+        + std::to_string(BodySize) + "\r\n\r\n" + UploadCheckHandler::makeBody(BodySize);
+    EXPECT_TRUE(client.send(request)) << client.lastError();
+
+    std::string received;
+    const std::string expectedBody = std::to_string(BodySize);
+    while (received.size() < expectedBody.size()
+           || received.compare(received.size() - expectedBody.size(), expectedBody.size(), expectedBody) != 0)
+    {
+        char recvBuf[1024];
+        size_t bytes;
+        if (!client.receive(recvBuf, sizeof(recvBuf), &bytes, std::chrono::seconds(5)) || bytes == 0)
+            break;
+
+        received.append(recvBuf, bytes);
+    }
+
+    server.shutdown();
+
+    ASSERT_EQ(received.rfind("HTTP/1.1 200 OK", 0), 0u) << received;
+    auto body = received.find("\r\n\r\n");
+    ASSERT_NE(body, std::string::npos);
+    ASSERT_EQ(received.substr(body + 4), expectedBody);
+}
+
+struct RequestDumpHandler : public Http::Handler
+{
+    HTTP_PROTOTYPE(RequestDumpHandler)
+
+    void onRequest(const Http::Request& request,
+                   Http::ResponseWriter writer) override
+    {
+        std::ostringstream oss;
+        oss << request.resource() << "|" << request.query().as_str() << "|"
+            << request.headers().rawList().size() << "|" << request.body();
+        writer.send(Http::Code::Ok, oss.str());
+    }
+};
+
+TEST(http_server_test, reused_request_storage_does_not_leak_between_requests)
+{
+    Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto flags = Tcp::Options::ReuseAddr;
+    auto opts  = Http::Endpoint::options().flags(flags).reuseRequestStorage(true);
+
+    server.init(opts);
+    server.setHandler(Http::make_handler<RequestDumpHandler>());
+    server.serveThreaded();
+
+    auto port = server.getPort();
+
+    TcpClient client;
+    EXPECT_TRUE(client.connect(Pistache::Address("localhost", port))) << client.lastError();
+
+    auto exchange = [&client](const std::string& request) {
+        EXPECT_TRUE(client.send(request)) << client.lastError();
+
+        std::string received;
+        size_t body   = std::string::npos;
+        size_t length = 0;
+        while (body == std::string::npos || received.size() < body + 4 + length)
+        {
+            char recvBuf[1024];
+            size_t bytes;
+            if (!client.receive(recvBuf, sizeof(recvBuf), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                break;
+
+            received.append(recvBuf, bytes);
+            body = received.find("\r\n\r\n");
+
+            auto header = received.find("Content-Length: ");
+            if (header != std::string::npos && header < body)
+                length = std::stoul(received.substr(header + 16));
+        }
+
+        return body == std::string::npos ? std::string() : received.substr(body + 4);
+    };
+
+    auto first = exchange("POST /first?a=1 HTTP/1.1\r\nHost: localhost\r\n"
+                          "Connection: Keep-Alive\r\nX-Extra: 1\r\n"
+                          "Content-Length: 5\r\n\r\nhello");
+    auto second = exchange("GET /second HTTP/1.1\r\nHost: localhost\r\n"
+                           "Connection: Keep-Alive\r\n\r\n");
+
+    server.shutdown();
+
+    ASSERT_EQ(first, "/first|?a=1|4|hello");
+    ASSERT_EQ(second, "/second||2|");
+}
+
+namespace
+{
+
+    struct ParserStatsHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(ParserStatsHandler)
+
+        void onRequest(const Http::Request& /*request*/,
+                       Http::ResponseWriter writer) override
+        {
+            auto stats = parserStats();
+            writer.send(Http::Code::Ok,
+                        std::to_string(stats.activeParsers) + "|" + std::to_string(stats.pooledParsers));
+        }
+    };
+
+    std::string receiveBody(TcpClient& client)
+    {
+        std::string received;
+        size_t body   = std::string::npos;
+        size_t length = 0;
+        while (body == std::string::npos || received.size() < body + 4 + length)
+        {
+            char recvBuf[1024];
+            size_t bytes;
+            if (!client.receive(recvBuf, sizeof(recvBuf), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                break;
+
+            received.append(recvBuf, bytes);
+            body = received.find("\r\n\r\n");
+
+            auto header = received.find("Content-Length: ");
+            if (header != std::string::npos && header < body)
+                length = std::stoul(received.substr(header + 16));
+        }
+
+        return body == std::string::npos ? std::string() : received.substr(body + 4);
+    }
+
+} // namespace
+
+TEST(http_server_test, idle_connections_hand_their_parser_back)
+{
+    Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto opts = Http::Endpoint::options().flags(Tcp::Options::ReuseAddr).threads(1);
+
+    server.init(opts);
+    server.setHandler(Http::make_handler<ParserStatsHandler>());
+    server.serveThreaded();
+
+    auto port = server.getPort();
+
+    TcpClient first;
+    TcpClient second;
+    EXPECT_TRUE(first.connect(Pistache::Address("localhost", port))) << first.lastError();
+    EXPECT_TRUE(second.connect(Pistache::Address("localhost", port))) << second.lastError();
+
+    const std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: Keep-Alive\r\n\r\n";
+
+    EXPECT_TRUE(first.send(request)) << first.lastError();
+    auto alone = receiveBody(first);
+
+    // The first connection is in the middle of a request and holds the
+    // pooled parser, the second one needs a new one
+    EXPECT_TRUE(first.send("GET / HTTP/1.1\r\n")) << first.lastError();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_TRUE(second.send(request)) << second.lastError();
+    auto both = receiveBody(second);
+
+    EXPECT_TRUE(first.send("Host: localhost\r\nConnection: Keep-Alive\r\n\r\n")) << first.lastError();
+    auto reused = receiveBody(first);
+
+    server.shutdown();
+
+    ASSERT_EQ(alone, "1|0");
+    ASSERT_EQ(both, "2|0");
+    ASSERT_EQ(reused, "1|1");
+
+    ParserStatsHandler handler;
+    const auto idleBytes = handler.parserStats().bytesPerIdleConnection;
+    ASSERT_GT(idleBytes, sizeof(Http::Private::ConnectionState));
+    ASSERT_LT(idleBytes, sizeof(Http::RequestParser));
+}
+
+namespace
+{
+    struct RequestsSlot : Tcp::PeerSlot<int>
+    { };
+
+    // Answers with the number of requests of the connection so far
+    struct PeerSlotHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(PeerSlotHandler)
+
+        void onRequest(const Http::Request&, Http::ResponseWriter response) override
+        {
+            auto peer = response.peer();
+            if (peer->slot<RequestsSlot>() == nullptr)
+                peer->putSlot<RequestsSlot>(std::make_shared<int>(0));
+
+            response.send(Http::Code::Ok, std::to_string(++*peer->slot<RequestsSlot>()));
+        }
+    };
+} // namespace
+
+TEST(http_server_test, peer_slots_keep_the_state_of_a_connection)
+{
+    Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr).threads(1));
+    server.setHandler(Http::make_handler<PeerSlotHandler>());
+    server.serveThreaded();
+
+    const std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: Keep-Alive\r\n\r\n";
+
+    TcpClient first;
+    TcpClient second;
+    EXPECT_TRUE(first.connect(Pistache::Address("localhost", server.getPort()))) << first.lastError();
+    EXPECT_TRUE(second.connect(Pistache::Address("localhost", server.getPort()))) << second.lastError();
+
+    std::vector<std::string> bodies;
+    for (auto* client : { &first, &first, &second, &first })
+    {
+        EXPECT_TRUE(client->send(request)) << client->lastError();
+        bodies.push_back(receiveBody(*client));
+    }
+
+    server.shutdown();
+
+    ASSERT_EQ(bodies, (std::vector<std::string> { "1", "2", "1", "3" }));
+
+    // The key of the handler and this one each have their own slot
+    auto peer = Tcp::Peer::Create(-1, Pistache::Address("localhost", Pistache::Port(0)));
+    ASSERT_EQ(peer->slot<RequestsSlot>(), nullptr);
+    ASSERT_EQ(Http::Handler::connectionState(*peer), nullptr);
+    peer->putSlot<RequestsSlot>(std::make_shared<int>(7));
+    ASSERT_EQ(*peer->sharedSlot<RequestsSlot>(), 7);
+    ASSERT_EQ(Http::Handler::connectionState(*peer), nullptr);
+}
+
+namespace
+{
+
+    class WaitHelper
+    {
+    public:
+        void increment()
+        {
+            std::lock_guard<std::mutex> lock(counterLock_);
+            ++counter_;
+            cv_.notify_one();
+        }
+
+        template <typename Duration>
+        bool wait(const size_t count, const Duration timeout)
+        {
+            std::unique_lock<std::mutex> lock(counterLock_);
+            return cv_.wait_for(lock, timeout,
+                                [this, count]() { return counter_ >= count; });
+        }
+
+    private:
+        size_t counter_ = 0;
+        std::mutex counterLock_;
+        std::condition_variable cv_;
+    };
+
+    // Holds the responses until a number of requests have been received,
+    // the client then has to send them on as many connections
+    class ResponseLatch
+    {
+    public:
+        explicit ResponseLatch(size_t count)
+            : count_(count)
+        { }
+
+        void hold(Http::ResponseWriter writer, std::string body)
+        {
+            std::vector<std::pair<Http::ResponseWriter, std::string>> released;
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                held_.emplace_back(std::move(writer), std::move(body));
+                if (held_.size() < count_)
+                    return;
+                released.swap(held_);
+            }
+
+            for (auto& [held, body] : released)
+                held.send(Http::Code::Ok, body);
+        }
+
+    private:
+        const size_t count_;
+        std::mutex lock_;
+        std::vector<std::pair<Http::ResponseWriter, std::string>> held_;
+    };
+
+    struct ClientCountingHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(ClientCountingHandler)
+
+        ClientCountingHandler(std::shared_ptr<WaitHelper> waitHelper,
+                              std::shared_ptr<ResponseLatch> latch)
+            : waitHelper(waitHelper)
+            , latch(latch)
+        { }
+
+        void onRequest(const Http::Request& request,
+                       Http::ResponseWriter writer) override
+        {
+            auto peer = writer.getPeer();
+            if (peer)
+            {
+                activeConnections.insert(peer->getID());
+            }
+            else
+            {
+                return;
+            }
+            std::string requestAddress = request.address().host();
+            LOGGER("server", "Holding `" << requestAddress << "` for " << *peer);
+            latch->hold(std::move(writer), std::move(requestAddress));
+        }
+
+        void onDisconnection(const std::shared_ptr<Tcp::Peer>& peer) override
+        {
+            LOGGER("server", "Disconnect from " << *peer);
+            activeConnections.erase(peer->getID());
+            waitHelper->increment();
+        }
+
+    private:
+        std::unordered_set<size_t> activeConnections;
+        std::shared_ptr<WaitHelper> waitHelper;
+        std::shared_ptr<ResponseLatch> latch;
+    };
+
+} // namespace
+
+TEST(http_server_test, client_multiple_requests_disconnects_handled)
+{
+    const Pistache::Address address("localhost", Pistache::Port(0));
+
+    Http::Endpoint server(address);
+    auto flags       = Tcp::Options::ReuseAddr;
+    auto server_opts = Http::Endpoint::options().flags(flags);
+    server.init(server_opts);
+
+    std::cout << "Trying to run server...\n";
+    const size_t CLIENT_REQUEST_SIZE = 3;
+    auto waitHelper = std::make_shared<WaitHelper>();
+    auto latch      = std::make_shared<ResponseLatch>(CLIENT_REQUEST_SIZE);
+    auto handler    = Http::make_handler<ClientCountingHandler>(waitHelper, latch);
+    server.setHandler(handler);
+    server.serveThreaded();
+
+    const std::string server_address = "localhost:" + server.getPort().toString();
+    std::cout << "Server address: " << server_address << "\n";
+
+    // Every request waits for the other ones, each has its own connection
+    const int resolved = clientLogicFunc(CLIENT_REQUEST_SIZE, server_address, 1, 6);
+    EXPECT_EQ(resolved, static_cast<int>(CLIENT_REQUEST_SIZE));
+
+    const bool result = waitHelper->wait(CLIENT_REQUEST_SIZE, std::chrono::seconds(2));
+    server.shutdown();
+
+    ASSERT_EQ(result, true);
+}
+
+namespace
+{
+    // Keeps the writers of the requests, with their cancellation, and
+    // answers none of them
+    struct CancellationHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(CancellationHandler)
+
+        struct Held
+        {
+            std::mutex lock;
+            std::vector<Http::ResponseWriter> writers;
+            std::vector<Async::CancellationToken> tokens;
+        };
+
+        explicit CancellationHandler(std::shared_ptr<Held> held)
+            : held(std::move(held))
+        { }
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter writer) override
+        {
+            if (request.resource() == "/timeout")
+                writer.timeoutAfter(std::chrono::milliseconds(50));
+
+            std::lock_guard<std::mutex> guard(held->lock);
+            held->tokens.push_back(writer.cancellation());
+            held->writers.push_back(std::move(writer));
+        }
+
+        std::shared_ptr<Held> held;
+    };
+
+    bool eventually(const std::function<bool()>& done)
+    {
+        for (int i = 0; i < 500 && !done(); ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return done();
+    }
+} // namespace
+
+TEST(http_server_test, requests_are_cancelled_on_timeout_and_disconnection)
+{
+    auto held = std::make_shared<CancellationHandler::Held>();
+
+    Http::Endpoint server(Pistache::Address("localhost", Pistache::Port(0)));
+    server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr).threads(1));
+    server.setHandler(Http::make_handler<CancellationHandler>(held));
+    server.serveThreaded();
+
+    const auto token = [&](size_t index) {
+        std::lock_guard<std::mutex> guard(held->lock);
+        return index < held->tokens.size() ? held->tokens[index] : Async::CancellationToken();
+    };
+
+    TcpClient timedOut;
+    EXPECT_TRUE(timedOut.connect(Pistache::Address("localhost", server.getPort())));
+    EXPECT_TRUE(timedOut.send("GET /timeout HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    const auto received = receiveUntil(timedOut, " 408 Request Timeout", 1);
+    EXPECT_NE(received.find(" 408 Request Timeout"), std::string::npos) << received;
+    EXPECT_TRUE(token(0).isCancelled());
+
+    TcpClient gone;
+    EXPECT_TRUE(gone.connect(Pistache::Address("localhost", server.getPort())));
+    EXPECT_TRUE(gone.send("GET /hold HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    ASSERT_TRUE(eventually([&] { return token(1).canBeCancelled(); }));
+    EXPECT_FALSE(token(1).isCancelled());
+
+    std::atomic<bool> called { false };
+    token(1).onCancel([&] { called = true; });
+    gone.close();
+    EXPECT_TRUE(eventually([&] { return token(1).isCancelled(); }));
+    EXPECT_TRUE(called.load());
+
+    server.shutdown();
+
+    std::lock_guard<std::mutex> guard(held->lock);
+    held->writers.clear();
+}
+
+TEST(http_server_test, keep_alive_connection_is_answered_after_a_timeout)
+{
+    auto held = std::make_shared<CancellationHandler::Held>();
+
+    Http::Endpoint server(Pistache::Address("localhost", Pistache::Port(0)));
+    server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr).threads(1));
+    server.setHandler(Http::make_handler<CancellationHandler>(held));
+    server.serveThreaded();
+
+    TcpClient client;
+    EXPECT_TRUE(client.connect(Pistache::Address("localhost", server.getPort())));
+    EXPECT_TRUE(client.send("GET /timeout HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    const auto first = receiveUntil(client, " 408 Request Timeout", 1);
+    EXPECT_NE(first.find(" 408 Request Timeout"), std::string::npos) << first;
+
+    // Held by the handler as well, times out along the same path
+    EXPECT_TRUE(client.send("GET /timeout HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    const auto second = receiveUntil(client, " 408 Request Timeout", 1);
+    EXPECT_NE(second.find(" 408 Request Timeout"), std::string::npos) << second;
+
+    {
+        std::lock_guard<std::mutex> guard(held->lock);
+        EXPECT_EQ(held->writers.size(), 2U);
+    }
+
+    server.shutdown();
+
+    std::lock_guard<std::mutex> guard(held->lock);
+    held->writers.clear();
+}
+
+namespace
+{
+    // Answers from a continuation of a promise resolved by another thread
+    struct ResumingHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(ResumingHandler)
+
+        void onRequest(const Http::Request& /*request*/, Http::ResponseWriter writer) override
+        {
+            auto deferred = std::make_shared<Async::Deferred<std::string>>();
+            Async::Promise<std::string> promise([&](Async::Deferred<std::string> d) {
+                *deferred = std::move(d);
+            });
+
+            auto executor = writer.executor();
+            promise.thenOn(
+                executor,
+                [writer = std::make_shared<Http::ResponseWriter>(std::move(writer))](const std::string& body) {
+                    const bool owner = writer->transport()->isInTransportThread();
+                    writer->send(Http::Code::Ok, owner ? body : "elsewhere");
+                },
+                Async::NoExcept);
+
+            std::thread([deferred] { deferred->resolve(std::string("resumed")); }).detach();
+        }
+    };
+} // namespace
+
+TEST(http_server_test, continuations_resume_on_the_transport_of_the_response)
+{
+    Http::Endpoint server(Pistache::Address("localhost", Pistache::Port(0)));
+    server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr).threads(1));
+    server.setHandler(Http::make_handler<ResumingHandler>());
+    server.serveThreaded();
+
+    TcpClient client;
+    EXPECT_TRUE(client.connect(Pistache::Address("localhost", server.getPort())));
+    EXPECT_TRUE(client.send("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    const auto received = receiveUntil(client, "resumed", 1);
+    EXPECT_NE(received.find("resumed"), std::string::npos) << received;
+
+    server.shutdown();
+}
+
+namespace
+{
+    // Answers whether its transport finds the peer of the request by handle,
+    // from the worker or, for /away, from another thread
+    struct PeerHandleHandler : public Http::Handler
+    {
+        HTTP_PROTOTYPE(PeerHandleHandler)
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter writer) override
+        {
+            auto peer   = writer.getPeer();
+            auto handle = peer->handle();
+            auto stale  = handle;
+            ++stale.id;
+
+            const bool found = transport()->findPeer(handle) == peer.get()
+                && transport()->findPeer(stale) == nullptr;
+            if (request.resource() != "/away")
+            {
+                writer.send(Http::Code::Ok, found ? "found" : "missing");
+                return;
+            }
+
+            std::thread([writer = std::move(writer), found]() mutable {
+                writer.send(Http::Code::Ok, found ? "found" : "missing");
+            }).join();
+        }
+    };
+} // namespace
+
+TEST(http_server_test, peers_are_found_by_handle_on_their_worker)
+{
+    Http::Endpoint server(Pistache::Address("localhost", Pistache::Port(0)));
+    server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr));
+    server.setHandler(Http::make_handler<PeerHandleHandler>());
+    server.serveThreaded();
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(Pistache::Address("localhost", server.getPort())));
+    ASSERT_TRUE(client.send("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                            "GET /away HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+
+    const auto received = receiveUntil(client, "found", 2);
+    EXPECT_EQ(received.find("missing"), std::string::npos) << received;
+    EXPECT_NE(received.find("found", received.find("found") + 1), std::string::npos) << received;
+
+    server.shutdown();
 }
@@ -7,6 +7,9 @@
 #include <gtest/gtest.h>
 #include <pistache/http.h>
 
+#include <thread>
+#include <vector>
+
 using namespace Pistache;
 
 TEST(http_uri_test, query_as_string_test)
@@ -22,4 +25,75 @@ TEST(http_uri_test, query_as_string_test)
     query3.add("value1", "name1");
     query3.add("value2", "name2");
     ASSERT_STREQ(query3.as_str().c_str(), "?value2=name2&value1=name1");
-}
\ No newline at end of file
+}
+
+TEST(http_uri_test, raw_query_is_looked_up_in_place)
+{
+    const auto query = Http::Uri::Query::fromRaw("q=caf%C3%A9+au+lait&page=2&flag&page=3&=x&empty=");
+
+    const auto raw = query.raw();
+    auto page      = query.getView("page");
+    ASSERT_TRUE(page.has_value());
+    ASSERT_EQ(*page, "2");
+    ASSERT_GE(page->data(), raw.data());
+    ASSERT_LT(page->data(), raw.data() + raw.size());
+
+    ASSERT_EQ(*query.getView("q"), "caf%C3%A9+au+lait");
+    ASSERT_EQ(*query.getDecoded("q"), "caf\xC3\xA9 au lait");
+    ASSERT_EQ(*query.get("flag"), "");
+    ASSERT_EQ(*query.get("empty"), "");
+    ASSERT_TRUE(query.has("flag"));
+    ASSERT_FALSE(query.has("fla"));
+    ASSERT_FALSE(query.getView("missing").has_value());
+
+    // Nothing has been split so far
+    ASSERT_FALSE(query.raw().empty());
+}
+
+TEST(http_uri_test, raw_query_is_split_when_iterated_or_modified)
+{
+    auto query = Http::Uri::Query::fromRaw("a=1&b=2&a=3");
+    ASSERT_EQ(query.parameters().size(), 2u);
+    ASSERT_EQ(*query.get("a"), "1");
+
+    auto other = Http::Uri::Query::fromRaw("a=1");
+    other.add("b", "2");
+    ASSERT_TRUE(other.raw().empty());
+    ASSERT_EQ(std::distance(other.parameters_begin(), other.parameters_end()), 2);
+    ASSERT_EQ(*other.getView("a"), "1");
+
+    other.clear();
+    ASSERT_FALSE(other.has("a"));
+    ASSERT_TRUE(other.as_str().empty());
+}
+
+TEST(http_uri_test, raw_query_is_split_once_across_threads)
+{
+    const auto query = Http::Uri::Query::fromRaw("a=1&b=2&c=3");
+
+    // Iterated and looked up from several threads, as a handler may with a
+    // const request
+    std::vector<std::thread> threads;
+    std::vector<size_t> counts(8);
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        threads.emplace_back([&query, &counts, i] {
+            ASSERT_EQ(*query.getView("b"), "2");
+            counts[i] = query.parameters().size();
+            ASSERT_EQ(*query.getView("c"), "3");
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    for (auto count : counts)
+        ASSERT_EQ(count, 3u);
+}
+
+TEST(http_uri_test, percent_decoding_keeps_malformed_escapes)
+{
+    const auto query = Http::Uri::Query::fromRaw("a=100%&b=%zz%41&c=%4");
+    ASSERT_EQ(*query.getDecoded("a"), "100%");
+    ASSERT_EQ(*query.getDecoded("b"), "%zzA");
+    ASSERT_EQ(*query.getDecoded("c"), "%4");
+}
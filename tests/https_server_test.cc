@@ -5,7 +5,12 @@
  */
 
 #include <array>
+#include <chrono>
 #include <cstring>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <thread>
 
 #include <pistache/client.h>
 #include <pistache/endpoint.h>
@@ -371,6 +376,191 @@ TEST(https_server_test, basic_tls_request_with_servefile)
     ASSERT_EQ(buffer.rfind("-----BEGIN CERTIFICATE-----", 0), 0u);
 }
 
+TEST(https_server_test, basic_tls_request_with_ktls_servefile)
+{
+    Http::Endpoint server(Address("localhost", Pistache::Port(0)));
+    auto flags       = Tcp::Options::ReuseAddr;
+    auto server_opts = Http::Endpoint::options().flags(flags);
+
+    server.init(server_opts);
+    server.setHandler(Http::make_handler<ServeFileHandler>());
+
+    // Needs the SSL context
+    ASSERT_THROW(server.useKTLS(), std::runtime_error);
+    server.useSSL("./certs/server.crt", "./certs/server.key");
+    server.useKTLS();
+    server.serveThreaded();
+
+    CURL* curl;
+    CURLcode res;
+    std::string buffer;
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    curl = curl_easy_init();
+    ASSERT_NE(curl, nullptr);
+
+    const auto url = getServerUrl(server);
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_CAINFO, "./certs/rootCA.crt");
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &write_cb);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
+
+    /* Skip hostname check */
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+
+    // The file is the same whether the kernel encrypted it or not
+    res = curl_easy_perform(curl);
+
+    curl_easy_cleanup(curl);
+    curl_global_cleanup();
+
+    server.shutdown();
+
+    ASSERT_EQ(res, CURLE_OK);
+    ASSERT_EQ(buffer.rfind("-----BEGIN CERTIFICATE-----", 0), 0u);
+    ASSERT_NE(buffer.find("-----END CERTIFICATE-----"), std::string::npos);
+}
+
+namespace
+{
+    // HTTP version negotiated by curl, whose ALPN offers h2 and http/1.1
+    long negotiateVersion(bool http2, std::string& buffer)
+    {
+        Http::Endpoint server(Address("localhost", Pistache::Port(0)));
+        server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr).http2(http2));
+        server.setHandler(Http::make_handler<ServeFileHandler>());
+        server.useSSL("./certs/server.crt", "./certs/server.key");
+        server.serveThreaded();
+
+        CURL* curl = curl_easy_init();
+        EXPECT_NE(curl, nullptr);
+
+        const auto url = getServerUrl(server);
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(curl, CURLOPT_CAINFO, "./certs/rootCA.crt");
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &write_cb);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
+
+        long version = 0;
+        EXPECT_EQ(curl_easy_perform(curl), CURLE_OK);
+        curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &version);
+
+        curl_easy_cleanup(curl);
+        server.shutdown();
+        return version;
+    }
+} // namespace
+
+TEST(https_server_test, http2_is_negotiated_with_alpn)
+{
+    std::ifstream file("./certs/rootCA.crt");
+    const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::string buffer;
+    ASSERT_EQ(negotiateVersion(true, buffer), CURL_HTTP_VERSION_2_0);
+    ASSERT_EQ(buffer, content);
+
+    buffer.clear();
+    ASSERT_EQ(negotiateVersion(false, buffer), CURL_HTTP_VERSION_1_1);
+    ASSERT_EQ(buffer, content);
+}
+
+namespace
+{
+    // Connects twice to the server, the second connection presents the
+    // session of the first one
+    void reconnect(const Http::Endpoint& server, const char* tlsVersion,
+                   std::chrono::milliseconds pause)
+    {
+        CURL* curl = curl_easy_init();
+        ASSERT_NE(curl, nullptr);
+
+        std::string buffer;
+        const auto url = getServerUrl(server);
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_CAINFO, "./certs/rootCA.crt");
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &write_cb);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
+        curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+        if (std::string(tlsVersion) == "1.2")
+            curl_easy_setopt(curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2 | CURL_SSLVERSION_MAX_TLSv1_2);
+
+        for (int i = 0; i < 2; ++i)
+        {
+            if (i > 0)
+                std::this_thread::sleep_for(pause);
+
+            buffer.clear();
+            ASSERT_EQ(curl_easy_perform(curl), CURLE_OK);
+            ASSERT_EQ(buffer, "Hello, World!");
+        }
+
+        curl_easy_cleanup(curl);
+    }
+
+    Tcp::TlsHandshakes resumeWith(std::shared_ptr<Tcp::TlsSessionStore> store,
+                                  std::chrono::seconds ticketKeyRotation, const char* tlsVersion,
+                                  std::chrono::milliseconds pause = std::chrono::milliseconds(0))
+    {
+        Http::Endpoint server(Address("localhost", Pistache::Port(0)));
+        server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr));
+        server.setHandler(Http::make_handler<HelloHandler>());
+        server.useSSL("./certs/server.crt", "./certs/server.key");
+        server.useSSLSessions(std::move(store), std::chrono::seconds(60), ticketKeyRotation);
+        server.serveThreaded();
+
+        reconnect(server, tlsVersion, pause);
+
+        auto handshakes = server.tlsHandshakes();
+        server.shutdown();
+        return handshakes;
+    }
+} // namespace
+
+TEST(https_server_test, tls_sessions_are_resumed_from_the_store)
+{
+    for (const char* version : { "1.2", "1.3" })
+    {
+        auto cache      = std::make_shared<Tcp::TlsSessionCache>();
+        auto handshakes = resumeWith(cache, std::chrono::seconds(0), version);
+
+        ASSERT_EQ(handshakes.full, 1U) << version;
+        ASSERT_EQ(handshakes.resumed, 1U) << version;
+        ASSERT_GE(cache->size(), 1U) << version;
+    }
+}
+
+TEST(https_server_test, tls_sessions_are_resumed_from_tickets)
+{
+    // curl only asks TLS 1.3 servers for tickets
+    auto handshakes = resumeWith(nullptr, std::chrono::seconds(3600), "1.3");
+
+    ASSERT_EQ(handshakes.full, 1U);
+    ASSERT_EQ(handshakes.resumed, 1U);
+}
+
+TEST(https_server_test, tls_tickets_outlive_the_rotation_of_their_key)
+{
+    auto handshakes = resumeWith(nullptr, std::chrono::seconds(1), "1.3", std::chrono::milliseconds(1100));
+
+    ASSERT_EQ(handshakes.full, 1U);
+    ASSERT_EQ(handshakes.resumed, 1U);
+}
+
+TEST(https_server_test, tls_sessions_are_not_resumed_when_disabled)
+{
+    auto handshakes = resumeWith(nullptr, std::chrono::seconds(0), "1.3");
+
+    ASSERT_EQ(handshakes.full, 2U);
+    ASSERT_EQ(handshakes.resumed, 0U);
+}
+
 TEST(https_server_test, basic_tls_request_with_password_cert)
 {
     Http::Endpoint server(Address("localhost", Pistache::Port(0)));
@@ -415,3 +605,79 @@ TEST(https_server_test, basic_tls_request_with_password_cert)
     ASSERT_EQ(res, CURLE_OK);
     ASSERT_EQ(buffer, "Hello, World!");
 }
+
+namespace
+{
+    // Sends a GET with the client, and waits for its response or its error
+    std::string clientGet(Http::Experimental::Client& client, const std::string& url)
+    {
+        std::promise<std::string> result;
+        client.get(url).send().then(
+            [&](Http::Response response) { result.set_value(response.body()); },
+            [&](std::exception_ptr exc) {
+                try
+                {
+                    std::rethrow_exception(exc);
+                }
+                catch (const std::exception& e)
+                {
+                    result.set_value(std::string("error: ") + e.what());
+                }
+            });
+
+        auto future = result.get_future();
+        if (future.wait_for(std::chrono::seconds(5)) != std::future_status::ready)
+            return "timeout";
+        return future.get();
+    }
+} // namespace
+
+TEST(https_server_test, client_resumes_tls_sessions)
+{
+    Http::Endpoint server(Address("localhost", Pistache::Port(0)));
+    server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr));
+    server.setHandler(Http::make_handler<HelloHandler>());
+    server.useSSL("./certs/server.crt", "./certs/server.key");
+    server.useSSLSessions();
+    server.serveThreaded();
+
+    Http::Experimental::Client client;
+    client.init(Http::Experimental::Client::options()
+                    .sslVerifyPeer(false)
+                    .idleTimeout(std::chrono::milliseconds(50)));
+
+    // The first connection is closed once idle, the second one resumes its
+    // session
+    const auto url = getServerUrl(server);
+    EXPECT_EQ(clientGet(client, url), "Hello, World!");
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_EQ(clientGet(client, url), "Hello, World!");
+
+    const auto handshakes = client.tlsHandshakes();
+    EXPECT_EQ(handshakes.full, 1U);
+    EXPECT_EQ(handshakes.resumed, 1U);
+    EXPECT_EQ(server.tlsHandshakes().resumed, 1U);
+
+    client.shutdown();
+    server.shutdown();
+}
+
+TEST(https_server_test, client_rejects_untrusted_certificates)
+{
+    Http::Endpoint server(Address("localhost", Pistache::Port(0)));
+    server.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr));
+    server.setHandler(Http::make_handler<HelloHandler>());
+    server.useSSL("./certs/server.crt", "./certs/server.key");
+    server.serveThreaded();
+
+    // Signed by a certificate authority of its own
+    Http::Experimental::Client client;
+    client.init();
+
+    const auto result = clientGet(client, getServerUrl(server));
+    EXPECT_EQ(result.rfind("error: Certificate verification failed", 0), 0U) << result;
+    EXPECT_EQ(client.tlsHandshakes().full, 0U);
+
+    client.shutdown();
+    server.shutdown();
+}
@@ -16,6 +16,11 @@
 
 #include <pistache/http.h>
 #include <pistache/listener.h>
+#include <pistache/os.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
 class SocketWrapper
 {
 
@@ -224,6 +229,70 @@ TEST(listener_test, listener_bind_ephemeral_v4_port)
     ASSERT_TRUE(bound_port > (uint16_t)0);
 }
 
+TEST(listener_test, workers_are_pinned_before_bind)
+{
+    Pistache::Address address(Pistache::Ipv4::loopback(), Pistache::Port(0));
+
+    Pistache::Tcp::Listener listener;
+    listener.init(2, Pistache::Flags<Pistache::Tcp::Options>());
+    listener.setHandler(Pistache::Http::make_handler<DummyHandler>());
+
+    const auto cpus = Pistache::availableCpus();
+    ASSERT_FALSE(cpus.empty());
+    ASSERT_GE(Pistache::cpuNode(cpus.front()), -1);
+
+    ASSERT_THROW(listener.pinWorker(2, Pistache::CpuSet({ cpus.front() })),
+                 std::invalid_argument);
+    ASSERT_NO_THROW(listener.pinWorker(1, Pistache::CpuSet({ cpus.front() })));
+
+    listener.setNumaAware(true);
+    listener.bind(address);
+
+    ASSERT_THROW(listener.pinWorker(0, Pistache::CpuSet({ cpus.front() })),
+                 std::domain_error);
+}
+
+TEST(listener_test, cpu_quota_of_the_cgroup)
+{
+    namespace fs = std::filesystem;
+    const auto root = fs::temp_directory_path() / "pistache-cgroup-test";
+    fs::remove_all(root);
+
+    const auto write = [](const fs::path& path, const std::string& content) {
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << content;
+    };
+
+    // cgroup v2, the parent limits more than the cgroup itself
+    write(root / "self", "0::/pod/app\n");
+    write(root / "v2/pod/cpu.max", "150000 100000\n");
+    write(root / "v2/pod/app/cpu.max", "400000 100000\n");
+    auto quota = Pistache::cpuQuota((root / "v2").string(), (root / "self").string());
+    ASSERT_TRUE(quota.has_value());
+    EXPECT_DOUBLE_EQ(*quota, 1.5);
+
+    write(root / "v2/pod/cpu.max", "max 100000\n");
+    write(root / "v2/pod/app/cpu.max", "max 100000\n");
+    EXPECT_FALSE(Pistache::cpuQuota((root / "v2").string(), (root / "self").string()));
+
+    // cgroup v1, with the v2 hierarchy empty
+    write(root / "self", "4:cpu,cpuacct:/app\n1:memory:/app\n0::/\n");
+    write(root / "v1/cpu,cpuacct/app/cpu.cfs_quota_us", "50000\n");
+    write(root / "v1/cpu,cpuacct/app/cpu.cfs_period_us", "100000\n");
+    quota = Pistache::cpuQuota((root / "v1").string(), (root / "self").string());
+    ASSERT_TRUE(quota.has_value());
+    EXPECT_DOUBLE_EQ(*quota, 0.5);
+
+    write(root / "v1/cpu,cpuacct/app/cpu.cfs_quota_us", "-1\n");
+    EXPECT_FALSE(Pistache::cpuQuota((root / "v1").string(), (root / "self").string()));
+
+    const auto usable = Pistache::usableCpus();
+    EXPECT_GE(usable, 1u);
+    EXPECT_LE(usable, Pistache::availableCpus().size());
+
+    fs::remove_all(root);
+}
+
 TEST(listener_test, listener_bind_ephemeral_v6_port)
 {
     Pistache::Tcp::Listener listener;
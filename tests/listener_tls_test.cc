@@ -92,3 +92,47 @@ TEST(listener_tls_test, tls_handshake_timeout_custom)
 
     BIO_free_all(bio);
 }
+
+TEST(listener_tls_test, stalled_handshake_does_not_block_other_clients)
+{
+    Pistache::Tcp::Listener listener;
+    listener.init(1);
+    listener.setupSSL("./certs/server.crt", "./certs/server.key", false, nullptr);
+    listener.setHandler(Pistache::Http::make_handler<HelloHandler>());
+    listener.bind(Pistache::Address(Pistache::IP::loopback(), 0));
+    listener.runThreaded();
+
+    const auto port = listener.getPort().toString();
+
+    // This client connects but never starts its TLS handshake
+    BIO* stalled = BIO_new_connect("localhost");
+    BIO_set_conn_port(stalled, port.c_str());
+    ASSERT_THAT(BIO_do_connect(stalled), Eq(1));
+
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    BIO* client = BIO_new_ssl_connect(ctx);
+    BIO_set_conn_hostname(client, ("localhost:" + port).c_str());
+    ASSERT_THAT(BIO_do_connect(client), Eq(1));
+    ASSERT_THAT(BIO_do_handshake(client), Eq(1));
+
+    const std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ASSERT_THAT(BIO_write(client, request.data(), static_cast<int>(request.size())),
+                Eq(static_cast<int>(request.size())));
+
+    char buf[256];
+    int bytes = BIO_read(client, buf, sizeof buf);
+    ASSERT_GT(bytes, 0);
+    EXPECT_EQ(std::string(buf, bytes).rfind("HTTP/1.1 200 OK", 0), 0u);
+
+    // The stalled handshake must not delay the second connection until the
+    // default handshake timeout expires
+    EXPECT_THAT(std::chrono::steady_clock::now() - start, Le(std::chrono::seconds(2)));
+
+    BIO_free_all(client);
+    SSL_CTX_free(ctx);
+    BIO_free_all(stalled);
+}
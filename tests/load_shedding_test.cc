@@ -0,0 +1,262 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_client.h"
+
+using namespace Pistache;
+
+namespace
+{
+    // Writers of the requests to /hold, answered by the test
+    struct Held
+    {
+        std::mutex lock;
+        std::vector<Http::ResponseWriter> writers;
+
+        size_t size()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return writers.size();
+        }
+    };
+
+    class OverloadHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(OverloadHandler)
+
+        explicit OverloadHandler(std::shared_ptr<Held> held)
+            : held_(std::move(held))
+        { }
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter response) override
+        {
+            if (request.resource() == "/hold")
+            {
+                std::lock_guard<std::mutex> guard(held_->lock);
+                held_->writers.push_back(std::move(response));
+                return;
+            }
+            if (request.resource() == "/slow")
+                std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+            response.send(Http::Code::Ok, "ok");
+        }
+
+    private:
+        std::shared_ptr<Held> held_;
+    };
+
+    const std::string Get = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+    // Reads until the text shows up, the connection closes or nothing
+    // arrives for the timeout
+    std::string receiveUntil(TcpClient& client, const std::string& text,
+                             std::chrono::milliseconds timeout = std::chrono::seconds(5))
+    {
+        std::string response;
+        char buffer[4096];
+        while (response.find(text) == std::string::npos)
+        {
+            size_t bytes = 0;
+            if (!client.receive(buffer, sizeof(buffer), &bytes, timeout) || bytes == 0)
+                break;
+            response.append(buffer, bytes);
+        }
+        return response;
+    }
+
+    size_t count(const std::string& text, const std::string& what)
+    {
+        size_t found = 0;
+        for (auto pos = text.find(what); pos != std::string::npos; pos = text.find(what, pos + 1))
+            ++found;
+        return found;
+    }
+
+    struct Server
+    {
+        explicit Server(Http::Endpoint::Options options,
+                        std::shared_ptr<Held> held = std::make_shared<Held>())
+            : endpoint(Address(IP::loopback(), Port(0)))
+        {
+            endpoint.init(options.threads(1).flags(Tcp::Options::ReuseAddr));
+            endpoint.setHandler(Http::make_handler<OverloadHandler>(std::move(held)));
+            endpoint.serveThreaded();
+        }
+
+        ~Server() { endpoint.shutdown(); }
+
+        bool connect(TcpClient& client)
+        {
+            return client.connect(Address(IP::loopback(), endpoint.getPort()));
+        }
+
+        Http::Endpoint endpoint;
+    };
+} // namespace
+
+TEST(load_shedding_test, connections_wait_in_the_backlog_past_the_limit)
+{
+    for (const bool perWorker : { false, true })
+    {
+        Server server(Http::Endpoint::options().maxConnections(2).acceptPerWorker(perWorker));
+
+        TcpClient first, second;
+        ASSERT_TRUE(server.connect(first));
+        ASSERT_TRUE(server.connect(second));
+        ASSERT_TRUE(first.send(Get));
+        ASSERT_TRUE(second.send(Get));
+        EXPECT_NE(receiveUntil(first, "\r\n\r\nok").find("200 OK"), std::string::npos);
+        EXPECT_NE(receiveUntil(second, "\r\n\r\nok").find("200 OK"), std::string::npos);
+
+        // Connected by the kernel, but not accepted by the server
+        TcpClient third;
+        ASSERT_TRUE(server.connect(third));
+        ASSERT_TRUE(third.send(Get));
+        EXPECT_EQ(receiveUntil(third, "\r\n\r\nok", std::chrono::milliseconds(300)), "")
+            << "accept per worker: " << perWorker;
+
+        first.close();
+        EXPECT_NE(receiveUntil(third, "\r\n\r\nok").find("200 OK"), std::string::npos)
+            << "accept per worker: " << perWorker;
+    }
+}
+
+TEST(load_shedding_test, refuses_requests_past_the_in_flight_limit)
+{
+    auto held = std::make_shared<Held>();
+    Server server(Http::Endpoint::options().maxInFlight(1), held);
+
+    TcpClient holding;
+    ASSERT_TRUE(server.connect(holding));
+    ASSERT_TRUE(holding.send("GET /hold HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+    for (int i = 0; i < 500 && held->size() == 0; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(held->size(), 1u);
+
+    TcpClient refused;
+    ASSERT_TRUE(server.connect(refused));
+    ASSERT_TRUE(refused.send("POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n\r\n"));
+    const auto response = receiveUntil(refused, "\r\n\r\n");
+    EXPECT_EQ(response.rfind("HTTP/1.1 503 Service Unavailable\r\n", 0), 0u) << response;
+    EXPECT_NE(response.find("Retry-After: 1\r\n"), std::string::npos) << response;
+    EXPECT_NE(response.find("Connection: Close\r\n"), std::string::npos) << response;
+
+    {
+        std::lock_guard<std::mutex> guard(held->lock);
+        held->writers.front().send(Http::Code::Ok, "ok");
+    }
+    EXPECT_NE(receiveUntil(holding, "\r\n\r\nok").find("200 OK"), std::string::npos);
+
+    // Answered, the request no longer counts
+    TcpClient next;
+    ASSERT_TRUE(server.connect(next));
+    ASSERT_TRUE(next.send(Get));
+    EXPECT_NE(receiveUntil(next, "\r\n\r\nok").find("200 OK"), std::string::npos);
+}
+
+TEST(load_shedding_test, sheds_requests_that_queued_too_long)
+{
+    Server server(Http::Endpoint::options().loadShedding(std::chrono::milliseconds(5),
+                                                         std::chrono::milliseconds(20)));
+
+    // Every request waits for the ones before it, 30ms each
+    std::string pipelined;
+    for (int i = 0; i < 10; ++i)
+        pipelined += "GET /slow HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+    TcpClient client;
+    ASSERT_TRUE(server.connect(client));
+    ASSERT_TRUE(client.send(pipelined));
+    const auto responses = receiveUntil(client, "Server overloaded");
+
+    EXPECT_NE(responses.find("HTTP/1.1 503 Service Unavailable\r\n"), std::string::npos)
+        << responses;
+    EXPECT_GE(count(responses, "HTTP/1.1 200 OK\r\n"), 1u) << responses;
+    EXPECT_LT(count(responses, "HTTP/1.1 200 OK\r\n"), 10u) << responses;
+
+    // A request that did not queue goes through
+    TcpClient fresh;
+    ASSERT_TRUE(server.connect(fresh));
+    ASSERT_TRUE(fresh.send(Get));
+    EXPECT_NE(receiveUntil(fresh, "\r\n\r\nok").find("200 OK"), std::string::npos);
+}
+
+TEST(load_shedding_test, refuses_bodies_past_the_budget)
+{
+    Server server(Http::Endpoint::options().bodyBudget(0, 4096).maxRequestSize(64 * 1024));
+
+    // Announced larger than the budget, answered before the body
+    TcpClient announced;
+    ASSERT_TRUE(server.connect(announced));
+    ASSERT_TRUE(announced.send("POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 100000\r\n\r\n"));
+    const auto refused = receiveUntil(announced, "for request bodies");
+    EXPECT_NE(refused.find("HTTP/1.1 503 Service Unavailable\r\n"), std::string::npos) << refused;
+    EXPECT_NE(refused.find("Retry-After: 1\r\n"), std::string::npos) << refused;
+    EXPECT_NE(refused.find("Connection: Close\r\n"), std::string::npos) << refused;
+
+    // Without a length, refused once the bytes received go past it
+    TcpClient chunked;
+    ASSERT_TRUE(server.connect(chunked));
+    ASSERT_TRUE(chunked.send("POST / HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n"));
+    const std::string chunk = "400\r\n" + std::string(1024, 'x') + "\r\n";
+    for (int i = 0; i < 5; ++i)
+        ASSERT_TRUE(chunked.send(chunk));
+    const auto grown = receiveUntil(chunked, "for request bodies");
+    EXPECT_NE(grown.find("HTTP/1.1 503 Service Unavailable\r\n"), std::string::npos) << grown;
+
+    // The bytes of the dispatched requests are given back
+    for (int i = 0; i < 3; ++i)
+    {
+        TcpClient fits;
+        ASSERT_TRUE(server.connect(fits));
+        ASSERT_TRUE(fits.send("POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 2048\r\n\r\n"
+                              + std::string(2048, 'x')));
+        const auto answered = receiveUntil(fits, "\r\n\r\nok");
+        EXPECT_NE(answered.find("200 OK"), std::string::npos) << answered;
+    }
+}
+
+TEST(load_shedding_test, evicts_the_least_recently_active_idle_connection)
+{
+    Server server(Http::Endpoint::options().evictIdleConnections(2));
+
+    const std::string keepAlive = "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: Keep-Alive\r\n\r\n";
+    TcpClient first, second;
+    for (auto* client : { &first, &second })
+    {
+        ASSERT_TRUE(server.connect(*client));
+        ASSERT_TRUE(client->send(keepAlive));
+        EXPECT_NE(receiveUntil(*client, "\r\n\r\nok").find("200 OK"), std::string::npos);
+    }
+
+    // The first one is active again, the second one is idle the longest
+    ASSERT_TRUE(first.send(keepAlive));
+    EXPECT_NE(receiveUntil(first, "\r\n\r\nok").find("200 OK"), std::string::npos);
+
+    TcpClient third;
+    ASSERT_TRUE(server.connect(third));
+    ASSERT_TRUE(third.send(keepAlive));
+    EXPECT_NE(receiveUntil(third, "\r\n\r\nok").find("200 OK"), std::string::npos);
+
+    EXPECT_TRUE(receiveUntil(second, "\r\n\r\nok").empty());
+
+    ASSERT_TRUE(first.send(keepAlive));
+    EXPECT_NE(receiveUntil(first, "\r\n\r\nok").find("200 OK"), std::string::npos);
+}
@@ -7,6 +7,11 @@
 #include <gtest/gtest.h>
 #include <pistache/mailbox.h>
 
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
 struct Data
 {
     static int num_instances;
@@ -41,3 +46,129 @@ TEST(queue_test, destructor_test)
     }
     // Should call Data::~Data 5 times and not 6 (placeholder entry)
 }
+
+TEST(queue_test, ring_destructor_test)
+{
+    Pistache::PollableRing<Data, 4> ring;
+    EXPECT_TRUE(ring.empty());
+
+    // Two of them go to the overflow
+    for (int i = 0; i < 6; i++)
+    {
+        ring.push(Data());
+    }
+    EXPECT_FALSE(ring.empty());
+}
+
+TEST(queue_test, ring_keeps_the_order_across_the_overflow)
+{
+    Pistache::PollableRing<int, 4> ring;
+
+    for (int i = 0; i < 10; ++i)
+        ring.push(i);
+
+    // Half of it drained, the ring has room again but the other pushes must
+    // still come after the overflow
+    for (int i = 0; i < 5; ++i)
+    {
+        auto value = ring.popSafe();
+        ASSERT_TRUE(value.has_value());
+        ASSERT_EQ(*value, i);
+    }
+
+    for (int i = 10; i < 14; ++i)
+        ring.push(i);
+
+    for (int i = 5; i < 14; ++i)
+    {
+        auto value = ring.popSafe();
+        ASSERT_TRUE(value.has_value());
+        ASSERT_EQ(*value, i);
+    }
+
+    ASSERT_FALSE(ring.popSafe().has_value());
+    ASSERT_TRUE(ring.empty());
+}
+
+TEST(queue_test, ring_signals_once_until_drained)
+{
+    Pistache::Polling::Epoll poller;
+    Pistache::PollableRing<int, 8> ring;
+    auto tag = ring.bind(poller);
+    auto fd  = static_cast<int>(tag.value());
+
+    for (int i = 0; i < 5; ++i)
+        ring.push(i);
+
+    uint64_t count = 0;
+    ASSERT_EQ(read(fd, &count, sizeof count), static_cast<ssize_t>(sizeof count));
+    ASSERT_EQ(count, 1u);
+
+    while (ring.popSafe())
+        ;
+
+    ring.push(42);
+    ASSERT_EQ(read(fd, &count, sizeof count), static_cast<ssize_t>(sizeof count));
+    ASSERT_EQ(count, 1u);
+    ASSERT_EQ(*ring.popSafe(), 42);
+}
+
+TEST(queue_test, ring_does_not_signal_a_spinning_consumer)
+{
+    Pistache::Polling::Epoll poller;
+    Pistache::PollableRing<int, 8> ring;
+    auto tag = ring.bind(poller);
+    auto fd  = static_cast<int>(tag.value());
+
+    std::atomic<bool> spinning { true };
+    ring.setSpinFlag(&spinning);
+
+    ring.push(1);
+    uint64_t count = 0;
+    ASSERT_EQ(read(fd, &count, sizeof count), -1);
+    ASSERT_EQ(*ring.popSafe(), 1);
+
+    // Asleep again, the consumer has to be woken up
+    spinning = false;
+    ring.push(2);
+    ASSERT_EQ(read(fd, &count, sizeof count), static_cast<ssize_t>(sizeof count));
+    ASSERT_EQ(*ring.popSafe(), 2);
+}
+
+TEST(queue_test, ring_keeps_the_order_of_each_producer)
+{
+    constexpr int Producers   = 4;
+    constexpr int PerProducer = 5000;
+
+    Pistache::PollableRing<std::pair<int, int>, 16> ring;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < Producers; ++p)
+    {
+        producers.emplace_back([&ring, p] {
+            for (int i = 0; i < PerProducer; ++i)
+                ring.push(std::make_pair(p, i));
+        });
+    }
+
+    std::vector<int> next(Producers, 0);
+    int received = 0;
+    while (received < Producers * PerProducer)
+    {
+        auto value = ring.popSafe();
+        if (!value)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        ASSERT_EQ(value->second, next[value->first]);
+        ++next[value->first];
+        ++received;
+    }
+
+    for (auto& producer : producers)
+        producer.join();
+
+    ASSERT_FALSE(ring.popSafe().has_value());
+}
@@ -9,6 +9,7 @@
 
 #include <pistache/http.h>
 #include <pistache/mime.h>
+#include <pistache/negotiation.h>
 
 #include <locale>
 
@@ -191,3 +192,56 @@ TEST(mime_test, should_parse_case_insensitive_issue_179)
         ASSERT_EQ(mime.q().value_or(Q(0)), Q(78));
     });
 }
+
+TEST(mime_test, negotiates_the_preferred_produced_type)
+{
+    Negotiator negotiator({ MIME(Application, Json),
+                            MediaType::fromString("application/msgpack"),
+                            MediaType::fromString("application/vnd.api+json") });
+
+    // No preference, the first type produced
+    EXPECT_EQ(negotiator.negotiate(""), 0u);
+    EXPECT_EQ(negotiator.negotiate("*/*"), 0u);
+    EXPECT_EQ(negotiator.negotiate("application/*"), 0u);
+
+    EXPECT_EQ(negotiator.negotiate("Application/MsgPack"), 1u);
+    EXPECT_EQ(negotiator.negotiate("application/json;q=0.5, application/msgpack"), 1u);
+    EXPECT_EQ(negotiator.negotiate("application/vnd.api+json, */*;q=0.1"), 2u);
+    EXPECT_EQ(negotiator.negotiate("text/html, application/*;q=0.2, application/msgpack;q=0.3"), 1u);
+
+    // The most specific range wins, even with a lower weight
+    EXPECT_EQ(negotiator.negotiate("application/json;q=0.1, */*;q=0.9"), 1u);
+
+    // Refused by a zero weight, or accepted by nothing
+    EXPECT_EQ(negotiator.negotiate("application/*;q=0"), std::nullopt);
+    EXPECT_EQ(negotiator.negotiate("text/html, image/png"), std::nullopt);
+    EXPECT_EQ(negotiator.negotiate("*/*, application/json;q=0, application/msgpack;q=0.000"), 2u);
+
+    // Answered from the cache the second time, with the same result
+    for (int i = 0; i < 2; ++i)
+    {
+        EXPECT_EQ(negotiator.negotiate("application/msgpack;q=0.9, application/json;q=0.8"), 1u);
+        EXPECT_EQ(negotiator.negotiate("text/plain"), std::nullopt);
+    }
+
+    // Another negotiator does not see the results of the first one
+    Negotiator text({ MIME(Text, Plain) });
+    EXPECT_EQ(text.negotiate("text/plain"), 0u);
+
+    EXPECT_THROW(Negotiator({}), std::invalid_argument);
+}
+
+TEST(mime_test, selects_the_type_of_a_request)
+{
+    Negotiator negotiator({ MIME(Application, Json), MIME(Text, Plain) });
+
+    Request request;
+    EXPECT_EQ(*negotiator.select(request), MIME(Application, Json));
+
+    request.headers().addRaw(Header::Raw("Accept", "text/*"));
+    EXPECT_EQ(*negotiator.select(request), MIME(Text, Plain));
+
+    Request refused;
+    refused.headers().addRaw(Header::Raw("accept", "image/png"));
+    EXPECT_EQ(negotiator.select(refused), nullptr);
+}
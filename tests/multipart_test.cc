@@ -0,0 +1,247 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+#include <pistache/multipart.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tcp_client.h"
+
+using namespace Pistache;
+
+namespace
+{
+    struct ReceivedPart
+    {
+        std::string name;
+        std::string filename;
+        std::string contentType;
+        std::string data;
+        bool ended = false;
+    };
+
+    // Gathers the parts, and checks that their data points into what was fed
+    class Collector : public Http::Multipart::Handler
+    {
+    public:
+        void onPart(const Http::Multipart::Part& part) override
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            parts.push_back({ part.name, part.filename, part.contentType.toString(), {}, false });
+        }
+
+        void onData(const Http::Multipart::Part&, std::string_view data) override
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (fed.data() != nullptr)
+            {
+                inPlace = inPlace && data.data() >= fed.data()
+                    && data.data() + data.size() <= fed.data() + fed.size();
+            }
+            parts.back().data.append(data);
+        }
+
+        void onPartEnd(const Http::Multipart::Part&) override
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            parts.back().ended = true;
+        }
+
+        void onEnd() override
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            ended = true;
+        }
+
+        void onError(const std::string& reason) override
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            error = reason;
+        }
+
+        std::mutex lock;
+        std::vector<ReceivedPart> parts;
+        bool ended = false;
+        std::string error;
+
+        // Piece being fed, when checked
+        std::string_view fed;
+        bool inPlace = true;
+    };
+
+    const std::string Body = "preamble, ignored\r\n"
+                             "--XyZ\r\n"
+                             "Content-Disposition: form-data; name=\"title\"\r\n"
+                             "\r\n"
+                             "hello\r\n--XyW not yet\r\n"
+                             "--XyZ  \r\n"
+                             "Content-Disposition: form-data; name=\"upload\"; filename=\"a \\\"b\\\".txt\"\r\n"
+                             "Content-Type: application/octet-stream\r\n"
+                             "\r\n"
+                             "\r\r\n\r\n-binary\r\n"
+                             "--XyZ--\r\n"
+                             "epilogue, ignored";
+
+    void expectParts(const Collector& collector)
+    {
+        ASSERT_EQ(collector.parts.size(), 2u);
+        EXPECT_EQ(collector.parts[0].name, "title");
+        EXPECT_EQ(collector.parts[0].filename, "");
+        EXPECT_EQ(collector.parts[0].contentType, "text/plain");
+        EXPECT_EQ(collector.parts[0].data, "hello\r\n--XyW not yet");
+        EXPECT_TRUE(collector.parts[0].ended);
+
+        EXPECT_EQ(collector.parts[1].name, "upload");
+        EXPECT_EQ(collector.parts[1].filename, "a \"b\".txt");
+        EXPECT_EQ(collector.parts[1].contentType, "application/octet-stream");
+        EXPECT_EQ(collector.parts[1].data, "\r\r\n\r\n-binary");
+        EXPECT_TRUE(collector.parts[1].ended);
+
+        EXPECT_TRUE(collector.ended);
+        EXPECT_EQ(collector.error, "");
+    }
+} // namespace
+
+TEST(multipart_test, parses_a_whole_body_in_place)
+{
+    Collector collector;
+    Http::Multipart::Parser parser("XyZ", collector);
+
+    collector.fed = Body;
+    parser.feed(Body);
+
+    EXPECT_TRUE(parser.done());
+    EXPECT_TRUE(collector.inPlace);
+    expectParts(collector);
+}
+
+TEST(multipart_test, parses_any_split_of_the_body)
+{
+    for (size_t piece = 1; piece < 24; ++piece)
+    {
+        Collector collector;
+        Http::Multipart::Parser parser("XyZ", collector);
+
+        for (size_t i = 0; i < Body.size(); i += piece)
+            parser.feed(std::string_view(Body).substr(i, piece));
+
+        EXPECT_TRUE(parser.done()) << piece;
+        expectParts(collector);
+    }
+}
+
+TEST(multipart_test, rejects_malformed_bodies)
+{
+    {
+        Collector collector;
+        Http::Multipart::Parser parser("XyZ", collector);
+        EXPECT_THROW(parser.feed("--XyZ\r\nno colon here\r\n\r\n"), Http::HttpError);
+    }
+    {
+        Collector collector;
+        Http::Multipart::Parser parser("XyZ", collector);
+        EXPECT_THROW(parser.feed("--XyZgarbage\r\n"), Http::HttpError);
+    }
+    {
+        Collector collector;
+        EXPECT_THROW(Http::Multipart::Parser(std::string(71, 'a'), collector), Http::HttpError);
+    }
+    {
+        Collector collector;
+        Http::Multipart::Parser parser("XyZ", collector);
+        parser.feed("--XyZ\r\n" + std::string(Http::Multipart::Parser::MaxHeadersSize, 'a'));
+        EXPECT_THROW(parser.feed("a"), Http::HttpError);
+    }
+}
+
+TEST(multipart_test, boundary_of_a_request)
+{
+    Http::Request request;
+    EXPECT_EQ(Http::Multipart::Parser::boundary(request), std::nullopt);
+
+    request.headers().add<Http::Header::ContentType>(
+        Http::Mime::MediaType::fromString("multipart/form-data; boundary=\"quoted\""));
+    EXPECT_EQ(Http::Multipart::Parser::boundary(request), "quoted");
+}
+
+namespace
+{
+    class UploadHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(UploadHandler)
+
+        explicit UploadHandler(std::shared_ptr<Collector> collector)
+            : collector_(std::move(collector))
+        { }
+
+        std::shared_ptr<Http::BodyReader> onBodyStart(const Http::Request& request,
+                                                      Http::BodyFlow) override
+        {
+            return Http::Multipart::Reader::create(request, collector_);
+        }
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter response) override
+        {
+            std::lock_guard<std::mutex> guard(collector_->lock);
+            response.send(Http::Code::Ok, std::to_string(collector_->parts.size()) + " parts "
+                                              + std::to_string(request.body().size()));
+        }
+
+    private:
+        std::shared_ptr<Collector> collector_;
+    };
+} // namespace
+
+TEST(multipart_test, streams_a_form_upload)
+{
+    auto collector = std::make_shared<Collector>();
+
+    Http::Endpoint endpoint(Address(IP::loopback(), Port(0)));
+    endpoint.init(Http::Endpoint::options().threads(1).flags(Tcp::Options::ReuseAddr));
+    endpoint.setHandler(Http::make_handler<UploadHandler>(collector));
+    endpoint.serveThreaded();
+
+    // Far larger than a buffered request may be
+    const std::string file(2 * 1024 * 1024, 'x');
+    const std::string body = "--b0undary\r\n"
+                             "Content-Disposition: form-data; name=\"file\"; filename=\"big.bin\"\r\n"
+                             "\r\n"
+        + file + "\r\n--b0undary--\r\n";
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(Address(IP::loopback(), endpoint.getPort())));
+    ASSERT_TRUE(client.send("POST /form HTTP/1.1\r\nHost: localhost\r\n"
+                            "Content-Type: multipart/form-data; boundary=b0undary\r\n"
+                            "Content-Length: "
+                            + std::to_string(body.size()) + "\r\n\r\n" + body));
+
+    std::string response;
+    char buffer[1024];
+    while (response.find("parts") == std::string::npos)
+    {
+        size_t bytes = 0;
+        if (!client.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)) || bytes == 0)
+            break;
+        response.append(buffer, bytes);
+    }
+    endpoint.shutdown();
+
+    EXPECT_NE(response.find("1 parts 0"), std::string::npos) << response;
+    std::lock_guard<std::mutex> guard(collector->lock);
+    ASSERT_EQ(collector->parts.size(), 1u);
+    EXPECT_EQ(collector->parts[0].filename, "big.bin");
+    EXPECT_EQ(collector->parts[0].data.size(), file.size());
+    EXPECT_TRUE(collector->ended);
+}
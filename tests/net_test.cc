@@ -8,12 +8,14 @@
 
 #include <pistache/net.h>
 
+#include <cstddef>
 #include <iostream>
 #include <stdexcept>
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 
 using namespace Pistache;
 
@@ -165,6 +167,32 @@ TEST(net_test, invalid_address)
     ASSERT_THROW(Address("1.0.0.256:8080");, std::invalid_argument);
 }
 
+TEST(net_test, unix_socket_address)
+{
+    Address path = Address::unixSocket("/run/service.sock");
+    ASSERT_EQ(path.host(), "/run/service.sock");
+    ASSERT_EQ(path.family(), AF_UNIX);
+    ASSERT_EQ(path.port(), 0);
+
+    struct sockaddr_storage storage;
+    ASSERT_EQ(path.toSockaddr(storage), sizeof(struct sockaddr_un));
+    auto* un = reinterpret_cast<struct sockaddr_un*>(&storage);
+    ASSERT_STREQ(un->sun_path, "/run/service.sock");
+
+    // The name of an abstract socket starts with a null byte, and is as long
+    // as the length of the address says
+    Address abstract("unix:@service");
+    ASSERT_EQ(abstract.host(), "@service");
+    ASSERT_EQ(abstract.family(), AF_UNIX);
+    ASSERT_EQ(abstract.toSockaddr(storage), offsetof(struct sockaddr_un, sun_path) + 8);
+    ASSERT_EQ(std::string(un->sun_path, 8), std::string("\0service", 8));
+
+    ASSERT_EQ(Address::fromUnix(reinterpret_cast<struct sockaddr*>(&storage)).host(), "@service");
+
+    ASSERT_THROW(Address::unixSocket(""), std::invalid_argument);
+    ASSERT_THROW(Address::unixSocket(std::string(sizeof(un->sun_path), 'a')), std::invalid_argument);
+}
+
 TEST(net_test, address_parser)
 {
     AddressParser ap1("127.0.0.1:80");
@@ -0,0 +1,160 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <pistache/client.h>
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+#include <pistache/proxy.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tcp_client.h"
+
+using namespace Pistache;
+
+namespace
+{
+    // Answers with what it received, the body in chunks of a stream
+    class UpstreamHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(UpstreamHandler)
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter response) override
+        {
+            const auto& headers = request.headers();
+            const auto raw      = [&](const std::string& name) {
+                auto header = headers.tryGetRaw(name);
+                return header ? header->value() : std::string("-");
+            };
+
+            response.headers().addRaw(Http::Header::Raw("X-Upstream", "yes"));
+            response.headers().addRaw(Http::Header::Raw("Keep-Alive", "timeout=5"));
+
+            auto stream      = response.stream(Http::Code::Ok);
+            const auto write = [&](const std::string& line) {
+                stream.write(line.data(), static_cast<std::streamsize>(line.size()));
+                stream.flush();
+            };
+            write(std::string(Http::methodString(request.method())) + " " + request.resource()
+                  + request.query().as_str() + "\n");
+            write("custom=" + raw("X-Custom") + " secret=" + raw("X-Secret")
+                  + " forwarded=" + raw("X-Forwarded-For") + "\n");
+            write("body=" + request.body() + "\n");
+            stream.ends();
+        }
+    };
+
+    // Reads until the response contains the text
+    std::string receiveUntil(TcpClient& client, const std::string& text)
+    {
+        std::string response;
+        char buffer[1024];
+        while (response.find(text) == std::string::npos)
+        {
+            size_t bytes = 0;
+            if (!client.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                break;
+            response.append(buffer, bytes);
+        }
+        return response;
+    }
+
+    struct ProxyServer
+    {
+        explicit ProxyServer(std::vector<std::string> upstreams)
+            : client(std::make_shared<Http::Experimental::Client>())
+            , endpoint(Address(IP::loopback(), Port(0)))
+        {
+            client->init();
+            endpoint.init(Http::Endpoint::options().threads(2).flags(Tcp::Options::ReuseAddr));
+            endpoint.setHandler(Http::make_handler<Http::Proxy>(client, std::move(upstreams),
+                                                                std::chrono::seconds(2)));
+            endpoint.serveThreaded();
+        }
+
+        ~ProxyServer()
+        {
+            endpoint.shutdown();
+            client->shutdown();
+        }
+
+        std::string exchange(const std::string& request, const std::string& until)
+        {
+            TcpClient tcp;
+            if (!tcp.connect(Address(IP::loopback(), endpoint.getPort())) || !tcp.send(request))
+                return "";
+            return receiveUntil(tcp, until);
+        }
+
+        std::shared_ptr<Http::Experimental::Client> client;
+        Http::Endpoint endpoint;
+    };
+} // namespace
+
+TEST(proxy_test, forwards_requests_and_streams_responses)
+{
+    Http::Endpoint upstream(Address(IP::loopback(), Port(0)));
+    upstream.init(Http::Endpoint::options().threads(1).flags(Tcp::Options::ReuseAddr));
+    upstream.setHandler(Http::make_handler<UpstreamHandler>());
+    upstream.serveThreaded();
+
+    {
+        ProxyServer proxy({ "127.0.0.1:" + upstream.getPort().toString() });
+
+        const auto response = proxy.exchange("POST /items?page=2 HTTP/1.1\r\n"
+                                             "Host: gateway\r\n"
+                                             "X-Custom: a, b;q=1\r\n"
+                                             "Connection: X-Secret\r\n"
+                                             "X-Secret: 1\r\n"
+                                             "Content-Length: 5\r\n"
+                                             "\r\n"
+                                             "hello",
+                                             "0\r\n\r\n");
+
+        EXPECT_NE(response.find("HTTP/1.1 200 OK\r\n"), std::string::npos) << response;
+        EXPECT_NE(response.find("X-Upstream: yes\r\n"), std::string::npos) << response;
+        EXPECT_NE(response.find("Transfer-Encoding: chunked\r\n"), std::string::npos);
+        EXPECT_EQ(response.find("Keep-Alive"), std::string::npos) << response;
+
+        EXPECT_NE(response.find("POST /items?page=2\n"), std::string::npos) << response;
+        EXPECT_NE(response.find("custom=a, b;q=1 secret=- forwarded=127.0.0.1\n"), std::string::npos)
+            << response;
+        EXPECT_NE(response.find("body=hello\n"), std::string::npos) << response;
+    }
+
+    upstream.shutdown();
+}
+
+TEST(proxy_test, unreachable_upstream_is_a_bad_gateway)
+{
+    // Bound but not listening, the connection is refused
+    const int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(sock, 0);
+    sockaddr_in addr {};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len        = sizeof(addr);
+    ASSERT_EQ(::bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(::getsockname(sock, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+    const auto port = Port(ntohs(addr.sin_port));
+
+    ProxyServer proxy({ "127.0.0.1:" + port.toString() });
+    const auto response = proxy.exchange("GET / HTTP/1.1\r\nHost: gateway\r\n\r\n", "\r\n\r\n");
+    EXPECT_EQ(response.rfind("HTTP/1.1 502 Bad Gateway\r\n", 0), 0u) << response;
+
+    ::close(sock);
+}
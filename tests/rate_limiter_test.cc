@@ -0,0 +1,199 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+#include <pistache/rate_limiter.h>
+#include <pistache/router.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_client.h"
+
+using namespace Pistache;
+using namespace std::chrono_literals;
+
+namespace
+{
+    // Reads until the text shows up, the connection closes or nothing
+    // arrives for the timeout
+    std::string receiveUntil(TcpClient& client, const std::string& text,
+                             std::chrono::milliseconds timeout = std::chrono::seconds(5))
+    {
+        std::string response;
+        char buffer[4096];
+        while (response.find(text) == std::string::npos)
+        {
+            size_t bytes = 0;
+            if (!client.receive(buffer, sizeof(buffer), &bytes, timeout) || bytes == 0)
+                break;
+            response.append(buffer, bytes);
+        }
+        return response;
+    }
+
+    std::string get(const std::string& key)
+    {
+        return "GET / HTTP/1.1\r\nHost: localhost\r\nConnection: Keep-Alive\r\nX-Api-Key: " + key
+            + "\r\n\r\n";
+    }
+
+    size_t count(const std::string& text, const std::string& part)
+    {
+        size_t found = 0;
+        for (auto pos = text.find(part); pos != std::string::npos; pos = text.find(part, pos + 1))
+            ++found;
+        return found;
+    }
+
+    class OkHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(OkHandler)
+
+        void onRequest(const Http::Request&, Http::ResponseWriter response) override
+        {
+            response.send(Http::Code::Ok, "ok");
+        }
+    };
+} // namespace
+
+TEST(rate_limiter_test, buckets_refill_at_the_rate)
+{
+    Http::RateLimiter limiter(2, 4);
+    const auto start = Http::RateLimiter::Clock::now();
+
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(limiter.allow("client", start));
+    EXPECT_FALSE(limiter.allow("client", start));
+    EXPECT_EQ(limiter.limited(), 1u);
+
+    // Every key has a bucket of its own, an empty key is not limited
+    EXPECT_TRUE(limiter.allow("other", start));
+    for (int i = 0; i < 10; ++i)
+        EXPECT_TRUE(limiter.allow("", start));
+
+    // Half a second earns a token at two per second
+    EXPECT_TRUE(limiter.allow("client", start + 500ms));
+    EXPECT_FALSE(limiter.allow("client", start + 500ms));
+
+    // A bucket holds burst tokens at most
+    const auto later = start + 60s;
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(limiter.allow("client", later));
+    EXPECT_FALSE(limiter.allow("client", later));
+}
+
+TEST(rate_limiter_test, threads_lease_tokens_from_the_shared_buckets)
+{
+    // Two tokens a lease, the bucket is shared by both threads
+    Http::RateLimiter limiter(1, 16);
+    const auto start = Http::RateLimiter::Clock::now();
+
+    std::atomic<int> allowed { 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; ++t)
+    {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 20; ++i)
+            {
+                if (limiter.allow("client", start))
+                    ++allowed;
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(allowed.load(), 16);
+    EXPECT_EQ(limiter.limited(), 24u);
+}
+
+TEST(rate_limiter_test, full_buckets_are_dropped_once_reconciled)
+{
+    Http::RateLimiter limiter(100, 8, Http::RateLimiter::byAddress(), 10ms);
+    const auto start = Http::RateLimiter::Clock::now();
+
+    for (int i = 0; i < 3; ++i)
+        EXPECT_TRUE(limiter.allow("client-" + std::to_string(i), start));
+    EXPECT_EQ(limiter.size(), 3u);
+
+    // Refilled a second later, the leases given back and every shard swept
+    for (size_t i = 0; i < Http::RateLimiter::ShardsCount; ++i)
+        limiter.allow("", start + 1s + i * 10ms);
+    EXPECT_EQ(limiter.size(), 0u);
+}
+
+TEST(rate_limiter_test, middleware_answers_with_a_429)
+{
+    auto limiter = std::make_shared<Http::RateLimiter>(0.5, 2, Http::RateLimiter::byHeader("X-Api-Key"));
+
+    Rest::Router router;
+    router.addMiddleware(Rest::Routes::rateLimit(limiter));
+    router.get("/", [](const Rest::Request&, Http::ResponseWriter response) {
+        response.send(Http::Code::Ok, "ok");
+        return Rest::Route::Result::Ok;
+    });
+
+    Http::Endpoint endpoint(Address(IP::loopback(), Port(0)));
+    endpoint.init(Http::Endpoint::options().threads(1).flags(Tcp::Options::ReuseAddr));
+    endpoint.setHandler(router.handler());
+    endpoint.serveThreaded();
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(Address(IP::loopback(), endpoint.getPort())));
+    ASSERT_TRUE(client.send(get("alice") + get("alice") + get("alice") + get("bob")));
+
+    // The responses keep the order of the requests, bob is answered last
+    std::string all;
+    while (count(all, "HTTP/1.1 ") < 4 || all.size() < 2 || all.compare(all.size() - 2, 2, "ok") != 0)
+    {
+        const auto received = receiveUntil(client, "\r\n\r\nok");
+        if (received.empty())
+            break;
+        all += received;
+    }
+    endpoint.shutdown();
+
+    EXPECT_EQ(count(all, "HTTP/1.1 200 OK"), 3u) << all;
+    EXPECT_EQ(count(all, "HTTP/1.1 429 Too Many Requests"), 1u) << all;
+    EXPECT_NE(all.find("Retry-After: 2\r\n"), std::string::npos) << all;
+    EXPECT_NE(all.find("Connection: Keep-Alive\r\n\r\nToo Many Requests"), std::string::npos) << all;
+    EXPECT_EQ(limiter->limited(), 1u);
+}
+
+TEST(rate_limiter_test, endpoint_refuses_before_the_body)
+{
+    auto limiter = std::make_shared<Http::RateLimiter>(1, 1);
+
+    Http::Endpoint endpoint(Address(IP::loopback(), Port(0)));
+    endpoint.init(Http::Endpoint::options().threads(1).flags(Tcp::Options::ReuseAddr).rateLimit(limiter));
+    endpoint.setHandler(Http::make_handler<OkHandler>());
+    endpoint.serveThreaded();
+
+    TcpClient first;
+    ASSERT_TRUE(first.connect(Address(IP::loopback(), endpoint.getPort())));
+    ASSERT_TRUE(first.send(get("")));
+    EXPECT_NE(receiveUntil(first, "\r\n\r\nok").find("200 OK"), std::string::npos);
+
+    // Answered without waiting for the body announced
+    TcpClient second;
+    ASSERT_TRUE(second.connect(Address(IP::loopback(), endpoint.getPort())));
+    ASSERT_TRUE(second.send("POST / HTTP/1.1\r\nHost: localhost\r\nContent-Length: 100000\r\n\r\n"));
+    const auto refused = receiveUntil(second, "\r\n\r\nToo Many Requests");
+    endpoint.shutdown();
+
+    EXPECT_NE(refused.find("HTTP/1.1 429 Too Many Requests"), std::string::npos) << refused;
+    EXPECT_NE(refused.find("Connection: Close\r\n"), std::string::npos) << refused;
+    EXPECT_EQ(limiter->limited(), 1u);
+}
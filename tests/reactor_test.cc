@@ -9,6 +9,10 @@
 
 #include <gtest/gtest.h>
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <memory>
@@ -58,6 +62,178 @@ private:
     std::unordered_set<int> values_;
 };
 
+class EventFdHandler : public Aio::Handler
+{
+    PROTOTYPE_OF(Aio::Handler, EventFdHandler)
+
+public:
+    EventFdHandler()
+        : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    { }
+
+    EventFdHandler(const EventFdHandler&)
+        : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    { }
+
+    ~EventFdHandler() override { close(fd_); }
+
+    void onReady(const Aio::FdSet& fds) override
+    {
+        for (const auto& entry : fds)
+        {
+            if (entry.getTag().value() != static_cast<uint64_t>(fd_))
+            {
+                foreign_.fetch_add(1);
+                continue;
+            }
+
+            uint64_t value;
+            while (::read(fd_, &value, sizeof value) == sizeof value)
+                received_.fetch_add(value);
+        }
+    }
+
+    void registerPoller(Polling::Epoll&) override { }
+
+    Fd fd() const { return fd_; }
+
+    void notify(uint64_t value) const
+    {
+        ASSERT_EQ(::write(fd_, &value, sizeof value), static_cast<ssize_t>(sizeof value));
+    }
+
+    uint64_t received() const { return received_.load(); }
+    int foreign() const { return foreign_.load(); }
+
+private:
+    Fd fd_;
+    std::atomic<uint64_t> received_ { 0 };
+    std::atomic<int> foreign_ { 0 };
+};
+
+TEST(reactor_test, events_reach_the_handler_that_registered_them)
+{
+    auto reactor = Aio::Reactor::create();
+    reactor->init(Aio::SyncContext());
+
+    auto first  = std::make_shared<EventFdHandler>();
+    auto second = std::make_shared<EventFdHandler>();
+
+    auto firstKey  = reactor->addHandler(first);
+    auto secondKey = reactor->addHandler(second);
+    reactor->registerFd(firstKey, first->fd(), Polling::NotifyOn::Read);
+    reactor->registerFd(secondKey, second->fd(), Polling::NotifyOn::Read);
+
+    std::thread thread([&] { reactor->run(); });
+
+    for (uint64_t i = 1; i <= 8; ++i)
+    {
+        first->notify(i);
+        second->notify(10 * i);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((first->received() != 36 || second->received() != 360)
+           && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    reactor->shutdown();
+    thread.join();
+
+    ASSERT_EQ(first->received(), 36u);
+    ASSERT_EQ(second->received(), 360u);
+    ASSERT_EQ(first->foreign(), 0);
+    ASSERT_EQ(second->foreign(), 0);
+}
+
+// Holds the loop in onReady() until released
+class BlockingHandler : public Aio::Handler
+{
+    PROTOTYPE_OF(Aio::Handler, BlockingHandler)
+
+public:
+    BlockingHandler()
+        : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    { }
+
+    BlockingHandler(const BlockingHandler&)
+        : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    { }
+
+    ~BlockingHandler() override { close(fd_); }
+
+    void onReady(const Aio::FdSet&) override
+    {
+        uint64_t value;
+        while (::read(fd_, &value, sizeof value) == sizeof value)
+        { }
+
+        blocked_.store(true);
+        while (!released_.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        blocked_.store(false);
+    }
+
+    void registerPoller(Polling::Epoll&) override { }
+
+    Fd fd() const { return fd_; }
+
+    void wake() const
+    {
+        uint64_t value = 1;
+        ASSERT_EQ(::write(fd_, &value, sizeof value), static_cast<ssize_t>(sizeof value));
+    }
+
+    bool blocked() const { return blocked_.load(); }
+    void release() { released_.store(true); }
+
+private:
+    Fd fd_;
+    std::atomic<bool> blocked_ { false };
+    std::atomic<bool> released_ { false };
+};
+
+TEST(reactor_test, loop_stats_show_a_stalled_handler)
+{
+    auto reactor = Aio::Reactor::create();
+    reactor->init(Aio::SyncContext());
+
+    auto handler = std::make_shared<BlockingHandler>();
+    auto key     = reactor->addHandler(handler);
+    reactor->registerFd(key, handler->fd(), Polling::NotifyOn::Read);
+
+    std::thread thread([&] { reactor->run(); });
+
+    handler->wake();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!handler->blocked() && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ASSERT_TRUE(handler->blocked());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto stats = reactor->loopStats();
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_GE(stats[0].lag, std::chrono::milliseconds(20));
+    EXPECT_GE(stats[0].iterations, 1u);
+    EXPECT_GE(stats[0].events, 1u);
+    EXPECT_EQ(stats[0].maxBatch, 1u);
+
+    handler->release();
+    while (handler->blocked() && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    stats = reactor->loopStats();
+    EXPECT_EQ(stats[0].lag.count(), 0);
+    EXPECT_EQ(stats[0].handlerCalls, 1u);
+    EXPECT_GE(stats[0].maxHandler, std::chrono::milliseconds(20));
+    EXPECT_GE(stats[0].busy, stats[0].maxHandler);
+
+    reactor->shutdown();
+    thread.join();
+}
+
 TEST(reactor_test, reactor_creation)
 {
     constexpr size_t NUM_THREADS          = 2;
@@ -97,6 +273,40 @@ TEST(reactor_test, reactor_creation)
     }
 }
 
+TEST(reactor_test, handlers_sharing_the_workers_get_their_own_events)
+{
+    constexpr size_t NUM_THREADS          = 2;
+    std::shared_ptr<Aio::Reactor> reactor = Aio::Reactor::create();
+    reactor->init(Aio::AsyncContext(NUM_THREADS));
+    auto firstKey = reactor->addHandler(std::make_shared<TransportMock>());
+    reactor->run();
+
+    // Added while the workers run, its queue registered from this thread
+    auto secondKey = reactor->addHandler(std::make_shared<TransportMock>());
+
+    auto first  = reactor->handlers(firstKey);
+    auto second = reactor->handlers(secondKey);
+    ASSERT_EQ(second.size(), NUM_THREADS);
+
+    for (size_t i = 0; i < NUM_THREADS; ++i)
+    {
+        std::static_pointer_cast<TransportMock>(first[i])->push(static_cast<int>(i));
+        std::static_pointer_cast<TransportMock>(second[i])->push(static_cast<int>(10 + i));
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    reactor->shutdown();
+
+    for (size_t i = 0; i < NUM_THREADS; ++i)
+    {
+        const auto& firstValues  = std::static_pointer_cast<TransportMock>(first[i])->values();
+        const auto& secondValues = std::static_pointer_cast<TransportMock>(second[i])->values();
+        ASSERT_EQ(firstValues, std::unordered_set<int>({ static_cast<int>(i) }));
+        ASSERT_EQ(secondValues, std::unordered_set<int>({ static_cast<int>(10 + i) }));
+    }
+}
+
 TEST(reactor_test, reactor_exceed_max_threads)
 {
     constexpr size_t MAX_SUPPORTED_THREADS = 255;
@@ -104,3 +314,36 @@ TEST(reactor_test, reactor_exceed_max_threads)
     ASSERT_THROW(reactor->init(Aio::AsyncContext(5 * MAX_SUPPORTED_THREADS + 1)),
                  std::runtime_error);
 }
+
+TEST(reactor_test, reactor_io_uring_backend)
+{
+    if (!Polling::Epoll::isSupported(Polling::Backend::IoUring))
+        GTEST_SKIP() << "io_uring is not supported by the running kernel";
+
+    constexpr size_t NUM_THREADS          = 2;
+    std::shared_ptr<Aio::Reactor> reactor = Aio::Reactor::create();
+    reactor->init(Aio::AsyncContext(NUM_THREADS, "", Polling::Backend::IoUring));
+    auto key = reactor->addHandler(std::make_shared<TransportMock>());
+    reactor->run();
+
+    auto handlers = reactor->handlers(key);
+
+    for (size_t i = 0; i < handlers.size(); ++i)
+    {
+        auto transport = std::static_pointer_cast<TransportMock>(handlers[i]);
+        for (int value = 0; value < 16; ++value)
+            transport->push(static_cast<int>(i) * 100 + value);
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    reactor->shutdown();
+
+    ASSERT_EQ(handlers.size(), NUM_THREADS);
+
+    for (size_t i = 0; i < handlers.size(); ++i)
+    {
+        auto transport = std::static_pointer_cast<TransportMock>(handlers[i]);
+        ASSERT_EQ(transport->values().size(), 16u);
+    }
+}
@@ -0,0 +1,201 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+#include <pistache/response_cache.h>
+#include <pistache/router.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "tcp_client.h"
+
+using namespace Pistache;
+
+namespace
+{
+    std::string get(Http::Endpoint& endpoint, const std::string& resource,
+                    const std::string& headers = "")
+    {
+        TcpClient client;
+        if (!client.connect(Address(IP::loopback(), endpoint.getPort())))
+            return {};
+        if (!client.send("GET " + resource + " HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n"))
+            return {};
+
+        std::string response;
+        char buffer[4096];
+        while (true)
+        {
+            size_t bytes = 0;
+            if (!client.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                break;
+            response.append(buffer, bytes);
+
+            const auto end = response.find("\r\n\r\n");
+            const auto cl  = response.find("Content-Length: ");
+            if (end != std::string::npos && cl != std::string::npos
+                && response.size() >= end + 4 + std::stoul(response.substr(cl + 16)))
+                break;
+        }
+        return response;
+    }
+
+    // Answers with the number of calls so far, and the headers given
+    Rest::Route::Handler counting(std::atomic<int>& calls, std::string cacheControl,
+                                  std::string vary = "")
+    {
+        return [&calls, cacheControl, vary](const Rest::Request&, Http::ResponseWriter response) {
+            if (!cacheControl.empty())
+                response.headers().addRaw(Http::Header::Raw("Cache-Control", cacheControl));
+            if (!vary.empty())
+                response.headers().add<Http::Header::Vary>(vary);
+            response.send(Http::Code::Ok, "call " + std::to_string(++calls));
+            return Rest::Route::Result::Ok;
+        };
+    }
+
+    struct Server
+    {
+        explicit Server(Rest::Router& router)
+            : endpoint(Address(IP::loopback(), Port(0)))
+        {
+            endpoint.init(Http::Endpoint::options().threads(2).flags(Tcp::Options::ReuseAddr));
+            endpoint.setHandler(router.handler());
+            endpoint.serveThreaded();
+        }
+
+        ~Server() { endpoint.shutdown(); }
+
+        Http::Endpoint endpoint;
+    };
+} // namespace
+
+TEST(response_cache_test, serves_hits_without_calling_the_handler)
+{
+    auto cache = std::make_shared<Rest::ResponseCache>();
+    std::atomic<int> calls { 0 };
+
+    Rest::Router router;
+    router.addMiddleware(Rest::Routes::cache(cache));
+    router.get("/fresh", counting(calls, "max-age=60"));
+
+    Server server(router);
+
+    const auto first = get(server.endpoint, "/fresh");
+    EXPECT_NE(first.find("call 1"), std::string::npos) << first;
+    EXPECT_EQ(first.find("Age:"), std::string::npos) << first;
+
+    const auto second = get(server.endpoint, "/fresh");
+    EXPECT_EQ(second.rfind("HTTP/1.1 200 OK\r\n", 0), 0u) << second;
+    EXPECT_NE(second.find("call 1"), std::string::npos) << second;
+    EXPECT_NE(second.find("Age: 0\r\n\r\n"), std::string::npos) << second;
+
+    // The query is part of the key
+    EXPECT_NE(get(server.endpoint, "/fresh?page=2").find("call 2"), std::string::npos);
+
+    EXPECT_EQ(calls.load(), 2);
+    EXPECT_EQ(cache->hits(), 1u);
+    EXPECT_EQ(cache->misses(), 2u);
+    EXPECT_EQ(cache->size(), 2u);
+}
+
+TEST(response_cache_test, respects_cache_control)
+{
+    auto cache = std::make_shared<Rest::ResponseCache>();
+    std::atomic<int> stored { 0 }, notStored { 0 }, noFreshness { 0 };
+
+    Rest::Router router;
+    router.get("/stored", Rest::Routes::cached(cache, counting(stored, "public, s-maxage=60")));
+    router.get("/not-stored", Rest::Routes::cached(cache, counting(notStored, "no-store")));
+    router.get("/no-freshness", Rest::Routes::cached(cache, counting(noFreshness, "")));
+
+    Server server(router);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        get(server.endpoint, "/stored");
+        get(server.endpoint, "/not-stored");
+        get(server.endpoint, "/no-freshness");
+    }
+    EXPECT_EQ(stored.load(), 1);
+    EXPECT_EQ(notStored.load(), 2);
+    EXPECT_EQ(noFreshness.load(), 2);
+
+    // Asked for a fresh response, which then replaces the cached one
+    const auto refreshed = get(server.endpoint, "/stored", "Cache-Control: no-cache\r\n");
+    EXPECT_NE(refreshed.find("call 2"), std::string::npos) << refreshed;
+    EXPECT_NE(get(server.endpoint, "/stored").find("call 2"), std::string::npos);
+
+    // Neither conditional nor authorized requests are answered from the cache
+    get(server.endpoint, "/stored", "If-None-Match: \"x\"\r\n");
+    get(server.endpoint, "/stored", "Authorization: Basic dTpw\r\n");
+    EXPECT_EQ(stored.load(), 4);
+}
+
+TEST(response_cache_test, keys_on_the_vary_headers)
+{
+    auto cache = std::make_shared<Rest::ResponseCache>(std::vector<std::string> { "Accept-Language" });
+    std::atomic<int> language { 0 }, other { 0 };
+
+    Rest::Router router;
+    router.get("/language", Rest::Routes::cached(cache, counting(language, "max-age=60", "accept-language")));
+    router.get("/other", Rest::Routes::cached(cache, counting(other, "max-age=60", "User-Agent")));
+
+    Server server(router);
+
+    EXPECT_NE(get(server.endpoint, "/language", "Accept-Language: fr\r\n").find("call 1"),
+              std::string::npos);
+    EXPECT_NE(get(server.endpoint, "/language", "Accept-Language: en\r\n").find("call 2"),
+              std::string::npos);
+    EXPECT_NE(get(server.endpoint, "/language", "Accept-Language: fr\r\n").find("call 1"),
+              std::string::npos);
+
+    // Varies on a header that the key does not hold
+    get(server.endpoint, "/other");
+    get(server.endpoint, "/other");
+    EXPECT_EQ(other.load(), 2);
+    EXPECT_EQ(cache->size(), 2u);
+}
+
+TEST(response_cache_test, stays_within_its_byte_budget)
+{
+    const size_t maxBytes = 16 * 1024;
+    auto cache = std::make_shared<Rest::ResponseCache>(std::vector<std::string>(), maxBytes,
+                                                       std::chrono::seconds(60));
+    std::atomic<int> calls { 0 };
+
+    Rest::Router router;
+    router.get("/items/:id", Rest::Routes::cached(cache, [&calls](const Rest::Request&,
+                                                                  Http::ResponseWriter response) {
+                   ++calls;
+                   response.send(Http::Code::Ok, std::string(300, 'x'));
+                   return Rest::Route::Result::Ok;
+               }));
+
+    Server server(router);
+
+    for (int i = 0; i < 200; ++i)
+        get(server.endpoint, "/items/" + std::to_string(i));
+
+    EXPECT_EQ(calls.load(), 200);
+    EXPECT_LE(cache->bytes(), maxBytes);
+    EXPECT_GT(cache->size(), 0u);
+    EXPECT_LT(cache->size(), 200u);
+
+    // The most recent one is still there
+    get(server.endpoint, "/items/199");
+    EXPECT_EQ(calls.load(), 200);
+
+    cache->clear();
+    EXPECT_EQ(cache->size(), 0u);
+    EXPECT_EQ(cache->bytes(), 0u);
+}
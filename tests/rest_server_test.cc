@@ -6,6 +6,7 @@
 
 #include <gtest/gtest.h>
 
+#include <pistache/description.h>
 #include <pistache/endpoint.h>
 #include <pistache/http.h>
 #include <pistache/peer.h>
@@ -13,7 +14,11 @@
 
 #include <httplib.h>
 
+#include <atomic>
 #include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
 #include <thread>
 
 using namespace std;
@@ -73,7 +78,13 @@ private:
     void doResolveClient(const Rest::Request& /*request*/,
                          Http::ResponseWriter response)
     {
-        response.send(Http::Code::Ok, response.peer()->hostname());
+        auto peer   = response.peer();
+        auto writer = std::make_shared<Http::ResponseWriter>(std::move(response));
+        peer->resolveHostname().then(
+            [writer](const std::string& name) { writer->send(Http::Code::Ok, name); },
+            [writer, peer](std::exception_ptr) {
+                writer->send(Http::Code::Ok, peer->hostname());
+            });
     }
 
     std::shared_ptr<Http::Endpoint> httpEndpoint;
@@ -256,3 +267,58 @@ TEST(rest_server_test, keepalive_multithread_client_request)
 
     stats.shutdown();
 }
+
+TEST(rest_server_test, swagger_serializes_the_description_once)
+{
+    const auto ui = std::filesystem::temp_directory_path() / "pistache-swagger-ui";
+    std::filesystem::create_directories(ui);
+    std::ofstream(ui / "index.html") << "index";
+
+    std::atomic<int> serialized { 0 };
+    Rest::Description description("Swagger API", "1.0");
+    Rest::Swagger swagger(description);
+    swagger.uiPath("/doc")
+        .uiDirectory(ui.string())
+        .apiPath("/api.json")
+        .serializer([&serialized](const Rest::Description& desc) {
+            ++serialized;
+            return "{\"title\":\"" + desc.rawInfo().title + "\"}";
+        });
+
+    Rest::Router router;
+    swagger.install(router);
+
+    Http::Endpoint endpoint(Address(Ipv4::loopback(), Port(0)));
+    endpoint.init(Http::Endpoint::options().threads(1));
+    endpoint.setHandler(router.handler());
+    endpoint.serveThreaded();
+
+    httplib::Client client("localhost", endpoint.getPort());
+    auto first  = client.Get("/api.json");
+    auto second = client.Get("/api.json");
+    ASSERT_EQ(first->status, 200);
+    ASSERT_EQ(first->body, "{\"title\":\"Swagger API\"}");
+    ASSERT_EQ(second->body, first->body);
+    EXPECT_EQ(serialized.load(), 1);
+
+    // Served again only when it changed
+    const auto etag = first->get_header_value("ETag");
+    ASSERT_FALSE(etag.empty());
+    auto unchanged = client.Get("/api.json", { { "If-None-Match", etag } });
+    EXPECT_EQ(unchanged->status, 304);
+
+    swagger.description(Rest::Description("Updated API", "2.0"));
+    auto updated = client.Get("/api.json", { { "If-None-Match", etag } });
+    ASSERT_EQ(updated->status, 200);
+    EXPECT_EQ(updated->body, "{\"title\":\"Updated API\"}");
+    EXPECT_NE(updated->get_header_value("ETag"), etag);
+    EXPECT_EQ(serialized.load(), 2);
+
+    auto index = client.Get("/doc/");
+    ASSERT_EQ(index->status, 200);
+    EXPECT_EQ(index->body, "index");
+    EXPECT_FALSE(index->get_header_value("ETag").empty());
+
+    endpoint.shutdown();
+    std::filesystem::remove_all(ui);
+}
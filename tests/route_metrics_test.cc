@@ -0,0 +1,150 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+#include <pistache/route_metrics.h>
+#include <pistache/router.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "tcp_client.h"
+
+using namespace Pistache;
+
+TEST(route_metrics_test, histogram_buckets)
+{
+    for (uint64_t value = 0; value < 100000; value += 7)
+    {
+        const auto bucket = Rest::LatencyHistogram::bucketOf(value);
+        EXPECT_GE(Rest::LatencyHistogram::upperBound(bucket), value);
+        if (bucket > 0)
+        {
+            EXPECT_LT(Rest::LatencyHistogram::upperBound(bucket - 1), value);
+        }
+    }
+
+    const auto last = Rest::LatencyHistogram::bucketOf(Rest::LatencyHistogram::MaxValue);
+    EXPECT_EQ(last, Rest::LatencyHistogram::BucketsCount - 1);
+    EXPECT_EQ(Rest::LatencyHistogram::bucketOf(UINT64_MAX), last);
+}
+
+TEST(route_metrics_test, histogram_quantiles)
+{
+    Rest::LatencyHistogram histogram;
+    for (int i = 1; i <= 1000; ++i)
+        histogram.record(std::chrono::microseconds(i));
+
+    Rest::LatencyHistogram::Snapshot snapshot;
+    histogram.addTo(snapshot);
+    EXPECT_EQ(snapshot.count, 1000u);
+    EXPECT_EQ(snapshot.sum, 500500u);
+    EXPECT_EQ(snapshot.max, 1000u);
+
+    const auto p50 = snapshot.quantile(0.5).count();
+    EXPECT_GE(p50, 500);
+    EXPECT_LE(p50, 500 + 500 / 16);
+    EXPECT_EQ(snapshot.quantile(0.999).count(), 1000);
+    EXPECT_EQ(snapshot.quantile(0).count(), 1);
+
+    EXPECT_EQ(Rest::LatencyHistogram::Snapshot().quantile(0.5).count(), 0);
+}
+
+namespace
+{
+    std::string get(Http::Endpoint& endpoint, const std::string& resource)
+    {
+        TcpClient client;
+        if (!client.connect(Address(IP::loopback(), endpoint.getPort())))
+            return {};
+        if (!client.send("GET " + resource + " HTTP/1.1\r\nHost: localhost\r\n\r\n"))
+            return {};
+
+        std::string response;
+        char buffer[4096];
+        while (true)
+        {
+            size_t bytes = 0;
+            if (!client.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                break;
+            response.append(buffer, bytes);
+
+            const auto end = response.find("\r\n\r\n");
+            const auto cl  = response.find("Content-Length: ");
+            if (end != std::string::npos && cl != std::string::npos
+                && response.size() >= end + 4 + std::stoul(response.substr(cl + 16)))
+                break;
+        }
+        return response;
+    }
+} // namespace
+
+TEST(route_metrics_test, serves_the_metrics_of_the_routes)
+{
+    Rest::Router router;
+    Rest::Routes::Metrics(router);
+    router.get("/users/:id", [](const Rest::Request&, Http::ResponseWriter response) {
+        response.send(Http::Code::Ok, "user");
+        return Rest::Route::Result::Ok;
+    });
+    router.get("/fail", [](const Rest::Request&, Http::ResponseWriter response) {
+        response.send(Http::Code::Internal_Server_Error, "failed");
+        return Rest::Route::Result::Ok;
+    });
+
+    Http::Endpoint endpoint(Address(IP::loopback(), Port(0)));
+    endpoint.init(Http::Endpoint::options().threads(2).flags(Tcp::Options::ReuseAddr));
+    endpoint.setHandler(router.handler());
+    endpoint.serveThreaded();
+
+    EXPECT_NE(get(endpoint, "/users/1").find("user"), std::string::npos);
+    EXPECT_NE(get(endpoint, "/users/2").find("user"), std::string::npos);
+    EXPECT_NE(get(endpoint, "/fail").find("failed"), std::string::npos);
+
+    // A response is recorded once written, which may be after the client
+    // got it
+    auto metrics        = router.metrics();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    auto written        = [&] {
+        uint64_t total = 0;
+        for (const auto& route : metrics->collect())
+            for (auto count : route.metrics.responses)
+                total += count;
+        return total;
+    };
+    while (written() < 3 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    const auto stats = metrics->collect();
+    ASSERT_EQ(stats.size(), 3u);
+    EXPECT_EQ(stats[1].resource, "/users/:id");
+    EXPECT_EQ(stats[1].metrics.requests, 2u);
+    EXPECT_EQ(stats[1].metrics.responses[1], 2u);
+    EXPECT_EQ(stats[1].metrics.dispatch.count, 2u);
+    EXPECT_EQ(stats[1].metrics.response.count, 2u);
+    EXPECT_EQ(stats[2].metrics.responses[4], 1u);
+
+    const auto text = get(endpoint, "/metrics");
+    endpoint.shutdown();
+
+    EXPECT_NE(text.find("Content-Type: text/plain; version=0.0.4"), std::string::npos) << text;
+    EXPECT_NE(text.find("pistache_route_requests_total{method=\"GET\",route=\"/users/:id\"} 2\n"),
+              std::string::npos)
+        << text;
+    EXPECT_NE(text.find("pistache_route_responses_total{method=\"GET\",route=\"/fail\",code=\"5xx\"} 1\n"),
+              std::string::npos)
+        << text;
+    EXPECT_NE(text.find("pistache_route_response_seconds{method=\"GET\",route=\"/users/:id\",quantile=\"0.99\"}"),
+              std::string::npos)
+        << text;
+    EXPECT_NE(text.find("pistache_route_dispatch_seconds_count{method=\"GET\",route=\"/users/:id\"} 2\n"),
+              std::string::npos)
+        << text;
+}
@@ -11,7 +11,10 @@
 */
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <gtest/gtest.h>
+#include <thread>
 
 #include <pistache/common.h>
 #include <pistache/endpoint.h>
@@ -163,6 +166,248 @@ TEST(router_test, test_mixed)
     ASSERT_TRUE(matchSplat(routes, "/hi", { "hi" }));
 }
 
+TEST(router_test, test_route_table_matches_like_the_tree)
+{
+    // The tree does not own its segments, keep them alive
+    std::vector<std::string> resources;
+    for (const auto* resource : { "/v1/hello", "/v1/hello/:name", "/v1/:version/hello",
+                                  "/get/:key?/bar", "/say/*/to/*", "/greetings/:from/:to",
+                                  "/hello", "/*", "/a/b/c" })
+        resources.push_back(SegmentTreeNode::sanitizeResource(resource));
+
+    SegmentTreeNode routes;
+    for (const auto& s : resources)
+        routes.addRoute(std::string_view { s.data(), s.length() }, nullptr, nullptr);
+
+    const RouteTable table(routes);
+
+    const char* requests[] = {
+        "/v1/hello", "/v1/hello/joe", "/v1/v2/hello", "/get/bar", "/get/foo/bar",
+        "/say/hello/to/user", "/say/hello/to", "/greetings/foo/bar", "/hello",
+        "/hi", "/a/b/c", "/a/b", "/nope/nope/nope/nope"
+    };
+    for (const auto* request : requests)
+    {
+        const auto s = SegmentTreeNode::sanitizeResource(request);
+
+        auto [route, params, splats] = routes.findRoute({ s.data(), s.size() });
+
+        RouteTable::Match match;
+        ASSERT_EQ(table.find(s, match), route != nullptr) << request;
+        if (route == nullptr)
+            continue;
+
+        ASSERT_EQ(match.route, route.get()) << request;
+        ASSERT_EQ(match.paramsCount, params.size()) << request;
+        for (size_t i = 0; i < params.size(); ++i)
+        {
+            ASSERT_EQ(match.params[i].name, params[i].name());
+            ASSERT_EQ(match.params[i].value, params[i].as<std::string>());
+        }
+        ASSERT_EQ(match.splatsCount, splats.size()) << request;
+        for (size_t i = 0; i < splats.size(); ++i)
+            ASSERT_EQ(match.splats[i], splats[i].as<std::string>());
+    }
+}
+
+TEST(router_test, test_route_table_captures_point_into_the_path)
+{
+    SegmentTreeNode routes;
+    const auto s = SegmentTreeNode::sanitizeResource("/users/:id/files/*");
+    routes.addRoute(std::string_view { s.data(), s.length() }, nullptr, nullptr);
+
+    const RouteTable table(routes);
+    const std::string_view path = "users/42/files/report";
+
+    RouteTable::Match match;
+    ASSERT_TRUE(table.find(path, match));
+    ASSERT_EQ(match.paramsCount, 1u);
+    ASSERT_EQ(match.params[0].name, ":id");
+    ASSERT_EQ(match.params[0].value.data(), path.data() + 6);
+    ASSERT_EQ(match.splatsCount, 1u);
+    ASSERT_EQ(match.splats[0].data(), path.data() + 15);
+}
+
+TEST(router_test, test_frozen_router)
+{
+    Address addr(Ipv4::any(), 0);
+    auto endpoint = std::make_shared<Http::Endpoint>(addr);
+
+    auto opts = Http::Endpoint::options().threads(1).maxRequestSize(4096);
+    endpoint->init(opts);
+
+    Rest::Router router;
+    Routes::Get(router, "/moogle/:name",
+                [](const Pistache::Rest::Request& request,
+                   Pistache::Http::ResponseWriter response) {
+                    response.send(Pistache::Http::Code::Ok,
+                                  request.param(":name").as<std::string>());
+                    return Pistache::Rest::Route::Result::Ok;
+                });
+    Routes::Post(router, "/kefka",
+                 [](const Pistache::Rest::Request&,
+                    Pistache::Http::ResponseWriter response) {
+                     response.send(Pistache::Http::Code::Ok);
+                     return Pistache::Rest::Route::Result::Ok;
+                 });
+
+    router.freeze();
+    ASSERT_TRUE(router.isFrozen());
+    ASSERT_THROW(Routes::Get(router, "/vicks", nullptr), std::runtime_error);
+    ASSERT_THROW(Routes::Remove(router, Http::Method::Get, "/moogle/:name"), std::runtime_error);
+
+    endpoint->setHandler(router.handler());
+    endpoint->serveThreaded();
+    const auto bound_port = endpoint->getPort();
+    httplib::Client client("localhost", bound_port);
+
+    auto found = client.Get("/moogle/kupo");
+    ASSERT_EQ(found->status, int(Pistache::Http::Code::Ok));
+    ASSERT_EQ(found->body, "kupo");
+
+    auto notAllowed = client.Get("/kefka");
+    ASSERT_EQ(notAllowed->status, int(Pistache::Http::Code::Method_Not_Allowed));
+
+    auto notFound = client.Get("/wedge");
+    ASSERT_EQ(notFound->status, int(Pistache::Http::Code::Not_Found));
+
+    endpoint->shutdown();
+}
+
+TEST(router_test, test_published_routes_change_while_serving)
+{
+    Address addr(Ipv4::any(), 0);
+    auto endpoint = std::make_shared<Http::Endpoint>(addr);
+    endpoint->init(Http::Endpoint::options().threads(2));
+
+    auto answer = [](std::string body) {
+        return [body](const Rest::Request&, Http::ResponseWriter response) {
+            response.send(Http::Code::Ok, body);
+            return Route::Result::Ok;
+        };
+    };
+
+    Rest::Router router;
+    Routes::Get(router, "/moogle", answer("moogle"));
+    ASSERT_EQ(router.version(), 0u);
+    router.publish();
+    ASSERT_EQ(router.version(), 1u);
+
+    // The copy given to the endpoint routes with the published tables
+    endpoint->setHandler(router.handler());
+    endpoint->serveThreaded();
+    httplib::Client client("localhost", endpoint->getPort());
+
+    ASSERT_EQ(client.Get("/moogle")->body, "moogle");
+
+    // Not seen until published, then all at once
+    Routes::Get(router, "/kefka", answer("kefka"));
+    Routes::Remove(router, Http::Method::Get, "/moogle");
+    ASSERT_EQ(client.Get("/moogle")->status, int(Http::Code::Ok));
+    ASSERT_EQ(client.Get("/kefka")->status, int(Http::Code::Not_Found));
+
+    router.publish();
+    ASSERT_EQ(router.version(), 2u);
+    ASSERT_EQ(client.Get("/moogle")->status, int(Http::Code::Not_Found));
+    ASSERT_EQ(client.Get("/kefka")->body, "kefka");
+
+    // Lookups go on while the routes change
+    std::atomic<bool> stop { false };
+    std::atomic<int> failures { 0 };
+    std::thread reader([&] {
+        httplib::Client reading("localhost", endpoint->getPort());
+        while (!stop)
+        {
+            auto res = reading.Get("/kefka");
+            if (!res || res->body != "kefka")
+                ++failures;
+        }
+    });
+    for (int i = 0; i < 200; ++i)
+    {
+        const auto resource = "/wedge/" + std::to_string(i);
+        Routes::Get(router, resource, answer("wedge"));
+        router.publish();
+        Routes::Remove(router, Http::Method::Get, resource);
+        router.publish();
+    }
+    stop = true;
+    reader.join();
+    ASSERT_EQ(failures.load(), 0);
+
+    router.freeze();
+    ASSERT_THROW(router.publish(), std::runtime_error);
+
+    endpoint->shutdown();
+}
+
+TEST(router_test, test_allowed_methods)
+{
+    std::vector<std::string> resources;
+    for (const auto* resource : { "/users/:id", "/users/me", "/files/*", "/get/:key?/bar" })
+        resources.push_back(SegmentTreeNode::sanitizeResource(resource));
+
+    SegmentTreeNode routes;
+    routes.addMethod({ resources[0].data(), resources[0].size() }, Http::Method::Get, nullptr);
+    routes.addMethod({ resources[0].data(), resources[0].size() }, Http::Method::Delete, nullptr);
+    routes.addMethod({ resources[1].data(), resources[1].size() }, Http::Method::Put, nullptr);
+    routes.addMethod({ resources[2].data(), resources[2].size() }, Http::Method::Post, nullptr);
+    routes.addMethod({ resources[3].data(), resources[3].size() }, Http::Method::Patch, nullptr);
+
+    auto allowed = [&](const std::string_view path) {
+        std::vector<Http::Method> methods;
+        const auto set = routes.allowedMethods(path);
+        for (size_t i = 0; i < set.size(); ++i)
+        {
+            if (set.test(i))
+                methods.push_back(static_cast<Http::Method>(i));
+        }
+        return methods;
+    };
+
+    using Methods = std::vector<Http::Method>;
+
+    // Every pattern matching the path contributes
+    ASSERT_EQ(allowed("users/me"), (Methods { Http::Method::Get, Http::Method::Put, Http::Method::Delete }));
+    ASSERT_EQ(allowed("users/42"), (Methods { Http::Method::Get, Http::Method::Delete }));
+    ASSERT_EQ(allowed("files/report"), (Methods { Http::Method::Post }));
+    ASSERT_EQ(allowed("get/foo/bar"), (Methods { Http::Method::Patch }));
+    ASSERT_TRUE(allowed("nowhere").empty());
+
+    routes.removeMethod({ resources[0].data(), resources[0].size() }, Http::Method::Get);
+    ASSERT_EQ(allowed("users/42"), (Methods { Http::Method::Delete }));
+}
+
+TEST(router_test, test_method_not_allowed)
+{
+    Address addr(Ipv4::any(), 0);
+    auto endpoint = std::make_shared<Http::Endpoint>(addr);
+
+    auto opts = Http::Endpoint::options().threads(1);
+    endpoint->init(opts);
+
+    auto ok = [](const Rest::Request&, Http::ResponseWriter response) {
+        response.send(Http::Code::Ok);
+        return Route::Result::Ok;
+    };
+
+    Rest::Router router;
+    Routes::Put(router, "/moogle/:name", ok);
+    Routes::Delete(router, "/moogle/kupo", ok);
+    Routes::Get(router, "/kefka", ok);
+    endpoint->setHandler(router.handler());
+    endpoint->serveThreaded();
+
+    const auto bound_port = endpoint->getPort();
+    httplib::Client client("localhost", bound_port);
+
+    auto response = client.Get("/moogle/kupo");
+    ASSERT_EQ(response->status, int(Pistache::Http::Code::Method_Not_Allowed));
+    ASSERT_EQ(response->get_header_value("Allow"), "PUT, DELETE");
+
+    endpoint->shutdown();
+}
+
 TEST(router_test, test_notfound_exactly_once)
 {
     Address addr(Ipv4::any(), 0);
@@ -305,6 +550,74 @@ TEST(router_test, test_bind_shared_ptr)
     endpoint->shutdown();
 }
 
+Rest::Route::Result handleFree(const Rest::Request&, Http::ResponseWriter response)
+{
+    response.send(Http::Code::Ok);
+    return Rest::Route::Result::Ok;
+}
+
+TEST(router_test, test_bind_at_compile_time)
+{
+    Address addr(Ipv4::any(), 0);
+    auto endpoint = std::make_shared<Http::Endpoint>(addr);
+    endpoint->init(Http::Endpoint::options().threads(1));
+
+    auto sharedPtr = std::make_shared<MyHandler>();
+    MyHandler plain;
+
+    Rest::Router router;
+    Routes::Head(router, "/shared", Routes::bind<&MyHandler::handle>(sharedPtr));
+    Routes::Head(router, "/const", Routes::bind<&MyHandler::handleConst>(sharedPtr));
+    Routes::Head(router, "/plain", Routes::bind<&MyHandler::handle>(&plain));
+    Routes::Head(router, "/free", Routes::bind<&handleFree>());
+
+    endpoint->setHandler(router.handler());
+    endpoint->serveThreaded();
+    httplib::Client client("localhost", endpoint->getPort());
+
+    client.Head("/shared");
+    client.Head("/const");
+    EXPECT_EQ(sharedPtr->getCount(), 2);
+    client.Head("/plain");
+    EXPECT_EQ(plain.getCount(), 1);
+    auto res = client.Head("/free");
+    ASSERT_TRUE(res);
+    EXPECT_EQ(res->status, 200);
+
+    endpoint->shutdown();
+}
+
+TEST(router_test, test_handler_holds_small_callables)
+{
+    Rest::Route::Handler empty;
+    EXPECT_TRUE(empty == nullptr);
+
+    // Copied and moved along with what it captured
+    auto owner = std::make_shared<int>(0);
+    Rest::Route::Handler handler = [owner](const Rest::Request&, Http::ResponseWriter) {
+        ++*owner;
+        return Rest::Route::Result::Ok;
+    };
+    EXPECT_TRUE(handler != nullptr);
+
+    auto copy  = handler;
+    auto moved = std::move(handler);
+    EXPECT_TRUE(handler == nullptr);
+    EXPECT_EQ(owner.use_count(), 3);
+
+    // Larger than the inline storage, the callable lives on the heap
+    std::array<char, Rest::Route::Handler::InlineSize> large {};
+    Rest::Route::Handler heavy = [owner, large](const Rest::Request&, Http::ResponseWriter) {
+        return large.empty() ? Rest::Route::Result::Failure : Rest::Route::Result::Ok;
+    };
+    copy = heavy;
+    EXPECT_EQ(owner.use_count(), 4);
+
+    copy  = nullptr;
+    heavy = Rest::Route::Handler();
+    EXPECT_EQ(owner.use_count(), 2);
+}
+
 class HandlerWithAuthMiddleware : public MyHandler
 {
 public:
@@ -380,6 +693,42 @@ TEST(router_test, test_middleware_stop_processing)
     ASSERT_EQ(response->status, int(Pistache::Http::Code::No_Content));
 }
 
+TEST(router_test, test_middleware_changes_reach_every_handler)
+{
+    Address addr(Ipv4::any(), 0);
+    auto endpoint = std::make_shared<Http::Endpoint>(addr);
+
+    auto opts = Http::Endpoint::options().threads(1);
+    endpoint->init(opts);
+
+    Rest::Router router;
+    router.addMiddleware([](Http::Request& request, Http::ResponseWriter& response) {
+        request.headers().addRaw(Http::Header::Raw("X-Seen", "yes"));
+        response.headers().add<Http::Header::Server>("middleware");
+        return true;
+    });
+    router.addCustomHandler([](const Rest::Request& request, Http::ResponseWriter) {
+        EXPECT_TRUE(request.headers().tryGetRaw("X-Seen").has_value());
+        return Route::Result::Failure;
+    });
+    Routes::NotFound(router, [](const Rest::Request& request, Http::ResponseWriter response) {
+        response.send(Http::Code::Not_Found, request.headers().getRaw("X-Seen").value());
+        return Route::Result::Ok;
+    });
+    endpoint->setHandler(router.handler());
+    endpoint->serveThreaded();
+
+    const auto bound_port = endpoint->getPort();
+    httplib::Client client("localhost", bound_port);
+
+    auto response = client.Get("/nowhere");
+    ASSERT_EQ(response->status, int(Pistache::Http::Code::Not_Found));
+    ASSERT_EQ(response->body, "yes");
+    ASSERT_EQ(response->get_header_value("Server"), "middleware");
+
+    endpoint->shutdown();
+}
+
 TEST(router_test, test_auth_middleware)
 {
     Address addr(Ipv4::any(), 0);
@@ -416,6 +765,24 @@ TEST(segment_tree_node_test, test_resource_sanitize)
     ASSERT_EQ(SegmentTreeNode::sanitizeResource("/path//to/bar"), "path/to/bar");
     ASSERT_EQ(SegmentTreeNode::sanitizeResource("/path//to/bar"), "path/to/bar");
     ASSERT_EQ(SegmentTreeNode::sanitizeResource("/path/to///////:place"), "path/to/:place");
+    ASSERT_EQ(SegmentTreeNode::sanitizeResource("//path/to//"), "path/to");
+    ASSERT_EQ(SegmentTreeNode::sanitizeResource("/"), "");
+}
+
+TEST(segment_tree_node_test, test_clean_resource_is_not_copied)
+{
+    std::string storage;
+
+    const std::string clean = "/path/to/bar/";
+    auto sanitized          = SegmentTreeNode::sanitizeResource(clean, storage);
+    ASSERT_EQ(sanitized, "path/to/bar");
+    ASSERT_EQ(sanitized.data(), clean.data() + 1);
+    ASSERT_TRUE(storage.empty());
+
+    const std::string dirty = "/path//to///bar";
+    sanitized               = SegmentTreeNode::sanitizeResource(dirty, storage);
+    ASSERT_EQ(sanitized, "path/to/bar");
+    ASSERT_EQ(sanitized.data(), storage.data());
 }
 
 namespace
@@ -486,3 +853,27 @@ namespace
         ASSERT_EQ(result, 1);
     }
 } // namespace
+
+TEST(router_test, typed_params_convert_without_a_stream)
+{
+    ASSERT_EQ(TypedParam("id", "42").as<int>(), 42);
+    ASSERT_EQ(TypedParam("id", " +42").as<long>(), 42);
+    ASSERT_EQ(TypedParam("id", "-7").as<int64_t>(), -7);
+    ASSERT_EQ(TypedParam("id", "12abc").as<unsigned>(), 12u);
+    ASSERT_DOUBLE_EQ(TypedParam("ratio", "2.5").as<double>(), 2.5);
+    ASSERT_FLOAT_EQ(TypedParam("ratio", "1e3").as<float>(), 1000.0f);
+
+    ASSERT_THROW(TypedParam("id", "abc").as<int>(), std::runtime_error);
+    ASSERT_THROW(TypedParam("id", "").as<int>(), std::runtime_error);
+    ASSERT_THROW(TypedParam("id", "70000").as<uint16_t>(), std::runtime_error);
+    ASSERT_THROW(TypedParam("id", "99999999999999999999").as<int64_t>(), std::runtime_error);
+
+    // bool and the character types still go through the stream
+    ASSERT_EQ(TypedParam("flag", "1").as<bool>(), true);
+    ASSERT_EQ(TypedParam("c", "x").as<char>(), 'x');
+
+    // A string_view converts as is, without a std::string in between
+    const std::string_view path = "/users/1234/posts";
+    ASSERT_EQ(details::LexicalCast<int>::cast(path.substr(7, 4)), 1234);
+    ASSERT_EQ(TypedParam("id", "1234").value(), "1234");
+}
@@ -0,0 +1,179 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+#include <pistache/sse.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_client.h"
+
+using namespace Pistache;
+
+namespace
+{
+    class SubscribeHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(SubscribeHandler)
+
+        explicit SubscribeHandler(std::shared_ptr<Http::Sse::Channel> channel)
+            : channel_(std::move(channel))
+        { }
+
+        void onRequest(const Http::Request&, Http::ResponseWriter response) override
+        {
+            channel_->subscribe(std::move(response));
+        }
+
+    private:
+        std::shared_ptr<Http::Sse::Channel> channel_;
+    };
+
+    bool waitFor(const std::function<bool()>& condition)
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            if (condition())
+                return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return condition();
+    }
+
+    // Reads until the response contains the text
+    std::string receiveUntil(TcpClient& client, const std::string& text)
+    {
+        std::string response;
+        char buffer[1024];
+        while (response.find(text) == std::string::npos)
+        {
+            size_t bytes = 0;
+            if (!client.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                break;
+            response.append(buffer, bytes);
+        }
+        return response;
+    }
+
+    struct SseServer
+    {
+        explicit SseServer(std::shared_ptr<Http::Sse::Channel> channel)
+            : endpoint(Address(IP::loopback(), Port(0)))
+        {
+            endpoint.init(Http::Endpoint::options().threads(2).flags(Tcp::Options::ReuseAddr));
+            endpoint.setHandler(Http::make_handler<SubscribeHandler>(std::move(channel)));
+            endpoint.serveThreaded();
+        }
+
+        ~SseServer() { endpoint.shutdown(); }
+
+        std::unique_ptr<TcpClient> subscribe()
+        {
+            auto client = std::make_unique<TcpClient>();
+            if (!client->connect(Address(IP::loopback(), endpoint.getPort()))
+                || !client->send("GET /events HTTP/1.1\r\nHost: localhost\r\n\r\n"))
+                return nullptr;
+            return client;
+        }
+
+        Http::Endpoint endpoint;
+    };
+} // namespace
+
+TEST(sse_test, event_serialization)
+{
+    Http::Sse::Event event("first\nsecond");
+    event.event = "update";
+    event.id    = "42";
+    event.retry = std::chrono::milliseconds(1500);
+
+    EXPECT_EQ(event.serialize(),
+              "event: update\nid: 42\nretry: 1500\ndata: first\ndata: second\n\n");
+    EXPECT_EQ(Http::Sse::Event("").serialize(), "data: \n\n");
+}
+
+TEST(sse_test, publish_reaches_every_subscriber)
+{
+    auto channel = Http::Sse::Channel::create(std::chrono::milliseconds(0));
+    SseServer server(channel);
+
+    constexpr size_t Subscribers = 6;
+    std::vector<std::unique_ptr<TcpClient>> clients;
+    for (size_t i = 0; i < Subscribers; ++i)
+    {
+        auto client = server.subscribe();
+        ASSERT_NE(client, nullptr);
+        clients.push_back(std::move(client));
+    }
+    ASSERT_TRUE(waitFor([&] { return channel->subscribers() == Subscribers; }));
+
+    for (auto& client : clients)
+    {
+        const auto head = receiveUntil(*client, "\r\n\r\n");
+        EXPECT_NE(head.find("Content-Type: text/event-stream"), std::string::npos) << head;
+        EXPECT_NE(head.find("Transfer-Encoding: chunked"), std::string::npos) << head;
+    }
+
+    Http::Sse::Event event("hello");
+    event.event = "greeting";
+    channel->publish(event);
+
+    for (auto& client : clients)
+    {
+        const auto body = receiveUntil(*client, "data: hello\n\n");
+        EXPECT_NE(body.find("event: greeting\ndata: hello\n\n"), std::string::npos) << body;
+    }
+
+    channel->close();
+    for (auto& client : clients)
+        EXPECT_NE(receiveUntil(*client, "0\r\n\r\n").find("0\r\n\r\n"), std::string::npos);
+    EXPECT_TRUE(waitFor([&] { return channel->subscribers() == 0; }));
+}
+
+TEST(sse_test, heartbeat_keeps_idle_streams_alive)
+{
+    auto channel = Http::Sse::Channel::create(std::chrono::milliseconds(50));
+    SseServer server(channel);
+
+    auto client = server.subscribe();
+    ASSERT_NE(client, nullptr);
+    ASSERT_TRUE(waitFor([&] { return channel->subscribers() == 1; }));
+
+    const auto response = receiveUntil(*client, ":\n\n");
+    EXPECT_NE(response.find("3\r\n:\n\n\r\n"), std::string::npos) << response;
+}
+
+TEST(sse_test, closed_connections_leave_the_channel)
+{
+    auto channel = Http::Sse::Channel::create(std::chrono::milliseconds(0));
+    SseServer server(channel);
+
+    auto staying = server.subscribe();
+    auto leaving = server.subscribe();
+    ASSERT_NE(staying, nullptr);
+    ASSERT_NE(leaving, nullptr);
+    ASSERT_TRUE(waitFor([&] { return channel->subscribers() == 2; }));
+
+    leaving->close();
+    // The stream of the closed connection is dropped by the next event
+    ASSERT_TRUE(waitFor([&] {
+        channel->publish(Http::Sse::Event("ping"));
+        return channel->subscribers() == 1;
+    }));
+
+    channel->publish(Http::Sse::Event("still here"));
+    const auto body = receiveUntil(*staying, "data: still here\n\n");
+    EXPECT_NE(body.find("data: still here\n\n"), std::string::npos);
+}
@@ -4,10 +4,13 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <pistache/buffer_pool.h>
+#include <pistache/scan.h>
 #include <pistache/stream.h>
 
 #include <gtest/gtest.h>
 
+#include <cctype>
 #include <climits>
 #include <cstdio>
 #include <cstdlib>
@@ -15,6 +18,9 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using namespace Pistache;
 
@@ -41,6 +47,25 @@ TEST(stream, test_buffer)
     ASSERT_EQ(buffer5.data(), "string");
 }
 
+TEST(stream, test_shared_buffer)
+{
+    SharedBuffer empty;
+    ASSERT_TRUE(empty.empty());
+    ASSERT_EQ(empty.size(), 0u);
+
+    SharedBuffer buffer(std::string("data: event\n\n"));
+    ASSERT_EQ(buffer.size(), 13u);
+    ASSERT_EQ(buffer.useCount(), 1);
+
+    {
+        SharedBuffer copy = buffer;
+        ASSERT_EQ(copy.data(), buffer.data());
+        ASSERT_EQ(buffer.useCount(), 2);
+    }
+    ASSERT_EQ(buffer.useCount(), 1);
+    ASSERT_EQ(std::string(buffer.data(), buffer.size()), "data: event\n\n");
+}
+
 TEST(stream, test_file_buffer)
 {
     char fileName[PATH_MAX] = "/tmp/pistacheioXXXXXX";
@@ -85,6 +110,81 @@ TEST(stream, test_dyn_buffer)
     ASSERT_EQ(strlen(rawbuf.data().c_str()), 128u);
 }
 
+TEST(stream, test_dynamic_buffer_detaches_its_block)
+{
+    DynamicStreamBuf buf(16, 1024);
+    std::ostream os(&buf);
+
+    os << "hello";
+    auto block = buf.detach();
+    ASSERT_EQ(std::string(block.data(), block.size()), "hello");
+    ASSERT_EQ(buf.buffer().size(), 0u);
+
+    // The next writes take another block, never past the maximum
+    os << std::string(2000, 'a');
+    ASSERT_EQ(buf.buffer().size(), 1024u);
+    ASSERT_EQ(std::string(block.data(), block.size()), "hello");
+}
+
+TEST(stream, test_dynamic_buffer_takes_a_block_once_written)
+{
+    const auto before = BufferPool::allocated();
+    std::vector<DynamicStreamBuf> bufs;
+    for (int i = 0; i < 100; ++i)
+        bufs.emplace_back(512, Const::MaxBuffer);
+    ASSERT_EQ(BufferPool::allocated(), before);
+    ASSERT_EQ(bufs.front().buffer().size(), 0u);
+
+    std::ostream os(&bufs.front());
+    os << "hello";
+    ASSERT_EQ(bufs.front().buffer().size(), 5u);
+    ASSERT_EQ(bufs.front().detach().capacity(), 512u);
+}
+
+TEST(stream, test_buffer_pool_recycles_blocks)
+{
+    {
+        PooledBuffer warm(1000);
+    }
+    const auto allocated = BufferPool::allocated();
+    for (int i = 0; i < 100; ++i)
+    {
+        PooledBuffer buffer(1000);
+        ASSERT_EQ(buffer.capacity(), 1024u);
+        std::memset(buffer.data(), 'a', buffer.capacity());
+    }
+    ASSERT_EQ(BufferPool::allocated(), allocated);
+
+    // Grown, the bytes in use come along
+    PooledBuffer buffer(10);
+    std::memcpy(buffer.data(), "abc", 3);
+    buffer.resize(3);
+    buffer.reserve(5000);
+    ASSERT_EQ(buffer.capacity(), 8192u);
+    ASSERT_EQ(std::string(buffer.data(), buffer.size()), "abc");
+
+    // Past the largest class, straight from the allocator
+    PooledBuffer large(BufferPool::MaxBlock + 1);
+    ASSERT_EQ(large.capacity(), BufferPool::MaxBlock + 1);
+}
+
+TEST(stream, test_buffer_pool_carves_huge_pages)
+{
+    BufferPool::setHugePages(true);
+    std::thread([] {
+        PooledBuffer buffer(64 * 1024);
+        ASSERT_EQ(buffer.capacity(), 64u * 1024);
+        std::memset(buffer.data(), 'a', buffer.capacity());
+    }).join();
+    BufferPool::setHugePages(false);
+
+    // Left by the thread, the blocks carved from the page are reused
+    const auto allocated = BufferPool::allocated();
+    PooledBuffer buffer(64 * 1024);
+    std::memset(buffer.data(), 'b', buffer.capacity());
+    ASSERT_EQ(BufferPool::allocated(), allocated);
+}
+
 TEST(stream, test_array_buffer)
 {
     ArrayStreamBuf<char> buffer(4);
@@ -96,6 +196,36 @@ TEST(stream, test_array_buffer)
     ASSERT_FALSE(buffer.feed(part2, strlen(part2)));
 }
 
+TEST(stream, test_array_buffer_keeps_its_storage)
+{
+    ArrayStreamBuf<char> buffer(Const::MaxBuffer * 2);
+    ASSERT_EQ(buffer.capacity(), 0u);
+
+    const std::string request(100, 'a');
+    ASSERT_TRUE(buffer.feed(request.data(), request.size()));
+    const auto capacity = buffer.capacity();
+    ASSERT_GE(capacity, Const::MaxBuffer);
+
+    buffer.reset();
+    ASSERT_EQ(buffer.capacity(), capacity);
+
+    // The leftover of a pipelined request moves to the front in place
+    StreamCursor cursor { &buffer };
+    const char* data = "abcdefgh";
+    ASSERT_TRUE(buffer.feed(data, strlen(data)));
+    cursor.advance(4);
+    buffer.discardConsumed();
+    ASSERT_EQ(buffer.capacity(), capacity);
+    ASSERT_EQ(cursor.current(), 'e');
+    ASSERT_EQ(cursor.remaining(), 4u);
+
+    // Never grows past the maximum
+    const std::string large(Const::MaxBuffer * 2 - 4, 'b');
+    ASSERT_TRUE(buffer.feed(large.data(), large.size()));
+    ASSERT_EQ(buffer.capacity(), Const::MaxBuffer * 2);
+    ASSERT_FALSE(buffer.feed("c", 1));
+}
+
 TEST(stream, test_cursor_advance_for_array)
 {
     ArrayStreamBuf<char> buffer(Const::MaxBuffer);
@@ -199,3 +329,203 @@ TEST(stream, test_cursor_diff_for_array)
     second_cursor.advance(4);
     ASSERT_EQ(second_cursor.diff(first_cursor), 0u);
 }
+
+TEST(stream, test_scan_backends_agree_with_scalar)
+{
+    const Scan::Backend backends[] = { Scan::Backend::Sse42, Scan::Backend::Avx2,
+                                       Scan::Backend::Neon };
+    const char* sets[] = { ":", " ?", "=& ", "\r\n:;" };
+
+    // Put the hit at every offset of the vector blocks, the tail included
+    for (size_t len = 1; len < 100; ++len)
+    {
+        for (size_t hit = 0; hit <= len; ++hit)
+        {
+            std::string data(len, 'a');
+            for (const auto* set : sets)
+            {
+                const size_t count = strlen(set);
+                if (hit < len)
+                    data[hit] = set[count - 1];
+
+                const char* begin    = data.data();
+                const char* end      = begin + data.size();
+                const char* expected = Scan::findFirstOf(Scan::Backend::Scalar, begin, end, set, count);
+                ASSERT_EQ(expected - begin, static_cast<std::ptrdiff_t>(hit));
+                ASSERT_EQ(Scan::findFirstOf(begin, end, set, count), expected);
+
+                for (auto backend : backends)
+                {
+                    if (!Scan::isSupported(backend))
+                        continue;
+                    ASSERT_EQ(Scan::findFirstOf(backend, begin, end, set, count), expected);
+                }
+
+                data.assign(len, 'a');
+            }
+        }
+    }
+}
+
+TEST(stream, test_mask_backends_agree_with_bytewise_xor)
+{
+    const Scan::Backend backends[] = { Scan::Backend::Scalar, Scan::Backend::Sse42,
+                                       Scan::Backend::Avx2, Scan::Backend::Neon };
+    const uint8_t key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+    for (size_t len = 0; len < 100; ++len)
+    {
+        std::string plain(len, '\0');
+        for (size_t i = 0; i < len; ++i)
+            plain[i] = static_cast<char>('a' + i % 26);
+
+        for (size_t phase = 0; phase < 4; ++phase)
+        {
+            std::string expected = plain;
+            for (size_t i = 0; i < len; ++i)
+                expected[i] = static_cast<char>(expected[i] ^ key[(phase + i) & 3]);
+
+            std::string data = plain;
+            ASSERT_EQ(Scan::applyMask(data.data(), data.size(), key, phase), (phase + len) & 3);
+            ASSERT_EQ(data, expected);
+
+            for (auto backend : backends)
+            {
+                if (!Scan::isSupported(backend))
+                    continue;
+                data = plain;
+                Scan::applyMask(backend, data.data(), data.size(), key, phase);
+                ASSERT_EQ(data, expected);
+            }
+        }
+    }
+
+    // A payload unmasked in two parts
+    std::string data(37, 'x');
+    const std::string original = data;
+    const size_t phase = Scan::applyMask(data.data(), 13, key);
+    Scan::applyMask(data.data() + 13, data.size() - 13, key, phase);
+    Scan::applyMask(data.data(), data.size(), key);
+    ASSERT_EQ(data, original);
+}
+
+TEST(stream, test_base64_backends_agree_with_rfc_4648)
+{
+    const Scan::Backend backends[] = { Scan::Backend::Scalar, Scan::Backend::Sse42,
+                                       Scan::Backend::Avx2, Scan::Backend::Neon };
+
+    // RFC 4648 section 10
+    const std::pair<std::string, std::string> vectors[] = {
+        { "", "" }, { "f", "Zg==" }, { "fo", "Zm8=" }, { "foo", "Zm9v" },
+        { "foob", "Zm9vYg==" }, { "fooba", "Zm9vYmE=" }, { "foobar", "Zm9vYmFy" }
+    };
+    for (const auto& [plain, encoded] : vectors)
+    {
+        std::string out(encoded.size(), '\0');
+        ASSERT_EQ(Scan::base64Encode(reinterpret_cast<const uint8_t*>(plain.data()), plain.size(),
+                                     out.data()),
+                  encoded.size());
+        ASSERT_EQ(out, encoded);
+
+        std::string decoded(plain.size() + 2, '\0');
+        ASSERT_EQ(Scan::base64Decode(encoded.data(), encoded.size(),
+                                     reinterpret_cast<uint8_t*>(decoded.data())),
+                  plain.size());
+        ASSERT_EQ(decoded.substr(0, plain.size()), plain);
+    }
+
+    // Long enough for every kernel to go through whole blocks, and every byte
+    for (size_t len = 0; len < 300; len += 7)
+    {
+        std::vector<uint8_t> plain(len);
+        for (size_t i = 0; i < len; ++i)
+            plain[i] = static_cast<uint8_t>(i * 37 + len);
+
+        std::string expected((len + 2) / 3 * 4, '\0');
+        Scan::base64Encode(Scan::Backend::Scalar, plain.data(), len, expected.data());
+
+        for (auto backend : backends)
+        {
+            if (!Scan::isSupported(backend))
+                continue;
+
+            std::string encoded(expected.size(), '\0');
+            ASSERT_EQ(Scan::base64Encode(backend, plain.data(), len, encoded.data()), encoded.size());
+            ASSERT_EQ(encoded, expected);
+
+            std::vector<uint8_t> decoded(len + 2);
+            ASSERT_EQ(Scan::base64Decode(backend, encoded.data(), encoded.size(), decoded.data()), len);
+            decoded.resize(len);
+            ASSERT_EQ(decoded, plain);
+
+            // Without the padding
+            const auto unpadded = encoded.substr(0, encoded.find('='));
+            ASSERT_EQ(Scan::base64Decode(backend, unpadded.data(), unpadded.size(), decoded.data()),
+                      len);
+        }
+    }
+
+    // Any character outside of the alphabet, anywhere in a block
+    const std::string valid(128, 'Q');
+    std::vector<uint8_t> out(96);
+    for (int c = 0; c < 256; ++c)
+    {
+        const bool inAlphabet = std::isalnum(c) || c == '+' || c == '/';
+        for (size_t pos : { size_t(0), size_t(13), size_t(31), size_t(32), size_t(63), size_t(100) })
+        {
+            auto encoded = valid;
+            encoded[pos] = static_cast<char>(c);
+            for (auto backend : backends)
+            {
+                if (!Scan::isSupported(backend))
+                    continue;
+                const auto size = Scan::base64Decode(backend, encoded.data(), encoded.size(), out.data());
+                ASSERT_EQ(size != Scan::Base64Invalid, inAlphabet)
+                    << "character " << c << " at " << pos;
+            }
+        }
+    }
+
+    for (const std::string invalid : { "Z", "Zg=", "Z===", "Zg==Zg==", "=Zg=", "Zm9vY" })
+        ASSERT_EQ(Scan::base64Decode(invalid.data(), invalid.size(), out.data()), Scan::Base64Invalid)
+            << invalid;
+}
+
+TEST(stream, test_match_until_eol)
+{
+    ArrayStreamBuf<char> buffer(Const::MaxBuffer);
+    StreamCursor cursor { &buffer };
+
+    const std::string data = std::string(40, 'x') + "\r" + std::string(40, 'y') + "\r\nz\r";
+    ASSERT_TRUE(buffer.feed(data.data(), data.size()));
+
+    // A lone CR is not an end of line
+    ASSERT_TRUE(match_until_eol(cursor));
+    ASSERT_EQ(static_cast<size_t>(cursor), 81u);
+    ASSERT_TRUE(cursor.eol());
+
+    cursor.advance(2);
+    ASSERT_FALSE(match_until_eol(cursor));
+    ASSERT_TRUE(cursor.eof());
+}
+
+TEST(stream, test_match_until_delimiters)
+{
+    ArrayStreamBuf<char> buffer(Const::MaxBuffer);
+    StreamCursor cursor { &buffer };
+
+    const std::string data = std::string(70, 'k') + "=value&other";
+    ASSERT_TRUE(buffer.feed(data.data(), data.size()));
+
+    ASSERT_TRUE(match_until({ ' ', '&', '=' }, cursor));
+    ASSERT_EQ(cursor.current(), '=');
+    ASSERT_EQ(static_cast<size_t>(cursor), 70u);
+
+    cursor.advance(1);
+    ASSERT_TRUE(match_until({ ' ', '&' }, cursor));
+    ASSERT_EQ(cursor.current(), '&');
+
+    cursor.advance(1);
+    ASSERT_FALSE(match_until({ ' ', '&' }, cursor));
+    ASSERT_TRUE(cursor.eof());
+}
@@ -14,13 +14,23 @@
 #include <curl/curl.h>
 #include <curl/easy.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <future>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "tcp_client.h"
+
 using namespace Pistache;
 
 static constexpr size_t N_LETTERS      = 26;
@@ -266,6 +276,124 @@ TEST_F(StreamingTests, ChunkedStream)
     EXPECT_EQ(chunks[2], "!");
 }
 
+class BufferChunksHandler : public Http::Handler
+{
+public:
+    HTTP_PROTOTYPE(BufferChunksHandler)
+
+    explicit BufferChunksHandler(std::string path)
+        : path_(std::move(path))
+    { }
+
+    void onRequest(const Http::Request&, Http::ResponseWriter response) override
+    {
+        auto stream = response.stream(Http::Code::Ok);
+
+        stream << "head ";
+        std::string payload(64 * 1024, 'x');
+        stream.write(RawBuffer(std::move(payload), 64 * 1024));
+
+        auto file = FileBuffer::own(::open(path_.c_str(), O_RDONLY));
+        stream.write(FileBuffer(file, 5, 6));
+        stream.write(RawBuffer(std::string(), 0));
+
+        stream << " tail";
+        stream.ends();
+    }
+
+private:
+    std::string path_;
+};
+
+TEST_F(StreamingTests, BufferAndFileChunks)
+{
+    char path[] = "/tmp/pistache_chunks_XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_NE(fd, -1);
+    ::close(fd);
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << "hello world!";
+    }
+
+    Init(std::make_shared<BufferChunksHandler>(path));
+
+    const CURLcode res = curl_easy_perform(curl);
+    std::remove(path);
+    ASSERT_EQ(res, CURLE_OK);
+
+    EXPECT_EQ(chunksToString(chunks), "head " + std::string(64 * 1024, 'x') + "world tail");
+}
+
+class SubscribeHandler : public Http::Handler
+{
+public:
+    HTTP_PROTOTYPE(SubscribeHandler)
+
+    explicit SubscribeHandler(std::shared_ptr<Http::StreamGroup> group)
+        : group_(std::move(group))
+    { }
+
+    void onRequest(const Http::Request&, Http::ResponseWriter response) override
+    {
+        group_->add(response.stream(Http::Code::Ok));
+    }
+
+private:
+    std::shared_ptr<Http::StreamGroup> group_;
+};
+
+TEST(StreamingTest, broadcast_shares_the_payload)
+{
+    auto group = std::make_shared<Http::StreamGroup>();
+
+    Http::Endpoint endpoint(Address(IP::loopback(), Port(0)));
+    endpoint.init(Http::Endpoint::options().threads(2).flags(Tcp::Options::ReuseAddr));
+    endpoint.setHandler(Http::make_handler<SubscribeHandler>(group));
+    endpoint.serveThreaded();
+
+    constexpr size_t Subscribers = 4;
+    std::vector<std::unique_ptr<TcpClient>> clients;
+    for (size_t i = 0; i < Subscribers; ++i)
+    {
+        auto client = std::make_unique<TcpClient>();
+        ASSERT_TRUE(client->connect(Address(IP::loopback(), endpoint.getPort()))) << client->lastError();
+        ASSERT_TRUE(client->send("GET /events HTTP/1.1\r\nHost: localhost\r\n\r\n")) << client->lastError();
+        clients.push_back(std::move(client));
+    }
+
+    for (int i = 0; i < 100 && group->size() < Subscribers; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(group->size(), Subscribers);
+
+    const SharedBuffer event(std::string("data: hello\n\n"));
+    EXPECT_EQ(group->broadcast(event), Subscribers);
+    group->close();
+    EXPECT_EQ(group->size(), 0u);
+
+    for (auto& client : clients)
+    {
+        std::string response;
+        char buffer[1024];
+        while (response.size() < 5 || response.compare(response.size() - 5, 5, "0\r\n\r\n") != 0)
+        {
+            size_t bytes = 0;
+            ASSERT_TRUE(client->receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)))
+                << client->lastError();
+            ASSERT_GT(bytes, 0u);
+            response.append(buffer, bytes);
+        }
+        EXPECT_NE(response.find("d\r\ndata: hello\n\n\r\n"), std::string::npos) << response;
+    }
+
+    // Released by the writes once they are done
+    for (int i = 0; i < 100 && event.useCount() > 1; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(event.useCount(), 1);
+
+    endpoint.shutdown();
+}
+
 class ClientDisconnectHandler : public Http::Handler {
 public:
     HTTP_PROTOTYPE(ClientDisconnectHandler)
@@ -327,3 +455,181 @@ TEST(StreamingTest, ClientDisconnect)
 
     // Don't care about response content, this test will fail if SIGPIPE is raised
 }
+
+namespace
+{
+    constexpr size_t BackpressureHigh  = 256 * 1024;
+    constexpr size_t BackpressureLow   = 64 * 1024;
+    constexpr size_t BackpressureChunk = 64 * 1024;
+    constexpr size_t BackpressureTotal = 32 * 1024 * 1024;
+
+    struct BackpressureStats
+    {
+        std::atomic<size_t> maxQueued { 0 };
+        std::atomic<size_t> pauses { 0 };
+        std::promise<void> done;
+    };
+} // namespace
+
+class BackpressureHandler : public Http::Handler
+{
+public:
+    HTTP_PROTOTYPE(BackpressureHandler)
+
+    explicit BackpressureHandler(std::shared_ptr<BackpressureStats> stats)
+        : stats_(std::move(stats))
+    { }
+
+    void onRequest(const Http::Request&, Http::ResponseWriter response) override
+    {
+        auto stream = std::make_shared<Http::ResponseStream>(response.stream(Http::Code::Ok));
+
+        // The writes are done by the thread of the transport, the producer
+        // must not block it
+        std::thread([stream, stats = stats_]() {
+            const std::string chunk(BackpressureChunk, 'a');
+            for (size_t sent = 0; sent < BackpressureTotal; sent += chunk.size())
+            {
+                if (!stream->writable())
+                {
+                    ++stats->pauses;
+                    std::promise<void> writable;
+                    auto ready = writable.get_future();
+                    stream->whenWritable().then(
+                        [&writable]() { writable.set_value(); },
+                        [&writable](std::exception_ptr exc) { writable.set_exception(exc); });
+                    ready.get();
+                }
+
+                stream->write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+                stream->flush();
+
+                size_t queued = stream->queuedBytes();
+                size_t max    = stats->maxQueued.load();
+                while (queued > max && !stats->maxQueued.compare_exchange_weak(max, queued))
+                { }
+            }
+            stream->ends();
+            stats->done.set_value();
+        }).detach();
+    }
+
+private:
+    std::shared_ptr<BackpressureStats> stats_;
+};
+
+TEST(StreamingTest, stream_waits_for_slow_client)
+{
+    auto stats = std::make_shared<BackpressureStats>();
+    auto done  = stats->done.get_future();
+
+    Http::Endpoint endpoint(Address(IP::loopback(), Port(0)));
+    endpoint.init(Http::Endpoint::options()
+                      .flags(Tcp::Options::ReuseAddr)
+                      .streamWatermarks(BackpressureHigh, BackpressureLow));
+    endpoint.setHandler(Http::make_handler<BackpressureHandler>(stats));
+    endpoint.serveThreaded();
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(Address(IP::loopback(), endpoint.getPort()))) << client.lastError();
+    ASSERT_TRUE(client.send("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n")) << client.lastError();
+
+    // Not reading, the socket fills up and the producer has to wait
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    std::string response;
+    std::vector<char> buffer(64 * 1024);
+    while (response.size() < 5 || response.compare(response.size() - 5, 5, "0\r\n\r\n") != 0)
+    {
+        size_t bytes = 0;
+        ASSERT_TRUE(client.receive(buffer.data(), buffer.size(), &bytes, std::chrono::seconds(10)))
+            << client.lastError();
+        ASSERT_GT(bytes, 0u);
+        response.append(buffer.data(), bytes);
+    }
+
+    ASSERT_EQ(done.wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    endpoint.shutdown();
+
+    const auto body = response.find("\r\n\r\n");
+    ASSERT_NE(body, std::string::npos);
+    EXPECT_EQ(static_cast<size_t>(std::count(response.begin() + static_cast<std::ptrdiff_t>(body),
+                                             response.end(), 'a')),
+              BackpressureTotal);
+
+    EXPECT_GT(stats->pauses.load(), 0u);
+    // Flushed once more at most past the high watermark, before noticing it
+    EXPECT_LE(stats->maxQueued.load(), BackpressureHigh + BackpressureChunk + 64);
+}
+
+namespace
+{
+    // Puts the document one character at a time, as a rapidjson::Writer does
+    template <typename Output>
+    void writeJson(Output& output, const std::string& json)
+    {
+        for (char c : json)
+            output.Put(c);
+        output.Flush();
+    }
+} // namespace
+
+class JsonHandler : public Http::Handler
+{
+public:
+    HTTP_PROTOTYPE(JsonHandler)
+
+    void onRequest(const Http::Request& request, Http::ResponseWriter response) override
+    {
+        if (request.resource() == "/small")
+        {
+            response.sendJson(Http::Code::Ok,
+                              [](Http::JsonOutput& output) { writeJson(output, R"({"a":1})"); });
+            return;
+        }
+
+        auto stream = response.stream(Http::Code::Ok);
+        Http::JsonStreamOutput output(stream, 16);
+        writeJson(output, R"([0,1,2,3,4,5,6,7,8,9,10,11,12])");
+        stream.ends();
+    }
+};
+
+TEST(StreamingTest, json_written_into_the_response)
+{
+    Http::Endpoint endpoint(Address(IP::loopback(), Port(0)));
+    endpoint.init(Http::Endpoint::options().flags(Tcp::Options::ReuseAddr));
+    endpoint.setHandler(Http::make_handler<JsonHandler>());
+    endpoint.serveThreaded();
+
+    const auto get = [&](const std::string& resource, const std::string& end) {
+        TcpClient client;
+        EXPECT_TRUE(client.connect(Address(IP::loopback(), endpoint.getPort())));
+        EXPECT_TRUE(client.send("GET " + resource + " HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+
+        std::string response;
+        char buffer[1024];
+        while (response.size() < end.size()
+               || response.compare(response.size() - end.size(), end.size(), end) != 0)
+        {
+            size_t bytes = 0;
+            if (!client.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                break;
+            response.append(buffer, bytes);
+        }
+        return response;
+    };
+
+    const auto small = get("/small", R"({"a":1})");
+    EXPECT_NE(small.find("Content-Type: application/json"), std::string::npos) << small;
+    EXPECT_NE(small.find("Content-Length: 7\r\n"), std::string::npos) << small;
+
+    // Chunks of 16 bytes, and what is left once the document is complete
+    const auto large = get("/large", "0\r\n\r\n");
+    EXPECT_NE(large.find("\r\n\r\n10\r\n[0,1,2,3,4,5,6,7\r\n"
+                         "e\r\n,8,9,10,11,12]\r\n0\r\n\r\n"),
+              std::string::npos)
+        << large;
+
+    endpoint.shutdown();
+}
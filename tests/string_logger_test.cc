@@ -4,9 +4,13 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <sstream>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include <pistache/log.h>
 #include <pistache/string_logger.h>
 
 #include <gtest/gtest.h>
@@ -36,3 +40,74 @@ TEST(logger_test, logger_guards_by_level)
 
     ASSERT_EQ(ss.str(), expected_string);
 }
+
+TEST(logger_test, async_logger_writes_the_messages_of_every_thread)
+{
+    std::stringstream ss;
+    ::Pistache::Log::AsyncStringLogger logger(::Pistache::Log::Level::INFO, &ss);
+
+    logger.log(::Pistache::Log::Level::DEBUG, "ignored");
+
+    constexpr int Threads  = 4;
+    constexpr int Messages = 500;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < Threads; ++t)
+    {
+        threads.emplace_back([&logger, t] {
+            for (int i = 0; i < Messages; ++i)
+                logger.log(::Pistache::Log::Level::INFO, std::to_string(t) + " " + std::to_string(i));
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    logger.flush();
+
+    // In order for each thread, unless dropped
+    std::vector<int> last(Threads, -1);
+    size_t lines = 0;
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        const auto space = line.find(' ');
+        ASSERT_NE(space, std::string::npos) << line;
+        const int t = std::stoi(line.substr(0, space));
+        const int i = std::stoi(line.substr(space + 1));
+        EXPECT_GT(i, last[t]) << line;
+        last[t] = i;
+        ++lines;
+    }
+    EXPECT_EQ(lines + logger.dropped(), static_cast<size_t>(Threads * Messages));
+}
+
+TEST(logger_test, async_logger_drops_what_does_not_fit)
+{
+    std::stringstream ss;
+    {
+        ::Pistache::Log::AsyncStringLogger logger(::Pistache::Log::Level::INFO, &ss, 64);
+
+        logger.log(::Pistache::Log::Level::WARN, std::string(100, 'x'));
+        logger.log(::Pistache::Log::Level::WARN, "kept");
+        EXPECT_EQ(logger.dropped(), 1u);
+    }
+
+    // Written on destruction at the latest
+    EXPECT_EQ(ss.str(), "kept\n");
+}
+
+TEST(logger_test, message_builder_formats_like_a_stream)
+{
+    ::Pistache::Log::MessageBuilder builder;
+    builder << "a" << std::string("b") << std::string_view("c") << ' ' << -42 << ' '
+            << 7u << ' ' << true << ' ' << 1.5;
+    EXPECT_EQ(builder.str(), "abc -42 7 1 1.5");
+
+    // From a manipulator on, the stream formats the rest
+    ::Pistache::Log::MessageBuilder hex;
+    hex << "x" << 10 << std::hex << ' ' << 255;
+    EXPECT_EQ(hex.str(), "x10 ff");
+
+    std::stringstream ss;
+    auto logger = std::make_shared<::Pistache::Log::StringToStreamLogger>(::Pistache::Log::Level::INFO, &ss);
+    PISTACHE_LOG_STRING_INFO(logger, "code " << 404 << " for " << std::string("/path"));
+    EXPECT_EQ(ss.str(), "code 404 for /path\n");
+}
@@ -68,6 +68,13 @@ namespace Pistache
             return true;
         }
 
+        void close()
+        {
+            if (fd_ != -1)
+                ::close(fd_);
+            fd_ = -1;
+        }
+
         bool send(const std::string& data)
         {
             return send(data.c_str(), data.size());
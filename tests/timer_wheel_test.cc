@@ -0,0 +1,115 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+#include <pistache/timer_wheel.h>
+
+#include <chrono>
+#include <vector>
+
+using namespace Pistache;
+using namespace std::chrono_literals;
+
+namespace
+{
+    const auto Origin = TimerWheel::Clock::time_point(std::chrono::hours(1));
+}
+
+TEST(timer_wheel_test, fires_at_deadline_and_not_before)
+{
+    TimerWheel wheel(10ms, 8, Origin);
+
+    int fired = 0;
+    wheel.schedule(25ms, [&] { ++fired; }, Origin);
+
+    ASSERT_EQ(wheel.advance(Origin + 24ms), 0u);
+    ASSERT_EQ(fired, 0);
+
+    // The deadline is rounded up to the next tick
+    ASSERT_EQ(wheel.advance(Origin + 29ms), 0u);
+    ASSERT_EQ(wheel.advance(Origin + 30ms), 1u);
+    ASSERT_EQ(fired, 1);
+    ASSERT_TRUE(wheel.empty());
+}
+
+TEST(timer_wheel_test, timers_of_later_rotations_wait_for_their_turn)
+{
+    TimerWheel wheel(10ms, 4, Origin);
+
+    std::vector<int> order;
+    wheel.schedule(10ms, [&] { order.push_back(1); }, Origin);
+    // Lands in the same slot, one rotation later
+    wheel.schedule(50ms, [&] { order.push_back(2); }, Origin);
+
+    ASSERT_EQ(wheel.advance(Origin + 10ms), 1u);
+    ASSERT_EQ(wheel.size(), 1u);
+
+    ASSERT_EQ(wheel.advance(Origin + 40ms), 0u);
+    ASSERT_EQ(wheel.advance(Origin + 50ms), 1u);
+
+    ASSERT_EQ(order, (std::vector<int> { 1, 2 }));
+}
+
+TEST(timer_wheel_test, late_advance_fires_everything_due)
+{
+    TimerWheel wheel(10ms, 4, Origin);
+
+    int fired = 0;
+    for (int i = 1; i <= 10; ++i)
+        wheel.schedule(std::chrono::milliseconds(i * 15), [&] { ++fired; }, Origin);
+
+    // Several rotations at once
+    ASSERT_EQ(wheel.advance(Origin + 1s), 10u);
+    ASSERT_EQ(fired, 10);
+}
+
+TEST(timer_wheel_test, cancelled_timers_do_not_fire)
+{
+    TimerWheel wheel(10ms, 8, Origin);
+
+    int fired = 0;
+    auto id   = wheel.schedule(20ms, [&] { ++fired; }, Origin);
+    wheel.schedule(20ms, [&] { fired += 10; }, Origin);
+
+    ASSERT_TRUE(wheel.isScheduled(id));
+    ASSERT_TRUE(wheel.cancel(id));
+    ASSERT_FALSE(wheel.isScheduled(id));
+    ASSERT_FALSE(wheel.cancel(id));
+
+    wheel.advance(Origin + 20ms);
+    ASSERT_EQ(fired, 10);
+}
+
+TEST(timer_wheel_test, callbacks_can_reschedule)
+{
+    TimerWheel wheel(10ms, 8, Origin);
+
+    int fired = 0;
+    std::function<void()> periodic;
+    periodic = [&] {
+        ++fired;
+        wheel.schedule(10ms, periodic, Origin + std::chrono::milliseconds(fired * 10));
+    };
+    wheel.schedule(10ms, periodic, Origin);
+
+    for (int i = 1; i <= 5; ++i)
+        wheel.advance(Origin + std::chrono::milliseconds(i * 10));
+
+    ASSERT_EQ(fired, 5);
+    ASSERT_EQ(wheel.size(), 1u);
+}
+
+TEST(timer_wheel_test, next_timeout_points_to_the_first_busy_tick)
+{
+    TimerWheel wheel(10ms, 8, Origin);
+
+    ASSERT_FALSE(wheel.nextTimeout(Origin).has_value());
+
+    wheel.schedule(35ms, [] {}, Origin);
+    auto next = wheel.nextTimeout(Origin);
+    ASSERT_TRUE(next.has_value());
+    ASSERT_EQ(*next, 40ms);
+}
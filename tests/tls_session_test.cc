@@ -0,0 +1,85 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/tls_session.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Pistache;
+
+TEST(tls_session_test, sessions_are_found_by_id)
+{
+    Tcp::TlsSessionCache cache(16, 4);
+
+    cache.put("first", "session one", std::chrono::seconds(60));
+    cache.put("second", "session two", std::chrono::seconds(60));
+    ASSERT_EQ(cache.size(), 2U);
+
+    ASSERT_EQ(cache.get("first"), "session one");
+    ASSERT_EQ(cache.get("second"), "session two");
+    ASSERT_FALSE(cache.get("third").has_value());
+
+    cache.put("first", "renewed", std::chrono::seconds(60));
+    ASSERT_EQ(cache.get("first"), "renewed");
+    ASSERT_EQ(cache.size(), 2U);
+
+    cache.remove("first");
+    ASSERT_FALSE(cache.get("first").has_value());
+    ASSERT_EQ(cache.size(), 1U);
+}
+
+TEST(tls_session_test, expired_sessions_are_forgotten)
+{
+    Tcp::TlsSessionCache cache;
+
+    cache.put("gone", "session", std::chrono::seconds(0));
+    ASSERT_FALSE(cache.get("gone").has_value());
+    ASSERT_EQ(cache.size(), 0U);
+}
+
+TEST(tls_session_test, least_recently_used_sessions_are_evicted)
+{
+    // A single shard makes the order of the evictions predictable
+    Tcp::TlsSessionCache cache(2, 1);
+
+    cache.put("a", "1", std::chrono::seconds(60));
+    cache.put("b", "2", std::chrono::seconds(60));
+    ASSERT_TRUE(cache.get("a").has_value());
+
+    cache.put("c", "3", std::chrono::seconds(60));
+    ASSERT_EQ(cache.size(), 2U);
+    ASSERT_TRUE(cache.get("a").has_value());
+    ASSERT_FALSE(cache.get("b").has_value());
+    ASSERT_TRUE(cache.get("c").has_value());
+
+    ASSERT_THROW(Tcp::TlsSessionCache(0), std::invalid_argument);
+}
+
+TEST(tls_session_test, sessions_are_shared_between_threads)
+{
+    Tcp::TlsSessionCache cache(4096);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&cache, t] {
+            for (int i = 0; i < 256; ++i)
+            {
+                const auto id = std::to_string(t) + "-" + std::to_string(i);
+                cache.put(id, id, std::chrono::seconds(60));
+                ASSERT_EQ(cache.get(id), id);
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    ASSERT_EQ(cache.size(), 4U * 256U);
+}
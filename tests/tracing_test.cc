@@ -0,0 +1,205 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+#include <pistache/tracing.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_client.h"
+
+using namespace Pistache;
+
+namespace
+{
+    constexpr char TraceParent[] = "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01";
+
+    class CollectingTracer : public Tracing::Tracer
+    {
+    public:
+        void onTrace(Tracing::RequestTrace trace) override
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            traces_.push_back(std::move(trace));
+        }
+
+        std::vector<Tracing::RequestTrace> traces()
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            return traces_;
+        }
+
+    private:
+        std::mutex lock_;
+        std::vector<Tracing::RequestTrace> traces_;
+    };
+
+    class HelloHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(HelloHandler)
+
+        void onRequest(const Http::Request&, Http::ResponseWriter response) override
+        {
+            response.send(Http::Code::Ok, "hello");
+        }
+    };
+} // namespace
+
+TEST(tracing_test, takes_the_ids_of_a_traceparent)
+{
+    Tracing::RequestTrace trace;
+    ASSERT_TRUE(trace.setParent(TraceParent));
+    trace.generateIds();
+
+    auto json = Tracing::OtlpExporter::toJson({ trace }, "svc");
+    EXPECT_NE(json.find("\"traceId\":\"4bf92f3577b34da6a3ce929d0e0e4736\""), std::string::npos) << json;
+    EXPECT_NE(json.find("\"parentSpanId\":\"00f067aa0ba902b7\""), std::string::npos) << json;
+    EXPECT_EQ(json.find("\"spanId\":\"00f067aa0ba902b7\""), std::string::npos) << json;
+
+    Tracing::RequestTrace other;
+    EXPECT_FALSE(other.setParent("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7"));
+    EXPECT_FALSE(other.setParent("00-00000000000000000000000000000000-00f067aa0ba902b7-01"));
+    EXPECT_FALSE(other.setParent("ff-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01"));
+    EXPECT_FALSE(other.setParent("00-4BF92F3577B34DA6A3CE929D0E0E4736-00f067aa0ba902b7-01"));
+
+    // A random trace without a parent
+    other.generateIds();
+    json = Tracing::OtlpExporter::toJson({ other }, "svc");
+    EXPECT_EQ(json.find("parentSpanId"), std::string::npos) << json;
+    EXPECT_EQ(json.find("\"traceId\":\"00000000000000000000000000000000\""), std::string::npos) << json;
+}
+
+TEST(tracing_test, exports_batches_of_spans)
+{
+    std::mutex lock;
+    std::vector<std::string> payloads;
+    auto exporter = std::make_shared<Tracing::OtlpExporter>(
+        [&](const std::string& payload) {
+            std::lock_guard<std::mutex> guard(lock);
+            payloads.push_back(payload);
+        },
+        "tests", 2, std::chrono::seconds(60));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        Tracing::RequestTrace trace;
+        trace.resource = "/item/" + std::to_string(i);
+        trace.status   = i == 2 ? Http::Code::Internal_Server_Error : Http::Code::Ok;
+        trace.written  = true;
+
+        trace[Tracing::Phase::FirstByte]     = Tracing::now();
+        trace[Tracing::Phase::HeadersParsed] = Tracing::now();
+        trace[Tracing::Phase::Written]       = Tracing::now();
+        trace.generateIds();
+        exporter->onTrace(std::move(trace));
+    }
+    exporter->flush();
+
+    EXPECT_EQ(exporter->exported(), 3u);
+    EXPECT_EQ(exporter->dropped(), 0u);
+
+    std::lock_guard<std::mutex> guard(lock);
+    ASSERT_EQ(payloads.size(), 2u);
+
+    const auto& first = payloads[0];
+    EXPECT_EQ(first.find("{\"resourceSpans\":[{\"resource\":{\"attributes\":[{\"key\":\"service.name\","
+                         "\"value\":{\"stringValue\":\"tests\"}}]}"),
+              0u)
+        << first;
+    EXPECT_NE(first.find("\"url.path\",\"value\":{\"stringValue\":\"/item/1\"}"), std::string::npos) << first;
+    EXPECT_NE(first.find("\"kind\":2"), std::string::npos) << first;
+    EXPECT_NE(first.find("\"name\":\"first_byte\""), std::string::npos) << first;
+    EXPECT_NE(first.find("\"name\":\"headers_parsed\""), std::string::npos) << first;
+    EXPECT_EQ(first.find("\"name\":\"accept\""), std::string::npos) << first;
+    EXPECT_EQ(first.find("\"code\":2"), std::string::npos) << first;
+
+    // A server error
+    EXPECT_NE(payloads[1].find("\"intValue\":\"500\""), std::string::npos) << payloads[1];
+    EXPECT_NE(payloads[1].find("\"status\":{\"code\":2}"), std::string::npos) << payloads[1];
+}
+
+TEST(tracing_test, unix_times_follow_the_clock)
+{
+    const auto before = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count();
+    const auto nanos = static_cast<int64_t>(Tracing::toUnixNanos(Tracing::now()));
+    const auto after = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+
+    // Within a millisecond, the error of the calibration
+    EXPECT_GT(nanos, before - 1000000);
+    EXPECT_LT(nanos, after + 1000000);
+}
+
+#ifdef PISTACHE_USE_TRACING
+
+TEST(tracing_test, times_the_phases_of_a_request)
+{
+    auto tracer = std::make_shared<CollectingTracer>();
+
+    Http::Endpoint endpoint(Address(IP::loopback(), Port(0)));
+    endpoint.init(Http::Endpoint::options().threads(1).flags(Tcp::Options::ReuseAddr).tracer(tracer));
+    endpoint.setHandler(Http::make_handler<HelloHandler>());
+    endpoint.serveThreaded();
+
+    TcpClient client;
+    ASSERT_TRUE(client.connect(Address(IP::loopback(), endpoint.getPort())));
+    const std::string request = std::string("GET /hello HTTP/1.1\r\nHost: localhost\r\ntraceparent: ")
+        + TraceParent + "\r\n\r\n";
+    ASSERT_TRUE(client.send(request));
+    ASSERT_TRUE(client.send("GET /again HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+
+    // The trace is handed over once written, which may be after the client
+    // got the response
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (tracer->traces().size() < 2 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    endpoint.shutdown();
+
+    const auto traces = tracer->traces();
+    ASSERT_EQ(traces.size(), 2u);
+
+    const auto& first = traces[0];
+    EXPECT_EQ(first.resource, "/hello");
+    EXPECT_EQ(first.status, Http::Code::Ok);
+    EXPECT_TRUE(first.written);
+    for (size_t phase = 1; phase < Tracing::PhasesCount; ++phase)
+    {
+        EXPECT_NE(first.at[phase], 0u) << Tracing::phaseName(static_cast<Tracing::Phase>(phase));
+        EXPECT_LE(first.at[phase - 1], first.at[phase])
+            << Tracing::phaseName(static_cast<Tracing::Phase>(phase));
+    }
+
+    const auto json = Tracing::OtlpExporter::toJson(traces, "tests");
+    EXPECT_NE(json.find("\"traceId\":\"4bf92f3577b34da6a3ce929d0e0e4736\""), std::string::npos) << json;
+
+    // The accept belongs to the first request of the connection
+    EXPECT_EQ(traces[1].resource, "/again");
+    EXPECT_EQ(traces[1][Tracing::Phase::Accept], 0u);
+    EXPECT_NE(traces[1][Tracing::Phase::Dispatch], 0u);
+    EXPECT_NE(traces[1].traceId, first.traceId);
+}
+
+#else
+
+TEST(tracing_test, tracer_needs_tracing_support)
+{
+    auto handler = Http::make_handler<HelloHandler>();
+    EXPECT_THROW(handler->setTracer(std::make_shared<CollectingTracer>()), std::runtime_error);
+    EXPECT_NO_THROW(handler->setTracer(nullptr));
+}
+
+#endif /* PISTACHE_USE_TRACING */
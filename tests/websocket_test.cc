@@ -0,0 +1,358 @@
+/*
+ * SPDX-FileCopyrightText: 2026 The Pistache Authors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <pistache/endpoint.h>
+#include <pistache/http.h>
+#include <pistache/websocket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp_client.h"
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+#include <zlib.h>
+#endif
+
+using namespace Pistache;
+namespace WebSocket = Http::WebSocket;
+
+namespace
+{
+    // Echoes the messages, "broadcast" answers with the shared buffer
+    class EchoHandler : public WebSocket::Handler
+    {
+    public:
+        void onMessage(const std::shared_ptr<WebSocket::Connection>& connection, std::string data,
+                       WebSocket::Opcode opcode) override
+        {
+            if (data == "broadcast")
+                connection->send(shared, opcode);
+            else
+                connection->send(data, opcode);
+        }
+
+        void onClose(const std::shared_ptr<WebSocket::Connection>&, WebSocket::CloseCode code,
+                     const std::string&) override
+        {
+            closeCode = static_cast<int>(code);
+        }
+
+        SharedBuffer shared { std::string(1000, 'x') };
+        std::atomic<int> closeCode { 0 };
+    };
+
+    class UpgradeHandler : public Http::Handler
+    {
+    public:
+        HTTP_PROTOTYPE(UpgradeHandler)
+
+        explicit UpgradeHandler(std::shared_ptr<EchoHandler> handler)
+            : handler_(std::move(handler))
+        { }
+
+        void onRequest(const Http::Request& request, Http::ResponseWriter response) override
+        {
+            WebSocket::upgrade(request, std::move(response), handler_);
+        }
+
+    private:
+        std::shared_ptr<EchoHandler> handler_;
+    };
+
+    bool waitFor(const std::function<bool()>& condition)
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            if (condition())
+                return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return condition();
+    }
+
+    std::string maskedFrame(uint8_t first, const std::string& payload)
+    {
+        static constexpr uint8_t Key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+        std::string frame;
+        frame.push_back(static_cast<char>(first));
+        if (payload.size() < 126)
+        {
+            frame.push_back(static_cast<char>(0x80 | payload.size()));
+        }
+        else
+        {
+            frame.push_back(static_cast<char>(0x80 | 126));
+            frame.push_back(static_cast<char>(payload.size() >> 8));
+            frame.push_back(static_cast<char>(payload.size()));
+        }
+        frame.append(reinterpret_cast<const char*>(Key), 4);
+        for (size_t i = 0; i < payload.size(); ++i)
+            frame.push_back(static_cast<char>(payload[i] ^ Key[i % 4]));
+        return frame;
+    }
+
+    struct Frame
+    {
+        uint8_t first = 0;
+        std::string payload;
+    };
+
+    // Reads a frame of the server, which are not masked
+    bool receiveFrame(TcpClient& client, std::string& input, Frame& frame)
+    {
+        char buffer[4096];
+        for (;;)
+        {
+            if (input.size() >= 2)
+            {
+                size_t length = static_cast<uint8_t>(input[1]) & 0x7f;
+                size_t head   = 2;
+                if (length == 126 && input.size() >= 4)
+                {
+                    length = (size_t(uint8_t(input[2])) << 8) | uint8_t(input[3]);
+                    head   = 4;
+                }
+                if (length != 126 && input.size() >= head + length)
+                {
+                    frame.first   = static_cast<uint8_t>(input[0]);
+                    frame.payload = input.substr(head, length);
+                    input.erase(0, head + length);
+                    return true;
+                }
+            }
+
+            size_t bytes = 0;
+            if (!client.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                return false;
+            input.append(buffer, bytes);
+        }
+    }
+
+    struct WebSocketServer
+    {
+        WebSocketServer()
+            : handler(std::make_shared<EchoHandler>())
+            , endpoint(Address(IP::loopback(), Port(0)))
+        {
+            endpoint.init(Http::Endpoint::options().threads(1).flags(Tcp::Options::ReuseAddr));
+            endpoint.setHandler(Http::make_handler<UpgradeHandler>(handler));
+            endpoint.serveThreaded();
+        }
+
+        ~WebSocketServer() { endpoint.shutdown(); }
+
+        // Connects and sends the upgrade request, the frames follow it
+        // right away. Returns what the server sent past its response
+        bool open(TcpClient& client, std::string& input, const std::string& frames = "",
+                  const std::string& extraHeaders = "")
+        {
+            if (!client.connect(Address(IP::loopback(), endpoint.getPort())))
+                return false;
+
+            const std::string request = "GET /chat HTTP/1.1\r\n"
+                                        "Host: localhost\r\n"
+                                        "Upgrade: websocket\r\n"
+                                        "Connection: keep-alive, Upgrade\r\n"
+                                        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                                        "Sec-WebSocket-Version: 13\r\n";
+            if (!client.send(request + extraHeaders + "\r\n" + frames))
+                return false;
+
+            char buffer[4096];
+            while (input.find("\r\n\r\n") == std::string::npos)
+            {
+                size_t bytes = 0;
+                if (!client.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)) || bytes == 0)
+                    return false;
+                input.append(buffer, bytes);
+            }
+            response = input.substr(0, input.find("\r\n\r\n") + 4);
+            input.erase(0, response.size());
+            return true;
+        }
+
+        std::shared_ptr<EchoHandler> handler;
+        Http::Endpoint endpoint;
+        std::string response;
+    };
+} // namespace
+
+TEST(websocket_test, accept_key)
+{
+    // RFC 6455 1.3
+    EXPECT_EQ(WebSocket::acceptKey("dGhlIHNhbXBsZSBub25jZQ=="), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST(websocket_test, handshake_and_echo)
+{
+    WebSocketServer server;
+    TcpClient client;
+    std::string input;
+
+    // The first frame is sent along with the request
+    ASSERT_TRUE(server.open(client, input, maskedFrame(0x81, "hello")));
+    EXPECT_EQ(server.response.find("HTTP/1.1 101 Switching Protocols\r\n"), 0u) << server.response;
+    EXPECT_NE(server.response.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo="),
+              std::string::npos);
+    EXPECT_NE(server.response.find("Connection: Upgrade"), std::string::npos);
+    EXPECT_EQ(server.response.find("Content-Length"), std::string::npos);
+
+    Frame frame;
+    ASSERT_TRUE(receiveFrame(client, input, frame));
+    EXPECT_EQ(frame.first, 0x81);
+    EXPECT_EQ(frame.payload, "hello");
+
+    // A message in fragments, with a ping in between
+    const std::string large(300, 'a');
+    ASSERT_TRUE(client.send(maskedFrame(0x02, large) + maskedFrame(0x89, "are you there")
+                            + maskedFrame(0x80, "end")));
+
+    ASSERT_TRUE(receiveFrame(client, input, frame));
+    EXPECT_EQ(frame.first, 0x8A);
+    EXPECT_EQ(frame.payload, "are you there");
+
+    ASSERT_TRUE(receiveFrame(client, input, frame));
+    EXPECT_EQ(frame.first, 0x82);
+    EXPECT_EQ(frame.payload, large + "end");
+}
+
+TEST(websocket_test, shared_buffer_is_sent_as_is)
+{
+    WebSocketServer server;
+    TcpClient client;
+    std::string input;
+    ASSERT_TRUE(server.open(client, input));
+
+    ASSERT_TRUE(client.send(maskedFrame(0x81, "broadcast")));
+
+    Frame frame;
+    ASSERT_TRUE(receiveFrame(client, input, frame));
+    EXPECT_EQ(frame.first, 0x81);
+    EXPECT_EQ(frame.payload, std::string(1000, 'x'));
+}
+
+TEST(websocket_test, closing_handshake)
+{
+    WebSocketServer server;
+    TcpClient client;
+    std::string input;
+    ASSERT_TRUE(server.open(client, input));
+
+    // 1000, "bye"
+    ASSERT_TRUE(client.send(maskedFrame(0x88, std::string("\x03\xe8", 2) + "bye")));
+
+    Frame frame;
+    ASSERT_TRUE(receiveFrame(client, input, frame));
+    EXPECT_EQ(frame.first, 0x88);
+    EXPECT_EQ(frame.payload, std::string("\x03\xe8", 2));
+    EXPECT_EQ(server.handler->closeCode.load(), 1000);
+
+    // The server closes the connection once its answer is out
+    char buffer[16];
+    size_t bytes = 1;
+    EXPECT_TRUE(client.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)));
+    EXPECT_EQ(bytes, 0u);
+}
+
+TEST(websocket_test, protocol_errors_close_the_connection)
+{
+    WebSocketServer server;
+    TcpClient client;
+    std::string input;
+    ASSERT_TRUE(server.open(client, input));
+
+    // Not valid UTF-8
+    ASSERT_TRUE(client.send(maskedFrame(0x81, "\xc3\x28")));
+
+    Frame frame;
+    ASSERT_TRUE(receiveFrame(client, input, frame));
+    EXPECT_EQ(frame.first, 0x88);
+    ASSERT_GE(frame.payload.size(), 2u);
+    EXPECT_EQ(frame.payload.substr(0, 2), std::string("\x03\xef", 2));
+    EXPECT_TRUE(waitFor([&] { return server.handler->closeCode.load() == 1007; }));
+}
+
+TEST(websocket_test, invalid_requests_are_not_upgraded)
+{
+    WebSocketServer server;
+    TcpClient client;
+    ASSERT_TRUE(client.connect(Address(IP::loopback(), server.endpoint.getPort())));
+    ASSERT_TRUE(client.send("GET /chat HTTP/1.1\r\n"
+                            "Host: localhost\r\n"
+                            "Upgrade: websocket\r\n"
+                            "Connection: Upgrade\r\n"
+                            "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                            "Sec-WebSocket-Version: 8\r\n\r\n"));
+
+    char buffer[1024];
+    size_t bytes = 0;
+    ASSERT_TRUE(client.receive(buffer, sizeof(buffer), &bytes, std::chrono::seconds(5)));
+    const std::string response(buffer, bytes);
+    EXPECT_EQ(response.find("HTTP/1.1 426"), 0u) << response;
+    EXPECT_NE(response.find("Sec-WebSocket-Version: 13"), std::string::npos);
+}
+
+#ifdef PISTACHE_USE_CONTENT_ENCODING_DEFLATE
+TEST(websocket_test, permessage_deflate)
+{
+    WebSocketServer server;
+    TcpClient client;
+    std::string input;
+    ASSERT_TRUE(server.open(client, input, "",
+                            "Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits\r\n"));
+    EXPECT_NE(server.response.find("Sec-WebSocket-Extensions: permessage-deflate"), std::string::npos)
+        << server.response;
+
+    z_stream deflater {};
+    z_stream inflater {};
+    ASSERT_EQ(deflateInit2(&deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY), Z_OK);
+    ASSERT_EQ(inflateInit2(&inflater, -15), Z_OK);
+
+    // The contexts are kept, the second message refers to the first one
+    const std::string text = std::string(200, 'w') + " compressed " + std::string(200, 'z');
+    for (int i = 0; i < 2; ++i)
+    {
+        std::string compressed(1024, '\0');
+        deflater.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+        deflater.avail_in  = static_cast<uInt>(text.size());
+        deflater.next_out  = reinterpret_cast<Bytef*>(compressed.data());
+        deflater.avail_out = static_cast<uInt>(compressed.size());
+        ASSERT_EQ(deflate(&deflater, Z_SYNC_FLUSH), Z_OK);
+        compressed.resize(compressed.size() - deflater.avail_out - 4);
+
+        ASSERT_TRUE(client.send(maskedFrame(0xC1, compressed)));
+
+        Frame frame;
+        ASSERT_TRUE(receiveFrame(client, input, frame));
+        EXPECT_EQ(frame.first, 0xC1);
+        EXPECT_LT(frame.payload.size(), text.size());
+
+        frame.payload.append("\x00\x00\xff\xff", 4);
+        std::string inflated(2048, '\0');
+        inflater.next_in   = reinterpret_cast<Bytef*>(frame.payload.data());
+        inflater.avail_in  = static_cast<uInt>(frame.payload.size());
+        inflater.next_out  = reinterpret_cast<Bytef*>(inflated.data());
+        inflater.avail_out = static_cast<uInt>(inflated.size());
+        ASSERT_EQ(inflate(&inflater, Z_SYNC_FLUSH), Z_OK);
+        inflated.resize(inflated.size() - inflater.avail_out);
+        EXPECT_EQ(inflated, text);
+    }
+
+    deflateEnd(&deflater);
+    inflateEnd(&inflater);
+}
+#endif